@@ -4,7 +4,9 @@ SUBDIRS += \
 #    qyaml-cpp\
     interface \
     plugins \
-    ebookedit
+    ebookedit \
+    cli \
+    benchmarks
 
 DISTFILES += \
     README.md
@@ -19,3 +21,9 @@ plugins.depends = interface #qyaml-cpp
 
 ebookedit.subdir = ebookedit
 ebookedit.depends = interface #qyaml-cpp
+
+cli.subdir = cli
+cli.depends = interface plugins
+
+benchmarks.subdir = benchmarks
+benchmarks.depends = interface
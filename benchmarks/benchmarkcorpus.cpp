@@ -0,0 +1,335 @@
+#include "benchmarkcorpus.h"
+
+#include <QDir>
+#include <QDomDocument>
+#include <QFile>
+#include <QProcessEnvironment>
+
+#include "ebookmetadata.h"
+#include "epubcontainer.h"
+#include "series.h"
+
+// the commonest words of English prose, with some accented words and a few
+// misspellings so that the spell checker has something to find.
+static const char VOCABULARY[] =
+  "the of and to a in that it was he she for on are with as his her they be "
+  "at one have this from or had by not word but what some we can out other "
+  "were all there when up use your how said an each which do their time if "
+  "will way about many then them write would like so these long make thing "
+  "see him two has look more day could go come did number sound no most "
+  "people my over know water than call first who may down side been now find "
+  "head stand own page should country found answer school grow study still "
+  "learn plant cover food sun between state keep eye never last let thought "
+  "city tree cross farm hard start might story saw far sea draw left late "
+  "run while press close night real life few north open seem together next "
+  "white children begin got walk example ease paper group always music those "
+  "both mark often letter until mile river car feet care second book carry "
+  "took science eat room friend began idea fish mountain stop once base hear "
+  "horse cut sure watch colour face wood main enough plain girl usual young "
+  "ready above ever red list though feel talk bird soon body dog family "
+  "direct pose leave song measure door product black short doesn't it's "
+  "o'clock well-known café naïve façade rôle fiancée recieve seperate "
+  "occured definately wierd untill acheive Árpád Zoë";
+
+static const char* const TITLE_WORDS[] = { "Silent", "River",  "House",
+                                           "Winter", "Garden", "Stone",
+                                           "Last",   "Road",   "Night",
+                                           "Summer", "Crown",  "Sea" };
+
+BenchmarkCorpus::BenchmarkCorpus(quint32 seed)
+  : m_random(seed)
+{
+  m_vocabulary =
+    QString::fromUtf8(VOCABULARY).split(' ', QString::SkipEmptyParts);
+}
+
+/*!
+ * \brief Returns count words picked at random from the vocabulary, as a
+ * sentence with a capital and a full stop.
+ */
+QString
+BenchmarkCorpus::words(int count)
+{
+  QString text;
+  for (int i = 0; i < count; i++) {
+    QString word = m_vocabulary.at(m_random.bounded(m_vocabulary.size()));
+    if (i == 0) {
+      word[0] = word.at(0).toUpper();
+    } else {
+      text += QLatin1Char(' ');
+    }
+    text += word;
+  }
+  text += QLatin1Char('.');
+  return text;
+}
+
+/*!
+ * \brief Returns the body of a paragraph, sentences of between 6 and 20
+ * words, one in four with some of it emphasised.
+ */
+QString
+BenchmarkCorpus::paragraph(int count)
+{
+  QString text;
+  int written = 0;
+  while (written < count) {
+    int length = qMin(6 + int(m_random.bounded(15)), count - written);
+    if (!text.isEmpty()) {
+      text += QLatin1Char(' ');
+    }
+    if (m_random.bounded(4) == 0) {
+      text += QStringLiteral("<em>%1</em>").arg(words(length));
+    } else {
+      text += words(length);
+    }
+    written += length;
+  }
+  return text;
+}
+
+/*!
+ * \brief Returns an xhtml chapter of paragraphs paragraphs.
+ *
+ * About one paragraph in ten links to the heading of another of the
+ * chapters, always with a fragment, so that building the table of contents
+ * from the chapters does not add anchor points to them and can be
+ * repeated.
+ */
+QString
+BenchmarkCorpus::chapter(int number, int chapters, int paragraphs)
+{
+  QString xhtml =
+    QStringLiteral("<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+                   "<!DOCTYPE html>\n"
+                   "<html xmlns=\"http://www.w3.org/1999/xhtml\" "
+                   "xmlns:epub=\"http://www.idpf.org/2007/ops\">\n"
+                   "<head>\n"
+                   "<title>Chapter %1</title>\n"
+                   "<link rel=\"stylesheet\" type=\"text/css\" "
+                   "href=\"style.css\"/>\n"
+                   "</head>\n"
+                   "<body class=\"chapter\">\n"
+                   "<h1 id=\"chapter%1\">Chapter %1</h1>\n")
+      .arg(number);
+  for (int i = 0; i < paragraphs; i++) {
+    xhtml += QStringLiteral("<p id=\"p%1_%2\">").arg(number).arg(i);
+    xhtml += paragraph(WORDS_PER_PARAGRAPH);
+    if (chapters > 1 && m_random.bounded(10) == 0) {
+      int other = 1 + int(m_random.bounded(chapters));
+      xhtml += QStringLiteral(" <a href=\"%1#chapter%2\">See chapter %2.</a>")
+                 .arg(chapterHref(other))
+                 .arg(other);
+    }
+    xhtml += QStringLiteral("</p>\n");
+  }
+  xhtml += QStringLiteral("</body>\n</html>\n");
+  return xhtml;
+}
+
+/*!
+ * \brief Returns the contents chapter, a list of links to the heading of
+ * every chapter.
+ */
+QString
+BenchmarkCorpus::contents(int chapters)
+{
+  QString xhtml =
+    QStringLiteral("<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+                   "<!DOCTYPE html>\n"
+                   "<html xmlns=\"http://www.w3.org/1999/xhtml\">\n"
+                   "<head>\n"
+                   "<title>Contents</title>\n"
+                   "</head>\n"
+                   "<body class=\"contents\">\n"
+                   "<h1 id=\"contents\">Contents</h1>\n"
+                   "<ul>\n");
+  for (int i = 1; i <= chapters; i++) {
+    xhtml +=
+      QStringLiteral("<li><a href=\"%1#chapter%2\">Chapter %2</a></li>\n")
+        .arg(chapterHref(i))
+        .arg(i);
+  }
+  xhtml += QStringLiteral("</ul>\n</body>\n</html>\n");
+  return xhtml;
+}
+
+/*!
+ * \brief Returns a book of a contents chapter and chapters chapters of
+ * paragraphs paragraphs each, with a stylesheet, creators that refine
+ * their roles, a modification date and a calibre series.
+ */
+EBookContent
+BenchmarkCorpus::book(int chapters, int paragraphs)
+{
+  EBookContent content;
+
+  QString metadata_xml =
+    QStringLiteral(
+      "<metadata xmlns:dc=\"http://purl.org/dc/elements/1.1/\" "
+      "xmlns:opf=\"http://www.idpf.org/2007/opf\">\n"
+      "<dc:identifier id=\"uid\">urn:uuid:"
+      "00000000-0000-4000-8000-%1</dc:identifier>\n"
+      "<dc:title id=\"title\">The %2 %3</dc:title>\n"
+      "<dc:language>en</dc:language>\n"
+      "<dc:creator id=\"creator1\">Jane Smith</dc:creator>\n"
+      "<meta refines=\"#creator1\" property=\"role\" "
+      "scheme=\"marc:relators\">aut</meta>\n"
+      "<meta refines=\"#creator1\" property=\"file-as\">Smith, Jane</meta>\n"
+      "<dc:creator id=\"creator2\">John Brown</dc:creator>\n"
+      "<meta refines=\"#creator2\" property=\"role\" "
+      "scheme=\"marc:relators\">ill</meta>\n"
+      "<dc:contributor id=\"contributor1\">Ann Green</dc:contributor>\n"
+      "<meta refines=\"#contributor1\" property=\"role\" "
+      "scheme=\"marc:relators\">edt</meta>\n"
+      "<dc:subject>Fiction</dc:subject>\n"
+      "<dc:description>%4</dc:description>\n"
+      "<meta property=\"dcterms:modified\">2019-01-01T00:00:00Z</meta>\n"
+      "<meta name=\"calibre:series\" content=\"The %2 Books\"/>\n"
+      "<meta name=\"calibre:series_index\" content=\"1\"/>\n"
+      "</metadata>\n")
+      .arg(chapters * 1000 + paragraphs, 12, 10, QLatin1Char('0'))
+      .arg(QString::fromLatin1(TITLE_WORDS[m_random.bounded(12)]))
+      .arg(QString::fromLatin1(TITLE_WORDS[m_random.bounded(12)]))
+      .arg(words(40));
+  QDomDocument metadata_document;
+  metadata_document.setContent(metadata_xml, true);
+  content.metadata = Metadata(new EBookMetadata());
+  content.metadata->parse(metadata_document.elementsByTagName("metadata"));
+
+  EBookContentChapter contents_chapter;
+  contents_chapter.href = QStringLiteral("contents.xhtml");
+  contents_chapter.title = QStringLiteral("Contents");
+  contents_chapter.xhtml = contents(chapters);
+  content.chapters.append(contents_chapter);
+  for (int i = 1; i <= chapters; i++) {
+    EBookContentChapter chapter;
+    chapter.href = chapterHref(i);
+    chapter.title = QStringLiteral("Chapter %1").arg(i);
+    chapter.xhtml = this->chapter(i, chapters, paragraphs);
+    content.chapters.append(chapter);
+  }
+
+  EBookContentResource style;
+  style.href = QStringLiteral("style.css");
+  style.media_type = QStringLiteral("text/css");
+  style.data = "body { margin: 1em; }\n"
+               "h1 { text-align: center; font-size: 1.5em; }\n"
+               "p { text-indent: 1.5em; margin: 0; }\n"
+               ".contents li { list-style: none; }\n";
+  content.resources.append(style);
+  return content;
+}
+
+/*!
+ * \brief Returns the library record of the number'th book of a library.
+ */
+BookData
+BenchmarkCorpus::bookData(int number)
+{
+  BookData book_data = BookData(new EBookData());
+  book_data->uid = quint64(number) + 1;
+  QString title = QStringLiteral("The %1 %2 %3")
+                    .arg(QString::fromLatin1(TITLE_WORDS[m_random.bounded(12)]))
+                    .arg(QString::fromLatin1(TITLE_WORDS[m_random.bounded(12)]))
+                    .arg(number);
+  book_data->title = title;
+  book_data->filename =
+    QStringLiteral("/home/reader/Books/%1.epub").arg(title.toLower());
+  book_data->file_size = 100000 + m_random.bounded(5000000);
+  book_data->file_modified = 1546300800000LL + m_random.bounded(1000000000);
+  book_data->current_spine_index = m_random.bounded(40);
+  book_data->current_spine_lineno = m_random.bounded(300);
+  book_data->content_hash =
+    QString::number(m_random.generate64(), 16).rightJustified(16, '0');
+  if (m_random.bounded(8) == 0) {
+    book_data->book_words << QStringLiteral("Árpád") << QStringLiteral("Zoë");
+    book_data->word_matches.insert(QStringLiteral("recieve"),
+                                   QStringLiteral("receive"));
+  }
+  return book_data;
+}
+
+/*!
+ * \brief Returns where the corpus is written, the directory named by the
+ * BIBLOS_BENCHMARK_CORPUS environment variable or biblos-benchmarks in the
+ * temporary directory.
+ */
+QString
+BenchmarkCorpus::directory()
+{
+  QString path =
+    QProcessEnvironment::systemEnvironment().value("BIBLOS_BENCHMARK_CORPUS");
+  if (path.isEmpty()) {
+    path = QDir::temp().filePath("biblos-benchmarks");
+  }
+  QDir().mkpath(path);
+  return path;
+}
+
+/*!
+ * \brief Returns the path of the book of chapters chapters of paragraphs
+ * paragraphs, writing it first if it is not already in the corpus.
+ *
+ * \return the path, or an empty string if the book could not be written.
+ */
+QString
+BenchmarkCorpus::bookFile(int chapters, int paragraphs)
+{
+  QString path = QDir(directory()).filePath(
+    QStringLiteral("book-%1x%2.epub").arg(chapters).arg(paragraphs));
+  if (QFile::exists(path)) {
+    return path;
+  }
+  BenchmarkCorpus corpus;
+  if (!EPubContainer::writeContent(corpus.book(chapters, paragraphs), path)) {
+    return QString();
+  }
+  return path;
+}
+
+/*!
+ * \brief Returns the path of the yaml library of records books, writing it
+ * first if it is not already in the corpus.
+ *
+ * \return the path, or an empty string if the library could not be
+ * written.
+ */
+QString
+BenchmarkCorpus::libraryFile(int records)
+{
+  QString path = QDir(directory()).filePath(
+    QStringLiteral("library-%1.yaml").arg(records));
+  if (QFile::exists(path)) {
+    return path;
+  }
+  // written elsewhere first, a run stopped part way must not leave a short
+  // library behind to be used by the next.
+  QString temp_path = path + ".part";
+  QFile::remove(temp_path);
+  if (!writeLibrary(temp_path, records) || !QFile::rename(temp_path, path)) {
+    return QString();
+  }
+  return path;
+}
+
+/*!
+ * \brief Writes a yaml library of records books to path.
+ */
+bool
+BenchmarkCorpus::writeLibrary(const QString& path, int records)
+{
+  BenchmarkCorpus corpus;
+  EBookLibraryDB library(SeriesDB(new EBookSeriesDB()));
+  library.setFilename(path);
+  for (int i = 0; i < records; i++) {
+    library.insertOrUpdateBook(corpus.bookData(i));
+  }
+  return library.save();
+}
+
+QString
+BenchmarkCorpus::chapterHref(int number)
+{
+  return QStringLiteral("chapter%1.xhtml").arg(number);
+}
@@ -0,0 +1,52 @@
+#ifndef BENCHMARKCORPUS_H
+#define BENCHMARKCORPUS_H
+
+#include <QRandomGenerator>
+#include <QString>
+#include <QStringList>
+
+#include "ebookcontent.h"
+#include "library.h"
+
+/*!
+ * \brief Makes the books and libraries that the benchmarks run on.
+ *
+ * Everything is made from a QRandomGenerator started from a fixed seed so
+ * the same arguments always give the same corpus, and the figures of two
+ * builds can be compared. The chapters are prose made from a list of
+ * common words, with some accented and misspelt words, emphasis, links to
+ * the headings of other chapters and a contents chapter linking to them
+ * all, which is what the table of contents, highlighter and spell checker
+ * have to work through in a real book.
+ *
+ * The files are written once to directory() and used again by later runs,
+ * bookFile() and libraryFile() only make those that are missing.
+ */
+class BenchmarkCorpus
+{
+public:
+  explicit BenchmarkCorpus(quint32 seed = SEED);
+
+  QString words(int count);
+  QString paragraph(int words);
+  QString chapter(int number, int chapters, int paragraphs);
+  QString contents(int chapters);
+  EBookContent book(int chapters, int paragraphs);
+  BookData bookData(int number);
+
+  static QString directory();
+  static QString bookFile(int chapters, int paragraphs);
+  static QString libraryFile(int records);
+  static bool writeLibrary(const QString& path, int records);
+
+  static QString chapterHref(int number);
+
+  static const quint32 SEED = 0x42494221;
+  static const int WORDS_PER_PARAGRAPH = 60;
+
+protected:
+  QRandomGenerator m_random;
+  QStringList m_vocabulary;
+};
+
+#endif // BENCHMARKCORPUS_H
@@ -0,0 +1,103 @@
+#-------------------------------------------------
+#
+# QBENCHMARK timings of the book, editor, spell checker and library code
+# on a generated corpus, see BenchmarkCorpus.
+#
+# ./biblos-benchmarks [-suite <class name>] [QTest options]
+#
+#-------------------------------------------------
+
+QT       += core gui xml svg concurrent testlib
+QT       -= widgets
+
+TEMPLATE = app
+TARGET = biblos-benchmarks
+CONFIG += console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+CONFIG += c++14
+
+DESTDIR = $$OUT_PWD/..
+
+# the plugins are loaded at run time, so the code that is timed is built
+# into the benchmarks, as the command line tool does with the plugin proxy.
+INCLUDEPATH += \
+    $$PWD/../plugins/epubplugin \
+    $$PWD/../plugins/hunspellplugin \
+    $$PWD/../ebookedit
+
+SOURCES += \
+    main.cpp \
+    benchmarkcorpus.cpp \
+    epubcontainerbenchmark.cpp \
+    epubparsingbenchmark.cpp \
+    hunspellbenchmark.cpp \
+    legacyepub.cpp \
+    legacylookups.cpp \
+    librarybenchmark.cpp \
+    lookupbenchmark.cpp \
+    xhtmlhighlighterbenchmark.cpp \
+    xhtmltokenizerbenchmark.cpp \
+    ../plugins/epubplugin/epubcontainer.cpp \
+    ../plugins/epubplugin/epubentrydevice.cpp \
+    ../plugins/epubplugin/epubfontregistry.cpp \
+    ../plugins/epubplugin/epubparsecache.cpp \
+    ../plugins/epubplugin/epubresourcestore.cpp \
+    ../plugins/epubplugin/epubstylesheetcache.cpp \
+    ../plugins/hunspellplugin/hunspellchecker.cpp \
+    ../plugins/hunspellplugin/hunspelldictionaries.cpp \
+    ../plugins/hunspellplugin/hunspellpool.cpp \
+    ../ebookedit/xhtmlhighlighter.cpp
+
+HEADERS += \
+    benchmarkcorpus.h \
+    epubcontainerbenchmark.h \
+    epubparsingbenchmark.h \
+    hunspellbenchmark.h \
+    legacyepub.h \
+    legacylookups.h \
+    librarybenchmark.h \
+    lookupbenchmark.h \
+    xhtmlhighlighterbenchmark.h \
+    xhtmltokenizerbenchmark.h \
+    ../plugins/epubplugin/epubcontainer.h \
+    ../plugins/epubplugin/epubentrydevice.h \
+    ../plugins/epubplugin/epubfontregistry.h \
+    ../plugins/epubplugin/epubparsecache.h \
+    ../plugins/epubplugin/epubresourcestore.h \
+    ../plugins/epubplugin/epubstylesheetcache.h \
+    ../plugins/hunspellplugin/hunspellchecker.h \
+    ../plugins/hunspellplugin/hunspelldictionaries.h \
+    ../plugins/hunspellplugin/hunspellpool.h \
+    ../ebookedit/xhtmlhighlighter.h
+
+INCLUDEPATH += /usr/local/include
+
+# CVSSplitter library
+unix|win32: LIBS += -lcsvsplitter
+# QYAML-CPP library
+unix|win32: LIBS += -lqyaml-cpp
+# YAML-CPP library
+unix|win32: LIBS += -lyaml-cpp
+# QUAZIP
+unix|win32: LIBS += -lquazip5
+# QLOGGER library
+unix|win32: LIBS += -lqloggerlib
+# HUNSpell library
+unix|win32: LIBS += -lhunspell-1.7
+
+
+win32:CONFIG(release, debug|release): LIBS += -L$$OUT_PWD/../interface/ -linterface
+else:win32:CONFIG(debug, debug|release): LIBS += -L$$OUT_PWD/../interface/ -linterface
+else:unix: LIBS += -L$$OUT_PWD/../interface/ -linterface
+
+INCLUDEPATH += $$PWD/../interface
+DEPENDPATH += $$PWD/../interface
+
+win32-g++:CONFIG(release, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../interface/release/libinterface.a
+else:win32-g++:CONFIG(debug, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../interface/debug/libinterface.a
+else:win32:!win32-g++:CONFIG(release, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../interface/release/interface.lib
+else:win32:!win32-g++:CONFIG(debug, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../interface/debug/interface.lib
+else:unix: PRE_TARGETDEPS += $$OUT_PWD/../interface/libinterface.a
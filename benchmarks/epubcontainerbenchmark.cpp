@@ -0,0 +1,233 @@
+#include "epubcontainerbenchmark.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "benchmarkcorpus.h"
+#include "epubcontainer.h"
+
+/*
+ * A novel, and a book that is long enough for the cost of each chapter to
+ * show over the cost of the archive.
+ */
+static void
+addBooks()
+{
+  QTest::addColumn<int>("chapters");
+  QTest::addColumn<int>("paragraphs");
+  QTest::newRow("novel") << 30 << 120;
+  QTest::newRow("long book") << 120 << 300;
+}
+
+void
+EPubContainerBenchmark::openEager_data()
+{
+  addBooks();
+}
+
+/*
+ * Every chapter is read and parsed before loadFile() returns.
+ */
+void
+EPubContainerBenchmark::openEager()
+{
+  QFETCH(int, chapters);
+  QFETCH(int, paragraphs);
+  QString path = BenchmarkCorpus::bookFile(chapters, paragraphs);
+  QVERIFY(!path.isEmpty());
+
+  QBENCHMARK
+  {
+    EPubContainer container;
+    container.setLazyLoading(false);
+    QVERIFY(container.loadFile(path));
+  }
+}
+
+void
+EPubContainerBenchmark::openLazy_data()
+{
+  addBooks();
+}
+
+/*
+ * Only the package file and the head of the chapters are read, the
+ * chapters being loaded when they are first used.
+ */
+void
+EPubContainerBenchmark::openLazy()
+{
+  QFETCH(int, chapters);
+  QFETCH(int, paragraphs);
+  QString path = BenchmarkCorpus::bookFile(chapters, paragraphs);
+  QVERIFY(!path.isEmpty());
+
+  QBENCHMARK
+  {
+    EPubContainer container;
+    container.setLazyLoading(true);
+    QVERIFY(container.loadFile(path));
+  }
+}
+
+void
+EPubContainerBenchmark::save_data()
+{
+  QTest::addColumn<int>("chapters");
+  QTest::addColumn<int>("paragraphs");
+  QTest::addColumn<int>("edited");
+  QTest::newRow("novel, one chapter edited") << 30 << 120 << 1;
+  QTest::newRow("novel, every chapter edited") << 30 << 120 << 30;
+  QTest::newRow("long book, one chapter edited") << 120 << 300 << 1;
+  QTest::newRow("long book, every chapter edited") << 120 << 300 << 120;
+}
+
+/*
+ * Saves a copy of the book over itself, as the editor does, after editing
+ * the first edited chapters, the rest being copied across compressed.
+ */
+void
+EPubContainerBenchmark::save()
+{
+  QFETCH(int, chapters);
+  QFETCH(int, paragraphs);
+  QFETCH(int, edited);
+  QString path = BenchmarkCorpus::bookFile(chapters, paragraphs);
+  QVERIFY(!path.isEmpty());
+
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  QString copy = dir.filePath("book.epub");
+  QVERIFY(QFile::copy(path, copy));
+
+  EPubContainer container;
+  QVERIFY(container.loadFile(copy));
+  // the contents chapter comes first.
+  QStringList keys = container.spineKeys().mid(1, edited);
+  QStringList documents;
+  foreach (QString key, keys) {
+    documents.append(container.itemDocument(key));
+  }
+
+  int edit = 0;
+  QBENCHMARK
+  {
+    edit++;
+    for (int i = 0; i < keys.size(); i++) {
+      // the document is the inside of the body.
+      container.setItemDocument(
+        keys.at(i), documents.at(i) + QString("<p>Edit %1.</p>\n").arg(edit));
+    }
+    QVERIFY(container.saveFile());
+  }
+}
+
+void
+EPubContainerBenchmark::saveReload_data()
+{
+  QTest::addColumn<bool>("edit_chapter");
+  QTest::addColumn<bool>("edit_metadata");
+  QTest::addColumn<bool>("save_as");
+  QTest::addColumn<bool>("verified");
+  QTest::newRow("chapter edited") << true << false << false << false;
+  QTest::newRow("metadata edited") << false << true << false << false;
+  QTest::newRow("chapter and metadata edited")
+    << true << true << false << false;
+  QTest::newRow("save as") << true << true << true << false;
+  QTest::newRow("chapter edited, verified") << true << false << false << true;
+  QTest::newRow("unchanged, verified") << false << false << false << true;
+}
+
+/*
+ * Saves an edited book through saveFile(), or saveMetadata() when only the
+ * metadata was edited as the editor does, or saveFileVerified() as the
+ * batch resave does, then opens the saved file again and checks that it
+ * verifies and still has its spine and edits.
+ */
+void
+EPubContainerBenchmark::saveReload()
+{
+  QFETCH(bool, edit_chapter);
+  QFETCH(bool, edit_metadata);
+  QFETCH(bool, save_as);
+  QFETCH(bool, verified);
+  QString path = BenchmarkCorpus::bookFile(30, 120);
+  QVERIFY(!path.isEmpty());
+
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  QString copy = dir.filePath("book.epub");
+  QVERIFY(QFile::copy(path, copy));
+  QString saved = (save_as ? dir.filePath("saved.epub") : copy);
+
+  EPubContainer container;
+  QVERIFY(container.loadFile(copy));
+  QStringList spine = container.spineKeys();
+  // the contents chapter comes first.
+  QString key = spine.value(1);
+  if (edit_chapter) {
+    // the document is the inside of the body.
+    container.setItemDocument(
+      key, container.itemDocument(key) + QLatin1String("<p>Edited.</p>\n"));
+  }
+  if (edit_metadata) {
+    EBookMetadataEdit edit;
+    edit.set_series = true;
+    edit.series = "Saved Series";
+    QVERIFY(container.metadata()->applyEdit(edit));
+  }
+  if (verified) {
+    QStringList problems;
+    QVERIFY2(container.saveFileVerified(QString(), problems),
+             qPrintable(problems.join("\n")));
+  } else if (edit_chapter || save_as) {
+    QVERIFY(container.saveFile(save_as ? saved : QString()));
+  } else {
+    QVERIFY(container.saveMetadata());
+  }
+  QVERIFY(container.closeFile());
+
+  EPubContainer reloaded;
+  QVERIFY(reloaded.loadFile(saved));
+  QStringList problems;
+  QVERIFY2(reloaded.verify(problems), qPrintable(problems.join("\n")));
+  QCOMPARE(reloaded.spineKeys(), spine);
+  QCOMPARE(reloaded.itemDocument(key).contains("<p>Edited.</p>"),
+           edit_chapter);
+  QCOMPARE(reloaded.metadata()->calibre()->seriesName(),
+           QString(edit_metadata ? "Saved Series" : ""));
+}
+
+void
+EPubContainerBenchmark::buildTocFromHtml_data()
+{
+  addBooks();
+}
+
+/*
+ * The chapters are loaded first so that only the scan of the chapters for
+ * their links is timed. The corpus only links to fragments, so no anchor
+ * points are added and every pass does the same work.
+ */
+void
+EPubContainerBenchmark::buildTocFromHtml()
+{
+  QFETCH(int, chapters);
+  QFETCH(int, paragraphs);
+  QString path = BenchmarkCorpus::bookFile(chapters, paragraphs);
+  QVERIFY(!path.isEmpty());
+
+  EPubContainer container;
+  QVERIFY(container.loadFile(path));
+  QVERIFY(container.loadAllItems());
+
+  EBookToc toc;
+  QStringList changed_keys;
+  QBENCHMARK
+  {
+    toc = container.buildTocfromHtml(&changed_keys);
+  }
+  QVERIFY(!toc.entries.isEmpty());
+  QVERIFY(changed_keys.isEmpty());
+}
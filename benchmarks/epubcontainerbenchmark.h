@@ -0,0 +1,30 @@
+#ifndef EPUBCONTAINERBENCHMARK_H
+#define EPUBCONTAINERBENCHMARK_H
+
+#include <QObject>
+
+/*!
+ * \brief Times opening, saving and building the table of contents of the
+ * books of the corpus with EPubContainer.
+ *
+ * saveReload() is not timed, it checks that a saved book can be opened and
+ * verified again.
+ */
+class EPubContainerBenchmark : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void openEager_data();
+  void openEager();
+  void openLazy_data();
+  void openLazy();
+  void save_data();
+  void save();
+  void saveReload_data();
+  void saveReload();
+  void buildTocFromHtml_data();
+  void buildTocFromHtml();
+};
+
+#endif // EPUBCONTAINERBENCHMARK_H
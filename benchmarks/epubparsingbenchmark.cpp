@@ -0,0 +1,189 @@
+#include "epubparsingbenchmark.h"
+
+#include <QtTest>
+
+#include "benchmarkcorpus.h"
+#include "epubcontainer.h"
+#include "legacyepub.h"
+
+static const QString PACKAGE_PATH = "OEBPS/content.opf";
+
+/*
+ * The body as parseHtmlItem() keeps it.
+ */
+static QString
+sectionsBody(const QString& container)
+{
+  EPubHtmlSections sections = LegacyEPubContainer::scanHtmlSections(container);
+  if (sections.body_start < 0) {
+    return QString();
+  }
+  return container
+    .midRef(sections.body_start, sections.body_end - sections.body_start)
+    .trimmed()
+    .toString();
+}
+
+/*
+ * Chapters of about 64K, 1M and 5M characters, a paragraph of the corpus
+ * being about 350 characters.
+ */
+static void
+addChapters()
+{
+  QTest::addColumn<QString>("chapter");
+  BenchmarkCorpus corpus;
+  QTest::newRow("64K") << corpus.chapter(1, 30, 64 * 1024 / 350);
+  QTest::newRow("1M") << corpus.chapter(2, 30, 1024 * 1024 / 350);
+  QTest::newRow("5M") << corpus.chapter(3, 30, 5 * 1024 * 1024 / 350);
+}
+
+void
+EPubParsingBenchmark::bodySections_data()
+{
+  addChapters();
+}
+
+void
+EPubParsingBenchmark::bodySections()
+{
+  QFETCH(QString, chapter);
+  QString body;
+  QBENCHMARK
+  {
+    body = sectionsBody(chapter);
+  }
+  QVERIFY(!body.isEmpty());
+}
+
+void
+EPubParsingBenchmark::bodyRegex_data()
+{
+  addChapters();
+}
+
+/*
+ * The regular expressions give up on the largest chapters, when the body
+ * they find is empty, otherwise it must be the same body.
+ */
+void
+EPubParsingBenchmark::bodyRegex()
+{
+  QFETCH(QString, chapter);
+  QString body;
+  QBENCHMARK
+  {
+    body = LegacyEPubContainer::regexBody(chapter);
+  }
+  if (!body.isEmpty()) {
+    QCOMPARE(body, sectionsBody(chapter));
+  }
+}
+
+/*
+ * Package files of books of 30, 300 and 3000 chapters, with the metadata
+ * of the corpus.
+ */
+static void
+addPackages()
+{
+  QTest::addColumn<QString>("package");
+  QTest::addColumn<int>("items");
+  BenchmarkCorpus corpus;
+  foreach (int chapters, QList<int>() << 30 << 300 << 3000) {
+    EBookContent content = corpus.book(chapters, 0);
+    QString package = QString::fromUtf8(
+      LegacyEPubContainer::contentPackageData(content, "nav.xhtml"));
+    // the chapters, the contents chapter, the stylesheet and the nav.
+    QTest::newRow(qPrintable(QString("%1 chapters").arg(chapters)))
+      << package << chapters + 3;
+  }
+}
+
+void
+EPubParsingBenchmark::packageStream_data()
+{
+  addPackages();
+}
+
+void
+EPubParsingBenchmark::packageStream()
+{
+  QFETCH(QString, package);
+  QFETCH(int, items);
+  QBENCHMARK
+  {
+    LegacyEPubContainer container;
+    container.parsePackageContent(package, PACKAGE_PATH);
+    QCOMPARE(container.manifestSize(), items);
+  }
+}
+
+void
+EPubParsingBenchmark::packageDom_data()
+{
+  addPackages();
+}
+
+void
+EPubParsingBenchmark::packageDom()
+{
+  QFETCH(QString, package);
+  QFETCH(int, items);
+  QBENCHMARK
+  {
+    LegacyEPubContainer container;
+    container.parsePackageDom(package, PACKAGE_PATH);
+    QCOMPARE(container.manifestSize(), items);
+  }
+}
+
+/*
+ * A chapter of the corpus of about 1M characters, a link in about one
+ * paragraph in ten, and the contents chapter of a book of 3000 chapters,
+ * which is nothing but links.
+ */
+static void
+addAnchorChapters()
+{
+  QTest::addColumn<QString>("chapter");
+  BenchmarkCorpus corpus;
+  QTest::newRow("1M chapter") << corpus.chapter(1, 30, 1024 * 1024 / 350);
+  QTest::newRow("3000 chapter contents") << corpus.contents(3000);
+}
+
+void
+EPubParsingBenchmark::anchorsTokenizer_data()
+{
+  addAnchorChapters();
+}
+
+void
+EPubParsingBenchmark::anchorsTokenizer()
+{
+  QFETCH(QString, chapter);
+  QList<EPubTocAnchor> anchors;
+  QBENCHMARK
+  {
+    anchors = LegacyEPubContainer::extractAnchors(chapter);
+  }
+  QVERIFY(!anchors.isEmpty());
+}
+
+void
+EPubParsingBenchmark::anchorsScanner_data()
+{
+  addAnchorChapters();
+}
+
+void
+EPubParsingBenchmark::anchorsScanner()
+{
+  QFETCH(QString, chapter);
+  QList<EPubTocAnchor> anchors;
+  QBENCHMARK
+  {
+    anchors = LegacyEPubContainer::scanAnchors(chapter);
+  }
+  QCOMPARE(anchors.size(), LegacyEPubContainer::extractAnchors(chapter).size());
+}
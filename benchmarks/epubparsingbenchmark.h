@@ -0,0 +1,29 @@
+#ifndef EPUBPARSINGBENCHMARK_H
+#define EPUBPARSINGBENCHMARK_H
+
+#include <QObject>
+
+/*!
+ * \brief Times the parsing that EPubContainer does on each chapter and on
+ * the package file against the code that it replaced, see LegacyEPub.
+ */
+class EPubParsingBenchmark : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void bodySections_data();
+  void bodySections();
+  void bodyRegex_data();
+  void bodyRegex();
+  void packageStream_data();
+  void packageStream();
+  void packageDom_data();
+  void packageDom();
+  void anchorsTokenizer_data();
+  void anchorsTokenizer();
+  void anchorsScanner_data();
+  void anchorsScanner();
+};
+
+#endif // EPUBPARSINGBENCHMARK_H
@@ -0,0 +1,170 @@
+#include "hunspellbenchmark.h"
+
+#include <QProcessEnvironment>
+#include <QtConcurrent>
+#include <QtTest>
+
+#include "benchmarkcorpus.h"
+#include "hunspellchecker.h"
+#include "hunspelldictionaries.h"
+#include "hunspellpool.h"
+#include "wordtokenizer.h"
+#include "xhtmldom.h"
+
+// the largest shard checked by one thread, as in HunspellPlugin.
+static const int SHARD_SIZE = 1000;
+
+static void
+addBooks()
+{
+  QTest::addColumn<int>("chapters");
+  QTest::addColumn<int>("paragraphs");
+  QTest::newRow("novel") << 30 << 120;
+  QTest::newRow("long book") << 120 << 300;
+}
+
+void
+HunspellBenchmark::initTestCase()
+{
+  QString directory =
+    QProcessEnvironment::systemEnvironment().value("BIBLOS_DICTIONARIES");
+  if (directory.isEmpty()) {
+    directory = "/usr/share/hunspell";
+  }
+  HunspellDictionaries* dictionaries = HunspellDictionaries::instance();
+  dictionaries->setDirectory(directory);
+  if (!dictionaries->available().contains(
+        HunspellDictionaries::DEFAULT_DICTIONARY)) {
+    QSKIP("The default dictionary is not in the dictionary directory.");
+  }
+  // the first Hunspell object is made with the pool, which is not timed.
+  QVERIFY(dictionaries->pool(HunspellDictionaries::DEFAULT_DICTIONARY));
+}
+
+void
+HunspellBenchmark::bookWords_data()
+{
+  addBooks();
+}
+
+/*
+ * Splitting the text of the chapters into words, which is done before any
+ * of them are checked.
+ */
+void
+HunspellBenchmark::bookWords()
+{
+  QFETCH(int, chapters);
+  QFETCH(int, paragraphs);
+  BenchmarkCorpus corpus;
+  EBookContent content = corpus.book(chapters, paragraphs);
+
+  int count = 0;
+  QBENCHMARK
+  {
+    count = 0;
+    foreach (const EBookContentChapter& chapter, content.chapters) {
+      XhtmlDom dom(chapter.xhtml);
+      QString text =
+        XhtmlDom::textContent(dom.firstElement(QLatin1String("body")));
+      count += EBookWordTokenizer::wordList(text).size();
+    }
+  }
+  QVERIFY(count > 0);
+}
+
+void
+HunspellBenchmark::checkBook_data()
+{
+  addBooks();
+}
+
+/*
+ * The whole book checked as HunspellPlugin::checkBook() does, the words
+ * without repeats split into shards that are checked in parallel, one
+ * Hunspell object from the pool for each thread.
+ */
+void
+HunspellBenchmark::checkBook()
+{
+  QFETCH(int, chapters);
+  QFETCH(int, paragraphs);
+  QStringList book;
+  foreach (const QStringList& words, chapterWords(chapters, paragraphs)) {
+    book += words;
+  }
+  HunspellPool* pool = HunspellDictionaries::instance()->pool(
+    HunspellDictionaries::DEFAULT_DICTIONARY);
+
+  int checked = 0;
+  QBENCHMARK
+  {
+    QStringList words = book;
+    words.removeDuplicates();
+    QList<QStringList> shards;
+    int shard_size =
+      qMin(SHARD_SIZE, (words.size() + pool->size() - 1) / pool->size());
+    for (int i = 0; i < words.size(); i += shard_size) {
+      shards.append(words.mid(i, shard_size));
+    }
+    QFuture<SpellResults> future =
+      QtConcurrent::mapped(shards, HunspellShardCheck(pool));
+    future.waitForFinished();
+    checked = 0;
+    for (int i = 0; i < future.resultCount(); i++) {
+      checked += future.resultAt(i).size();
+    }
+  }
+  QVERIFY(checked > 0);
+}
+
+void
+HunspellBenchmark::checkChapters_data()
+{
+  addBooks();
+}
+
+/*
+ * Each chapter sent to HunspellChecker as one batch, as the editor does
+ * for each document it opens, and timed until every batch has been
+ * reported.
+ */
+void
+HunspellBenchmark::checkChapters()
+{
+  QFETCH(int, chapters);
+  QFETCH(int, paragraphs);
+  QList<QStringList> chapter_words = chapterWords(chapters, paragraphs);
+  HunspellChecker checker;
+
+  QBENCHMARK
+  {
+    QSignalSpy spy(&checker, &HunspellChecker::wordsChecked);
+    foreach (QStringList words, chapter_words) {
+      words.removeDuplicates();
+      checker.checkWords(HunspellDictionaries::DEFAULT_DICTIONARY, words);
+    }
+    while (spy.count() < chapter_words.size()) {
+      QVERIFY(spy.wait(60000));
+    }
+  }
+}
+
+/*
+ * The words of each of the chapters of the book of chapters chapters of
+ * paragraphs paragraphs.
+ */
+QList<QStringList>
+HunspellBenchmark::chapterWords(int chapters, int paragraphs)
+{
+  BenchmarkCorpus corpus;
+  EBookContent content = corpus.book(chapters, paragraphs);
+  QList<QStringList> words;
+  foreach (const EBookContentChapter& chapter, content.chapters) {
+    XhtmlDom dom(chapter.xhtml);
+    QString text =
+      XhtmlDom::textContent(dom.firstElement(QLatin1String("body")));
+    words.append(EBookWordTokenizer::wordList(text));
+  }
+  return words;
+}
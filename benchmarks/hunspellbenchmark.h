@@ -0,0 +1,33 @@
+#ifndef HUNSPELLBENCHMARK_H
+#define HUNSPELLBENCHMARK_H
+
+#include <QList>
+#include <QObject>
+#include <QStringList>
+
+/*!
+ * \brief Times checking the spelling of every word of a book of the
+ * corpus, with the default Hunspell dictionary.
+ *
+ * The dictionaries are read from the directory named by the
+ * BIBLOS_DICTIONARIES environment variable or /usr/share/hunspell, the
+ * benchmarks are skipped if the default dictionary is not there.
+ */
+class HunspellBenchmark : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void initTestCase();
+  void bookWords_data();
+  void bookWords();
+  void checkBook_data();
+  void checkBook();
+  void checkChapters_data();
+  void checkChapters();
+
+protected:
+  static QList<QStringList> chapterWords(int chapters, int paragraphs);
+};
+
+#endif // HUNSPELLBENCHMARK_H
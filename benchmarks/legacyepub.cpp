@@ -0,0 +1,406 @@
+#include "legacyepub.h"
+
+#include <QDir>
+#include <QDomDocument>
+#include <QRegularExpression>
+#include <QTextStream>
+
+// the helpers of the old anchor scanner, see scanAnchors().
+
+/*
+ * Returns the index of the '>' that closes the tag starting at index, ignoring
+ * any '>' characters inside quoted attribute values, or -1 if the tag is not
+ * closed.
+ */
+static int
+findTagEnd(const QString& document, int index)
+{
+  const QChar* data = document.constData();
+  int length = document.length();
+  QChar quote;
+  for (int i = index; i < length; i++) {
+    QChar c = data[i];
+    if (!quote.isNull()) {
+      if (c == quote) {
+        quote = QChar();
+      }
+    } else if (c == '"' || c == '\'') {
+      quote = c;
+    } else if (c == '>') {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/*
+ * true if the text at index is the named tag, ie '<name' followed by white
+ * space, '>' or '/'.
+ */
+static bool
+isTagAt(const QString& document, int index, QLatin1String name)
+{
+  int name_end = index + 1 + name.size();
+  if (name_end >= document.length()) {
+    return false;
+  }
+  if (document.midRef(index + 1, name.size()) != name) {
+    return false;
+  }
+  QChar next = document.at(name_end);
+  return (next.isSpace() || next == '>' || next == '/');
+}
+
+/*
+ * Returns the value of the named attribute within the tag between tag_start
+ * and tag_end, or an empty string if the tag does not have the attribute.
+ */
+static QString
+tagAttribute(const QString& document,
+             int tag_start,
+             int tag_end,
+             QLatin1String name)
+{
+  QStringRef tag = document.midRef(tag_start, tag_end - tag_start);
+  int index = 0;
+  while ((index = tag.indexOf(name, index)) >= 0) {
+    int i = index + name.size();
+    if (index > 0 && !tag.at(index - 1).isSpace()) {
+      index = i; // part of a longer attribute name.
+      continue;
+    }
+    while (i < tag.size() && tag.at(i).isSpace()) {
+      i++;
+    }
+    if (i >= tag.size() || tag.at(i) != '=') {
+      index = i;
+      continue;
+    }
+    i++;
+    while (i < tag.size() && tag.at(i).isSpace()) {
+      i++;
+    }
+    if (i >= tag.size()) {
+      break;
+    }
+    QChar quote = tag.at(i);
+    if (quote == '"' || quote == '\'') {
+      int end = tag.indexOf(quote, i + 1);
+      if (end < 0) {
+        break;
+      }
+      return tag.mid(i + 1, end - i - 1).toString();
+    }
+    int end = i;
+    while (end < tag.size() && !tag.at(end).isSpace() && tag.at(end) != '>') {
+      end++;
+    }
+    return tag.mid(i, end - i).toString();
+  }
+  return QString();
+}
+
+/*!
+ * \brief The body of an html chapter as parseHtmlItem() found it with
+ * regular expressions, before EPubContainer::scanHtmlSections().
+ */
+QString
+LegacyEPubContainer::regexBody(const QString& container)
+{
+  QString in_body;
+  QRegularExpression regex("<body[^>]*>((.|[\n\r])*)<\\/body>");
+  QRegularExpressionMatch match = regex.match(container);
+  int start, end;
+  if (match.isValid()) {
+    in_body = match.captured(0);
+    regex = QRegularExpression("<body[^>]*>");
+    match = regex.match(in_body);
+    if (match.isValid()) {
+      start = match.capturedEnd(0);
+      regex = QRegularExpression("<\\/body>");
+      match = regex.match(in_body);
+      if (match.isValid()) {
+        end = match.capturedStart(0);
+        in_body = in_body.mid(start, end - start);
+      }
+    }
+  }
+  return in_body.trimmed();
+}
+
+/*!
+ * \brief The package file read into a QDomDocument, as parsePackageFile()
+ * did before EPubContainer::parsePackageContent(), without the warnings.
+ *
+ * The manifest items are indexed as they are now, so that only the reading
+ * of the package differs.
+ */
+void
+LegacyEPubContainer::parsePackageDom(const QString& content,
+                                     const QString& full_path)
+{
+  QDomDocument package_document;
+  package_document.setContent(content, true); // turn on namespace processing
+  // parse root element attributes.
+  QDomElement root_element = package_document.documentElement();
+  QDomNamedNodeMap node_map = root_element.attributes();
+  QDomNode node;
+  for (int i = 0; i < node_map.size(); i++) {
+    QDomNode node = node_map.item(i);
+    QString name = node.nodeName();
+    QString value = node.nodeValue().toLower();
+    // parse package attributes.
+    if (name == "version") {
+      if (value == "2.0") {
+        m_version = 2;
+      } else if (value == "3.0") {
+        m_version = 3;
+      }
+    } else if (name == "xmlns") {
+      m_package_xmlns = value;
+    } else if (name == "unique-identifier") {
+      m_metadata->setUniqueIdentifierName(value);
+    } else if (name == "xml:lang") {
+      m_package_language = value;
+    } else if (name == "prefix") { // Only 3.0
+      m_package_prefix = value;
+    } else if (name == "dir") { // Only 3.0
+      m_package_direction = value;
+    } else if (name == "id") { // Only 3.0
+      m_package_id = value;
+    }
+  }
+
+  // parse metadata.
+  QDomNodeList metadata_node_list =
+    package_document.elementsByTagName("metadata");
+  m_metadata->parse(metadata_node_list);
+  m_metadata_xml.clear();
+  if (!m_parse_cache_directory.isEmpty() && !metadata_node_list.isEmpty()) {
+    QTextStream stream(&m_metadata_xml);
+    metadata_node_list.at(0).save(stream, 0);
+  }
+
+  // Extract current path, for resolving relative paths
+  QString content_file_folder;
+  int separator_index = full_path.lastIndexOf('/');
+  if (separator_index > 0) {
+    content_file_folder = full_path.left(separator_index + 1);
+  }
+
+  // should only have one manifest.
+  QDomNodeList manifest_node_list =
+    package_document.elementsByTagName("manifest");
+  for (int i = 0; i < manifest_node_list.count(); i++) {
+    QDomElement manifest_element = manifest_node_list.at(i).toElement();
+    node_map = manifest_element.attributes();
+    node = node_map.namedItem("id");
+    if (!node.isNull()) {
+      m_manifest.id = node.nodeValue();
+    }
+    QDomNodeList manifest_item_list =
+      manifest_element.elementsByTagName("item");
+
+    for (int j = 0; j < manifest_item_list.count(); j++) {
+      parseManifestNode(manifest_item_list.at(j), content_file_folder);
+    }
+  }
+
+  QDomNodeList spine_node_list = package_document.elementsByTagName("spine");
+  for (int i = 0; i < spine_node_list.count(); i++) {
+    QDomElement spine_element = spine_node_list.at(i).toElement();
+    node_map = spine_element.attributes();
+    node = node_map.namedItem("id");
+    if (!node.isNull()) { // optional
+      m_spine.id = node.nodeValue();
+    }
+    node = node_map.namedItem("toc");
+    if (!node.isNull()) { // optional
+      m_spine.toc = node.nodeValue();
+    }
+    node = node_map.namedItem("page-progression-dir");
+    if (!node.isNull()) { // optional
+      m_spine.page_progression_dir = node.nodeValue();
+    }
+
+    QDomNodeList spine_item_list = spine_element.elementsByTagName("itemref");
+    for (int j = 0; j < spine_item_list.count(); j++) {
+      parseSpineNode(spine_item_list.at(j));
+    }
+  }
+}
+
+void
+LegacyEPubContainer::parseManifestNode(const QDomNode& manifest_node,
+                                       const QString& current_folder)
+{
+  QDomElement metadata_element = manifest_node.toElement();
+  QDomNamedNodeMap node_map = metadata_element.attributes();
+  QDomNode node;
+  QString name, value;
+
+  if (metadata_element.tagName() != "item") {
+    return;
+  }
+  SharedManifestItem item = SharedManifestItem(new EPubManifestItem());
+  node = node_map.namedItem("href");
+  if (!node.isNull()) {
+    value = node.nodeValue();
+    item->href = value;
+    item->path = QDir::cleanPath(current_folder + value);
+  }
+
+  node = node_map.namedItem("id");
+  if (!node.isNull()) {
+    item->id = node.nodeValue();
+  }
+
+  node = node_map.namedItem("media-type");
+  if (!node.isNull()) {
+    item->media_type = node.nodeValue().toLatin1();
+  }
+
+  node = node_map.namedItem("properties");
+  if (!node.isNull()) {
+    name = node.nodeName();
+    value = node.nodeValue();
+    // space separated list
+    QStringList properties = value.split(' ', QString::SkipEmptyParts);
+    item->properties = properties;
+
+    foreach (QString prop, properties) {
+      if (prop != "cover-image" && prop != "nav" && prop != "svg" &&
+          prop != "switch" && prop != "mathml" && prop != "remote-resources" &&
+          prop != "scripted") {
+        item->non_standard_properties.insert(name, value);
+      }
+    }
+  }
+
+  node = node_map.namedItem("fallback");
+  if (!node.isNull()) {
+    item->fallback = node.nodeValue();
+  }
+
+  node = node_map.namedItem("media-overlay");
+  if (!node.isNull()) {
+    item->media_overlay = node.nodeValue();
+  }
+
+  indexManifestItem(item);
+}
+
+void
+LegacyEPubContainer::parseSpineNode(const QDomNode& spine_node)
+{
+  QDomElement spine_element = spine_node.toElement();
+  QDomNamedNodeMap node_map = spine_element.attributes();
+  QDomNode node;
+  QString value;
+
+  if (spine_element.tagName() != "itemref") {
+    return;
+  }
+  SharedSpineItem item = SharedSpineItem(new EPubSpineItem());
+  node = node_map.namedItem("idref");
+  if (!node.isNull()) {
+    item->idref = node.nodeValue();
+  }
+
+  node = node_map.namedItem("id");
+  if (!node.isNull()) {
+    item->id = node.nodeValue();
+  }
+
+  node = node_map.namedItem("linear");
+  if (!node.isNull()) {
+    item->linear = (node.nodeValue() == "yes"); // false by default.
+  }
+
+  node = node_map.namedItem("properties");
+  if (!node.isNull()) {
+    // space separated list
+    QStringList properties =
+      node.nodeValue().split(' ', QString::SkipEmptyParts);
+    foreach (QString prop, properties) {
+      if (prop == "page-spread-left") {
+        item->page_spread_left = true;
+      } else if (prop == "page-spread-right") {
+        item->page_spread_right = true;
+      }
+    }
+  }
+
+  m_spine.items.insert(item->idref, item);
+  m_spine.ordered_items.append(item->idref);
+}
+
+/*!
+ * \brief The anchors of an html document, as the character at a time
+ * scanner found them before EPubContainer::extractAnchors() used
+ * XhtmlTokenizer.
+ */
+QList<EPubTocAnchor>
+LegacyEPubContainer::scanAnchors(const QString& document)
+{
+  QList<EPubTocAnchor> anchors;
+  const QChar* data = document.constData();
+  int length = document.length();
+  int i = 0;
+
+  while (i < length) {
+    if (data[i] != '<' || !isTagAt(document, i, QLatin1String("a"))) {
+      i++;
+      continue;
+    }
+
+    int tag_end = findTagEnd(document, i);
+    if (tag_end < 0) {
+      break;
+    }
+    QString href = tagAttribute(document, i, tag_end, QLatin1String("href"));
+
+    // collect the anchor text up to the closing tag.
+    QString text;
+    int j = tag_end + 1;
+    bool closed = false;
+    while (j < length) {
+      if (data[j] == '<') {
+        if (isTagAt(document, j, QLatin1String("/a"))) {
+          closed = true;
+          break;
+        }
+        int inner_end = findTagEnd(document, j);
+        if (inner_end < 0) {
+          j = length;
+          break;
+        }
+        j = inner_end + 1;
+        continue;
+      }
+      text += data[j];
+      j++;
+    }
+
+    if (!closed) {
+      break;
+    }
+
+    if (!href.isEmpty()) {
+      EPubTocAnchor anchor;
+      int hash = href.indexOf('#');
+      if (hash < 0) {
+        anchor.file = href;
+      } else {
+        anchor.file = href.left(hash);
+        anchor.fragment = href.mid(hash + 1);
+        anchor.has_fragment = true;
+      }
+      anchor.text = text;
+      anchors.append(anchor);
+    }
+    i = j;
+  }
+
+  return anchors;
+}
@@ -0,0 +1,37 @@
+#ifndef LEGACYEPUB_H
+#define LEGACYEPUB_H
+
+#include <QDomNode>
+#include <QString>
+
+#include "epubcontainer.h"
+
+/*!
+ * \brief The EPubContainer code that has since been replaced, kept as it
+ * was so that the benchmarks can time the new code against it.
+ *
+ * The protected parsing of EPubContainer that replaced it is made public
+ * here too, so that both can be run on the same input.
+ */
+class LegacyEPubContainer : public EPubContainer
+{
+public:
+  using EPubContainer::contentPackageData;
+  using EPubContainer::extractAnchors;
+  using EPubContainer::parsePackageContent;
+  using EPubContainer::scanHtmlSections;
+
+  static QString regexBody(const QString& container);
+  static QList<EPubTocAnchor> scanAnchors(const QString& document);
+  void parsePackageDom(const QString& content, const QString& full_path);
+
+  int manifestSize() const { return m_manifest.size(); }
+  int spineSize() const { return m_spine.ordered_items.size(); }
+
+protected:
+  void parseManifestNode(const QDomNode& manifest_node,
+                         const QString& current_folder);
+  void parseSpineNode(const QDomNode& spine_node);
+};
+
+#endif // LEGACYEPUB_H
@@ -0,0 +1,851 @@
+#include "legacylookups.h"
+
+/*!
+ * \brief The relator of a MARC code, as MarcRelator::fromString() found it
+ * before it used a lookup table.
+ */
+MarcRelator::Relator
+LegacyLookups::marcRelator(QString relator_name)
+{
+  QString name = relator_name.toLower();
+  if (name == "abr") {
+    return MarcRelator::ABRIDGER;
+  } else if (name == "acp") {
+    return MarcRelator::ART_COPYIST;
+  } else if (name == "act") {
+    return MarcRelator::ACTOR;
+  } else if (name == "adi") {
+    return MarcRelator::ART_DIRECTOR;
+  } else if (name == "adp") {
+    return MarcRelator::ADAPTER;
+  } else if (name == "aft") {
+    return MarcRelator::AUTHOR_OF_AFTERWORD;
+  } else if (name == "anl") {
+    return MarcRelator::ANALYST;
+  } else if (name == "anm") {
+    return MarcRelator::ANIMATOR;
+  } else if (name == "ann") {
+    return MarcRelator::ANNOTATOR;
+  } else if (name == "ant") {
+    return MarcRelator::BIBLIOGRAPHIC_ANTECEDENT;
+  } else if (name == "ape") {
+    return MarcRelator::APPELLEE;
+  } else if (name == "apl") {
+    return MarcRelator::APPELLANT;
+  } else if (name == "app") {
+    return MarcRelator::APPLICANT;
+  } else if (name == "aqt") {
+    return MarcRelator::AUTHOR_IN_QUOTATIONS;
+  } else if (name == "arc") {
+    return MarcRelator::ARCHITECT;
+  } else if (name == "ard") {
+    return MarcRelator::ARTISTIC_DIRECTOR;
+  } else if (name == "arr") {
+    return MarcRelator::ARRANGER;
+  } else if (name == "art") {
+    return MarcRelator::ARTIST;
+  } else if (name == "asg") {
+    return MarcRelator::ASSIGNEE;
+  } else if (name == "asn") {
+    return MarcRelator::ASSOCIATED_NAME;
+  } else if (name == "ato") {
+    return MarcRelator::AUTOGRAPHER;
+  } else if (name == "att") {
+    return MarcRelator::ATTRIBUTED_NAME;
+  } else if (name == "auc") {
+    return MarcRelator::AUCTIONEER;
+  } else if (name == "aut") {
+    return MarcRelator::AUTHOR;
+  } else if (name == "aud") {
+    return MarcRelator::AUTHOR_OF_DIALOG;
+  } else if (name == "aui") {
+    return MarcRelator::AUTHOR_OF_INTRODUCTION;
+  } else if (name == "aus") {
+    return MarcRelator::SCREENWRITER;
+  } else if (name == "bdd") {
+    return MarcRelator::BINDING_DESIGNER;
+  } else if (name == "bjd") {
+    return MarcRelator::BOOKJACKET_DESIGNER;
+  } else if (name == "bkd") {
+    return MarcRelator::BOOK_DESIGNER;
+  } else if (name == "bkp") {
+    return MarcRelator::BOOK_PRODUCER;
+  } else if (name == "blw") {
+    return MarcRelator::BLURB_WRITER;
+  } else if (name == "bnd") {
+    return MarcRelator::BINDER;
+  } else if (name == "bpd") {
+    return MarcRelator::BOOKPLATE_DESIGNER;
+  } else if (name == "brd") {
+    return MarcRelator::BROADCASTER;
+  } else if (name == "brl") {
+    return MarcRelator::BRAILE_EMBOSSER;
+  } else if (name == "bsl") {
+    return MarcRelator::BOOKSELLER;
+  } else if (name == "cas") {
+    return MarcRelator::CASTER;
+  } else if (name == "ccp") {
+    return MarcRelator::CONCEPTOR;
+  } else if (name == "chr") {
+    return MarcRelator::CHOREOGRAPHER;
+  } else if (name == "clb") {
+    return MarcRelator::COLLABORATOR; // Discontinued
+  } else if (name == "cli") {
+    return MarcRelator::CLIENT;
+  } else if (name == "cll") {
+    return MarcRelator::CALLIGRAPHER;
+  } else if (name == "clr") {
+    return MarcRelator::COLORIST;
+  } else if (name == "clt") {
+    return MarcRelator::COLLOTYPER;
+  } else if (name == "cmm") {
+    return MarcRelator::COMMENTATOR;
+  } else if (name == "cmp") {
+    return MarcRelator::COMPOSER;
+  } else if (name == "cmt") {
+    return MarcRelator::COMPOSITOR;
+  } else if (name == "cnd") {
+    return MarcRelator::CONDUCTOR;
+  } else if (name == "cng") {
+    return MarcRelator::CINEMATOGRAPHER;
+  } else if (name == "cns") {
+    return MarcRelator::CENSOR;
+  } else if (name == "coe") {
+    return MarcRelator::CONTESTANT_APPELLEE;
+  } else if (name == "col") {
+    return MarcRelator::CONTESTOR;
+  } else if (name == "com") {
+    return MarcRelator::COMPILER;
+  } else if (name == "con") {
+    return MarcRelator::CONSERVATOR;
+  } else if (name == "cor") {
+    return MarcRelator::COLLECTION_REGISTRAR;
+  } else if (name == "cos") {
+    return MarcRelator::CONTESTANT;
+  } else if (name == "cot") {
+    return MarcRelator::CONTESTEE_APPELLANT;
+  } else if (name == "cou") {
+    return MarcRelator::COURT_GOVERNED;
+  } else if (name == "cov") {
+    return MarcRelator::COVER_DESIGNER;
+  } else if (name == "cpc") {
+    return MarcRelator::COPYRIGHT_CLAIMANT;
+  } else if (name == "cpe") {
+    return MarcRelator::COMPLAINANT_APPELLEE;
+  } else if (name == "cph") {
+    return MarcRelator::COPYRIGHT_HOLDER;
+  } else if (name == "cpl") {
+    return MarcRelator::COMPLAINANT;
+  } else if (name == "cpt") {
+    return MarcRelator::COMPLAINANT_APPELLANT;
+  } else if (name == "cre") {
+    return MarcRelator::CREATOR;
+  } else if (name == "crp") {
+    return MarcRelator::CORRESPONDANT;
+  } else if (name == "crr") {
+    return MarcRelator::CORRECTOR;
+  } else if (name == "crt") {
+    return MarcRelator::COURT_REPORTER;
+  } else if (name == "csl") {
+    return MarcRelator::CONSULTANT;
+  } else if (name == "csp") {
+    return MarcRelator::CONSULTANT_TO_A_PROJECT;
+  } else if (name == "cst") {
+    return MarcRelator::COSTUME_DESIGNER;
+  } else if (name == "ctb") {
+    return MarcRelator::CONTRIBUTOR;
+  } else if (name == "cte") {
+    return MarcRelator::CONTESTEE_APPELLEE;
+  } else if (name == "ctg") {
+    return MarcRelator::CARTOGRAPHER;
+  } else if (name == "ctr") {
+    return MarcRelator::CONTRACTOR;
+  } else if (name == "cts") {
+    return MarcRelator::CONTESTEE;
+  } else if (name == "ctt") {
+    return MarcRelator::CONTESTANT_APPELLANT;
+  } else if (name == "cur") {
+    return MarcRelator::CURATOR;
+  } else if (name == "cwt") {
+    return MarcRelator::COMMENTATOR_FOR_WRITTEN_TEXT;
+  } else if (name == "dbp") {
+    return MarcRelator::DISTIBUTION_PLACE;
+  } else if (name == "dfd") {
+    return MarcRelator::DEFENDANT;
+  } else if (name == "dfe") {
+    return MarcRelator::DEFENDANT_APPELLEE;
+  } else if (name == "dft") {
+    return MarcRelator::DEFENDANT_APPELLANT;
+  } else if (name == "dgg") {
+    return MarcRelator::DEGREE_GRANTING_INSTITUTION;
+  } else if (name == "dgs") {
+    return MarcRelator::DEGREE_SUPERVISOR;
+  } else if (name == "dis") {
+    return MarcRelator::DISSERTANT;
+  } else if (name == "dln") {
+    return MarcRelator::DELINEATOR;
+  } else if (name == "dnc") {
+    return MarcRelator::DANCER;
+  } else if (name == "dnr") {
+    return MarcRelator::DONOR;
+  } else if (name == "dpc") {
+    return MarcRelator::DEPICTED;
+  } else if (name == "dpt") {
+    return MarcRelator::DEPOSITOR;
+  } else if (name == "drm") {
+    return MarcRelator::DRAFTSMAN;
+  } else if (name == "drt") {
+    return MarcRelator::DIRECTOR;
+  } else if (name == "dsr") {
+    return MarcRelator::DESIGNER;
+  } else if (name == "dst") {
+    return MarcRelator::DISTRIBUTOR;
+  } else if (name == "dtc") {
+    return MarcRelator::DATA_CONTRIBUTOR;
+  } else if (name == "dte") {
+    return MarcRelator::DEDICATEE;
+  } else if (name == "dtm") {
+    return MarcRelator::DATA_MANAGER;
+  } else if (name == "dto") {
+    return MarcRelator::DEDICATOR;
+  } else if (name == "dub") {
+    return MarcRelator::DUBIOUS_AUTHOR;
+  } else if (name == "edc") {
+    return MarcRelator::EDITOR_OF_COMPILATION;
+  } else if (name == "edm") {
+    return MarcRelator::EDITOR_OF_MOVING_IMAGE_WORK;
+  } else if (name == "edt") {
+    return MarcRelator::EDITOR;
+  } else if (name == "egr") {
+    return MarcRelator::ENGRAVER;
+  } else if (name == "elg") {
+    return MarcRelator::ELECTRICIAN;
+  } else if (name == "elt") {
+    return MarcRelator::ELECTROTYPER;
+  } else if (name == "eng") {
+    return MarcRelator::ENGINEER;
+  } else if (name == "enj") {
+    return MarcRelator::ENACTING_JURISTICTION;
+  } else if (name == "etr") {
+    return MarcRelator::ETCHER;
+  } else if (name == "evp") {
+    return MarcRelator::EVENT_PLACE;
+  } else if (name == "exp") {
+    return MarcRelator::EXPERT;
+  } else if (name == "fac") {
+    return MarcRelator::FACSIMILIST;
+  } else if (name == "fds") {
+    return MarcRelator::FILM_DISTRIBUTOR;
+  } else if (name == "fld") {
+    return MarcRelator::FIELD_DIRECTOR;
+  } else if (name == "flm") {
+    return MarcRelator::FILM_EDITOR;
+  } else if (name == "fmd") {
+    return MarcRelator::FILM_DIRECTOR;
+  } else if (name == "fmk") {
+    return MarcRelator::FILM_MAKER;
+  } else if (name == "fmo") {
+    return MarcRelator::FORMER_OWNOR;
+  } else if (name == "fmp") {
+    return MarcRelator::FILM_PRODUCER;
+  } else if (name == "fnd") {
+    return MarcRelator::FUNDER;
+  } else if (name == "fpy") {
+    return MarcRelator::FIRST_PARTY;
+  } else if (name == "frg") {
+    return MarcRelator::FORGER;
+  } else if (name == "gis") {
+    return MarcRelator::GEOGRAPHIC_INFORMATION_SPECIALIST;
+  } else if (name == "grt") {
+    return MarcRelator::GRAPHIC_TECHNICIAN; // Discontinued
+  } else if (name == "his") {
+    return MarcRelator::HOST_INSTITUTION;
+  } else if (name == "hnr") {
+    return MarcRelator::HONOREE;
+  } else if (name == "hst") {
+    return MarcRelator::HOST;
+  } else if (name == "ill") {
+    return MarcRelator::ILLISTRATOR;
+  } else if (name == "ilu") {
+    return MarcRelator::ILLUMINATOR;
+  } else if (name == "ins") {
+    return MarcRelator::INSCRIBER;
+  } else if (name == "inv") {
+    return MarcRelator::INVENTOR;
+  } else if (name == "isb") {
+    return MarcRelator::ISSUING_BODY;
+  } else if (name == "itr") {
+    return MarcRelator::INSTRUMENTALIST;
+  } else if (name == "ive") {
+    return MarcRelator::INTERVIEWEE;
+  } else if (name == "ivr") {
+    return MarcRelator::INTERVIEWER;
+  } else if (name == "jud") {
+    return MarcRelator::JUDGE;
+  } else if (name == "jug") {
+    return MarcRelator::JURISTICTION_GOVERNED;
+  } else if (name == "lbr") {
+    return MarcRelator::LABORATORY;
+  } else if (name == "lbt") {
+    return MarcRelator::LIBRETTIST;
+  } else if (name == "ldr") {
+    return MarcRelator::LABORATORY_DIRECTOR;
+  } else if (name == "led") {
+    return MarcRelator::LEAD;
+  } else if (name == "lee") {
+    return MarcRelator::LIBELLEE_APPELEE;
+  } else if (name == "lel") {
+    return MarcRelator::LIBELLEE;
+  } else if (name == "len") {
+    return MarcRelator::LENDER;
+  } else if (name == "let") {
+    return MarcRelator::LIBELLEE_APPELLANT;
+  } else if (name == "lgd") {
+    return MarcRelator::LIGHTING_DESIGNER;
+  } else if (name == "lie") {
+    return MarcRelator::LIBELANT_APPELLEE;
+  } else if (name == "lil") {
+    return MarcRelator::LIBELLANT;
+  } else if (name == "lit") {
+    return MarcRelator::LIBELANT_APPELLANT;
+  } else if (name == "lsa") {
+    return MarcRelator::LANDSCAPE_ARCHITECT;
+  } else if (name == "lse") {
+    return MarcRelator::LICENSEE;
+  } else if (name == "lso") {
+    return MarcRelator::LICENSOR;
+  } else if (name == "ltg") {
+    return MarcRelator::LITHOGRAPHER;
+  } else if (name == "lyr") {
+    return MarcRelator::LYRICIST;
+  } else if (name == "mcp") {
+    return MarcRelator::MUSIC_COPYIST;
+  } else if (name == "mdc") {
+    return MarcRelator::METADATA_CONTACT;
+  } else if (name == "med") {
+    return MarcRelator::MEDIUM;
+  } else if (name == "mfp") {
+    return MarcRelator::MANUFACTURE_PLACE;
+  } else if (name == "mfr") {
+    return MarcRelator::MANFACTURER;
+  } else if (name == "mod") {
+    return MarcRelator::MODERATOR;
+  } else if (name == "mon") {
+    return MarcRelator::MONITOR;
+  } else if (name == "mrb") {
+    return MarcRelator::MARBLER;
+  } else if (name == "mrk") {
+    return MarcRelator::MARKUP_EDITOR;
+  } else if (name == "msd") {
+    return MarcRelator::MUSICAL_DIRECTOR;
+  } else if (name == "mte") {
+    return MarcRelator::METAL_ENGRAVER;
+  } else if (name == "mtk") {
+    return MarcRelator::MINUTE_TAKER;
+  } else if (name == "mus") {
+    return MarcRelator::MUSICIAN;
+  } else if (name == "nrt") {
+    return MarcRelator::NARRATOR;
+  } else if (name == "opn") {
+    return MarcRelator::OPPONENT;
+  } else if (name == "org") {
+    return MarcRelator::ORIGINATOR;
+  } else if (name == "orm") {
+    return MarcRelator::ORGANISER;
+  } else if (name == "osp") {
+    return MarcRelator::ONSCREEN_PRESENTER;
+  } else if (name.startsWith("oth")) {
+    // starts with because non-standard relators are defined as
+    // Other and start with 'oth.' followed by custon definition.
+    return MarcRelator::OTHER;
+  } else if (name == "own") {
+    return MarcRelator::OWNER;
+  } else if (name == "pan") {
+    return MarcRelator::PANELIST;
+  } else if (name == "pat") {
+    return MarcRelator::PATRON;
+  } else if (name == "pbd") {
+    return MarcRelator::PUBLISHING_DIRECTOR;
+  } else if (name == "pbl") {
+    return MarcRelator::PUBLISHER;
+  } else if (name == "pdr") {
+    return MarcRelator::PROJECT_DIRECTOR;
+  } else if (name == "pfr") {
+    return MarcRelator::PROOFREADER;
+  } else if (name == "pht") {
+    return MarcRelator::PHOTOGRAPHER;
+  } else if (name == "plt") {
+    return MarcRelator::PLATEMAKER;
+  } else if (name == "pma") {
+    return MarcRelator::PERMIITIN_AGENCY;
+  } else if (name == "pmn") {
+    return MarcRelator::PRODUCTION_MANAGER;
+  } else if (name == "pop") {
+    return MarcRelator::PRINTER_OF_PLATES;
+  } else if (name == "ppm") {
+    return MarcRelator::PAPERMAKE;
+  } else if (name == "ppt") {
+    return MarcRelator::PUPPETEER;
+  } else if (name == "pra") {
+    return MarcRelator::PRAESES;
+  } else if (name == "prc") {
+    return MarcRelator::PROCESS_CONTACT;
+  } else if (name == "prd") {
+    return MarcRelator::PRODUCTION_PERSONNAL;
+  } else if (name == "pre") {
+    return MarcRelator::PRESENTER;
+  } else if (name == "prf") {
+    return MarcRelator::PERFORMER;
+  } else if (name == "prg") {
+    return MarcRelator::PROGRAMMER;
+  } else if (name == "prm") {
+    return MarcRelator::PRINTMAKER;
+  } else if (name == "prn") {
+    return MarcRelator::PRODUCTION_COMPANY;
+  } else if (name == "pro") {
+    return MarcRelator::PRODUCER;
+  } else if (name == "prp") {
+    return MarcRelator::PRODUCTION_PLACE;
+  } else if (name == "prs") {
+    return MarcRelator::PRODUCTION_DESIGNER;
+  } else if (name == "prt") {
+    return MarcRelator::PRINTER;
+  } else if (name == "prv") {
+    return MarcRelator::PROVIDER;
+  } else if (name == "pta") {
+    return MarcRelator::PATENT_APPLICATION;
+  } else if (name == "pte") {
+    return MarcRelator::PLAINTIFF_APPELLEE;
+  } else if (name == "ptf") {
+    return MarcRelator::PLAINTIFF;
+  } else if (name == "pth") {
+    return MarcRelator::PATENT_HOLDER;
+  } else if (name == "ptt") {
+    return MarcRelator::PLAINTIFF_APPELLANT;
+  } else if (name == "pup") {
+    return MarcRelator::PUBLICATION_PLACE;
+  } else if (name == "rbr") {
+    return MarcRelator::RUBRICATOR;
+  } else if (name == "rcd") {
+    return MarcRelator::RECORDIST;
+  } else if (name == "rce") {
+    return MarcRelator::RECORDING_ENGINEER;
+  } else if (name == "rcp") {
+    return MarcRelator::ADDRESSEE;
+  } else if (name == "rdd") {
+    return MarcRelator::RADIO_DIRECTOR;
+  } else if (name == "red") {
+    return MarcRelator::REDAKTOR;
+  } else if (name == "ren") {
+    return MarcRelator::RENDERER;
+  } else if (name == "res") {
+    return MarcRelator::RESEARCHER;
+  } else if (name == "rev") {
+    return MarcRelator::REVIEWER;
+  } else if (name == "rpc") {
+    return MarcRelator::RADIO_PRODUCER;
+  } else if (name == "rps") {
+    return MarcRelator::REPOSITORY;
+  } else if (name == "rpt") {
+    return MarcRelator::REPOSRTER;
+  } else if (name == "rpy") {
+    return MarcRelator::RESPONSIBLE_PARTY;
+  } else if (name == "rse") {
+    return MarcRelator::RESPONDANT_APPELLEE;
+  } else if (name == "rsg") {
+    return MarcRelator::RESTAGER;
+  } else if (name == "rsp") {
+    return MarcRelator::RESPONDANT;
+  } else if (name == "rsr") {
+    return MarcRelator::RESTORATIONIST;
+  } else if (name == "rst") {
+    return MarcRelator::RESPONDANT_APPELLANT;
+  } else if (name == "rth") {
+    return MarcRelator::RESEARCH_TEAM_HEAD;
+  } else if (name == "rtm") {
+    return MarcRelator::RESEARCH_TEAM_MEMBER;
+  } else if (name == "sad") {
+    return MarcRelator::SCIENTIFIC_ADVISOR;
+  } else if (name == "sce") {
+    return MarcRelator::SCENARIST;
+  } else if (name == "scl") {
+    return MarcRelator::SCULPTOR;
+  } else if (name == "scr") {
+    return MarcRelator::SCRIBE;
+  } else if (name == "sds") {
+    return MarcRelator::SOUND_DESIGNER;
+  } else if (name == "sec") {
+    return MarcRelator::SECRETARY;
+  } else if (name == "sgd") {
+    return MarcRelator::STAGE_DIRECTOR;
+  } else if (name == "sgn") {
+    return MarcRelator::SIGNER;
+  } else if (name == "sht") {
+    return MarcRelator::SUPPORTING_HOST;
+  } else if (name == "sll") {
+    return MarcRelator::SELLER;
+  } else if (name == "sng") {
+    return MarcRelator::SINGER;
+  } else if (name == "spk") {
+    return MarcRelator::SPEAKER;
+  } else if (name == "spn") {
+    return MarcRelator::SPONSOR;
+  } else if (name == "spy") {
+    return MarcRelator::SECOND_PARTY;
+  } else if (name == "srv") {
+    return MarcRelator::SURVEYOR;
+  } else if (name == "std") {
+    return MarcRelator::SET_DESIGNER;
+  } else if (name == "stg") {
+    return MarcRelator::SETTING;
+  } else if (name == "stl") {
+    return MarcRelator::STORYTELLER;
+  } else if (name == "stm") {
+    return MarcRelator::STAGE_MANAGER;
+  } else if (name == "stn") {
+    return MarcRelator::STANDARDS_BODY;
+  } else if (name == "str") {
+    return MarcRelator::STEREOTYPER;
+  } else if (name == "tcd") {
+    return MarcRelator::TECHNICAL_DIRECTOR;
+  } else if (name == "tch") {
+    return MarcRelator::TEACHER;
+  } else if (name == "ths") {
+    return MarcRelator::THESIS_ADVISOR;
+  } else if (name == "tld") {
+    return MarcRelator::TELEVISION_DIRECTOR;
+  } else if (name == "tlp") {
+    return MarcRelator::TELEVISION_PRODUCER;
+  } else if (name == "trc") {
+    return MarcRelator::TRANSCRIBER;
+  } else if (name == "trl") {
+    return MarcRelator::TRANSLATOR;
+  } else if (name == "tyd") {
+    return MarcRelator::TYPE_DESIGNER;
+  } else if (name == "tyg") {
+    return MarcRelator::TYPOGRAPHER;
+  } else if (name == "uvp") {
+    return MarcRelator::UNIVERSITY_PLACE;
+  } else if (name == "vac") {
+    return MarcRelator::VOICE_ACTOR;
+  } else if (name == "vdg") {
+    return MarcRelator::VIDEOGRAPHER;
+  } else if (name == "voc") {
+    return MarcRelator::VOCALIST; // Discontinued
+  } else if (name == "wac") {
+    return MarcRelator::WRITER_OF_ADDED_COMMENTARY;
+  } else if (name == "wal") {
+    return MarcRelator::WRITER_OF_ADDED_LYRICS;
+  } else if (name == "wam") {
+    return MarcRelator::WRITER_OF_ACCOMPANYING_MATERIAL;
+  } else if (name == "wat") {
+    return MarcRelator::WRITER_OF_ADDED_TEXT;
+  } else if (name == "wdc") {
+    return MarcRelator::WOODCUTTER;
+  } else if (name == "wde") {
+    return MarcRelator::WOOD_ENGRAVER;
+  } else if (name == "win") {
+    return MarcRelator::WRITER_OF_INTRODUCTION;
+  } else if (name == "wit") {
+    return MarcRelator::WITNESS;
+  } else if (name == "wpr") {
+    return MarcRelator::WRITER_OF_PREFACE;
+  } else if (name == "wst") {
+    return MarcRelator::WRITER_OF_SUPPLEMENTARY_TEXTUAL_CONTENT;
+  } else {
+    return MarcRelator::NO_TYPE;
+  }
+}
+
+/*!
+ * \brief The term of a dcterms: property, as DCTerms::fromString() found it
+ * before it used a lookup table.
+ *
+ * The names were compared in camel case with the lower case property name,
+ * so only the terms whose names are all lower case were ever found.
+ */
+DCTerms::Term
+LegacyLookups::dcTerm(QString term_name)
+{
+  QString name;
+  if (term_name.toLower().startsWith("dcterms:")) {
+    QStringList splits = term_name.toLower().split(":");
+    if (splits.size() == 2) {
+      name = splits.at(1);
+    } else {
+      return DCTerms::NO_TERM;
+    }
+  }
+  if (name == "abstract") {
+    return DCTerms::ABSTRACT;
+  } else if (name == "accessRights") {
+    return DCTerms::ACCESS_RIGHTS;
+  } else if (name == "accrualMethod") {
+    return DCTerms::ACCRUAL_METHOD;
+  } else if (name == "accrualPeriodicity") {
+    return DCTerms::ACCRUAL_PERIODICITY;
+  } else if (name == "accrualPolicy") {
+    return DCTerms::ACCRUAL_POLICY;
+  } else if (name == "alternative") {
+    return DCTerms::ALTERNATIVE;
+  } else if (name == "audience") {
+    return DCTerms::AUDIENCE;
+  } else if (name == "available") {
+    return DCTerms::AVAILABLE;
+  } else if (name == "bibliographicCitation") {
+    return DCTerms::BIBLIOGRAPHIC_CITATION;
+  } else if (name == "conformsTo") {
+    return DCTerms::CONFORMS_TO;
+  } else if (name == "contributor") {
+    return DCTerms::CONTRIBUTOR;
+  } else if (name == "coverage") {
+    return DCTerms::COVERAGE;
+  } else if (name == "created") {
+    return DCTerms::CREATED;
+  } else if (name == "creator") {
+    return DCTerms::CREATOR;
+  } else if (name == "date") {
+    return DCTerms::DATE;
+  } else if (name == "dateAccepted") {
+    return DCTerms::DATE_ACCEPTED;
+  } else if (name == "dateCopyrighted") {
+    return DCTerms::DATE_COPYRIGHTED;
+  } else if (name == "dateSubmitted") {
+    return DCTerms::DATE_SUBMITTED;
+  } else if (name == "description") {
+    return DCTerms::DESCRIPTION;
+  } else if (name == "educationLevel") {
+    return DCTerms::EDUCATION_LEVEL;
+  } else if (name == "extent") {
+    return DCTerms::EXTENT;
+  } else if (name == "format") {
+    return DCTerms::FORMAT;
+  } else if (name == "hasFormat") {
+    return DCTerms::HAS_FORMAT;
+  } else if (name == "hasPart") {
+    return DCTerms::HAS_PART;
+  } else if (name == "hasVersion") {
+    return DCTerms::HAS_VERSION;
+  } else if (name == "identifier") {
+    return DCTerms::IDENTIFIER;
+  } else if (name == "instructionalMethod") {
+    return DCTerms::INSTRUCTIONAL_METHOD;
+  } else if (name == "isFormatOf") {
+    return DCTerms::IS_FORMAT_OF;
+  } else if (name == "isPartOf") {
+    return DCTerms::IS_PART_OF;
+  } else if (name == "isReferencedBy") {
+    return DCTerms::IS_REFERENCED_BY;
+  } else if (name == "isReplacedBy") {
+    return DCTerms::IS_REPLACED_BY;
+  } else if (name == "isRequiredBy") {
+    return DCTerms::IS_REQUIRED_BY;
+  } else if (name == "issued") {
+    return DCTerms::ISSUED;
+  } else if (name == "isVersionOf") {
+    return DCTerms::IS_VERSION_OF;
+  } else if (name == "language") {
+    return DCTerms::LANGUAGE;
+  } else if (name == "license") {
+    return DCTerms::LICENSE;
+  } else if (name == "mediator") {
+    return DCTerms::MEDIATOR;
+  } else if (name == "medium") {
+    return DCTerms::MEDIUM;
+  } else if (name == "modified") {
+    return DCTerms::MODIFIED;
+  } else if (name == "provenance") {
+    return DCTerms::PROVENANCE;
+  } else if (name == "publisher") {
+    return DCTerms::PUBLISHER;
+  } else if (name == "references") {
+    return DCTerms::REFERENCES;
+  } else if (name == "relation") {
+    return DCTerms::RELATION;
+  } else if (name == "replaces") {
+    return DCTerms::REPLACES;
+  } else if (name == "requires") {
+    return DCTerms::REQUIRES;
+  } else if (name == "rights") {
+    return DCTerms::RIGHTS;
+  } else if (name == "rightsHolder") {
+    return DCTerms::RIGHTS_HOLDER;
+  } else if (name == "source") {
+    return DCTerms::SOURCE;
+  } else if (name == "spatial") {
+    return DCTerms::SPACIAL;
+  } else if (name == "subject") {
+    return DCTerms::SUBJECT;
+  } else if (name == "tableOfContents") {
+    return DCTerms::TABLE_OF_CONTENTS;
+  } else if (name == "temporal") {
+    return DCTerms::TEMPORAL;
+  } else if (name == "title") {
+    return DCTerms::TITLE;
+  } else if (name == "type") {
+    return DCTerms::TYPE;
+  } else if (name == "valid") {
+    return DCTerms::VALID;
+  }
+  return DCTerms::NO_TERM;
+}
+
+/*!
+ * \brief The term of a foaf: property, as Foaf::fromString() found it
+ * before it used a lookup table.
+ */
+Foaf::Term
+LegacyLookups::foafTerm(QString term_name)
+{
+  QString name;
+  if (term_name.toLower().startsWith("foaf:")) {
+    QStringList splits = term_name.toLower().split(":");
+    if (splits.size() == 2) {
+      name = splits.at(1).toLower();
+    } else {
+      return Foaf::NO_TERM;
+    }
+  }
+  if (name == "agent") {
+    return Foaf::AGENT;
+  } else if (name == "person") {
+    return Foaf::PERSON;
+  } else if (name == "name") {
+    return Foaf::NAME;
+  } else if (name == "title") {
+    return Foaf::TITLE;
+  } else if (name == "img") {
+    return Foaf::IMG;
+  } else if (name == "depiction") {
+    return Foaf::DEPICTION;
+  } else if (name == "depicts") {
+    return Foaf::DEPICTS;
+  } else if (name == "familyname") {
+    return Foaf::FAMILY_NAME;
+  } else if (name == "givenname") {
+    return Foaf::GIVEN_NAME;
+  } else if (name == "knows") {
+    return Foaf::KNOWS;
+  } else if (name == "based_near") {
+    return Foaf::BASED_NEAR;
+  } else if (name == "age") {
+    return Foaf::AGE;
+  } else if (name == "made") {
+    return Foaf::MADE;
+  } else if (name == "maker") {
+    return Foaf::MAKER;
+  } else if (name == "primarytopic") {
+    return Foaf::PRIMARY_TOPIC;
+  } else if (name == "primarytopicof") {
+    return Foaf::PRIMARY_TOPIC_OF;
+  } else if (name == "project") {
+    return Foaf::PROJECT;
+  } else if (name == "organization") {
+    return Foaf::ORGANISATION;
+  } else if (name == "group") {
+    return Foaf::GROUP;
+  } else if (name == "member") {
+    return Foaf::MEMBER;
+  } else if (name == "document") {
+    return Foaf::DOCUMENT;
+  } else if (name == "image") {
+    return Foaf::IMAGE;
+  } else if (name == "nick") {
+    return Foaf::NICK;
+  } else if (name == "mbox") {
+    return Foaf::MBOX;
+  } else if (name == "homepage") {
+    return Foaf::HOMEPAGE;
+  } else if (name == "weblog") {
+    return Foaf::WEBLOG;
+  } else if (name == "openid") {
+    return Foaf::OPENID;
+  } else if (name == "jabberid") {
+    return Foaf::JABBER_ID;
+  } else if (name == "mbox_sha1sum") {
+    return Foaf::MBOX_SHA1SUM;
+  } else if (name == "interest") {
+    return Foaf::INTEREST;
+  } else if (name == "topic_interest") {
+    return Foaf::TOPIC_INTEREST;
+  } else if (name == "topic") {
+    return Foaf::TOPIC;
+  } else if (name == "page") {
+    return Foaf::PAGE;
+  } else if (name == "workplacehomepage") {
+    return Foaf::WORKPLACE_HOMEPAGE;
+  } else if (name == "workinfohomepage") {
+    return Foaf::WORK_INFO_HOMEPAGE;
+  } else if (name == "schoolhomepage") {
+    return Foaf::SCHOOL_HOMEPAGE;
+  } else if (name == "publications") {
+    return Foaf::PUBLICATIONS;
+  } else if (name == "currentproject") {
+    return Foaf::CURRENT_PROJECT;
+  } else if (name == "pastproject") {
+    return Foaf::PAST_PROJECT;
+  } else if (name == "account") {
+    return Foaf::ACCOUNT;
+  } else if (name == "onlineaccount") {
+    return Foaf::ONLINE_ACCOUNT;
+  } else if (name == "accountname") {
+    return Foaf::ACCOUNT_NAME;
+  } else if (name == "accountservicehomepage") {
+    return Foaf::ACCOUNT_SERVICE_HOMEPAGE;
+  } else if (name == "personalprofiledocument") {
+    return Foaf::PERSONAL_PROFILE_DOCUMENT;
+  } else if (name == "tipjar") {
+    return Foaf::TIPJAR;
+  } else if (name == "sha1") {
+    return Foaf::SHA1;
+  } else if (name == "thumbnail") {
+    return Foaf::THUMBNAIL;
+  } else if (name == "logo") {
+    return Foaf::LOGO;
+  }
+  return Foaf::NO_TERM;
+}
+
+/*!
+ * \brief The guide type of an opf guide reference, as
+ * EPubGuideItem::fromString() found it before it used a lookup table.
+ */
+EPubGuideItem::GuideType
+LegacyLookups::guideType(QString type)
+{
+  if (type == "cover") {
+    return EPubGuideItem::cover;
+  } else if (type == "title-page") {
+    return EPubGuideItem::title_page;
+  } else if (type == "toc") {
+    return EPubGuideItem::toc;
+  } else if (type == "index") {
+    return EPubGuideItem::index;
+  } else if (type == "glossary") {
+    return EPubGuideItem::glossary;
+  } else if (type == "acknowledgements") {
+    return EPubGuideItem::acknowledgements;
+  } else if (type == "bibliography") {
+    return EPubGuideItem::bibliography;
+  } else if (type == "colophon") {
+    return EPubGuideItem::colophon;
+  } else if (type == "copyright-page") {
+    return EPubGuideItem::copyright_page;
+  } else if (type == "dedication") {
+    return EPubGuideItem::dedication;
+  } else if (type == "epigraph") {
+    return EPubGuideItem::epigraph;
+  } else if (type == "foreword") {
+    return EPubGuideItem::foreword;
+  } else if (type == "loi") { // list of illustrations
+    return EPubGuideItem::loi;
+  } else if (type == "lot") { // list of tables
+    return EPubGuideItem::lot;
+  } else if (type == "notes") {
+    return EPubGuideItem::notes;
+  } else if (type == "preface") {
+    return EPubGuideItem::preface;
+  } else {
+    return EPubGuideItem::text;
+  }
+}
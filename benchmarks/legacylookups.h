@@ -0,0 +1,28 @@
+#ifndef LEGACYLOOKUPS_H
+#define LEGACYLOOKUPS_H
+
+#include <QString>
+
+#include "dcterms.h"
+#include "epubcontainer.h"
+#include "foaf.h"
+#include "marcrelator.h"
+
+/*!
+ * \brief The if/else chains that the fromString() methods were before they
+ * used the tables of LookupTable, kept so that the benchmarks can time the
+ * tables against them.
+ *
+ * Each returns the enum value that the old fromString() set on the object
+ * that it returned.
+ */
+class LegacyLookups
+{
+public:
+  static MarcRelator::Relator marcRelator(QString relator_name);
+  static DCTerms::Term dcTerm(QString term_name);
+  static Foaf::Term foafTerm(QString term_name);
+  static EPubGuideItem::GuideType guideType(QString type);
+};
+
+#endif // LEGACYLOOKUPS_H
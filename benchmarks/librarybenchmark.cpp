@@ -0,0 +1,106 @@
+#include "librarybenchmark.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include "benchmarkcorpus.h"
+#include "library.h"
+#include "series.h"
+
+static void
+addLibraries()
+{
+  QTest::addColumn<int>("records");
+  QTest::newRow("1k") << 1000;
+  QTest::newRow("10k") << 10000;
+  QTest::newRow("100k") << 100000;
+}
+
+void
+LibraryBenchmark::load_data()
+{
+  addLibraries();
+}
+
+void
+LibraryBenchmark::load()
+{
+  QFETCH(int, records);
+  QString path = BenchmarkCorpus::libraryFile(records);
+  QVERIFY(!path.isEmpty());
+
+  QBENCHMARK
+  {
+    EBookLibraryDB library(SeriesDB(new EBookSeriesDB()));
+    QVERIFY(library.load(path));
+    QCOMPARE(library.books().size(), records);
+  }
+}
+
+void
+LibraryBenchmark::save_data()
+{
+  addLibraries();
+}
+
+/*
+ * The whole library written again, as when it is first saved or its
+ * journal is compacted.
+ */
+void
+LibraryBenchmark::save()
+{
+  QFETCH(int, records);
+  QString path = BenchmarkCorpus::libraryFile(records);
+  QVERIFY(!path.isEmpty());
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  QString copy = dir.filePath("library.yaml");
+  QVERIFY(QFile::copy(path, copy));
+
+  EBookLibraryDB library(SeriesDB(new EBookSeriesDB()));
+  QVERIFY(library.load(copy));
+  QBENCHMARK
+  {
+    // with nothing changed the save writes every book.
+    library.setModified(true);
+    QVERIFY(library.save());
+  }
+}
+
+void
+LibraryBenchmark::saveChange_data()
+{
+  addLibraries();
+}
+
+/*
+ * One book changed and saved, which only appends the book to the journal
+ * of the library.
+ */
+void
+LibraryBenchmark::saveChange()
+{
+  QFETCH(int, records);
+  QString path = BenchmarkCorpus::libraryFile(records);
+  QVERIFY(!path.isEmpty());
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  QString copy = dir.filePath("library.yaml");
+  QVERIFY(QFile::copy(path, copy));
+
+  EBookLibraryDB library(SeriesDB(new EBookSeriesDB()));
+  QVERIFY(library.load(copy));
+  BookData book_data = library.bookByUid(1);
+  QVERIFY(book_data);
+  QBENCHMARK
+  {
+    // records are immutable snapshots, a change goes into a copy.
+    BookData changed(new EBookData(*book_data));
+    changed->current_spine_lineno++;
+    library.insertOrUpdateBook(changed);
+    book_data = changed;
+    QVERIFY(library.save());
+  }
+}
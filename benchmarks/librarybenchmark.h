@@ -0,0 +1,22 @@
+#ifndef LIBRARYBENCHMARK_H
+#define LIBRARYBENCHMARK_H
+
+#include <QObject>
+
+/*!
+ * \brief Times loading and saving the yaml library of EBookLibraryDB.
+ */
+class LibraryBenchmark : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void load_data();
+  void load();
+  void save_data();
+  void save();
+  void saveChange_data();
+  void saveChange();
+};
+
+#endif // LIBRARYBENCHMARK_H
@@ -0,0 +1,147 @@
+#include "lookupbenchmark.h"
+
+#include <QtTest>
+
+#include "legacylookups.h"
+
+static void
+addLookups()
+{
+  QTest::addColumn<bool>("legacy");
+  QTest::newRow("lookup table") << false;
+  QTest::newRow("if/else chain") << true;
+}
+
+void
+LookupBenchmark::marcRelator_data()
+{
+  addLookups();
+}
+
+void
+LookupBenchmark::marcRelator()
+{
+  QFETCH(bool, legacy);
+  QStringList names;
+  for (int i = MarcRelator::ABRIDGER;
+       i <= MarcRelator::WRITER_OF_SUPPLEMENTARY_TEXTUAL_CONTENT;
+       i++) {
+    names.append(MarcRelator::toString(MarcRelator::Relator(i)));
+  }
+  names << "AUT" << "oth.compiler" << "xyz";
+
+  int found = 0;
+  QBENCHMARK
+  {
+    found = 0;
+    foreach (QString name, names) {
+      MarcRelator::Relator relator =
+        legacy ? LegacyLookups::marcRelator(name)
+               : MarcRelator::fromString(name).type();
+      if (relator != MarcRelator::NO_TYPE) {
+        found++;
+      }
+    }
+  }
+  QVERIFY(found > 0);
+}
+
+void
+LookupBenchmark::dcTerms_data()
+{
+  addLookups();
+}
+
+void
+LookupBenchmark::dcTerms()
+{
+  QFETCH(bool, legacy);
+  QStringList names;
+  for (int i = DCTerms::ABSTRACT; i <= DCTerms::VALID; i++) {
+    names.append(DCTerms::toString(DCTerms::Term(i)));
+  }
+  names << "DCTERMS:MODIFIED" << "dcterms:unknown" << "marc:relators";
+
+  int found = 0;
+  QBENCHMARK
+  {
+    found = 0;
+    foreach (QString name, names) {
+      DCTerms::Term term = legacy ? LegacyLookups::dcTerm(name)
+                                  : DCTerms::fromString(name).term();
+      if (term != DCTerms::NO_TERM) {
+        found++;
+      }
+    }
+  }
+  QVERIFY(found > 0);
+}
+
+void
+LookupBenchmark::foaf_data()
+{
+  addLookups();
+}
+
+void
+LookupBenchmark::foaf()
+{
+  QFETCH(bool, legacy);
+  QStringList names;
+  for (int i = Foaf::AGENT; i <= Foaf::LOGO; i++) {
+    names.append(Foaf::toString(Foaf::Term(i)));
+  }
+  names << "FOAF:NAME" << "foaf:unknown" << "dcterms:title";
+
+  int found = 0;
+  QBENCHMARK
+  {
+    found = 0;
+    foreach (QString name, names) {
+      Foaf::Term term = legacy ? LegacyLookups::foafTerm(name)
+                               : Foaf::fromString(name).term();
+      if (term != Foaf::NO_TERM) {
+        found++;
+      }
+    }
+  }
+  QVERIFY(found > 0);
+}
+
+void
+LookupBenchmark::guideType_data()
+{
+  addLookups();
+}
+
+/*
+ * Most references of a guide are to the text, the last of the chain.
+ */
+void
+LookupBenchmark::guideType()
+{
+  QFETCH(bool, legacy);
+  QStringList names;
+  for (int i = EPubGuideItem::cover; i <= EPubGuideItem::text; i++) {
+    names.append(EPubGuideItem::toString(EPubGuideItem::GuideType(i)));
+  }
+  int count = names.size();
+  for (int i = 0; i < count; i++) {
+    names.append("text");
+  }
+
+  int text = 0;
+  QBENCHMARK
+  {
+    text = 0;
+    foreach (QString name, names) {
+      EPubGuideItem::GuideType type = legacy
+                                        ? LegacyLookups::guideType(name)
+                                        : EPubGuideItem::fromString(name);
+      if (type == EPubGuideItem::text) {
+        text++;
+      }
+    }
+  }
+  QVERIFY(text > 0);
+}
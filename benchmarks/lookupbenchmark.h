@@ -0,0 +1,29 @@
+#ifndef LOOKUPBENCHMARK_H
+#define LOOKUPBENCHMARK_H
+
+#include <QObject>
+
+/*!
+ * \brief Times the fromString() lookups of the metadata vocabularies and
+ * the guide types against the if/else chains they replaced, see
+ * LegacyLookups.
+ *
+ * Every name of each vocabulary is looked up, along with a few that are
+ * not in it, in the case they are written in books.
+ */
+class LookupBenchmark : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void marcRelator_data();
+  void marcRelator();
+  void dcTerms_data();
+  void dcTerms();
+  void foaf_data();
+  void foaf();
+  void guideType_data();
+  void guideType();
+};
+
+#endif // LOOKUPBENCHMARK_H
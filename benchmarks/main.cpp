@@ -0,0 +1,56 @@
+#include <QGuiApplication>
+#include <QtTest>
+
+#include "epubcontainerbenchmark.h"
+#include "epubparsingbenchmark.h"
+#include "hunspellbenchmark.h"
+#include "librarybenchmark.h"
+#include "lookupbenchmark.h"
+#include "xhtmlhighlighterbenchmark.h"
+#include "xhtmltokenizerbenchmark.h"
+
+/*
+ * Runs every benchmark, or only the one named by -suite, the class name of
+ * the benchmark. Every other argument is passed on to QTest, so the usual
+ * -iterations, -callgrind or function names can be given, although a
+ * function name only makes sense together with -suite.
+ */
+int
+main(int argc, char* argv[])
+{
+  // the benchmarks need QtGui for fonts and text layout, never a display.
+  if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  }
+  QGuiApplication a(argc, argv);
+  QCoreApplication::setApplicationName("Biblos");
+
+  QStringList arguments = QCoreApplication::arguments();
+  QString suite;
+  int index = arguments.indexOf("-suite");
+  if (index > 0 && index + 1 < arguments.size()) {
+    suite = arguments.at(index + 1);
+    arguments.removeAt(index + 1);
+    arguments.removeAt(index);
+  }
+
+  EPubContainerBenchmark epub_container;
+  EPubParsingBenchmark epub_parsing;
+  XhtmlTokenizerBenchmark xhtml_tokenizer;
+  XhtmlHighlighterBenchmark xhtml_highlighter;
+  HunspellBenchmark hunspell;
+  LibraryBenchmark library;
+  LookupBenchmark lookup;
+  QList<QObject*> benchmarks;
+  benchmarks << &epub_container << &epub_parsing << &xhtml_tokenizer
+             << &xhtml_highlighter << &hunspell << &library << &lookup;
+
+  int result = 0;
+  foreach (QObject* benchmark, benchmarks) {
+    if (suite.isEmpty() ||
+        suite == QLatin1String(benchmark->metaObject()->className())) {
+      result |= QTest::qExec(benchmark, arguments);
+    }
+  }
+  return result;
+}
@@ -0,0 +1,42 @@
+#include "xhtmlhighlighterbenchmark.h"
+
+#include <QTextDocument>
+#include <QtTest>
+
+#include "benchmarkcorpus.h"
+#include "options.h"
+#include "xhtmlhighlighter.h"
+
+void
+XhtmlHighlighterBenchmark::highlightLargeBlock_data()
+{
+  QTest::addColumn<int>("characters");
+  QTest::newRow("64K") << 64 * 1024;
+  QTest::newRow("1M") << 1024 * 1024;
+  QTest::newRow("4M") << 4 * 1024 * 1024;
+}
+
+/*
+ * A chapter of about characters characters with its line ends taken out,
+ * so the highlighter is given the whole of it as one block.
+ */
+void
+XhtmlHighlighterBenchmark::highlightLargeBlock()
+{
+  QFETCH(int, characters);
+  BenchmarkCorpus corpus;
+  // a paragraph of the corpus is about 350 characters.
+  QString line = corpus.chapter(1, 1, characters / 350 + 1);
+  line.replace(QLatin1Char('\n'), QLatin1Char(' '));
+
+  Options options;
+  QTextDocument document;
+  document.setPlainText(line);
+  QCOMPARE(document.blockCount(), 1);
+  XhtmlHighlighter highlighter(&options, &document);
+
+  QBENCHMARK
+  {
+    highlighter.rehighlight();
+  }
+}
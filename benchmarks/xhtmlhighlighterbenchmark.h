@@ -0,0 +1,19 @@
+#ifndef XHTMLHIGHLIGHTERBENCHMARK_H
+#define XHTMLHIGHLIGHTERBENCHMARK_H
+
+#include <QObject>
+
+/*!
+ * \brief Times XhtmlHighlighter on a chapter that is all one block, the
+ * minified xhtml that some books are made of.
+ */
+class XhtmlHighlighterBenchmark : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void highlightLargeBlock_data();
+  void highlightLargeBlock();
+};
+
+#endif // XHTMLHIGHLIGHTERBENCHMARK_H
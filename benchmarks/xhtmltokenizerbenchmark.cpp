@@ -0,0 +1,65 @@
+#include "xhtmltokenizerbenchmark.h"
+
+#include <QtTest>
+
+#include "benchmarkcorpus.h"
+#include "xhtmltokenizer.h"
+
+/*
+ * A chapter of about 1M characters with every character made ascii, so
+ * that only the fast path is taken, the chapter as the corpus makes it,
+ * and the chapter with every e accented, so that the text is full of
+ * characters that the fast path does not take. It is tokenized whole, as
+ * the scanners of the container do, or a line at a time with the state
+ * carried from one line to the next, as the highlighter does.
+ */
+void
+XhtmlTokenizerBenchmark::tokenize_data()
+{
+  QTest::addColumn<QString>("chapter");
+  QTest::addColumn<bool>("by_line");
+  BenchmarkCorpus corpus;
+  QString chapter = corpus.chapter(1, 30, 1024 * 1024 / 350);
+  QString ascii = chapter;
+  for (int i = 0; i < ascii.size(); i++) {
+    if (ascii.at(i).unicode() > 0x7f) {
+      ascii[i] = QLatin1Char('e');
+    }
+  }
+  QString accented = chapter;
+  accented.replace(QLatin1Char('e'), QChar(0x00e9));
+
+  QTest::newRow("ascii") << ascii << false;
+  QTest::newRow("corpus") << chapter << false;
+  QTest::newRow("accented") << accented << false;
+  QTest::newRow("ascii, a line at a time") << ascii << true;
+}
+
+void
+XhtmlTokenizerBenchmark::tokenize()
+{
+  QFETCH(QString, chapter);
+  QFETCH(bool, by_line);
+  QVector<QStringRef> lines;
+  if (by_line) {
+    lines = chapter.splitRef(QLatin1Char('\n'));
+  } else {
+    lines.append(QStringRef(&chapter));
+  }
+
+  int tokens = 0;
+  QBENCHMARK
+  {
+    tokens = 0;
+    int state = XhtmlTokenizer::TEXT_STATE;
+    foreach (const QStringRef& line, lines) {
+      XhtmlTokenizer tokenizer(line, state);
+      while (!tokenizer.atEnd()) {
+        tokenizer.next();
+        tokens++;
+      }
+      state = tokenizer.state();
+    }
+  }
+  QVERIFY(tokens > 0);
+}
@@ -0,0 +1,19 @@
+#ifndef XHTMLTOKENIZERBENCHMARK_H
+#define XHTMLTOKENIZERBENCHMARK_H
+
+#include <QObject>
+
+/*!
+ * \brief Times the XhtmlTokenizer loop that the container's scanners and
+ * the highlighter share.
+ */
+class XhtmlTokenizerBenchmark : public QObject
+{
+  Q_OBJECT
+
+private slots:
+  void tokenize_data();
+  void tokenize();
+};
+
+#endif // XHTMLTOKENIZERBENCHMARK_H
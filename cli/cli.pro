@@ -0,0 +1,60 @@
+#-------------------------------------------------
+#
+# The headless command line tool, the book plugins without widgets.
+#
+#-------------------------------------------------
+
+QT       += core gui xml svg sql concurrent
+QT       -= widgets
+
+TEMPLATE = app
+TARGET = ebookedit-cli
+CONFIG += console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+CONFIG += c++14
+
+DESTDIR = $$OUT_PWD/..
+
+# the plugin loading is shared with Biblos.
+INCLUDEPATH += $$PWD/../ebookedit
+
+SOURCES += \
+    main.cpp \
+    ebookbatch.cpp \
+    ../ebookedit/ebookpluginproxy.cpp \
+    ../ebookedit/ebooktypesniffer.cpp
+
+HEADERS += \
+    ebookbatch.h \
+    ../ebookedit/ebookpluginproxy.h \
+    ../ebookedit/ebooktypesniffer.h
+
+INCLUDEPATH += /usr/local/include
+
+# CVSSplitter library
+unix|win32: LIBS += -lcsvsplitter
+# QYAML-CPP library
+unix|win32: LIBS += -lqyaml-cpp
+# YAML-CPP library
+unix|win32: LIBS += -lyaml-cpp
+# QUAZIP
+unix|win32: LIBS += -lquazip5
+# QLOGGER library
+unix|win32: LIBS += -lqloggerlib
+
+
+win32:CONFIG(release, debug|release): LIBS += -L$$OUT_PWD/../interface/ -linterface
+else:win32:CONFIG(debug, debug|release): LIBS += -L$$OUT_PWD/../interface/ -linterface
+else:unix: LIBS += -L$$OUT_PWD/../interface/ -linterface
+
+INCLUDEPATH += $$PWD/../interface
+DEPENDPATH += $$PWD/../interface
+
+win32-g++:CONFIG(release, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../interface/release/libinterface.a
+else:win32-g++:CONFIG(debug, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../interface/debug/libinterface.a
+else:win32:!win32-g++:CONFIG(release, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../interface/release/interface.lib
+else:win32:!win32-g++:CONFIG(debug, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../interface/debug/interface.lib
+else:unix: PRE_TARGETDEPS += $$OUT_PWD/../interface/libinterface.a
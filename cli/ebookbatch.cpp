@@ -0,0 +1,532 @@
+#include "ebookbatch.h"
+
+#include <QCommandLineParser>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QSet>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <QXmlStreamWriter>
+#include <QtEndian>
+
+#include <qlogger/qlogger.h>
+
+#include "ebookconverter.h"
+#include "ebookjobs.h"
+#include "searchindex.h"
+
+using namespace qlogger;
+
+const QString EBookBatch::PREF_FILE = "preferences.yaml";
+
+EBookBatch::EBookBatch()
+  : m_options(new Options())
+  , m_command(NO_COMMAND)
+  , m_jobs(0)
+{}
+
+EBookBatch::~EBookBatch()
+{
+  // let any job still writing a book finish first.
+  EBookJobs::pool()->waitForDone();
+  qDeleteAll(m_plugins);
+  delete m_options;
+}
+
+/*!
+ * \brief Runs the command given on the command line over the books.
+ *
+ * \return EXIT_OK if every book succeeded, EXIT_FAILED if any failed or
+ *         EXIT_USAGE if the command line was wrong.
+ */
+int
+EBookBatch::run(const QStringList& arguments)
+{
+  QCommandLineParser parser;
+  parser.setApplicationDescription(
+    tr("Processes books without opening a window."));
+  parser.addHelpOption();
+  parser.addPositionalArgument(
+    "command",
+    tr("One of resave, metadata-dump, index, verify, convert or compare."));
+  parser.addPositionalArgument(
+    "files", tr("The books, directories are searched for books."), "files...");
+  QCommandLineOption jobs_option(
+    QStringList() << "j"
+                  << "jobs",
+    tr("Work on <n> books at once, by default one for each core."),
+    "n");
+  QCommandLineOption output_option(
+    QStringList() << "o"
+                  << "output",
+    tr("resave writes the books into <directory> rather than over "
+       "themselves, a book is only replaced once its saved copy verifies. "
+       "index writes its index files there and convert the converted "
+       "books."),
+    "directory");
+  QCommandLineOption format_option(
+    QStringList() << "f"
+                  << "format",
+    tr("convert writes books of the type with suffix <format>, by default "
+       "epub."),
+    "format",
+    "epub");
+  QCommandLineOption verbose_option(QStringList() << "v"
+                                                  << "verbose",
+                                    tr("Log the details of any problems."));
+  parser.addOption(jobs_option);
+  parser.addOption(output_option);
+  parser.addOption(format_option);
+  parser.addOption(verbose_option);
+  parser.process(arguments);
+
+  QTextStream err(stderr);
+  QStringList positional = parser.positionalArguments();
+  if (positional.size() < 2) {
+    err << parser.helpText();
+    return EXIT_USAGE;
+  }
+
+  QString command = positional.takeFirst();
+  if (command == "resave") {
+    m_command = RESAVE;
+  } else if (command == "metadata-dump") {
+    m_command = METADATA_DUMP;
+  } else if (command == "index") {
+    m_command = INDEX;
+  } else if (command == "verify") {
+    m_command = VERIFY;
+  } else if (command == "convert") {
+    m_command = CONVERT;
+  } else if (command == "compare") {
+    m_command = COMPARE;
+    if (positional.size() != 2) {
+      err << tr("compare needs the original and the changed book") << "\n";
+      return EXIT_USAGE;
+    }
+  } else {
+    err << tr("Unknown command %1").arg(command) << "\n";
+    return EXIT_USAGE;
+  }
+
+  m_output_directory = parser.value(output_option);
+  if ((m_command == INDEX || m_command == CONVERT) &&
+      m_output_directory.isEmpty()) {
+    err << tr("%1 needs an --output directory").arg(command) << "\n";
+    return EXIT_USAGE;
+  }
+  m_format = parser.value(format_option).toLower();
+  if (!m_output_directory.isEmpty() && !QDir().mkpath(m_output_directory)) {
+    err << tr("Unable to create %1").arg(m_output_directory) << "\n";
+    return EXIT_FAILED;
+  }
+
+  if (parser.isSet(jobs_option)) {
+    bool ok;
+    int jobs = parser.value(jobs_option).toInt(&ok);
+    if (!ok || jobs < 1) {
+      err << tr("The number of jobs must be at least 1") << "\n";
+      return EXIT_USAGE;
+    }
+    EBookJobs::pool()->setMaxThreadCount(jobs);
+    m_jobs = jobs;
+  }
+
+  if (parser.isSet(verbose_option)) {
+    QLogger::addLogger("root", q5TRACE, CONSOLE);
+  }
+
+  loadOptions();
+  loadPlugins();
+
+  if (m_command == COMPARE) {
+    return compare(positional.at(0), positional.at(1));
+  }
+
+  QStringList files = bookFiles(positional);
+  if (m_command == CONVERT) {
+    return convert(files);
+  }
+
+  QList<QFuture<EBookBatchResult>> futures;
+  foreach (QString filename, files) {
+    futures.append(EBookJobs::submit<EBookBatchResult>(
+      [this, filename](QFutureInterface<EBookBatchResult>&) {
+        return process(filename);
+      }));
+  }
+
+  QTextStream out(stdout);
+  int failed = 0;
+  foreach (QFuture<EBookBatchResult> future, futures) {
+    future.waitForFinished();
+    EBookBatchResult result = future.result();
+    out << result.output;
+    out.flush();
+    foreach (QString problem, result.problems) {
+      err << tr("%1 : %2").arg(result.filename).arg(problem) << "\n";
+    }
+    err.flush();
+    if (!result.success) {
+      failed++;
+    }
+  }
+
+  if (failed > 0) {
+    err << tr("%1 of %2 books failed").arg(failed).arg(files.size()) << "\n";
+    return EXIT_FAILED;
+  }
+  return EXIT_OK;
+}
+
+/*
+ * The same preferences as Biblos, so that books are saved with the same
+ * compression level and the parse cache is shared.
+ */
+void
+EBookBatch::loadOptions()
+{
+  m_options->setConfigDirectory(
+    QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation));
+  m_options->setCacheDirectory(
+    QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+  QDir().mkpath(m_options->cacheDirectory());
+  m_options->setConfigFile(m_options->configDirectory() + QDir::separator() +
+                           PREF_FILE);
+  m_options->load(m_options->configFile());
+}
+
+/*
+ * Only the book plugins are used, each is loaded the first time a book of
+ * its type is read.
+ */
+void
+EBookBatch::loadPlugins()
+{
+  QDir pluginsDir = QDir(QCoreApplication::applicationDirPath());
+  pluginsDir.cd("plugins");
+
+  foreach (QString fileName, pluginsDir.entryList(QDir::Files)) {
+    if (fileName == "Makefile") // can remove this in installed versions.
+      continue;
+    EBookPluginLoader* loader =
+      new EBookPluginLoader(pluginsDir.absoluteFilePath(fileName), m_options);
+    if (!loader->isValid() || loader->value("interface") != "ebook") {
+      delete loader;
+      continue;
+    }
+    EBookPluginProxy* ebook_interface = new EBookPluginProxy(loader);
+    m_type_sniffer.addPlugin(ebook_interface);
+    m_plugins.append(ebook_interface);
+  }
+}
+
+/*
+ * The plugin for a book, by its content if it has a signature, else by its
+ * suffix.
+ */
+IEBookInterface*
+EBookBatch::pluginFor(const QString& filename) const
+{
+  IEBookInterface* plugin = m_type_sniffer.plugin(filename);
+  if (plugin) {
+    return plugin;
+  }
+  return pluginForSuffix(QFileInfo(filename).suffix());
+}
+
+/*
+ * The plugin whose file filter has suffix.
+ */
+IEBookInterface*
+EBookBatch::pluginForSuffix(const QString& suffix) const
+{
+  foreach (EBookPluginProxy* proxy, m_plugins) {
+    foreach (QString filter, proxy->fileFilter().split(' ')) {
+      // filters are of the form *.epub
+      if (filter.mid(filter.lastIndexOf('.') + 1).compare(
+            suffix, Qt::CaseInsensitive) == 0) {
+        return proxy;
+      }
+    }
+  }
+  return nullptr;
+}
+
+/*
+ * Files are kept whatever they are, so that a file that is not a book is
+ * reported, directories are searched for the books that they hold.
+ */
+QStringList
+EBookBatch::bookFiles(const QStringList& paths) const
+{
+  QStringList files;
+  foreach (QString path, paths) {
+    QFileInfo info(path);
+    if (!info.isDir()) {
+      files.append(path);
+      continue;
+    }
+    QStringList found;
+    QDirIterator it(path, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+      QString filename = it.next();
+      if (pluginFor(filename)) {
+        found.append(filename);
+      }
+    }
+    found.sort();
+    files.append(found);
+  }
+  return files;
+}
+
+/*
+ * Run in a pool thread.
+ */
+EBookBatchResult
+EBookBatch::process(const QString& filename)
+{
+  IEBookInterface* plugin = pluginFor(filename);
+  if (!plugin) {
+    EBookBatchResult result;
+    result.filename = filename;
+    result.problems.append(tr("Not a book that can be read"));
+    return result;
+  }
+
+  switch (m_command) {
+    case RESAVE:
+      return resave(plugin, filename);
+    case METADATA_DUMP:
+      return dumpMetadata(plugin, filename);
+    case INDEX:
+      return index(plugin, filename);
+    case VERIFY:
+      return verify(plugin, filename);
+    default:
+      return EBookBatchResult();
+  }
+}
+
+EBookBatchResult
+EBookBatch::resave(IEBookInterface* plugin, const QString& filename)
+{
+  EBookBatchResult result;
+  result.filename = filename;
+  QString save_path;
+  if (!m_output_directory.isEmpty()) {
+    save_path = m_output_directory + QDir::separator() +
+                QFileInfo(filename).fileName();
+  }
+  // a book that does not verify once written is not saved, the problems
+  // found say why.
+  result.success = plugin->resaveBook(filename, save_path, result.problems);
+  if (result.success) {
+    result.output = tr("%1 : saved\n").arg(filename);
+  } else {
+    result.problems.prepend(tr("Unable to save the book"));
+  }
+  return result;
+}
+
+/*
+ * The metadata is written as it would be in an epub package file.
+ */
+EBookBatchResult
+EBookBatch::dumpMetadata(IEBookInterface* plugin, const QString& filename)
+{
+  EBookBatchResult result;
+  result.filename = filename;
+  Metadata metadata = plugin->readMetadata(filename);
+  if (metadata.isNull()) {
+    result.problems.append(tr("Unable to read the metadata"));
+    return result;
+  }
+
+  QXmlStreamWriter writer(&result.output);
+  writer.setAutoFormatting(true);
+  writer.writeStartElement("book");
+  writer.writeAttribute("file", filename);
+  metadata->write(&writer);
+  writer.writeEndElement();
+  result.output += "\n";
+  result.success = true;
+  return result;
+}
+
+/*
+ * Books indexed before and unchanged since are left alone, changed books
+ * only have their changed chapters indexed again.
+ */
+EBookBatchResult
+EBookBatch::index(IEBookInterface* plugin, const QString& filename)
+{
+  EBookBatchResult result;
+  result.filename = filename;
+  quint64 uid = pathUid(filename);
+  qint64 modified = QFileInfo(filename).lastModified().toMSecsSinceEpoch();
+  QString path = EBookSearchIndex::bookPath(m_output_directory, uid);
+  EBookIndexedBook previous;
+  if (QFile::exists(path)) {
+    previous = EBookSearchIndex::readBook(path);
+    if (previous.uid == uid && previous.modified == modified) {
+      result.output = tr("%1 : up to date\n").arg(filename);
+      result.success = true;
+      return result;
+    }
+  }
+
+  EBookChapterList chapters = plugin->readChapters(filename);
+  if (chapters.isEmpty()) {
+    result.problems.append(tr("Unable to read the chapters"));
+    return result;
+  }
+  EBookIndexedBook book =
+    EBookSearchIndex::buildBook(uid, modified, chapters, previous);
+  if (!EBookSearchIndex::writeBook(m_output_directory, book)) {
+    result.problems.append(tr("Unable to store the search index"));
+    return result;
+  }
+  result.output = tr("%1 : %2 chapters indexed as %3\n")
+                    .arg(filename)
+                    .arg(book.chapters.size())
+                    .arg(uid);
+  result.success = true;
+  return result;
+}
+
+EBookBatchResult
+EBookBatch::verify(IEBookInterface* plugin, const QString& filename)
+{
+  EBookBatchResult result;
+  result.filename = filename;
+  result.success = plugin->verifyBook(filename, result.problems);
+  if (result.success) {
+    result.output = tr("%1 : ok\n").arg(filename);
+  } else if (result.problems.isEmpty()) {
+    result.problems.append(tr("Books of this type cannot be verified"));
+  }
+  return result;
+}
+
+/*
+ * Each book is written into the output directory with its own name and the
+ * suffix of the format. The books go through one EBookConverter, with -j
+ * setting the number of transforming workers, and the results are printed
+ * once all are done.
+ */
+int
+EBookBatch::convert(const QStringList& files)
+{
+  QTextStream out(stdout);
+  QTextStream err(stderr);
+  IEBookInterface* writer = pluginForSuffix(m_format);
+  if (!writer) {
+    err << tr("Unable to write books of type %1").arg(m_format) << "\n";
+    return EXIT_USAGE;
+  }
+
+  EBookConverter converter;
+  if (m_jobs > 0) {
+    converter.setWorkers(converter.readers(), m_jobs, converter.writers());
+  }
+
+  // two books of the same name would be written to the same file.
+  QList<EBookConversion> conversions;
+  QSet<QString> targets;
+  int failed = 0;
+  foreach (QString filename, files) {
+    EBookConversion conversion;
+    conversion.source = filename;
+    conversion.target = m_output_directory + QDir::separator() +
+                        QFileInfo(filename).completeBaseName() + "." +
+                        m_format;
+    if (targets.contains(conversion.target)) {
+      err << tr("%1 : %2 is already being written")
+               .arg(filename)
+               .arg(conversion.target)
+          << "\n";
+      failed++;
+      continue;
+    }
+    targets.insert(conversion.target);
+    conversion.reader = pluginFor(filename);
+    conversion.writer = writer;
+    conversions.append(conversion);
+  }
+
+  EBookConversionResultList results = converter.convert(conversions);
+  foreach (EBookConversionResult result, results) {
+    if (result.success) {
+      out << tr("%1 : converted to %2\n").arg(result.source).arg(result.target);
+    } else {
+      err << tr("%1 : %2").arg(result.source).arg(result.error) << "\n";
+      failed++;
+    }
+  }
+  out.flush();
+  err.flush();
+
+  if (failed > 0) {
+    err << tr("%1 of %2 books failed").arg(failed).arg(files.size()) << "\n";
+    return EXIT_FAILED;
+  }
+  return EXIT_OK;
+}
+
+/*
+ * Prints the diff of each text file that changed and a line for each other
+ * file that differs. As with diff the exit code is EXIT_OK if the books are
+ * the same, EXIT_FAILED if they differ and EXIT_USAGE if they could not be
+ * compared.
+ */
+int
+EBookBatch::compare(const QString& original, const QString& changed)
+{
+  QTextStream out(stdout);
+  QTextStream err(stderr);
+  IEBookInterface* plugin = pluginFor(original);
+  EBookComparison comparison;
+  if (!plugin || plugin != pluginFor(changed) ||
+      !plugin->compareBooks(original, changed, comparison)) {
+    err << tr("Unable to compare %1 and %2").arg(original).arg(changed)
+        << "\n";
+    return EXIT_USAGE;
+  }
+
+  foreach (EBookEntryDifference difference, comparison.differences) {
+    if (!difference.diff.isEmpty()) {
+      out << difference.diff;
+    } else if (difference.change == EBookEntryDifference::ADDED) {
+      out << tr("%1 : added\n").arg(difference.path);
+    } else if (difference.change == EBookEntryDifference::REMOVED) {
+      out << tr("%1 : removed\n").arg(difference.path);
+    } else {
+      out << tr("%1 : changed\n").arg(difference.path);
+    }
+  }
+  out << tr("%1 files differ, %2 are the same\n")
+           .arg(comparison.differences.size())
+           .arg(comparison.unchanged);
+  out.flush();
+  return (comparison.isSame() ? EXIT_OK : EXIT_FAILED);
+}
+
+/*
+ * Books indexed from the command line are not in the library, so have no
+ * library uid. They are given one from their path instead, which stays the
+ * same as long as the book is not moved.
+ */
+quint64
+EBookBatch::pathUid(const QString& filename)
+{
+  QByteArray hash = QCryptographicHash::hash(
+    QFileInfo(filename).absoluteFilePath().toUtf8(), QCryptographicHash::Sha1);
+  quint64 uid = qFromBigEndian<quint64>(
+    reinterpret_cast<const uchar*>(hash.constData()));
+  // 0 is never a valid uid.
+  return (uid == 0 ? 1 : uid);
+}
@@ -0,0 +1,91 @@
+#ifndef EBOOKBATCH_H
+#define EBOOKBATCH_H
+
+#include <QCoreApplication>
+#include <QStringList>
+
+#include "ebookpluginproxy.h"
+#include "ebooktypesniffer.h"
+#include "options.h"
+
+/*!
+ * \brief The outcome of one book, printed once every earlier book has been
+ * printed so that the output is in the order the books were given.
+ */
+struct EBookBatchResult
+{
+  QString filename;
+  bool success = false;
+  QString output;        // printed to stdout, the metadata for example.
+  QStringList problems;  // printed to stderr.
+};
+
+/*!
+ * \brief Runs one command over many books without a window, for scripts
+ * and servers.
+ *
+ * The book plugins are loaded from the plugins directory next to the
+ * executable, as for Biblos itself, but nothing that needs widgets is
+ * loaded. Each book is handled by a job on the global thread pool, which
+ * runs at most the number of workers given with -j at once.
+ *
+ * Each command only uses the plugin methods that may be called from worker
+ * threads, IEBookInterface::readMetadata(), readChapters(), verifyBook(),
+ * resaveBook(), readContent(), writeContent() and compareBooks(), so no
+ * document is ever created. convert runs its books through an
+ * EBookConverter rather than a job each, and compare takes exactly two
+ * books, the original and the changed version.
+ */
+class EBookBatch
+{
+  Q_DECLARE_TR_FUNCTIONS(EBookBatch)
+public:
+  enum Command
+  {
+    NO_COMMAND,
+    RESAVE,
+    METADATA_DUMP,
+    INDEX,
+    VERIFY,
+    CONVERT,
+    COMPARE,
+  };
+
+  EBookBatch();
+  ~EBookBatch();
+
+  int run(const QStringList& arguments);
+
+  // the exit codes.
+  static const int EXIT_OK = 0;
+  static const int EXIT_FAILED = 1; // at least one book failed.
+  static const int EXIT_USAGE = 2;
+
+protected:
+  Options* m_options;
+  QList<EBookPluginProxy*> m_plugins;
+  EBookTypeSniffer m_type_sniffer;
+  Command m_command;
+  QString m_output_directory;
+  QString m_format; // the suffix of the books written by convert.
+  int m_jobs;       // from -j, 0 if not given.
+
+  void loadOptions();
+  void loadPlugins();
+  IEBookInterface* pluginFor(const QString& filename) const;
+  IEBookInterface* pluginForSuffix(const QString& suffix) const;
+  QStringList bookFiles(const QStringList& paths) const;
+  EBookBatchResult process(const QString& filename);
+  EBookBatchResult resave(IEBookInterface* plugin, const QString& filename);
+  EBookBatchResult dumpMetadata(IEBookInterface* plugin,
+                                const QString& filename);
+  EBookBatchResult index(IEBookInterface* plugin, const QString& filename);
+  EBookBatchResult verify(IEBookInterface* plugin, const QString& filename);
+  int convert(const QStringList& files);
+  int compare(const QString& original, const QString& changed);
+  static quint64 pathUid(const QString& filename);
+
+  static const QString PREF_FILE;
+};
+
+#endif // EBOOKBATCH_H
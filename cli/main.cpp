@@ -0,0 +1,21 @@
+#include <QGuiApplication>
+
+#include "ebookbatch.h"
+#include "ebooktrace.h"
+
+int
+main(int argc, char* argv[])
+{
+  // the plugins need QtGui for images and fonts, but never a display.
+  if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  }
+  QGuiApplication a(argc, argv);
+  // shares the preferences and caches of Biblos.
+  QCoreApplication::setApplicationName("Biblos");
+  // before the plugins are loaded, so that they share the trace.
+  EBookTrace::install();
+
+  EBookBatch batch;
+  return batch.run(QCoreApplication::arguments());
+}
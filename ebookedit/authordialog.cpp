@@ -1,4 +1,5 @@
 #include "authordialog.h"
+#include "ebooknamecompleter.h"
 
 // const QString AuthorDialog::SELECTED_BORDER = QString("QFrame {"
 //    "border: 2px solid green;"
@@ -166,7 +167,7 @@ AuthorDialog::acceptAuthor()
   if (m_image_lbl->modified()) {
     const QPixmap* pixmap = m_image_lbl->pixmap();
     if (!pixmap->isNull()) {
-      author_data->setPixmap(*pixmap);
+      m_authors->setPortrait(author_data, *pixmap);
     }
   }
   QString site = m_web_edit->text();
@@ -292,7 +293,7 @@ AuthorDialog::execute(AuthorData author_data)
   m_original_wikipedia = author_data->wikipedia();
   m_names_index = 0;
   m_current_index = 0;
-  QPixmap pixmap = author_data->pixmap();
+  QPixmap pixmap = m_authors->portrait(author_data);
   if (!pixmap.isNull())
     m_image_lbl->setPixmap(pixmap);
   return QDialog::exec();
@@ -380,6 +381,14 @@ AuthorDialog::addAuthorRow()
 
   FocusLineEdit* m_surname_edit = new FocusLineEdit(this);
   m_surnames.append(m_surname_edit);
+  // the surnames already in the library.
+  AuthorsDB authors_db = m_authors;
+  new EBookNameCompleter(
+    m_surname_edit,
+    [authors_db](const QString& prefix, int limit) {
+      return authors_db->completeSurname(prefix, limit);
+    },
+    EBookAuthorsDB::COMPLETION_LIMIT);
   connect(m_surname_edit,
           &FocusLineEdit::textChanged,
           this,
@@ -0,0 +1,95 @@
+#include "batchmetadatadialog.h"
+
+#include "ebooknamecompleter.h"
+
+BatchMetadataDialog::BatchMetadataDialog(AuthorsDB authors_db,
+                                         SeriesDB series_db,
+                                         int book_count,
+                                         QWidget* parent)
+  : QDialog(parent)
+{
+  setWindowTitle(tr("Edit Metadata"));
+
+  QGridLayout* layout = new QGridLayout;
+  setLayout(layout);
+  int row = 0;
+
+  QLabel* summary =
+    new QLabel(tr("The change is made to %1 books.").arg(book_count), this);
+  layout->addWidget(summary, row++, 0, 1, 2);
+
+  EBookNameCompleter::Lookup authors =
+    [authors_db](const QString& prefix, int limit) {
+      return authors_db->completeAuthor(prefix, limit);
+    };
+  layout->addWidget(new QLabel(tr("Author :"), this), row, 0);
+  m_author_edit = new QLineEdit(this);
+  m_author_edit->setPlaceholderText(tr("the name as it is in the books"));
+  new EBookNameCompleter(
+    m_author_edit, authors, EBookAuthorsDB::COMPLETION_LIMIT);
+  layout->addWidget(m_author_edit, row++, 1);
+  layout->addWidget(new QLabel(tr("Corrected to :"), this), row, 0);
+  m_corrected_edit = new QLineEdit(this);
+  new EBookNameCompleter(
+    m_corrected_edit, authors, EBookAuthorsDB::COMPLETION_LIMIT);
+  layout->addWidget(m_corrected_edit, row++, 1);
+
+  m_series_box = new QCheckBox(tr("Series :"), this);
+  layout->addWidget(m_series_box, row, 0);
+  m_series_edit = new QLineEdit(this);
+  m_series_edit->setPlaceholderText(tr("empty to remove the series"));
+  m_series_edit->setEnabled(false);
+  new EBookNameCompleter(
+    m_series_edit,
+    [series_db](const QString& prefix, int limit) {
+      return series_db->completeSeries(prefix, limit);
+    },
+    EBookSeriesDB::COMPLETION_LIMIT);
+  layout->addWidget(m_series_edit, row++, 1);
+  connect(
+    m_series_box, &QCheckBox::toggled, m_series_edit, &QWidget::setEnabled);
+
+  QDialogButtonBox* buttons = new QDialogButtonBox(
+    QDialogButtonBox::Apply | QDialogButtonBox::Cancel, this);
+  m_apply_btn = buttons->button(QDialogButtonBox::Apply);
+  connect(m_apply_btn, &QPushButton::clicked, this, &QDialog::accept);
+  connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+  layout->addWidget(buttons, row++, 0, 1, 2);
+
+  connect(m_author_edit,
+          &QLineEdit::textChanged,
+          this,
+          &BatchMetadataDialog::updateButtons);
+  connect(m_corrected_edit,
+          &QLineEdit::textChanged,
+          this,
+          &BatchMetadataDialog::updateButtons);
+  connect(m_series_box,
+          &QCheckBox::toggled,
+          this,
+          &BatchMetadataDialog::updateButtons);
+  updateButtons();
+}
+
+/*!
+ * \brief The change that was asked for.
+ */
+EBookMetadataEdit
+BatchMetadataDialog::edit() const
+{
+  EBookMetadataEdit edit;
+  QString author = m_author_edit->text().simplified();
+  QString corrected = m_corrected_edit->text().simplified();
+  if (!author.isEmpty() && !corrected.isEmpty() && author != corrected) {
+    edit.creators.insert(author, corrected);
+  }
+  edit.set_series = m_series_box->isChecked();
+  edit.series = m_series_edit->text().simplified();
+  return edit;
+}
+
+void
+BatchMetadataDialog::updateButtons()
+{
+  m_apply_btn->setEnabled(!edit().isEmpty());
+}
@@ -0,0 +1,38 @@
+#ifndef BATCHMETADATADIALOG_H
+#define BATCHMETADATADIALOG_H
+
+#include <QDialog>
+#include <QtWidgets>
+
+#include "authors.h"
+#include "ebookmetadata.h"
+#include "series.h"
+
+/*!
+ * \brief Asks for the change to make to the metadata of the books selected
+ * in the library, see EBookMetadataBatch.
+ *
+ * An author can be corrected and the series set, or cleared, in one pass.
+ */
+class BatchMetadataDialog : public QDialog
+{
+  Q_OBJECT
+public:
+  BatchMetadataDialog(AuthorsDB authors_db,
+                      SeriesDB series_db,
+                      int book_count,
+                      QWidget* parent = nullptr);
+
+  EBookMetadataEdit edit() const;
+
+protected:
+  QLineEdit* m_author_edit;
+  QLineEdit* m_corrected_edit;
+  QCheckBox* m_series_box;
+  QLineEdit* m_series_edit;
+  QPushButton* m_apply_btn;
+
+  void updateButtons();
+};
+
+#endif // BATCHMETADATADIALOG_H
@@ -0,0 +1,139 @@
+#include "comparedialog.h"
+
+DiffHighlighter::DiffHighlighter(QTextDocument* parent)
+  : QSyntaxHighlighter(parent)
+{
+  m_added_format.setForeground(QColor("darkgreen"));
+  m_removed_format.setForeground(QColor("darkred"));
+  m_hunk_format.setForeground(QColor("darkblue"));
+}
+
+void
+DiffHighlighter::highlightBlock(const QString& text)
+{
+  if (text.startsWith("+++") || text.startsWith("---") ||
+      text.startsWith("@@")) {
+    setFormat(0, text.length(), m_hunk_format);
+  } else if (text.startsWith('+')) {
+    setFormat(0, text.length(), m_added_format);
+  } else if (text.startsWith('-')) {
+    setFormat(0, text.length(), m_removed_format);
+  }
+}
+
+CompareDialog::CompareDialog(const EBookComparison& comparison,
+                             QWidget* parent)
+  : QDialog(parent)
+  , m_comparison(comparison)
+{
+  setWindowTitle(tr("Compare Books"));
+
+  QGridLayout* layout = new QGridLayout;
+  setLayout(layout);
+
+  QLabel* summary = new QLabel(this);
+  summary->setText(tr("%1 and %2 : %3 files differ, %4 are the same")
+                     .arg(QFileInfo(comparison.original).fileName())
+                     .arg(QFileInfo(comparison.changed).fileName())
+                     .arg(comparison.differences.size())
+                     .arg(comparison.unchanged));
+  layout->addWidget(summary, 0, 0, 1, 2);
+
+  QSplitter* splitter = new QSplitter(this);
+  layout->addWidget(splitter, 1, 0, 1, 2);
+
+  QStringList headers;
+  headers << tr("Chapter") << tr("Change") << tr("Lines");
+  m_files_widget = new QTreeWidget(this);
+  m_files_widget->setColumnCount(headers.size());
+  m_files_widget->setHeaderLabels(headers);
+  m_files_widget->setRootIsDecorated(false);
+  m_files_widget->header()->setSectionResizeMode(
+    QHeaderView::ResizeToContents);
+  splitter->addWidget(m_files_widget);
+
+  m_diff_view = new QPlainTextEdit(this);
+  m_diff_view->setReadOnly(true);
+  m_diff_view->setLineWrapMode(QPlainTextEdit::NoWrap);
+  m_diff_view->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+  new DiffHighlighter(m_diff_view->document());
+  splitter->addWidget(m_diff_view);
+  splitter->setStretchFactor(0, 1);
+  splitter->setStretchFactor(1, 3);
+
+  for (int i = 0; i < comparison.differences.size(); i++) {
+    const EBookEntryDifference& difference = comparison.differences.at(i);
+    QTreeWidgetItem* item = new QTreeWidgetItem(m_files_widget);
+    if (difference.chapter >= 0) {
+      QString title = tr("Chapter %1").arg(difference.chapter + 1);
+      if (!difference.title.isEmpty()) {
+        title += " : " + difference.title;
+      }
+      item->setText(0, title);
+    } else {
+      item->setText(0, difference.path);
+    }
+    item->setToolTip(0, difference.path);
+    item->setText(1, changeText(difference.change));
+    if (!difference.diff.isEmpty()) {
+      item->setText(2,
+                    tr("+%1 -%2")
+                      .arg(difference.added_lines)
+                      .arg(difference.removed_lines));
+      item->setTextAlignment(2, Qt::AlignRight | Qt::AlignVCenter);
+    }
+    item->setData(0, Qt::UserRole, i);
+  }
+  connect(m_files_widget,
+          &QTreeWidget::currentItemChanged,
+          this,
+          &CompareDialog::showDifference);
+  if (m_files_widget->topLevelItemCount() > 0) {
+    m_files_widget->setCurrentItem(m_files_widget->topLevelItem(0));
+  } else {
+    m_diff_view->setPlainText(tr("The books are the same."));
+  }
+
+  QPushButton* close_button = new QPushButton(tr("Close"), this);
+  connect(close_button, &QPushButton::clicked, this, &QDialog::accept);
+  layout->addWidget(close_button, 2, 1);
+
+  setGeometry(geometry().x(), geometry().y(), 1000, 600);
+}
+
+void
+CompareDialog::showDifference()
+{
+  QTreeWidgetItem* item = m_files_widget->currentItem();
+  if (!item) {
+    m_diff_view->clear();
+    return;
+  }
+  const EBookEntryDifference& difference =
+    m_comparison.differences.at(item->data(0, Qt::UserRole).toInt());
+  if (!difference.diff.isEmpty()) {
+    m_diff_view->setPlainText(difference.diff);
+  } else if (difference.change != EBookEntryDifference::CHANGED) {
+    m_diff_view->setPlainText(tr("%1 was %2.")
+                                .arg(difference.path)
+                                .arg(changeText(difference.change).toLower()));
+  } else if (difference.text) {
+    m_diff_view->setPlainText(
+      tr("%1 was changed but its lines are the same.").arg(difference.path));
+  } else {
+    m_diff_view->setPlainText(tr("%1 was changed.").arg(difference.path));
+  }
+}
+
+QString
+CompareDialog::changeText(EBookEntryDifference::Change change)
+{
+  switch (change) {
+    case EBookEntryDifference::ADDED:
+      return tr("Added");
+    case EBookEntryDifference::REMOVED:
+      return tr("Removed");
+    default:
+      return tr("Changed");
+  }
+}
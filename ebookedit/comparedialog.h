@@ -0,0 +1,52 @@
+#ifndef COMPAREDIALOG_H
+#define COMPAREDIALOG_H
+
+#include <QDialog>
+#include <QSyntaxHighlighter>
+#include <QtWidgets>
+
+#include "ebookcomparison.h"
+
+/*!
+ * \brief Colours the added, removed and hunk header lines of a unified
+ * diff.
+ */
+class DiffHighlighter : public QSyntaxHighlighter
+{
+  Q_OBJECT
+public:
+  explicit DiffHighlighter(QTextDocument* parent);
+
+protected:
+  QTextCharFormat m_added_format;
+  QTextCharFormat m_removed_format;
+  QTextCharFormat m_hunk_format;
+
+  void highlightBlock(const QString& text) override;
+};
+
+/*!
+ * \brief Shows the differences between two versions of a book, see
+ * IEBookInterface::compareBooks().
+ *
+ * Each file that differs has a row, the chapters in reading order first,
+ * and the diff of the row selected is shown beside the list.
+ */
+class CompareDialog : public QDialog
+{
+  Q_OBJECT
+public:
+  explicit CompareDialog(const EBookComparison& comparison,
+                         QWidget* parent = nullptr);
+
+protected:
+  EBookComparison m_comparison;
+  QTreeWidget* m_files_widget;
+  QPlainTextEdit* m_diff_view;
+
+  void showDifference();
+
+  static QString changeText(EBookEntryDifference::Change change);
+};
+
+#endif // COMPAREDIALOG_H
@@ -0,0 +1,263 @@
+#include "ebookbooksearch.h"
+
+#include <QtConcurrent>
+#include <algorithm>
+
+#include <qlogger/qlogger.h>
+
+using namespace qlogger;
+
+EBookBookSearch::EBookBookSearch(QObject* parent)
+  : QObject(parent)
+  , m_document(nullptr)
+{
+  connect(&m_watcher,
+          &QFutureWatcher<EBookChapterTask>::resultsReadyAt,
+          this,
+          &EBookBookSearch::chaptersSearched);
+  connect(&m_watcher,
+          &QFutureWatcher<EBookChapterTask>::finished,
+          this,
+          &EBookBookSearch::searchFinished);
+}
+
+EBookBookSearch::~EBookBookSearch()
+{
+  cancel();
+  m_watcher.waitForFinished();
+}
+
+/*!
+ * \brief Searches and replaces in another book, the hits and the last
+ * replace of the book before are dropped.
+ */
+void
+EBookBookSearch::setDocument(IEBookDocument* document)
+{
+  if (document == m_document) {
+    return;
+  }
+  cancel();
+  m_watcher.waitForFinished();
+  m_document = document;
+  m_hits.clear();
+  m_replaced.clear();
+}
+
+IEBookDocument*
+EBookBookSearch::document() const
+{
+  return m_document;
+}
+
+/*!
+ * \brief Starts a search of every chapter of the book.
+ *
+ * The xhtml of the chapters is read here, as the book can only be used
+ * from this thread, and then searched in the global thread pool. The hits
+ * are sent by hitsFound() a chapter at a time, in no particular order, and
+ * finished() is sent once the whole book has been searched.
+ *
+ * \return false if there is no book or the expression is not valid.
+ */
+bool
+EBookBookSearch::start(const QRegularExpression& expression)
+{
+  if (!m_document || !expression.isValid() || expression.pattern().isEmpty()) {
+    return false;
+  }
+  cancel();
+  m_watcher.waitForFinished();
+  m_hits.clear();
+
+  ChapterTaskList tasks;
+  int count = m_document->chapterCount();
+  for (int i = 0; i < count; i++) {
+    EBookChapterTask task;
+    task.chapter = i;
+    task.source = m_document->chapterSourceAt(i);
+    task.expression = expression;
+    if (!task.source.isEmpty()) {
+      tasks << task;
+    }
+  }
+  m_watcher.setFuture(
+    QtConcurrent::mapped(tasks, &EBookBookSearch::searchChapter));
+  return true;
+}
+
+void
+EBookBookSearch::cancel()
+{
+  m_watcher.cancel();
+}
+
+bool
+EBookBookSearch::isRunning() const
+{
+  return m_watcher.isRunning();
+}
+
+/*!
+ * \brief The hits of the last search, sorted by chapter and offset once it
+ * has finished.
+ */
+BookHitList
+EBookBookSearch::hits() const
+{
+  return m_hits;
+}
+
+/*!
+ * \brief Replaces every match of an expression in the book.
+ *
+ * The chapters are replaced in parallel, then each chapter with matches is
+ * put back into the book as one change. Chapters that are not shown are
+ * not laid out. The hits are dropped, as their offsets no longer hold.
+ *
+ * \return the number of matches replaced.
+ */
+int
+EBookBookSearch::replaceAll(const QRegularExpression& expression,
+                            const QString& replacement)
+{
+  if (!m_document || !expression.isValid() || expression.pattern().isEmpty()) {
+    return 0;
+  }
+  cancel();
+  m_watcher.waitForFinished();
+
+  // every chapter is gone over, not only those with hits, as the hits may
+  // have been cut short or be of another search.
+  ChapterTaskList tasks;
+  int count = m_document->chapterCount();
+  for (int i = 0; i < count; i++) {
+    EBookChapterTask task;
+    task.chapter = i;
+    task.source = m_document->chapterSourceAt(i);
+    task.expression = expression;
+    task.replacement = replacement;
+    if (!task.source.isEmpty()) {
+      tasks << task;
+    }
+  }
+  ChapterTaskList results =
+    QtConcurrent::blockingMapped(tasks, &EBookBookSearch::replaceChapter);
+
+  m_replaced.clear();
+  int replaced = 0;
+  for (int i = 0; i < results.size(); i++) {
+    const EBookChapterTask& result = results.at(i);
+    if (result.replaced == 0) {
+      continue;
+    }
+    if (!m_document->setChapterSource(result.chapter, result.source)) {
+      QLOG_DEBUG(tr("Unable to replace chapter %1").arg(result.chapter));
+      continue;
+    }
+    m_replaced.insert(result.chapter, tasks.at(i).source);
+    replaced += result.replaced;
+  }
+  m_hits.clear();
+  return replaced;
+}
+
+bool
+EBookBookSearch::canUndoReplace() const
+{
+  return (m_document && !m_replaced.isEmpty());
+}
+
+/*!
+ * \brief Puts back the chapters changed by the last replaceAll().
+ */
+bool
+EBookBookSearch::undoReplace()
+{
+  if (!canUndoReplace()) {
+    return false;
+  }
+  bool restored = true;
+  QHash<int, QString>::const_iterator it = m_replaced.constBegin();
+  for (; it != m_replaced.constEnd(); ++it) {
+    restored &= m_document->setChapterSource(it.key(), it.value());
+  }
+  m_replaced.clear();
+  m_hits.clear();
+  return restored;
+}
+
+/*!
+ * \brief Run in the global thread pool.
+ */
+EBookChapterTask
+EBookBookSearch::searchChapter(const EBookChapterTask& task)
+{
+  EBookChapterTask result = task;
+  QRegularExpressionMatchIterator it =
+    task.expression.globalMatch(task.source);
+  while (it.hasNext() && result.hits.size() < MAX_HITS) {
+    QRegularExpressionMatch match = it.next();
+    if (match.capturedLength() == 0) {
+      continue;
+    }
+    EBookBookHit hit;
+    hit.chapter = task.chapter;
+    hit.offset = match.capturedStart();
+    hit.length = match.capturedLength();
+    int start = qMax(0, hit.offset - CONTEXT_LENGTH);
+    hit.context =
+      task.source.mid(start, hit.offset + hit.length + CONTEXT_LENGTH - start)
+        .simplified();
+    result.hits.append(hit);
+  }
+  // only the hits go back to the gui thread.
+  result.source.clear();
+  return result;
+}
+
+/*!
+ * \brief Run in the global thread pool.
+ */
+EBookChapterTask
+EBookBookSearch::replaceChapter(const EBookChapterTask& task)
+{
+  EBookChapterTask result = task;
+  QRegularExpressionMatchIterator it =
+    task.expression.globalMatch(task.source);
+  while (it.hasNext()) {
+    it.next();
+    result.replaced++;
+  }
+  if (result.replaced > 0) {
+    result.source.replace(task.expression, task.replacement);
+  }
+  return result;
+}
+
+void
+EBookBookSearch::chaptersSearched(int begin, int end)
+{
+  BookHitList found;
+  for (int i = begin; i < end && m_hits.size() < MAX_HITS; i++) {
+    BookHitList hits = m_watcher.resultAt(i).hits;
+    hits = hits.mid(0, MAX_HITS - m_hits.size());
+    m_hits += hits;
+    found += hits;
+  }
+  if (!found.isEmpty()) {
+    emit hitsFound(found);
+  }
+}
+
+void
+EBookBookSearch::searchFinished()
+{
+  std::sort(m_hits.begin(),
+            m_hits.end(),
+            [](const EBookBookHit& a, const EBookBookHit& b) {
+              return (a.chapter < b.chapter ||
+                      (a.chapter == b.chapter && a.offset < b.offset));
+            });
+  emit finished();
+}
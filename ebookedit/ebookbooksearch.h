@@ -0,0 +1,93 @@
+#ifndef EBOOKBOOKSEARCH_H
+#define EBOOKBOOKSEARCH_H
+
+#include <QFutureWatcher>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QRegularExpression>
+
+#include "iebookdocument.h"
+
+/*!
+ * \brief A match found by EBookBookSearch.
+ */
+struct EBookBookHit
+{
+  int chapter = 0;
+  int offset = 0; // into the xhtml of the chapter.
+  int length = 0;
+  QString context;
+};
+typedef QList<EBookBookHit> BookHitList;
+
+/*!
+ * \brief One chapter of a search or a replace, run in the global thread
+ * pool.
+ */
+struct EBookChapterTask
+{
+  int chapter = 0;
+  QString source;
+  QRegularExpression expression;
+  QString replacement;
+  BookHitList hits;
+  int replaced = 0;
+};
+typedef QList<EBookChapterTask> ChapterTaskList;
+
+/*!
+ * \brief Finds a regular expression in the xhtml of every chapter of a
+ * book, and replaces it.
+ *
+ * The chapters are searched in parallel and the hits of each are sent by
+ * hitsFound() as soon as it has been searched, so that they can be shown
+ * while the rest of the book is still being searched. Only the xhtml is
+ * gone over, no chapter is laid out.
+ *
+ * replaceAll() changes each chapter with hits as one edit. The chapters
+ * as they were before are kept, so undoReplace() can put the whole replace
+ * back.
+ */
+class EBookBookSearch : public QObject
+{
+  Q_OBJECT
+public:
+  explicit EBookBookSearch(QObject* parent = nullptr);
+  ~EBookBookSearch();
+
+  void setDocument(IEBookDocument* document);
+  IEBookDocument* document() const;
+
+  bool start(const QRegularExpression& expression);
+  void cancel();
+  bool isRunning() const;
+  BookHitList hits() const;
+
+  int replaceAll(const QRegularExpression& expression,
+                 const QString& replacement);
+  bool canUndoReplace() const;
+  bool undoReplace();
+
+signals:
+  void hitsFound(const BookHitList& hits);
+  void finished();
+
+protected:
+  IEBookDocument* m_document;
+  QFutureWatcher<EBookChapterTask> m_watcher;
+  BookHitList m_hits;
+  // the chapters before the last replace.
+  QHash<int, QString> m_replaced;
+
+  static EBookChapterTask searchChapter(const EBookChapterTask& task);
+  static EBookChapterTask replaceChapter(const EBookChapterTask& task);
+  void chaptersSearched(int begin, int end);
+  void searchFinished();
+
+  // characters either side of a hit given as its context.
+  static const int CONTEXT_LENGTH = 30;
+  static const int MAX_HITS = 10000;
+};
+
+#endif // EBOOKBOOKSEARCH_H
@@ -1,12 +1,46 @@
 #include "ebookcodeeditor.h"
 
-EBookCodeEditor::EBookCodeEditor(QWidget* parent) : QPlainTextEdit(parent)
+#include <QElapsedTimer>
+#include <QPlainTextDocumentLayout>
+#include <QScrollBar>
+
+#include "ebookprofileoverlay.h"
+#include "ebooktrace.h"
+
+#ifdef EBOOK_TRACE_ENABLED
+/*
+ * Times the layout that follows each change to the document, the layout of
+ * a QPlainTextEdit otherwise being out of sight of the traces.
+ */
+class EBookTracedLayout : public QPlainTextDocumentLayout
+{
+public:
+  EBookTracedLayout(QTextDocument* document)
+    : QPlainTextDocumentLayout(document)
+  {}
+
+  void documentChanged(int from, int removed, int added) override
+  {
+    EBOOK_TRACE_SCOPE("EBookCodeEditor::layout");
+    QPlainTextDocumentLayout::documentChanged(from, removed, added);
+  }
+};
+#endif
+
+EBookCodeEditor::EBookCodeEditor(QWidget* parent)
+  : QPlainTextEdit(parent), m_highlighter(nullptr), m_options(nullptr),
+    m_next_block(0), m_format_version(0), m_large_file(false),
+    m_load_position(0), m_gutter_digits(0), m_gutter_width(0),
+    m_profile_overlay(nullptr)
 {
   init();
 }
 
 EBookCodeEditor::EBookCodeEditor(Options* options, QWidget* parent)
-  : QPlainTextEdit(parent), m_options(options)
+  : QPlainTextEdit(parent), m_highlighter(nullptr), m_options(options),
+    m_next_block(0), m_format_version(0), m_large_file(false),
+    m_load_position(0), m_gutter_digits(0), m_gutter_width(0),
+    m_profile_overlay(nullptr)
 {
   init();
 }
@@ -33,19 +67,39 @@ void EBookCodeEditor::init()
   connect(this, &EBookCodeEditor::cursorPositionChanged, this,
           &EBookCodeEditor::highlightCurrentLine);
 
+  // the slices run when the editor is otherwise idle.
+  m_highlight_timer.setSingleShot(true);
+  m_highlight_timer.setInterval(0);
+  connect(&m_highlight_timer, &QTimer::timeout, this,
+          &EBookCodeEditor::highlightSlice);
+  connect(verticalScrollBar(), &QScrollBar::valueChanged, this,
+          &EBookCodeEditor::highlightVisible);
+  m_load_timer.setSingleShot(true);
+  m_load_timer.setInterval(0);
+  connect(&m_load_timer, &QTimer::timeout, this, &EBookCodeEditor::loadChunk);
+  if (m_options) {
+    m_format_version = m_options->codeFormatVersion();
+    connect(m_options, &Options::codeFormatsChanged, this,
+            &EBookCodeEditor::codeFormatsChanged);
+  }
+
   updateLineNumberAreaWidth(0);
   highlightCurrentLine();
 }
 
 void EBookCodeEditor::lineNumberAreaPaintEvent(QPaintEvent* event)
 {
+  EBOOK_TRACE_SCOPE("EBookCodeEditor::lineNumberAreaPaintEvent");
   QPainter painter(lineNumberArea);
   painter.fillRect(event->rect(), Qt::lightGray);
 
   QTextBlock block = firstVisibleBlock();
   int blockNumber = block.blockNumber();
   int top = int(blockBoundingGeometry(block).translated(contentOffset()).top());
-  int bottom = top + int(blockBoundingRect(block).height());
+  // a large file is not wrapped, so every block is one line of the same
+  // height and only the first needs to be measured.
+  int height = int(blockBoundingRect(block).height());
+  int bottom = top + height;
 
   while (block.isValid() && top <= event->rect().bottom()) {
     if (block.isVisible() && bottom >= event->rect().top()) {
@@ -57,12 +111,27 @@ void EBookCodeEditor::lineNumberAreaPaintEvent(QPaintEvent* event)
 
     block = block.next();
     top = bottom;
-    bottom = top + int(blockBoundingRect(block).height());
+    if (!m_large_file) {
+      height = int(blockBoundingRect(block).height());
+    }
+    bottom = top + height;
     ++blockNumber;
   }
 }
 
 int EBookCodeEditor::lineNumberAreaWidth()
+{
+  if (m_gutter_digits == 0) {
+    updateGutterWidth();
+  }
+  return m_gutter_width;
+}
+
+/*
+ * The width only changes with the number of digits in the line count, or
+ * the font, so it is worked out again only then.
+ */
+bool EBookCodeEditor::updateGutterWidth()
 {
   int digits = 1;
   int max = qMax(1, blockCount());
@@ -70,15 +139,42 @@ int EBookCodeEditor::lineNumberAreaWidth()
     max /= 10;
     ++digits;
   }
+  if (digits == m_gutter_digits) {
+    return false;
+  }
+  m_gutter_digits = digits;
+  m_gutter_width =
+    3 + fontMetrics().horizontalAdvance(QLatin1Char('9')) * digits;
+  return true;
+}
 
-  int space = 3 + fontMetrics().horizontalAdvance(QLatin1Char('9')) * digits;
+/*
+ * An editor that was hidden, in a background tab or behind the book
+ * editor, when the code formats changed is highlighted again now.
+ */
+void EBookCodeEditor::showEvent(QShowEvent* e)
+{
+  QPlainTextEdit::showEvent(e);
+  if (m_options && m_format_version != m_options->codeFormatVersion()) {
+    rehighlight();
+  }
+}
 
-  return space;
+void EBookCodeEditor::paintEvent(QPaintEvent* e)
+{
+  {
+    EBOOK_TRACE_SCOPE("EBookCodeEditor::paintEvent");
+    QPlainTextEdit::paintEvent(e);
+  }
+  if (m_profile_overlay) {
+    m_profile_overlay->frameFinished();
+  }
 }
 
 void EBookCodeEditor::resizeEvent(QResizeEvent* e)
 {
   QPlainTextEdit::resizeEvent(e);
+  highlightVisible();
 
   QRect cr = contentsRect();
   lineNumberArea->setGeometry(
@@ -87,7 +183,9 @@ void EBookCodeEditor::resizeEvent(QResizeEvent* e)
 
 void EBookCodeEditor::updateLineNumberAreaWidth(int /* newBlockCount */)
 {
-  setViewportMargins(lineNumberAreaWidth(), 0, 0, 0);
+  if (updateGutterWidth()) {
+    setViewportMargins(m_gutter_width, 0, 0, 0);
+  }
 }
 
 void EBookCodeEditor::highlightCurrentLine()
@@ -119,11 +217,260 @@ void EBookCodeEditor::updateLineNumberArea(const QRect& rect, int dy)
   if (rect.contains(viewport()->rect())) updateLineNumberAreaWidth(0);
 }
 
+/*!
+ * \brief Shows a document, with its code highlighted.
+ *
+ * A large document, a MOBI book is a single document, is not highlighted
+ * all at once. The visible blocks are highlighted at once and the rest a
+ * few milliseconds at a time while the editor is idle.
+ */
 void EBookCodeEditor::setDocument(IEBookDocument* document)
 {
   QTextDocument* doc = dynamic_cast<QTextDocument*>(document);
+  attachDocument(doc, doc && doc->characterCount() > LARGE_DOCUMENT);
+  if (m_large_file) {
+    startSlicedHighlight(false);
+  }
+}
+
+/*!
+ * \brief Shows the xhtml code in a document of the editor's own.
+ *
+ * Code of more than LARGE_DOCUMENT characters is added to the document
+ * LOAD_CHUNK characters at a time while the editor is idle, so the first
+ * page can be seen and scrolled before the rest has been read.
+ */
+void EBookCodeEditor::setCode(const QString& code)
+{
+  QTextDocument* old_doc = document();
+  QTextDocument* doc = new QTextDocument(this);
+  doc->setDocumentLayout(new QPlainTextDocumentLayout(doc));
+  bool large = (code.size() > LARGE_DOCUMENT);
+  attachDocument(doc, large);
+  if (old_doc && old_doc->parent() == this) {
+    old_doc->deleteLater();
+  }
+
+  if (large) {
+    // loading is not something to undo.
+    doc->setUndoRedoEnabled(false);
+    m_pending_code = code;
+    m_load_position = 0;
+    loadChunk();
+  } else {
+    doc->setPlainText(code);
+  }
+}
+
+bool EBookCodeEditor::isLargeFile() const
+{
+  return m_large_file;
+}
+
+/*!
+ * \brief True while setCode() is still adding code to the document.
+ */
+bool EBookCodeEditor::isLoading() const
+{
+  return !m_pending_code.isEmpty();
+}
+
+/*
+ * Qt only highlights the document once the event loop runs, by which time
+ * the highlighter is deferred.
+ */
+void EBookCodeEditor::attachDocument(QTextDocument* doc, bool large)
+{
+  m_highlight_timer.stop();
+  m_load_timer.stop();
+  m_pending_code.clear();
   m_highlighter = new XhtmlHighlighter(m_options, doc);
+  m_highlighter->setDeferred(large);
+  if (m_options) {
+    m_format_version = m_options->codeFormatVersion();
+  }
+#ifdef EBOOK_TRACE_ENABLED
+  if (doc && !dynamic_cast<EBookTracedLayout*>(doc->documentLayout())) {
+    doc->setDocumentLayout(new EBookTracedLayout(doc));
+  }
+#endif
   QPlainTextEdit::setDocument(doc);
+  setLargeFile(large);
+  if (doc) {
+    connect(doc, &QTextDocument::undoCommandAdded, this,
+            &EBookCodeEditor::boundUndo);
+    connect(doc, &QTextDocument::contentsChange, this,
+            &EBookCodeEditor::profileEdit);
+  }
+}
+
+/*!
+ * \brief Shows or hides the profiling overlay, the time spent highlighting,
+ * laying out and painting the code in each frame.
+ *
+ * The overlay is only of use when tracing is built in, see EBookTrace.
+ */
+void EBookCodeEditor::setProfileOverlay(bool show)
+{
+  if (!show) {
+    delete m_profile_overlay;
+    m_profile_overlay = nullptr;
+    return;
+  }
+  if (m_profile_overlay) {
+    return;
+  }
+  QList<EBookProfileOverlay::Row> rows;
+  rows << EBookProfileOverlay::Row{ tr("Highlight"),
+                                    "XhtmlHighlighter::highlightBlock" }
+       << EBookProfileOverlay::Row{ tr("Layout"), "EBookCodeEditor::layout" }
+       << EBookProfileOverlay::Row{
+            tr("Line numbers"), "EBookCodeEditor::lineNumberAreaPaintEvent" }
+       << EBookProfileOverlay::Row{ tr("Paint"),
+                                    "EBookCodeEditor::paintEvent" };
+  m_profile_overlay =
+    new EBookProfileOverlay(this, rows, "XhtmlHighlighter::highlightBlock");
+  m_profile_overlay->show();
+}
+
+/*
+ * The highlighter marks the blocks it formats as changed, with as many
+ * characters removed as added, which is not an edit.
+ */
+void EBookCodeEditor::profileEdit(int /*position*/, int removed, int added)
+{
+  if (m_profile_overlay && removed != added) {
+    m_profile_overlay->documentEdited();
+  }
+}
+
+/*
+ * Large-file mode lays the lines out without wrapping, so that a line is
+ * laid out only when it is shown, and bounds the undo history.
+ */
+void EBookCodeEditor::setLargeFile(bool large)
+{
+  m_large_file = large;
+  setLineWrapMode(large ? QPlainTextEdit::NoWrap
+                        : QPlainTextEdit::WidgetWidth);
+}
+
+/*
+ * QTextDocument cannot drop only its oldest undo steps, so once a large
+ * file has more than MAX_UNDO_STEPS the history is cleared.
+ */
+void EBookCodeEditor::boundUndo()
+{
+  if (m_large_file && document()->availableUndoSteps() > MAX_UNDO_STEPS) {
+    document()->clearUndoRedoStacks(QTextDocument::UndoStack);
+  }
+}
+
+/*
+ * Appends the next LOAD_CHUNK characters of the code, the background
+ * highlight starts once it is all there.
+ */
+void EBookCodeEditor::loadChunk()
+{
+  int end = qMin(m_load_position + LOAD_CHUNK, m_pending_code.size());
+  // never split a surrogate pair.
+  if (end < m_pending_code.size() &&
+      m_pending_code.at(end - 1).isHighSurrogate()) {
+    end++;
+  }
+  QTextCursor cursor(document());
+  cursor.movePosition(QTextCursor::End);
+  cursor.insertText(
+    m_pending_code.mid(m_load_position, end - m_load_position));
+  m_load_position = end;
+
+  if (m_load_position < m_pending_code.size()) {
+    highlightVisible();
+    m_load_timer.start();
+  } else {
+    m_pending_code.clear();
+    document()->setUndoRedoEnabled(true);
+    startSlicedHighlight(false);
+  }
+}
+
+/*
+ * Highlights the visible blocks then starts the background highlight from
+ * the start of the document. If again the visible blocks are highlighted
+ * even if they have been before, the formats have changed.
+ */
+void EBookCodeEditor::startSlicedHighlight(bool again)
+{
+  m_next_block = 0;
+  if (again) {
+    int bottom = viewport()->height();
+    QTextBlock block = firstVisibleBlock();
+    while (block.isValid() &&
+           blockBoundingGeometry(block).translated(contentOffset()).top() <=
+             bottom) {
+      m_highlighter->highlightNow(block);
+      block = block.next();
+    }
+  } else {
+    highlightVisible();
+  }
+  m_highlight_timer.start();
+}
+
+/*
+ * Highlights any visible blocks that the background highlight has not
+ * reached.
+ */
+void EBookCodeEditor::highlightVisible()
+{
+  if (!m_highlighter || !m_highlighter->isDeferred()) {
+    return;
+  }
+  int bottom = viewport()->height();
+  QTextBlock block = firstVisibleBlock();
+  while (block.isValid() &&
+         blockBoundingGeometry(block).translated(contentOffset()).top() <=
+           bottom) {
+    if (!XhtmlHighlighter::isHighlighted(block)) {
+      m_highlighter->highlightNow(block);
+    }
+    block = block.next();
+  }
+}
+
+/*
+ * Highlights blocks from the start of the document for HIGHLIGHT_SLICE ms,
+ * then lets the event loop run before the next slice.
+ */
+void EBookCodeEditor::highlightSlice()
+{
+  EBOOK_TRACE_SCOPE("EBookCodeEditor::highlightSlice");
+  // the block is found by number, edits may have removed the last one.
+  QTextBlock block = document()->findBlockByNumber(m_next_block);
+  QElapsedTimer elapsed;
+  elapsed.start();
+  while (block.isValid() && elapsed.elapsed() < HIGHLIGHT_SLICE) {
+    m_highlighter->highlightNow(block);
+    block = block.next();
+    m_next_block++;
+  }
+  if (block.isValid()) {
+    m_highlight_timer.start();
+  } else {
+    // every block is highlighted, edits are now followed as normal.
+    m_highlighter->setDeferred(false);
+  }
+}
+
+/*
+ * Only a visible editor is highlighted straight away, the others wait
+ * until they are next shown.
+ */
+void EBookCodeEditor::codeFormatsChanged()
+{
+  if (isVisible()) {
+    rehighlight();
+  }
 }
 
 /*!
@@ -135,8 +482,21 @@ void EBookCodeEditor::setDocument(IEBookDocument* document)
 void EBookCodeEditor::rehighlight()
 {
   setFont(m_options->codeFont());
-  m_highlighter->resetFormattingOptions();
-  m_highlighter->rehighlight();
+  // the gutter width depends upon the font.
+  m_gutter_digits = 0;
+  updateLineNumberAreaWidth(0);
+  m_format_version = m_options->codeFormatVersion();
+  if (!m_highlighter) {
+    return;
+  }
+  if (document()->characterCount() > LARGE_DOCUMENT) {
+    // every block is highlighted again through the slices.
+    m_highlighter->setDeferred(true);
+    startSlicedHighlight(true);
+  } else {
+    EBOOK_TRACE_SCOPE("XhtmlHighlighter::rehighlight");
+    m_highlighter->rehighlight();
+  }
 }
 
 LineNumberArea::LineNumberArea(EBookCodeEditor* editor) : QWidget(editor)
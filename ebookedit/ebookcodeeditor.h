@@ -3,10 +3,14 @@
 
 #include <QPainter>
 #include <QPlainTextEdit>
+#include <QTextBlock>
+#include <QTimer>
 
 #include "iebookdocument.h"
 #include "xhtmlhighlighter.h"
 
+class EBookProfileOverlay;
+
 class EBookCodeEditor : public QPlainTextEdit
 {
 public:
@@ -19,18 +23,54 @@ public:
   int lineNumberAreaWidth();
 
   void setDocument(IEBookDocument* document);
+  void setCode(const QString& code);
   void rehighlight();
+  bool isLargeFile() const;
+  bool isLoading() const;
+  void setProfileOverlay(bool show);
 
 protected:
   QWidget* lineNumberArea;
   XhtmlHighlighter* m_highlighter;
   Options* m_options;
+  // large documents are highlighted in slices, m_next_block is the number
+  // of the next block that the background highlight will do.
+  QTimer m_highlight_timer;
+  int m_next_block;
+  // the version of the code formats that the document was highlighted with.
+  int m_format_version;
+  // documents larger than LARGE_DOCUMENT are edited in large-file mode.
+  bool m_large_file;
+  // the code that setCode() has still to add to the document.
+  QTimer m_load_timer;
+  QString m_pending_code;
+  int m_load_position;
+  int m_gutter_digits, m_gutter_width;
+  EBookProfileOverlay* m_profile_overlay;
 
+  void paintEvent(QPaintEvent* event) override;
+  void showEvent(QShowEvent* event) override;
   void resizeEvent(QResizeEvent* event) override;
   void updateLineNumberAreaWidth(int newBlockCount);
   void highlightCurrentLine();
   void updateLineNumberArea(const QRect&, int);
   void init();
+  bool updateGutterWidth();
+  void attachDocument(QTextDocument* doc, bool large);
+  void setLargeFile(bool large);
+  void boundUndo();
+  void loadChunk();
+  void startSlicedHighlight(bool again);
+  void highlightVisible();
+  void highlightSlice();
+  void codeFormatsChanged();
+  void profileEdit(int position, int removed, int added);
+
+  // documents of more characters than this are highlighted in slices.
+  static const int LARGE_DOCUMENT = 1000000;
+  static const int HIGHLIGHT_SLICE = 5; // ms.
+  static const int LOAD_CHUNK = 256 * 1024; // characters.
+  static const int MAX_UNDO_STEPS = 200;
 };
 
 class LineNumberArea : public QWidget
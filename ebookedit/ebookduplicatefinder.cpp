@@ -0,0 +1,212 @@
+#include "ebookduplicatefinder.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QHash>
+#include <QtConcurrent>
+#include <QtEndian>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <quazip5/quazip.h>
+
+#include <qlogger/qlogger.h>
+
+using namespace qlogger;
+
+EBookDuplicateFinder::EBookDuplicateFinder(LibraryDB library_db,
+                                           QObject* parent)
+  : QObject(parent)
+  , m_library_db(library_db)
+  , m_restart(false)
+{
+  connect(&m_watcher,
+          &QFutureWatcher<EBookHashTask>::resultsReadyAt,
+          this,
+          &EBookDuplicateFinder::booksHashed);
+  connect(&m_watcher,
+          &QFutureWatcher<EBookHashTask>::finished,
+          this,
+          &EBookDuplicateFinder::hashFinished);
+}
+
+EBookDuplicateFinder::~EBookDuplicateFinder()
+{
+  cancel();
+  m_watcher.waitForFinished();
+}
+
+/*!
+ * \brief Hashes the books that do not yet have a content hash then looks
+ * for duplicates.
+ *
+ * If a search is already running another follows it, so books added in
+ * the meantime are included.
+ */
+void
+EBookDuplicateFinder::start()
+{
+  if (isRunning()) {
+    m_restart = true;
+    return;
+  }
+  m_restart = false;
+
+  HashTaskList tasks;
+  foreach (BookData book, m_library_db->books()) {
+    if (book->content_hash.isEmpty() && !book->filename.isEmpty()) {
+      EBookHashTask task;
+      task.uid = book->uid;
+      task.filename = book->filename;
+      tasks << task;
+    }
+  }
+  m_watcher.setFuture(
+    QtConcurrent::mapped(tasks, &EBookDuplicateFinder::hashBook));
+}
+
+void
+EBookDuplicateFinder::cancel()
+{
+  m_restart = false;
+  m_watcher.cancel();
+}
+
+bool
+EBookDuplicateFinder::isRunning() const
+{
+  return m_watcher.isRunning();
+}
+
+/*!
+ * \brief The clusters of books found by the last search.
+ */
+DuplicateList
+EBookDuplicateFinder::duplicates() const
+{
+  return m_duplicates;
+}
+
+/*!
+ * \brief Works out the content hash of a book file.
+ *
+ * \return the hash, or an empty string if the file could not be read.
+ */
+QString
+EBookDuplicateFinder::contentHash(const QString& filename)
+{
+  QString hash = zipHash(filename);
+  if (hash.isEmpty()) {
+    hash = fileHash(filename);
+  }
+  return hash;
+}
+
+/*!
+ * \brief Run in the global thread pool.
+ */
+EBookHashTask
+EBookDuplicateFinder::hashBook(const EBookHashTask& task)
+{
+  EBookHashTask result = task;
+  result.hash = contentHash(task.filename);
+  return result;
+}
+
+/*!
+ * \brief Hashes the central directory of a zip file.
+ *
+ * Only the central directory is read. The CRC32 and uncompressed size of
+ * each entry are sorted so that two copies of a book written in a
+ * different order, or with different compression, have the same hash.
+ */
+QString
+EBookDuplicateFinder::zipHash(const QString& filename)
+{
+  QuaZip zip(filename);
+  if (!zip.open(QuaZip::mdUnzip)) {
+    return QString();
+  }
+  QList<QuaZipFileInfo64> infos = zip.getFileInfoList64();
+  zip.close();
+  if (infos.isEmpty()) {
+    return QString();
+  }
+
+  std::vector<std::pair<quint32, quint64>> entries;
+  entries.reserve(infos.size());
+  foreach (QuaZipFileInfo64 info, infos) {
+    entries.push_back(std::make_pair(info.crc, info.uncompressedSize));
+  }
+  std::sort(entries.begin(), entries.end());
+
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  for (const std::pair<quint32, quint64>& entry : entries) {
+    quint32 crc = qToLittleEndian(entry.first);
+    quint64 size = qToLittleEndian(entry.second);
+    hash.addData(reinterpret_cast<const char*>(&crc), sizeof(crc));
+    hash.addData(reinterpret_cast<const char*>(&size), sizeof(size));
+  }
+  return QString("zip:") + QString::fromLatin1(hash.result().toHex());
+}
+
+QString
+EBookDuplicateFinder::fileHash(const QString& filename)
+{
+  QFile file(filename);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return QString();
+  }
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  if (!hash.addData(&file)) {
+    return QString();
+  }
+  return QString::fromLatin1(hash.result().toHex());
+}
+
+/*!
+ * \brief Stores each batch of hashes in the library as it arrives, so
+ * that a cancelled search does not lose them.
+ */
+void
+EBookDuplicateFinder::booksHashed(int begin, int end)
+{
+  for (int i = begin; i < end; i++) {
+    EBookHashTask task = m_watcher.resultAt(i);
+    if (task.hash.isEmpty()) {
+      QLOG_DEBUG(tr("Unable to hash %1").arg(task.filename));
+      continue;
+    }
+    m_library_db->setContentHash(task.uid, task.hash);
+  }
+}
+
+/*!
+ * \brief Groups the books by their hashes.
+ */
+void
+EBookDuplicateFinder::hashFinished()
+{
+  if (m_restart) {
+    start();
+    return;
+  }
+  m_library_db->save();
+
+  QHash<QString, BookList> by_hash;
+  foreach (BookData book, m_library_db->books()) {
+    if (!book->content_hash.isEmpty()) {
+      by_hash[book->content_hash].append(book);
+    }
+  }
+  m_duplicates.clear();
+  for (QHash<QString, BookList>::const_iterator it = by_hash.constBegin();
+       it != by_hash.constEnd();
+       ++it) {
+    if (it.value().size() > 1) {
+      m_duplicates.append(it.value());
+    }
+  }
+  emit duplicatesFound(m_duplicates);
+}
@@ -0,0 +1,66 @@
+#ifndef EBOOKDUPLICATEFINDER_H
+#define EBOOKDUPLICATEFINDER_H
+
+#include <QFutureWatcher>
+#include <QList>
+#include <QObject>
+
+#include "library.h"
+
+/*!
+ * \brief A book waiting to have its content hash worked out.
+ */
+struct EBookHashTask
+{
+  quint64 uid = 0;
+  QString filename;
+  QString hash; // empty if the file could not be read.
+};
+typedef QList<EBookHashTask> HashTaskList;
+typedef QList<BookList> DuplicateList;
+
+/*!
+ * \brief Finds the books that are in the library more than once.
+ *
+ * Each book has a content hash that is kept with it in the library, so
+ * only new and changed books are hashed by start(), in parallel. For zip
+ * based books, epubs, the hash is taken over the sorted CRC32s and sizes
+ * of the entries in the zip central directory, so no entry is
+ * decompressed and the order the entries were written in does not matter.
+ * Other books are hashed in full.
+ *
+ * Books with the same hash are reported as a cluster by duplicatesFound().
+ */
+class EBookDuplicateFinder : public QObject
+{
+  Q_OBJECT
+public:
+  explicit EBookDuplicateFinder(LibraryDB library_db,
+                                QObject* parent = nullptr);
+  ~EBookDuplicateFinder();
+
+  void start();
+  void cancel();
+  bool isRunning() const;
+
+  DuplicateList duplicates() const;
+
+  static QString contentHash(const QString& filename);
+
+signals:
+  void duplicatesFound(const DuplicateList& duplicates);
+
+protected:
+  LibraryDB m_library_db;
+  QFutureWatcher<EBookHashTask> m_watcher;
+  DuplicateList m_duplicates;
+  bool m_restart;
+
+  static EBookHashTask hashBook(const EBookHashTask& task);
+  static QString zipHash(const QString& filename);
+  static QString fileHash(const QString& filename);
+  void booksHashed(int begin, int end);
+  void hashFinished();
+};
+
+#endif // EBOOKDUPLICATEFINDER_H
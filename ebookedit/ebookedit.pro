@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui xml svg sql
+QT       += core gui xml svg sql concurrent
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
 TEMPLATE = app
@@ -46,41 +46,83 @@ DESTDIR = $$OUT_PWD/..
 SOURCES += \
     main.cpp \
     mainwindow.cpp \
+    ebookpluginproxy.cpp \
+    ebooktypesniffer.cpp \
     optionsdialog.cpp \
     xhtmlhighlighter.cpp \
     ebookcodeeditor.cpp \
+    ebookduplicatefinder.cpp \
     ebookwrapper.cpp \
+    ebooksourcemap.cpp \
+    ebookundohistory.cpp \
+    ebookstatisticstracker.cpp \
+    ebookeditjournal.cpp \
+    ebookbooksearch.cpp \
     ebookeditor.cpp \
+    ebookprofileoverlay.cpp \
     deletefiledialog.cpp \
     authordialog.cpp \
+    batchmetadatadialog.cpp \
     metadataeditor.cpp \
     ebookwordreader.cpp \
     plugindialog.cpp \
+    memorydialog.cpp \
+    comparedialog.cpp \
     libraryframe.cpp \
+    librarytreemodel.cpp \
     libraryshelf.cpp \
     aboutdialog.cpp \
     ebooktocwidget.cpp \
     ebooktoceditor.cpp \
-    focuslineedit.cpp
+    focuslineedit.cpp \
+    ebooknamecompleter.cpp \
+    ebookimporter.cpp \
+    ebookmetadatabatch.cpp \
+    ebookindexer.cpp \
+    ebooklibrarywatcher.cpp \
+    ebookthumbnailcache.cpp \
+    searchdialog.cpp \
+    findreplacedialog.cpp
 
 HEADERS += \
     mainwindow.h \
+    ebookpluginproxy.h \
+    ebooktypesniffer.h \
     optionsdialog.h \
     xhtmlhighlighter.h \
     ebookcodeeditor.h \
+    ebookduplicatefinder.h \
     ebookwrapper.h \
+    ebooksourcemap.h \
+    ebookundohistory.h \
+    ebookstatisticstracker.h \
+    ebookeditjournal.h \
+    ebookbooksearch.h \
     ebookeditor.h \
+    ebookprofileoverlay.h \
     deletefiledialog.h \
     authordialog.h \
+    batchmetadatadialog.h \
     metadataeditor.h \
     ebookwordreader.h \
     plugindialog.h \
+    memorydialog.h \
+    comparedialog.h \
     libraryframe.h \
+    librarytreemodel.h \
     libraryshelf.h \
     aboutdialog.h \
     ebooktocwidget.h \
     ebooktoceditor.h \
-    focuslineedit.h
+    focuslineedit.h \
+    ebooknamecompleter.h \
+    ebookimporter.h \
+    ebookmetadatabatch.h \
+    ebookindexer.h \
+    ebooklibrarywatcher.h \
+    ebookthumbnailcache.h \
+    searchdialog.h \
+    findreplacedialog.h
 
 FORMS += \
         mainwindow.ui
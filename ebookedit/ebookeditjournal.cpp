@@ -0,0 +1,339 @@
+#include "ebookeditjournal.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QTextCursor>
+
+#include <qlogger/qlogger.h>
+
+using namespace qlogger;
+
+const QString EBookEditJournal::DIRECTORY = "journals";
+const QString EBookEditJournal::SUFFIX = ".journal";
+
+EBookEditJournal::EBookEditJournal(Options* options, QObject* parent)
+  : QObject(parent)
+  , m_options(options)
+  , m_document(nullptr)
+  , m_changing_chapter(false)
+{}
+
+/*
+ * The journal is left behind, the edits in it have not been saved.
+ */
+EBookEditJournal::~EBookEditJournal()
+{
+  m_file.close();
+}
+
+/*!
+ * \brief Journals the edits to a newly opened book.
+ *
+ * Nothing is written until the first edit, so an existing journal of the
+ * book is still there for recover().
+ */
+void
+EBookEditJournal::setDocument(ITextDocument* document)
+{
+  if (m_document) {
+    disconnect(m_document, nullptr, this, nullptr);
+  }
+  m_file.close();
+  m_changing_chapter = false;
+  m_document = document;
+  if (!m_document) {
+    return;
+  }
+
+  // connected after the undo history, which puts back the edits of a
+  // chapter in its chapterChanged(), so those are not journalled again.
+  connect(m_document,
+          &QTextDocument::contentsChange,
+          this,
+          &EBookEditJournal::contentsChange);
+  connect(m_document,
+          &ITextDocument::chapterAboutToChange,
+          this,
+          &EBookEditJournal::chapterAboutToChange);
+  connect(m_document,
+          &ITextDocument::chapterChanged,
+          this,
+          &EBookEditJournal::chapterChanged);
+  connect(m_document,
+          &ITextDocument::chapterSourceChanged,
+          this,
+          &EBookEditJournal::chapterSourceChanged);
+  connect(m_document,
+          &ITextDocument::saveCompleted,
+          this,
+          &EBookEditJournal::saveCompleted);
+}
+
+/*!
+ * \brief Replays the journal left by an earlier session over the book.
+ *
+ * The edits are journalled afresh as they are replayed, so the book can
+ * be recovered again if Biblos stops before it is saved.
+ *
+ * \return true if there were edits to replay and all were replayed.
+ */
+bool
+EBookEditJournal::recover()
+{
+  if (!m_document) {
+    return false;
+  }
+  QString book;
+  EBookEditRecordList records;
+  QString filename = journalFilename(m_options, m_document->filename());
+  if (!readJournal(filename, book, records) || records.isEmpty()) {
+    return false;
+  }
+
+  m_file.close();
+  QFile::remove(filename);
+  bool replayed = true;
+  foreach (EBookEditRecord record, records) {
+    if (!replay(record)) {
+      QLOG_DEBUG(tr("Unable to replay an edit of chapter %1 of %2")
+                   .arg(record.chapter)
+                   .arg(book));
+      replayed = false;
+    }
+  }
+  return replayed;
+}
+
+/*!
+ * \brief Removes the journal, the book was closed with nothing unsaved.
+ */
+void
+EBookEditJournal::discard()
+{
+  m_file.close();
+  if (m_document) {
+    QFile::remove(journalFilename(m_options, m_document->filename()));
+  }
+}
+
+/*!
+ * \brief The journal of a book, named from a hash of its path.
+ */
+QString
+EBookEditJournal::journalFilename(Options* options, const QString& book)
+{
+  QByteArray hash =
+    QCryptographicHash::hash(QFileInfo(book).absoluteFilePath().toUtf8(),
+                             QCryptographicHash::Sha1);
+  return options->configDirectory() + QDir::separator() + DIRECTORY +
+         QDir::separator() + QString::fromLatin1(hash.toHex().left(16)) +
+         SUFFIX;
+}
+
+/*!
+ * \brief The books with edits journalled but not saved.
+ *
+ * Journals with no edits, and those of books that are missing or have been
+ * saved since the journal was started, are removed.
+ */
+QStringList
+EBookEditJournal::recoverableBooks(Options* options)
+{
+  QStringList books;
+  QDir directory(options->configDirectory() + QDir::separator() + DIRECTORY);
+  foreach (QString name,
+           directory.entryList(QStringList() << "*" + SUFFIX, QDir::Files)) {
+    QString filename = directory.filePath(name);
+    QString book;
+    EBookEditRecordList records;
+    if (readJournal(filename, book, records) && !records.isEmpty()) {
+      books.append(book);
+    } else {
+      QFile::remove(filename);
+    }
+  }
+  return books;
+}
+
+/*!
+ * \brief Removes the journal of a book whose edits are not to be
+ * recovered.
+ */
+void
+EBookEditJournal::discardBook(Options* options, const QString& book)
+{
+  QFile::remove(journalFilename(options, book));
+}
+
+void
+EBookEditJournal::contentsChange(int position, int removed, int added)
+{
+  // chapters are loaded with undo turned off, they are not edits.
+  if (m_changing_chapter || !m_document->isUndoRedoEnabled()) {
+    return;
+  }
+  EBookEditRecord record;
+  record.chapter = m_document->currentChapter();
+  record.position = position;
+  record.removed = removed;
+  if (added > 0) {
+    int last = m_document->characterCount() - 1;
+    QTextCursor cursor(m_document);
+    cursor.setPosition(qBound(0, position, last));
+    cursor.setPosition(qBound(0, position + added, last),
+                       QTextCursor::KeepAnchor);
+    record.text = cursor.selectedText();
+  }
+  append(record);
+}
+
+void
+EBookEditJournal::chapterAboutToChange(int /*index*/)
+{
+  m_changing_chapter = true;
+}
+
+void
+EBookEditJournal::chapterChanged(int /*index*/)
+{
+  m_changing_chapter = false;
+}
+
+/*
+ * The new xhtml is journalled whole, it is replaced rarely and as a whole.
+ */
+void
+EBookEditJournal::chapterSourceChanged(int index)
+{
+  EBookEditRecord record;
+  record.chapter = index;
+  record.position = -1;
+  record.text = m_document->chapterSourceAt(index);
+  append(record);
+}
+
+/*
+ * The journal starts again from the saved book, which may also have a new
+ * name after a save as.
+ */
+void
+EBookEditJournal::saveCompleted(bool success)
+{
+  if (success && m_file.isOpen()) {
+    m_file.close();
+    m_file.remove();
+  }
+}
+
+/*
+ * Starts the journal with the book's path, size and modification time,
+ * which must still match for it to be replayed.
+ */
+bool
+EBookEditJournal::open()
+{
+  QString book = QFileInfo(m_document->filename()).absoluteFilePath();
+  m_file.setFileName(journalFilename(m_options, book));
+  QDir().mkpath(QFileInfo(m_file.fileName()).path());
+  if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    QLOG_DEBUG(
+      tr("Unable to open the edit journal %1").arg(m_file.fileName()));
+    return false;
+  }
+  QFileInfo info(book);
+  QDataStream stream(&m_file);
+  stream.setVersion(QDataStream::Qt_5_0);
+  stream << MAGIC << book << qint64(info.size())
+         << qint64(info.lastModified().toMSecsSinceEpoch());
+  return m_file.flush();
+}
+
+/*
+ * Each record is flushed as it is written, a record cut short by a crash
+ * is ignored by readJournal().
+ */
+bool
+EBookEditJournal::append(const EBookEditRecord& record)
+{
+  if (!m_file.isOpen() && !open()) {
+    return false;
+  }
+  QDataStream stream(&m_file);
+  stream.setVersion(QDataStream::Qt_5_0);
+  stream << record.chapter << record.position << record.removed
+         << record.text;
+  if (stream.status() != QDataStream::Ok || !m_file.flush()) {
+    QLOG_DEBUG(
+      tr("Unable to write to the edit journal %1").arg(m_file.fileName()));
+    return false;
+  }
+  return true;
+}
+
+bool
+EBookEditJournal::replay(const EBookEditRecord& record)
+{
+  if (record.chapter != m_document->currentChapter() &&
+      !m_document->setCurrentChapter(record.chapter)) {
+    return false;
+  }
+  if (record.position < 0) {
+    return m_document->setChapterSource(record.chapter, record.text);
+  }
+
+  int last = m_document->characterCount() - 1;
+  QTextCursor cursor(m_document);
+  cursor.setPosition(qBound(0, record.position, last));
+  cursor.setPosition(qBound(0, record.position + record.removed, last),
+                     QTextCursor::KeepAnchor);
+  if (record.text.isEmpty()) {
+    cursor.removeSelectedText();
+  } else {
+    cursor.insertText(record.text);
+  }
+  return true;
+}
+
+/*
+ * Reads the book and edits of a journal, the journal is only valid if the
+ * book is still as it was when the journal was started.
+ */
+bool
+EBookEditJournal::readJournal(const QString& filename,
+                              QString& book,
+                              EBookEditRecordList& records)
+{
+  QFile file(filename);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  QDataStream stream(&file);
+  stream.setVersion(QDataStream::Qt_5_0);
+  quint32 magic;
+  qint64 size, modified;
+  stream >> magic >> book >> size >> modified;
+  if (stream.status() != QDataStream::Ok || magic != MAGIC) {
+    QLOG_DEBUG(tr("%1 is not an edit journal").arg(filename));
+    return false;
+  }
+  QFileInfo info(book);
+  if (!info.exists() || info.size() != size ||
+      info.lastModified().toMSecsSinceEpoch() != modified) {
+    QLOG_DEBUG(tr("%1 has changed since it was journalled").arg(book));
+    return false;
+  }
+
+  while (!stream.atEnd()) {
+    EBookEditRecord record;
+    stream >> record.chapter >> record.position >> record.removed >>
+      record.text;
+    if (stream.status() != QDataStream::Ok) {
+      break;
+    }
+    records.append(record);
+  }
+  return true;
+}
@@ -0,0 +1,84 @@
+#ifndef EBOOKEDITJOURNAL_H
+#define EBOOKEDITJOURNAL_H
+
+#include <QFile>
+#include <QList>
+#include <QObject>
+#include <QStringList>
+
+#include "iebookdocument.h"
+#include "options.h"
+
+/*!
+ * \brief One edit of a book, as kept by EBookEditJournal.
+ *
+ * The position and removed length are those of the chapter's
+ * QTextDocument. A position of -1 is the xhtml of the chapter being
+ * replaced, by a replace over the whole book for instance, and the text is
+ * then the new xhtml.
+ */
+struct EBookEditRecord
+{
+  qint32 chapter = 0;
+  qint32 position = 0;
+  qint32 removed = 0;
+  QString text; // inserted.
+};
+typedef QList<EBookEditRecord> EBookEditRecordList;
+
+/*!
+ * \brief An autosave journal of the edits to an open book.
+ *
+ * Each edit is appended to a file in the journals folder of the config
+ * directory as it is made and flushed, so that saving it costs only the
+ * size of the edit rather than a rewrite of the book. The journal starts
+ * with the size and modification time of the book as last saved and is
+ * removed once the book is saved again.
+ *
+ * If Biblos stops before the book is saved the journal is left behind and
+ * recover() replays it over the saved book the next time the book is
+ * opened, through the document as if the edits were made again, so they
+ * are journalled again as they are replayed and are undoable.
+ *
+ * The text that is inserted is kept without its formatting, so a pasted
+ * paragraph is recovered with the format of the text around it.
+ */
+class EBookEditJournal : public QObject
+{
+  Q_OBJECT
+public:
+  explicit EBookEditJournal(Options* options, QObject* parent = nullptr);
+  ~EBookEditJournal();
+
+  void setDocument(ITextDocument* document);
+  bool recover();
+  void discard();
+
+  static QString journalFilename(Options* options, const QString& book);
+  static QStringList recoverableBooks(Options* options);
+  static void discardBook(Options* options, const QString& book);
+
+protected:
+  Options* m_options;
+  ITextDocument* m_document;
+  QFile m_file;
+  bool m_changing_chapter; // between chapterAboutToChange and chapterChanged.
+
+  void contentsChange(int position, int removed, int added);
+  void chapterAboutToChange(int index);
+  void chapterChanged(int index);
+  void chapterSourceChanged(int index);
+  void saveCompleted(bool success);
+  bool open();
+  bool append(const EBookEditRecord& record);
+  bool replay(const EBookEditRecord& record);
+  static bool readJournal(const QString& filename,
+                          QString& book,
+                          EBookEditRecordList& records);
+
+  static const quint32 MAGIC = 0x45424a31; // "EBJ1"
+  static const QString DIRECTORY;
+  static const QString SUFFIX;
+};
+
+#endif // EBOOKEDITJOURNAL_H
@@ -1,9 +1,29 @@
 #include "ebookeditor.h"
 
-EBookEditor::EBookEditor(QWidget* parent) : QTextEdit(parent) {}
+#include <QKeyEvent>
+#include <QResizeEvent>
+#include <QScrollBar>
+#include <QTextBlock>
+#include <QWheelEvent>
+
+#include "ebookprofileoverlay.h"
+#include "ebooksourcemap.h"
+#include "ebooktrace.h"
+#include "ebookundohistory.h"
+
+EBookEditor::EBookEditor(QWidget* parent)
+  : QTextEdit(parent)
+  , m_document(nullptr)
+  , m_undo_history(nullptr)
+  , m_base_point_size(font().pointSizeF())
+  , m_profile_overlay(nullptr) {}
 
 EBookEditor::EBookEditor(const EBookEditor& editor)
-  : QTextEdit(dynamic_cast<QWidget*>(editor.parent())) {}
+  : QTextEdit(dynamic_cast<QWidget*>(editor.parent()))
+  , m_document(nullptr)
+  , m_undo_history(nullptr)
+  , m_base_point_size(font().pointSizeF())
+  , m_profile_overlay(nullptr) {}
 
 EBookEditor::~EBookEditor() {}
 
@@ -12,16 +32,266 @@ void EBookEditor::setDocument(IEBookDocument* document)
   QTextDocument* doc = dynamic_cast<QTextDocument*>(document);
   QTextEdit::setDocument(doc);
   m_document = document;
+  if (m_document) {
+    m_document->setImageZoom(zoom());
+    updatePageLayout();
+  }
   //  m_data.setValue(*document->data());
   emit documentLoaded();
 }
 
+IEBookDocument* EBookEditor::ebookDocument() const
+{
+  return m_document;
+}
+
 QVariant EBookEditor::data()
 {
   return m_data;
 }
 
-QString EBookEditor::buildTocFromData()
+EBookToc EBookEditor::buildTocFromData()
 {
   return m_document->buildTocFromData();
 }
+
+/*!
+ * \brief Shows another chapter of a book that is shown a chapter at a
+ * time, at its start or, if at_end, at its end.
+ *
+ * Only the chapter shown is laid out, its neighbours are prepared by the
+ * document in the background and the others are released.
+ */
+bool EBookEditor::showChapter(int index, bool at_end)
+{
+  if (!m_document || index < 0 || index >= m_document->chapterCount()) {
+    return false;
+  }
+  if (index != m_document->currentChapter() &&
+      !m_document->setCurrentChapter(index)) {
+    return false;
+  }
+  moveCursor(at_end ? QTextCursor::End : QTextCursor::Start);
+  return true;
+}
+
+/*!
+ * \brief Shows a page of a chapter, a page being a screenful.
+ *
+ * The pages are worked out in the background, see
+ * IEBookDocument::chapterPageCount(), so this fails until those of the
+ * chapter are known.
+ */
+bool EBookEditor::showPage(int index, int page)
+{
+  if (!m_document) {
+    return false;
+  }
+  int position = m_document->pagePosition(index, page);
+  if (position < 0 || !showChapter(index)) {
+    return false;
+  }
+  QTextCursor cursor = textCursor();
+  cursor.setPosition(qMin(position, document()->characterCount() - 1));
+  setTextCursor(cursor);
+  // the page starts at the top of the view.
+  QScrollBar* bar = verticalScrollBar();
+  bar->setValue(bar->value() + cursorRect(cursor).top());
+  return true;
+}
+
+/*!
+ * \brief Shows a block of a chapter at the top of the view.
+ *
+ * The block is found through block_index if the chapter has not changed
+ * since it was indexed, otherwise it is looked up by number.
+ */
+bool EBookEditor::showBlock(int index,
+                            int block,
+                            const EBookBlockIndex& block_index)
+{
+  if (!showChapter(index)) {
+    return false;
+  }
+  int position = block_index.position(index, block, document());
+  if (position < 0) {
+    QTextBlock found = document()->findBlockByNumber(block);
+    if (!found.isValid()) {
+      return false;
+    }
+    position = found.position();
+  }
+  QTextCursor cursor = textCursor();
+  cursor.setPosition(position);
+  setTextCursor(cursor);
+  QScrollBar* bar = verticalScrollBar();
+  bar->setValue(bar->value() + cursorRect(cursor).top());
+  return true;
+}
+
+/*!
+ * \brief The number of the block at the top of the view.
+ */
+int EBookEditor::topBlock() const
+{
+  return cursorForPosition(QPoint(0, 0)).blockNumber();
+}
+
+/*!
+ * \brief Moves to a table of contents link, which may be in another
+ * chapter.
+ */
+void EBookEditor::showUrl(const QUrl& url)
+{
+  QString fragment = url.fragment();
+  int chapter = (m_document ? m_document->chapterOfHref(url.path()) : -1);
+  if (chapter >= 0) {
+    showChapter(chapter);
+    if (!fragment.isEmpty()) {
+      scrollToAnchor(fragment);
+    }
+  } else if (fragment.isEmpty()) {
+    scrollToAnchor(url.path());
+  } else {
+    scrollToAnchor(fragment);
+  }
+}
+
+/*!
+ * \brief Selects the text that came from a range of the xhtml of the
+ * chapter shown, a book search hit for instance.
+ */
+void EBookEditor::selectSource(int offset, int length)
+{
+  if (!m_document) {
+    return;
+  }
+  EBookSourceMap map;
+  map.build(m_document->chapterSource(), document()->toPlainText());
+  QTextCursor cursor = textCursor();
+  cursor.setPosition(map.textPosition(offset));
+  cursor.setPosition(map.textPosition(offset + length),
+                     QTextCursor::KeepAnchor);
+  setTextCursor(cursor);
+  ensureCursorVisible();
+}
+
+/*!
+ * \brief Sets the history that undo and redo go through, rather than the
+ * document's own unbounded undo stack.
+ */
+void EBookEditor::setUndoHistory(EBookUndoHistory* history)
+{
+  m_undo_history = history;
+}
+
+/*
+ * How far the text is zoomed, 1.0 being unzoomed.
+ */
+qreal EBookEditor::zoom() const
+{
+  if (m_base_point_size <= 0) {
+    return 1.0;
+  }
+  return font().pointSizeF() / m_base_point_size;
+}
+
+/*
+ * The document's chapters are paginated at the size of the view and the
+ * zoomed font.
+ */
+void EBookEditor::updatePageLayout()
+{
+  if (m_document) {
+    m_document->setPageLayoutSize(QSizeF(viewport()->size()));
+  }
+}
+
+void EBookEditor::keyPressEvent(QKeyEvent* event)
+{
+  if (m_undo_history && event->matches(QKeySequence::Undo)) {
+    m_undo_history->undo();
+    event->accept();
+  } else if (m_undo_history && event->matches(QKeySequence::Redo)) {
+    m_undo_history->redo();
+    event->accept();
+  } else {
+    QTextEdit::keyPressEvent(event);
+  }
+}
+
+/*
+ * Scrolling on past the end of a chapter moves to the start of the next,
+ * and back past its start to the end of the one before. Scrolling with
+ * control held zooms the text, and the images with it.
+ */
+void EBookEditor::wheelEvent(QWheelEvent* event)
+{
+  QScrollBar* bar = verticalScrollBar();
+  int delta = event->angleDelta().y();
+  if (event->modifiers() & Qt::ControlModifier) {
+    if (delta > 0) {
+      zoomIn();
+    } else if (delta < 0) {
+      zoomOut();
+    }
+    if (m_document) {
+      m_document->setImageZoom(zoom());
+      updatePageLayout();
+    }
+    event->accept();
+    return;
+  }
+  if (m_document && m_document->chapterCount() > 1) {
+    int chapter = m_document->currentChapter();
+    if ((delta < 0 && bar->value() == bar->maximum() &&
+         showChapter(chapter + 1)) ||
+        (delta > 0 && bar->value() == bar->minimum() &&
+         showChapter(chapter - 1, true))) {
+      event->accept();
+      return;
+    }
+  }
+  QTextEdit::wheelEvent(event);
+}
+
+/*!
+ * \brief Shows or hides the profiling overlay, the time spent painting the
+ * book in each frame.
+ *
+ * The layout of a QTextEdit is private to Qt and cannot be traced, so only
+ * painting, which includes any layout that it needs, is shown. The overlay
+ * is only of use when tracing is built in, see EBookTrace.
+ */
+void EBookEditor::setProfileOverlay(bool show)
+{
+  if (!show) {
+    delete m_profile_overlay;
+    m_profile_overlay = nullptr;
+    return;
+  }
+  if (m_profile_overlay) {
+    return;
+  }
+  QList<EBookProfileOverlay::Row> rows;
+  rows << EBookProfileOverlay::Row{ tr("Paint"), "EBookEditor::paintEvent" };
+  m_profile_overlay = new EBookProfileOverlay(this, rows);
+  m_profile_overlay->show();
+}
+
+void EBookEditor::paintEvent(QPaintEvent* event)
+{
+  {
+    EBOOK_TRACE_SCOPE("EBookEditor::paintEvent");
+    QTextEdit::paintEvent(event);
+  }
+  if (m_profile_overlay) {
+    m_profile_overlay->frameFinished();
+  }
+}
+
+void EBookEditor::resizeEvent(QResizeEvent* event)
+{
+  QTextEdit::resizeEvent(event);
+  updatePageLayout();
+}
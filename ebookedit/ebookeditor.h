@@ -3,9 +3,14 @@
 
 #include <QTextDocument>
 #include <QTextEdit>
+#include <QUrl>
 
+#include "ebookblockindex.h"
 #include "iebookdocument.h"
 
+class EBookProfileOverlay;
+class EBookUndoHistory;
+
 class EBookEditor : public QTextEdit
 {
   Q_OBJECT
@@ -16,9 +21,20 @@ public:
   ~EBookEditor();
 
   void setDocument(IEBookDocument* document);
+  IEBookDocument* ebookDocument() const;
   QVariant data();
 
-  QString buildTocFromData();
+  EBookToc buildTocFromData();
+
+  bool showChapter(int index, bool at_end = false);
+  bool showPage(int index, int page);
+  bool showBlock(int index, int block, const EBookBlockIndex& block_index);
+  int topBlock() const;
+  void showUrl(const QUrl& url);
+  void selectSource(int offset, int length);
+
+  void setUndoHistory(EBookUndoHistory* history);
+  void setProfileOverlay(bool show);
 
 signals:
   void documentLoaded();
@@ -26,6 +42,16 @@ signals:
 protected:
   QVariant m_data;
   IEBookDocument* m_document;
+  EBookUndoHistory* m_undo_history;
+  qreal m_base_point_size; // the font size before any zoom.
+  EBookProfileOverlay* m_profile_overlay;
+
+  qreal zoom() const;
+  void updatePageLayout();
+  void paintEvent(QPaintEvent* event) override;
+  void keyPressEvent(QKeyEvent* event) override;
+  void wheelEvent(QWheelEvent* event) override;
+  void resizeEvent(QResizeEvent* event) override;
 };
 
 Q_DECLARE_METATYPE(EBookEditor)
@@ -0,0 +1,450 @@
+#include "ebookimporter.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QtConcurrent>
+
+#include <qlogger/qlogger.h>
+
+#include "ebooktypesniffer.h"
+#include "iebookinterface.h"
+
+using namespace qlogger;
+
+EBookImporter::EBookImporter(Options* options,
+                             AuthorsDB authors_db,
+                             SeriesDB series_db,
+                             LibraryDB library_db,
+                             QObject* parent)
+  : QObject(parent)
+  , m_options(options)
+  , m_authors_db(authors_db)
+  , m_series_db(series_db)
+  , m_library_db(library_db)
+  , m_reading(false)
+  , m_in_place(false)
+  , m_pending_copies(0)
+  , m_total(0)
+  , m_done(0)
+  , m_imported(0)
+  , m_skipped(0)
+{
+  m_copy_pool.setMaxThreadCount(COPY_THREADS);
+  connect(&m_read_watcher,
+          &QFutureWatcher<EBookImportItem>::resultsReadyAt,
+          this,
+          &EBookImporter::resolveItems);
+  connect(&m_read_watcher,
+          &QFutureWatcher<EBookImportItem>::finished,
+          this,
+          &EBookImporter::readFinished);
+}
+
+EBookImporter::~EBookImporter()
+{
+  cancel();
+  m_read_watcher.waitForFinished();
+  m_copy_pool.waitForDone();
+}
+
+/*!
+ * \brief Starts importing every book below directory.
+ *
+ * Files are matched to plugins by their file filters. Files that are already
+ * inside the library directory are ignored.
+ *
+ * \return false if an import is already running or no books were found,
+ *         otherwise true in which case finished() will be emitted.
+ */
+bool
+EBookImporter::importDirectory(const QString& directory,
+                               const QList<IEBookInterface*>& plugins)
+{
+  if (isRunning()) {
+    return false;
+  }
+
+  QMap<QString, IEBookInterface*> suffixes = pluginSuffixes(plugins);
+  // files whose suffix is not known to a plugin are told by their contents.
+  EBookTypeSniffer sniffer(plugins);
+
+  QString library_directory =
+    QFileInfo(m_options->libraryDirectory()).absoluteFilePath();
+  ImportItemList items;
+  QDirIterator it(
+    directory, QDir::Files | QDir::Readable, QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    QFileInfo info(it.next());
+    if (info.absoluteFilePath().startsWith(library_directory)) {
+      continue;
+    }
+    EBookImportItem item;
+    item.source = info.absoluteFilePath();
+    item.plugin = suffixes.value(info.suffix().toLower());
+    if (!item.plugin) {
+      item.plugin = sniffer.plugin(item.source);
+    }
+    if (item.plugin) {
+      items.append(item);
+    }
+  }
+  if (items.isEmpty()) {
+    return false;
+  }
+
+  m_in_place = false;
+  startReading(items);
+  return true;
+}
+
+/*!
+ * \brief Reads the metadata of books that are already in the library
+ * directory, adding those that are not yet in the library and updating
+ * those that are.
+ *
+ * Nothing is copied. Files that have no plugin are ignored.
+ *
+ * \return false if an import is already running or there was nothing to
+ *         read, otherwise true in which case finished() will be emitted.
+ */
+bool
+EBookImporter::updateFiles(const QStringList& files,
+                           const QList<IEBookInterface*>& plugins)
+{
+  if (isRunning()) {
+    return false;
+  }
+
+  QMap<QString, IEBookInterface*> suffixes = pluginSuffixes(plugins);
+  ImportItemList items;
+  foreach (QString file, files) {
+    EBookImportItem item;
+    item.source = file;
+    item.plugin = suffixes.value(QFileInfo(file).suffix().toLower());
+    if (item.plugin) {
+      items.append(item);
+    }
+  }
+  if (items.isEmpty()) {
+    return false;
+  }
+
+  m_in_place = true;
+  startReading(items);
+  return true;
+}
+
+/*!
+ * \brief Maps the file suffixes handled by plugins to the plugin, the
+ * filters themselves are added to name_filters if it is set.
+ */
+QMap<QString, IEBookInterface*>
+EBookImporter::pluginSuffixes(const QList<IEBookInterface*>& plugins,
+                              QStringList* name_filters)
+{
+  QMap<QString, IEBookInterface*> suffixes;
+  foreach (IEBookInterface* plugin, plugins) {
+    foreach (QString filter, plugin->fileFilter().split(' ')) {
+      // filters are of the form *.epub
+      QString suffix = filter.mid(filter.lastIndexOf('.') + 1).toLower();
+      if (!suffix.isEmpty()) {
+        suffixes.insert(suffix, plugin);
+        if (name_filters) {
+          *name_filters << filter;
+        }
+      }
+    }
+  }
+  return suffixes;
+}
+
+void
+EBookImporter::startReading(const ImportItemList& items)
+{
+  m_cancelled = 0;
+  m_reading = true;
+  m_pending_copies = 0;
+  m_total = items.size();
+  m_done = 0;
+  m_imported = 0;
+  m_skipped = 0;
+  m_needs_attention.clear();
+  m_failed.clear();
+  m_updated.clear();
+
+  emit progress(m_done, m_total);
+  m_read_watcher.setFuture(
+    QtConcurrent::mapped(items, &EBookImporter::readItem));
+}
+
+/*!
+ * \brief Stops the import.
+ *
+ * Books that have already been copied are kept and added to the library,
+ * finished() is still emitted.
+ */
+void
+EBookImporter::cancel()
+{
+  m_cancelled = 1;
+  m_read_watcher.cancel();
+}
+
+bool
+EBookImporter::isRunning() const
+{
+  return (m_reading || m_pending_copies > 0);
+}
+
+/*!
+ * \brief The books found in the last import that have no author.
+ */
+QStringList
+EBookImporter::needsAttention() const
+{
+  return m_needs_attention;
+}
+
+/*!
+ * \brief The books in the last import that could not be read or copied.
+ */
+QStringList
+EBookImporter::failed() const
+{
+  return m_failed;
+}
+
+/*!
+ * \brief The library files added or updated by the last import.
+ */
+QStringList
+EBookImporter::updated() const
+{
+  return m_updated;
+}
+
+/*!
+ * \brief The first stage, run in the global thread pool.
+ */
+EBookImportItem
+EBookImporter::readItem(const EBookImportItem& item)
+{
+  EBookImportItem result = item;
+  result.metadata = item.plugin->readMetadata(item.source);
+  return result;
+}
+
+/*!
+ * \brief The second stage, matches a batch of read books with the authors
+ * and series databases then hands them on to be copied.
+ */
+void
+EBookImporter::resolveItems(int begin, int end)
+{
+  ImportItemList batch;
+  for (int i = begin; i < end; i++) {
+    EBookImportItem item = m_read_watcher.resultAt(i);
+    if (m_cancelled != 0) {
+      break;
+    }
+    if (resolveItem(item)) {
+      batch.append(item);
+    } else {
+      m_done++;
+    }
+  }
+  emit progress(m_done, m_total);
+
+  if (batch.isEmpty()) {
+    return;
+  }
+  if (m_in_place) {
+    for (int i = 0; i < batch.size(); i++) {
+      batch[i].copied = true;
+    }
+    storeItems(batch);
+    return;
+  }
+  QFutureWatcher<ImportItemList>* watcher =
+    new QFutureWatcher<ImportItemList>(this);
+  connect(watcher,
+          &QFutureWatcher<ImportItemList>::finished,
+          this,
+          &EBookImporter::copyFinished);
+  m_pending_copies++;
+  watcher->setFuture(QtConcurrent::run(
+    &m_copy_pool, [this, batch]() { return copyItems(batch); }));
+}
+
+/*!
+ * \brief Resolves the authors, series and library path of a book.
+ *
+ * \return true if the book should be copied, otherwise false.
+ */
+bool
+EBookImporter::resolveItem(EBookImportItem& item)
+{
+  if (item.metadata.isNull()) {
+    QLOG_DEBUG(tr("Unable to read the metadata of %1").arg(item.source));
+    m_failed << item.source;
+    return false;
+  }
+
+  QStringList creators = item.metadata->creatorList();
+  if (creators.isEmpty()) {
+    m_needs_attention << item.source;
+    return false;
+  }
+
+  QStringList names;
+  foreach (QString name, creators) {
+    AuthorData author = m_authors_db->author(name);
+    if (author.isNull()) {
+      author = AuthorData(new EBookAuthorData());
+      author->setDisplayName(name);
+      m_authors_db->insertAuthor(author);
+    }
+    item.authors << author;
+    names << author->displayName();
+  }
+
+  if (m_in_place) {
+    item.destination = item.source;
+    BookData existing = m_library_db->bookByFile(item.source);
+    if (existing.isNull()) {
+      item.book = BookData(new EBookData());
+    } else {
+      // the library keeps its own copy so this does not change it.
+      item.book = BookData(new EBookData(*existing));
+    }
+  } else {
+    QFileInfo info(item.source);
+    QString destination = m_options->libraryDirectory() + QDir::separator() +
+                          "library" + QDir::separator() + names.join(", ");
+    item.destination = destination + QDir::separator() + info.fileName();
+    if (QFile::exists(item.destination) ||
+        !m_library_db->bookByFile(item.destination).isNull()) {
+      // already in the library, only the single book open can overwrite.
+      m_skipped++;
+      return false;
+    }
+    item.book = BookData(new EBookData());
+  }
+
+  OrderedTitleMap titles = item.metadata->orderedTitles();
+  if (!titles.isEmpty() && !titles.first().isNull()) {
+    item.book->title = titles.first()->title;
+  }
+  Calibre calibre = item.metadata->calibre();
+  if (!calibre.isNull() && !calibre->seriesName().isEmpty()) {
+    item.book->series = m_series_db->insertOrGetSeries(calibre->seriesName());
+    item.book->series_index = calibre->seriesIndex();
+  }
+  return true;
+}
+
+/*!
+ * \brief The third stage, copies a batch of books into the library in the
+ * copy thread pool.
+ *
+ * As with a single book an untouched original copy is stored alongside the
+ * library copy.
+ */
+ImportItemList
+EBookImporter::copyItems(ImportItemList items)
+{
+  QDir dir;
+  for (int i = 0; i < items.size(); i++) {
+    if (m_cancelled != 0) {
+      break;
+    }
+    EBookImportItem& item = items[i];
+    QFileInfo info(item.destination);
+    dir.mkpath(info.path());
+    QString original = info.path() + QDir::separator() +
+                       info.completeBaseName() + ".original." + info.suffix();
+    item.copied = QFile::copy(item.source, item.destination);
+    if (item.copied) {
+      QFile::copy(item.source, original);
+    }
+  }
+  return items;
+}
+
+void
+EBookImporter::copyFinished()
+{
+  QFutureWatcher<ImportItemList>* watcher =
+    static_cast<QFutureWatcher<ImportItemList>*>(sender());
+  ImportItemList items = watcher->result();
+  watcher->deleteLater();
+  m_pending_copies--;
+  storeItems(items);
+}
+
+/*!
+ * \brief The last stage, adds the copied books to the library.
+ *
+ * The size and modification time of each file are kept with the book so
+ * that later changes to the file can be noticed.
+ */
+void
+EBookImporter::storeItems(const ImportItemList& items)
+{
+  foreach (EBookImportItem item, items) {
+    m_done++;
+    if (!item.copied) {
+      if (m_cancelled == 0) {
+        m_failed << item.source;
+      }
+      continue;
+    }
+    item.book->filename = item.destination;
+    BookData existing = m_library_db->bookByFile(item.destination);
+    if (item.book->uid == 0 && !existing.isNull()) {
+      // the library watcher found the copy first.
+      item.book->uid = existing->uid;
+    }
+    QFileInfo info(item.destination);
+    qint64 modified = info.lastModified().toMSecsSinceEpoch();
+    if (item.book->file_size != info.size() ||
+        item.book->file_modified != modified) {
+      // worked out again by the duplicate finder.
+      item.book->content_hash.clear();
+    }
+    item.book->file_size = info.size();
+    item.book->file_modified = modified;
+    quint64 uid = m_library_db->insertOrUpdateBook(item.book);
+    foreach (AuthorData author, item.authors) {
+      m_authors_db->addBook(author, uid);
+    }
+    m_updated << item.destination;
+    m_imported++;
+  }
+  emit progress(m_done, m_total);
+  checkFinished();
+}
+
+void
+EBookImporter::readFinished()
+{
+  m_reading = false;
+  checkFinished();
+}
+
+/*!
+ * \brief Saves the databases once every stage has completed.
+ */
+void
+EBookImporter::checkFinished()
+{
+  if (isRunning()) {
+    return;
+  }
+  m_library_db->save();
+  m_authors_db->save();
+  m_series_db->save();
+  emit finished(m_imported, m_skipped);
+}
@@ -0,0 +1,114 @@
+#ifndef EBOOKIMPORTER_H
+#define EBOOKIMPORTER_H
+
+#include <QAtomicInt>
+#include <QFutureWatcher>
+#include <QObject>
+#include <QStringList>
+#include <QThreadPool>
+
+#include "authors.h"
+#include "ebookmetadata.h"
+#include "library.h"
+#include "options.h"
+#include "series.h"
+
+class IEBookInterface;
+
+/*!
+ * \brief A book as it passes through the stages of an EBookImporter.
+ */
+struct EBookImportItem
+{
+  EBookImportItem()
+    : plugin(nullptr)
+    , copied(false)
+  {}
+  QString source;      // the file being imported.
+  QString destination; // the library copy of the file.
+  IEBookInterface* plugin;
+  Metadata metadata;
+  BookData book;
+  AuthorList authors;
+  bool copied;
+};
+typedef QList<EBookImportItem> ImportItemList;
+
+/*!
+ * \brief Imports a directory tree of books into the library.
+ *
+ * The import runs as a pipeline. The metadata of each book is read in
+ * parallel with IEBookInterface::readMetadata(). As each batch of results
+ * arrives the authors and series are resolved against the databases, which
+ * only happens in the thread that owns them, and the books are then copied
+ * into the library directory in the background. The databases are saved
+ * once at the end.
+ *
+ * Books without any author are not copied, they are held in
+ * needsAttention() so that they can be opened one at a time later.
+ *
+ * updateFiles() runs the same pipeline over books that are already in the
+ * library directory, without the copy, to add or refresh them in place.
+ */
+class EBookImporter : public QObject
+{
+  Q_OBJECT
+public:
+  EBookImporter(Options* options,
+                AuthorsDB authors_db,
+                SeriesDB series_db,
+                LibraryDB library_db,
+                QObject* parent = nullptr);
+  ~EBookImporter();
+
+  bool importDirectory(const QString& directory,
+                       const QList<IEBookInterface*>& plugins);
+  bool updateFiles(const QStringList& files,
+                   const QList<IEBookInterface*>& plugins);
+  void cancel();
+  bool isRunning() const;
+
+  QStringList needsAttention() const;
+  QStringList failed() const;
+  QStringList updated() const;
+
+signals:
+  void progress(int value, int total);
+  void finished(int imported, int skipped);
+
+protected:
+  Options* m_options;
+  AuthorsDB m_authors_db;
+  SeriesDB m_series_db;
+  LibraryDB m_library_db;
+
+  QFutureWatcher<EBookImportItem> m_read_watcher;
+  QThreadPool m_copy_pool;
+  QAtomicInt m_cancelled;
+  bool m_reading;
+  bool m_in_place; // the books are already in the library directory.
+  int m_pending_copies;
+  int m_total, m_done, m_imported, m_skipped;
+  QStringList m_needs_attention;
+  QStringList m_failed;
+  QStringList m_updated;
+
+  static QMap<QString, IEBookInterface*> pluginSuffixes(
+    const QList<IEBookInterface*>& plugins,
+    QStringList* name_filters = nullptr);
+  void startReading(const ImportItemList& items);
+  static EBookImportItem readItem(const EBookImportItem& item);
+  ImportItemList copyItems(ImportItemList items);
+
+  void resolveItems(int begin, int end);
+  bool resolveItem(EBookImportItem& item);
+  void readFinished();
+  void copyFinished();
+  void storeItems(const ImportItemList& items);
+  void checkFinished();
+
+  // copies are disk bound so more threads than this do not help.
+  static const int COPY_THREADS = 2;
+};
+
+#endif // EBOOKIMPORTER_H
@@ -0,0 +1,246 @@
+#include "ebookindexer.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QSet>
+#include <QtConcurrent>
+
+#include <qlogger/qlogger.h>
+
+#include "iebookinterface.h"
+
+using namespace qlogger;
+
+const QString EBookIndexer::INDEX_DIRECTORY = "search";
+
+EBookIndexer::EBookIndexer(Options* options,
+                           LibraryDB library_db,
+                           QObject* parent)
+  : QObject(parent)
+  , m_options(options)
+  , m_library_db(library_db)
+  , m_total(0)
+  , m_done(0)
+{
+  connect(&m_read_watcher,
+          &QFutureWatcher<EBookIndexedBook>::resultsReadyAt,
+          this,
+          &EBookIndexer::booksRead);
+  connect(&m_read_watcher,
+          &QFutureWatcher<EBookIndexedBook>::finished,
+          this,
+          &EBookIndexer::readFinished);
+  connect(&m_build_watcher,
+          &QFutureWatcher<EBookIndexedBook>::resultsReadyAt,
+          this,
+          &EBookIndexer::booksBuilt);
+  connect(&m_build_watcher,
+          &QFutureWatcher<EBookIndexedBook>::finished,
+          this,
+          &EBookIndexer::buildFinished);
+}
+
+EBookIndexer::~EBookIndexer()
+{
+  cancel();
+  m_read_watcher.waitForFinished();
+  m_build_watcher.waitForFinished();
+}
+
+/*!
+ * \brief Loads the index and brings it up to date with the library.
+ *
+ * The index files are kept in the search directory of the cache directory.
+ */
+void
+EBookIndexer::start(const QList<IEBookInterface*>& plugins)
+{
+  if (isRunning()) {
+    return;
+  }
+  m_plugins = plugins;
+  m_index.setDirectory(m_options->cacheDirectory() + QDir::separator() +
+                       INDEX_DIRECTORY);
+  m_read_watcher.setFuture(
+    QtConcurrent::mapped(m_index.indexFiles(), &EBookSearchIndex::readBook));
+}
+
+/*!
+ * \brief Indexes a library book again, normally after it has been saved.
+ */
+void
+EBookIndexer::indexBook(const QString& filename)
+{
+  EBookIndexTask task;
+  if (!createTask(m_library_db->bookByFile(filename), task)) {
+    return;
+  }
+  buildBooks(IndexTaskList() << task);
+}
+
+/*!
+ * \brief Removes a book that is no longer in the library.
+ */
+void
+EBookIndexer::removeBook(quint64 uid)
+{
+  m_index.removeBook(uid);
+}
+
+void
+EBookIndexer::cancel()
+{
+  m_queue.clear();
+  m_read_watcher.cancel();
+  m_build_watcher.cancel();
+}
+
+bool
+EBookIndexer::isRunning() const
+{
+  return (m_read_watcher.isRunning() || m_build_watcher.isRunning());
+}
+
+EBookSearchHitList
+EBookIndexer::search(const QString& query, int limit) const
+{
+  return m_index.search(query, limit);
+}
+
+/*!
+ * \brief Indexes a book in the global thread pool and writes its index file.
+ *
+ * \return the book, or a book with a uid of 0 if it could not be read.
+ */
+EBookIndexedBook
+EBookIndexer::buildBook(const EBookIndexTask& task)
+{
+  EBookChapterList chapters = task.plugin->readChapters(task.filename);
+  if (chapters.isEmpty()) {
+    return EBookIndexedBook();
+  }
+  EBookIndexedBook book = EBookSearchIndex::buildBook(
+    task.uid, task.modified, chapters, task.previous);
+  if (!EBookSearchIndex::writeBook(task.directory, book)) {
+    QLOG_DEBUG(tr("Unable to store the search index of %1").arg(task.filename));
+  }
+  return book;
+}
+
+IEBookInterface*
+EBookIndexer::pluginFor(const QString& filename) const
+{
+  QString suffix = QFileInfo(filename).suffix().toLower();
+  foreach (IEBookInterface* plugin, m_plugins) {
+    foreach (QString filter, plugin->fileFilter().split(' ')) {
+      // filters are of the form *.epub
+      if (filter.mid(filter.lastIndexOf('.') + 1).toLower() == suffix) {
+        return plugin;
+      }
+    }
+  }
+  return nullptr;
+}
+
+bool
+EBookIndexer::createTask(BookData book, EBookIndexTask& task) const
+{
+  if (book.isNull() || m_index.directory().isEmpty()) {
+    return false;
+  }
+  QFileInfo info(book->filename);
+  task.plugin = pluginFor(book->filename);
+  if (!info.exists() || !task.plugin) {
+    return false;
+  }
+  task.uid = book->uid;
+  task.filename = book->filename;
+  task.modified = info.lastModified().toMSecsSinceEpoch();
+  task.directory = m_index.directory();
+  return true;
+}
+
+/*!
+ * \brief Indexes tasks in parallel, if a pass is already running they are
+ * queued until it finishes.
+ */
+void
+EBookIndexer::buildBooks(IndexTaskList tasks)
+{
+  if (isRunning()) {
+    m_queue += tasks;
+    return;
+  }
+  if (tasks.isEmpty()) {
+    emit finished();
+    return;
+  }
+  // the previous versions are only fetched now, so that queued books see
+  // the results of the last pass.
+  for (int i = 0; i < tasks.size(); i++) {
+    tasks[i].previous = m_index.book(tasks.at(i).uid);
+  }
+  m_total = tasks.size();
+  m_done = 0;
+  emit progress(m_done, m_total);
+  m_build_watcher.setFuture(
+    QtConcurrent::mapped(tasks, &EBookIndexer::buildBook));
+}
+
+void
+EBookIndexer::booksRead(int begin, int end)
+{
+  for (int i = begin; i < end; i++) {
+    m_index.insertBook(m_read_watcher.resultAt(i));
+  }
+}
+
+/*!
+ * \brief Drops any books that have left the library and indexes those that
+ * are new or have changed.
+ */
+void
+EBookIndexer::readFinished()
+{
+  if (m_read_watcher.isCanceled()) {
+    return;
+  }
+  IndexTaskList tasks;
+  QSet<quint64> library_uids;
+  foreach (BookData book, m_library_db->books()) {
+    library_uids.insert(book->uid);
+    EBookIndexTask task;
+    if (createTask(book, task) && !m_index.isCurrent(task.uid, task.modified)) {
+      tasks.append(task);
+    }
+  }
+  foreach (quint64 uid, m_index.books()) {
+    if (!library_uids.contains(uid)) {
+      m_index.removeBook(uid);
+    }
+  }
+  tasks += m_queue;
+  m_queue.clear();
+  buildBooks(tasks);
+}
+
+void
+EBookIndexer::booksBuilt(int begin, int end)
+{
+  for (int i = begin; i < end; i++) {
+    m_index.insertBook(m_build_watcher.resultAt(i));
+    m_done++;
+  }
+  emit progress(m_done, m_total);
+}
+
+void
+EBookIndexer::buildFinished()
+{
+  if (m_build_watcher.isCanceled()) {
+    return;
+  }
+  IndexTaskList tasks = m_queue;
+  m_queue.clear();
+  buildBooks(tasks);
+}
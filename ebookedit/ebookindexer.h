@@ -0,0 +1,86 @@
+#ifndef EBOOKINDEXER_H
+#define EBOOKINDEXER_H
+
+#include <QFutureWatcher>
+#include <QObject>
+
+#include "library.h"
+#include "options.h"
+#include "searchindex.h"
+
+class IEBookInterface;
+
+/*!
+ * \brief A book waiting to be indexed by an EBookIndexer.
+ */
+struct EBookIndexTask
+{
+  quint64 uid = 0;
+  qint64 modified = 0;
+  QString filename;
+  QString directory; // where the index file is written.
+  IEBookInterface* plugin = nullptr;
+  EBookIndexedBook previous;
+};
+typedef QList<EBookIndexTask> IndexTaskList;
+
+/*!
+ * \brief Keeps the full text search index of the library up to date.
+ *
+ * start() reads the index files in parallel and then indexes, again in
+ * parallel, any library book that is missing from the index or has been
+ * changed since it was indexed. The chapters of each book are read with
+ * IEBookInterface::readChapters(). Books that are saved while Biblos is
+ * running are passed to indexBook(), only their changed chapters are
+ * indexed again.
+ *
+ * The index itself is only touched in the thread that owns the indexer so
+ * search() can be called at any time, books still being indexed are simply
+ * not found.
+ */
+class EBookIndexer : public QObject
+{
+  Q_OBJECT
+public:
+  EBookIndexer(Options* options,
+               LibraryDB library_db,
+               QObject* parent = nullptr);
+  ~EBookIndexer();
+
+  void start(const QList<IEBookInterface*>& plugins);
+  void indexBook(const QString& filename);
+  void removeBook(quint64 uid);
+  void cancel();
+  bool isRunning() const;
+
+  EBookSearchHitList search(const QString& query, int limit = 1000) const;
+
+signals:
+  void progress(int value, int total);
+  void finished();
+
+protected:
+  Options* m_options;
+  LibraryDB m_library_db;
+  EBookSearchIndex m_index;
+  QList<IEBookInterface*> m_plugins;
+
+  QFutureWatcher<EBookIndexedBook> m_read_watcher;
+  QFutureWatcher<EBookIndexedBook> m_build_watcher;
+  IndexTaskList m_queue; // books waiting for the current pass to finish.
+  int m_total, m_done;
+
+  static EBookIndexedBook buildBook(const EBookIndexTask& task);
+  IEBookInterface* pluginFor(const QString& filename) const;
+  bool createTask(BookData book, EBookIndexTask& task) const;
+  void buildBooks(IndexTaskList tasks);
+
+  void booksRead(int begin, int end);
+  void readFinished();
+  void booksBuilt(int begin, int end);
+  void buildFinished();
+
+  static const QString INDEX_DIRECTORY;
+};
+
+#endif // EBOOKINDEXER_H
@@ -0,0 +1,253 @@
+#include "ebooklibrarywatcher.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QtConcurrent>
+
+#include <qlogger/qlogger.h>
+
+#include "ebookimporter.h"
+#include "iebookinterface.h"
+
+using namespace qlogger;
+
+EBookLibraryWatcher::EBookLibraryWatcher(Options* options,
+                                         AuthorsDB authors_db,
+                                         SeriesDB series_db,
+                                         LibraryDB library_db,
+                                         QObject* parent)
+  : QObject(parent)
+  , m_options(options)
+  , m_library_db(library_db)
+  , m_rescan(false)
+{
+  // kept apart from the user's imports so that neither holds up the other.
+  m_importer =
+    new EBookImporter(options, authors_db, series_db, library_db, this);
+  connect(m_importer,
+          &EBookImporter::finished,
+          this,
+          &EBookLibraryWatcher::importFinished);
+
+  m_scan_timer.setInterval(SCAN_INTERVAL);
+  connect(&m_scan_timer, &QTimer::timeout, this, &EBookLibraryWatcher::scan);
+  // a copy touches the directory many times, only scan once it settles.
+  m_change_timer.setSingleShot(true);
+  m_change_timer.setInterval(CHANGE_DELAY);
+  connect(&m_change_timer, &QTimer::timeout, this, &EBookLibraryWatcher::scan);
+  connect(&m_watcher,
+          &QFileSystemWatcher::directoryChanged,
+          &m_change_timer,
+          static_cast<void (QTimer::*)()>(&QTimer::start));
+
+  connect(&m_scan_watcher,
+          &QFutureWatcher<EBookLibraryScan>::finished,
+          this,
+          &EBookLibraryWatcher::scanFinished);
+}
+
+EBookLibraryWatcher::~EBookLibraryWatcher()
+{
+  stop();
+  m_scan_watcher.waitForFinished();
+}
+
+/*!
+ * \brief Starts watching the library directory, the first scan is started
+ * straight away.
+ */
+void
+EBookLibraryWatcher::start(const QList<IEBookInterface*>& plugins)
+{
+  m_plugins = plugins;
+  m_suffixes.clear();
+  foreach (IEBookInterface* plugin, plugins) {
+    foreach (QString filter, plugin->fileFilter().split(' ')) {
+      // filters are of the form *.epub
+      QString suffix = filter.mid(filter.lastIndexOf('.') + 1).toLower();
+      if (!suffix.isEmpty()) {
+        m_suffixes << suffix;
+      }
+    }
+  }
+  m_scan_timer.start();
+  scan();
+}
+
+void
+EBookLibraryWatcher::stop()
+{
+  m_scan_timer.stop();
+  m_change_timer.stop();
+  m_importer->cancel();
+  if (!m_watcher.directories().isEmpty()) {
+    m_watcher.removePaths(m_watcher.directories());
+  }
+}
+
+/*!
+ * \brief Scans the library directory in the background.
+ *
+ * If a scan or an update is already running another scan follows it.
+ */
+void
+EBookLibraryWatcher::scan()
+{
+  if (m_plugins.isEmpty()) {
+    return;
+  }
+  if (m_scan_watcher.isRunning() || m_importer->isRunning()) {
+    m_rescan = true;
+    return;
+  }
+  m_rescan = false;
+  m_scan_watcher.setFuture(QtConcurrent::run(
+    &EBookLibraryWatcher::scanDirectory, libraryPath(), m_suffixes));
+}
+
+/*!
+ * \brief The directory that the books are stored below.
+ */
+QString
+EBookLibraryWatcher::libraryPath() const
+{
+  return m_options->libraryDirectory() + QDir::separator() + "library";
+}
+
+/*!
+ * \brief Finds the book files and directories below directory.
+ *
+ * This runs in a worker thread. Only the directory entries are read, the
+ * untouched ".original" copies kept beside each book are ignored.
+ */
+EBookLibraryScan
+EBookLibraryWatcher::scanDirectory(const QString& directory,
+                                   const QStringList& suffixes)
+{
+  EBookLibraryScan scan;
+  if (!QFileInfo(directory).isDir()) {
+    return scan;
+  }
+  scan.directories << directory;
+  QDirIterator it(directory,
+                  QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot |
+                    QDir::Readable,
+                  QDirIterator::Subdirectories);
+  while (it.hasNext()) {
+    it.next();
+    QFileInfo info = it.fileInfo();
+    if (info.isDir()) {
+      scan.directories << info.filePath();
+      continue;
+    }
+    if (!suffixes.contains(info.suffix().toLower()) ||
+        info.completeBaseName().endsWith(".original")) {
+      continue;
+    }
+    EBookLibraryFile file;
+    file.filename = info.filePath();
+    file.size = info.size();
+    file.modified = info.lastModified().toMSecsSinceEpoch();
+    scan.files << file;
+  }
+  return scan;
+}
+
+/*!
+ * \brief Compares a finished scan with the library.
+ */
+void
+EBookLibraryWatcher::scanFinished()
+{
+  EBookLibraryScan result = m_scan_watcher.result();
+
+  // new directories are watched, those that have gone are dropped by the
+  // QFileSystemWatcher itself.
+  QSet<QString> watched = m_watcher.directories().toSet();
+  QStringList directories;
+  foreach (QString directory, result.directories) {
+    if (!watched.contains(directory)) {
+      directories << directory;
+    }
+  }
+  if (!directories.isEmpty()) {
+    m_watcher.addPaths(directories);
+  }
+
+  qint64 now = QDateTime::currentMSecsSinceEpoch();
+  QSet<QString> found;
+  QStringList changed;
+  bool unsettled = false;
+  foreach (EBookLibraryFile file, result.files) {
+    found.insert(file.filename);
+    if (now - file.modified < SETTLE_TIME) {
+      unsettled = true;
+      continue;
+    }
+    BookData book = m_library_db->bookByFile(file.filename);
+    if (!book.isNull() && book->file_size == file.size &&
+        book->file_modified == file.modified) {
+      continue;
+    }
+    QPair<qint64, qint64> fingerprint(file.size, file.modified);
+    if (m_unreadable.contains(file.filename) &&
+        m_unreadable.value(file.filename) == fingerprint) {
+      continue;
+    }
+    changed << file.filename;
+    m_pending.insert(file.filename, file);
+  }
+
+  QString root = libraryPath() + QDir::separator();
+  QList<quint64> removed;
+  foreach (BookData book, m_library_db->books()) {
+    if (book->filename.startsWith(root) && !found.contains(book->filename) &&
+        !QFile::exists(book->filename)) {
+      m_library_db->removeBook(book->uid);
+      removed << book->uid;
+    }
+  }
+  if (!removed.isEmpty()) {
+    QLOG_DEBUG(tr("%1 books no longer in the library directory")
+                 .arg(removed.size()));
+    m_library_db->save();
+    emit booksRemoved(removed);
+  }
+
+  if (!changed.isEmpty() && !m_importer->updateFiles(changed, m_plugins)) {
+    m_pending.clear();
+  }
+  if (unsettled) {
+    m_change_timer.start();
+  }
+  if (m_rescan && !m_importer->isRunning()) {
+    scan();
+  }
+}
+
+/*!
+ * \brief Remembers the files that could not be read and reports those that
+ * were added or updated.
+ */
+void
+EBookLibraryWatcher::importFinished()
+{
+  foreach (QString filename,
+           m_importer->failed() + m_importer->needsAttention()) {
+    EBookLibraryFile file = m_pending.value(filename);
+    m_unreadable.insert(filename, qMakePair(file.size, file.modified));
+  }
+  m_pending.clear();
+
+  QStringList updated = m_importer->updated();
+  if (!updated.isEmpty()) {
+    emit booksUpdated(updated);
+  }
+  if (m_rescan) {
+    scan();
+  }
+}
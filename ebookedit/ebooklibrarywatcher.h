@@ -0,0 +1,102 @@
+#ifndef EBOOKLIBRARYWATCHER_H
+#define EBOOKLIBRARYWATCHER_H
+
+#include <QFileSystemWatcher>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QObject>
+#include <QPair>
+#include <QStringList>
+#include <QTimer>
+
+#include "authors.h"
+#include "library.h"
+#include "options.h"
+#include "series.h"
+
+class IEBookInterface;
+class EBookImporter;
+
+/*!
+ * \brief A book file found by an EBookLibraryWatcher scan.
+ */
+struct EBookLibraryFile
+{
+  QString filename;
+  qint64 size = 0;
+  qint64 modified = 0; // ms since the epoch.
+};
+typedef QList<EBookLibraryFile> LibraryFileList;
+
+/*!
+ * \brief The result of one scan of the library directory.
+ */
+struct EBookLibraryScan
+{
+  LibraryFileList files;
+  QStringList directories;
+};
+
+/*!
+ * \brief Keeps the library in step with the books in the library directory.
+ *
+ * The directory is scanned in the background, which only reads the size
+ * and modification time of each file. A file whose size or time differ
+ * from those stored with its book, or that has no book, has its metadata
+ * read by its own EBookImporter with EBookImporter::updateFiles(). Books
+ * whose files have gone are removed from the library.
+ *
+ * The directories are watched with a QFileSystemWatcher so that a change
+ * is scanned for shortly after it happens, there is also a scan every few
+ * minutes as the watcher can miss changes. Files changed within the last
+ * couple of seconds are left to the next scan, they may still be being
+ * written.
+ */
+class EBookLibraryWatcher : public QObject
+{
+  Q_OBJECT
+public:
+  EBookLibraryWatcher(Options* options,
+                      AuthorsDB authors_db,
+                      SeriesDB series_db,
+                      LibraryDB library_db,
+                      QObject* parent = nullptr);
+  ~EBookLibraryWatcher();
+
+  void start(const QList<IEBookInterface*>& plugins);
+  void stop();
+  void scan();
+
+signals:
+  void booksUpdated(const QStringList& files);
+  void booksRemoved(const QList<quint64>& uids);
+
+protected:
+  Options* m_options;
+  LibraryDB m_library_db;
+  EBookImporter* m_importer;
+  QList<IEBookInterface*> m_plugins;
+  QStringList m_suffixes;
+  QFileSystemWatcher m_watcher;
+  QTimer m_scan_timer;
+  QTimer m_change_timer;
+  QFutureWatcher<EBookLibraryScan> m_scan_watcher;
+  bool m_rescan;
+  // the files handed to the importer.
+  QHash<QString, EBookLibraryFile> m_pending;
+  // the size and time of files that could not be read, they are not tried
+  // again until they change.
+  QHash<QString, QPair<qint64, qint64>> m_unreadable;
+
+  QString libraryPath() const;
+  static EBookLibraryScan scanDirectory(const QString& directory,
+                                        const QStringList& suffixes);
+  void scanFinished();
+  void importFinished();
+
+  static const int SCAN_INTERVAL = 5 * 60 * 1000;
+  static const int CHANGE_DELAY = 2000;
+  static const int SETTLE_TIME = 2000;
+};
+
+#endif // EBOOKLIBRARYWATCHER_H
@@ -0,0 +1,211 @@
+#include "ebookmetadatabatch.h"
+
+#include <functional>
+
+#include <QFileInfo>
+#include <QtConcurrent>
+
+#include <qlogger/qlogger.h>
+
+#include "ebooktypesniffer.h"
+#include "iebookinterface.h"
+
+using namespace qlogger;
+
+EBookMetadataBatch::EBookMetadataBatch(AuthorsDB authors_db,
+                                       SeriesDB series_db,
+                                       LibraryDB library_db,
+                                       QObject* parent)
+  : QObject(parent)
+  , m_authors_db(authors_db)
+  , m_series_db(series_db)
+  , m_library_db(library_db)
+  , m_total(0)
+  , m_done(0)
+{
+  connect(&m_watcher,
+          &QFutureWatcher<EBookBatchItem>::resultsReadyAt,
+          this,
+          &EBookMetadataBatch::itemsReady);
+  connect(&m_watcher,
+          &QFutureWatcher<EBookBatchItem>::finished,
+          this,
+          &EBookMetadataBatch::writeFinished);
+}
+
+EBookMetadataBatch::~EBookMetadataBatch()
+{
+  cancel();
+  m_watcher.waitForFinished();
+}
+
+/*!
+ * \brief Starts applying edit to the library books uids.
+ *
+ * \return false if a batch is already running or there is nothing to do,
+ *         otherwise true in which case finished() will be emitted.
+ */
+bool
+EBookMetadataBatch::start(const QList<quint64>& uids,
+                          const EBookMetadataEdit& edit,
+                          const QList<IEBookInterface*>& plugins)
+{
+  if (isRunning() || edit.isEmpty()) {
+    return false;
+  }
+  BatchItemList items;
+  foreach (quint64 uid, uids) {
+    BookData book = m_library_db->bookByUid(uid);
+    if (!book.isNull()) {
+      EBookBatchItem item;
+      item.uid = uid;
+      item.filename = book->filename;
+      items << item;
+    }
+  }
+  if (items.isEmpty()) {
+    return false;
+  }
+
+  m_cancelled = 0;
+  m_edit = edit;
+  m_total = items.size();
+  m_done = 0;
+  m_failed.clear();
+  m_updated.clear();
+  emit progress(m_done, m_total);
+
+  // the files are sniffed on the workers as well.
+  EBookTypeSniffer sniffer(plugins);
+  QAtomicInt* cancelled = &m_cancelled;
+  std::function<EBookBatchItem(const EBookBatchItem&)> worker =
+    [sniffer, edit, cancelled](const EBookBatchItem& item) {
+      EBookBatchItem result = item;
+      if (*cancelled != 0) {
+        return result;
+      }
+      result.plugin = sniffer.plugin(item.filename);
+      if (result.plugin) {
+        result.written =
+          result.plugin->writeMetadata(item.filename, edit, result.metadata);
+      }
+      return result;
+    };
+  m_watcher.setFuture(QtConcurrent::mapped(items, worker));
+  return true;
+}
+
+/*!
+ * \brief Stops the batch, the books already written are kept and stored in
+ * the library, finished() is still emitted.
+ */
+void
+EBookMetadataBatch::cancel()
+{
+  m_cancelled = 1;
+  m_watcher.cancel();
+}
+
+bool
+EBookMetadataBatch::isRunning() const
+{
+  return m_watcher.isRunning();
+}
+
+/*!
+ * \brief The books of the last batch that could not be written.
+ */
+QStringList
+EBookMetadataBatch::failed() const
+{
+  return m_failed;
+}
+
+/*!
+ * \brief The books written by the last batch.
+ */
+QStringList
+EBookMetadataBatch::updated() const
+{
+  return m_updated;
+}
+
+void
+EBookMetadataBatch::itemsReady(int begin, int end)
+{
+  for (int i = begin; i < end; i++) {
+    storeItem(m_watcher.resultAt(i));
+  }
+  emit progress(m_done, m_total);
+}
+
+/*
+ * Brings the library records of a written book up to date, on the thread
+ * that owns the databases.
+ */
+void
+EBookMetadataBatch::storeItem(const EBookBatchItem& item)
+{
+  m_done++;
+  if (!item.written || item.metadata.isNull()) {
+    if (m_cancelled == 0) {
+      QLOG_DEBUG(
+        tr("Unable to write the metadata of %1").arg(item.filename));
+      m_failed << item.filename;
+    }
+    return;
+  }
+  BookData existing = m_library_db->bookByUid(item.uid);
+  if (existing.isNull()) {
+    return;
+  }
+  // the library keeps its own copy so this does not change it.
+  BookData book = BookData(new EBookData(*existing));
+  if (m_edit.set_series) {
+    book->series = (m_edit.series.isEmpty()
+                      ? 0
+                      : m_series_db->insertOrGetSeries(m_edit.series));
+    if (book->series == 0) {
+      book->series_index.clear();
+    }
+  }
+  QFileInfo info(item.filename);
+  book->file_size = info.size();
+  book->file_modified = info.lastModified().toMSecsSinceEpoch();
+  // worked out again by the duplicate finder.
+  book->content_hash.clear();
+  m_library_db->insertOrUpdateBook(book);
+
+  QStringList creators = item.metadata->creatorList();
+  QMap<QString, QString>::const_iterator it = m_edit.creators.constBegin();
+  for (; it != m_edit.creators.constEnd(); ++it) {
+    if (!creators.contains(it.value())) {
+      continue;
+    }
+    AuthorData old_author = m_authors_db->author(it.key());
+    if (!old_author.isNull()) {
+      m_authors_db->removeAuthorBook(old_author, item.uid);
+    }
+    AuthorData author = m_authors_db->author(it.value());
+    if (author.isNull()) {
+      author = AuthorData(new EBookAuthorData());
+      author->setDisplayName(it.value());
+      m_authors_db->insertAuthor(author);
+    }
+    m_authors_db->addBook(author, item.uid);
+  }
+  m_updated << item.filename;
+}
+
+/*!
+ * \brief Saves the databases, committing every change of the batch at
+ * once.
+ */
+void
+EBookMetadataBatch::writeFinished()
+{
+  m_library_db->save();
+  m_authors_db->save();
+  m_series_db->save();
+  emit finished(m_updated.size(), m_failed.size());
+}
@@ -0,0 +1,83 @@
+#ifndef EBOOKMETADATABATCH_H
+#define EBOOKMETADATABATCH_H
+
+#include <QAtomicInt>
+#include <QFutureWatcher>
+#include <QObject>
+#include <QStringList>
+
+#include "authors.h"
+#include "ebookmetadata.h"
+#include "library.h"
+#include "series.h"
+
+class IEBookInterface;
+
+/*!
+ * \brief A book as it passes through an EBookMetadataBatch.
+ */
+struct EBookBatchItem
+{
+  quint64 uid = 0;
+  QString filename;
+  IEBookInterface* plugin = nullptr;
+  Metadata metadata; // as written, null until the book has been written.
+  bool written = false;
+};
+typedef QList<EBookBatchItem> BatchItemList;
+
+/*!
+ * \brief Makes one metadata change to many library books in the
+ * background.
+ *
+ * Each book is rewritten in the global thread pool with
+ * IEBookInterface::writeMetadata(), which only replaces the metadata of
+ * the book. As the books are written their library, author and series
+ * records are updated on the thread that owns the databases, and the
+ * databases are saved once at the end, so every change to them is
+ * committed in a single transaction.
+ *
+ * A book that cannot be written is added to failed() and the rest carry
+ * on, nothing is asked while the batch runs.
+ */
+class EBookMetadataBatch : public QObject
+{
+  Q_OBJECT
+public:
+  EBookMetadataBatch(AuthorsDB authors_db,
+                     SeriesDB series_db,
+                     LibraryDB library_db,
+                     QObject* parent = nullptr);
+  ~EBookMetadataBatch();
+
+  bool start(const QList<quint64>& uids,
+             const EBookMetadataEdit& edit,
+             const QList<IEBookInterface*>& plugins);
+  void cancel();
+  bool isRunning() const;
+
+  QStringList failed() const;
+  QStringList updated() const;
+
+signals:
+  void progress(int value, int total);
+  void finished(int updated, int failed);
+
+protected:
+  AuthorsDB m_authors_db;
+  SeriesDB m_series_db;
+  LibraryDB m_library_db;
+
+  QFutureWatcher<EBookBatchItem> m_watcher;
+  QAtomicInt m_cancelled;
+  EBookMetadataEdit m_edit;
+  int m_total, m_done;
+  QStringList m_failed;
+  QStringList m_updated;
+
+  void itemsReady(int begin, int end);
+  void storeItem(const EBookBatchItem& item);
+  void writeFinished();
+};
+
+#endif // EBOOKMETADATABATCH_H
@@ -0,0 +1,35 @@
+#include "ebooknamecompleter.h"
+
+/*!
+ * \brief Constructs a completer and sets it as the completer of edit, the
+ * edit is its parent.
+ */
+EBookNameCompleter::EBookNameCompleter(QLineEdit* edit,
+                                       Lookup lookup,
+                                       int limit)
+  : QCompleter(edit)
+  , m_model(new QStringListModel(this))
+  , m_lookup(lookup)
+  , m_limit(limit)
+{
+  setModel(m_model);
+  // the model only holds matches, there is nothing left to filter.
+  setCompletionMode(QCompleter::UnfilteredPopupCompletion);
+  setCaseSensitivity(Qt::CaseInsensitive);
+  edit->setCompleter(this);
+  connect(edit,
+          &QLineEdit::textEdited,
+          this,
+          &EBookNameCompleter::textEdited);
+}
+
+void
+EBookNameCompleter::textEdited(const QString& text)
+{
+  m_model->setStringList(m_lookup(text, m_limit));
+  if (m_model->rowCount() == 0) {
+    popup()->hide();
+  } else {
+    complete();
+  }
+}
@@ -0,0 +1,35 @@
+#ifndef EBOOKNAMECOMPLETER_H
+#define EBOOKNAMECOMPLETER_H
+
+#include <functional>
+
+#include <QCompleter>
+#include <QLineEdit>
+#include <QStringListModel>
+
+/*!
+ * \brief Completes a line edit from a name index.
+ *
+ * Rather than filtering a model of every name, the model only ever holds
+ * the few names that the lookup returns for the text typed, see
+ * EBookNameIndex::complete(), so a keystroke costs a binary search however
+ * many authors or series the library has.
+ */
+class EBookNameCompleter : public QCompleter
+{
+  Q_OBJECT
+public:
+  // the names starting with a prefix, at most limit of them.
+  typedef std::function<QStringList(const QString& prefix, int limit)> Lookup;
+
+  EBookNameCompleter(QLineEdit* edit, Lookup lookup, int limit);
+
+protected:
+  QStringListModel* m_model;
+  Lookup m_lookup;
+  int m_limit;
+
+  void textEdited(const QString& text);
+};
+
+#endif // EBOOKNAMECOMPLETER_H
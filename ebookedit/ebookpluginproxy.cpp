@@ -0,0 +1,283 @@
+#include "ebookpluginproxy.h"
+
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QMutexLocker>
+
+#include <qlogger/qlogger.h>
+
+using namespace qlogger;
+
+EBookPluginLoader::EBookPluginLoader(const QString& path, Options* options)
+  : m_loader(new QPluginLoader(path))
+  , m_options(options)
+  , m_instance(nullptr)
+{
+  m_metadata = m_loader->metaData().value("MetaData").toObject();
+}
+
+EBookPluginLoader::~EBookPluginLoader()
+{
+  // the plugin stays loaded for the life of the application.
+  delete m_loader;
+}
+
+/*!
+ * \brief true if the file is a plugin whose metadata names it.
+ */
+bool
+EBookPluginLoader::isValid() const
+{
+  return !value("name").isEmpty();
+}
+
+/*!
+ * \brief The contents of the plugin's json file.
+ */
+QJsonObject
+EBookPluginLoader::metaData() const
+{
+  return m_metadata;
+}
+
+QString
+EBookPluginLoader::value(const QString& key) const
+{
+  return m_metadata.value(key).toString();
+}
+
+QString
+EBookPluginLoader::errorString() const
+{
+  return m_loader->errorString();
+}
+
+/*!
+ * \brief Sets the options handed to a book or spelling plugin, now if it
+ * is loaded or else when it is.
+ */
+void
+EBookPluginLoader::setOptions(Options* options)
+{
+  QMutexLocker locker(&m_mutex);
+  m_options = options;
+  if (m_instance) {
+    setPluginOptions(m_instance);
+  }
+}
+
+/*
+ * Book plugins and spelling plugins both take the options.
+ */
+void
+EBookPluginLoader::setPluginOptions(QObject* plugin)
+{
+  IEBookInterface* ebook = dynamic_cast<IEBookInterface*>(plugin);
+  if (ebook) {
+    ebook->setOptions(m_options);
+  }
+  ISpellInterface* spell = dynamic_cast<ISpellInterface*>(plugin);
+  if (spell) {
+    spell->setOptions(m_options);
+  }
+}
+
+bool
+EBookPluginLoader::isLoaded() const
+{
+  QMutexLocker locker(&m_mutex);
+  return (m_instance != nullptr);
+}
+
+/*!
+ * \brief The plugin, loaded and set up the first time this is called.
+ *
+ * \return the plugin or nullptr if it could not be loaded.
+ */
+QObject*
+EBookPluginLoader::instance()
+{
+  QMutexLocker locker(&m_mutex);
+  if (m_instance) {
+    return m_instance;
+  }
+  QObject* plugin = m_loader->instance();
+  IPluginInterface* interface = dynamic_cast<IPluginInterface*>(plugin);
+  if (!interface) {
+    QLOG_DEBUG(QCoreApplication::translate("EBookPluginLoader",
+                                           "Plugin error : %1")
+                 .arg(m_loader->errorString()))
+    return nullptr;
+  }
+  if (plugin->thread() != QCoreApplication::instance()->thread()) {
+    // first needed by a worker thread, documents are made on the gui thread.
+    plugin->moveToThread(QCoreApplication::instance()->thread());
+  }
+  setPluginOptions(plugin);
+  interface->buildMenu();
+  interface->setLoaded(true);
+  m_instance = plugin;
+  return m_instance;
+}
+
+EBookPluginProxy::EBookPluginProxy(EBookPluginLoader* loader)
+  : PluginProxy<IEBookInterface>(loader)
+  , m_type(UNSUPPORTED_TYPE)
+{
+  QString type = m_loader->value("type");
+  if (type == "EPUB") {
+    m_type = EPUB;
+  } else if (type == "MOBI") {
+    m_type = MOBI;
+  } else if (type == "AZW") {
+    m_type = AZW;
+  } else if (type == "PDF") {
+    m_type = PDF;
+  }
+
+  QJsonArray signatures = m_loader->metaData().value("signatures").toArray();
+  foreach (QJsonValue value, signatures) {
+    QJsonObject object = value.toObject();
+    EBookSignature signature;
+    signature.offset = object.value("offset").toInt();
+    signature.magic = object.value("magic").toString().toLatin1();
+    if (!signature.magic.isEmpty()) {
+      m_signatures.append(signature);
+    }
+  }
+}
+
+/*!
+ * \brief The plugin itself, loading it if this is the first time it has
+ * been needed.
+ */
+IEBookInterface*
+EBookPluginProxy::plugin() const
+{
+  return dynamic_cast<IEBookInterface*>(m_loader->instance());
+}
+
+IEBookDocument*
+EBookPluginProxy::createDocument(QString filename)
+{
+  IEBookInterface* ebook = plugin();
+  return (ebook ? ebook->createDocument(filename) : nullptr);
+}
+
+IEBookDocument*
+EBookPluginProxy::createCodeDocument()
+{
+  IEBookInterface* ebook = plugin();
+  return (ebook ? ebook->createCodeDocument() : nullptr);
+}
+
+QString
+EBookPluginProxy::fileFilter()
+{
+  return m_loader->value("fileFilter");
+}
+
+QString
+EBookPluginProxy::fileDescription()
+{
+  return m_loader->value("fileDescription");
+}
+
+EBookDocumentType
+EBookPluginProxy::type() const
+{
+  return m_type;
+}
+
+EBookSignatureList
+EBookPluginProxy::signatures() const
+{
+  return m_signatures;
+}
+
+Metadata
+EBookPluginProxy::readMetadata(const QString& path)
+{
+  IEBookInterface* ebook = plugin();
+  return (ebook ? ebook->readMetadata(path) : Metadata());
+}
+
+EBookChapterList
+EBookPluginProxy::readChapters(const QString& path)
+{
+  IEBookInterface* ebook = plugin();
+  return (ebook ? ebook->readChapters(path) : EBookChapterList());
+}
+
+bool
+EBookPluginProxy::parsesInBackground() const
+{
+  IEBookInterface* ebook = plugin();
+  return (ebook ? ebook->parsesInBackground() : false);
+}
+
+QObject*
+EBookPluginProxy::parseDocument(const QString& path, QThread* thread)
+{
+  IEBookInterface* ebook = plugin();
+  return (ebook ? ebook->parseDocument(path, thread) : nullptr);
+}
+
+IEBookDocument*
+EBookPluginProxy::createParsedDocument(QObject* parsed)
+{
+  IEBookInterface* ebook = plugin();
+  return (ebook ? ebook->createParsedDocument(parsed) : nullptr);
+}
+
+QImage
+EBookPluginProxy::readCover(const QString& path, const QSize& size)
+{
+  IEBookInterface* ebook = plugin();
+  return (ebook ? ebook->readCover(path, size) : QImage());
+}
+
+bool
+EBookPluginProxy::verifyBook(const QString& path, QStringList& problems)
+{
+  IEBookInterface* ebook = plugin();
+  return (ebook ? ebook->verifyBook(path, problems) : false);
+}
+
+bool
+EBookPluginProxy::resaveBook(const QString& path,
+                             const QString& save_path,
+                             QStringList& problems)
+{
+  IEBookInterface* ebook = plugin();
+  return (ebook ? ebook->resaveBook(path, save_path, problems) : false);
+}
+
+bool
+EBookPluginProxy::readContent(const QString& path, EBookContent& content)
+{
+  IEBookInterface* ebook = plugin();
+  return (ebook ? ebook->readContent(path, content) : false);
+}
+
+bool
+EBookPluginProxy::writeContent(const EBookContent& content, const QString& path)
+{
+  IEBookInterface* ebook = plugin();
+  return (ebook ? ebook->writeContent(content, path) : false);
+}
+
+bool
+EBookPluginProxy::compareBooks(const QString& original,
+                               const QString& changed,
+                               EBookComparison& comparison)
+{
+  IEBookInterface* ebook = plugin();
+  return (ebook ? ebook->compareBooks(original, changed, comparison) : false);
+}
+
+void
+EBookPluginProxy::setOptions(Options* options)
+{
+  m_loader->setOptions(options);
+}
@@ -0,0 +1,129 @@
+#ifndef EBOOKPLUGINPROXY_H
+#define EBOOKPLUGINPROXY_H
+
+#include <QJsonObject>
+#include <QMutex>
+#include <QPluginLoader>
+
+#include "iebookinterface.h"
+#include "ispellinterface.h"
+
+/*!
+ * \brief A plugin in the plugins directory, known only from the metadata
+ * compiled into it until it is first used.
+ *
+ * The metadata, the plugin's json file, is read with
+ * QPluginLoader::metaData() which does not load the library. instance()
+ * loads it and creates the plugin the first time it is called, from any
+ * thread, and the plugin is then moved to the gui thread.
+ */
+class EBookPluginLoader
+{
+public:
+  EBookPluginLoader(const QString& path, Options* options);
+  ~EBookPluginLoader();
+
+  bool isValid() const;
+  QJsonObject metaData() const;
+  QString value(const QString& key) const;
+  QString errorString() const;
+  void setOptions(Options* options);
+
+  bool isLoaded() const;
+  QObject* instance();
+
+protected:
+  QPluginLoader* m_loader;
+  QJsonObject m_metadata;
+  Options* m_options;
+  QObject* m_instance;
+  mutable QMutex m_mutex;
+
+  void setPluginOptions(QObject* plugin);
+};
+
+/*!
+ * \brief Stands in for a plugin of type Interface, answering the
+ * IPluginInterface methods from the metadata so that listing the plugins
+ * loads none of them.
+ */
+template<class Interface>
+class PluginProxy : public Interface
+{
+public:
+  explicit PluginProxy(EBookPluginLoader* loader)
+    : m_loader(loader)
+  {}
+  ~PluginProxy() { delete m_loader; }
+
+  EBookPluginLoader* loader() const { return m_loader; }
+
+  QString pluginGroup() const override { return m_loader->value("group"); }
+  QString pluginName() const override { return m_loader->value("name"); }
+  QString vendor() const override { return m_loader->value("vendor"); }
+  bool loaded() const override { return m_loader->isLoaded(); }
+  // loaded() follows the plugin itself.
+  void setLoaded(bool) override {}
+  QString version() const override { return m_loader->value("version"); }
+  int majorVersion() const override { return versionPart(0); }
+  int minorVersion() const override { return versionPart(1); }
+  int buildVersion() const override { return versionPart(2); }
+  // the plugin builds its menu when it is loaded.
+  void buildMenu() override {}
+
+protected:
+  EBookPluginLoader* m_loader;
+
+  int versionPart(int index) const
+  {
+    return version().section('.', index, index).toInt();
+  }
+};
+
+typedef PluginProxy<IPluginInterface> EBookOtherPluginProxy;
+
+/*!
+ * \brief Stands in for a book plugin.
+ *
+ * The file filter, description, type and signatures come from the
+ * metadata, so building the file dialog filters and sniffing book types
+ * do not load the plugin. Anything that reads or opens a book loads it.
+ */
+class EBookPluginProxy : public PluginProxy<IEBookInterface>
+{
+public:
+  explicit EBookPluginProxy(EBookPluginLoader* loader);
+
+  IEBookInterface* plugin() const;
+
+  IEBookDocument* createDocument(QString filename) override;
+  IEBookDocument* createCodeDocument() override;
+
+  QString fileFilter() override;
+  QString fileDescription() override;
+  EBookDocumentType type() const override;
+  EBookSignatureList signatures() const override;
+
+  Metadata readMetadata(const QString& path) override;
+  EBookChapterList readChapters(const QString& path) override;
+  bool parsesInBackground() const override;
+  QObject* parseDocument(const QString& path, QThread* thread) override;
+  IEBookDocument* createParsedDocument(QObject* parsed) override;
+  QImage readCover(const QString& path, const QSize& size) override;
+  bool verifyBook(const QString& path, QStringList& problems) override;
+  bool resaveBook(const QString& path,
+                  const QString& save_path,
+                  QStringList& problems) override;
+  bool readContent(const QString& path, EBookContent& content) override;
+  bool writeContent(const EBookContent& content, const QString& path) override;
+  bool compareBooks(const QString& original,
+                    const QString& changed,
+                    EBookComparison& comparison) override;
+  void setOptions(Options* options) override;
+
+protected:
+  EBookDocumentType m_type;
+  EBookSignatureList m_signatures;
+};
+
+#endif // EBOOKPLUGINPROXY_H
@@ -0,0 +1,160 @@
+#include "ebookprofileoverlay.h"
+
+#include <QEvent>
+#include <QPainter>
+
+EBookProfileOverlay::EBookProfileOverlay(QAbstractScrollArea* editor,
+                                         const QList<Row>& rows,
+                                         const QByteArray& counted_scope)
+  : QWidget(editor)
+  , m_editor(editor)
+  , m_rows(rows)
+  , m_counted_scope(counted_scope)
+  , m_previous(EBookTrace::threadTotals())
+  , m_frame(rows.size(), 0)
+  , m_peak(rows.size(), 0)
+  , m_window_peak(rows.size(), 0)
+  , m_frame_count(0)
+  , m_edit_count(0)
+  , m_edited(false)
+{
+  // an opaque overlay does not make the viewport below it paint again,
+  // which would make another frame.
+  setAutoFillBackground(true);
+  setAttribute(Qt::WA_TransparentForMouseEvents);
+  QFont small = font();
+  small.setPointSize(qMax(small.pointSize() - 2, 6));
+  setFont(small);
+
+  m_window.start();
+  m_editor->installEventFilter(this);
+  reposition();
+}
+
+/*!
+ * \brief Takes the time spent in each of the scopes since the last frame,
+ * to be called by the editor once it has painted.
+ */
+void
+EBookProfileOverlay::frameFinished()
+{
+  EBookTraceTotals totals = EBookTrace::threadTotals();
+  for (int i = 0; i < m_rows.size(); i++) {
+    const QByteArray& scope = m_rows.at(i).scope;
+    m_frame[i] =
+      totals.value(scope).duration - m_previous.value(scope).duration;
+    m_window_peak[i] = qMax(m_window_peak.at(i), m_frame.at(i));
+  }
+  if (!m_counted_scope.isEmpty()) {
+    m_frame_count = totals.value(m_counted_scope).count -
+                    m_previous.value(m_counted_scope).count;
+    if (m_edited) {
+      m_edit_count = m_frame_count;
+      m_edited = false;
+    }
+  }
+  m_previous = totals;
+
+  if (m_window.elapsed() > PEAK_WINDOW) {
+    m_peak = m_window_peak;
+    m_window_peak.fill(0);
+    m_window.restart();
+  }
+  reposition();
+  update();
+}
+
+/*!
+ * \brief Marks the next frame as the one that shows an edit, the counted
+ * scope of that frame being shown until the following edit.
+ */
+void
+EBookProfileOverlay::documentEdited()
+{
+  m_edited = true;
+}
+
+bool
+EBookProfileOverlay::eventFilter(QObject* watched, QEvent* event)
+{
+  if (watched == m_editor && event->type() == QEvent::Resize) {
+    reposition();
+  }
+  return QWidget::eventFilter(watched, event);
+}
+
+void
+EBookProfileOverlay::paintEvent(QPaintEvent* /*event*/)
+{
+  QPainter painter(this);
+  painter.setPen(Qt::darkGray);
+  painter.drawRect(rect().adjusted(0, 0, -1, -1));
+
+  QFontMetrics metrics = fontMetrics();
+  int line = metrics.lineSpacing();
+  int value_width = metrics.horizontalAdvance(QStringLiteral("0000.00 ms"));
+  int label_width = width() - 2 * value_width - 4 * MARGIN;
+  int y = MARGIN;
+
+  painter.setPen(palette().color(QPalette::WindowText));
+  for (int i = 0; i < m_rows.size(); i++) {
+    QRect label(MARGIN, y, label_width, line);
+    QRect frame(label.right() + MARGIN, y, value_width, line);
+    QRect peak(frame.right() + MARGIN, y, value_width, line);
+    painter.drawText(label, Qt::AlignLeft, m_rows.at(i).label);
+    painter.drawText(frame, Qt::AlignRight, milliseconds(m_frame.at(i)));
+    painter.drawText(peak,
+                     Qt::AlignRight,
+                     milliseconds(qMax(m_peak.at(i), m_window_peak.at(i))));
+    y += line;
+  }
+  if (!m_counted_scope.isEmpty()) {
+    painter.drawText(QRect(MARGIN, y, width() - 2 * MARGIN, line),
+                     Qt::AlignLeft,
+                     tr("Blocks highlighted by the last edit: %1")
+                       .arg(m_edit_count));
+  }
+}
+
+/*
+ * Keeps the overlay in the top right corner of the viewport, sized to its
+ * rows, whatever the size of the editor.
+ */
+void
+EBookProfileOverlay::reposition()
+{
+  QFontMetrics metrics = fontMetrics();
+  int label_width = 0;
+  foreach (const Row& row, m_rows) {
+    label_width = qMax(label_width, metrics.horizontalAdvance(row.label));
+  }
+  int value_width = metrics.horizontalAdvance(QStringLiteral("0000.00 ms"));
+  int overlay_width = label_width + 2 * value_width + 4 * MARGIN;
+  int lines = m_rows.size();
+  if (!m_counted_scope.isEmpty()) {
+    lines++;
+    overlay_width = qMax(
+      overlay_width,
+      metrics.horizontalAdvance(
+        tr("Blocks highlighted by the last edit: %1").arg(99999)) +
+        2 * MARGIN);
+  }
+  QSize size(overlay_width, lines * metrics.lineSpacing() + 2 * MARGIN);
+  if (this->size() != size) {
+    resize(size);
+  }
+
+  QRect viewport = m_editor->viewport()->geometry();
+  QPoint position(viewport.right() - size.width() - MARGIN,
+                  viewport.top() + MARGIN);
+  if (pos() != position) {
+    move(position);
+  }
+  raise();
+}
+
+QString
+EBookProfileOverlay::milliseconds(qint64 microseconds)
+{
+  return tr("%1 ms").arg(microseconds / 1000.0, 0, 'f', 2);
+}
@@ -0,0 +1,65 @@
+#ifndef EBOOKPROFILEOVERLAY_H
+#define EBOOKPROFILEOVERLAY_H
+
+#include <QAbstractScrollArea>
+#include <QElapsedTimer>
+#include <QList>
+#include <QVector>
+#include <QWidget>
+
+#include "ebooktrace.h"
+
+/*!
+ * \brief A developer overlay in the corner of an editor showing where the
+ * time of each frame went.
+ *
+ * Each row is a traced scope, EBOOK_TRACE_SCOPE(), shown as the time spent
+ * in it since the previous frame and the most spent in any one frame over
+ * the last PEAK_WINDOW. The figures are the differences between the
+ * EBookTrace::threadTotals() at the end of one frame, frameFinished(), and
+ * the next, so the overlay costs nothing until tracing is built in and it
+ * is shown.
+ *
+ * If a counted scope is given, XhtmlHighlighter::highlightBlock for the
+ * code editor, the number of times it ran in the frame that followed the
+ * last edit is shown too, which for the highlighter is the number of
+ * blocks that the edit had highlighted again.
+ */
+class EBookProfileOverlay : public QWidget
+{
+  Q_OBJECT
+public:
+  struct Row
+  {
+    QString label;
+    QByteArray scope;
+  };
+
+  EBookProfileOverlay(QAbstractScrollArea* editor,
+                      const QList<Row>& rows,
+                      const QByteArray& counted_scope = QByteArray());
+
+  void frameFinished();
+  void documentEdited();
+
+  static const int PEAK_WINDOW = 1000; // ms.
+
+protected:
+  QAbstractScrollArea* m_editor;
+  QList<Row> m_rows;
+  QByteArray m_counted_scope;
+  EBookTraceTotals m_previous;
+  QVector<qint64> m_frame, m_peak, m_window_peak; // microseconds.
+  QElapsedTimer m_window;
+  qint64 m_frame_count, m_edit_count;
+  bool m_edited;
+
+  bool eventFilter(QObject* watched, QEvent* event) override;
+  void paintEvent(QPaintEvent* event) override;
+  void reposition();
+  static QString milliseconds(qint64 microseconds);
+
+  static const int MARGIN = 4;
+};
+
+#endif // EBOOKPROFILEOVERLAY_H
@@ -0,0 +1,433 @@
+#include "ebooksourcemap.h"
+
+#include <algorithm>
+
+#include "xhtmltokenizer.h"
+
+namespace {
+
+/* Characters that the layout adds to the text without any xhtml text of
+ * their own, the break between two blocks or an image for instance. */
+inline bool
+isLayoutGap(QChar c)
+{
+  return c.isSpace() || c == QChar::ObjectReplacementCharacter;
+}
+
+} // end of anonymous namespace
+
+EBookSourceMap::EBookSourceMap()
+  : m_text_changed_start(-1)
+  , m_text_changed_end(-1)
+  , m_source_changed_start(-1)
+  , m_source_changed_end(-1)
+{}
+
+/*!
+ * \brief Matches the whole of the text of a chapter against its xhtml.
+ *
+ * \param source the xhtml of the chapter.
+ * \param text the plain text of the document made from it, as given by
+ *        QTextDocument::toPlainText(), which has one character for each
+ *        position in the document.
+ */
+void
+EBookSourceMap::build(const QString& source, const QString& text)
+{
+  clear();
+  align(QStringView(source), 0, QStringView(text), 0, m_spans);
+}
+
+void
+EBookSourceMap::clear()
+{
+  m_spans.clear();
+  m_text_changed_start = m_text_changed_end = -1;
+  m_source_changed_start = m_source_changed_end = -1;
+}
+
+bool
+EBookSourceMap::isEmpty() const
+{
+  return m_spans.isEmpty();
+}
+
+/*!
+ * \brief The xhtml offset of a document position.
+ *
+ * A position between two spans, at the break between two paragraphs for
+ * instance, is placed at the end of the text before it, or within a
+ * break, at the start of the text after it.
+ */
+int
+EBookSourceMap::sourcePosition(int text_position) const
+{
+  if (m_spans.isEmpty()) {
+    return 0;
+  }
+  SourceSpans::const_iterator it = std::upper_bound(
+    m_spans.constBegin(),
+    m_spans.constEnd(),
+    text_position,
+    [](int position, const EBookSourceSpan& span) {
+      return position < span.text_start;
+    });
+  if (it == m_spans.constBegin()) {
+    return it->source_start;
+  }
+  const EBookSourceSpan& span = *(it - 1);
+  if (text_position < span.textEnd()) {
+    return (span.isPlain() ? span.source_start + text_position -
+                               span.text_start
+                           : span.source_start);
+  }
+  if (text_position == span.textEnd() || it == m_spans.constEnd()) {
+    return span.sourceEnd();
+  }
+  return it->source_start;
+}
+
+/*!
+ * \brief The document position of an xhtml offset.
+ *
+ * Offsets within markup are placed as sourcePosition() places positions
+ * between spans.
+ */
+int
+EBookSourceMap::textPosition(int source_position) const
+{
+  if (m_spans.isEmpty()) {
+    return 0;
+  }
+  SourceSpans::const_iterator it = std::upper_bound(
+    m_spans.constBegin(),
+    m_spans.constEnd(),
+    source_position,
+    [](int position, const EBookSourceSpan& span) {
+      return position < span.source_start;
+    });
+  if (it == m_spans.constBegin()) {
+    return it->text_start;
+  }
+  const EBookSourceSpan& span = *(it - 1);
+  if (source_position < span.sourceEnd()) {
+    return (span.isPlain() ? span.text_start + source_position -
+                               span.source_start
+                           : span.text_start);
+  }
+  if (source_position == span.sourceEnd() || it == m_spans.constEnd()) {
+    return span.textEnd();
+  }
+  return it->text_start;
+}
+
+/*!
+ * \brief The xhtml that a range of the document came from.
+ */
+QPair<int, int>
+EBookSourceMap::sourceRange(int text_start, int text_end) const
+{
+  return qMakePair(sourcePosition(text_start), sourcePosition(text_end));
+}
+
+/*!
+ * \brief Follows an edit of the document, as reported by
+ * QTextDocument::contentsChange().
+ */
+void
+EBookSourceMap::textChanged(int position, int removed, int added)
+{
+  changed(true, position, removed, added);
+}
+
+/*!
+ * \brief Follows an edit of the xhtml.
+ */
+void
+EBookSourceMap::sourceChanged(int position, int removed, int added)
+{
+  changed(false, position, removed, added);
+}
+
+bool
+EBookSourceMap::hasChanges() const
+{
+  return (m_text_changed_start >= 0 || m_source_changed_start >= 0);
+}
+
+/*!
+ * \brief The range of the document changed since the map was built, or
+ * (-1, -1).
+ */
+QPair<int, int>
+EBookSourceMap::changedText() const
+{
+  return qMakePair(m_text_changed_start, m_text_changed_end);
+}
+
+/*!
+ * \brief The range of the xhtml changed since the map was built, or
+ * (-1, -1).
+ */
+QPair<int, int>
+EBookSourceMap::changedSource() const
+{
+  return qMakePair(m_source_changed_start, m_source_changed_end);
+}
+
+/*!
+ * \brief Matches the changed ranges of the text and the xhtml again.
+ *
+ * Only the part between the last span before the changes and the first
+ * span after them is gone over, the rest of the map is kept.
+ */
+void
+EBookSourceMap::remap(const QString& source, const QString& text)
+{
+  if (!hasChanges()) {
+    return;
+  }
+  if (m_spans.isEmpty()) {
+    build(source, text);
+    return;
+  }
+
+  int count = m_spans.size();
+  int first = 0;
+  while (first < count) {
+    const EBookSourceSpan& span = m_spans.at(first);
+    if ((m_text_changed_start >= 0 &&
+         span.textEnd() > m_text_changed_start) ||
+        (m_source_changed_start >= 0 &&
+         span.sourceEnd() > m_source_changed_start)) {
+      break;
+    }
+    first++;
+  }
+  int last = count;
+  while (last > first) {
+    const EBookSourceSpan& span = m_spans.at(last - 1);
+    if ((m_text_changed_start >= 0 &&
+         span.text_start < m_text_changed_end) ||
+        (m_source_changed_start >= 0 &&
+         span.source_start < m_source_changed_end)) {
+      break;
+    }
+    last--;
+  }
+
+  int text_from = (first > 0 ? m_spans.at(first - 1).textEnd() : 0);
+  int text_to = (last < count ? m_spans.at(last).text_start : text.size());
+  int source_from = (first > 0 ? m_spans.at(first - 1).sourceEnd() : 0);
+  int source_to =
+    (last < count ? m_spans.at(last).source_start : source.size());
+  text_to = qBound(text_from, text_to, text.size());
+  source_to = qBound(source_from, source_to, source.size());
+
+  SourceSpans spans = m_spans.mid(0, first);
+  align(QStringView(source).mid(source_from, source_to - source_from),
+        source_from,
+        QStringView(text).mid(text_from, text_to - text_from),
+        text_from,
+        spans);
+  spans += m_spans.mid(last);
+  m_spans = spans;
+
+  m_text_changed_start = m_text_changed_end = -1;
+  m_source_changed_start = m_source_changed_end = -1;
+}
+
+/*
+ * Spans after the edit are moved, those that it touches are cut back to
+ * the parts either side of it, and the changed range grows to hold it.
+ */
+void
+EBookSourceMap::changed(bool text, int position, int removed, int added)
+{
+  int end = position + removed;
+  int delta = added - removed;
+
+  SourceSpans spans;
+  spans.reserve(m_spans.size() + 1);
+  foreach (EBookSourceSpan span, m_spans) {
+    int& start = (text ? span.text_start : span.source_start);
+    int length = (text ? span.text_length : span.source_length);
+    if (start + length <= position) {
+      spans.append(span);
+      continue;
+    }
+    if (start >= end) {
+      start += delta;
+      spans.append(span);
+      continue;
+    }
+    if (!span.isPlain()) {
+      // an entity that has been edited.
+      continue;
+    }
+    int before = position - start;
+    if (before > 0) {
+      EBookSourceSpan head = span;
+      head.text_length = head.source_length = before;
+      spans.append(head);
+    }
+    int after = start + length - end;
+    if (after > 0) {
+      int cut = length - after;
+      EBookSourceSpan tail = span;
+      tail.text_start += cut;
+      tail.source_start += cut;
+      tail.text_length = tail.source_length = after;
+      (text ? tail.text_start : tail.source_start) += delta;
+      spans.append(tail);
+    }
+  }
+  m_spans = spans;
+
+  int& changed_start = (text ? m_text_changed_start : m_source_changed_start);
+  int& changed_end = (text ? m_text_changed_end : m_source_changed_end);
+  if (changed_start < 0) {
+    changed_start = position;
+    changed_end = position + added;
+    return;
+  }
+  auto moved = [=](int offset) {
+    if (offset >= end) {
+      return offset + delta;
+    }
+    return (offset > position ? position + added : offset);
+  };
+  changed_start = qMin(moved(changed_start), position);
+  changed_end = qMax(moved(changed_end), position + added);
+}
+
+/*
+ * Walks the text and entity tokens of the xhtml alongside the text. White
+ * space in the xhtml may have been collapsed or dropped, and the text may
+ * hold block breaks and images that have no xhtml text, so both are
+ * skipped over until the next matching character. Markup is skipped.
+ */
+void
+EBookSourceMap::align(QStringView source,
+                      int source_offset,
+                      QStringView text,
+                      int text_offset,
+                      SourceSpans& spans)
+{
+  XhtmlTokenizer tokenizer(source);
+  int text_length = int(text.size());
+  int t = 0;
+
+  while (!tokenizer.atEnd() && t < text_length) {
+    XhtmlToken token = tokenizer.next();
+    if (token.type == XhtmlToken::TEXT) {
+      for (int i = token.start; i < token.end() && t < text_length; i++) {
+        QChar c = source.at(i);
+        if (c.isSpace()) {
+          if (text.at(t).isSpace()) {
+            addSpan(spans, text_offset + t, source_offset + i, 1);
+            t++;
+            // the rest of the run of white space was collapsed.
+            while (i + 1 < token.end() && source.at(i + 1).isSpace()) {
+              i++;
+            }
+          }
+          continue;
+        }
+        while (t < text_length && text.at(t) != c && isLayoutGap(text.at(t))) {
+          t++;
+        }
+        if (t < text_length && text.at(t) == c) {
+          addSpan(spans, text_offset + t, source_offset + i, 1);
+          t++;
+        }
+      }
+
+    } else if (token.type == XhtmlToken::ENTITY) {
+      QChar c = decodeEntity(token.text);
+      if (c.isNull()) {
+        continue;
+      }
+      if (c == QChar::Nbsp) {
+        // toPlainText() gives a plain space.
+        c = QLatin1Char(' ');
+      }
+      while (t < text_length && text.at(t) != c && isLayoutGap(text.at(t))) {
+        t++;
+      }
+      if (t < text_length && text.at(t) == c) {
+        addSpan(
+          spans, text_offset + t, source_offset + token.start, token.length);
+        t++;
+      }
+    }
+  }
+}
+
+/*
+ * A character of plain text that follows on from the last span extends it.
+ */
+void
+EBookSourceMap::addSpan(SourceSpans& spans,
+                        int text_start,
+                        int source_start,
+                        int source_length)
+{
+  if (source_length == 1 && !spans.isEmpty()) {
+    EBookSourceSpan& last = spans.last();
+    if (last.isPlain() && last.textEnd() == text_start &&
+        last.sourceEnd() == source_start) {
+      last.text_length++;
+      last.source_length++;
+      return;
+    }
+  }
+  EBookSourceSpan span;
+  span.text_start = text_start;
+  span.text_length = 1;
+  span.source_start = source_start;
+  span.source_length = source_length;
+  spans.append(span);
+}
+
+/*
+ * Only the character references and the named entities of xml, plus
+ * &nbsp;, are known. Anything else, or a character outside the BMP, gives
+ * a null QChar and is left out of the map.
+ */
+QChar
+EBookSourceMap::decodeEntity(QStringView entity)
+{
+  if (entity.size() < 3 || entity.at(0) != '&' ||
+      entity.at(entity.size() - 1) != ';') {
+    return QChar();
+  }
+  QStringView name = entity.mid(1, entity.size() - 2);
+  if (name.at(0) == '#') {
+    bool ok = false;
+    uint code;
+    if (name.size() > 1 && (name.at(1) == 'x' || name.at(1) == 'X')) {
+      code = name.mid(2).toString().toUInt(&ok, 16);
+    } else {
+      code = name.mid(1).toString().toUInt(&ok, 10);
+    }
+    if (!ok || code == 0 || code > 0xFFFF) {
+      return QChar();
+    }
+    return QChar(ushort(code));
+  }
+  if (XhtmlTokenizer::equals(name, QLatin1String("amp"))) {
+    return QLatin1Char('&');
+  } else if (XhtmlTokenizer::equals(name, QLatin1String("lt"))) {
+    return QLatin1Char('<');
+  } else if (XhtmlTokenizer::equals(name, QLatin1String("gt"))) {
+    return QLatin1Char('>');
+  } else if (XhtmlTokenizer::equals(name, QLatin1String("quot"))) {
+    return QLatin1Char('"');
+  } else if (XhtmlTokenizer::equals(name, QLatin1String("apos"))) {
+    return QLatin1Char('\'');
+  } else if (XhtmlTokenizer::equals(name, QLatin1String("nbsp"))) {
+    return QChar(QChar::Nbsp);
+  }
+  return QChar();
+}
@@ -0,0 +1,79 @@
+#ifndef EBOOKSOURCEMAP_H
+#define EBOOKSOURCEMAP_H
+
+#include <QPair>
+#include <QString>
+#include <QStringView>
+#include <QVector>
+
+/*!
+ * \brief A run of the document text and the xhtml it came from.
+ *
+ * Plain text is matched a character at a time, so both lengths are the
+ * same. An entity, &amp; for instance, is one character of text and
+ * several of xhtml.
+ */
+struct EBookSourceSpan
+{
+  int text_start = 0;
+  int text_length = 0;
+  int source_start = 0;
+  int source_length = 0;
+
+  int textEnd() const { return text_start + text_length; }
+  int sourceEnd() const { return source_start + source_length; }
+  bool isPlain() const { return text_length == source_length; }
+};
+typedef QVector<EBookSourceSpan> SourceSpans;
+
+/*!
+ * \brief Maps positions in the book editor's QTextDocument to offsets in
+ * the xhtml of the chapter, the document_string of its manifest item,
+ * and back.
+ *
+ * The map is built once for a chapter with build(). Edits in either view
+ * are then passed to textChanged() or sourceChanged(), which only move or
+ * cut the spans around the edit and remember the range that changed.
+ * remap() later matches just that range again, so keeping the two views in
+ * step never needs the whole chapter to be gone over.
+ */
+class EBookSourceMap
+{
+public:
+  EBookSourceMap();
+
+  void build(const QString& source, const QString& text);
+  void clear();
+  bool isEmpty() const;
+
+  int sourcePosition(int text_position) const;
+  int textPosition(int source_position) const;
+  QPair<int, int> sourceRange(int text_start, int text_end) const;
+
+  void textChanged(int position, int removed, int added);
+  void sourceChanged(int position, int removed, int added);
+  bool hasChanges() const;
+  QPair<int, int> changedText() const;
+  QPair<int, int> changedSource() const;
+  void remap(const QString& source, const QString& text);
+
+protected:
+  SourceSpans m_spans;
+  // the ranges changed since the map was last built, -1 if none.
+  int m_text_changed_start, m_text_changed_end;
+  int m_source_changed_start, m_source_changed_end;
+
+  void changed(bool text, int position, int removed, int added);
+  static void align(QStringView source,
+                    int source_offset,
+                    QStringView text,
+                    int text_offset,
+                    SourceSpans& spans);
+  static void addSpan(SourceSpans& spans,
+                      int text_start,
+                      int source_start,
+                      int source_length);
+  static QChar decodeEntity(QStringView entity);
+};
+
+#endif // EBOOKSOURCEMAP_H
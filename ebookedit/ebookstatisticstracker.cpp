@@ -0,0 +1,300 @@
+#include "ebookstatisticstracker.h"
+
+EBookStatisticsTracker::EBookStatisticsTracker(QObject* parent)
+  : QObject(parent)
+  , m_document(nullptr)
+  , m_chapter(0)
+  , m_changing_chapter(false)
+  , m_words(0)
+  , m_characters(0)
+{
+  m_timer.setSingleShot(true);
+  m_timer.setInterval(0);
+  connect(&m_timer,
+          &QTimer::timeout,
+          this,
+          &EBookStatisticsTracker::countNextChapter);
+}
+
+EBookStatisticsTracker::~EBookStatisticsTracker() {}
+
+/*!
+ * \brief Counts a newly opened book, the chapter shown at once and the
+ * others from the event loop.
+ */
+void
+EBookStatisticsTracker::setDocument(ITextDocument* document)
+{
+  if (m_document) {
+    disconnect(m_document, nullptr, this, nullptr);
+  }
+  m_timer.stop();
+  m_chapters.clear();
+  m_blocks.clear();
+  m_vocabulary.clear();
+  m_uncounted.clear();
+  m_words = 0;
+  m_characters = 0;
+  m_changing_chapter = false;
+  m_document = document;
+  if (!m_document) {
+    emit statisticsChanged();
+    return;
+  }
+
+  m_chapters.resize(qMax(1, m_document->chapterCount()));
+  m_chapter = qBound(0, m_document->currentChapter(), m_chapters.size() - 1);
+  connect(m_document,
+          &QTextDocument::contentsChange,
+          this,
+          &EBookStatisticsTracker::contentsChange);
+  connect(m_document,
+          &ITextDocument::chapterAboutToChange,
+          this,
+          &EBookStatisticsTracker::chapterAboutToChange);
+  connect(m_document,
+          &ITextDocument::chapterChanged,
+          this,
+          &EBookStatisticsTracker::chapterChanged);
+  connect(m_document,
+          &ITextDocument::chapterSourceChanged,
+          this,
+          &EBookStatisticsTracker::chapterSourceChanged);
+
+  countDocument();
+  for (int i = 0; i < m_chapters.size(); i++) {
+    if (i != m_chapter) {
+      m_uncounted.append(i);
+    }
+  }
+  if (!m_uncounted.isEmpty()) {
+    m_timer.start();
+  }
+}
+
+/*!
+ * \brief The statistics of the whole book, those of chapters not yet
+ * counted are missing until isComplete().
+ */
+EBookStatistics
+EBookStatisticsTracker::bookStatistics() const
+{
+  EBookStatistics statistics;
+  statistics.words = m_words;
+  statistics.characters = m_characters;
+  statistics.unique_words = m_vocabulary.size();
+  statistics.chapters = m_chapters.size();
+  return statistics;
+}
+
+/*!
+ * \brief The statistics of the chapter shown.
+ */
+EBookStatistics
+EBookStatisticsTracker::chapterStatistics() const
+{
+  EBookStatistics statistics;
+  if (m_chapter < m_chapters.size()) {
+    const EBookChapterCount& chapter = m_chapters.at(m_chapter);
+    statistics.words = chapter.words;
+    statistics.characters = chapter.characters;
+    statistics.unique_words = chapter.vocabulary.size();
+    statistics.chapters = 1;
+  }
+  return statistics;
+}
+
+/*!
+ * \brief true once every chapter has been counted.
+ */
+bool
+EBookStatisticsTracker::isComplete() const
+{
+  return (m_document && m_uncounted.isEmpty() && !m_chapters.isEmpty());
+}
+
+/*
+ * The blocks before and after the change are untouched, so the difference
+ * in the number of blocks gives how many of the old blocks were replaced
+ * by the blocks now holding the change.
+ */
+void
+EBookStatisticsTracker::contentsChange(int position,
+                                       int /*removed*/,
+                                       int added)
+{
+  if (m_changing_chapter) {
+    return;
+  }
+  QTextBlock first = m_document->findBlock(position);
+  QTextBlock last = m_document->findBlock(position + added);
+  if (!last.isValid()) {
+    last = m_document->lastBlock();
+  }
+  int first_number = first.blockNumber();
+  int old_last =
+    last.blockNumber() - (m_document->blockCount() - m_blocks.size());
+  if (!first.isValid() || old_last < first_number ||
+      old_last >= m_blocks.size()) {
+    // not in step with the document, which should not happen.
+    countDocument();
+    return;
+  }
+
+  EBookChapterCount& chapter = m_chapters[m_chapter];
+  for (int i = first_number; i <= old_last; i++) {
+    remove(chapter, m_blocks.at(i));
+  }
+  m_blocks.remove(first_number, old_last - first_number + 1);
+  int index = first_number;
+  for (QTextBlock block = first; block.isValid(); block = block.next()) {
+    EBookTextCount count = blockCount(block);
+    add(chapter, count);
+    m_blocks.insert(index++, count);
+    if (block == last) {
+      break;
+    }
+  }
+  emit statisticsChanged();
+}
+
+/*
+ * The contents are replaced by the new chapter in between, which is
+ * counted once it is shown. The counts of the chapter left are kept.
+ */
+void
+EBookStatisticsTracker::chapterAboutToChange(int /*index*/)
+{
+  m_changing_chapter = true;
+}
+
+void
+EBookStatisticsTracker::chapterChanged(int index)
+{
+  m_changing_chapter = false;
+  if (index >= m_chapters.size()) {
+    m_chapters.resize(index + 1);
+  }
+  m_chapter = qMax(0, index);
+  m_uncounted.removeAll(m_chapter);
+  countDocument();
+}
+
+/*
+ * A chapter that is not shown is counted again from its new xhtml, the
+ * chapter shown is loaded again so is counted from the document.
+ */
+void
+EBookStatisticsTracker::chapterSourceChanged(int index)
+{
+  if (index == m_chapter || index >= m_chapters.size() ||
+      m_uncounted.contains(index)) {
+    return;
+  }
+  m_uncounted.append(index);
+  m_timer.start();
+}
+
+/*
+ * Counts the chapter shown from the blocks of the document.
+ */
+void
+EBookStatisticsTracker::countDocument()
+{
+  clearChapter(m_chapter);
+  m_blocks.clear();
+  m_blocks.reserve(m_document->blockCount());
+  EBookChapterCount& chapter = m_chapters[m_chapter];
+  for (QTextBlock block = m_document->begin(); block.isValid();
+       block = block.next()) {
+    EBookTextCount count = blockCount(block);
+    add(chapter, count);
+    m_blocks.append(count);
+  }
+  chapter.counted = true;
+  emit statisticsChanged();
+}
+
+/*
+ * Counts one chapter that is not shown from its xhtml, then comes back
+ * for the next from the event loop.
+ */
+void
+EBookStatisticsTracker::countNextChapter()
+{
+  if (!m_document || m_uncounted.isEmpty()) {
+    return;
+  }
+  int index = m_uncounted.takeFirst();
+  if (index != m_chapter) {
+    clearChapter(index);
+    EBookChapterCount& chapter = m_chapters[index];
+    QString text =
+      EBookStatistics::xhtmlText(m_document->chapterSourceAt(index));
+    add(chapter, EBookStatistics::countText(text));
+    chapter.counted = true;
+    emit statisticsChanged();
+  }
+  if (!m_uncounted.isEmpty()) {
+    m_timer.start();
+  }
+}
+
+/*
+ * Takes the counts of a chapter out of the book's.
+ */
+void
+EBookStatisticsTracker::clearChapter(int index)
+{
+  EBookChapterCount& chapter = m_chapters[index];
+  m_words -= chapter.words;
+  m_characters -= chapter.characters;
+  QHash<QString, int>::const_iterator it = chapter.vocabulary.constBegin();
+  for (; it != chapter.vocabulary.constEnd(); ++it) {
+    QHash<QString, int>::iterator used = m_vocabulary.find(it.key());
+    if (used != m_vocabulary.end() && (used.value() -= it.value()) <= 0) {
+      m_vocabulary.erase(used);
+    }
+  }
+  chapter = EBookChapterCount();
+}
+
+void
+EBookStatisticsTracker::add(EBookChapterCount& chapter,
+                            const EBookTextCount& count)
+{
+  chapter.words += count.words;
+  chapter.characters += count.characters;
+  m_words += count.words;
+  m_characters += count.characters;
+  foreach (const QString& word, count.vocabulary) {
+    chapter.vocabulary[word]++;
+    m_vocabulary[word]++;
+  }
+}
+
+void
+EBookStatisticsTracker::remove(EBookChapterCount& chapter,
+                               const EBookTextCount& count)
+{
+  chapter.words -= count.words;
+  chapter.characters -= count.characters;
+  m_words -= count.words;
+  m_characters -= count.characters;
+  foreach (const QString& word, count.vocabulary) {
+    QHash<QString, int>::iterator it = chapter.vocabulary.find(word);
+    if (it != chapter.vocabulary.end() && --it.value() <= 0) {
+      chapter.vocabulary.erase(it);
+    }
+    it = m_vocabulary.find(word);
+    if (it != m_vocabulary.end() && --it.value() <= 0) {
+      m_vocabulary.erase(it);
+    }
+  }
+}
+
+EBookTextCount
+EBookStatisticsTracker::blockCount(const QTextBlock& block) const
+{
+  return EBookStatistics::countText(block.text());
+}
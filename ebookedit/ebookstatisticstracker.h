@@ -0,0 +1,78 @@
+#ifndef EBOOKSTATISTICSTRACKER_H
+#define EBOOKSTATISTICSTRACKER_H
+
+#include <QHash>
+#include <QObject>
+#include <QStringList>
+#include <QTextBlock>
+#include <QTimer>
+#include <QVector>
+
+#include "ebookstatistics.h"
+#include "iebookdocument.h"
+
+/*!
+ * \brief The counts of one chapter of a book.
+ */
+struct EBookChapterCount
+{
+  qint64 words = 0;
+  qint64 characters = 0;
+  QHash<QString, int> vocabulary; // word -> times used in the chapter.
+  bool counted = false;
+};
+
+/*!
+ * \brief Keeps the statistics of an open book up to date as it is edited.
+ *
+ * The chapter shown is counted a block at a time and the count of each
+ * block is kept, so an edit, seen through QTextDocument::contentsChange(),
+ * only recounts the blocks it touched and the book's totals and vocabulary
+ * are corrected by the difference. The chapters that are not shown are
+ * counted once from their xhtml, one chapter per pass of the event loop,
+ * and again only if their xhtml is replaced.
+ *
+ * Nothing here walks the whole book after it has been counted once, so the
+ * status bar can show the statistics on every keystroke.
+ */
+class EBookStatisticsTracker : public QObject
+{
+  Q_OBJECT
+public:
+  explicit EBookStatisticsTracker(QObject* parent = nullptr);
+  ~EBookStatisticsTracker();
+
+  void setDocument(ITextDocument* document);
+
+  EBookStatistics bookStatistics() const;
+  EBookStatistics chapterStatistics() const;
+  bool isComplete() const;
+
+signals:
+  void statisticsChanged();
+
+protected:
+  ITextDocument* m_document;
+  int m_chapter;
+  bool m_changing_chapter; // between chapterAboutToChange and chapterChanged.
+  QVector<EBookChapterCount> m_chapters;
+  QVector<EBookTextCount> m_blocks; // of the chapter shown.
+  QHash<QString, int> m_vocabulary; // word -> times used in the book.
+  qint64 m_words;
+  qint64 m_characters;
+  QList<int> m_uncounted; // the chapters still to count from their xhtml.
+  QTimer m_timer;
+
+  void contentsChange(int position, int removed, int added);
+  void chapterAboutToChange(int index);
+  void chapterChanged(int index);
+  void chapterSourceChanged(int index);
+  void countDocument();
+  void countNextChapter();
+  void clearChapter(int index);
+  void add(EBookChapterCount& chapter, const EBookTextCount& count);
+  void remove(EBookChapterCount& chapter, const EBookTextCount& count);
+  EBookTextCount blockCount(const QTextBlock& block) const;
+};
+
+#endif // EBOOKSTATISTICSTRACKER_H
@@ -0,0 +1,200 @@
+#include "ebookthumbnailcache.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QPixmapCache>
+#include <QSaveFile>
+#include <QUrl>
+#include <QtConcurrent>
+
+#include <qlogger/qlogger.h>
+
+#include "iebookinterface.h"
+
+using namespace qlogger;
+
+const QString EBookThumbnailCache::THUMBNAIL_DIRECTORY = "thumbnails/normal";
+
+EBookThumbnailCache::EBookThumbnailCache(Options* options,
+                                         LibraryDB library_db,
+                                         QObject* parent)
+  : QObject(parent)
+  , m_options(options)
+  , m_library_db(library_db)
+{
+  // kept apart from the global pool so that indexing does not hold up the
+  // covers that are being looked at.
+  m_pool.setMaxThreadCount(MAX_JOBS);
+}
+
+EBookThumbnailCache::~EBookThumbnailCache()
+{
+  m_queue.clear();
+  m_pool.waitForDone();
+}
+
+void
+EBookThumbnailCache::setPlugins(const QList<IEBookInterface*>& plugins)
+{
+  m_plugins = plugins;
+}
+
+/*!
+ * \brief Returns the thumbnail of a library book.
+ *
+ * \return the thumbnail, or a null pixmap if it is not yet available, in
+ *         which case thumbnailReady() will be emitted if the book has a
+ *         cover.
+ */
+QPixmap
+EBookThumbnailCache::thumbnail(quint64 uid)
+{
+  QPixmap pixmap;
+  if (QPixmapCache::find(cacheKey(uid), &pixmap)) {
+    return pixmap;
+  }
+  if (!m_no_cover.contains(uid) && !m_running.contains(uid)) {
+    m_queue.removeOne(uid);
+    m_queue.prepend(uid);
+    while (m_queue.size() > MAX_QUEUED) {
+      m_queue.removeLast();
+    }
+    startNext();
+  }
+  return pixmap;
+}
+
+/*!
+ * \brief Forgets the thumbnail of a book that has been changed, it is built
+ * again the next time it is needed.
+ */
+void
+EBookThumbnailCache::removeThumbnail(quint64 uid)
+{
+  QPixmapCache::remove(cacheKey(uid));
+  m_no_cover.remove(uid);
+}
+
+/*!
+ * \brief Reads a thumbnail from disk, or builds it from the book cover if
+ * it is missing or out of date.
+ *
+ * This runs in a worker thread so only works with QImage.
+ */
+EBookThumbnail
+EBookThumbnailCache::loadThumbnail(const EBookThumbnailTask& task)
+{
+  EBookThumbnail thumbnail;
+  thumbnail.uid = task.uid;
+
+  QString mtime = QString::number(
+    QFileInfo(task.filename).lastModified().toMSecsSinceEpoch() / 1000);
+  QString name = QString("%1-%2.png").arg(task.uid).arg(mtime);
+  QDir dir(task.directory);
+  QString path = dir.filePath(name);
+
+  if (thumbnail.image.load(path, "PNG") &&
+      thumbnail.image.text("Thumb::MTime") == mtime) {
+    return thumbnail;
+  }
+
+  thumbnail.image = task.plugin->readCover(
+    task.filename, QSize(THUMBNAIL_SIZE, THUMBNAIL_SIZE));
+  if (thumbnail.image.isNull()) {
+    return thumbnail;
+  }
+  thumbnail.image.setText("Thumb::URI",
+                          QUrl::fromLocalFile(task.filename).toString());
+  thumbnail.image.setText("Thumb::MTime", mtime);
+
+  // a thumbnail of an earlier version of the book is no longer needed.
+  dir.mkpath(".");
+  foreach (QString old,
+           dir.entryList(QStringList() << QString("%1-*.png").arg(task.uid),
+                         QDir::Files)) {
+    dir.remove(old);
+  }
+  QSaveFile file(path);
+  if (!file.open(QIODevice::WriteOnly) ||
+      !thumbnail.image.save(&file, "PNG") || !file.commit()) {
+    QLOG_DEBUG(QString("Unable to store thumbnail %1").arg(path));
+  }
+  return thumbnail;
+}
+
+IEBookInterface*
+EBookThumbnailCache::pluginFor(const QString& filename) const
+{
+  QString suffix = QFileInfo(filename).suffix().toLower();
+  foreach (IEBookInterface* plugin, m_plugins) {
+    foreach (QString filter, plugin->fileFilter().split(' ')) {
+      // filters are of the form *.epub
+      if (filter.mid(filter.lastIndexOf('.') + 1).toLower() == suffix) {
+        return plugin;
+      }
+    }
+  }
+  return nullptr;
+}
+
+/*!
+ * \brief Starts the books at the front of the queue until every job slot
+ * is in use.
+ */
+void
+EBookThumbnailCache::startNext()
+{
+  while (m_running.size() < MAX_JOBS && !m_queue.isEmpty()) {
+    quint64 uid = m_queue.takeFirst();
+    BookData book = m_library_db->bookByUid(uid);
+    EBookThumbnailTask task;
+    task.uid = uid;
+    if (!book.isNull()) {
+      task.filename = book->filename;
+      task.plugin = pluginFor(book->filename);
+    }
+    if (!task.plugin || !QFileInfo::exists(task.filename)) {
+      m_no_cover.insert(uid);
+      continue;
+    }
+    task.directory = m_options->cacheDirectory() + QDir::separator() +
+                     THUMBNAIL_DIRECTORY;
+
+    QFutureWatcher<EBookThumbnail>* watcher =
+      new QFutureWatcher<EBookThumbnail>(this);
+    connect(watcher,
+            &QFutureWatcher<EBookThumbnail>::finished,
+            this,
+            [this, watcher]() { thumbnailLoaded(watcher); });
+    m_running.insert(uid);
+    watcher->setFuture(
+      QtConcurrent::run(&m_pool, &EBookThumbnailCache::loadThumbnail, task));
+  }
+}
+
+/*!
+ * \brief Moves a finished thumbnail into the QPixmapCache, pixmaps can only
+ * be created in the GUI thread.
+ */
+void
+EBookThumbnailCache::thumbnailLoaded(QFutureWatcher<EBookThumbnail>* watcher)
+{
+  EBookThumbnail thumbnail = watcher->result();
+  watcher->deleteLater();
+  m_running.remove(thumbnail.uid);
+
+  if (thumbnail.image.isNull()) {
+    m_no_cover.insert(thumbnail.uid);
+  } else {
+    QPixmapCache::insert(cacheKey(thumbnail.uid),
+                         QPixmap::fromImage(thumbnail.image));
+    emit thumbnailReady(thumbnail.uid);
+  }
+  startNext();
+}
+
+QString
+EBookThumbnailCache::cacheKey(quint64 uid)
+{
+  return QString("thumbnail:%1").arg(uid);
+}
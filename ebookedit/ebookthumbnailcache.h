@@ -0,0 +1,92 @@
+#ifndef EBOOKTHUMBNAILCACHE_H
+#define EBOOKTHUMBNAILCACHE_H
+
+#include <QFutureWatcher>
+#include <QImage>
+#include <QObject>
+#include <QPixmap>
+#include <QSet>
+#include <QThreadPool>
+
+#include "library.h"
+#include "options.h"
+
+class IEBookInterface;
+
+/*!
+ * \brief A cover waiting to be thumbnailed by an EBookThumbnailCache.
+ */
+struct EBookThumbnailTask
+{
+  quint64 uid = 0;
+  QString filename;
+  QString directory; // where the thumbnail is written.
+  IEBookInterface* plugin = nullptr;
+};
+
+/*!
+ * \brief The result of an EBookThumbnailTask.
+ */
+struct EBookThumbnail
+{
+  quint64 uid = 0;
+  QImage image; // null if the book has no cover.
+};
+
+/*!
+ * \brief Supplies the cover thumbnails shown on the library shelf.
+ *
+ * Thumbnails are kept on disk in the freedesktop.org style, as 128 pixel
+ * PNG files carrying Thumb::URI and Thumb::MTime text keys, and are named
+ * by the book uid and the modification time of the book so that a changed
+ * book gets a new thumbnail. Those in use are also kept in the
+ * QPixmapCache.
+ *
+ * thumbnail() never blocks. If the thumbnail is not in memory it returns a
+ * null pixmap and queues the book, thumbnailReady() is emitted once it has
+ * been read from disk or built from the cover. The most recently requested
+ * books are handled first, views only ask for the items they are painting,
+ * so the visible covers are always next. Books that have been scrolled past
+ * are dropped from the end of the queue.
+ */
+class EBookThumbnailCache : public QObject
+{
+  Q_OBJECT
+public:
+  explicit EBookThumbnailCache(Options* options,
+                               LibraryDB library_db,
+                               QObject* parent = nullptr);
+  ~EBookThumbnailCache();
+
+  void setPlugins(const QList<IEBookInterface*>& plugins);
+  QPixmap thumbnail(quint64 uid);
+  void removeThumbnail(quint64 uid);
+
+  static EBookThumbnail loadThumbnail(const EBookThumbnailTask& task);
+
+  static const int THUMBNAIL_SIZE = 128;
+
+signals:
+  void thumbnailReady(quint64 uid);
+
+protected:
+  Options* m_options;
+  LibraryDB m_library_db;
+  QList<IEBookInterface*> m_plugins;
+  QThreadPool m_pool;
+  QList<quint64> m_queue;
+  QSet<quint64> m_running;
+  QSet<quint64> m_no_cover;
+
+  IEBookInterface* pluginFor(const QString& filename) const;
+  void startNext();
+  void thumbnailLoaded(QFutureWatcher<EBookThumbnail>* watcher);
+
+  static QString cacheKey(quint64 uid);
+
+  static const QString THUMBNAIL_DIRECTORY;
+  static const int MAX_JOBS = 2;
+  static const int MAX_QUEUED = 256;
+};
+
+#endif // EBOOKTHUMBNAILCACHE_H
@@ -20,85 +20,100 @@ EBookTocEditor::EBookTocEditor(QWidget* parent)
   update();
 }
 
-void EBookTocEditor::setDocument(QTextDocument* document)
+/*!
+ * \brief Fills the table with the entries of a toc, a row for each entry
+ * in the order that they are shown, nested entries after their parent.
+ */
+void EBookTocEditor::setToc(const EBookToc& toc)
 {
-  QString doc_string = document->toHtml();
-  setDocumentString(doc_string);
-}
-
-void EBookTocEditor::setDocumentString(QString document_string)
-{
-  m_original_string = document_string;
+  m_original = toc;
+  m_result = toc;
   m_modified = false;
   m_initialised = false;
 
   TocDisplayDocument* m_display_document = m_toc_display->document();
   QString toc_string = LIST_START;
-
-  QDomDocument* doc = new QDomDocument;
-  doc->setContent(document_string);
   m_toc_editor->clearContents();
   m_toc_editor->setRowCount(0);
+  m_display_document->clearLinePositions();
+  m_rows.clear();
 
-  QDomElement root = doc->documentElement();
-  if (!root.isNull()) {
-    QDomNodeList html = doc->elementsByTagName("html");
-    for (int i = 0; i < html.count(); i++) {
-      QDomElement html_elem = html.at(i).toElement();
-      QDomNodeList body = html_elem.elementsByTagName("body");
-      for (int i = 0; i < body.count(); i++) {
-        QDomElement body_elem = body.at(i).toElement();
-        QDomNodeList ul = body_elem.elementsByTagName("ul");
-        for (int i = 0; i < ul.count(); i++) {
-          QDomElement ul_elem = ul.at(i).toElement();
-          QDomNodeList li = ul_elem.elementsByTagName("li");
-          for (int i = 0; i < li.count(); i++) {
-            QDomElement li_elem = li.at(i).toElement();
-            QDomNodeList a = li_elem.elementsByTagName("a");
-            for (int i = 0; i < a.count(); i++) {
-              QDomElement a_elem = a.at(i).toElement();
-              QString href = a_elem.attribute("href");
-              if (!href.isEmpty()) {
-                QStringList splits = href.split("#");
-                QString file, anchor, contents, doc_line;
-                if (splits.size() > 0)
-                  file = splits.at(0);
-                if (splits.size() > 1)
-                  anchor = splits.at(1);
-                contents = a_elem.text();
-                int row = m_toc_editor->rowCount();
-                m_toc_editor->insertRow(row);
-
-                QTableWidgetItem* enabled_item = new QTableWidgetItem();
-                enabled_item->setCheckState(Qt::Checked);
-                QTableWidgetItem* file_item = new QTableWidgetItem(file);
-                QTableWidgetItem* anchor_item = new QTableWidgetItem(anchor);
-                QTableWidgetItem* contents_item = new QTableWidgetItem(contents);
-                m_toc_editor->setItem(row, 0, enabled_item);
-                m_toc_editor->setItem(row, 1, file_item);
-                m_toc_editor->setItem(row, 2, anchor_item);
-                m_toc_editor->setItem(row, 3, contents_item);
-
-                int start_position = toc_string.length();
-                doc_line = LIST_BUILD_ITEM.arg(file).arg(anchor).arg(contents);
-                toc_string.append(doc_line);
-                m_display_document->addLinePosition(row, start_position, doc_line.length());
-              }
-            }
-          }
-        }
-      }
-    }
-  }
+  addRows(toc.entries, toc_string);
 
   toc_string += LIST_END;
   m_display_document->setTocString(toc_string);
   m_initialised = true;
 }
 
-QString EBookTocEditor::documentString()
+/*!
+ * \brief The toc as it was accepted, or the toc that was set if the editor
+ * was cancelled.
+ */
+EBookToc EBookTocEditor::toc()
+{
+  return m_result;
+}
+
+void EBookTocEditor::addRows(const TocEntryList& entries, QString& toc_string)
+{
+  TocDisplayDocument* m_display_document = m_toc_display->document();
+  foreach (SharedTocEntry entry, entries) {
+    int separator = entry->href.indexOf("#");
+    QString file = entry->href.left(separator);
+    QString anchor = (separator < 0 ? QString()
+                                    : entry->href.mid(separator + 1));
+    int row = m_toc_editor->rowCount();
+    m_toc_editor->insertRow(row);
+    m_rows.append(entry);
+
+    QTableWidgetItem* enabled_item = new QTableWidgetItem();
+    enabled_item->setCheckState(Qt::Checked);
+    m_toc_editor->setItem(row, 0, enabled_item);
+    m_toc_editor->setItem(row, 1, new QTableWidgetItem(file));
+    m_toc_editor->setItem(row, 2, new QTableWidgetItem(anchor));
+    m_toc_editor->setItem(row, 3, new QTableWidgetItem(entry->label));
+
+    int start_position = toc_string.length();
+    QString doc_line =
+      LIST_BUILD_ITEM.arg(file).arg(anchor).arg(entry->label);
+    toc_string.append(doc_line);
+    m_display_document->addLinePosition(
+      row, start_position, doc_line.length());
+
+    addRows(entry->children, toc_string);
+  }
+}
+
+/*
+ * Rows were added depth first so the same walk meets them in order. The
+ * entries of rows that were turned off are dropped and their children moved
+ * up into their place.
+ */
+TocEntryList EBookTocEditor::editedEntries(const TocEntryList& entries,
+                                           int& row)
 {
-  return m_result_string;
+  TocEntryList edited;
+  foreach (SharedTocEntry entry, entries) {
+    int entry_row = row++;
+    TocEntryList children = editedEntries(entry->children, row);
+    if (m_toc_editor->item(entry_row, 0)->checkState() != Qt::Checked) {
+      edited += children;
+      continue;
+    }
+    SharedTocEntry edited_entry(new EBookTocEntry());
+    edited_entry->href = rowHref(entry_row);
+    edited_entry->label = m_toc_editor->item(entry_row, 3)->text();
+    edited_entry->children = children;
+    edited.append(edited_entry);
+  }
+  return edited;
+}
+
+QString EBookTocEditor::rowHref(int row)
+{
+  QString file = m_toc_editor->item(row, 1)->text();
+  QString anchor = m_toc_editor->item(row, 2)->text();
+  return (anchor.isEmpty() ? file : file + "#" + anchor);
 }
 
 void EBookTocEditor::initGui()
@@ -157,32 +172,20 @@ void EBookTocEditor::updateLine(int row, bool enabled)
    * the toc display document but this QTextCursors ignore all of the html tags
    * and only handles the text so these were all wrong. I now manage points in a
    * QString which is modified and passed to the document.
+   *
+   * The document now keeps the line itself and changes only its block, the
+   * string is rebuilt from the lines when it is needed.
    */
   TocDisplayDocument* toc_document = m_toc_display->document();
-  QPair<int, int> position = toc_document->linePosition(row);
-  QString toc_string = toc_document->tocString();
-  // remove the old line values.
-  toc_string.remove(position.first, position.second);
-  int old_line_length = position.second;
+  QString file = m_toc_editor->item(row, 1)->text();
+  QString anchor = m_toc_editor->item(row, 2)->text();
+  QString contents = m_toc_editor->item(row, 3)->text();
 
   QString doc_line;
   if (enabled) {
-    QString file = m_toc_editor->item(row, 1)->text();
-    QString anchor = m_toc_editor->item(row, 2)->text();
-    QString contents = m_toc_editor->item(row, 3)->text();
     doc_line = LIST_BUILD_ITEM.arg(file).arg(anchor).arg(contents);
-    position.second = doc_line.length();
-  } else {
-    doc_line = "";
-    position.second = 0;
   }
-
-  // update offsets for new line length.
-  toc_document->updateLinePosition(row, position, position.second - old_line_length);
-  // insert the modified line (possibly empty).
-  toc_string.insert(position.first, doc_line);
-  // reset the toc string.
-  m_toc_display->document()->setTocString(toc_string);
+  toc_document->setLine(row, doc_line, rowHref(row), contents);
 }
 
 void EBookTocEditor::tocEditorCellChanged(int row, int column)
@@ -246,16 +249,17 @@ void EBookTocEditor::tocLineEnabledClicked()
 
 void EBookTocEditor::cancelClicked()
 {
-  m_result_string = m_original_string;
+  m_result = m_original;
   reject();
 }
 
 void EBookTocEditor::acceptClicked()
 {
+  m_result = m_original;
   if (m_modified) {
-    // TODO build result from modified data.
-  } else {
-    m_result_string = m_original_string;
+    // only now is the edited toc put back together.
+    int row = 0;
+    m_result.entries = editedEntries(m_original.entries, row);
   }
   accept();
 }
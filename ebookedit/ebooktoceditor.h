@@ -1,9 +1,9 @@
 #ifndef EBOOKTOCEDITOR_H
 #define EBOOKTOCEDITOR_H
 
-#include <QDomDocument>
 #include <QtWidgets>
 
+#include "ebooktoc.h"
 #include "ebooktocwidget.h"
 
 
@@ -12,17 +12,21 @@ class EBookTocEditor : public QDialog
 public:
   EBookTocEditor(QWidget* parent = nullptr);
 
-  void setDocument(QTextDocument* document);
-  void setDocumentString(QString document_string);
-  QString documentString();
+  void setToc(const EBookToc& toc);
+  EBookToc toc();
 
 protected:
   EBookTOCWidget* m_toc_display;
   QTableWidget* m_toc_editor;
-  QString m_original_string, m_result_string;
+  EBookToc m_original, m_result;
+  // the entry shown in each row of the table.
+  TocEntryList m_rows;
   bool m_modified, m_loaded, m_initialised;
 
   void initGui();
+  void addRows(const TocEntryList& entries, QString& toc_string);
+  TocEntryList editedEntries(const TocEntryList& entries, int& row);
+  QString rowHref(int row);
   void tocEditorCellChanged(int row, int column);
   void tocLineEnabledClicked();
   void cancelClicked();
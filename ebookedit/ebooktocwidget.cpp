@@ -8,9 +8,18 @@ EBookTOCWidget::EBookTOCWidget(QWidget* parent)
   connect(this, &QWidget::customContextMenuRequested, this, &EBookTOCWidget::showContextMenu);
 }
 
-void EBookTOCWidget::setDocumentString(QString document_string)
+/*!
+ * \brief Shows a toc, it is only turned into html here.
+ */
+void EBookTOCWidget::setToc(const EBookToc& toc)
 {
-  document()->setHtml(document_string);
+  m_toc = toc;
+  document()->setHtml(toc.toHtml());
+}
+
+EBookToc EBookTOCWidget::toc() const
+{
+  return m_toc;
 }
 
 void EBookTOCWidget::enableHtmlMenuItem(bool enable)
@@ -65,26 +74,58 @@ void EBookTOCWidget::addAnchors()
 
 TocDisplayDocument::TocDisplayDocument(QObject* parent)
   : QTextDocument(parent)
+  , m_toc_dirty(false)
+  , m_first_line_block(0)
+  , m_first_line_start(0)
 {
+  // the toc editor changes lines directly, they are not edits.
+  setUndoRedoEnabled(false);
 }
 
 TocDisplayDocument::~TocDisplayDocument()
 {
 }
 
+void TocDisplayDocument::clearLinePositions()
+{
+  m_first_line_start = 0;
+  m_line_lengths.clear();
+  m_length_tree.clear();
+}
+
+/*!
+ * \brief Adds the next toc line, lines are added in order and each starts
+ * where the one before ends.
+ */
 void TocDisplayDocument::addLinePosition(int line_index, int start_position, int length)
 {
-  QPair<int, int> data = qMakePair<int,int>(start_position, length);
-//  TocLinePosition line_position;
-//  line_position.line_start = start_position;
-//  line_position.filename = filename;
-//  line_position.anchor = anchor;
-//  line_position.contents = contents;
-//  line_position.line_length = length;
-  m_toc_positioning.insert(line_index, data);
+  if (line_index < m_line_lengths.size()) {
+    updateLineLength(line_index, length);
+    return;
+  }
+  if (m_line_lengths.isEmpty()) {
+    m_first_line_start = start_position;
+  }
+  // a Fenwick node holds the lengths of the lines below it that are not
+  // held by the nodes before it.
+  int index = m_line_lengths.size() + 1;
+  int node = length;
+  int lowest = index & -index;
+  for (int i = 1; i < lowest; i <<= 1) {
+    node += m_length_tree.at(index - i - 1);
+  }
+  m_line_lengths.append(length);
+  m_length_tree.append(node);
 }
 
+/*!
+ * \brief The start and length of a toc line in the toc string.
+ */
 QPair<int, int> TocDisplayDocument::linePosition(int index)
 {
-  return m_toc_positioning.value(index);
+  if (index < 0 || index >= m_line_lengths.size()) {
+    return qMakePair<int, int>(0, 0);
+  }
+  return qMakePair<int, int>(m_first_line_start + lengthBefore(index),
+                             m_line_lengths.at(index));
 }
@@ -5,6 +5,7 @@
 #include <QTextBrowser>
 
 #include <ebookcommon.h>
+#include <ebooktoc.h>
 
 class EBookTOCWidget : public QTextBrowser
 {
@@ -12,7 +13,8 @@ class EBookTOCWidget : public QTextBrowser
 public:
   EBookTOCWidget(QWidget* parent = nullptr);
 
-  void setDocumentString(QString document_string);
+  void setToc(const EBookToc& toc);
+  EBookToc toc() const;
   void enableHtmlMenuItem(bool enable);
   TocDisplayDocument *document();
   void setDocument(TocDisplayDocument* document);
@@ -25,6 +27,7 @@ signals:
 protected:
   //  void contextMenuEvent(QContextMenuEvent* event);
   bool m_enable_html = true;
+  EBookToc m_toc;
 
   void showContextMenu(const QPoint& point);
   void manualToc();
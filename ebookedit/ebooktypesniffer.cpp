@@ -0,0 +1,64 @@
+#include "ebooktypesniffer.h"
+
+#include <QFile>
+
+EBookTypeSniffer::EBookTypeSniffer() {}
+
+EBookTypeSniffer::EBookTypeSniffer(const QList<IEBookInterface*>& plugins)
+{
+  foreach (IEBookInterface* plugin, plugins) {
+    addPlugin(plugin);
+  }
+}
+
+/*!
+ * \brief Registers the signatures of a plugin.
+ */
+void
+EBookTypeSniffer::addPlugin(IEBookInterface* plugin)
+{
+  foreach (EBookSignature signature, plugin->signatures()) {
+    if (signature.magic.isEmpty() || signature.offset < 0 ||
+        signature.offset + signature.magic.size() > SNIFF_SIZE) {
+      continue;
+    }
+    m_signatures.append(qMakePair(signature, plugin));
+  }
+}
+
+void
+EBookTypeSniffer::clear()
+{
+  m_signatures.clear();
+}
+
+/*!
+ * \brief The plugin whose signature the file matches, or nullptr if none
+ * do or the file cannot be read.
+ */
+IEBookInterface*
+EBookTypeSniffer::plugin(const QString& filename) const
+{
+  QFile file(filename);
+  if (m_signatures.isEmpty() || !file.open(QIODevice::ReadOnly)) {
+    return nullptr;
+  }
+  return plugin(file.read(SNIFF_SIZE));
+}
+
+/*!
+ * \brief The plugin whose signature the start of a file matches.
+ */
+IEBookInterface*
+EBookTypeSniffer::plugin(const QByteArray& head) const
+{
+  for (int i = 0; i < m_signatures.size(); i++) {
+    const EBookSignature& signature = m_signatures.at(i).first;
+    if (head.size() >= signature.offset + signature.magic.size() &&
+        head.mid(signature.offset, signature.magic.size()) ==
+          signature.magic) {
+      return m_signatures.at(i).second;
+    }
+  }
+  return nullptr;
+}
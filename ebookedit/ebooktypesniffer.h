@@ -0,0 +1,36 @@
+#ifndef EBOOKTYPESNIFFER_H
+#define EBOOKTYPESNIFFER_H
+
+#include <QList>
+#include <QPair>
+#include <QString>
+
+#include "iebookinterface.h"
+
+/*!
+ * \brief Finds the plugin for a book file from the signatures that the
+ * plugins register.
+ *
+ * The first SNIFF_SIZE bytes of the file are read once and checked against
+ * every signature, so files are told apart without the MIME database or
+ * opening them as books.
+ */
+class EBookTypeSniffer
+{
+public:
+  EBookTypeSniffer();
+  explicit EBookTypeSniffer(const QList<IEBookInterface*>& plugins);
+
+  void addPlugin(IEBookInterface* plugin);
+  void clear();
+
+  IEBookInterface* plugin(const QString& filename) const;
+  IEBookInterface* plugin(const QByteArray& head) const;
+
+  static const int SNIFF_SIZE = 128;
+
+protected:
+  QList<QPair<EBookSignature, IEBookInterface*>> m_signatures;
+};
+
+#endif // EBOOKTYPESNIFFER_H
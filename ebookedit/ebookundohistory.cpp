@@ -0,0 +1,303 @@
+#include "ebookundohistory.h"
+
+#include <QDir>
+
+#include <qlogger/qlogger.h>
+
+using namespace qlogger;
+
+EBookUndoHistory::EBookUndoHistory(Options* options, QObject* parent)
+  : QObject(parent)
+  , m_options(options)
+  , m_document(nullptr)
+  , m_chapter(0)
+  , m_memory(0)
+  , m_journal(nullptr)
+  , m_restoring(false)
+{}
+
+EBookUndoHistory::~EBookUndoHistory() {}
+
+/*!
+ * \brief Follows the edits of a document, any earlier history is dropped.
+ */
+void
+EBookUndoHistory::setDocument(ITextDocument* document)
+{
+  if (m_document) {
+    disconnect(m_document, nullptr, this, nullptr);
+  }
+  clear();
+  m_document = document;
+  if (!m_document) {
+    return;
+  }
+  m_chapter = m_document->currentChapter();
+  connect(m_document,
+          &QTextDocument::undoCommandAdded,
+          this,
+          &EBookUndoHistory::undoCommandAdded);
+  connect(m_document,
+          &ITextDocument::chapterAboutToChange,
+          this,
+          &EBookUndoHistory::chapterAboutToChange);
+  connect(m_document,
+          &ITextDocument::chapterChanged,
+          this,
+          &EBookUndoHistory::chapterChanged);
+  connect(m_document,
+          &ITextDocument::chapterSourceChanged,
+          this,
+          &EBookUndoHistory::chapterSourceChanged);
+}
+
+/*!
+ * \brief Undoes the last edit, or once the document has no more edits to
+ * undo goes back to the checkpoint before.
+ *
+ * \return true if anything was undone.
+ */
+bool
+EBookUndoHistory::undo()
+{
+  if (!m_document) {
+    return false;
+  }
+  if (m_document->isUndoAvailable()) {
+    m_document->undo();
+    return true;
+  }
+  EBookChapterHistory& history = m_chapters[m_chapter];
+  if (history.checkpoints.size() < 2) {
+    return false;
+  }
+  history.redo.append(history.checkpoints.takeLast());
+  return restore(history.checkpoints.last());
+}
+
+/*!
+ * \brief Redoes the last undone edit, or the last checkpoint gone back
+ * from.
+ *
+ * \return true if anything was redone.
+ */
+bool
+EBookUndoHistory::redo()
+{
+  if (!m_document) {
+    return false;
+  }
+  if (m_document->isRedoAvailable()) {
+    m_document->redo();
+    return true;
+  }
+  EBookChapterHistory& history = m_chapters[m_chapter];
+  if (history.redo.isEmpty()) {
+    return false;
+  }
+  history.checkpoints.append(history.redo.takeLast());
+  return restore(history.checkpoints.last());
+}
+
+/*!
+ * \brief The bytes of compressed checkpoints held in memory, those spilled
+ * to the journal are not counted.
+ */
+qint64
+EBookUndoHistory::memory() const
+{
+  return m_memory;
+}
+
+bool
+EBookUndoHistory::isUndoAvailable() const
+{
+  return (m_document && (m_document->isUndoAvailable() ||
+                         m_chapters.value(m_chapter).checkpoints.size() > 1));
+}
+
+bool
+EBookUndoHistory::isRedoAvailable() const
+{
+  return (m_document && (m_document->isRedoAvailable() ||
+                         !m_chapters.value(m_chapter).redo.isEmpty()));
+}
+
+/*
+ * A new edit means that nothing undone can be redone. Past the step limit
+ * the older edits are folded into a checkpoint.
+ */
+void
+EBookUndoHistory::undoCommandAdded()
+{
+  if (m_restoring) {
+    return;
+  }
+  m_chapters[m_chapter].redo.clear();
+  if (m_document->availableUndoSteps() > m_options->undoSteps()) {
+    checkpoint();
+    m_document->clearUndoRedoStacks(QTextDocument::UndoStack);
+  }
+}
+
+/*
+ * Edits of the chapter being left are kept as a checkpoint, so that they
+ * are there when it is shown again.
+ */
+void
+EBookUndoHistory::chapterAboutToChange(int index)
+{
+  if (m_restoring) {
+    return;
+  }
+  m_chapter = index;
+  if (m_document->availableUndoSteps() > 0) {
+    checkpoint();
+  }
+}
+
+void
+EBookUndoHistory::chapterChanged(int index)
+{
+  if (m_restoring) {
+    return;
+  }
+  m_chapter = index;
+  EBookChapterHistory history = m_chapters.value(index);
+  if (!history.checkpoints.isEmpty() &&
+      !history.checkpoints.last()->original) {
+    restore(history.checkpoints.last());
+  }
+}
+
+/*
+ * The checkpoints of a chapter whose xhtml has been replaced, by a book
+ * wide replace for instance, no longer apply to it.
+ */
+void
+EBookUndoHistory::chapterSourceChanged(int index)
+{
+  m_chapters.remove(index);
+}
+
+/*
+ * Adds the chapter as it is now to its history.
+ */
+void
+EBookUndoHistory::checkpoint()
+{
+  EBookChapterHistory& history = m_chapters[m_chapter];
+  if (history.checkpoints.isEmpty()) {
+    SharedUndoCheckpoint original(new EBookUndoCheckpoint());
+    original->original = true;
+    history.checkpoints.append(original);
+  }
+  SharedUndoCheckpoint checkpoint(new EBookUndoCheckpoint());
+  checkpoint->html = qCompress(m_document->toHtml().toUtf8());
+  history.checkpoints.append(checkpoint);
+  history.redo.clear();
+
+  m_memory += checkpoint->html.size();
+  m_in_memory.enqueue(
+    HeldUndoCheckpoint(checkpoint.toWeakRef(), checkpoint->html.size()));
+  spill();
+}
+
+/*
+ * Replaces the contents of the document with a checkpoint, this also
+ * clears the document's own undo stack.
+ */
+bool
+EBookUndoHistory::restore(SharedUndoCheckpoint checkpoint)
+{
+  m_restoring = true;
+  bool restored = true;
+  if (checkpoint->original) {
+    restored = m_document->reloadChapter();
+  } else {
+    QByteArray html = checkpointHtml(checkpoint);
+    if (html.isEmpty()) {
+      restored = false;
+    } else {
+      m_document->setHtml(QString::fromUtf8(qUncompress(html)));
+    }
+  }
+  m_restoring = false;
+  return restored;
+}
+
+/*
+ * Writes the oldest checkpoints to the journal until those left are
+ * within the memory budget.
+ */
+void
+EBookUndoHistory::spill()
+{
+  qint64 budget = qint64(m_options->undoMemory()) * 1024 * 1024;
+  while (m_memory > budget && !m_in_memory.isEmpty()) {
+    HeldUndoCheckpoint held = m_in_memory.dequeue();
+    SharedUndoCheckpoint checkpoint = held.first.toStrongRef();
+    if (checkpoint.isNull()) {
+      // dropped from the history already, its memory went with it.
+      m_memory -= held.second;
+      continue;
+    }
+    if (!m_journal) {
+      m_journal = new QTemporaryFile(m_options->cacheDirectory() +
+                                       QDir::separator() +
+                                       "undo-XXXXXX.journal",
+                                     this);
+      if (!m_journal->open()) {
+        QLOG_DEBUG(tr("Unable to open the undo journal %1")
+                     .arg(m_journal->fileTemplate()));
+        delete m_journal;
+        m_journal = nullptr;
+        // kept in memory after all.
+        m_in_memory.prepend(held);
+        return;
+      }
+    }
+    qint64 offset = m_journal->size();
+    m_journal->seek(offset);
+    if (m_journal->write(checkpoint->html) != checkpoint->html.size()) {
+      QLOG_DEBUG(tr("Unable to write to the undo journal %1")
+                   .arg(m_journal->fileName()));
+      m_in_memory.prepend(held);
+      return;
+    }
+    checkpoint->journal_offset = offset;
+    checkpoint->journal_size = checkpoint->html.size();
+    m_memory -= checkpoint->html.size();
+    checkpoint->html.clear();
+  }
+}
+
+/*
+ * The compressed html of a checkpoint, read back from the journal if it
+ * has been spilled.
+ */
+QByteArray
+EBookUndoHistory::checkpointHtml(SharedUndoCheckpoint checkpoint)
+{
+  if (checkpoint->journal_offset < 0) {
+    return checkpoint->html;
+  }
+  if (!m_journal || !m_journal->seek(checkpoint->journal_offset)) {
+    QLOG_DEBUG(tr("Unable to read the undo journal"));
+    return QByteArray();
+  }
+  return m_journal->read(checkpoint->journal_size);
+}
+
+void
+EBookUndoHistory::clear()
+{
+  m_chapters.clear();
+  m_in_memory.clear();
+  m_memory = 0;
+  m_chapter = 0;
+  if (m_journal) {
+    delete m_journal;
+    m_journal = nullptr;
+  }
+}
@@ -0,0 +1,97 @@
+#ifndef EBOOKUNDOHISTORY_H
+#define EBOOKUNDOHISTORY_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPair>
+#include <QQueue>
+#include <QSharedPointer>
+#include <QTemporaryFile>
+#include <QWeakPointer>
+
+#include "iebookdocument.h"
+#include "options.h"
+
+/*!
+ * \brief The state of a chapter at the start of a block of edits.
+ *
+ * The html is held compressed, or once it has been spilled only its place
+ * in the journal file is kept. The first checkpoint of a chapter is the
+ * chapter as it is in the book and holds nothing.
+ */
+struct EBookUndoCheckpoint
+{
+  bool original = false;
+  QByteArray html;
+  qint64 journal_offset = -1;
+  int journal_size = 0;
+};
+typedef QSharedPointer<EBookUndoCheckpoint> SharedUndoCheckpoint;
+// a checkpoint held in memory and its size.
+typedef QPair<QWeakPointer<EBookUndoCheckpoint>, int> HeldUndoCheckpoint;
+
+/*!
+ * \brief The undo history of one chapter.
+ */
+struct EBookChapterHistory
+{
+  QList<SharedUndoCheckpoint> checkpoints;
+  QList<SharedUndoCheckpoint> redo;
+};
+
+/*!
+ * \brief A bounded undo history for each chapter of a book.
+ *
+ * The document's own undo stack, which already merges runs of typing into
+ * single steps, holds the latest Options::undoSteps() edits of the chapter
+ * shown. When it grows past that the chapter is checkpointed and the stack
+ * cleared, so older edits are undone a block at a time by going back to
+ * the checkpoint before. A chapter is also checkpointed when it is left
+ * and put back when it is next shown, so each chapter keeps its own
+ * history.
+ *
+ * Checkpoints are compressed. Once they take more than Options::undoMemory()
+ * megabytes the oldest are spilled to a journal file in the cache
+ * directory, which is removed along with the history, so memory stays flat
+ * however long the book is edited.
+ */
+class EBookUndoHistory : public QObject
+{
+  Q_OBJECT
+public:
+  explicit EBookUndoHistory(Options* options, QObject* parent = nullptr);
+  ~EBookUndoHistory();
+
+  void setDocument(ITextDocument* document);
+
+  bool undo();
+  bool redo();
+  bool isUndoAvailable() const;
+  bool isRedoAvailable() const;
+  qint64 memory() const;
+
+protected:
+  Options* m_options;
+  ITextDocument* m_document;
+  int m_chapter;
+  QHash<int, EBookChapterHistory> m_chapters;
+  // the checkpoints held in memory, oldest first.
+  QQueue<HeldUndoCheckpoint> m_in_memory;
+  qint64 m_memory;
+  QTemporaryFile* m_journal;
+  bool m_restoring;
+
+  void undoCommandAdded();
+  void chapterAboutToChange(int index);
+  void chapterChanged(int index);
+  void chapterSourceChanged(int index);
+  void checkpoint();
+  bool restore(SharedUndoCheckpoint checkpoint);
+  void spill();
+  QByteArray checkpointHtml(SharedUndoCheckpoint checkpoint);
+  void clear();
+};
+
+#endif // EBOOKUNDOHISTORY_H
@@ -1,86 +1,187 @@
 #include "ebookwordreader.h"
 
+#include <QElapsedTimer>
+#include <QTextBlock>
+
 #include <qlogger/qlogger.h>
 
 #include "ebookeditor.h"
+#include "ispellinterface.h"
 
 using namespace qlogger;
 
 EBookWordReader::EBookWordReader(EBookEditor *editor, QObject *parent)
-    : QThread(parent), m_running(true), m_document_loaded(false),
-      m_editor(editor), m_document(nullptr) {}
+    : QObject(parent), m_editor(editor), m_document(nullptr),
+      m_checker(nullptr) {
+  m_timer.setSingleShot(true);
+  m_timer.setInterval(0);
+  connect(&m_timer, &QTimer::timeout, this, &EBookWordReader::readSlice);
+}
 
 EBookWordReader::~EBookWordReader() {}
 
-void EBookWordReader::stopRunning() { m_running = false; }
+/*!
+ * \brief Sets the spell checker the words are passed to, nothing is read
+ * until one is set.
+ */
+void EBookWordReader::setSpellChecker(ISpellInterface *checker) {
+  m_checker = checker;
+  m_sent.clear();
+  setLanguage();
+  checkDocument();
+}
+
+/*
+ * The checker uses the dictionary of the book's dc:language.
+ */
+void EBookWordReader::setLanguage() {
+  IEBookDocument *document = m_editor->ebookDocument();
+  if (m_checker && document) {
+    m_checker->setLanguage(document->language());
+  }
+}
+
+void EBookWordReader::stopRunning() {
+  m_timer.stop();
+  m_dirty.clear();
+}
 
 void EBookWordReader::documentIsLoaded() {
+  if (m_document) {
+    disconnect(m_document, &QTextDocument::contentsChange, this,
+               &EBookWordReader::contentsChange);
+  }
   m_document = m_editor->document();
-  m_document_loaded = true;
-}
-
-void EBookWordReader::run() {
-  //  QTextDocumentFragment fragment;
-  while (m_running) {
-
-    if (m_document_loaded) {
-      QString word;
-      int end = 0, start = 0, pos = 0;
-      start = 0;
-      // we are checking the entire document so set end at end of
-      //      EBookTextCursor tmpCursor(m_editor->textCursor());
-      //      tmpCursor.movePosition(QTextCursor::End);
-      //      end = tmpCursor.position();
-
-      //      //      // block signals during check
-      //      m_editor->document()->blockSignals(true);
-
-      //      EBookTextCursor cursor(m_editor->textCursor());
-      //      cursor.beginEditBlock();
-      //      cursor.setPosition(start);
-      //      pos = cursor.position();
-      //      while (pos < end) {
-      //        word = getNextWord(&pos);
-      //        //        pos = cursor.position();
-      //      }
-
-      //      while (cursor.position() < end &&
-      //             !cursor.isWordChar(cursor.nextCharacter())) {
-      //        cursor.movePosition(QTextCursor::NextCharacter);
-      //      }
-      //      cursor.endEditBlock();
-      //      // clear signal block
-      //      m_editor->document()->blockSignals(false);
-
-      thread()->msleep(100);
+  m_sent.clear();
+  setLanguage();
+  if (m_document) {
+    connect(m_document, &QTextDocument::contentsChange, this,
+            &EBookWordReader::contentsChange);
+  }
+  checkDocument();
+}
+
+/*!
+ * \brief Reads the whole document again.
+ */
+void EBookWordReader::checkDocument() {
+  m_dirty.clear();
+  if (m_document) {
+    markDirty(0, m_document->characterCount());
+  }
+}
+
+void EBookWordReader::contentsChange(int position, int removed, int added) {
+  // everything after the edit moves with it.
+  int shift = added - removed;
+  for (int i = 0; i < m_dirty.size(); i++) {
+    QPair<int, int> &range = m_dirty[i];
+    if (range.first > position) {
+      range.first = qMax(position, range.first + shift);
+    }
+    if (range.second > position) {
+      range.second = qMax(position, range.second + shift);
+    }
+  }
+  markDirty(position, position + added);
+}
+
+/*!
+ * \brief Adds a range of positions to the dirty ranges, merging it with any
+ * range it touches.
+ */
+void EBookWordReader::markDirty(int start, int end) {
+  QList<QPair<int, int>> ranges;
+  bool inserted = false;
+  foreach (const QPair<int, int> &range, m_dirty) {
+    if (range.second < start) {
+      ranges.append(range);
+    } else if (range.first > end) {
+      if (!inserted) {
+        ranges.append(qMakePair(start, end));
+        inserted = true;
+      }
+      ranges.append(range);
+    } else {
+      start = qMin(start, range.first);
+      end = qMax(end, range.second);
     }
   }
+  if (!inserted) {
+    ranges.append(qMakePair(start, end));
+  }
+  m_dirty = ranges;
+  if (m_checker && !m_timer.isActive()) {
+    m_timer.start();
+  }
 }
 
-QString EBookWordReader::getNextWord(int *pos) {
-  QString word;
-  if (pos) {
-    EBookTextCursor cursor(m_editor->textCursor());
-    cursor.setPosition(*pos);
-    cursor.movePosition(QTextCursor::StartOfWord);
-    cursor.movePosition(QTextCursor::EndOfWord, QTextCursor::KeepAnchor);
-    word = cursor.selectedText();
-    *pos = cursor.position() + 1; // move past word end.
+/*!
+ * \brief Reads dirty blocks for at most TIME_SLICE ms then returns to the
+ * event loop, another slice follows if any are left.
+ */
+void EBookWordReader::readSlice() {
+  if (!m_document || !m_checker) {
+    return;
+  }
+  QElapsedTimer elapsed;
+  elapsed.start();
+  QStringList words;
+  while (!m_dirty.isEmpty() && elapsed.elapsed() < TIME_SLICE) {
+    QPair<int, int> &range = m_dirty.first();
+    QTextBlock block = m_document->findBlock(range.first);
+    if (!block.isValid() || block.position() > range.second) {
+      m_dirty.removeFirst();
+      continue;
+    }
+    blockWords(block.text(), words);
+    range.first = block.position() + block.length();
+    if (range.first > range.second) {
+      m_dirty.removeFirst();
+    }
+  }
+
+  QStringList unsent;
+  foreach (QString word, words) {
+    if (!m_sent.contains(word)) {
+      m_sent.insert(word);
+      unsent << word;
+    }
+  }
+  if (!unsent.isEmpty()) {
+    m_checker->checkWords(unsent);
+  }
+
+  if (m_dirty.isEmpty()) {
+    emit finished();
+  } else {
+    m_timer.start();
+  }
+}
+
+/*!
+ * \brief Appends the words of a block of text to words.
+ *
+ * The block text is split by EBookWordTokenizer rather than by moving a
+ * cursor through the document a word at a time.
+ */
+void EBookWordReader::blockWords(const QString &text, QStringList &words) {
+  for (const EBookWordSpan &span : EBookWordTokenizer::words(text)) {
+    words.append(text.mid(span.start, span.length));
   }
-  return word;
 }
 
 EBookTextCursor::EBookTextCursor()
-    : QTextCursor(), m_regex(QRegularExpression("^\\w$")) {}
+    : QTextCursor() {}
 
 EBookTextCursor::EBookTextCursor(QTextDocument *document)
-    : QTextCursor(document), m_regex(QRegularExpression("^\\w$")) {}
+    : QTextCursor(document) {}
 
 EBookTextCursor::EBookTextCursor(const QTextBlock &block)
-    : QTextCursor(block), m_regex(QRegularExpression("^\\w$")) {}
+    : QTextCursor(block) {}
 
 EBookTextCursor::EBookTextCursor(const QTextCursor &cursor)
-    : QTextCursor(cursor), m_regex(QRegularExpression("^\\w$")) {}
+    : QTextCursor(cursor) {}
 
 /*! /brief Retreive the num-th next character.
  *
@@ -88,13 +189,11 @@ EBookTextCursor::EBookTextCursor(const QTextCursor &cursor)
  * /return A string containing the character, which might be empty.
  */
 QString EBookTextCursor::nextCharacter(int index) const {
-  EBookTextCursor cursor(*this);
-  if (index > 1)
-    cursor.movePosition(NextCharacter, MoveAnchor, index - 1);
-  else
-    cursor.setPosition(cursor.position());
-  cursor.movePosition(NextCharacter, KeepAnchor);
-  return cursor.selectedText();
+  QTextDocument *doc = document();
+  int pos = position() + index - 1;
+  if (!doc || index < 1 || pos >= doc->characterCount())
+    return QString();
+  return QString(doc->characterAt(pos));
 }
 
 /*! /brief Retreive the num-th previous character.
@@ -103,13 +202,11 @@ QString EBookTextCursor::nextCharacter(int index) const {
  * /return A string containing the character, which might be empty.
  */
 QString EBookTextCursor::prevCharacter(int index) const {
-  EBookTextCursor cursor(*this);
-  if (index > 1)
-    cursor.movePosition(PreviousCharacter, MoveAnchor, index - 1);
-  else
-    cursor.setPosition(cursor.position());
-  cursor.movePosition(PreviousCharacter, KeepAnchor);
-  return cursor.selectedText();
+  QTextDocument *doc = document();
+  int pos = position() - index;
+  if (!doc || index < 1 || pos < 0)
+    return QString();
+  return QString(doc->characterAt(pos));
 }
 
 /*! /brief Move the cursor to the start of the current word. Cursor must be
@@ -129,7 +226,7 @@ void EBookTextCursor::moveToWordStart(QTextCursor::MoveMode moveMode) {
   //  if (nextCharacter() == "'") {
   //    // If the previous char is alphanumeric, move left one word, otherwise
   //    // move right one char
-  //    if (prevCharacter().contains(m_regex)) {
+  //    if (isWordChar(prevCharacter())) {
   movePosition(WordLeft, moveMode);
   //    } else {
   //      movePosition(NextCharacter, moveMode);
@@ -160,7 +257,7 @@ void EBookTextCursor::moveToWordEnd(QTextCursor::MoveMode moveMode) {
   if (prevCharacter() == "'") {
     // If the next char is alphanumeric, move right one word, otherwise move
     // left one char
-    if (nextCharacter().contains(m_regex)) {
+    if (isWordChar(nextCharacter())) {
       movePosition(WordRight, moveMode);
     } else {
       movePosition(PreviousCharacter, moveMode);
@@ -168,7 +265,7 @@ void EBookTextCursor::moveToWordEnd(QTextCursor::MoveMode moveMode) {
   }
   // If the next char is a quote, and the char after that is alphanumeric,
   // move right one word
-  else if (nextCharacter() == "'" && nextCharacter(2).contains(m_regex)) {
+  else if (nextCharacter() == "'" && isWordChar(nextCharacter(2))) {
     movePosition(WordRight, moveMode,
                  2); // 2: because quote counts as a word boundary
   }
@@ -179,7 +276,7 @@ void EBookTextCursor::moveToWordEnd(QTextCursor::MoveMode moveMode) {
  * /return Whether the cursor is inside a word.
  */
 bool EBookTextCursor::isInsideWord() const {
-  return nextCharacter().contains(m_regex) || prevCharacter().contains(m_regex);
+  return isWordChar(nextCharacter()) || isWordChar(prevCharacter());
 }
 
 /*! /brief Returns whether the specified character is a word character.
@@ -187,5 +284,5 @@ bool EBookTextCursor::isInsideWord() const {
  * /return Whether the specified character is a word character.
  */
 bool EBookTextCursor::isWordChar(const QString &character) const {
-  return character.contains(m_regex);
+  return character.size() == 1 && EBookWordTokenizer::isWordChar(character.at(0));
 }
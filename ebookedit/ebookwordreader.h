@@ -2,14 +2,18 @@
 #define EBOOKWORDREADER_H
 
 #include <QCoreApplication>
-#include <QRegularExpression>
+#include <QPair>
+#include <QSet>
 #include <QTextCursor>
 #include <QTextDocument>
 #include <QTextDocumentFragment>
 #include <QTextEdit>
-#include <QThread>
+#include <QTimer>
+
+#include "wordtokenizer.h"
 
 class EBookEditor;
+class ISpellInterface;
 
 class EBookTextCursor : public QTextCursor
 {
@@ -27,31 +31,51 @@ public:
 
   bool isInsideWord() const;
   bool isWordChar(const QString& character) const;
-
-protected:
-  QRegularExpression m_regex;
 };
 
-class EBookWordReader : public QThread
+/*!
+ * \brief Feeds the words of an editor document to a spell checker as the
+ * document changes.
+ *
+ * Edits are followed through QTextDocument::contentsChange(), which only
+ * marks the changed range dirty. The dirty blocks are then read in the GUI
+ * thread a few milliseconds at a time, so typing costs work in proportion
+ * to the edit rather than to the size of the chapter, and the editor is
+ * never held up. Only words that have not been sent before are passed to
+ * the spell checker.
+ */
+class EBookWordReader : public QObject
 {
   Q_OBJECT
 public:
   explicit EBookWordReader(EBookEditor* editor, QObject* parent = nullptr);
-    ~EBookWordReader();
+  ~EBookWordReader();
 
+  void setSpellChecker(ISpellInterface* checker);
   void stopRunning();
   void documentIsLoaded();
+  void checkDocument();
 
 signals:
   void finished();
 
 protected:
-  bool m_running, m_document_loaded;
   EBookEditor* m_editor;
   QTextDocument* m_document;
+  ISpellInterface* m_checker;
+  // the dirty ranges of the document as character positions, sorted and
+  // not overlapping.
+  QList<QPair<int, int>> m_dirty;
+  QSet<QString> m_sent; // the words already passed to the spell checker.
+  QTimer m_timer;
+
+  void setLanguage();
+  void contentsChange(int position, int removed, int added);
+  void markDirty(int start, int end);
+  void readSlice();
+  static void blockWords(const QString& text, QStringList& words);
 
-  void run();
-  QString getNextWord(int *pos);
+  static const int TIME_SLICE = 5; // ms.
 };
 
 #endif // EBOOKWORDREADER_H
@@ -1,4 +1,7 @@
 #include "ebookwrapper.h"
+#include "ebookeditjournal.h"
+#include "ebookstatisticstracker.h"
+#include "ebookundohistory.h"
 #include "ebookwordreader.h"
 
 EBookWrapper::EBookWrapper(Options* options,
@@ -11,11 +14,15 @@ EBookWrapper::EBookWrapper(Options* options,
   , m_codeeditor(new EBookCodeEditor(options, parent))
   , m_metaeditor(
       new MetadataEditor(options, authors, series_db, library, parent))
-  /* ,m_word_reader(new EBookWordReader(m_editor, this)),*/
+  , m_word_reader(new EBookWordReader(m_editor, this))
+  , m_undo_history(new EBookUndoHistory(options, this))
+  , m_statistics(new EBookStatisticsTracker(this))
+  , m_journal(new EBookEditJournal(options, this))
   , m_editorindex(0)
   , m_codeindex(0)
   , m_metaindex(0)
   , m_options(options)
+  , m_code_chapter(-1)
 {
   //  Qt::TextInteractionFlags flags = m_editor->textInteractionFlags();
   //  flags ^= Qt::TextEditorInteraction; // add editing capabilities (this
@@ -25,25 +32,84 @@ EBookWrapper::EBookWrapper(Options* options,
   m_editorindex = addWidget(m_editor);
   m_codeindex = addWidget(m_codeeditor);
   m_metaindex = addWidget(m_metaeditor);
+  m_editor->setUndoHistory(m_undo_history);
 
-  //  connect(m_editor, &EBookEditor::documentLoaded, m_word_reader,
-  //  &EBookWordReader::documentIsLoaded); m_word_reader->start();
+  connect(m_editor,
+          &EBookEditor::documentLoaded,
+          m_word_reader,
+          &EBookWordReader::documentIsLoaded);
+  connect(m_editor,
+          &EBookEditor::documentLoaded,
+          this,
+          &EBookWrapper::editorDocumentLoaded);
 }
 
 EBookWrapper::~EBookWrapper()
 {
-  /*m_word_reader->stopRunning();*/
+  m_word_reader->stopRunning();
 }
 
+/*!
+ * \brief Shows the book editor, at the place of the cursor in the code.
+ *
+ * Only the parts of the source map that were edited since it was last
+ * used are matched again.
+ */
 void
 EBookWrapper::setToEditor()
 {
+  if (currentIndex() == m_codeindex && !m_source_map.isEmpty() &&
+      !m_codeeditor->isLoading()) {
+    m_source_map.remap(m_codeeditor->toPlainText(), m_editor->toPlainText());
+    int position =
+      m_source_map.textPosition(m_codeeditor->textCursor().position());
+    QTextCursor cursor = m_editor->textCursor();
+    cursor.setPosition(
+      qBound(0, position, m_editor->document()->characterCount() - 1));
+    m_editor->setTextCursor(cursor);
+    m_editor->ensureCursorVisible();
+  }
   setCurrentIndex(m_editorindex);
 }
 
+/*!
+ * \brief Shows the code of the chapter in the book editor, at the place of
+ * its cursor.
+ *
+ * The code is only read from the book when the chapter has changed.
+ */
 void
 EBookWrapper::setToCode()
 {
+  IEBookDocument* document = m_editor->ebookDocument();
+  if (document) {
+    int chapter = document->currentChapter();
+    if (chapter != m_code_chapter) {
+      QString code = document->chapterSource();
+      m_source_map.clear();
+      m_codeeditor->setCode(code);
+      connect(m_codeeditor->document(),
+              &QTextDocument::contentsChange,
+              this,
+              &EBookWrapper::codeChanged);
+      if (!code.isEmpty()) {
+        m_source_map.build(code, m_editor->toPlainText());
+      }
+      m_code_chapter = chapter;
+    } else if (!m_codeeditor->isLoading()) {
+      m_source_map.remap(m_codeeditor->toPlainText(),
+                         m_editor->toPlainText());
+    }
+    if (!m_source_map.isEmpty()) {
+      int position =
+        m_source_map.sourcePosition(m_editor->textCursor().position());
+      QTextCursor cursor = m_codeeditor->textCursor();
+      cursor.setPosition(
+        qBound(0, position, m_codeeditor->document()->characterCount() - 1));
+      m_codeeditor->setTextCursor(cursor);
+      m_codeeditor->centerCursor();
+    }
+  }
   setCurrentIndex(m_codeindex);
 }
 
@@ -77,10 +143,124 @@ EBookWrapper::optionsHaveChanged()
   m_codeeditor->rehighlight();
 }
 
+/*!
+ * \brief Shows or hides the profiling overlay of both editors.
+ */
+void
+EBookWrapper::setProfileOverlay(bool show)
+{
+  m_editor->setProfileOverlay(show);
+  m_codeeditor->setProfileOverlay(show);
+}
+
 void
 EBookWrapper::startWordReader()
 {
-  /*m_word_reader->start();*/
+  m_word_reader->checkDocument();
+}
+
+/*!
+ * \brief Sets the spell checker that the words of the document are passed
+ * to as it is edited.
+ */
+void
+EBookWrapper::setSpellChecker(ISpellInterface* checker)
+{
+  m_word_reader->setSpellChecker(checker);
+}
+
+/*
+ * The edits of the book have to be followed by the source map.
+ */
+void
+EBookWrapper::editorDocumentLoaded()
+{
+  m_source_map.clear();
+  m_code_chapter = -1;
+  m_undo_history->setDocument(
+    dynamic_cast<ITextDocument*>(m_editor->ebookDocument()));
+  m_statistics->setDocument(
+    dynamic_cast<ITextDocument*>(m_editor->ebookDocument()));
+  m_journal->setDocument(
+    dynamic_cast<ITextDocument*>(m_editor->ebookDocument()));
+  connect(m_editor->document(),
+          &QTextDocument::contentsChange,
+          this,
+          &EBookWrapper::textChanged);
+}
+
+void
+EBookWrapper::textChanged(int position, int removed, int added)
+{
+  if (!m_source_map.isEmpty()) {
+    m_source_map.textChanged(position, removed, added);
+  }
+}
+
+void
+EBookWrapper::codeChanged(int position, int removed, int added)
+{
+  // the code is still being loaded.
+  if (m_codeeditor->isLoading() || m_source_map.isEmpty()) {
+    return;
+  }
+  m_source_map.sourceChanged(position, removed, added);
+}
+
+/*!
+ * \brief The memory held by the book and by its undo history.
+ */
+EBookMemoryUsage
+EBookWrapper::memoryUsage() const
+{
+  EBookMemoryUsage usage;
+  IEBookDocument* document = m_editor->ebookDocument();
+  if (document) {
+    usage = document->memoryUsage();
+  }
+  usage.undo += m_undo_history->memory();
+  return usage;
+}
+
+/*!
+ * \brief The statistics of the book, kept up to date as it is edited.
+ */
+EBookStatisticsTracker*
+EBookWrapper::statistics()
+{
+  return m_statistics;
+}
+
+/*!
+ * \brief The autosave journal of the edits to the book.
+ */
+EBookEditJournal*
+EBookWrapper::journal()
+{
+  return m_journal;
+}
+
+/*!
+ * \brief Undoes the last edit in the editor shown.
+ */
+void
+EBookWrapper::undo()
+{
+  if (currentIndex() == m_codeindex) {
+    m_codeeditor->undo();
+  } else if (currentIndex() == m_editorindex) {
+    m_undo_history->undo();
+  }
+}
+
+void
+EBookWrapper::redo()
+{
+  if (currentIndex() == m_codeindex) {
+    m_codeeditor->redo();
+  } else if (currentIndex() == m_editorindex) {
+    m_undo_history->redo();
+  }
 }
 
 void
@@ -6,9 +6,14 @@
 #include "ebookcodeeditor.h"
 #include "ebookcommon.h"
 #include "ebookeditor.h"
+#include "ebooksourcemap.h"
 #include "metadataeditor.h"
 
+class EBookEditJournal;
+class EBookStatisticsTracker;
+class EBookUndoHistory;
 class EBookWordReader;
+class ISpellInterface;
 
 class EBookWrapper : public QStackedWidget
 {
@@ -30,6 +35,13 @@ public:
   MetadataEditor* metaEditor();
   void optionsHaveChanged();
   void startWordReader();
+  void setSpellChecker(ISpellInterface* checker);
+  void setProfileOverlay(bool show);
+  void undo();
+  void redo();
+  EBookMemoryUsage memoryUsage() const;
+  EBookStatisticsTracker* statistics();
+  EBookEditJournal* journal();
 
   void update();
 
@@ -37,9 +49,19 @@ protected:
   EBookEditor* m_editor;
   EBookCodeEditor* m_codeeditor;
   MetadataEditor* m_metaeditor;
-  //  EBookWordReader* m_word_reader;
+  EBookWordReader* m_word_reader;
+  EBookUndoHistory* m_undo_history;
+  EBookStatisticsTracker* m_statistics;
+  EBookEditJournal* m_journal;
   int m_editorindex, m_codeindex, m_metaindex;
   Options* m_options;
+  // maps the book editor's chapter to the code shown in the code editor.
+  EBookSourceMap m_source_map;
+  int m_code_chapter;
+
+  void editorDocumentLoaded();
+  void textChanged(int position, int removed, int added);
+  void codeChanged(int position, int removed, int added);
 };
 
 #endif // EBOOKWRAPPER_H
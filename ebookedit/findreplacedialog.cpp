@@ -0,0 +1,216 @@
+#include "findreplacedialog.h"
+
+FindReplaceDialog::FindReplaceDialog(QWidget* parent)
+  : QDialog(parent)
+{
+  setWindowTitle(tr("Find and Replace in Book"));
+
+  m_search = new EBookBookSearch(this);
+  connect(m_search,
+          &EBookBookSearch::hitsFound,
+          this,
+          &FindReplaceDialog::hitsFound);
+  connect(m_search,
+          &EBookBookSearch::finished,
+          this,
+          &FindReplaceDialog::searchFinished);
+
+  QVBoxLayout* layout = new QVBoxLayout;
+  setLayout(layout);
+
+  QFormLayout* form = new QFormLayout;
+  layout->addLayout(form);
+  m_find_edit = new QLineEdit(this);
+  form->addRow(tr("Find :"), m_find_edit);
+  connect(
+    m_find_edit, &QLineEdit::returnPressed, this, &FindReplaceDialog::find);
+  connect(m_find_edit,
+          &QLineEdit::textChanged,
+          this,
+          &FindReplaceDialog::updateButtons);
+  m_replace_edit = new QLineEdit(this);
+  form->addRow(tr("Replace :"), m_replace_edit);
+
+  QHBoxLayout* options = new QHBoxLayout;
+  layout->addLayout(options);
+  m_regex_box = new QCheckBox(tr("Regular expression"), this);
+  options->addWidget(m_regex_box);
+  m_case_box = new QCheckBox(tr("Match case"), this);
+  options->addWidget(m_case_box);
+  options->addStretch();
+
+  QHBoxLayout* actions = new QHBoxLayout;
+  layout->addLayout(actions);
+  m_find_button = new QPushButton(tr("Find All"), this);
+  actions->addWidget(m_find_button);
+  connect(
+    m_find_button, &QPushButton::clicked, this, &FindReplaceDialog::find);
+  m_replace_button = new QPushButton(tr("Replace All"), this);
+  actions->addWidget(m_replace_button);
+  connect(m_replace_button,
+          &QPushButton::clicked,
+          this,
+          &FindReplaceDialog::replaceAll);
+  m_undo_button = new QPushButton(tr("Undo Replace"), this);
+  actions->addWidget(m_undo_button);
+  connect(m_undo_button,
+          &QPushButton::clicked,
+          this,
+          &FindReplaceDialog::undoReplace);
+  actions->addStretch();
+
+  m_results = new QListWidget(this);
+  layout->addWidget(m_results);
+  connect(m_results,
+          &QListWidget::itemActivated,
+          this,
+          &FindReplaceDialog::activate);
+
+  m_status = new QLabel(this);
+  layout->addWidget(m_status);
+
+  QDialogButtonBox* buttons =
+    new QDialogButtonBox(QDialogButtonBox::Close, Qt::Horizontal, this);
+  connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+  layout->addWidget(buttons);
+
+  updateButtons();
+}
+
+/*!
+ * \brief Searches another book, the hits of the last one are dropped.
+ */
+void
+FindReplaceDialog::setDocument(IEBookDocument* document)
+{
+  if (document == m_search->document()) {
+    return;
+  }
+  m_search->setDocument(document);
+  m_hits.clear();
+  m_results->clear();
+  m_status->clear();
+  updateButtons();
+}
+
+IEBookDocument*
+FindReplaceDialog::document() const
+{
+  return m_search->document();
+}
+
+void
+FindReplaceDialog::find()
+{
+  QRegularExpression regex = expression();
+  if (!regex.isValid()) {
+    m_status->setText(tr("Invalid expression : %1").arg(regex.errorString()));
+    return;
+  }
+  m_hits.clear();
+  m_results->clear();
+  m_timer.start();
+  if (m_search->start(regex)) {
+    m_status->setText(tr("Searching..."));
+  }
+  updateButtons();
+}
+
+void
+FindReplaceDialog::replaceAll()
+{
+  QRegularExpression regex = expression();
+  if (m_search->isRunning() || !regex.isValid()) {
+    return;
+  }
+  int replaced = m_search->replaceAll(regex, m_replace_edit->text());
+  m_hits.clear();
+  m_results->clear();
+  m_status->setText(tr("%1 matches replaced").arg(replaced));
+  updateButtons();
+}
+
+void
+FindReplaceDialog::undoReplace()
+{
+  if (m_search->undoReplace()) {
+    m_status->setText(tr("Replace undone"));
+  }
+  m_hits.clear();
+  m_results->clear();
+  updateButtons();
+}
+
+/*
+ * Hits arrive a chapter at a time while the rest of the book is searched.
+ */
+void
+FindReplaceDialog::hitsFound(const BookHitList& hits)
+{
+  foreach (EBookBookHit hit, hits) {
+    addHit(hit);
+  }
+  m_status->setText(tr("Searching, %1 matches").arg(m_hits.size()));
+}
+
+/*
+ * The list is rebuilt in book order once every chapter has been searched.
+ */
+void
+FindReplaceDialog::searchFinished()
+{
+  m_hits.clear();
+  m_results->clear();
+  foreach (EBookBookHit hit, m_search->hits()) {
+    addHit(hit);
+  }
+  m_status->setText(
+    tr("%1 matches in %2 ms").arg(m_hits.size()).arg(m_timer.elapsed()));
+  updateButtons();
+}
+
+void
+FindReplaceDialog::activate(QListWidgetItem* item)
+{
+  int row = m_results->row(item);
+  if (row >= 0 && row < m_hits.size()) {
+    emit hitActivated(m_hits.at(row));
+  }
+}
+
+void
+FindReplaceDialog::updateButtons()
+{
+  bool has_document = (m_search->document() != nullptr);
+  bool has_text = !m_find_edit->text().isEmpty();
+  m_find_button->setEnabled(has_document && has_text);
+  m_replace_button->setEnabled(has_document && has_text &&
+                               !m_search->isRunning());
+  m_undo_button->setEnabled(m_search->canUndoReplace());
+}
+
+/*
+ * Plain text is escaped so that it is matched as it is.
+ */
+QRegularExpression
+FindReplaceDialog::expression() const
+{
+  QString pattern = m_find_edit->text();
+  if (!m_regex_box->isChecked()) {
+    pattern = QRegularExpression::escape(pattern);
+  }
+  QRegularExpression::PatternOptions options =
+    QRegularExpression::NoPatternOption;
+  if (!m_case_box->isChecked()) {
+    options |= QRegularExpression::CaseInsensitiveOption;
+  }
+  return QRegularExpression(pattern, options);
+}
+
+void
+FindReplaceDialog::addHit(const EBookBookHit& hit)
+{
+  m_hits.append(hit);
+  m_results->addItem(
+    tr("%1, %2 : %3").arg(hit.chapter + 1).arg(hit.offset).arg(hit.context));
+}
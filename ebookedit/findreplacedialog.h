@@ -0,0 +1,52 @@
+#ifndef FINDREPLACEDIALOG_H
+#define FINDREPLACEDIALOG_H
+
+#include <QtWidgets>
+
+#include "ebookbooksearch.h"
+
+/*!
+ * \brief Finds and replaces a regular expression in the xhtml of every
+ * chapter of the book shown.
+ *
+ * Hits are listed as they are found. Activating one emits hitActivated()
+ * so that the editor can move to it.
+ */
+class FindReplaceDialog : public QDialog
+{
+  Q_OBJECT
+public:
+  FindReplaceDialog(QWidget* parent = nullptr);
+
+  void setDocument(IEBookDocument* document);
+  IEBookDocument* document() const;
+
+signals:
+  void hitActivated(const EBookBookHit& hit);
+
+protected:
+  EBookBookSearch* m_search;
+  QLineEdit* m_find_edit;
+  QLineEdit* m_replace_edit;
+  QCheckBox* m_regex_box;
+  QCheckBox* m_case_box;
+  QPushButton* m_find_button;
+  QPushButton* m_replace_button;
+  QPushButton* m_undo_button;
+  QListWidget* m_results;
+  QLabel* m_status;
+  BookHitList m_hits;
+  QElapsedTimer m_timer;
+
+  void find();
+  void replaceAll();
+  void undoReplace();
+  void hitsFound(const BookHitList& hits);
+  void searchFinished();
+  void activate(QListWidgetItem* item);
+  void updateButtons();
+  QRegularExpression expression() const;
+  void addHit(const EBookBookHit& hit);
+};
+
+#endif // FINDREPLACEDIALOG_H
@@ -3,10 +3,20 @@
 #include <ebookcommon.h>
 
 #include "libraryshelf.h"
+#include "librarytreemodel.h"
 
-LibraryFrame::LibraryFrame(Options* options, QWidget* parent)
+LibraryFrame::LibraryFrame(Options* options,
+                           AuthorsDB authors_db,
+                           SeriesDB series_db,
+                           LibraryDB library_db,
+                           EBookThumbnailCache* thumbnails,
+                           QWidget* parent)
   : QWidget(parent)
   , m_options(options)
+  , m_authors_db(authors_db)
+  , m_series_db(series_db)
+  , m_library_db(library_db)
+  , m_thumbnails(thumbnails)
 {
   initGui();
 }
@@ -21,25 +31,86 @@ void LibraryFrame::initGui()
   m_stack = new QStackedWidget(this);
   main_layout->addWidget(m_stack);
 
-  m_library_tree = new QTreeWidget(this);
-  m_stack_tree = m_stack->addWidget(m_library_tree);
+  QWidget* tree_page = new QWidget(this);
+  QVBoxLayout* tree_layout = new QVBoxLayout;
+  tree_layout->setContentsMargins(0, 0, 0, 0);
+  tree_page->setLayout(tree_layout);
+  m_tree_filter_edit = new QLineEdit(tree_page);
+  m_tree_filter_edit->setPlaceholderText(tr("Filter by author or title"));
+  m_tree_filter_edit->setClearButtonEnabled(true);
+  tree_layout->addWidget(m_tree_filter_edit);
+  m_library_tree = new QTreeView(tree_page);
+  tree_layout->addWidget(m_library_tree);
+  m_stack_tree = m_stack->addWidget(tree_page);
+  initTree();
 
-  m_library_shelf = new LibraryShelf(this);
+  m_library_shelf = new LibraryShelf(m_library_db, m_thumbnails, this);
   m_stack_shelf = m_stack->addWidget(m_library_shelf);
 
   setToTree();
 }
 
+/*!
+ * \brief Shows the library as a tree of authors and their books.
+ *
+ * The tree is a view on the databases, the rows are only created as they
+ * are scrolled to or expanded.
+ */
 void LibraryFrame::initTree()
 {
+  m_tree_model =
+    new LibraryTreeModel(m_authors_db, m_series_db, m_library_db, this);
+  m_tree_filter = new LibraryTreeFilter(m_library_db, this);
+  m_tree_filter->setSourceModel(m_tree_model);
+  m_library_tree->setHeaderHidden(true);
+  m_library_tree->setUniformRowHeights(true);
+  m_library_tree->setSelectionMode(QAbstractItemView::ExtendedSelection);
+  m_library_tree->setModel(m_tree_filter);
+  connect(m_tree_filter_edit,
+          &QLineEdit::textChanged,
+          m_tree_filter,
+          &LibraryTreeFilter::setFilterText);
 }
 
 void LibraryFrame::initShelf()
 {
 }
 
+/*!
+ * \brief Shows the books now in the library.
+ */
 void LibraryFrame::readLibrary()
 {
+  m_tree_model->reset();
+  m_library_shelf->setBooks(m_library_db->books());
+}
+
+/*!
+ * \brief The uids of the books selected in the view shown, a selected
+ * author in the tree stands for all of the author's books.
+ */
+QList<quint64> LibraryFrame::selectedBooks() const
+{
+  if (m_stack->currentIndex() == m_stack_shelf) {
+    return m_library_shelf->selectedBooks();
+  }
+  QList<quint64> uids;
+  foreach (const QModelIndex& index,
+           m_library_tree->selectionModel()->selectedIndexes()) {
+    QModelIndex source = m_tree_filter->mapToSource(index);
+    QList<quint64> books;
+    if (m_tree_model->isAuthor(source)) {
+      books = m_tree_model->authorBookUids(source);
+    } else {
+      books << source.data(LibraryTreeModel::UidRole).toULongLong();
+    }
+    foreach (quint64 uid, books) {
+      if (uid != 0 && !uids.contains(uid)) {
+        uids << uid;
+      }
+    }
+  }
+  return uids;
 }
 
 void LibraryFrame::setToShelf()
@@ -3,36 +3,58 @@
 
 #include <QFrame>
 #include <QHBoxLayout>
+#include <QLineEdit>
 #include <QStackedWidget>
-#include <QTreeWidget>
+#include <QTreeView>
+#include <QVBoxLayout>
 #include <QWidget>
 
+#include "authors.h"
+#include "library.h"
 #include "options.h"
+#include "series.h"
 
+class EBookThumbnailCache;
 class LibraryShelf;
+class LibraryTreeFilter;
+class LibraryTreeModel;
 
 class LibraryFrame : public QWidget
 {
   Q_OBJECT
 public:
-  explicit LibraryFrame(Options* options, QWidget* parent = nullptr);
+  explicit LibraryFrame(Options* options,
+                        AuthorsDB authors_db,
+                        SeriesDB series_db,
+                        LibraryDB library_db,
+                        EBookThumbnailCache* thumbnails,
+                        QWidget* parent = nullptr);
   ~LibraryFrame();
 
+  void readLibrary();
+  QList<quint64> selectedBooks() const;
+
   void setToShelf();
   void setToTree();
   bool isTree();
 
 protected:
   Options* m_options;
+  AuthorsDB m_authors_db;
+  SeriesDB m_series_db;
+  LibraryDB m_library_db;
+  EBookThumbnailCache* m_thumbnails;
   QStackedWidget* m_stack;
-  QTreeWidget* m_library_tree;
+  QLineEdit* m_tree_filter_edit;
+  QTreeView* m_library_tree;
+  LibraryTreeModel* m_tree_model;
+  LibraryTreeFilter* m_tree_filter;
   LibraryShelf* m_library_shelf;
   int m_stack_tree, m_stack_shelf;
 
   void initGui();
   void initTree();
   void initShelf();
-  void readLibrary();
 };
 
 #endif // LIBRARYFRAME_H
@@ -1,6 +1,201 @@
 #include "libraryshelf.h"
 
-LibraryShelf::LibraryShelf(QWidget* parent)
+#include <QHBoxLayout>
+
+#include <algorithm>
+
+#include "ebookthumbnailcache.h"
+
+LibraryShelfModel::LibraryShelfModel(LibraryDB library_db,
+                                     EBookThumbnailCache* thumbnails,
+                                     QObject* parent)
+  : QAbstractListModel(parent)
+  , m_library_db(library_db)
+  , m_thumbnails(thumbnails)
+  , m_placeholder(":/icons/library")
+{
+  connect(m_thumbnails,
+          &EBookThumbnailCache::thumbnailReady,
+          this,
+          &LibraryShelfModel::thumbnailReady);
+  connect(m_library_db.data(),
+          &EBookLibraryDB::bookAdded,
+          this,
+          &LibraryShelfModel::bookAdded);
+  connect(m_library_db.data(),
+          &EBookLibraryDB::bookChanged,
+          this,
+          &LibraryShelfModel::bookChanged);
+  connect(m_library_db.data(),
+          &EBookLibraryDB::bookRemoved,
+          this,
+          &LibraryShelfModel::bookRemoved);
+}
+
+void
+LibraryShelfModel::setBooks(BookList books)
+{
+  beginResetModel();
+  std::stable_sort(books.begin(), books.end(), &titleLessThan);
+  m_books = books;
+  m_rows.clear();
+  updateRows(0);
+  endResetModel();
+}
+
+/*!
+ * \brief The uid of the book in row, or 0 if there is no such row.
+ */
+quint64
+LibraryShelfModel::bookUid(int row) const
+{
+  return (row >= 0 && row < m_books.size() ? m_books.at(row)->uid : 0);
+}
+
+int
+LibraryShelfModel::rowCount(const QModelIndex& parent) const
+{
+  return (parent.isValid() ? 0 : m_books.size());
+}
+
+QVariant
+LibraryShelfModel::data(const QModelIndex& index, int role) const
+{
+  if (!index.isValid() || index.row() >= m_books.size()) {
+    return QVariant();
+  }
+  BookData book = m_books.at(index.row());
+  switch (role) {
+    case Qt::DisplayRole:
+      return book->title;
+    case Qt::ToolTipRole:
+      // the statistics are known once the book has been opened.
+      if (book->statistics.isEmpty()) {
+        return book->title;
+      }
+      return tr("%1\n%2").arg(book->title).arg(book->statistics.summary());
+    case Qt::DecorationRole: {
+      // the placeholder is shown until the thumbnail has been read.
+      QPixmap pixmap = m_thumbnails->thumbnail(book->uid);
+      return (pixmap.isNull() ? m_placeholder : pixmap);
+    }
+    default:
+      return QVariant();
+  }
+}
+
+void
+LibraryShelfModel::thumbnailReady(quint64 uid)
+{
+  int row = m_rows.value(uid, -1);
+  if (row >= 0) {
+    QModelIndex changed = index(row);
+    emit dataChanged(changed, changed, QVector<int>() << Qt::DecorationRole);
+  }
+}
+
+/*!
+ * \brief Renumbers the rows from first onwards after an insert or remove.
+ */
+void
+LibraryShelfModel::updateRows(int first)
+{
+  for (int row = first; row < m_books.size(); row++) {
+    m_rows.insert(m_books.at(row)->uid, row);
+  }
+}
+
+void
+LibraryShelfModel::bookAdded(quint64 uid)
+{
+  BookData book = m_library_db->bookByUid(uid);
+  if (book.isNull() || m_rows.contains(uid)) {
+    return;
+  }
+  int row = int(
+    std::upper_bound(m_books.begin(), m_books.end(), book, &titleLessThan) -
+    m_books.begin());
+  beginInsertRows(QModelIndex(), row, row);
+  m_books.insert(row, book);
+  updateRows(row);
+  endInsertRows();
+}
+
+void
+LibraryShelfModel::bookChanged(quint64 uid)
+{
+  // the title may have changed, so the book is moved to its new place.
+  bookRemoved(uid);
+  bookAdded(uid);
+}
+
+void
+LibraryShelfModel::bookRemoved(quint64 uid)
+{
+  int row = m_rows.value(uid, -1);
+  if (row < 0) {
+    return;
+  }
+  beginRemoveRows(QModelIndex(), row, row);
+  m_books.removeAt(row);
+  m_rows.remove(uid);
+  updateRows(row);
+  endRemoveRows();
+}
+
+bool
+LibraryShelfModel::titleLessThan(const BookData& a, const BookData& b)
+{
+  return (QString::localeAwareCompare(a->title, b->title) < 0);
+}
+
+LibraryShelf::LibraryShelf(LibraryDB library_db,
+                           EBookThumbnailCache* thumbnails,
+                           QWidget* parent)
   : QFrame(parent)
 {
+  QHBoxLayout* layout = new QHBoxLayout;
+  layout->setContentsMargins(0, 0, 0, 0);
+  setLayout(layout);
+
+  m_model = new LibraryShelfModel(library_db, thumbnails, this);
+
+  // uniform items and batched layout keep a large shelf from laying out
+  // every book before the first covers are shown.
+  m_view = new QListView(this);
+  m_view->setViewMode(QListView::IconMode);
+  m_view->setMovement(QListView::Static);
+  m_view->setResizeMode(QListView::Adjust);
+  m_view->setLayoutMode(QListView::Batched);
+  m_view->setUniformItemSizes(true);
+  m_view->setWordWrap(true);
+  m_view->setIconSize(QSize(EBookThumbnailCache::THUMBNAIL_SIZE,
+                            EBookThumbnailCache::THUMBNAIL_SIZE));
+  m_view->setGridSize(QSize(ITEM_WIDTH, ITEM_HEIGHT));
+  m_view->setSelectionMode(QAbstractItemView::ExtendedSelection);
+  m_view->setModel(m_model);
+  layout->addWidget(m_view);
+}
+
+void
+LibraryShelf::setBooks(BookList books)
+{
+  m_model->setBooks(books);
+}
+
+/*!
+ * \brief The uids of the selected books.
+ */
+QList<quint64>
+LibraryShelf::selectedBooks() const
+{
+  QList<quint64> uids;
+  foreach (const QModelIndex& index,
+           m_view->selectionModel()->selectedIndexes()) {
+    quint64 uid = m_model->bookUid(index.row());
+    if (uid != 0) {
+      uids << uid;
+    }
+  }
+  return uids;
 }
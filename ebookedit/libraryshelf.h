@@ -1,12 +1,70 @@
 #ifndef LIBRARYSHELF_H
 #define LIBRARYSHELF_H
 
+#include <QAbstractListModel>
 #include <QFrame>
+#include <QHash>
+#include <QListView>
+#include <QPixmap>
+
+#include "library.h"
+
+class EBookThumbnailCache;
+
+/*!
+ * \brief The books shown on a LibraryShelf, in title order.
+ *
+ * The cover thumbnails are only asked for when a book is painted, so only
+ * the visible covers are ever read. Books added to or removed from the
+ * library are inserted or removed singly.
+ */
+class LibraryShelfModel : public QAbstractListModel
+{
+  Q_OBJECT
+public:
+  LibraryShelfModel(LibraryDB library_db,
+                    EBookThumbnailCache* thumbnails,
+                    QObject* parent = 0);
+
+  void setBooks(BookList books);
+  quint64 bookUid(int row) const;
+
+  int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex& index,
+                int role = Qt::DisplayRole) const override;
+
+protected:
+  LibraryDB m_library_db;
+  EBookThumbnailCache* m_thumbnails;
+  BookList m_books;
+  QHash<quint64, int> m_rows;
+  QPixmap m_placeholder;
+
+  void updateRows(int first);
+  void thumbnailReady(quint64 uid);
+  void bookAdded(quint64 uid);
+  void bookChanged(quint64 uid);
+  void bookRemoved(quint64 uid);
+
+  static bool titleLessThan(const BookData& a, const BookData& b);
+};
 
 class LibraryShelf : public QFrame
 {
 public:
-  LibraryShelf(QWidget* parent = 0);
+  LibraryShelf(LibraryDB library_db,
+               EBookThumbnailCache* thumbnails,
+               QWidget* parent = 0);
+
+  void setBooks(BookList books);
+  QList<quint64> selectedBooks() const;
+
+protected:
+  QListView* m_view;
+  LibraryShelfModel* m_model;
+
+  static const int ITEM_WIDTH = 150;
+  static const int ITEM_HEIGHT = 180;
 };
 
 #endif // LIBRARYSHELF_H
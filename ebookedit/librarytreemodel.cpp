@@ -0,0 +1,481 @@
+#include "librarytreemodel.h"
+
+#include <algorithm>
+
+LibraryTreeModel::LibraryTreeModel(AuthorsDB authors_db,
+                                   SeriesDB series_db,
+                                   LibraryDB library_db,
+                                   QObject* parent)
+  : QAbstractItemModel(parent)
+  , m_authors_db(authors_db)
+  , m_series_db(series_db)
+  , m_library_db(library_db)
+  , m_loaded(false)
+  , m_fetched(0)
+{
+  connect(m_authors_db.data(),
+          &EBookAuthorsDB::authorAdded,
+          this,
+          &LibraryTreeModel::authorAdded);
+  connect(m_authors_db.data(),
+          &EBookAuthorsDB::authorRemoved,
+          this,
+          &LibraryTreeModel::authorRemoved);
+  connect(m_authors_db.data(),
+          &EBookAuthorsDB::authorBookAdded,
+          this,
+          &LibraryTreeModel::authorBookAdded);
+  connect(m_library_db.data(),
+          &EBookLibraryDB::bookChanged,
+          this,
+          &LibraryTreeModel::bookChanged);
+  connect(m_library_db.data(),
+          &EBookLibraryDB::bookRemoved,
+          this,
+          &LibraryTreeModel::bookRemoved);
+}
+
+/*!
+ * \brief Reads the author keys once the databases have been loaded.
+ *
+ * Until this is called the model is empty and the database signals are
+ * ignored.
+ */
+void
+LibraryTreeModel::reset()
+{
+  beginResetModel();
+  m_authors.clear();
+  m_author_keys.clear();
+  m_books.clear();
+  m_fetched = 0;
+  AuthorList authors = m_authors_db->authors();
+  m_authors.reserve(authors.size());
+  foreach (AuthorData author, authors) {
+    LibraryTreeAuthor entry;
+    entry.key = authorKey(author);
+    entry.uid = author->uid();
+    m_authors.append(entry);
+    m_author_keys.insert(entry.uid, entry.key);
+  }
+  std::sort(m_authors.begin(), m_authors.end());
+  m_loaded = true;
+  endResetModel();
+}
+
+/*!
+ * \brief Returns true for an author row, false for a book row.
+ */
+bool
+LibraryTreeModel::isAuthor(const QModelIndex& index) const
+{
+  return (index.isValid() && index.internalId() == 0);
+}
+
+/*!
+ * \brief Returns the uids of the books of an author row, whether or not
+ * they have been fetched.
+ */
+QList<quint64>
+LibraryTreeModel::authorBookUids(const QModelIndex& index) const
+{
+  if (!isAuthor(index)) {
+    return QList<quint64>();
+  }
+  AuthorData author = m_authors_db->author(m_authors.at(index.row()).uid);
+  return (author.isNull() ? QList<quint64>() : author->books());
+}
+
+/*
+ * The internal id of an author index is 0, that of a book index is the uid
+ * of its author.
+ */
+QModelIndex
+LibraryTreeModel::index(int row, int column, const QModelIndex& parent) const
+{
+  if (row < 0 || column != 0) {
+    return QModelIndex();
+  }
+  if (!parent.isValid()) {
+    return (row < m_fetched ? createIndex(row, column, quintptr(0))
+                            : QModelIndex());
+  }
+  if (!isAuthor(parent)) {
+    return QModelIndex();
+  }
+  quint64 uid = m_authors.at(parent.row()).uid;
+  if (row < m_books.value(uid).size()) {
+    return createIndex(row, column, quintptr(uid));
+  }
+  return QModelIndex();
+}
+
+QModelIndex
+LibraryTreeModel::parent(const QModelIndex& child) const
+{
+  if (!child.isValid() || isAuthor(child)) {
+    return QModelIndex();
+  }
+  int row = authorRow(child.internalId());
+  return (row < 0 ? QModelIndex() : createIndex(row, 0, quintptr(0)));
+}
+
+int
+LibraryTreeModel::rowCount(const QModelIndex& parent) const
+{
+  if (!parent.isValid()) {
+    return m_fetched;
+  }
+  if (parent.column() > 0 || !isAuthor(parent)) {
+    return 0;
+  }
+  return m_books.value(m_authors.at(parent.row()).uid).size();
+}
+
+int
+LibraryTreeModel::columnCount(const QModelIndex& /*parent*/) const
+{
+  return 1;
+}
+
+/*!
+ * \brief Authors show an expander before their books have been fetched.
+ */
+bool
+LibraryTreeModel::hasChildren(const QModelIndex& parent) const
+{
+  if (!parent.isValid()) {
+    return !m_authors.isEmpty();
+  }
+  if (!isAuthor(parent)) {
+    return false;
+  }
+  quint64 uid = m_authors.at(parent.row()).uid;
+  if (m_books.contains(uid)) {
+    return !m_books.value(uid).isEmpty();
+  }
+  return !authorBookUids(parent).isEmpty();
+}
+
+bool
+LibraryTreeModel::canFetchMore(const QModelIndex& parent) const
+{
+  if (!parent.isValid()) {
+    return (m_fetched < m_authors.size());
+  }
+  return (isAuthor(parent) &&
+          !m_books.contains(m_authors.at(parent.row()).uid));
+}
+
+void
+LibraryTreeModel::fetchMore(const QModelIndex& parent)
+{
+  if (!parent.isValid()) {
+    int count = qMin(FETCH_SIZE, m_authors.size() - m_fetched);
+    if (count > 0) {
+      beginInsertRows(QModelIndex(), m_fetched, m_fetched + count - 1);
+      m_fetched += count;
+      endInsertRows();
+    }
+    return;
+  }
+  if (!isAuthor(parent)) {
+    return;
+  }
+
+  quint64 uid = m_authors.at(parent.row()).uid;
+  QVector<quint64> uids;
+  foreach (BookData book, authorBooks(m_authors_db->author(uid))) {
+    uids.append(book->uid);
+  }
+  if (uids.isEmpty()) {
+    m_books.insert(uid, uids);
+    return;
+  }
+  beginInsertRows(parent, 0, uids.size() - 1);
+  m_books.insert(uid, uids);
+  endInsertRows();
+}
+
+QVariant
+LibraryTreeModel::data(const QModelIndex& index, int role) const
+{
+  if (!index.isValid()) {
+    return QVariant();
+  }
+
+  if (isAuthor(index)) {
+    const LibraryTreeAuthor& entry = m_authors.at(index.row());
+    if (role == UidRole) {
+      return entry.uid;
+    } else if (role == KeyRole) {
+      return entry.key;
+    } else if (role == Qt::DisplayRole) {
+      AuthorData author = m_authors_db->author(entry.uid);
+      if (author.isNull()) {
+        return QVariant();
+      }
+      return (author->displayName().isEmpty() ? author->fileAs()
+                                              : author->displayName());
+    }
+    return QVariant();
+  }
+
+  quint64 uid = m_books.value(index.internalId()).value(index.row());
+  if (role == UidRole) {
+    return uid;
+  }
+  BookData book = m_library_db->bookByUid(uid);
+  if (book.isNull()) {
+    return QVariant();
+  }
+  switch (role) {
+    case Qt::DisplayRole:
+      return bookText(book);
+    case Qt::ToolTipRole:
+      return book->filename;
+    case KeyRole:
+      return book->title.toLower();
+    default:
+      return QVariant();
+  }
+}
+
+/*!
+ * \brief Finds the row of an author from its key, without a search of the
+ * rows.
+ *
+ * \return the row, or -1 if the author is not in the model.
+ */
+int
+LibraryTreeModel::authorRow(quint64 uid) const
+{
+  QHash<quint64, QString>::const_iterator key = m_author_keys.constFind(uid);
+  if (key == m_author_keys.constEnd()) {
+    return -1;
+  }
+  LibraryTreeAuthor probe;
+  probe.key = key.value();
+  probe.uid = uid;
+  LibraryTreeAuthors::const_iterator it =
+    std::lower_bound(m_authors.constBegin(), m_authors.constEnd(), probe);
+  if (it == m_authors.constEnd() || it->uid != uid) {
+    return -1;
+  }
+  return int(it - m_authors.constBegin());
+}
+
+/*!
+ * \brief The books of an author that are still in the library, in title
+ * order.
+ */
+BookList
+LibraryTreeModel::authorBooks(AuthorData author) const
+{
+  BookList books;
+  if (author.isNull()) {
+    return books;
+  }
+  foreach (quint64 uid, author->books()) {
+    BookData book = m_library_db->bookByUid(uid);
+    if (!book.isNull()) {
+      books.append(book);
+    }
+  }
+  std::stable_sort(
+    books.begin(), books.end(), [](const BookData& a, const BookData& b) {
+      return (QString::localeAwareCompare(a->title, b->title) < 0);
+    });
+  return books;
+}
+
+QString
+LibraryTreeModel::bookText(BookData book) const
+{
+  if (book->series == 0) {
+    return book->title;
+  }
+  SeriesData series = m_series_db->series(book->series);
+  if (series.isNull()) {
+    return book->title;
+  }
+  return tr("%1 (%2 %3)").arg(book->title, series->name, book->series_index);
+}
+
+QString
+LibraryTreeModel::authorKey(AuthorData author)
+{
+  return EBookAuthorsDB::normalizedName(
+    author->fileAs().isEmpty() ? author->displayName() : author->fileAs());
+}
+
+/*!
+ * \brief Inserts a new author at its sorted position, it is only announced
+ * to the view if its row has already been fetched.
+ */
+void
+LibraryTreeModel::authorAdded(quint64 uid)
+{
+  if (!m_loaded || m_author_keys.contains(uid)) {
+    return;
+  }
+  AuthorData author = m_authors_db->author(uid);
+  if (author.isNull()) {
+    return;
+  }
+  LibraryTreeAuthor entry;
+  entry.key = authorKey(author);
+  entry.uid = uid;
+  int row = int(std::lower_bound(m_authors.begin(), m_authors.end(), entry) -
+                m_authors.begin());
+  m_author_keys.insert(uid, entry.key);
+
+  // rows beyond the fetched ones will be picked up by fetchMore().
+  bool visible = (row < m_fetched || m_fetched == m_authors.size());
+  if (visible) {
+    beginInsertRows(QModelIndex(), row, row);
+  }
+  m_authors.insert(row, entry);
+  if (visible) {
+    m_fetched++;
+    endInsertRows();
+  }
+}
+
+void
+LibraryTreeModel::authorRemoved(quint64 uid)
+{
+  int row = authorRow(uid);
+  if (row < 0) {
+    return;
+  }
+  bool visible = (row < m_fetched);
+  if (visible) {
+    beginRemoveRows(QModelIndex(), row, row);
+  }
+  m_authors.remove(row);
+  m_author_keys.remove(uid);
+  m_books.remove(uid);
+  if (visible) {
+    m_fetched--;
+    endRemoveRows();
+  }
+}
+
+/*!
+ * \brief Adds a book to an author that has already been expanded.
+ */
+void
+LibraryTreeModel::authorBookAdded(quint64 author_uid, quint64 book_uid)
+{
+  if (!m_books.contains(author_uid)) {
+    return;
+  }
+  int author_row = authorRow(author_uid);
+  BookData book = m_library_db->bookByUid(book_uid);
+  QVector<quint64>& books = m_books[author_uid];
+  if (author_row < 0 || book.isNull() || books.contains(book_uid)) {
+    return;
+  }
+  int row = 0;
+  while (row < books.size()) {
+    BookData other = m_library_db->bookByUid(books.at(row));
+    if (!other.isNull() &&
+        QString::localeAwareCompare(book->title, other->title) < 0) {
+      break;
+    }
+    row++;
+  }
+  beginInsertRows(createIndex(author_row, 0, quintptr(0)), row, row);
+  books.insert(row, book_uid);
+  endInsertRows();
+}
+
+void
+LibraryTreeModel::bookChanged(quint64 uid)
+{
+  for (QHash<quint64, QVector<quint64>>::const_iterator it = m_books.begin();
+       it != m_books.end();
+       ++it) {
+    int row = it.value().indexOf(uid);
+    int author_row = authorRow(it.key());
+    if (row >= 0 && author_row >= 0) {
+      QModelIndex changed = createIndex(row, 0, quintptr(it.key()));
+      emit dataChanged(changed, changed);
+    }
+  }
+}
+
+void
+LibraryTreeModel::bookRemoved(quint64 uid)
+{
+  foreach (quint64 author_uid, m_books.keys()) {
+    QVector<quint64>& books = m_books[author_uid];
+    int row = books.indexOf(uid);
+    int author_row = authorRow(author_uid);
+    if (row < 0 || author_row < 0) {
+      continue;
+    }
+    beginRemoveRows(createIndex(author_row, 0, quintptr(0)), row, row);
+    books.remove(row);
+    endRemoveRows();
+  }
+}
+
+LibraryTreeFilter::LibraryTreeFilter(LibraryDB library_db, QObject* parent)
+  : QSortFilterProxyModel(parent)
+  , m_library_db(library_db)
+{
+  setSortRole(LibraryTreeModel::KeyRole);
+}
+
+/*!
+ * \brief Shows only the authors whose names contain text and the books
+ * whose titles contain it, an empty text shows everything.
+ */
+void
+LibraryTreeFilter::setFilterText(const QString& text)
+{
+  m_key = EBookAuthorsDB::normalizedName(text.trimmed());
+  m_matching_books.clear();
+  if (!m_key.isEmpty()) {
+    foreach (BookData book, m_library_db->searchTitles(text, MAX_MATCHES)) {
+      m_matching_books.insert(book->uid);
+    }
+  }
+  invalidateFilter();
+}
+
+bool
+LibraryTreeFilter::filterAcceptsRow(int source_row,
+                                    const QModelIndex& source_parent) const
+{
+  if (m_key.isEmpty()) {
+    return true;
+  }
+  QModelIndex index = sourceModel()->index(source_row, 0, source_parent);
+  if (!source_parent.isValid()) {
+    if (authorMatches(index)) {
+      return true;
+    }
+    LibraryTreeModel* model = qobject_cast<LibraryTreeModel*>(sourceModel());
+    if (model) {
+      foreach (quint64 uid, model->authorBookUids(index)) {
+        if (m_matching_books.contains(uid)) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+  // all of the books of a matching author are shown.
+  return (authorMatches(source_parent) ||
+          m_matching_books.contains(
+            index.data(LibraryTreeModel::UidRole).toULongLong()));
+}
+
+bool
+LibraryTreeFilter::authorMatches(const QModelIndex& author) const
+{
+  return author.data(LibraryTreeModel::KeyRole).toString().contains(m_key);
+}
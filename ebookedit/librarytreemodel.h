@@ -0,0 +1,123 @@
+#ifndef LIBRARYTREEMODEL_H
+#define LIBRARYTREEMODEL_H
+
+#include <QAbstractItemModel>
+#include <QHash>
+#include <QSet>
+#include <QSortFilterProxyModel>
+#include <QVector>
+
+#include "authors.h"
+#include "library.h"
+#include "series.h"
+
+/*!
+ * \brief An author row of a LibraryTreeModel.
+ */
+struct LibraryTreeAuthor
+{
+  QString key; // the folded file as name the authors are ordered by.
+  quint64 uid = 0;
+
+  bool operator<(const LibraryTreeAuthor& other) const
+  {
+    return (key < other.key || (key == other.key && uid < other.uid));
+  }
+};
+typedef QVector<LibraryTreeAuthor> LibraryTreeAuthors;
+
+/*!
+ * \brief The library as a tree of authors and their books.
+ *
+ * No item is created for a row, the indexes refer straight into the
+ * databases. The top level holds only a sorted vector of author keys, its
+ * rows are handed to the view a batch at a time through fetchMore() as it
+ * scrolls, and the books of an author are only looked up when the author
+ * is first expanded. Once reset() has been called the model follows the
+ * database signals, inserting and removing single rows rather than being
+ * rebuilt.
+ */
+class LibraryTreeModel : public QAbstractItemModel
+{
+  Q_OBJECT
+public:
+  enum Roles
+  {
+    UidRole = Qt::UserRole,
+    KeyRole, // the folded name or title used to sort and filter.
+  };
+
+  LibraryTreeModel(AuthorsDB authors_db,
+                   SeriesDB series_db,
+                   LibraryDB library_db,
+                   QObject* parent = nullptr);
+
+  void reset();
+  bool isAuthor(const QModelIndex& index) const;
+  QList<quint64> authorBookUids(const QModelIndex& index) const;
+
+  QModelIndex index(int row,
+                    int column,
+                    const QModelIndex& parent = QModelIndex()) const override;
+  QModelIndex parent(const QModelIndex& child) const override;
+  int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+  int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+  bool hasChildren(const QModelIndex& parent = QModelIndex()) const override;
+  bool canFetchMore(const QModelIndex& parent) const override;
+  void fetchMore(const QModelIndex& parent) override;
+  QVariant data(const QModelIndex& index,
+                int role = Qt::DisplayRole) const override;
+
+protected:
+  AuthorsDB m_authors_db;
+  SeriesDB m_series_db;
+  LibraryDB m_library_db;
+  bool m_loaded;
+  LibraryTreeAuthors m_authors;
+  QHash<quint64, QString> m_author_keys;
+  int m_fetched;
+  // the books of the authors that have been expanded, in title order.
+  QHash<quint64, QVector<quint64>> m_books;
+
+  int authorRow(quint64 uid) const;
+  BookList authorBooks(AuthorData author) const;
+  QString bookText(BookData book) const;
+  static QString authorKey(AuthorData author);
+
+  void authorAdded(quint64 uid);
+  void authorRemoved(quint64 uid);
+  void authorBookAdded(quint64 author_uid, quint64 book_uid);
+  void bookChanged(quint64 uid);
+  void bookRemoved(quint64 uid);
+
+  static const int FETCH_SIZE = 500;
+};
+
+/*!
+ * \brief Filters a LibraryTreeModel by author name or book title.
+ *
+ * The matching books are found once per filter from the library title
+ * index, rather than by testing the title of every row, and authors are
+ * matched on their folded names so accents and case are ignored.
+ */
+class LibraryTreeFilter : public QSortFilterProxyModel
+{
+  Q_OBJECT
+public:
+  LibraryTreeFilter(LibraryDB library_db, QObject* parent = nullptr);
+
+  void setFilterText(const QString& text);
+
+protected:
+  LibraryDB m_library_db;
+  QString m_key;
+  QSet<quint64> m_matching_books;
+
+  bool filterAcceptsRow(int source_row,
+                        const QModelIndex& source_parent) const override;
+  bool authorMatches(const QModelIndex& author) const;
+
+  static const int MAX_MATCHES = 10000;
+};
+
+#endif // LIBRARYTREEMODEL_H
@@ -4,6 +4,7 @@
 #include "ebookcodeeditor.h"
 #include "ebookcommon.h"
 #include "ebookeditor.h"
+#include "ebooktrace.h"
 #include "iebookdocument.h"
 //#include "epubdocument.h"
 //#include "mobidocument.h"
@@ -15,6 +16,8 @@ main(int argc, char* argv[])
   //  QCoreApplication::setOrganizationName("SM Electronic Components");
   //  QCoreApplication::setOrganizationDomain("smelecomp.co.uk");
   QCoreApplication::setApplicationName("Biblos");
+  // before the plugins are loaded, so that they share the trace.
+  EBookTrace::install();
 
   qRegisterMetaType<EBookEditor>();
   qRegisterMetaType<EBookCodeEditor>();
@@ -1,5 +1,7 @@
 #include "mainwindow.h"
 
+#include <QtConcurrent>
+
 #include <qlogger/qlogger.h>
 
 #include "iebookinterface.h"
@@ -9,19 +11,35 @@
 #include "iebookdocument.h"
 
 #include "ebookcodeeditor.h"
+#include "ebookduplicatefinder.h"
+#include "ebookeditjournal.h"
 #include "ebookeditor.h"
+#include "ebookimporter.h"
+#include "ebookindexer.h"
+#include "ebookmetadatabatch.h"
+#include "ebooklibrarywatcher.h"
+#include "ebookstatisticstracker.h"
+#include "ebookthumbnailcache.h"
 
 #include "ebooktoceditor.h"
 #include "ebooktocwidget.h"
+#include "ebooktrace.h"
 #include "ebookwordreader.h"
+#include "ebookbooksearch.h"
 #include "ebookwrapper.h"
 #include "libraryframe.h"
 
 #include "aboutdialog.h"
+#include "database.h"
 #include "authordialog.h"
+#include "batchmetadatadialog.h"
+#include "comparedialog.h"
+#include "findreplacedialog.h"
+#include "memorydialog.h"
 #include "libraryframe.h"
 #include "optionsdialog.h"
 #include "plugindialog.h"
+#include "searchdialog.h"
 
 using namespace qlogger;
 
@@ -35,13 +53,25 @@ const QString MainWindow::PREF_FILE = "preferences.yaml";
 const QString MainWindow::LIB_FILE = "library.yaml";
 const QString MainWindow::AUTHOR_FILE = "authors.yaml";
 const QString MainWindow::SERIES_FILE = "series.yaml";
-// const QString MainWindow::DB_NAME = "library.sqlite";
+const QString MainWindow::PORTRAIT_DIRECTORY = "portraits";
+const QString MainWindow::DB_NAME = "library.sqlite";
 
 MainWindow::MainWindow(QWidget* parent)
   : QMainWindow(parent)
   , m_initialising(true)
   , m_loading(false)
   , m_options(new Options(this))
+  , m_import_progress(nullptr)
+  , m_batch_progress(nullptr)
+  , m_indexer(nullptr)
+  , m_library_watcher(nullptr)
+  , m_duplicate_finder(nullptr)
+  , m_search_dialog(nullptr)
+  , m_find_replace_dialog(nullptr)
+  , m_pending_databases(0)
+  , m_databases_loaded(false)
+  , m_profiling(false)
+  , m_pending_library_index(-1)
   , m_bookcount(0)
   , m_popup(nullptr)
   , m_current_spell_checker(nullptr)
@@ -56,12 +86,51 @@ MainWindow::MainWindow(QWidget* parent)
   m_authors_db = AuthorsDB(new EBookAuthorsDB());
   m_series_db = SeriesDB(new EBookSeriesDB());
   m_library_db = LibraryDB(new EBookLibraryDB(m_series_db));
+  m_importer = new EBookImporter(
+    m_options, m_authors_db, m_series_db, m_library_db, this);
+  connect(m_importer,
+          &EBookImporter::progress,
+          this,
+          &MainWindow::importProgress);
+  connect(m_importer,
+          &EBookImporter::finished,
+          this,
+          &MainWindow::importFinished);
+  m_metadata_batch = new EBookMetadataBatch(
+    m_authors_db, m_series_db, m_library_db, this);
+  connect(m_metadata_batch,
+          &EBookMetadataBatch::progress,
+          this,
+          &MainWindow::batchProgress);
+  connect(m_metadata_batch,
+          &EBookMetadataBatch::finished,
+          this,
+          &MainWindow::batchFinished);
+  m_indexer = new EBookIndexer(m_options, m_library_db, this);
+  connect(
+    m_indexer, &EBookIndexer::progress, this, &MainWindow::indexProgress);
+  connect(
+    m_indexer, &EBookIndexer::finished, this, &MainWindow::indexFinished);
+  m_thumbnails = new EBookThumbnailCache(m_options, m_library_db, this);
+  m_library_watcher = new EBookLibraryWatcher(
+    m_options, m_authors_db, m_series_db, m_library_db, this);
+  connect(m_library_watcher,
+          &EBookLibraryWatcher::booksUpdated,
+          this,
+          &MainWindow::libraryBooksUpdated);
+  connect(m_library_watcher,
+          &EBookLibraryWatcher::booksRemoved,
+          this,
+          &MainWindow::libraryBooksRemoved);
+  m_duplicate_finder = new EBookDuplicateFinder(m_library_db, this);
+  connect(m_duplicate_finder,
+          &EBookDuplicateFinder::duplicatesFound,
+          this,
+          &MainWindow::duplicatesFound);
 
   connect(
     m_options, &Options::loadLibraryFiles, this, &MainWindow::loadLibraryFiles);
 
-  loadPlugins();
-  initBuild();
   QDir dir;
   m_options->setHomeDirectiory(QStandardPaths::locate(
     QStandardPaths::HomeLocation, QString(), QStandardPaths::LocateDirectory));
@@ -71,6 +140,9 @@ MainWindow::MainWindow(QWidget* parent)
   m_options->setConfigDirectory(
     QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation));
   dir.mkpath(m_options->configDirectory());
+  m_options->setCacheDirectory(
+    QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+  dir.mkpath(m_options->cacheDirectory());
   m_options->setConfigFile(m_options->configDirectory() + QDir::separator() +
                            PREF_FILE);
   m_options->setLibraryFile(m_options->configDirectory() + QDir::separator() +
@@ -79,28 +151,53 @@ MainWindow::MainWindow(QWidget* parent)
                             AUTHOR_FILE);
   m_options->setSeriesFile(m_options->configDirectory() + QDir::separator() +
                            SERIES_FILE);
-  loadAuthors();
-  loadSeries();
-  loadLibrary();
-
-  //  /* The database file will be created automatically by SqLite if it
-  //   * does not exist. The tables are created if they do not already exist.
-  //   */
-  //  QString db_path = m_config_directory + QDir::separator() + DB_NAME;
-  //  m_database = new DbManager(db_path, parent);
-
+  m_authors_db->setImageDirectory(m_options->configDirectory() +
+                                  QDir::separator() + PORTRAIT_DIRECTORY);
+
+  /* The database file will be created automatically by SqLite if it
+   * does not exist. The tables are created if they do not already exist and
+   * the yaml files are copied into them on first use.
+   */
+  if (Options::readSqliteStorage(m_options->configFile())) {
+    m_database = Database(new EBookDatabase());
+    if (m_database->open(m_options->configDirectory() + QDir::separator() +
+                         DB_NAME)) {
+      m_authors_db->setDatabase(m_database);
+      m_series_db->setDatabase(m_database);
+      m_library_db->setDatabase(m_database);
+    }
+  }
+  // the databases load in the background while the plugins are loaded and
+  // the window is built, any books left open are opened once they finish.
+  loadDatabases();
+  loadPlugins();
+  m_thumbnails->setPlugins(ebookPlugins());
+  initBuild();
+  m_file_open->setEnabled(m_databases_loaded);
+  m_file_import->setEnabled(m_databases_loaded);
+  m_file_batch_metadata->setEnabled(m_databases_loaded);
   initSetup();
+  if (m_databases_loaded) {
+    m_indexer->start(ebookPlugins());
+    m_library_watcher->start(ebookPlugins());
+    m_duplicate_finder->start();
+    m_library_frame->readLibrary();
+  }
 
   m_initialising = false;
 }
 
-MainWindow::~MainWindow() {}
+MainWindow::~MainWindow()
+{
+  qDeleteAll(m_plugins);
+}
 
 void
 MainWindow::resizeEvent(QResizeEvent* e)
 {
-  QSize size = e->size();
-  m_options->rect().setSize(size);
+  QRect rect = m_options->rect();
+  rect.setSize(e->size());
+  m_options->setRect(rect);
   if (!m_initialising)
     saveOptions();
 }
@@ -156,7 +253,13 @@ MainWindow::initGui()
           &MainWindow::setObjectVisibility);
   setCentralWidget(m_doc_stack);
 
-  m_library_frame = new LibraryFrame(m_options, this);
+  m_library_frame =
+    new LibraryFrame(m_options,
+                     m_authors_db,
+                     m_series_db,
+                     m_library_db,
+                     m_thumbnails,
+                     this);
   // These could not be created when the action was as l_library was still null.
   connect(m_library_shelf,
           &QAction::triggered,
@@ -219,6 +322,11 @@ MainWindow::initFileMenu()
   m_filemenu = menuBar()->addMenu(tr("&File"));
   m_filemenu->addAction(m_file_new);
   m_filemenu->addAction(m_file_open);
+  m_filemenu->addAction(m_file_import);
+  m_filemenu->addAction(m_file_resolve_imports);
+  m_filemenu->addAction(m_file_batch_metadata);
+  m_filemenu->addAction(m_file_search);
+  m_filemenu->addAction(m_file_compare);
   m_filemenu->addSeparator();
   m_filemenu->addAction(m_file_save);
   m_filemenu->addAction(m_file_save_as);
@@ -239,6 +347,8 @@ MainWindow::initEditMenu()
   m_editmenu->addAction(m_edit_paste);
   m_editmenu->addAction(m_edit_paste_history);
   m_editmenu->addSeparator();
+  m_editmenu->addAction(m_edit_find_replace);
+  m_editmenu->addSeparator();
   m_spellingmenu = m_editmenu->addMenu(tr("Spelling"));
   m_spellingmenu->addAction(m_edit_spellcheck);
   m_spellingmenu->addSeparator();
@@ -279,8 +389,14 @@ MainWindow::initHelpMenu()
   m_helpmenu->addSeparator();
   m_helpmenu->addAction(m_help_about_ebookeditor);
   m_helpmenu->addAction(m_help_about_plugins);
+  m_helpmenu->addAction(m_help_memory_usage);
   m_helpmenu->addSeparator();
   m_helpmenu->addAction(m_help_check_updates);
+  if (EBookTrace::isEnabled()) {
+    m_helpmenu->addSeparator();
+    m_helpmenu->addAction(m_help_save_trace);
+    m_helpmenu->addAction(m_help_profiling);
+  }
 }
 
 void
@@ -311,6 +427,38 @@ MainWindow::initFileActions()
   m_file_open->setStatusTip(tr("Open a new file."));
   connect(m_file_open, &QAction::triggered, this, &MainWindow::fileOpen);
 
+  m_file_import = new QAction(tr("&Import Directory.."), this);
+  m_file_import->setStatusTip(
+    tr("Copy all of the books in a directory into the library."));
+  connect(m_file_import, &QAction::triggered, this, &MainWindow::fileImport);
+
+  m_file_resolve_imports = new QAction(tr("&Resolve Imported Books.."), this);
+  m_file_resolve_imports->setStatusTip(
+    tr("Open the imported books that need author information."));
+  m_file_resolve_imports->setEnabled(false);
+  connect(m_file_resolve_imports,
+          &QAction::triggered,
+          this,
+          &MainWindow::fileResolveImports);
+
+  m_file_batch_metadata = new QAction(tr("Edit Library &Metadata.."), this);
+  m_file_batch_metadata->setStatusTip(
+    tr("Change the metadata of the books selected in the library."));
+  connect(m_file_batch_metadata,
+          &QAction::triggered,
+          this,
+          &MainWindow::fileBatchMetadata);
+
+  m_file_search = new QAction(tr("Search &Library.."), this);
+  m_file_search->setShortcut(QKeySequence(tr("Ctrl+Shift+F")));
+  m_file_search->setStatusTip(tr("Find words in any book in the library."));
+  connect(m_file_search, &QAction::triggered, this, &MainWindow::fileSearch);
+
+  m_file_compare = new QAction(tr("&Compare Books.."), this);
+  m_file_compare->setStatusTip(
+    tr("Show the differences between two versions of a book."));
+  connect(m_file_compare, &QAction::triggered, this, &MainWindow::fileCompare);
+
   m_file_save = new QAction(save_icon, tr("&Save"), this);
   m_file_save->setShortcut(QKeySequence::Save);
   m_file_save->setStatusTip(tr("Save the current file."));
@@ -430,6 +578,15 @@ MainWindow::initEditActions()
   connect(
     m_edit_paste_history, &QAction::triggered, this, &MainWindow::editCopy);
 
+  m_edit_find_replace = new QAction(tr("Find and &Replace in Book..."), this);
+  m_edit_find_replace->setShortcut(QKeySequence::Replace);
+  m_edit_find_replace->setStatusTip(
+    tr("Find and replace in every chapter of the book."));
+  connect(m_edit_find_replace,
+          &QAction::triggered,
+          this,
+          &MainWindow::editFindReplace);
+
   m_edit_options = new QAction(tr("Preferences"), this);
   m_edit_options->setShortcut(QKeySequence::Preferences);
   m_edit_options->setStatusTip(tr("Modify preferences."));
@@ -456,19 +613,21 @@ MainWindow::initEditActions()
   m_edit_send_to_booklist =
     new QAction(tr("Send Word to Book Dictionary"), this);
   //  m_editoptions->setShortcut(QKeySequence::Preferences);
-  m_edit_options->setStatusTip(
+  m_edit_send_to_booklist->setStatusTip(
     tr("This allows you to create a dictionary specifically for this book."));
-  connect(
-    m_edit_options, &QAction::triggered, this, &MainWindow::editSendToBookList);
+  connect(m_edit_send_to_booklist,
+          &QAction::triggered,
+          this,
+          &MainWindow::editSendToBookList);
 
   m_edit_send_to_authorlist =
     new QAction(tr("Send Word to Author Dictionary"), this);
   //  m_editoptions->setShortcut(QKeySequence::Preferences);
-  m_edit_options->setStatusTip(
+  m_edit_send_to_authorlist->setStatusTip(
     tr("This allows you to create a dictionary specifically for this Author. "
        "Generally you would use this for an Authors Series where the same, "
        "possibly name or non-standard word might be used in muyltiple books."));
-  connect(m_edit_options,
+  connect(m_edit_send_to_authorlist,
           &QAction::triggered,
           this,
           &MainWindow::editSendToAuthorList);
@@ -532,6 +691,28 @@ MainWindow::initHelpActions()
   m_help_contents->setStatusTip(tr("Access Help Contents."));
   connect(
     m_help_contents, &QAction::triggered, this, &MainWindow::helpCheckUpdates);
+
+  m_help_memory_usage = new QAction(tr("Memory Usage..."), this);
+  m_help_memory_usage->setStatusTip(
+    tr("Shows the memory held by each open book."));
+  connect(m_help_memory_usage,
+          &QAction::triggered,
+          this,
+          &MainWindow::helpMemoryUsage);
+
+  m_help_save_trace = new QAction(tr("Save Trace..."), this);
+  m_help_save_trace->setStatusTip(
+    tr("Saves the timings of the latest work, for chrome://tracing."));
+  connect(
+    m_help_save_trace, &QAction::triggered, this, &MainWindow::helpSaveTrace);
+
+  m_help_profiling = new QAction(tr("Show Profiling Overlay"), this);
+  m_help_profiling->setCheckable(true);
+  m_help_profiling->setStatusTip(
+    tr("Shows the time spent highlighting, laying out and painting in each "
+       "frame of the editors."));
+  connect(
+    m_help_profiling, &QAction::toggled, this, &MainWindow::helpProfiling);
 }
 
 void
@@ -589,9 +770,139 @@ MainWindow::initStatusbar()
   m_readonlylbl->setFrameStyle(QFrame::StyledPanel);
   m_modifiedlbl = new QLabel(NOT_MODIFIED, this);
   m_modifiedlbl->setFrameStyle(QFrame::StyledPanel);
+  m_memorylbl = new QLabel(this);
+  m_memorylbl->setFrameStyle(QFrame::StyledPanel);
+  m_memorylbl->setVisible(false);
+  m_statisticslbl = new QLabel(this);
+  m_statisticslbl->setFrameStyle(QFrame::StyledPanel);
+  m_statisticslbl->setVisible(false);
+  statusBar()->addPermanentWidget(m_statisticslbl);
+  statusBar()->addPermanentWidget(m_memorylbl);
   statusBar()->addPermanentWidget(m_filelbl);
   statusBar()->addPermanentWidget(m_modifiedlbl);
   statusBar()->addPermanentWidget(m_readonlylbl);
+
+  m_memory_timer = new QTimer(this);
+  m_memory_timer->setInterval(MEMORY_INTERVAL);
+  connect(
+    m_memory_timer, &QTimer::timeout, this, &MainWindow::updateMemoryUsage);
+  m_memory_timer->start();
+}
+
+/*
+ * Shows the memory held by the book shown, if the options ask for it.
+ */
+void
+MainWindow::updateMemoryUsage()
+{
+  EBookWrapper* wrapper =
+    qobject_cast<EBookWrapper*>(m_doc_tabs->currentWidget());
+  if (!m_options->showMemoryUsage() || !wrapper) {
+    m_memorylbl->setVisible(false);
+    return;
+  }
+  EBookMemoryUsage usage = wrapper->memoryUsage();
+  m_memorylbl->setText(MemoryDialog::formatBytes(usage.total()));
+  m_memorylbl->setToolTip(
+    tr("Images %1, SVGs %2, documents %3, CSS/JS %4, resources %5, "
+       "text %6, undo %7")
+      .arg(MemoryDialog::formatBytes(usage.images))
+      .arg(MemoryDialog::formatBytes(usage.svgs))
+      .arg(MemoryDialog::formatBytes(usage.documents))
+      .arg(MemoryDialog::formatBytes(usage.styles))
+      .arg(MemoryDialog::formatBytes(usage.resources))
+      .arg(MemoryDialog::formatBytes(usage.text_document))
+      .arg(MemoryDialog::formatBytes(usage.undo)));
+  m_memorylbl->setVisible(true);
+}
+
+/*
+ * Shows the statistics of the book shown and of its current chapter.
+ */
+void
+MainWindow::updateStatistics()
+{
+  EBookWrapper* wrapper =
+    qobject_cast<EBookWrapper*>(m_doc_tabs->currentWidget());
+  if (!wrapper) {
+    m_statisticslbl->setVisible(false);
+    return;
+  }
+  EBookStatistics chapter = wrapper->statistics()->chapterStatistics();
+  EBookStatistics book = wrapper->statistics()->bookStatistics();
+  QLocale locale;
+  m_statisticslbl->setText(
+    tr("Chapter %1, book %2").arg(chapter.summary()).arg(book.summary()));
+  m_statisticslbl->setToolTip(
+    tr("Chapter : %1 characters, %2 different words\n"
+       "Book : %3 characters, %4 different words in %5 chapters%6")
+      .arg(locale.toString(chapter.characters))
+      .arg(locale.toString(chapter.unique_words))
+      .arg(locale.toString(book.characters))
+      .arg(locale.toString(book.unique_words))
+      .arg(book.chapters)
+      .arg(wrapper->statistics()->isComplete() ? QString()
+                                               : tr(", still counting")));
+  m_statisticslbl->setVisible(true);
+}
+
+/*
+ * Stores the statistics of a book in the library once every chapter has
+ * been counted, so that the library can show them.
+ */
+void
+MainWindow::storeStatistics(EBookWrapper* wrapper)
+{
+  IEBookDocument* document = wrapper->editor()->ebookDocument();
+  if (!document || !wrapper->statistics()->isComplete()) {
+    return;
+  }
+  BookData book = m_library_db->bookByFile(document->filename());
+  if (book) {
+    m_library_db->setStatistics(book->uid,
+                                wrapper->statistics()->bookStatistics());
+  }
+}
+
+/*
+ * Stores the chapter and block at the top of the view, with the index of
+ * the chapter's blocks added to those already stored, so the book opens
+ * there next time.
+ */
+void
+MainWindow::storePosition(EBookWrapper* wrapper)
+{
+  IEBookDocument* document = wrapper->editor()->ebookDocument();
+  if (!document) {
+    return;
+  }
+  BookData book = m_library_db->bookByFile(document->filename());
+  if (book) {
+    int chapter = document->currentChapter();
+    EBookBlockIndex block_index = book->block_index;
+    block_index.index(chapter, wrapper->editor()->document());
+    m_library_db->setPosition(
+      book->uid, chapter, wrapper->editor()->topBlock(), block_index);
+  }
+}
+
+/*
+ * Shows the chapter and block that the book was left at.
+ */
+void
+MainWindow::restorePosition(EBookWrapper* wrapper)
+{
+  IEBookDocument* document = wrapper->editor()->ebookDocument();
+  if (!document) {
+    return;
+  }
+  BookData book = m_library_db->bookByFile(document->filename());
+  if (book && (book->current_spine_index > 0 ||
+               book->current_spine_lineno > 0)) {
+    wrapper->editor()->showBlock(book->current_spine_index,
+                                 book->current_spine_lineno,
+                                 book->block_index);
+  }
 }
 
 void
@@ -625,32 +936,113 @@ MainWindow::initToolbar()
 void
 MainWindow::loadLibraryFiles(QStringList current_lib_files, int currentindex)
 {
-  if (!current_lib_files.empty()) {
-    foreach (QString filename, current_lib_files) {
-      //      filename = filename;
-      QFile file(filename);
-      if (file.exists()) {
-        loadDocument(filename, true);
-      }
-      if (currentindex >= 0 && m_doc_tabs->count() > currentindex) {
-        m_doc_tabs->setCurrentIndex(currentindex);
-      } else {
-        m_doc_tabs->setCurrentIndex(0);
-      }
+  if (!m_databases_loaded) {
+    // opening a book needs the databases so wait for them.
+    m_pending_library_files = current_lib_files;
+    m_pending_library_index = currentindex;
+    return;
+  }
+  QStringList files;
+  foreach (QString filename, current_lib_files) {
+    if (QFile::exists(filename)) {
+      files.append(filename);
+    }
+  }
+  if (files.isEmpty()) {
+    return;
+  }
+  // only the current book is opened now, the other tabs wait until they
+  // are first shown.
+  int current = (currentindex >= 0 && currentindex < files.size()
+                   ? currentindex
+                   : 0);
+  for (int i = 0; i < files.size(); i++) {
+    if (i == current) {
+      loadDocument(files.at(i), true);
+    } else {
+      addPlaceholderTab(files.at(i));
     }
   }
+  if (current < m_doc_tabs->count()) {
+    m_doc_tabs->setCurrentIndex(current);
+  }
+}
+
+/*!
+ * \brief Adds a tab for a book that is only opened when the tab is first
+ * shown.
+ *
+ * The title comes from the library, so the book is not read at all.
+ */
+void
+MainWindow::addPlaceholderTab(const QString& filename)
+{
+  m_loading = true;
+  QString tabname = libraryTabName(filename);
+  QLabel* placeholder = new QLabel(tr("Loading %1...").arg(tabname), this);
+  placeholder->setAlignment(Qt::AlignCenter);
+  m_tab_placeholders.insert(placeholder, filename);
+  m_doc_tabs->addTab(placeholder, tabname);
+  // the toc stack keeps one page for every tab.
+  m_toc_stack->addWidget(new QWidget(this));
+  m_doc_stack->setCurrentIndex(m_stack_editor);
+  m_doc_tabs->setEnabled(true);
+  m_show_library->setVisible(true);
+  m_show_editor->setVisible(false);
+  m_loading = false;
+}
+
+/*
+ * The title of a book as the library has it, so that it can be shown before
+ * the book has been read.
+ */
+QString
+MainWindow::libraryTabName(const QString& filename)
+{
+  BookData book = m_library_db->bookByFile(filename);
+  if (!book.isNull() && !book->title.isEmpty()) {
+    return book->title;
+  }
+  return QFileInfo(filename).completeBaseName();
+}
+
+/*!
+ * \brief Opens the book of a placeholder tab in its place.
+ */
+void
+MainWindow::loadPlaceholderTab(int index)
+{
+  QWidget* placeholder = m_doc_tabs->widget(index);
+  QString filename = m_tab_placeholders.take(placeholder);
+  if (filename.isEmpty()) {
+    return;
+  }
+  m_loading = true;
+  m_doc_tabs->removeTab(index);
+  QWidget* toc_placeholder = m_toc_stack->widget(index);
+  m_toc_stack->removeWidget(toc_placeholder);
+  toc_placeholder->deleteLater();
+  placeholder->deleteLater();
+  // the tab may only be the parsing placeholder for now.
+  loadDocument(filename, true, index);
+  if (index >= m_doc_tabs->count()) {
+    return;
+  }
+  if (m_doc_tabs->currentIndex() != index) {
+    m_doc_tabs->setCurrentIndex(index);
+  } else {
+    documentChanged(index);
+  }
 }
 
+/*!
+ * \brief The type of a book from the signatures registered by the plugins.
+ */
 EBookDocumentType
 MainWindow::checkMimetype(QString filename)
 {
-  QMimeDatabase db;
-  QMimeType mime = db.mimeTypeForFile(filename, QMimeDatabase::MatchDefault);
-
-  if (mime.name() == "application/epub+zip")
-    return EPUB;
-  // TODO add further mime types.
-  return UNSUPPORTED_TYPE;
+  IEBookInterface* plugin = m_type_sniffer.plugin(filename);
+  return (plugin ? plugin->type() : UNSUPPORTED_TYPE);
 }
 
 void
@@ -660,10 +1052,14 @@ MainWindow::loadOptions()
   setObjectVisibility();
 }
 
+/*
+ * Changes often come in bursts, window moves and resizes for instance, so
+ * the options are written in the background once they stop changing.
+ */
 void
 MainWindow::saveOptions()
 {
-  m_options->save(m_options->configFile());
+  m_options->saveLater(m_options->configFile());
 }
 
 void
@@ -702,6 +1098,132 @@ MainWindow::saveAuthors()
   m_authors_db->save();
 }
 
+/*!
+ * \brief Starts loading the library, authors and series databases.
+ *
+ * The yaml files are read concurrently in the global thread pool and
+ * databasesLoaded() is called once all three have been read. Older author
+ * files hold pixmaps so only the authors file is parsed in the background,
+ * the authors themselves are built in the GUI thread. The SQLite connection
+ * belongs to this thread so if it is in use the databases are loaded
+ * directly, which is fast as only the records are read.
+ */
+void
+MainWindow::loadDatabases()
+{
+  if (m_database) {
+    loadAuthors();
+    loadSeries();
+    loadLibrary();
+    databasesLoaded();
+    return;
+  }
+
+  m_pending_databases = 3;
+  QString authors_file = m_options->authorsFile();
+  QFutureWatcher<YAML::Node>* authors_watcher =
+    new QFutureWatcher<YAML::Node>(this);
+  connect(authors_watcher,
+          &QFutureWatcher<YAML::Node>::finished,
+          this,
+          [this, authors_watcher, authors_file]() {
+            m_authors_db->load(authors_file, authors_watcher->result());
+            authors_watcher->deleteLater();
+            databaseLoaded();
+          });
+  authors_watcher->setFuture(
+    QtConcurrent::run(&EBookAuthorsDB::parseFile, authors_file));
+
+  QFutureWatcher<bool>* series_watcher = new QFutureWatcher<bool>(this);
+  connect(series_watcher,
+          &QFutureWatcher<bool>::finished,
+          this,
+          [this, series_watcher]() {
+            series_watcher->deleteLater();
+            databaseLoaded();
+          });
+  series_watcher->setFuture(QtConcurrent::run(
+    m_series_db.data(), &EBookSeriesDB::load, m_options->seriesFile()));
+
+  QFutureWatcher<bool>* library_watcher = new QFutureWatcher<bool>(this);
+  connect(library_watcher,
+          &QFutureWatcher<bool>::finished,
+          this,
+          [this, library_watcher]() {
+            library_watcher->deleteLater();
+            databaseLoaded();
+          });
+  library_watcher->setFuture(QtConcurrent::run(
+    m_library_db.data(), &EBookLibraryDB::load, m_options->libraryFile()));
+}
+
+void
+MainWindow::databaseLoaded()
+{
+  m_pending_databases--;
+  if (m_pending_databases == 0) {
+    databasesLoaded();
+  }
+}
+
+/*!
+ * \brief Called once all the databases have loaded, opens the books that
+ * were open when Biblos was last closed.
+ */
+void
+MainWindow::databasesLoaded()
+{
+  m_databases_loaded = true;
+  if (!m_initialising) {
+    m_file_open->setEnabled(true);
+    m_file_import->setEnabled(true);
+    m_file_batch_metadata->setEnabled(true);
+    m_indexer->start(ebookPlugins());
+    m_library_watcher->start(ebookPlugins());
+    m_duplicate_finder->start();
+    m_library_frame->readLibrary();
+  }
+  recoverEdits();
+  if (!m_pending_library_files.isEmpty()) {
+    loadLibraryFiles(m_pending_library_files, m_pending_library_index);
+    m_pending_library_files.clear();
+  }
+  // recovered books that were not open when Biblos stopped.
+  QStringList session;
+  foreach (QString filename, m_options->currentfiles()) {
+    session.append(QFileInfo(filename).absoluteFilePath());
+  }
+  foreach (QString filename, m_recover_files.values()) {
+    if (!session.contains(filename)) {
+      loadDocument(filename, true);
+    }
+  }
+}
+
+/*!
+ * \brief Asks whether to recover the edits journalled to books that were
+ * not saved before Biblos last stopped.
+ *
+ * The books to recover have their edits replayed as they are opened, see
+ * addDocumentTab().
+ */
+void
+MainWindow::recoverEdits()
+{
+  foreach (QString book, EBookEditJournal::recoverableBooks(m_options)) {
+    QMessageBox::StandardButton button = QMessageBox::question(
+      this,
+      tr("Recover Edits"),
+      tr("Biblos closed with unsaved edits to %1. Recover them?")
+        .arg(QFileInfo(book).fileName()));
+    if (button == QMessageBox::Yes) {
+      m_recover_files.insert(book);
+    } else {
+      EBookEditJournal::discardBook(m_options, book);
+    }
+  }
+}
+
 void
 MainWindow::initSetup()
 {
@@ -857,6 +1379,12 @@ MainWindow::selectAuthorNames(QString filename, QString title)
   // First see if the author name is in the title.
   QStringList names = attemptToExtractAuthorFromFilename(filename, title);
   if (!names.isEmpty()) {
+    // the filename may just hold a known author, possibly misspelt.
+    AuthorData author = m_authors_db->findAuthor(names.join(" "));
+    if (!author.isNull()) {
+      authors << author;
+      return authors;
+    }
     author_dlg = new AuthorDialog(m_options, m_authors_db, this);
     if (author_dlg->execute(AuthorDialog::FromTitle, title, names) ==
         QDialog::Accepted) {
@@ -966,6 +1494,9 @@ MainWindow::copyToLibraryAndOpen(QString& filename,
         filename = out_file.fileName();
       } else if (btn == QMessageBox::Open) { // Use Library Version.
         filename = out_file.fileName();
+        // the library version may have been edited so it has to be parsed.
+        delete ebook_document;
+        ebook_document = ebook_plugin->createDocument(filename);
       } else if (btn == QMessageBox::Save) { // Save As.
         bool ok;
         QString text = QInputDialog::getText(this,
@@ -995,12 +1526,19 @@ MainWindow::copyToLibraryAndOpen(QString& filename,
       }
     }
   }
+
+  // the copy is identical to the file that was parsed, so the document is
+  // moved to it rather than parsed again.
+  if (ebook_document->filename() != filename) {
+    ebook_document->setFilename(filename);
+  }
   return ebook_document;
 }
 
 void
-MainWindow::loadDocument(QString file_name, bool from_library)
+MainWindow::loadDocument(QString file_name, bool from_library, int index)
 {
+  EBOOK_TRACE_SCOPE("MainWindow::loadDocument");
   m_loading = true;
   QString filename = file_name;
   EBookDocumentType ebook_type = checkMimetype(filename);
@@ -1015,71 +1553,214 @@ MainWindow::loadDocument(QString file_name, bool from_library)
     }
   }
 
+  if (ebook_plugin && from_library && ebook_plugin->parsesInBackground()) {
+    // parsed in a worker thread, the tab shows progress until it is done.
+    parseDocument(filename, ebook_plugin, index);
+    m_loading = false;
+    return;
+  }
+
   IEBookDocument* ebook_document;
   if (ebook_plugin) {
     if (!from_library) {
       ebook_document = copyToLibraryAndOpen(filename, ebook_plugin);
-    } // end of if (from_library)
-
-    // reload the ebook document from the library version of the file.
-    ebook_document = ebook_plugin->createDocument(filename);
-    ITextDocument* itextdocument;
-    EBookWrapper* wrapper;
-    QString tabname;
-    itextdocument = dynamic_cast<ITextDocument*>(ebook_document);
-    //    htmldocument->setPlugin(ebook_plugin);
-    //    IEBookDocument* codeDocument = ebook_plugin->createCodeDocument();
-    wrapper = new EBookWrapper(
-      m_options, m_authors_db, m_series_db, m_library_db, this);
-    wrapper->editor()->setDocument(ebook_document);
-
-    EBookTOCWidget* toc_widget = new EBookTOCWidget(this);
-    toc_widget->setOpenLinks(false);
-    //  m_toc->setTextInteractionFlags(Qt::NoTextInteraction);
-    connect(toc_widget,
-            &EBookTOCWidget::anchorClicked,
-            this,
-            &MainWindow::tocAnchorClicked);
-    connect(toc_widget,
-            &EBookTOCWidget::buildTocFromHtmlFiles,
-            this,
-            &MainWindow::buildTocFromData);
-    connect(toc_widget,
-            &EBookTOCWidget::buildManualToc,
-            this,
-            &MainWindow::builManualToc);
-    connect(toc_widget,
-            &EBookTOCWidget::addAnchorsToToc,
-            this,
-            &MainWindow::addTocAnchors);
-    toc_widget->setDocumentString(ebook_document->tocAsString());
+    } else {
+      ebook_document = ebook_plugin->createDocument(filename);
+    }
+    addDocumentTab(ebook_document, filename, index);
+  } // end of is(ebook_plugin)
+
+  m_loading = false;
+}
+
+/*!
+ * \brief Builds the editor tab and table of contents of an open book.
+ *
+ * \param index the position of the tab, or -1 to add it at the end.
+ */
+void
+MainWindow::addDocumentTab(IEBookDocument* ebook_document,
+                           const QString& filename,
+                           int index)
+{
+  ITextDocument* itextdocument;
+  EBookWrapper* wrapper;
+  QString tabname;
+  itextdocument = dynamic_cast<ITextDocument*>(ebook_document);
+  //    htmldocument->setPlugin(ebook_plugin);
+  //    IEBookDocument* codeDocument = ebook_plugin->createCodeDocument();
+  wrapper = new EBookWrapper(
+    m_options, m_authors_db, m_series_db, m_library_db, this);
+  loadWordLists(ebook_document);
+  wrapper->setSpellChecker(spellChecker());
+  wrapper->setProfileOverlay(m_profiling);
+  connect(wrapper->statistics(),
+          &EBookStatisticsTracker::statisticsChanged,
+          this,
+          [this, wrapper]() {
+            if (m_doc_tabs->currentWidget() == wrapper) {
+              updateStatistics();
+            }
+          });
+  wrapper->editor()->setDocument(ebook_document);
+  if (m_recover_files.remove(
+        QFileInfo(ebook_document->filename()).absoluteFilePath()) &&
+      wrapper->journal()->recover()) {
+    statusBar()->showMessage(
+      tr("Recovered the unsaved edits to %1").arg(filename));
+  }
+  restorePosition(wrapper);
+
+  EBookTOCWidget* toc_widget = new EBookTOCWidget(this);
+  toc_widget->setOpenLinks(false);
+  //  m_toc->setTextInteractionFlags(Qt::NoTextInteraction);
+  connect(toc_widget,
+          &EBookTOCWidget::anchorClicked,
+          this,
+          &MainWindow::tocAnchorClicked);
+  connect(toc_widget,
+          &EBookTOCWidget::buildTocFromHtmlFiles,
+          this,
+          &MainWindow::buildTocFromData);
+  connect(toc_widget,
+          &EBookTOCWidget::buildManualToc,
+          this,
+          &MainWindow::builManualToc);
+  connect(toc_widget,
+          &EBookTOCWidget::addAnchorsToToc,
+          this,
+          &MainWindow::addTocAnchors);
+  toc_widget->setToc(ebook_document->toc());
+  if (index >= 0 && index <= m_toc_stack->count()) {
+    m_toc_stack->insertWidget(index, toc_widget);
+  } else {
     m_toc_stack->addWidget(toc_widget);
+  }
 
-    tabname =
-      QString(tr("%1, (%2)")
-                .arg(ebook_document->title())
-                .arg(ebook_document->creatorNames(ebook_document->creators())));
+  tabname =
+    QString(tr("%1, (%2)")
+              .arg(ebook_document->title())
+              .arg(ebook_document->creatorNames(ebook_document->creators())));
+  if (index >= 0 && index <= m_doc_tabs->count()) {
+    m_doc_tabs->insertTab(index, wrapper, tabname);
+  } else {
     m_doc_tabs->addTab(wrapper, tabname);
-    m_current_document = dynamic_cast<QTextDocument*>(ebook_document);
-    connect(itextdocument,
-            &ITextDocument::loadCompleted,
-            wrapper,
-            &EBookWrapper::update);
-
-    wrapper->metaEditor()->setDocument(itextdocument);
-
-    // set up the editor state correctly (editor visible, show_library btn
-    // visible)
-    m_doc_stack->setCurrentIndex(m_stack_editor);
-    m_doc_tabs->setEnabled(true);
-    m_show_library->setVisible(true);
-    m_show_editor->setVisible(false);
-    m_options->appendCurrentFile(filename);
-    saveOptions();
+  }
+  m_current_document = dynamic_cast<QTextDocument*>(ebook_document);
+  connect(itextdocument,
+          &ITextDocument::loadCompleted,
+          wrapper,
+          &EBookWrapper::update);
 
-  } // end of is(ebook_plugin)
+  wrapper->metaEditor()->setDocument(itextdocument);
+
+  // set up the editor state correctly (editor visible, show_library btn
+  // visible)
+  m_doc_stack->setCurrentIndex(m_stack_editor);
+  m_doc_tabs->setEnabled(true);
+  m_show_library->setVisible(true);
+  m_show_editor->setVisible(false);
+  m_options->appendCurrentFile(filename);
+  saveOptions();
+}
+
+/*!
+ * \brief Parses a book in the global thread pool.
+ *
+ * A tab with a busy indicator holds the book's place until it has been
+ * parsed, then the document is built on this thread and replaces it. Any
+ * number of books can be parsed at once.
+ */
+void
+MainWindow::parseDocument(const QString& filename,
+                          IEBookInterface* ebook_plugin,
+                          int index)
+{
+  QString tabname = libraryTabName(filename);
+  QWidget* placeholder = new QWidget(this);
+  QVBoxLayout* layout = new QVBoxLayout;
+  placeholder->setLayout(layout);
+  layout->addStretch();
+  QLabel* label = new QLabel(tr("Opening %1...").arg(tabname), placeholder);
+  label->setAlignment(Qt::AlignCenter);
+  layout->addWidget(label);
+  QProgressBar* progress = new QProgressBar(placeholder);
+  // parsing gives no progress of its own so the bar just shows it is busy.
+  progress->setRange(0, 0);
+  layout->addWidget(progress);
+  layout->addStretch();
+
+  m_loading = true;
+  if (index >= 0 && index <= m_doc_tabs->count()) {
+    m_doc_tabs->insertTab(index, placeholder, tabname);
+    m_toc_stack->insertWidget(index, new QWidget(this));
+  } else {
+    m_doc_tabs->addTab(placeholder, tabname);
+    m_toc_stack->addWidget(new QWidget(this));
+  }
+  m_doc_stack->setCurrentIndex(m_stack_editor);
+  m_doc_tabs->setEnabled(true);
+  m_show_library->setVisible(true);
+  m_show_editor->setVisible(false);
+  m_loading = false;
+
+  QFutureWatcher<QObject*>* watcher = new QFutureWatcher<QObject*>(this);
+  m_parsing_tabs.insert(watcher, placeholder);
+  connect(watcher, &QFutureWatcher<QObject*>::finished, this, [=]() {
+    documentParsed(watcher, filename, ebook_plugin);
+  });
+  QThread* gui_thread = thread();
+  watcher->setFuture(QtConcurrent::run([=]() {
+    return ebook_plugin->parseDocument(filename, gui_thread);
+  }));
+}
+
+/*
+ * Replaces the placeholder tab of a parsed book with the book, unless the
+ * tab was closed in the meantime.
+ */
+void
+MainWindow::documentParsed(QFutureWatcher<QObject*>* watcher,
+                           const QString& filename,
+                           IEBookInterface* ebook_plugin)
+{
+  QWidget* placeholder = m_parsing_tabs.take(watcher);
+  QObject* parsed = watcher->result();
+  watcher->deleteLater();
+
+  int index = (placeholder ? m_doc_tabs->indexOf(placeholder) : -1);
+  if (index < 0) {
+    delete parsed;
+    return;
+  }
+  bool current = (m_doc_tabs->currentIndex() == index);
+  m_loading = true;
+  m_doc_tabs->removeTab(index);
+  QWidget* toc_placeholder = m_toc_stack->widget(index);
+  m_toc_stack->removeWidget(toc_placeholder);
+  toc_placeholder->deleteLater();
+  placeholder->deleteLater();
+  m_loading = false;
 
+  IEBookDocument* ebook_document =
+    (parsed ? ebook_plugin->createParsedDocument(parsed) : nullptr);
+  if (!ebook_document) {
+    QLOG_DEBUG(tr("Unable to open %1").arg(filename));
+    if (current && m_doc_tabs->currentIndex() >= 0) {
+      documentChanged(m_doc_tabs->currentIndex());
+    }
+    return;
+  }
+  m_loading = true;
+  addDocumentTab(ebook_document, filename, index);
   m_loading = false;
+  if (current) {
+    if (m_doc_tabs->currentIndex() != index) {
+      m_doc_tabs->setCurrentIndex(index);
+    } else {
+      documentChanged(index);
+    }
+  }
 }
 
 QString
@@ -1179,6 +1860,20 @@ MainWindow::saveDocument(IEBookDocument* document)
   //      dynamic_cast<IEBookDocument*>(wrapper->codeEditor()->document());
   if (document) {
     //    IEBookInterface* plugin = document->plugin();
+    // documents may save in the background, and report their progress.
+    ITextDocument* text_document = dynamic_cast<ITextDocument*>(document);
+    if (text_document) {
+      connect(text_document,
+              &ITextDocument::saveProgress,
+              this,
+              &MainWindow::documentSaveProgress,
+              Qt::UniqueConnection);
+      connect(text_document,
+              &ITextDocument::saveCompleted,
+              this,
+              &MainWindow::documentSaveCompleted,
+              Qt::UniqueConnection);
+    }
     document->saveDocument();
   }
 }
@@ -1187,10 +1882,21 @@ void
 MainWindow::documentChanged(int index)
 {
   if (!m_loading) {
+    if (index >= 0 && m_tab_placeholders.contains(m_doc_tabs->widget(index))) {
+      // shown for the first time, this comes back here once it is open.
+      loadPlaceholderTab(index);
+      return;
+    }
     if (index >= 0) {
       m_options->setCurrentIndex(index);
+      saveOptions();
       EBookWrapper* wrapper =
         qobject_cast<EBookWrapper*>(m_doc_tabs->widget(index));
+      if (!wrapper) {
+        // still being parsed.
+        m_toc_stack->setCurrentIndex(index);
+        return;
+      }
       QTextDocument* textdocument =
         dynamic_cast<QTextDocument*>(wrapper->editor()->document());
       IEBookDocument* iebookdocument =
@@ -1207,6 +1913,7 @@ MainWindow::documentChanged(int index)
       //        setStatusReadWrite();
       //      }
       setStatusFilename(iebookdocument->filename());
+      updateStatistics();
 
       if (textdocument) {
         m_current_document = textdocument;
@@ -1214,6 +1921,10 @@ MainWindow::documentChanged(int index)
         if (iebookdocument) {
           QString language = iebookdocument->language();
           QLocale local(language);
+          loadWordLists(iebookdocument);
+        }
+        if (m_find_replace_dialog) {
+          m_find_replace_dialog->setDocument(iebookdocument);
         }
       } else {
         m_current_document = nullptr;
@@ -1230,6 +1941,23 @@ MainWindow::documentChanged(int index)
 void
 MainWindow::tabClosing(int index)
 {
+  QWidget* placeholder = m_doc_tabs->widget(index);
+  QFutureWatcher<QObject*>* parsing = m_parsing_tabs.key(placeholder);
+  if (parsing) {
+    // the parsed book is dropped once it arrives.
+    m_parsing_tabs.insert(parsing, nullptr);
+  }
+  if (parsing || m_tab_placeholders.contains(placeholder)) {
+    // never opened so there is nothing to save.
+    m_tab_placeholders.remove(placeholder);
+    m_doc_tabs->removeTab(index);
+    QWidget* toc_placeholder = m_toc_stack->widget(index);
+    m_toc_stack->removeWidget(toc_placeholder);
+    toc_placeholder->deleteLater();
+    placeholder->deleteLater();
+    return;
+  }
+
   EBookWrapper* wrapper =
     qobject_cast<EBookWrapper*>(m_doc_tabs->widget(index));
   QTextDocument* textdocument =
@@ -1241,19 +1969,30 @@ MainWindow::tabClosing(int index)
     if (itextdocument) {
       saveDocument(itextdocument);
     }
+  } else {
+    wrapper->journal()->discard();
   }
+  if (m_find_replace_dialog &&
+      m_find_replace_dialog->document() ==
+        dynamic_cast<IEBookDocument*>(wrapper->editor()->document())) {
+    m_find_replace_dialog->setDocument(nullptr);
+  }
+  storeStatistics(wrapper);
+  storePosition(wrapper);
   m_doc_tabs->removeTab(index);
 
   // load next document from m_tabs;
   wrapper = qobject_cast<EBookWrapper*>(m_doc_tabs->currentWidget());
-  textdocument = dynamic_cast<QTextDocument*>(wrapper->editor()->document());
   if (wrapper) {
+    textdocument =
+      dynamic_cast<QTextDocument*>(wrapper->editor()->document());
     if (textdocument) {
       m_current_document = textdocument;
     }
   } else {
     // no more tabs.
     m_current_document = nullptr;
+    updateStatistics();
   }
 }
 
@@ -1292,18 +2031,393 @@ MainWindow::fileOpen()
   saveOptions();
 }
 
+/*!
+ * \brief Imports every book in a directory tree into the library.
+ *
+ * The import runs in the background, see EBookImporter. Books that have no
+ * author are queued for fileResolveImports() rather than asking about each
+ * one as it is found.
+ */
 void
-MainWindow::fileSave()
+MainWindow::fileImport()
 {
-  // TODO
-  EBookWrapper* wrapper =
-    qobject_cast<EBookWrapper*>(m_doc_tabs->currentWidget());
-  if (wrapper) {
-    QTextDocument* textdocument =
-      qobject_cast<QTextDocument*>(wrapper->editor()->document());
-    IEBookDocument* itextdocument = dynamic_cast<IEBookDocument*>(textdocument);
-    if (textdocument->isModified()) {
-      saveDocument(itextdocument);
+  if (m_importer->isRunning()) {
+    return;
+  }
+  QString directory = QFileDialog::getExistingDirectory(
+    this, tr("Import Books"), m_defbookpath);
+  if (directory.isEmpty()) {
+    return;
+  }
+
+  if (!m_importer->importDirectory(directory, ebookPlugins())) {
+    statusBar()->showMessage(tr("No books found in %1").arg(directory));
+    return;
+  }
+  m_file_import->setEnabled(false);
+  m_import_progress =
+    new QProgressDialog(tr("Importing books.."), tr("Cancel"), 0, 0, this);
+  m_import_progress->setMinimumDuration(0);
+  connect(m_import_progress,
+          &QProgressDialog::canceled,
+          m_importer,
+          &EBookImporter::cancel);
+}
+
+/*!
+ * \brief Opens the imported books that had no author one at a time, so that
+ * the authors can be entered.
+ */
+void
+MainWindow::fileResolveImports()
+{
+  QStringList filenames = m_needs_attention;
+  m_needs_attention.clear();
+  m_file_resolve_imports->setEnabled(false);
+  foreach (QString filename, filenames) {
+    loadDocument(filename);
+  }
+  m_bookcount = m_options->currentfiles().size();
+  saveOptions();
+}
+
+/*!
+ * \brief Makes one metadata change to all of the books selected in the
+ * library.
+ *
+ * The books are written in the background, see EBookMetadataBatch. Books
+ * that are open are left alone as saving them would undo the change.
+ */
+void
+MainWindow::fileBatchMetadata()
+{
+  if (m_metadata_batch->isRunning()) {
+    return;
+  }
+  QStringList open_files;
+  for (int i = 0; i < m_doc_tabs->count(); i++) {
+    QWidget* widget = m_doc_tabs->widget(i);
+    EBookWrapper* tab = qobject_cast<EBookWrapper*>(widget);
+    IEBookDocument* document =
+      (tab ? dynamic_cast<IEBookDocument*>(tab->editor()->document())
+           : nullptr);
+    if (document) {
+      open_files << document->filename();
+    } else if (m_tab_placeholders.contains(widget)) {
+      open_files << m_tab_placeholders.value(widget);
+    }
+  }
+  QList<quint64> uids;
+  int open_count = 0;
+  foreach (quint64 uid, m_library_frame->selectedBooks()) {
+    BookData book = m_library_db->bookByUid(uid);
+    if (book.isNull()) {
+      continue;
+    }
+    if (open_files.contains(book->filename)) {
+      open_count++;
+    } else {
+      uids << uid;
+    }
+  }
+  if (uids.isEmpty()) {
+    statusBar()->showMessage(
+      open_count > 0 ? tr("The selected books are all open")
+                     : tr("No books are selected in the library"));
+    return;
+  }
+
+  BatchMetadataDialog dialog(m_authors_db, m_series_db, uids.size(), this);
+  if (dialog.exec() != QDialog::Accepted) {
+    return;
+  }
+  if (!m_metadata_batch->start(uids, dialog.edit(), ebookPlugins())) {
+    return;
+  }
+  if (open_count > 0) {
+    QLOG_DEBUG(tr("%1 open books were left unchanged").arg(open_count));
+  }
+  m_file_batch_metadata->setEnabled(false);
+  m_batch_progress = new QProgressDialog(
+    tr("Writing book metadata.."), tr("Cancel"), 0, uids.size(), this);
+  m_batch_progress->setMinimumDuration(0);
+  connect(m_batch_progress,
+          &QProgressDialog::canceled,
+          m_metadata_batch,
+          &EBookMetadataBatch::cancel);
+}
+
+void
+MainWindow::batchProgress(int value, int total)
+{
+  if (m_batch_progress) {
+    m_batch_progress->setMaximum(total);
+    m_batch_progress->setValue(value);
+  }
+}
+
+void
+MainWindow::batchFinished(int updated, int failed)
+{
+  if (m_batch_progress) {
+    m_batch_progress->deleteLater();
+    m_batch_progress = nullptr;
+  }
+  m_file_batch_metadata->setEnabled(true);
+  if (updated > 0) {
+    // the authors and series of the books may have changed.
+    m_library_frame->readLibrary();
+  }
+  statusBar()->showMessage(
+    tr("Updated the metadata of %1 books, %2 failed").arg(updated).arg(failed));
+}
+
+void
+MainWindow::importProgress(int value, int total)
+{
+  if (m_import_progress) {
+    m_import_progress->setMaximum(total);
+    m_import_progress->setValue(value);
+  }
+}
+
+void
+MainWindow::importFinished(int imported, int skipped)
+{
+  if (m_import_progress) {
+    m_import_progress->deleteLater();
+    m_import_progress = nullptr;
+  }
+  m_file_import->setEnabled(true);
+
+  m_needs_attention += m_importer->needsAttention();
+  m_file_resolve_imports->setEnabled(!m_needs_attention.isEmpty());
+  if (imported > 0) {
+    m_duplicate_finder->start();
+  }
+
+  statusBar()->showMessage(
+    tr("Imported %1 books, %2 already in the library, %3 need authors, "
+       "%4 failed")
+      .arg(imported)
+      .arg(skipped)
+      .arg(m_importer->needsAttention().size())
+      .arg(m_importer->failed().size()));
+}
+
+/*!
+ * \brief Shows the library search dialog.
+ */
+void
+MainWindow::fileSearch()
+{
+  if (!m_search_dialog) {
+    m_search_dialog = new SearchDialog(m_indexer, m_library_db, this);
+    connect(m_search_dialog,
+            &SearchDialog::hitActivated,
+            this,
+            &MainWindow::openSearchHit);
+  }
+  m_search_dialog->show();
+  m_search_dialog->raise();
+  m_search_dialog->activateWindow();
+}
+
+/*!
+ * \brief Asks for two versions of a book and shows their differences.
+ *
+ * The books are compared in the background by their plugin, see
+ * IEBookInterface::compareBooks(), and the results shown in a
+ * CompareDialog.
+ */
+void
+MainWindow::fileCompare()
+{
+  // only the epub plugin can compare its books.
+  QString filter = tr("EPub ( *.epub )");
+  QString original = QFileDialog::getOpenFileName(
+    this, tr("Original Book"), m_defbookpath, filter);
+  if (original.isEmpty()) {
+    return;
+  }
+  QString changed = QFileDialog::getOpenFileName(
+    this, tr("Changed Book"), QFileInfo(original).path(), filter);
+  if (changed.isEmpty()) {
+    return;
+  }
+
+  EBookTypeSniffer sniffer(ebookPlugins());
+  IEBookInterface* ebook_plugin = sniffer.plugin(original);
+  if (!ebook_plugin || ebook_plugin != sniffer.plugin(changed)) {
+    statusBar()->showMessage(
+      tr("Only two books of the same type can be compared"));
+    return;
+  }
+
+  m_file_compare->setEnabled(false);
+  statusBar()->showMessage(tr("Comparing %1 and %2..")
+                             .arg(QFileInfo(original).fileName())
+                             .arg(QFileInfo(changed).fileName()));
+  QSharedPointer<EBookComparison> comparison(new EBookComparison());
+  QFutureWatcher<bool>* watcher = new QFutureWatcher<bool>(this);
+  connect(watcher, &QFutureWatcher<bool>::finished, this, [=]() {
+    watcher->deleteLater();
+    m_file_compare->setEnabled(true);
+    if (!watcher->result()) {
+      statusBar()->showMessage(tr("Unable to compare the books"));
+      return;
+    }
+    statusBar()->clearMessage();
+    CompareDialog* dlg = new CompareDialog(*comparison, this);
+    dlg->setAttribute(Qt::WA_DeleteOnClose);
+    dlg->show();
+  });
+  watcher->setFuture(QtConcurrent::run([=]() {
+    return ebook_plugin->compareBooks(original, changed, *comparison);
+  }));
+}
+
+/*!
+ * \brief Opens the book of a search hit, or switches to it if it is already
+ * open, and selects the word that was found.
+ */
+void
+MainWindow::openSearchHit(const EBookSearchHit& hit)
+{
+  BookData book = m_library_db->bookByUid(hit.uid);
+  if (book.isNull()) {
+    return;
+  }
+
+  EBookWrapper* wrapper = nullptr;
+  for (int i = 0; i < m_doc_tabs->count(); i++) {
+    if (m_tab_placeholders.value(m_doc_tabs->widget(i)) == book->filename) {
+      // opens the book of the placeholder.
+      m_doc_tabs->setCurrentIndex(i);
+    }
+    EBookWrapper* tab = qobject_cast<EBookWrapper*>(m_doc_tabs->widget(i));
+    IEBookDocument* document =
+      (tab ? dynamic_cast<IEBookDocument*>(tab->editor()->document())
+           : nullptr);
+    if (document && document->filename() == book->filename) {
+      m_doc_tabs->setCurrentIndex(i);
+      wrapper = tab;
+      break;
+    }
+  }
+  if (!wrapper) {
+    int count = m_doc_tabs->count();
+    loadDocument(book->filename, true);
+    if (m_doc_tabs->count() == count) {
+      return;
+    }
+    m_doc_tabs->setCurrentIndex(count);
+    wrapper = qobject_cast<EBookWrapper*>(m_doc_tabs->widget(count));
+  }
+  viewShowEditor();
+  wrapper->setToEditor();
+
+  EBookEditor* editor = wrapper->editor();
+  IEBookDocument* document =
+    dynamic_cast<IEBookDocument*>(editor->document());
+  if (document) {
+    document->showChapter(hit.chapter);
+  }
+  // the offset is into the chapter html so the rendered word is found by
+  // counting its occurrences instead.
+  editor->moveCursor(QTextCursor::Start);
+  for (int i = 0; i <= hit.occurrence; i++) {
+    if (!editor->find(hit.term, QTextDocument::FindWholeWords)) {
+      break;
+    }
+  }
+  editor->setFocus();
+}
+
+void
+MainWindow::indexProgress(int value, int total)
+{
+  statusBar()->showMessage(
+    tr("Indexing the library, %1 of %2 books").arg(value).arg(total));
+}
+
+void
+MainWindow::indexFinished()
+{
+  statusBar()->showMessage(tr("The library search index is up to date"),
+                           5000);
+}
+
+/*!
+ * \brief Called when books have been added to or changed in the library
+ * directory outside Biblos.
+ */
+void
+MainWindow::libraryBooksUpdated(const QStringList& files)
+{
+  foreach (QString file, files) {
+    m_indexer->indexBook(file);
+    BookData book = m_library_db->bookByFile(file);
+    if (!book.isNull()) {
+      m_thumbnails->removeThumbnail(book->uid);
+    }
+    for (int i = 0; i < m_doc_tabs->count(); i++) {
+      EBookWrapper* wrapper =
+        qobject_cast<EBookWrapper*>(m_doc_tabs->widget(i));
+      if (wrapper && wrapper->editor()->ebookDocument() == document) {
+        storeStatistics(wrapper);
+        storePosition(wrapper);
+      }
+    }
+  }
+  statusBar()->showMessage(
+    tr("%1 books updated from the library directory").arg(files.size()),
+    5000);
+  m_duplicate_finder->start();
+}
+
+void
+MainWindow::libraryBooksRemoved(const QList<quint64>& uids)
+{
+  foreach (quint64 uid, uids) {
+    m_indexer->removeBook(uid);
+    m_thumbnails->removeThumbnail(uid);
+  }
+}
+
+/*!
+ * \brief Reports the books that are in the library more than once.
+ */
+void
+MainWindow::duplicatesFound(const QList<BookList>& duplicates)
+{
+  if (duplicates.isEmpty()) {
+    return;
+  }
+  foreach (BookList books, duplicates) {
+    QStringList files;
+    foreach (BookData book, books) {
+      files << book->filename;
+    }
+    QLOG_DEBUG(tr("Duplicate books : %1").arg(files.join(", ")));
+  }
+  statusBar()->showMessage(
+    tr("%1 books are in the library more than once").arg(duplicates.size()),
+    5000);
+}
+
+void
+MainWindow::fileSave()
+{
+  // TODO
+  EBookWrapper* wrapper =
+    qobject_cast<EBookWrapper*>(m_doc_tabs->currentWidget());
+  if (wrapper) {
+    QTextDocument* textdocument =
+      qobject_cast<QTextDocument*>(wrapper->editor()->document());
+    IEBookDocument* itextdocument = dynamic_cast<IEBookDocument*>(textdocument);
+    if (textdocument->isModified()) {
+      saveDocument(itextdocument);
     }
   }
 }
@@ -1317,7 +2431,14 @@ MainWindow::fileSaveAs()
 void
 MainWindow::fileExit()
 {
-  saveOptions();
+  m_options->save(m_options->configFile());
+  for (int i = 0; i < m_doc_tabs->count(); i++) {
+    EBookWrapper* wrapper =
+      qobject_cast<EBookWrapper*>(m_doc_tabs->widget(i));
+    if (wrapper) {
+      storePosition(wrapper);
+    }
+  }
 
   // TODO Are you really really really sure?
   close();
@@ -1326,13 +2447,21 @@ MainWindow::fileExit()
 void
 MainWindow::editUndo()
 {
-  // TODO
+  EBookWrapper* wrapper =
+    qobject_cast<EBookWrapper*>(m_doc_tabs->currentWidget());
+  if (wrapper) {
+    wrapper->undo();
+  }
 }
 
 void
 MainWindow::editRedo()
 {
-  // TODO
+  EBookWrapper* wrapper =
+    qobject_cast<EBookWrapper*>(m_doc_tabs->currentWidget());
+  if (wrapper) {
+    wrapper->redo();
+  }
 }
 
 void
@@ -1365,16 +2494,114 @@ MainWindow::editNextWord()
   // TODO
 }
 
+/*!
+ * \brief Hands the spell checker the word lists kept in the library for
+ * a book and its authors.
+ */
+void
+MainWindow::loadWordLists(IEBookDocument* document)
+{
+  ISpellInterface* checker = spellChecker();
+  if (!checker || !document) {
+    return;
+  }
+  BookData book = m_library_db->bookByFile(document->filename());
+  QStringList author_words;
+  foreach (AuthorData author, bookAuthors(document)) {
+    author_words += author->words();
+  }
+  checker->setAuthorList(author_words);
+  checker->setBookList(book ? book->book_words : QStringList());
+  checker->setWordMatches(
+    book ? book->word_matches : QMap<QString, QString>());
+}
+
+AuthorList
+MainWindow::bookAuthors(IEBookDocument* document)
+{
+  AuthorList authors;
+  foreach (QString name, document->creators()) {
+    AuthorData author = m_authors_db->author(name);
+    if (author && !authors.contains(author)) {
+      authors << author;
+    }
+  }
+  return authors;
+}
+
+/*!
+ * \brief The selected text of the current editor, or the word under the
+ * cursor if nothing is selected.
+ */
+QString
+MainWindow::currentWord()
+{
+  EBookWrapper* wrapper =
+    qobject_cast<EBookWrapper*>(m_doc_tabs->currentWidget());
+  if (!wrapper) {
+    return QString();
+  }
+  QTextCursor cursor = wrapper->editor()->textCursor();
+  if (!cursor.hasSelection()) {
+    cursor.select(QTextCursor::WordUnderCursor);
+  }
+  return cursor.selectedText().trimmed();
+}
+
+IEBookDocument*
+MainWindow::currentEBookDocument()
+{
+  EBookWrapper* wrapper =
+    qobject_cast<EBookWrapper*>(m_doc_tabs->currentWidget());
+  return (wrapper ? wrapper->editor()->ebookDocument() : nullptr);
+}
+
 void
 MainWindow::editSendToBookList()
 {
-  // TODO
+  IEBookDocument* document = currentEBookDocument();
+  QString word = currentWord();
+  ISpellInterface* checker = spellChecker();
+  if (!checker || !document || word.isEmpty()) {
+    return;
+  }
+  checker->addWordToBookList(word);
+
+  BookData book = m_library_db->bookByFile(document->filename());
+  if (book && !book->book_words.contains(word)) {
+    QStringList words = book->book_words;
+    words << word;
+    m_library_db->setWordLists(book->uid, words, book->word_matches);
+    saveLibrary();
+  }
+  // the word is now correct.
+  checker->checkWord(word);
 }
 
 void
 MainWindow::editSendToAuthorList()
 {
-  // TODO
+  IEBookDocument* document = currentEBookDocument();
+  QString word = currentWord();
+  ISpellInterface* checker = spellChecker();
+  if (!checker || !document || word.isEmpty()) {
+    return;
+  }
+  checker->addWordToAuthorList(word);
+
+  bool changed = false;
+  foreach (AuthorData author, bookAuthors(document)) {
+    QStringList words = author->words();
+    if (!words.contains(word)) {
+      words << word;
+      m_authors_db->setWords(author, words);
+      changed = true;
+    }
+  }
+  if (changed) {
+    saveAuthors();
+  }
+  checker->checkWord(word);
 }
 
 void
@@ -1389,11 +2616,62 @@ MainWindow::editPasteFromHistory()
   // TODO
 }
 
+/*!
+ * \brief Shows the find and replace dialog for the book shown.
+ */
+void
+MainWindow::editFindReplace()
+{
+  if (!m_find_replace_dialog) {
+    m_find_replace_dialog = new FindReplaceDialog(this);
+    connect(m_find_replace_dialog,
+            &FindReplaceDialog::hitActivated,
+            this,
+            &MainWindow::openBookHit);
+  }
+  EBookWrapper* wrapper =
+    qobject_cast<EBookWrapper*>(m_doc_tabs->currentWidget());
+  m_find_replace_dialog->setDocument(
+    wrapper ? dynamic_cast<IEBookDocument*>(wrapper->editor()->document())
+            : nullptr);
+  m_find_replace_dialog->show();
+  m_find_replace_dialog->raise();
+  m_find_replace_dialog->activateWindow();
+}
+
+/*!
+ * \brief Moves the editor to a find and replace hit in the book shown.
+ *
+ * Only the chapter of the hit is laid out.
+ */
+void
+MainWindow::openBookHit(const EBookBookHit& hit)
+{
+  EBookWrapper* wrapper =
+    qobject_cast<EBookWrapper*>(m_doc_tabs->currentWidget());
+  if (!wrapper) {
+    return;
+  }
+  viewShowEditor();
+  wrapper->setToEditor();
+  EBookEditor* editor = wrapper->editor();
+  if (!editor->showChapter(hit.chapter)) {
+    return;
+  }
+  editor->selectSource(hit.offset, hit.length);
+  editor->setFocus();
+}
+
 void
 MainWindow::editOptions()
 {
   OptionsDialog* dlg = new OptionsDialog(m_options, this);
   connect(dlg, &OptionsDialog::codeChanged, this, &MainWindow::codeChanged);
+  // the code editors watch the shared formats themselves.
+  connect(dlg,
+          &OptionsDialog::codeChanged,
+          m_options,
+          &Options::updateCodeFormats);
   connect(dlg, &OptionsDialog::showToc, m_toc, &QTextEdit::setVisible);
   connect(dlg, &OptionsDialog::moveToc, this, &MainWindow::update);
   int result = dlg->exec();
@@ -1445,6 +2723,7 @@ MainWindow::viewToc()
   }
   m_view_toc->setText(text);
   m_toc->setVisible(!state);
+  saveOptions();
 }
 
 void
@@ -1463,6 +2742,7 @@ MainWindow::viewTocPosition()
   }
   m_view_toc_position->setText(text);
   update(position);
+  saveOptions();
 }
 
 void
@@ -1533,6 +2813,65 @@ MainWindow::helpCheckUpdates()
   // TODO
 }
 
+void
+MainWindow::helpMemoryUsage()
+{
+  MemoryDialog* dlg = new MemoryDialog(this);
+  dlg->setAttribute(Qt::WA_DeleteOnClose);
+  connect(dlg, &MemoryDialog::refreshRequested, this, [this, dlg]() {
+    for (int i = 0; i < m_doc_tabs->count(); i++) {
+      EBookWrapper* wrapper =
+        qobject_cast<EBookWrapper*>(m_doc_tabs->widget(i));
+      if (wrapper) {
+        dlg->addBook(m_doc_tabs->tabText(i), wrapper->memoryUsage());
+      }
+    }
+  });
+  dlg->show();
+}
+
+/*
+ * Saves the trace of every thread, so that a slow book can be profiled
+ * where it was found.
+ */
+void
+MainWindow::helpSaveTrace()
+{
+  QString filename = QFileDialog::getSaveFileName(
+    this,
+    tr("Save Trace"),
+    QDir::homePath() + QDir::separator() + "biblos-trace.json",
+    tr("Trace files (*.json)"));
+  if (filename.isEmpty()) {
+    return;
+  }
+  QSaveFile file(filename);
+  if (!file.open(QIODevice::WriteOnly)) {
+    QLOG_DEBUG(tr("Unable to write the trace to %1").arg(filename))
+    return;
+  }
+  file.write(EBookTrace::toJson());
+  if (!file.commit()) {
+    QLOG_DEBUG(tr("Unable to write the trace to %1").arg(filename))
+  }
+}
+
+/*
+ * Shows or hides the profiling overlay of the editors of every open book,
+ * books opened later follow suit.
+ */
+void
+MainWindow::helpProfiling(bool show)
+{
+  m_profiling = show;
+  for (int i = 0; i < m_doc_tabs->count(); i++) {
+    EBookWrapper* tab = qobject_cast<EBookWrapper*>(m_doc_tabs->widget(i));
+    if (tab) {
+      tab->setProfileOverlay(show);
+    }
+  }
+}
+
 void
 MainWindow::setStatusModified()
 {
@@ -1565,6 +2904,42 @@ MainWindow::setStatusFilename(QString name)
   m_filelbl->setText(name);
 }
 
+void
+MainWindow::documentSaveProgress(int value, int total)
+{
+  ITextDocument* document = qobject_cast<ITextDocument*>(sender());
+  if (document && total > 0) {
+    statusBar()->showMessage(tr("Saving %1 : %2%")
+                               .arg(document->filename())
+                               .arg((value * 100) / total));
+  }
+}
+
+void
+MainWindow::documentSaveCompleted(bool success)
+{
+  ITextDocument* document = qobject_cast<ITextDocument*>(sender());
+  QString name = (document ? document->filename() : QString());
+  if (success) {
+    statusBar()->showMessage(tr("Saved %1").arg(name), 5000);
+    m_indexer->indexBook(name);
+    BookData book = m_library_db->bookByFile(name);
+    if (!book.isNull()) {
+      m_thumbnails->removeThumbnail(book->uid);
+    }
+    for (int i = 0; i < m_doc_tabs->count(); i++) {
+      EBookWrapper* wrapper =
+        qobject_cast<EBookWrapper*>(m_doc_tabs->widget(i));
+      if (wrapper && wrapper->editor()->ebookDocument() == document) {
+        storeStatistics(wrapper);
+        storePosition(wrapper);
+      }
+    }
+  } else {
+    statusBar()->showMessage(tr("Failed to save %1").arg(name), 5000);
+  }
+}
+
 void
 MainWindow::openWindow()
 {
@@ -1589,12 +2964,8 @@ MainWindow::tocAnchorClicked(QUrl url)
   EBookWrapper* wrapper =
     qobject_cast<EBookWrapper*>(m_doc_tabs->currentWidget());
   EBookEditor* editor = wrapper->editor();
-  QString fragment = url.fragment();
-  if (fragment.isEmpty()) {
-    editor->scrollToAnchor(url.path());
-  } else {
-    editor->scrollToAnchor(fragment);
-  }
+  // the link may be to another chapter.
+  editor->showUrl(url);
 }
 
 void
@@ -1640,7 +3011,7 @@ MainWindow::buildTocFromData()
   int index = m_doc_tabs->currentIndex();
   EBookEditor* editor = wrapper->editor();
   // get new toc data
-  QString toc_string = editor->buildTocFromData();
+  EBookToc toc = editor->buildTocFromData();
   // create new data widget
   EBookTOCWidget* new_toc_widget = new EBookTOCWidget(this);
   new_toc_widget->setOpenLinks(false);
@@ -1652,7 +3023,7 @@ MainWindow::buildTocFromData()
           &EBookTOCWidget::buildManualToc,
           this,
           &MainWindow::builManualToc);
-  new_toc_widget->setDocumentString(toc_string);
+  new_toc_widget->setToc(toc);
   // get current toc widget
   QWidget* toc_widget = m_toc_stack->currentWidget();
   // back it up
@@ -1679,13 +3050,12 @@ MainWindow::builManualToc()
   //  m_toc_backup.insert(index, toc_widget);
   //  // replace it with the new toc data
   //  m_toc_stack->removeWidget(toc_widget);
-  toceditor->setDocument(toc_widget->document());
+  toceditor->setToc(toc_widget->toc());
   //  m_toc_stack->insertWidget(index, toceditor);
   //  m_toc_stack->setCurrentIndex(index);
 
   toceditor->exec();
-  QString toc = toceditor->documentString();
-  toc_widget->setDocumentString(toc);
+  toc_widget->setToc(toceditor->toc());
 }
 
 void
@@ -1783,6 +3153,27 @@ MainWindow::fileNew()
 //    //    return document;
 //}
 
+/*!
+ * \brief The loaded plugins that read books.
+ */
+QList<IEBookInterface*>
+MainWindow::ebookPlugins()
+{
+  QList<IEBookInterface*> ebook_plugins;
+  foreach (IPluginInterface* plugin, m_plugins) {
+    IEBookInterface* ebook = dynamic_cast<IEBookInterface*>(plugin);
+    if (ebook) {
+      ebook_plugins.append(ebook);
+    }
+  }
+  return ebook_plugins;
+}
+
+/*
+ * Only the metadata of each plugin is read here, which does not load it.
+ * Book plugins are loaded the first time a book of their type is read,
+ * spellcheckers when spelling is first checked.
+ */
 void
 MainWindow::loadPlugins()
 {
@@ -1792,38 +3183,57 @@ MainWindow::loadPlugins()
   foreach (QString fileName, pluginsDir.entryList(QDir::Files)) {
     if (fileName == "Makefile") // can remove this in installed versions.
       continue;
-    QPluginLoader loader(pluginsDir.absoluteFilePath(fileName));
-    QObject* plugin = loader.instance();
-
-    if (plugin) {
-      IPluginInterface* iebook = dynamic_cast<IPluginInterface*>(plugin);
-      if (iebook) {
-        iebook->buildMenu();
-        // Add plugin to list of ALL plugins.
-        m_plugins.append(iebook);
-        iebook->setLoaded(true);
-
-        // Add spellcheckers to list of spellcheckers;
-        //                QString name = iebook->pluginName();
-        //                ISpellInterface *spellinterface =
-        //                dynamic_cast<ISpellInterface *>(iebook); if
-        //                (spellinterface) {
-        //                    m_spellchecker_plugins.insert(name,
-        //                    spellinterface);
-        //                }
-
-        //      m_languages = m_current_spell_checker->languageCodes();
-        //      foreach (QString lang, m_languages) {
-        //        CountryData* data = m_current_spell_checker->dictionary(lang);
-        //        m_dict_data.insert(lang, data);
-        //        m_dict_paths.insert(lang, data->path);
-        //      }
-      }
+    EBookPluginLoader* loader =
+      new EBookPluginLoader(pluginsDir.absoluteFilePath(fileName), m_options);
+    if (!loader->isValid()) {
+      QLOG_DEBUG(tr("Plugin error : %1").arg(loader->errorString()))
+      delete loader;
+      continue;
+    }
+
+    QString interface = loader->value("interface");
+    if (interface == "ebook") {
+      EBookPluginProxy* ebook_interface = new EBookPluginProxy(loader);
+      m_type_sniffer.addPlugin(ebook_interface);
+      m_plugins.append(ebook_interface);
     } else {
-      QLOG_DEBUG(tr("Plugin error : %1").arg(loader.errorString()))
+      if (interface == "spell") {
+        m_spellchecker_plugins.insert(loader->value("name"), loader);
+      }
+      // Add plugin to list of ALL plugins.
+      m_plugins.append(new EBookOtherPluginProxy(loader));
+    }
+  }
+}
+
+/*!
+ * \brief The spellchecker, loaded the first time that it is asked for.
+ *
+ * If a spell server is set the remote checker is used, with Hunspell as
+ * its local checker, otherwise Hunspell is used on its own.
+ *
+ * \return the spellchecker or nullptr if there is none.
+ */
+ISpellInterface*
+MainWindow::spellChecker()
+{
+  if (!m_current_spell_checker) {
+    ISpellInterface* local = nullptr;
+    EBookPluginLoader* loader = m_spellchecker_plugins.value("Hunspell");
+    if (loader) {
+      local = dynamic_cast<ISpellInterface*>(loader->instance());
+    }
+    m_current_spell_checker = local;
+
+    loader = m_spellchecker_plugins.value("Google Spell");
+    if (loader && !m_options->spellServer().isEmpty()) {
+      ISpellInterface* remote =
+        dynamic_cast<ISpellInterface*>(loader->instance());
+      if (remote) {
+        remote->setLocalChecker(local);
+        m_current_spell_checker = remote;
+      }
     }
   }
-  // TODO handle more than one spellchecker plugin.
-  m_current_spell_checker = m_spellchecker_plugins["HunSpell"];
-  //  return false;
+  return m_current_spell_checker;
 }
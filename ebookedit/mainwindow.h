@@ -3,7 +3,6 @@
 
 #include <QDir>
 #include <QMainWindow>
-#include <QMimeDatabase>
 #include <QSqlDatabase>
 #include <QStringList>
 #include <QtWidgets>
@@ -17,8 +16,11 @@
 #include "iebookdocument.h"
 
 #include "authors.h"
+#include "ebookpluginproxy.h"
+#include "ebooktypesniffer.h"
 #include "library.h"
 #include "options.h"
+#include "searchindex.h"
 
 class IEBookDocument;
 class EPubDocument;
@@ -28,6 +30,15 @@ class IPluginInterface;
 class CountryData;
 class LibraryFrame;
 class EBookWrapper;
+class EBookImporter;
+class EBookMetadataBatch;
+class EBookIndexer;
+class EBookLibraryWatcher;
+class EBookDuplicateFinder;
+class EBookThumbnailCache;
+class SearchDialog;
+class FindReplaceDialog;
+struct EBookBookHit;
 
 class MainWindow : public QMainWindow
 {
@@ -57,9 +68,11 @@ protected:
   QMap<int, QWidget*> m_toc_backup;
 
   Options::TocPosition m_toc_position;
-  QMap<QString, ISpellInterface*> m_spellchecker_plugins;
+  // spellcheckers by name, loaded when spelling is first checked.
+  QMap<QString, EBookPluginLoader*> m_spellchecker_plugins;
   QMap<QString, IPluginInterface*> m_ebookplugins;
   QList<IPluginInterface*> m_plugins;
+  EBookTypeSniffer m_type_sniffer;
   QStringList m_languages;
   QMap<QString, QString> m_dict_paths;
   QMap<QString, CountryData*> m_dict_data;
@@ -70,7 +83,7 @@ protected:
   //  QString m_lib_file;
   //  QString m_authors_file;
   bool is_in_temp_store = false;
-  //  DbManager* m_database;
+  Database m_database;
 
   void resizeEvent(QResizeEvent* e);
   void moveEvent(QMoveEvent* e);
@@ -82,6 +95,10 @@ protected:
   void loadAuthors();
   void saveSeries();
   void loadSeries();
+  void loadDatabases();
+  void databaseLoaded();
+  void databasesLoaded();
+  void recoverEdits();
   void documentChanged(int index);
   void tabClosing(int);
   //  bool eventFilter(QObject *object, QEvent *event);
@@ -92,6 +109,28 @@ protected:
   Options* m_options;
   SeriesDB m_series_db;
   LibraryDB m_library_db;
+  EBookImporter* m_importer;
+  QProgressDialog* m_import_progress;
+  EBookMetadataBatch* m_metadata_batch;
+  QProgressDialog* m_batch_progress;
+  EBookIndexer* m_indexer;
+  EBookThumbnailCache* m_thumbnails;
+  EBookLibraryWatcher* m_library_watcher;
+  EBookDuplicateFinder* m_duplicate_finder;
+  SearchDialog* m_search_dialog;
+  // tabs whose books are opened when first shown, and their files.
+  QHash<QWidget*, QString> m_tab_placeholders;
+  // books being parsed and their placeholder tabs, nullptr once closed.
+  QHash<QFutureWatcher<QObject*>*, QWidget*> m_parsing_tabs;
+  FindReplaceDialog* m_find_replace_dialog;
+  QStringList m_needs_attention; // imported books that have no author.
+  int m_pending_databases;
+  bool m_databases_loaded;
+  bool m_profiling; // the editors show the profiling overlay.
+  QStringList m_pending_library_files; // opened once the databases load.
+  int m_pending_library_index;
+  // books whose journalled edits are replayed when they are opened.
+  QSet<QString> m_recover_files;
   AuthorsDB m_authors_db;
   //  bool m_prefchanged = false;
   QString m_defbookpath;
@@ -124,8 +163,28 @@ protected:
   void initHelpMenu();
 
   void loadPlugins();
-  void loadDocument(QString file_name, bool from_library = false);
+  QList<IEBookInterface*> ebookPlugins();
+  ISpellInterface* spellChecker();
+  void loadDocument(QString file_name,
+                    bool from_library = false,
+                    int index = -1);
+  void addDocumentTab(IEBookDocument* ebook_document,
+                      const QString& filename,
+                      int index = -1);
+  void parseDocument(const QString& filename,
+                     IEBookInterface* ebook_plugin,
+                     int index = -1);
+  void documentParsed(QFutureWatcher<QObject*>* watcher,
+                      const QString& filename,
+                      IEBookInterface* ebook_plugin);
+  QString libraryTabName(const QString& filename);
+  void addPlaceholderTab(const QString& filename);
+  void loadPlaceholderTab(int index);
   void saveDocument(IEBookDocument* document);
+  void loadWordLists(IEBookDocument* document);
+  AuthorList bookAuthors(IEBookDocument* document);
+  QString currentWord();
+  IEBookDocument* currentEBookDocument();
 
   QString concatenateAuthorNames(AuthorList names);
   QString concatenateAuthorNames(QStringList names);
@@ -138,6 +197,19 @@ protected:
   void setStatusReadOnly();
   void setStatusReadWrite();
   void setStatusFilename(QString name);
+  void documentSaveProgress(int value, int total);
+  void documentSaveCompleted(bool success);
+  void importProgress(int value, int total);
+  void importFinished(int imported, int skipped);
+  void batchProgress(int value, int total);
+  void batchFinished(int updated, int failed);
+  void indexProgress(int value, int total);
+  void indexFinished();
+  void libraryBooksUpdated(const QStringList& files);
+  void libraryBooksRemoved(const QList<quint64>& uids);
+  void duplicatesFound(const QList<BookList>& duplicates);
+  void openSearchHit(const EBookSearchHit& hit);
+  void openBookHit(const EBookBookHit& hit);
   void tabEntered(int, QPoint pos, QVariant);
   void tabExited(int);
   void openWindow();
@@ -164,6 +236,9 @@ protected: // Menu/StatusBar stuff
   QLabel* m_modifiedlbl;
   QLabel* m_readonlylbl;
   QLabel* m_filelbl;
+  QLabel* m_memorylbl;
+  QLabel* m_statisticslbl;
+  QTimer* m_memory_timer;
 
   QAction* m_show_library;
   QAction* m_show_editor;
@@ -172,6 +247,11 @@ protected: // Menu/StatusBar stuff
 
   QAction* m_file_new;
   QAction* m_file_open;
+  QAction* m_file_import;
+  QAction* m_file_resolve_imports;
+  QAction* m_file_batch_metadata;
+  QAction* m_file_search;
+  QAction* m_file_compare;
   QAction* m_file_save;
   QAction* m_file_save_as;
   QAction* m_file_save_all;
@@ -183,6 +263,7 @@ protected: // Menu/StatusBar stuff
   QAction* m_edit_copy;
   QAction* m_edit_paste;
   QAction* m_edit_paste_history;
+  QAction* m_edit_find_replace;
   QAction* m_edit_options;
   QAction* m_edit_spellcheck;
   QAction* m_edit_highlight_misspelled;
@@ -200,6 +281,9 @@ protected: // Menu/StatusBar stuff
   QAction* m_help_about_ebookeditor;
   QAction* m_help_about_plugins;
   QAction* m_help_check_updates;
+  QAction* m_help_save_trace;
+  QAction* m_help_profiling;
+  QAction* m_help_memory_usage;
 
   QActionGroup* m_screengrp;
   QAction* m_view_fullscreen;
@@ -211,6 +295,11 @@ protected: // Menu/StatusBar stuff
 
   void fileNew();
   void fileOpen();
+  void fileImport();
+  void fileResolveImports();
+  void fileBatchMetadata();
+  void fileSearch();
+  void fileCompare();
   void fileSave();
   void fileSaveAs();
   void fileSaveAll();
@@ -222,6 +311,7 @@ protected: // Menu/StatusBar stuff
   void editCut();
   void editPaste();
   void editPasteFromHistory();
+  void editFindReplace();
   void editOptions();
   void editSpellcheck();
   void editHighlightWords();
@@ -244,12 +334,21 @@ protected: // Menu/StatusBar stuff
   void helpAboutEbookEditor();
   void helpAboutPlugins();
   void helpCheckUpdates();
+  void helpSaveTrace();
+  void helpProfiling(bool show);
+  void helpMemoryUsage();
+  void updateMemoryUsage();
+  void updateStatistics();
+  void storeStatistics(EBookWrapper* wrapper);
+  void storePosition(EBookWrapper* wrapper);
+  void restorePosition(EBookWrapper* wrapper);
 
   static const QString READ_ONLY;
   static const QString READ_WRITE;
   static const QString NO_FILE;
   static const QString NOT_MODIFIED;
   static const QString MODIFIED;
+  static const int MEMORY_INTERVAL = 2000; // ms
 
   static const QString DB_NAME;
 
@@ -257,6 +356,7 @@ protected: // Menu/StatusBar stuff
   static const QString LIB_FILE;
   static const QString AUTHOR_FILE;
   static const QString SERIES_FILE;
+  static const QString PORTRAIT_DIRECTORY;
 
   void loadLibraryFiles(QStringList current_lib_files, int currentindex);
   EBookDocumentType checkMimetype(QString filename);
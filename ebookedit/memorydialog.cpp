@@ -0,0 +1,114 @@
+#include "memorydialog.h"
+
+MemoryDialog::MemoryDialog(QWidget* parent) : QDialog(parent)
+{
+  setWindowTitle(tr("Memory Usage"));
+
+  QGridLayout* layout = new QGridLayout;
+  setLayout(layout);
+
+  QStringList headers;
+  headers << tr("Book") << tr("Images") << tr("SVGs") << tr("Documents")
+          << tr("CSS/JS") << tr("Resources") << tr("Text") << tr("Undo")
+          << tr("Total");
+
+  m_usage_widget = new QTreeWidget(this);
+  m_usage_widget->setColumnCount(headers.size());
+  m_usage_widget->setHeaderLabels(headers);
+  m_usage_widget->setRootIsDecorated(false);
+  m_usage_widget->header()->setSectionResizeMode(
+    QHeaderView::ResizeToContents);
+  layout->addWidget(m_usage_widget, 0, 0, 1, 2);
+
+  QPushButton* refresh_button = new QPushButton(tr("Refresh"), this);
+  connect(refresh_button, &QPushButton::clicked, this, &MemoryDialog::refresh);
+  layout->addWidget(refresh_button, 1, 1);
+
+  m_refresh_timer.setInterval(REFRESH_INTERVAL);
+  connect(&m_refresh_timer, &QTimer::timeout, this, &MemoryDialog::refresh);
+
+  setGeometry(geometry().x(), geometry().y(), 800, 300);
+}
+
+void
+MemoryDialog::showEvent(QShowEvent* event)
+{
+  QDialog::showEvent(event);
+  refresh();
+  m_refresh_timer.start();
+}
+
+void
+MemoryDialog::hideEvent(QHideEvent* event)
+{
+  m_refresh_timer.stop();
+  QDialog::hideEvent(event);
+}
+
+void
+MemoryDialog::refresh()
+{
+  clear();
+  emit refreshRequested();
+  QTreeWidgetItem* item = new QTreeWidgetItem(m_usage_widget);
+  setRow(item, tr("All books"), m_total);
+  QFont font = item->font(0);
+  font.setBold(true);
+  for (int column = 0; column < m_usage_widget->columnCount(); column++) {
+    item->setFont(column, font);
+  }
+}
+
+void
+MemoryDialog::clear()
+{
+  m_usage_widget->clear();
+  m_total = EBookMemoryUsage();
+}
+
+/*!
+ * \brief Adds a row for a book, called for every open book in answer to
+ * refreshRequested().
+ */
+void
+MemoryDialog::addBook(const QString& name, const EBookMemoryUsage& usage)
+{
+  setRow(new QTreeWidgetItem(m_usage_widget), name, usage);
+  m_total.images += usage.images;
+  m_total.svgs += usage.svgs;
+  m_total.documents += usage.documents;
+  m_total.styles += usage.styles;
+  m_total.resources += usage.resources;
+  m_total.text_document += usage.text_document;
+  m_total.undo += usage.undo;
+}
+
+void
+MemoryDialog::setRow(QTreeWidgetItem* item,
+                     const QString& name,
+                     const EBookMemoryUsage& usage)
+{
+  QList<qint64> values;
+  values << usage.images << usage.svgs << usage.documents << usage.styles
+         << usage.resources << usage.text_document << usage.undo
+         << usage.total();
+  item->setText(0, name);
+  for (int i = 0; i < values.size(); i++) {
+    item->setText(i + 1, formatBytes(values.at(i)));
+    item->setTextAlignment(i + 1, Qt::AlignRight | Qt::AlignVCenter);
+  }
+}
+
+/*!
+ * \brief The bytes as KB, MB or GB, whichever is the most readable.
+ */
+QString
+MemoryDialog::formatBytes(qint64 bytes)
+{
+  if (bytes < 1024 * 1024) {
+    return tr("%1 KB").arg(double(bytes) / 1024, 0, 'f', 1);
+  } else if (bytes < 1024 * 1024 * 1024) {
+    return tr("%1 MB").arg(double(bytes) / (1024 * 1024), 0, 'f', 1);
+  }
+  return tr("%1 GB").arg(double(bytes) / (1024 * 1024 * 1024), 0, 'f', 2);
+}
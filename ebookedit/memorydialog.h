@@ -0,0 +1,46 @@
+#ifndef MEMORYDIALOG_H
+#define MEMORYDIALOG_H
+
+#include <QDialog>
+#include <QTimer>
+#include <QtWidgets>
+
+#include "iebookdocument.h"
+
+/*!
+ * \brief Shows the memory held by each open book, for each kind of data.
+ *
+ * The figures are asked for again every REFRESH_INTERVAL ms while the
+ * dialog is shown, through refreshRequested(), so that the cache budgets
+ * can be tuned against real books.
+ */
+class MemoryDialog : public QDialog
+{
+  Q_OBJECT
+public:
+  explicit MemoryDialog(QWidget* parent = nullptr);
+
+  void clear();
+  void addBook(const QString& name, const EBookMemoryUsage& usage);
+
+  static QString formatBytes(qint64 bytes);
+
+signals:
+  void refreshRequested();
+
+protected:
+  QTreeWidget* m_usage_widget;
+  QTimer m_refresh_timer;
+  EBookMemoryUsage m_total;
+
+  void showEvent(QShowEvent* event) override;
+  void hideEvent(QHideEvent* event) override;
+  void refresh();
+  void setRow(QTreeWidgetItem* item,
+              const QString& name,
+              const EBookMemoryUsage& usage);
+
+  static const int REFRESH_INTERVAL = 2000;
+};
+
+#endif // MEMORYDIALOG_H
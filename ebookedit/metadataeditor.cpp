@@ -1,5 +1,6 @@
 #include "metadataeditor.h"
 #include "authordialog.h"
+#include "ebooknamecompleter.h"
 #include "iebookdocument.h"
 
 MetadataEditor::MetadataEditor(Options* options,
@@ -92,10 +93,6 @@ MetadataEditor::setDocument(ITextDocument* doc)
     m_book_data->series_index = m_calibre->seriesIndex();
   }
 
-  QCompleter* completer = new QCompleter(m_series_db->seriesList(), this);
-  completer->setCaseSensitivity(Qt::CaseInsensitive);
-  m_series_edit->setCompleter(completer);
-
   QStringList creators = m_document->creators();
   AuthorList author_list;
   foreach (QString creator, creators) {
@@ -154,6 +151,7 @@ MetadataEditor::addOrUpdateAuthorRow(AuthorList author_list)
       m_next_author_row++;
     } else if (i >= m_author_edits.size()) {
       author_edit = new QLineEdit(this);
+      completeAuthors(author_edit);
       m_author_edits.append(author_edit);
       m_main_layout->removeWidget(m_spacer);
       m_main_layout->removeWidget(m_btn_frame);
@@ -244,6 +242,13 @@ MetadataEditor::initGui()
   m_main_layout->addWidget(lbl, row, 0);
   m_series_edit = new QLineEdit(this);
   //  m_series_edit->setReadOnly(true);
+  SeriesDB series_db = m_series_db;
+  new EBookNameCompleter(
+    m_series_edit,
+    [series_db](const QString& prefix, int limit) {
+      return series_db->completeSeries(prefix, limit);
+    },
+    EBookSeriesDB::COMPLETION_LIMIT);
   connect(m_series_edit,
           &QLineEdit::textChanged,
           this,
@@ -263,6 +268,7 @@ MetadataEditor::initGui()
   m_main_layout->addWidget(lbl, row, 0);
 
   QLineEdit* author = new QLineEdit(this);
+  completeAuthors(author);
   m_main_layout->addWidget(author, row, 1);
   QCheckBox* author_cbox = new QCheckBox(QStringLiteral("Surname last"), this);
   m_author_cboxs.append(author_cbox);
@@ -306,6 +312,21 @@ MetadataEditor::initGui()
   m_author_edits.append(author);
 }
 
+/*
+ * Suggests the display names of the library authors as the name is typed.
+ */
+void
+MetadataEditor::completeAuthors(QLineEdit* edit)
+{
+  AuthorsDB authors_db = m_author_db;
+  new EBookNameCompleter(
+    edit,
+    [authors_db](const QString& prefix, int limit) {
+      return authors_db->completeAuthor(prefix, limit);
+    },
+    EBookAuthorsDB::COMPLETION_LIMIT);
+}
+
 void
 MetadataEditor::editTitle()
 {
@@ -54,6 +54,7 @@ protected:
   void setTitle(QString title);
   void setFileInfo(QString filepath);
   void initGui();
+  void completeAuthors(QLineEdit* edit);
   void editTitle();
   void editAuthor();
   void filenameChanged();
@@ -0,0 +1,64 @@
+#include "searchdialog.h"
+
+#include "ebookindexer.h"
+
+SearchDialog::SearchDialog(EBookIndexer* indexer,
+                           LibraryDB library_db,
+                           QWidget* parent)
+  : QDialog(parent)
+  , m_indexer(indexer)
+  , m_library_db(library_db)
+{
+  setWindowTitle(tr("Search Library"));
+
+  QVBoxLayout* layout = new QVBoxLayout;
+  setLayout(layout);
+
+  m_query_edit = new QLineEdit(this);
+  m_query_edit->setPlaceholderText(tr("Words to find"));
+  layout->addWidget(m_query_edit);
+  connect(m_query_edit, &QLineEdit::returnPressed, this, &SearchDialog::search);
+
+  m_results = new QListWidget(this);
+  layout->addWidget(m_results);
+  connect(m_results,
+          &QListWidget::itemActivated,
+          this,
+          &SearchDialog::activate);
+
+  m_status = new QLabel(this);
+  layout->addWidget(m_status);
+
+  QDialogButtonBox* buttons =
+    new QDialogButtonBox(QDialogButtonBox::Close, Qt::Horizontal, this);
+  connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+  layout->addWidget(buttons);
+}
+
+void
+SearchDialog::search()
+{
+  QElapsedTimer timer;
+  timer.start();
+  m_hits = m_indexer->search(m_query_edit->text(), MAX_HITS);
+  qint64 elapsed = timer.elapsed();
+
+  m_results->clear();
+  foreach (EBookSearchHit hit, m_hits) {
+    BookData book = m_library_db->bookByUid(hit.uid);
+    QString title = (book.isNull() ? QString() : book->title);
+    m_results->addItem(
+      tr("%1 : %2, %3").arg(title).arg(hit.chapter).arg(hit.offset));
+  }
+  m_status->setText(
+    tr("%1 matches in %2 ms").arg(m_hits.size()).arg(elapsed));
+}
+
+void
+SearchDialog::activate(QListWidgetItem* item)
+{
+  int row = m_results->row(item);
+  if (row >= 0 && row < m_hits.size()) {
+    emit hitActivated(m_hits.at(row));
+  }
+}
@@ -0,0 +1,42 @@
+#ifndef SEARCHDIALOG_H
+#define SEARCHDIALOG_H
+
+#include <QtWidgets>
+
+#include "library.h"
+#include "searchindex.h"
+
+class EBookIndexer;
+
+/*!
+ * \brief Searches the text of every book in the library.
+ *
+ * Double clicking a result emits hitActivated() so that the book can be
+ * opened at the hit.
+ */
+class SearchDialog : public QDialog
+{
+  Q_OBJECT
+public:
+  SearchDialog(EBookIndexer* indexer,
+               LibraryDB library_db,
+               QWidget* parent = nullptr);
+
+signals:
+  void hitActivated(const EBookSearchHit& hit);
+
+protected:
+  EBookIndexer* m_indexer;
+  LibraryDB m_library_db;
+  QLineEdit* m_query_edit;
+  QListWidget* m_results;
+  QLabel* m_status;
+  EBookSearchHitList m_hits;
+
+  void search();
+  void activate(QListWidgetItem* item);
+
+  static const int MAX_HITS = 1000;
+};
+
+#endif // SEARCHDIALOG_H
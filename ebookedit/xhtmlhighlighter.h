@@ -5,17 +5,18 @@
 #include <QRegularExpression>
 #include <QSyntaxHighlighter>
 #include <QStack>
+#include <QTextBlock>
 
 #include <qlogger/qlogger.h>
 
 #include "ebookcommon.h"
 #include "options.h"
+#include "xhtmltokenizer.h"
 
 class XhtmlHighlighter : public QSyntaxHighlighter
 {
   Q_OBJECT
 
-  typedef QSharedPointer<QTextCharFormat> format_t;
   //  struct Attribute
   //  {
   //    int start, end, value_start, value_end;
@@ -74,62 +75,27 @@ public:
   XhtmlHighlighter(Options* options, QTextDocument* parent = nullptr);
   ~XhtmlHighlighter() override;
 
-  void resetFormattingOptions();
-  void setNormalFormat(QColor fore = QColor(Qt::black),
-                       QColor back = QColor(Qt::white),
-                       QFont::Weight weight = QFont::Normal,
-                       bool italic = false);
-  void setErrorFormat(QColor fore = QColor(Qt::white),
-                      QColor back = QColor(Qt::yellow),
-                      QFont::Weight weight = QFont::Bold,
-                      bool italic = false);
-  void setAttributeFormat(QColor fore = QColor(Qt::cyan),
-                          QColor back = QColor(Qt::white),
-                          QFont::Weight weight = QFont::Normal,
-                          bool italic = false);
-  void setTagFormat(QColor fore = QColor(Qt::blue),
-                    QColor back = QColor(Qt::white),
-                    QFont::Weight weight = QFont::Normal,
-                    bool italic = false);
-  void setStringFormat(QColor fore = QColor(Qt::green),
-                       QColor back = QColor(Qt::white),
-                       QFont::Weight weight = QFont::Normal,
-                       bool italic = false);
-  void setStyleFormat(QColor fore = QColor(Qt::darkMagenta),
-                      QColor back = QColor(Qt::white),
-                      QFont::Weight weight = QFont::Normal,
-                      bool italic = false);
-  void setScriptFormat(QColor fore = QColor(Qt::darkGray),
-                       QColor back = QColor(Qt::white),
-                       QFont::Weight weight = QFont::Normal,
-                       bool italic = false);
+  void setDeferred(bool deferred);
+  bool isDeferred() const;
+  void highlightNow(const QTextBlock& block);
+  static bool isHighlighted(const QTextBlock& block);
 
 protected:
-  bool m_tagstarted; // triggered by the '<' start tag character.
-  bool m_tagcomplete; // triggered by the '>' end tag character
-  bool m_tagcloser; // triggered by '/' IF it is the second character in the tag.
-  bool m_dquot; // triggered by a start double quote '"'. A second one cancels.
-  bool m_squot; // triggered by a start single quote '\''. A second one cancels.
-  bool m_namestarted; // triggered by the first non special character after the start tag.
-  bool m_namecomplete; // trgiggerd by a space, a '/' or a '>' after m_namestarted is true.
-  bool m_attstarted; // triggered by a non-special character after m_namecomplete.
-  bool m_attcomplete; // triggered by a space, a '/', an '=' or a '>' or a non-special character.
-  bool m_endtag; // triggered by '>'
-  bool m_eqstarted; // triggered by an '=' character.
-  bool m_error; // indicates an error has occured. Normally a special character out of place.
-  bool m_style_or_script; // a 'style' or a 'script' tag name has been detected without a tag closer.
-  QString m_tagname;
-//  QStack<QString> m_namestack;
-  int m_tagpos, m_tagstartpos;
-  format_t m_current_format;
   Options* m_options;
+  // while deferred only blocks that have been highlighted before, or that
+  // are passed to highlightNow(), are highlighted.
+  bool m_deferred;
+  QTextBlock m_forced_block;
+
+  // set in the block state of every block that has been highlighted, the
+  // tokenizer state is held in the bits below it.
+  static const int HIGHLIGHTED_STATE = 0x100;
   //  node_t m_start_node, m_tagnode, m_current_node;
 
   void highlightBlock(const QString& text) override;
+  const QTextCharFormat& tokenFormat(const XhtmlToken& token) const;
 //  void setError(QString errorstring);
 
-  void resetTagFlags();
-
 private:
   //  struct HighlightingRule
   //  {
@@ -137,14 +103,6 @@ private:
   //    QTextCharFormat format;
   //  };
   //  QVector<HighlightingRule> highlighting_rules;
-
-  format_t m_normal_format;
-  format_t m_tag_format;
-  format_t m_string_format;
-  format_t m_attribute_format;
-  format_t m_style_format;
-  format_t m_script_format;
-  format_t m_error_format;
 };
 
 #endif // XHTMLHIGHLIGHTER_H
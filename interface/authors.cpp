@@ -1,7 +1,10 @@
 #include "authors.h"
 
+#include "database.h"
+
 // starts at 1 - 0 == null value
-quint64 EBookAuthorsDB::m_highest_uid = 1;
+EBookUidGenerator EBookAuthorsDB::m_uids(1);
+const double EBookAuthorsDB::FUZZY_MATCH = 0.6;
 
 EBookAuthorsDB::EBookAuthorsDB(QObject* parent)
   : QObject(parent)
@@ -10,28 +13,109 @@ EBookAuthorsDB::EBookAuthorsDB(QObject* parent)
 
 EBookAuthorsDB::~EBookAuthorsDB()
 {
-  saveAuthors();
+  save();
 }
 
 void
 EBookAuthorsDB::setFilename(QString filename)
 {
   m_filename = filename;
+  m_journal.setFilename(filename);
 }
 
+/*!
+ * \brief Saves the authors.
+ *
+ * With a database only the authors that have been changed since the last
+ * save are written.
+ */
 bool
 EBookAuthorsDB::save()
 {
+  QWriteLocker locker(&m_lock);
+  if (m_database) {
+    foreach (AuthorData author_data, m_author_data) {
+      if (author_data->isModified()) {
+        writeAuthor(author_data);
+      }
+    }
+    m_removed.clear();
+    m_author_changed = false;
+    return m_database->commit();
+  }
   return saveAuthors();
 }
 
+/*!
+ * \brief Loads the authors from the database if one is set, otherwise from
+ * the yaml file.
+ *
+ * The first time an empty database is used the yaml file is read and copied
+ * into it.
+ */
 bool
 EBookAuthorsDB::load(QString filename)
 {
   setFilename(filename);
+  QWriteLocker locker(&m_lock);
+  if (m_database) {
+    if (m_database->isEmpty("authors") && QFile::exists(m_filename)) {
+      // storeAuthor() writes each author read to the database.
+      bool result = loadAuthors();
+      m_database->commit();
+      return result;
+    }
+    return loadDatabase();
+  }
   return loadAuthors();
 }
 
+/*!
+ * \brief Stores the authors in database rather than the yaml file.
+ *
+ * Must be set before load() is called.
+ */
+void
+EBookAuthorsDB::setDatabase(Database database)
+{
+  m_database = database;
+}
+
+/*!
+ * \brief Sets the directory that the author portraits are stored in.
+ *
+ * Must be set before load() is called, as portraits held in older files
+ * are moved into it as they are read.
+ */
+void
+EBookAuthorsDB::setImageDirectory(const QString& directory)
+{
+  m_image_store.setDirectory(directory);
+}
+
+/*!
+ * \brief Returns the portrait of an author, which is only read from the
+ * image store when it is first needed.
+ */
+QPixmap
+EBookAuthorsDB::portrait(AuthorData author_data) const
+{
+  if (author_data.isNull()) {
+    return QPixmap();
+  }
+  return m_image_store.pixmap(author_data->imageHash());
+}
+
+void
+EBookAuthorsDB::setPortrait(AuthorData author_data, const QPixmap& pixmap)
+{
+  if (author_data.isNull()) {
+    return;
+  }
+  author_data->setImageHash(m_image_store.insert(pixmap));
+  m_author_changed = true;
+}
+
 quint64
 EBookAuthorsDB::insertAuthor(AuthorData author_data)
 {
@@ -41,7 +125,6 @@ EBookAuthorsDB::insertAuthor(AuthorData author_data)
   if (author_data->uid() == 0) {
     author_data->setUid(nextUid());
   }
-  m_author_data.insert(author_data->uid(), author_data);
   if (author_data->displayName().isEmpty()) {
     if (!author_data->isEmpty()) {
       // TODO handle asian type surname first format.
@@ -88,43 +171,193 @@ EBookAuthorsDB::insertAuthor(AuthorData author_data)
   return author_data->uid();
 }
 
+/*!
+ * \brief Returns the names that match the forename or surname of a known
+ * author, in their original order and without duplicates.
+ *
+ * Names are compared after accent and case folding.
+ */
 QStringList
 EBookAuthorsDB::compareAndDiscard(QStringList names)
 {
+  QReadLocker locker(&m_lock);
   QStringList cleaned;
+  QSet<QString> seen;
   foreach (QString value, names) {
-    QString lower = value.toLower();
-    // check if the surname list has a match.
-    AuthorList list = m_author_by_surname.values(value);
-    foreach (AuthorData data, list) {
-      if (lower == data->forename().toLower() ||
-          lower == data->surname().toLower()) {
-        if (!cleaned.contains(value))
-          cleaned += value;
+    if (seen.contains(value)) {
+      continue;
+    }
+    seen.insert(value);
+    if (m_author_by_name_part.contains(normalizedName(value))) {
+      cleaned += value;
+    }
+  }
+  return cleaned;
+}
+
+/*!
+ * \brief Finds the author that best matches name.
+ *
+ * The name may be in either 'FORENAME SURNAME' or 'SURNAME, FORENAME' order
+ * and is compared without regard to accents or case. If no author matches
+ * exactly the authors with the same surname soundex and forename initial
+ * are compared by trigram similarity, so that small spelling differences
+ * still find the author.
+ *
+ * \return the author, or a null AuthorData if none is close enough.
+ */
+AuthorData
+EBookAuthorsDB::findAuthor(QString name)
+{
+  QString normalized = normalizedName(name);
+  if (normalized.isEmpty()) {
+    return AuthorData();
+  }
+  QReadLocker locker(&m_lock);
+  AuthorData data = m_author_by_normalized.value(normalized);
+  if (!data.isNull()) {
+    return data;
+  }
+
+  QStringList words = normalized.split(' ');
+  QStringList keys;
+  if (words.size() == 1) {
+    keys << phoneticKey(words.first());
+  } else {
+    keys << phoneticKey(words.last()) + words.first().at(0);
+    keys << phoneticKey(words.first()) + words.last().at(0);
+  }
+
+  double best_score = FUZZY_MATCH;
+  foreach (QString key, keys) {
+    foreach (AuthorData candidate, m_author_by_phonetic.values(key)) {
+      foreach (QString candidate_name, normalizedKeys(candidate)) {
+        double score = similarity(normalized, candidate_name);
+        if (score >= best_score) {
+          best_score = score;
+          data = candidate;
+        }
       }
     }
-    // check if the forename list has a match.
-    list = m_author_by_forename.values(value);
-    foreach (AuthorData data, list) {
-      if (lower == data->forename().toLower() ||
-          lower == data->surname().toLower()) {
-        if (!cleaned.contains(value))
-          cleaned += value;
+  }
+  return data;
+}
+
+/*!
+ * \brief Folds a name for comparison.
+ *
+ * Accents are removed, case is folded and any run of characters that are
+ * not letters or digits becomes a single space, so 'Brontë, Émily' becomes
+ * 'bronte emily'.
+ */
+QString
+EBookAuthorsDB::normalizedName(const QString& name)
+{
+  QString decomposed = name.normalized(QString::NormalizationForm_KD);
+  QString result;
+  result.reserve(decomposed.size());
+  bool separator = false;
+  foreach (QChar c, decomposed) {
+    if (c.isMark()) {
+      continue;
+    }
+    if (c.isLetterOrNumber()) {
+      if (separator && !result.isEmpty()) {
+        result += ' ';
       }
+      separator = false;
+      result += c;
+    } else {
+      separator = true;
     }
   }
-  return cleaned;
+  return result.toCaseFolded();
+}
+
+/*!
+ * \brief The soundex code of a single folded word.
+ *
+ * Words that do not start with a latin letter are returned unchanged.
+ */
+QString
+EBookAuthorsDB::phoneticKey(const QString& word)
+{
+  // the soundex digit for each letter a-z, '0' for those that are dropped.
+  static const char codes[] = "01230120022455012623010202";
+
+  if (word.isEmpty() || word.at(0) < 'a' || word.at(0) > 'z') {
+    return word;
+  }
+  QString key(word.at(0).toUpper());
+  char last = codes[word.at(0).unicode() - 'a'];
+  for (int i = 1; i < word.size() && key.size() < 4; i++) {
+    ushort c = word.at(i).unicode();
+    if (c < 'a' || c > 'z') {
+      continue;
+    }
+    char code = codes[c - 'a'];
+    if (code != '0' && code != last) {
+      key += QChar(code);
+    }
+    // h and w do not separate letters with the same code, vowels do.
+    if (c != 'h' && c != 'w') {
+      last = code;
+    }
+  }
+  while (key.size() < 4) {
+    key += '0';
+  }
+  return key;
+}
+
+/*!
+ * \brief The Dice coefficient of the trigrams of two folded names, from 0
+ * for nothing in common to 1 for the same name.
+ */
+double
+EBookAuthorsDB::similarity(const QString& first, const QString& second)
+{
+  QSet<QString> first_trigrams = trigrams(first);
+  QSet<QString> second_trigrams = trigrams(second);
+  int total = first_trigrams.size() + second_trigrams.size();
+  if (total == 0) {
+    return 0.0;
+  }
+  int common = first_trigrams.intersect(second_trigrams).size();
+  return (2.0 * common) / total;
 }
 
 bool
 EBookAuthorsDB::removeBook(quint64 index)
 {
+  QWriteLocker locker(&m_lock);
   if (m_author_data.contains(index)) {
     AuthorData author = m_author_data.value(index);
     m_author_data.remove(index);
     m_author_by_displayname.remove(author->displayName(), author);
-    m_author_by_fileas.remove(author->fileAs(), author);
+    m_author_by_fileas.remove(author->fileAs().toLower(), author);
+    m_author_by_surname.remove(author->surname().toLower(), author);
+    m_author_by_forename.remove(author->forename().toLower(), author);
+    removeFromIndexes(author);
+    m_removed.insert(index);
     m_author_changed = true;
+    if (m_database) {
+      QSqlQuery query =
+        m_database->prepare("DELETE FROM authors WHERE uid = ?");
+      query.addBindValue(index);
+      m_database->exec(query);
+      QSqlQuery books_query =
+        m_database->prepare("DELETE FROM author_books WHERE author = ?");
+      books_query.addBindValue(index);
+      m_database->exec(books_query);
+      QSqlQuery words_query =
+        m_database->prepare("DELETE FROM author_words WHERE author = ?");
+      words_query.addBindValue(index);
+      m_database->exec(words_query);
+    }
+    // signalled outside the lock, receivers will read the authors.
+    locker.unlock();
+    emit authorRemoved(index);
     return true;
   }
   return false;
@@ -140,63 +373,73 @@ EBookAuthorsDB::removeBook(quint64 index)
 AuthorData
 EBookAuthorsDB::author(QString name)
 {
-  AuthorData data;
-  data = m_author_by_displayname.value(name);
-  if (!data.isNull()) {
-    return data;
-  }
-
-  /* The display name is normally in the form 'FORENAME SURNAME' or
-   * vicky-verky  in the case of asian names.
-   */
-  QStringList splits = name.split(" ");
-  if (splits.size() > 1) {
-    if (splits.size() == 2) { // normal case unless middle names are supplied.
-      if (m_author_by_surname.contains(splits.last())) {
-        data = m_author_by_surname.value(splits.last());
-        if (data->forename() == splits.first()) {
-          return data;
-        } else {
-          // TODO different surname?
-        }
-      }
-    } else {
+  {
+    QReadLocker locker(&m_lock);
+    AuthorData data = m_author_by_displayname.value(name);
+    if (!data.isNull()) {
+      return data;
     }
-  } else {
   }
-  return data;
+  return findAuthor(name);
 }
 
 AuthorData
 EBookAuthorsDB::authorByFileAs(QString file_as)
 {
+  QReadLocker locker(&m_lock);
   return m_author_by_fileas.value(file_as);
 }
 
 AuthorData
 EBookAuthorsDB::author(quint64 uid)
 {
+  QReadLocker locker(&m_lock);
   return m_author_data.value(uid);
 }
 
 AuthorList
 EBookAuthorsDB::authors()
 {
+  QReadLocker locker(&m_lock);
   return m_author_data.values();
 }
 
 AuthorList
 EBookAuthorsDB::authorsBySurname(QString surname)
 {
+  QReadLocker locker(&m_lock);
   return m_author_by_surname.values(surname);
 }
 
 AuthorList
 EBookAuthorsDB::authorsByForename(QString surname)
 {
+  QReadLocker locker(&m_lock);
   return m_author_by_forename.values(surname);
 }
 
+/*!
+ * \brief The display names of the authors whose display or file as names
+ * start with prefix, ignoring case and accents.
+ */
+QStringList
+EBookAuthorsDB::completeAuthor(const QString& prefix, int limit)
+{
+  QReadLocker locker(&m_lock);
+  return m_author_completions.complete(prefix, limit);
+}
+
+/*!
+ * \brief The surnames of the authors that start with prefix, ignoring case
+ * and accents.
+ */
+QStringList
+EBookAuthorsDB::completeSurname(const QString& prefix, int limit)
+{
+  QReadLocker locker(&m_lock);
+  return m_surname_completions.complete(prefix, limit);
+}
+
 bool
 EBookAuthorsDB::loadAuthors()
 {
@@ -205,121 +448,295 @@ EBookAuthorsDB::loadAuthors()
 
   QFile file(m_filename);
   if (file.exists()) {
-    YAML::Node authors_map = YAML::LoadFile(m_filename.toStdString());
-    if (authors_map && authors_map.IsMap()) {
-      for (YAML::const_iterator it1 = authors_map.begin();
-           it1 != authors_map.end();
-           ++it1) {
-        YAML::Node author_node = it1->second;
-        AuthorData author = AuthorData(new EBookAuthorData());
-
-        quint64 uid =
-          it1->first.as<quint64>(); // author_node["uid"].as<quint64>();
-        author->setUid(uid);
-        author->setSurname(
-          (author_node["surname"] ? author_node["surname"].as<QString>() : ""));
-        author->setForename((author_node["forenames"]
-                               ? author_node["forenames"].as<QString>()
-                               : ""));
-        author->setMiddlenames((author_node["middlenames"]
-                                  ? author_node["middlenames"].as<QString>()
-                                  : ""));
-        author->setDisplayName((author_node["display name"]
-                                  ? author_node["display name"].as<QString>()
-                                  : ""));
-        author->setFile_as(
-          (author_node["file as"] ? author_node["file as"].as<QString>() : ""));
-        author->setWebsite(
-          (author_node["website"] ? author_node["website"].as<QString>() : ""));
-        author->setWikipedia((author_node["wikipedia"]
-                                ? author_node["wikipedia"].as<QString>()
-                                : ""));
-        author->setSurnameLast((author_node["surname last"]
-                                  ? author_node["surname last"].as<bool>()
-                                  : true));
-        if (author_node["image"]) {
-          QPixmap pixmap = author_node["image"].as<QPixmap>();
-          if (!pixmap.isNull())
-            author->setPixmap(pixmap);
-        }
+    return loadAuthors(parseFile(m_filename));
+  }
 
-        if (author->uid() > m_highest_uid) {
-          m_highest_uid = author->uid();
-        }
+  return false;
+}
+
+/*!
+ * \brief Reads the yaml authors file.
+ *
+ * This is the slow part of loading the yaml file and only builds a
+ * YAML::Node, so unlike load() it can be run in a worker thread.
+ *
+ * \return the authors map, or a null node if there is no file.
+ */
+YAML::Node
+EBookAuthorsDB::parseFile(QString filename)
+{
+  if (filename.isEmpty() || !QFile::exists(filename)) {
+    return YAML::Node();
+  }
+  return YAML::LoadFile(filename.toStdString());
+}
+
+/*!
+ * \brief Loads the authors from a yaml file already read by parseFile().
+ *
+ * Older files hold the author images themselves, which are decoded as
+ * pixmaps, so this must be called in the GUI thread.
+ * If a database is set it is used instead and authors_map is ignored.
+ */
+bool
+EBookAuthorsDB::load(QString filename, YAML::Node authors_map)
+{
+  if (m_database) {
+    return load(filename);
+  }
+  setFilename(filename);
+  QWriteLocker locker(&m_lock);
+  return loadAuthors(authors_map);
+}
+
+bool
+EBookAuthorsDB::loadAuthors(YAML::Node authors_map)
+{
+  if (authors_map.IsNull()) {
+    return false;
+  }
+  bool converted = false;
+  if (authors_map && authors_map.IsMap()) {
+    for (YAML::const_iterator it1 = authors_map.begin();
+         it1 != authors_map.end();
+         ++it1) {
+      // author_node["uid"].as<quint64>();
+      quint64 uid = it1->first.as<quint64>();
+      bool image_converted = false;
+      AuthorData author = parseAuthor(uid, it1->second, image_converted);
+      m_uids.reserve(author->uid());
+      storeAuthor(author);
+      author->setModified(image_converted);
+      converted |= image_converted;
+    }
+  }
 
-        addAuthor(author);
+  // the changes saved since the file was last written.
+  for (const YAML::Node& change : m_journal.read()) {
+    if (!change.IsMap()) {
+      continue;
+    }
+    for (YAML::const_iterator it = change.begin(); it != change.end(); ++it) {
+      quint64 uid = it->first.as<quint64>();
+      if (m_author_data.contains(uid)) {
+        AuthorData old = m_author_data.take(uid);
+        m_author_by_displayname.remove(old->displayName(), old);
+        m_author_by_fileas.remove(old->fileAs().toLower(), old);
+        m_author_by_surname.remove(old->surname().toLower(), old);
+        m_author_by_forename.remove(old->forename().toLower(), old);
+        removeFromIndexes(old);
+      }
+      if (it->second.IsNull()) { // removed
+        continue;
       }
+      bool image_converted = false;
+      AuthorData author = parseAuthor(uid, it->second, image_converted);
+      m_uids.reserve(uid);
+      storeAuthor(author);
+      author->setModified(image_converted);
+      converted |= image_converted;
     }
-    m_author_changed = false;
-    return true;
   }
+  m_removed.clear();
 
-  return false;
+  // rewrite the file without the images.
+  m_author_changed = converted;
+  return true;
 }
 
+/*!
+ * \brief Builds an author from its yaml node.
+ *
+ * converted is set if the node held the image itself rather than its
+ * hash, the image is then moved into the image store.
+ */
+AuthorData
+EBookAuthorsDB::parseAuthor(quint64 uid,
+                            const YAML::Node& author_node,
+                            bool& converted)
+{
+  AuthorData author = AuthorData(new EBookAuthorData());
+  author->setUid(uid);
+  author->setSurname(
+    (author_node["surname"] ? author_node["surname"].as<QString>() : ""));
+  author->setForename(
+    (author_node["forenames"] ? author_node["forenames"].as<QString>() : ""));
+  author->setMiddlenames((author_node["middlenames"]
+                            ? author_node["middlenames"].as<QString>()
+                            : ""));
+  author->setDisplayName((author_node["display name"]
+                            ? author_node["display name"].as<QString>()
+                            : ""));
+  author->setFile_as(
+    (author_node["file as"] ? author_node["file as"].as<QString>() : ""));
+  author->setWebsite(
+    (author_node["website"] ? author_node["website"].as<QString>() : ""));
+  author->setWikipedia(
+    (author_node["wikipedia"] ? author_node["wikipedia"].as<QString>() : ""));
+  author->setSurnameLast((author_node["surname last"]
+                            ? author_node["surname last"].as<bool>()
+                            : true));
+  if (author_node["image hash"]) {
+    author->setImageHash(author_node["image hash"].as<QString>());
+  } else if (author_node["image"]) {
+    // older files hold the image itself, it is moved to the store.
+    QPixmap pixmap = author_node["image"].as<QPixmap>();
+    if (!pixmap.isNull()) {
+      author->setImageHash(m_image_store.insert(pixmap));
+      converted = true;
+    }
+  }
+  YAML::Node books_node = author_node["books"];
+  if (books_node && books_node.IsSequence()) {
+    QList<quint64> books;
+    for (YAML::const_iterator it = books_node.begin(); it != books_node.end();
+         ++it) {
+      books << it->as<quint64>();
+    }
+    author->setBooks(books);
+  }
+  YAML::Node words_node = author_node["words"];
+  if (words_node && words_node.IsSequence()) {
+    QStringList words;
+    for (YAML::const_iterator it = words_node.begin(); it != words_node.end();
+         ++it) {
+      words << it->as<QString>();
+    }
+    author->setWords(words);
+  }
+  return author;
+}
+
+/*!
+ * \brief Saves the authors changed since the last save.
+ *
+ * Only the modified and removed authors are appended to the journal, the
+ * whole file is rewritten when the journal has grown to half its size.
+ */
 bool
 EBookAuthorsDB::saveAuthors()
 {
-  if (m_filename.isEmpty())
+  if (m_filename.isEmpty() || !m_author_changed) {
     return false;
+  }
+  QList<AuthorData> modified;
+  foreach (AuthorData author_data, m_author_data) {
+    if (author_data->isModified()) {
+      modified << author_data;
+    }
+  }
 
+  bool result;
+  if (!QFile::exists(m_filename) || m_journal.needsCompaction() ||
+      (modified.isEmpty() && m_removed.isEmpty())) {
+    result = writeAuthorsFile();
+    if (result) {
+      m_journal.clear();
+    }
+  } else {
+    YAML::Emitter emitter;
+    emitter << YAML::BeginMap;
+    foreach (AuthorData author_data, modified) {
+      emitAuthor(emitter, author_data);
+    }
+    foreach (quint64 uid, m_removed) {
+      emitter << YAML::Key << uid;
+      emitter << YAML::Value << YAML::Null;
+    }
+    emitter << YAML::EndMap;
+    result = m_journal.append(QString::fromUtf8(emitter.c_str()));
+  }
+  if (result) {
+    foreach (AuthorData author_data, modified) {
+      author_data->setModified(false);
+    }
+    m_removed.clear();
+    m_author_changed = false;
+  }
+  return result;
+}
+
+bool
+EBookAuthorsDB::writeAuthorsFile()
+{
   QFile file(m_filename);
-  if (m_author_changed) {
-    if (file.open((QFile::ReadWrite | QFile::Truncate))) {
-      YAML::Emitter emitter;
-      emitter << YAML::Comment(
-        QString("A YAML File is supposed to be user readable/editable but\n"
-                "you need to be careful when manually editing.\n"
-                "Remember that the uid numbers stand for unique identifier\n"
-                "so if you edit these MAKE SURE THAT THEY ARE UNIQUE. If\n"
-                "you repeat one the second will overwrite the first."));
-
-      emitter << YAML::BeginMap;
-      foreach (AuthorData author_data, m_author_data) {
-        // for some reason emitter wont take the result directly from the
-        // method. might need some work on the YAML files.
-        quint64 uid = author_data->uid();
-        QString surname = author_data->surname();
-        QString forename = author_data->forename();
-        QString middlenames = author_data->middlenames();
-        QString display_name = author_data->displayName();
-        QString file_as = author_data->fileAs();
-        QString website = author_data->website();
-        QString wikipedia = author_data->wikipedia();
-        QPixmap pixmap = author_data->pixmap();
-
-        emitter << YAML::Key << uid;
-        emitter << YAML::Value;
-        emitter << YAML::BeginMap;
-        emitter << YAML::Key << "surname";
-        emitter << YAML::Value << surname;
-        emitter << YAML::Key << "forenames";
-        emitter << YAML::Value << forename;
-        emitter << YAML::Key << "middlenames";
-        emitter << YAML::Value << middlenames;
-        emitter << YAML::Key << "display name";
-        emitter << YAML::Value << display_name;
-        emitter << YAML::Key << "file as";
-        emitter << YAML::Value << file_as;
-        emitter << YAML::Key << "surname last";
-        emitter << YAML::Value << author_data->surnameLast();
-        emitter << YAML::Key << "website";
-        emitter << YAML::Value << website;
-        emitter << YAML::Key << "wikipedia";
-        emitter << YAML::Value << wikipedia;
-        if (!author_data->pixmap().isNull()) {
-          emitter << YAML::Key << "image";
-          emitter << YAML::Value << pixmap;
-        }
-        emitter << YAML::EndMap;
-      }
-      emitter << YAML::EndMap;
-      QTextStream out(&file);
-      out << emitter.c_str();
-      return true;
+  if (!file.open((QFile::ReadWrite | QFile::Truncate))) {
+    return false;
+  }
+  YAML::Emitter emitter;
+  emitter << YAML::Comment(
+    QString("A YAML File is supposed to be user readable/editable but\n"
+            "you need to be careful when manually editing.\n"
+            "Remember that the uid numbers stand for unique identifier\n"
+            "so if you edit these MAKE SURE THAT THEY ARE UNIQUE. If\n"
+            "you repeat one the second will overwrite the first.\n"
+            "Recent changes may be in the .journal file beside this one."));
+
+  emitter << YAML::BeginMap;
+  foreach (AuthorData author_data, m_author_data) {
+    emitAuthor(emitter, author_data);
+  }
+  emitter << YAML::EndMap;
+  QTextStream out(&file);
+  out << emitter.c_str();
+  return true;
+}
+
+void
+EBookAuthorsDB::emitAuthor(YAML::Emitter& emitter, AuthorData author_data)
+{
+  // for some reason emitter wont take the result directly from the
+  // method. might need some work on the YAML files.
+  quint64 uid = author_data->uid();
+  QString surname = author_data->surname();
+  QString forename = author_data->forename();
+  QString middlenames = author_data->middlenames();
+  QString display_name = author_data->displayName();
+  QString file_as = author_data->fileAs();
+  QString website = author_data->website();
+  QString wikipedia = author_data->wikipedia();
+  QString image_hash = author_data->imageHash();
+
+  emitter << YAML::Key << uid;
+  emitter << YAML::Value;
+  emitter << YAML::BeginMap;
+  emitter << YAML::Key << "surname";
+  emitter << YAML::Value << surname;
+  emitter << YAML::Key << "forenames";
+  emitter << YAML::Value << forename;
+  emitter << YAML::Key << "middlenames";
+  emitter << YAML::Value << middlenames;
+  emitter << YAML::Key << "display name";
+  emitter << YAML::Value << display_name;
+  emitter << YAML::Key << "file as";
+  emitter << YAML::Value << file_as;
+  emitter << YAML::Key << "surname last";
+  emitter << YAML::Value << author_data->surnameLast();
+  emitter << YAML::Key << "website";
+  emitter << YAML::Value << website;
+  emitter << YAML::Key << "wikipedia";
+  emitter << YAML::Value << wikipedia;
+  if (!image_hash.isEmpty()) {
+    emitter << YAML::Key << "image hash";
+    emitter << YAML::Value << image_hash;
+  }
+  if (!author_data->books().isEmpty()) {
+    emitter << YAML::Key << "books";
+    emitter << YAML::Value << YAML::Flow << YAML::BeginSeq;
+    foreach (quint64 book_uid, author_data->books()) {
+      emitter << book_uid;
     }
-  } // authors changed
-  return false;
+    emitter << YAML::EndSeq;
+  }
+  if (!author_data->words().isEmpty()) {
+    emitter << YAML::Key << "words";
+    emitter << YAML::Value << YAML::Flow << YAML::BeginSeq;
+    foreach (QString word, author_data->words()) {
+      emitter << word;
+    }
+    emitter << YAML::EndSeq;
+  }
+  emitter << YAML::EndMap;
 }
 
 AuthorData
@@ -330,6 +747,7 @@ EBookAuthorsDB::addAuthor(QString display_name, FileAsList /*file_as_list*/)
    * vicky-verky  in the case of asian names.
    */
   AuthorData data;
+  QReadLocker locker(&m_lock);
   QStringList splits = display_name.split(" ");
   if (splits.size() > 1) {
     if (splits.size() == 2) { // normal case unless middle names are supplied.
@@ -346,6 +764,25 @@ EBookAuthorsDB::addAuthor(QString display_name, FileAsList /*file_as_list*/)
 
 void
 EBookAuthorsDB::addAuthor(AuthorData author_data)
+{
+  QWriteLocker locker(&m_lock);
+  bool added = storeAuthor(author_data);
+  // signalled outside the lock, receivers will read the authors.
+  locker.unlock();
+  if (added) {
+    emit authorAdded(author_data->uid());
+  }
+}
+
+/*!
+ * \brief Adds an author to the maps and indexes, the caller must hold the
+ * write lock.
+ *
+ * \return true if the author was added, false if it was invalid or already
+ *         known.
+ */
+bool
+EBookAuthorsDB::storeAuthor(AuthorData author_data)
 {
   if (author_data->isValid()) {
     if (!m_author_data.contains(author_data->uid())) {
@@ -360,8 +797,288 @@ EBookAuthorsDB::addAuthor(AuthorData author_data)
         m_author_by_displayname.insert(author_data->displayName(), author_data);
       if (!author_data->fileAs().isEmpty())
         m_author_by_fileas.insert(author_data->fileAs().toLower(), author_data);
+      addToIndexes(author_data);
+      m_removed.remove(author_data->uid());
+      // saved with the next journal entry.
+      author_data->setModified(true);
+      m_author_changed = true;
+      if (m_database) {
+        writeAuthor(author_data);
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+/*!
+ * \brief Adds a library book to the books of an author.
+ */
+void
+EBookAuthorsDB::addBook(AuthorData author_data, quint64 book_uid)
+{
+  {
+    QWriteLocker locker(&m_lock);
+    QList<quint64> books = author_data->books();
+    if (books.contains(book_uid)) {
+      return;
+    }
+    books << book_uid;
+    author_data->setBooks(books);
+    m_author_changed = true;
+    if (m_database) {
+      writeAuthor(author_data);
+    }
+  }
+  emit authorBookAdded(author_data->uid(), book_uid);
+}
+
+/*!
+ * \brief Removes a library book from the books of an author, the author is
+ * kept even if it has no books left.
+ */
+void
+EBookAuthorsDB::removeAuthorBook(AuthorData author_data, quint64 book_uid)
+{
+  QWriteLocker locker(&m_lock);
+  QList<quint64> books = author_data->books();
+  if (books.removeAll(book_uid) == 0) {
+    return;
+  }
+  author_data->setBooks(books);
+  m_author_changed = true;
+  if (m_database) {
+    writeAuthor(author_data);
+  }
+}
+
+/*!
+ * \brief Sets the spell checker words of an author.
+ */
+void
+EBookAuthorsDB::setWords(AuthorData author_data, const QStringList& words)
+{
+  QWriteLocker locker(&m_lock);
+  if (author_data->words() == words) {
+    return;
+  }
+  author_data->setWords(words);
+  m_author_changed = true;
+  if (m_database) {
+    writeAuthor(author_data);
+  }
+}
+
+void
+EBookAuthorsDB::addToIndexes(AuthorData author_data)
+{
+  foreach (QString key, normalizedKeys(author_data)) {
+    m_author_by_normalized.insert(key, author_data);
+  }
+  QString forename = normalizedName(author_data->forename());
+  if (!forename.isEmpty()) {
+    m_author_by_name_part.insert(forename, author_data);
+  }
+  QString surname = normalizedName(author_data->surname());
+  if (!surname.isEmpty()) {
+    m_author_by_name_part.insert(surname, author_data);
+  }
+  foreach (QString key, phoneticKeys(author_data)) {
+    m_author_by_phonetic.insert(key, author_data);
+  }
+  m_author_completions.insert(author_data->displayName());
+  if (author_data->fileAs() != author_data->displayName()) {
+    m_author_completions.insert(author_data->fileAs(),
+                                author_data->displayName());
+  }
+  m_surname_completions.insert(author_data->surname());
+}
+
+void
+EBookAuthorsDB::removeFromIndexes(AuthorData author_data)
+{
+  foreach (QString key, normalizedKeys(author_data)) {
+    m_author_by_normalized.remove(key, author_data);
+  }
+  m_author_by_name_part.remove(normalizedName(author_data->forename()),
+                               author_data);
+  m_author_by_name_part.remove(normalizedName(author_data->surname()),
+                               author_data);
+  foreach (QString key, phoneticKeys(author_data)) {
+    m_author_by_phonetic.remove(key, author_data);
+  }
+  m_author_completions.remove(author_data->displayName());
+  if (author_data->fileAs() != author_data->displayName()) {
+    m_author_completions.remove(author_data->fileAs(),
+                                author_data->displayName());
+  }
+  m_surname_completions.remove(author_data->surname());
+}
+
+/*!
+ * \brief The folded names an author is found by, the display and file as
+ * names and the forename and surname in both orders.
+ */
+QStringList
+EBookAuthorsDB::normalizedKeys(AuthorData author_data)
+{
+  QString forenames = author_data->forename();
+  if (!author_data->middlenames().isEmpty()) {
+    forenames += " " + author_data->middlenames();
+  }
+  QStringList keys;
+  keys << normalizedName(author_data->displayName())
+       << normalizedName(author_data->fileAs())
+       << normalizedName(forenames + " " + author_data->surname())
+       << normalizedName(author_data->surname() + " " + forenames);
+  keys.removeAll(QString());
+  keys.removeDuplicates();
+  return keys;
+}
+
+QStringList
+EBookAuthorsDB::phoneticKeys(AuthorData author_data)
+{
+  QStringList keys;
+  QStringList surnames = normalizedName(author_data->surname()).split(' ');
+  QString surname = surnames.last();
+  if (surname.isEmpty()) {
+    return keys;
+  }
+  QString key = phoneticKey(surname);
+  keys << key;
+  QString forename = normalizedName(author_data->forename());
+  if (!forename.isEmpty()) {
+    keys << key + forename.at(0);
+  }
+  return keys;
+}
+
+/*!
+ * \brief The three character sequences of a name, padded with spaces so
+ * that the start and end of each word count.
+ */
+QSet<QString>
+EBookAuthorsDB::trigrams(const QString& name)
+{
+  QSet<QString> result;
+  QString padded = " " + name + " ";
+  for (int i = 0; i + 3 <= padded.size(); i++) {
+    result.insert(padded.mid(i, 3));
+  }
+  return result;
+}
+
+bool
+EBookAuthorsDB::loadDatabase()
+{
+  QHash<quint64, QList<quint64>> books;
+  QSqlQuery books_query =
+    m_database->prepare("SELECT author, book FROM author_books");
+  if (books_query.exec()) {
+    while (books_query.next()) {
+      books[books_query.value(0).toULongLong()]
+        << books_query.value(1).toULongLong();
+    }
+  }
+  QHash<quint64, QStringList> words;
+  QSqlQuery words_query =
+    m_database->prepare("SELECT author, word FROM author_words");
+  if (words_query.exec()) {
+    while (words_query.next()) {
+      words[words_query.value(0).toULongLong()]
+        << words_query.value(1).toString();
+    }
+  }
+
+  QSqlQuery query = m_database->prepare(
+    "SELECT uid, surname, forename, middlenames, display_name, file_as, "
+    "surname_last, website, wikipedia, image FROM authors");
+  if (!query.exec()) {
+    return false;
+  }
+  // storeAuthor() would write each author straight back.
+  Database database = m_database;
+  m_database.clear();
+  while (query.next()) {
+    AuthorData author = AuthorData(new EBookAuthorData());
+    author->setUid(query.value(0).toULongLong());
+    author->setSurname(query.value(1).toString());
+    author->setForename(query.value(2).toString());
+    author->setMiddlenames(query.value(3).toString());
+    author->setDisplayName(query.value(4).toString());
+    author->setFile_as(query.value(5).toString());
+    author->setSurnameLast(query.value(6).toBool());
+    author->setWebsite(query.value(7).toString());
+    author->setWikipedia(query.value(8).toString());
+    // the image column holds the portrait hash, older databases hold the
+    // PNG itself which is moved to the store and rewritten on save.
+    QByteArray image = query.value(9).toByteArray();
+    QString image_hash = QString::fromLatin1(image);
+    bool converted = false;
+    if (EBookImageStore::isHash(image_hash)) {
+      author->setImageHash(image_hash);
+    } else if (!image.isEmpty()) {
+      author->setImageHash(m_image_store.insert(image));
+      converted = true;
     }
+    author->setBooks(books.value(author->uid()));
+    author->setWords(words.value(author->uid()));
+    author->setModified(converted);
+
+    m_uids.reserve(author->uid());
+    storeAuthor(author);
+  }
+  m_database = database;
+  m_author_changed = false;
+  return true;
+}
+
+void
+EBookAuthorsDB::writeAuthor(AuthorData author_data)
+{
+  QSqlQuery query = m_database->prepare(
+    "INSERT OR REPLACE INTO authors (uid, surname, surname_lower, forename, "
+    "middlenames, display_name, file_as, file_as_lower, surname_last, "
+    "website, wikipedia, image) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+  query.addBindValue(author_data->uid());
+  query.addBindValue(author_data->surname());
+  query.addBindValue(author_data->surname().toLower());
+  query.addBindValue(author_data->forename());
+  query.addBindValue(author_data->middlenames());
+  query.addBindValue(author_data->displayName());
+  query.addBindValue(author_data->fileAs());
+  query.addBindValue(author_data->fileAs().toLower());
+  query.addBindValue(author_data->surnameLast());
+  query.addBindValue(author_data->website());
+  query.addBindValue(author_data->wikipedia());
+  query.addBindValue(author_data->imageHash());
+  m_database->exec(query);
+
+  QSqlQuery delete_query =
+    m_database->prepare("DELETE FROM author_books WHERE author = ?");
+  delete_query.addBindValue(author_data->uid());
+  m_database->exec(delete_query);
+  foreach (quint64 book_uid, author_data->books()) {
+    QSqlQuery books_query = m_database->prepare(
+      "INSERT OR IGNORE INTO author_books (author, book) VALUES (?, ?)");
+    books_query.addBindValue(author_data->uid());
+    books_query.addBindValue(book_uid);
+    m_database->exec(books_query);
+  }
+
+  QSqlQuery delete_words_query =
+    m_database->prepare("DELETE FROM author_words WHERE author = ?");
+  delete_words_query.addBindValue(author_data->uid());
+  m_database->exec(delete_words_query);
+  foreach (QString word, author_data->words()) {
+    QSqlQuery words_query = m_database->prepare(
+      "INSERT OR IGNORE INTO author_words (author, word) VALUES (?, ?)");
+    words_query.addBindValue(author_data->uid());
+    words_query.addBindValue(word);
+    m_database->exec(words_query);
   }
+  author_data->setModified(false);
 }
 
 QString
@@ -441,17 +1158,20 @@ EBookAuthorData::setDisplayName(const QString& display_name)
   m_display_name = display_name;
 }
 
-QPixmap
-EBookAuthorData::pixmap() const
+/*!
+ * \brief The hash of the author's portrait in the EBookImageStore.
+ */
+QString
+EBookAuthorData::imageHash() const
 {
-  return m_pixmap;
+  return m_image_hash;
 }
 
 void
-EBookAuthorData::setPixmap(const QPixmap& pixmap)
+EBookAuthorData::setImageHash(const QString& image_hash)
 {
   m_modified = true;
-  m_pixmap = pixmap;
+  m_image_hash = image_hash;
 }
 
 bool
@@ -480,6 +1200,19 @@ EBookAuthorData::setBooks(const QList<quint64>& books)
   m_books = books;
 }
 
+QStringList
+EBookAuthorData::words() const
+{
+  return m_words;
+}
+
+void
+EBookAuthorData::setWords(const QStringList& words)
+{
+  m_modified = true;
+  m_words = words;
+}
+
 QString
 EBookAuthorData::wikipedia() const
 {
@@ -524,7 +1257,8 @@ EBookAuthorData::EBookAuthorData(const EBookAuthorData& other)
   m_file_as = other.m_file_as;
   m_website = other.m_website;
   m_wikipedia = other.m_wikipedia;
-  m_pixmap = other.m_pixmap;
+  m_image_hash = other.m_image_hash;
+  m_words = other.m_words;
 }
 
 EBookAuthorData::~EBookAuthorData() {}
@@ -548,6 +1282,12 @@ EBookAuthorData::isModified()
   return m_modified;
 }
 
+void
+EBookAuthorData::setModified(bool modified)
+{
+  m_modified = modified;
+}
+
 EBookAuthorData::Comparison
 EBookAuthorData::compare(QString forename, QString middlenames, QString surname)
 {
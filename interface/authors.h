@@ -1,12 +1,24 @@
 #ifndef AUTHORS_H
 #define AUTHORS_H
 
+#include <QMultiHash>
 #include <QObject>
 #include <QPixmap>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QStringList>
 
 #include <qyaml-cpp/QYamlCpp>
 
+#include "changejournal.h"
 #include "ebookbasemetadata.h"
+#include "ebooknameindex.h"
+#include "imagestore.h"
+#include "uidgenerator.h"
+
+// see database.h, QtSql is only needed where the database is used.
+class EBookDatabase;
+typedef QSharedPointer<EBookDatabase> Database;
 
 class EBookAuthorData
 {
@@ -28,6 +40,7 @@ public:
   bool isValid();
   bool isEmpty();
   bool isModified();
+  void setModified(bool modified);
   bool operator==(const EBookAuthorData& rhs)
   {
     if (m_uid == rhs.m_uid) {
@@ -57,8 +70,10 @@ public:
   void setWikipedia(const QString& wikipedia);
   QList<quint64> books() const;
   void setBooks(const QList<quint64>& books);
-  QPixmap pixmap() const;
-  void setPixmap(const QPixmap& pixmap);
+  QStringList words() const;
+  void setWords(const QStringList& words);
+  QString imageHash() const;
+  void setImageHash(const QString& image_hash);
   bool surnameLast() const;
   void setSurnameLast(bool surnameLast);
 
@@ -75,7 +90,9 @@ protected:
   QString m_website;
   QString m_wikipedia;
   QList<quint64> m_books;
-  QPixmap m_pixmap;
+  QString m_image_hash; // the portrait in the EBookImageStore.
+  // the words that the spell checker accepts in all of the author's books.
+  QStringList m_words;
 
 public:
 };
@@ -84,8 +101,16 @@ typedef QSharedPointer<EBookAuthorData> AuthorData;
 typedef QList<AuthorData> AuthorList;
 typedef QMap<quint64, AuthorData> AuthorMap;
 typedef QMultiMap<QString, AuthorData> AuthorByString;
+typedef QMultiHash<QString, AuthorData> AuthorIndex;
 Q_DECLARE_METATYPE(AuthorData);
 
+/*!
+ * \brief The authors of the library books.
+ *
+ * Any thread may look up authors, only the thread that owns the database
+ * may add, remove or change them. The AuthorData records themselves are
+ * shared, a worker that needs a stable view of one should take a copy.
+ */
 class EBookAuthorsDB : public QObject
 {
   Q_OBJECT
@@ -96,6 +121,10 @@ public:
   void setFilename(QString filename);
   bool save();
   bool load(QString filename);
+  bool load(QString filename, YAML::Node authors_map);
+  static YAML::Node parseFile(QString filename);
+  void setDatabase(Database database);
+  void setImageDirectory(const QString& directory);
 
   bool removeBook(quint64 index);
 
@@ -105,15 +134,34 @@ public:
   AuthorList authorsBySurname(QString surname);
   AuthorList authorsByForename(QString surname);
   AuthorData authorByFileAs(QString file_as);
+  QStringList completeAuthor(const QString& prefix,
+                             int limit = COMPLETION_LIMIT);
+  QStringList completeSurname(const QString& prefix,
+                              int limit = COMPLETION_LIMIT);
   quint64 insertAuthor(AuthorData author);
   AuthorData addAuthor(QString display_name,
                        FileAsList file_as_list = FileAsList());
   void addAuthor(AuthorData author_data);
+  void addBook(AuthorData author_data, quint64 book_uid);
+  void removeAuthorBook(AuthorData author_data, quint64 book_uid);
+  void setWords(AuthorData author_data, const QStringList& words);
   QStringList compareAndDiscard(QStringList names);
+  AuthorData findAuthor(QString name);
+  QPixmap portrait(AuthorData author_data) const;
+  void setPortrait(AuthorData author_data, const QPixmap& pixmap);
+
+  static QString normalizedName(const QString& name);
+  static QString phoneticKey(const QString& word);
+  static double similarity(const QString& first, const QString& second);
 
-  static quint64 nextUid() { return ++m_highest_uid; }
+  static quint64 nextUid() { return m_uids.next(); }
+
+  static const int COMPLETION_LIMIT = 20; // suggestions offered at once.
 
 signals:
+  void authorAdded(quint64 uid);
+  void authorRemoved(quint64 uid);
+  void authorBookAdded(quint64 author_uid, quint64 book_uid);
 
 public slots:
 
@@ -124,13 +172,49 @@ protected:
   AuthorByString m_author_by_displayname;
   AuthorByString m_author_by_surname;
   AuthorByString m_author_by_forename;
+  // accent and case folded names in both name orders.
+  AuthorIndex m_author_by_normalized;
+  // the folded forenames and surnames.
+  AuthorIndex m_author_by_name_part;
+  // the soundex of the surname, alone and followed by the forename initial.
+  AuthorIndex m_author_by_phonetic;
+  // the display and file as names completing to the display name, and the
+  // surnames.
+  EBookNameIndex m_author_completions;
+  EBookNameIndex m_surname_completions;
 
   bool m_author_changed;
+  // the authors removed since the last save, changed authors are marked
+  // modified.
+  QSet<quint64> m_removed;
+  EBookChangeJournal m_journal;
+  Database m_database;
+  EBookImageStore m_image_store;
+  // guards the maps and indexes, the yaml file and database are only used
+  // by the owner.
+  mutable QReadWriteLock m_lock;
 
   bool loadAuthors();
+  bool loadAuthors(YAML::Node authors_map);
   bool saveAuthors();
-
-  static quint64 m_highest_uid;
+  bool writeAuthorsFile();
+  AuthorData parseAuthor(quint64 uid,
+                         const YAML::Node& author_node,
+                         bool& converted);
+  static void emitAuthor(YAML::Emitter& emitter, AuthorData author_data);
+  bool loadDatabase();
+  bool storeAuthor(AuthorData author_data);
+  void writeAuthor(AuthorData author_data);
+  void addToIndexes(AuthorData author_data);
+  void removeFromIndexes(AuthorData author_data);
+  static QStringList normalizedKeys(AuthorData author_data);
+  static QStringList phoneticKeys(AuthorData author_data);
+  static QSet<QString> trigrams(const QString& name);
+
+  // the trigram similarity a fuzzy match must reach.
+  static const double FUZZY_MATCH;
+
+  static EBookUidGenerator m_uids;
 };
 typedef QSharedPointer<EBookAuthorsDB> AuthorsDB;
 
@@ -0,0 +1,117 @@
+#include "changejournal.h"
+
+#include <QFile>
+#include <QFileInfo>
+
+#include <qlogger/qlogger.h>
+
+using namespace qlogger;
+
+const QString EBookChangeJournal::SUFFIX = ".journal";
+
+EBookChangeJournal::EBookChangeJournal() {}
+
+QString
+EBookChangeJournal::filename() const
+{
+  return m_filename;
+}
+
+/*!
+ * \brief Sets the yaml file that is journalled, the journal is the same
+ * file with a .journal suffix.
+ */
+void
+EBookChangeJournal::setFilename(const QString& database_filename)
+{
+  m_database_filename = database_filename;
+  m_filename =
+    (database_filename.isEmpty() ? QString() : database_filename + SUFFIX);
+}
+
+/*!
+ * \brief Appends one yaml document to the journal.
+ *
+ * The document is closed with a yaml document end marker and flushed
+ * before returning, so that a document cut short by a crash can be seen.
+ */
+bool
+EBookChangeJournal::append(const QString& document)
+{
+  if (m_filename.isEmpty()) {
+    return false;
+  }
+  QFile file(m_filename);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+    QLOG_DEBUG(QString("Unable to open journal %1").arg(m_filename));
+    return false;
+  }
+  QByteArray data = "---\n" + document.toUtf8() + "\n...\n";
+  if (file.write(data) != data.size() || !file.flush()) {
+    QLOG_DEBUG(QString("Unable to write journal %1").arg(m_filename));
+    return false;
+  }
+  return true;
+}
+
+/*!
+ * \brief Reads every complete document in the journal, oldest first.
+ *
+ * Only documents that reached their end marker are returned, a last
+ * document cut short by a crash is ignored.
+ */
+std::vector<YAML::Node>
+EBookChangeJournal::read() const
+{
+  std::vector<YAML::Node> documents;
+  if (m_filename.isEmpty()) {
+    return documents;
+  }
+  QFile file(m_filename);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return documents;
+  }
+  QByteArray document;
+  bool in_document = false;
+  while (!file.atEnd()) {
+    QByteArray line = file.readLine();
+    QByteArray marker = line.trimmed();
+    if (marker == "---") {
+      document.clear();
+      in_document = true;
+    } else if (marker == "..." && in_document) {
+      documents.push_back(YAML::Load(document.toStdString()));
+      in_document = false;
+    } else if (in_document) {
+      document += line;
+    }
+  }
+  return documents;
+}
+
+/*!
+ * \brief Returns true once the journal is large enough, compared to the
+ * file it journals, that the file should be rewritten.
+ */
+bool
+EBookChangeJournal::needsCompaction() const
+{
+  QFileInfo journal(m_filename);
+  if (!journal.exists()) {
+    return false;
+  }
+  qint64 size = journal.size();
+  return (size > MIN_COMPACT_SIZE &&
+          size > QFileInfo(m_database_filename).size() / 2);
+}
+
+/*!
+ * \brief Removes the journal, once its changes are in the file.
+ */
+void
+EBookChangeJournal::clear()
+{
+  if (!m_filename.isEmpty()) {
+    QFile::remove(m_filename);
+  }
+}
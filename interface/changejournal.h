@@ -0,0 +1,41 @@
+#ifndef CHANGEJOURNAL_H
+#define CHANGEJOURNAL_H
+
+#include <QString>
+#include <vector>
+
+#include <qyaml-cpp/QYamlCpp>
+
+/*!
+ * \brief An append only journal of the changes to a yaml database file.
+ *
+ * Rather than rewriting the whole yaml file when a few records change, the
+ * changed records are appended to a journal beside it, each save as one
+ * yaml document in the same form as the file itself. A removed record is
+ * written with a null value. The journal is replayed over the file when it
+ * is loaded and folded back into it, by rewriting the file, once it has
+ * grown to half the size of the file.
+ */
+class EBookChangeJournal
+{
+public:
+  EBookChangeJournal();
+
+  QString filename() const;
+  void setFilename(const QString& database_filename);
+
+  bool append(const QString& document);
+  std::vector<YAML::Node> read() const;
+  bool needsCompaction() const;
+  void clear();
+
+protected:
+  QString m_database_filename;
+  QString m_filename;
+
+  static const QString SUFFIX;
+  // small journals are never compacted whatever the size of the file.
+  static const qint64 MIN_COMPACT_SIZE = 64 * 1024;
+};
+
+#endif // CHANGEJOURNAL_H
@@ -0,0 +1,199 @@
+#include "database.h"
+
+#include <QSqlError>
+#include <QStringList>
+
+#include <qlogger/qlogger.h>
+
+using namespace qlogger;
+
+int EBookDatabase::m_connection_count = 0;
+
+// the lower case columns hold the keys that the databases search on.
+const QStringList EBookDatabase::SCHEMA = {
+  "CREATE TABLE IF NOT EXISTS books ("
+  "uid INTEGER PRIMARY KEY, title TEXT, title_lower TEXT, filename TEXT, "
+  "series INTEGER, series_index TEXT, spine_index INTEGER, "
+  "spine_lineno INTEGER)",
+  "CREATE INDEX IF NOT EXISTS books_title ON books (title_lower)",
+  "CREATE INDEX IF NOT EXISTS books_filename ON books (filename)",
+  // kept apart from books so that older databases only gain a table.
+  "CREATE TABLE IF NOT EXISTS book_files ("
+  "book INTEGER PRIMARY KEY, size INTEGER, modified INTEGER, "
+  "content_hash TEXT)",
+  // the spell checker words of each book, match is empty for words that
+  // are simply correct in the book.
+  "CREATE TABLE IF NOT EXISTS book_words ("
+  "book INTEGER, word TEXT, match TEXT, PRIMARY KEY (book, word))",
+  // the statistics of each book that has been opened.
+  "CREATE TABLE IF NOT EXISTS book_statistics ("
+  "book INTEGER PRIMARY KEY, words INTEGER, characters INTEGER, "
+  "unique_words INTEGER, chapters INTEGER)",
+  // the block index of each book, see EBookBlockIndex::toByteArray().
+  "CREATE TABLE IF NOT EXISTS book_block_index ("
+  "book INTEGER PRIMARY KEY, data BLOB)",
+  "CREATE TABLE IF NOT EXISTS authors ("
+  "uid INTEGER PRIMARY KEY, surname TEXT, surname_lower TEXT, forename TEXT, "
+  "middlenames TEXT, display_name TEXT, file_as TEXT, file_as_lower TEXT, "
+  "surname_last INTEGER, website TEXT, wikipedia TEXT, image BLOB)",
+  "CREATE INDEX IF NOT EXISTS authors_surname ON authors (surname_lower)",
+  "CREATE INDEX IF NOT EXISTS authors_display_name ON authors (display_name)",
+  "CREATE INDEX IF NOT EXISTS authors_file_as ON authors (file_as_lower)",
+  "CREATE TABLE IF NOT EXISTS author_books ("
+  "author INTEGER, book INTEGER, PRIMARY KEY (author, book))",
+  "CREATE TABLE IF NOT EXISTS author_words ("
+  "author INTEGER, word TEXT, PRIMARY KEY (author, word))",
+  "CREATE TABLE IF NOT EXISTS series ("
+  "uid INTEGER PRIMARY KEY, name TEXT, name_lower TEXT)",
+  "CREATE INDEX IF NOT EXISTS series_name ON series (name_lower)",
+};
+
+EBookDatabase::EBookDatabase()
+  : m_in_batch(false)
+{}
+
+EBookDatabase::~EBookDatabase()
+{
+  close();
+}
+
+/*!
+ * \brief Opens the SQLite file, creating it and its tables if necessary.
+ */
+bool
+EBookDatabase::open(const QString& filename)
+{
+  close();
+  m_connection_name = QString("biblos_%1").arg(++m_connection_count);
+  m_database = QSqlDatabase::addDatabase("QSQLITE", m_connection_name);
+  m_database.setDatabaseName(filename);
+  if (!m_database.open()) {
+    QLOG_DEBUG(QString("Unable to open database %1 : %2")
+                 .arg(filename)
+                 .arg(m_database.lastError().text()));
+    return false;
+  }
+  // a commit does not have to wait for the readers.
+  QSqlQuery pragma(m_database);
+  pragma.exec("PRAGMA journal_mode=WAL");
+  pragma.exec("PRAGMA synchronous=NORMAL");
+  return createTables();
+}
+
+/*!
+ * \brief Commits any outstanding batch and closes the database.
+ */
+void
+EBookDatabase::close()
+{
+  if (!m_database.isValid()) {
+    return;
+  }
+  commit();
+  m_queries.clear();
+  m_database.close();
+  m_database = QSqlDatabase();
+  QSqlDatabase::removeDatabase(m_connection_name);
+}
+
+bool
+EBookDatabase::isOpen() const
+{
+  return m_database.isOpen();
+}
+
+/*!
+ * \brief Returns a prepared query for statement.
+ *
+ * Queries are prepared once and reused, so the same statement string should
+ * be used for every call.
+ */
+QSqlQuery
+EBookDatabase::prepare(const QString& statement)
+{
+  QHash<QString, QSqlQuery>::iterator it = m_queries.find(statement);
+  if (it == m_queries.end()) {
+    QSqlQuery query(m_database);
+    query.setForwardOnly(true);
+    if (!query.prepare(statement)) {
+      QLOG_DEBUG(QString("Unable to prepare %1 : %2")
+                   .arg(statement)
+                   .arg(query.lastError().text()));
+    }
+    it = m_queries.insert(statement, query);
+  }
+  return it.value();
+}
+
+/*!
+ * \brief Executes a prepared write within the current batch.
+ */
+bool
+EBookDatabase::exec(QSqlQuery& query)
+{
+  beginBatch();
+  if (!query.exec()) {
+    QLOG_DEBUG(QString("Database write failed : %1")
+                 .arg(query.lastError().text()));
+    return false;
+  }
+  return true;
+}
+
+/*!
+ * \brief Starts a transaction if one is not already open.
+ */
+bool
+EBookDatabase::beginBatch()
+{
+  if (!m_in_batch) {
+    m_in_batch = m_database.transaction();
+  }
+  return m_in_batch;
+}
+
+/*!
+ * \brief Commits the writes made since the last commit.
+ */
+bool
+EBookDatabase::commit()
+{
+  if (!m_in_batch) {
+    return true;
+  }
+  m_in_batch = false;
+  if (!m_database.commit()) {
+    QLOG_DEBUG(QString("Database commit failed : %1")
+                 .arg(m_database.lastError().text()));
+    return false;
+  }
+  return true;
+}
+
+/*!
+ * \brief Returns true if table has no rows, used to decide whether the yaml
+ * files should be imported.
+ */
+bool
+EBookDatabase::isEmpty(const QString& table)
+{
+  QSqlQuery query(m_database);
+  if (!query.exec(QString("SELECT 1 FROM %1 LIMIT 1").arg(table))) {
+    return true;
+  }
+  return !query.next();
+}
+
+bool
+EBookDatabase::createTables()
+{
+  QSqlQuery query(m_database);
+  foreach (QString statement, SCHEMA) {
+    if (!query.exec(statement)) {
+      QLOG_DEBUG(QString("Unable to create database tables : %1")
+                   .arg(query.lastError().text()));
+      return false;
+    }
+  }
+  return true;
+}
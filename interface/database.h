@@ -0,0 +1,48 @@
+#ifndef DATABASE_H
+#define DATABASE_H
+
+#include <QHash>
+#include <QSharedPointer>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QString>
+
+/*!
+ * \brief The SQLite store shared by the library, authors and series
+ * databases.
+ *
+ * Each of EBookLibraryDB, EBookAuthorsDB and EBookSeriesDB writes single
+ * records as they change rather than rewriting a whole file. Writes are
+ * batched into one transaction that is started by the first write and
+ * committed by commit(), which the databases call from their save().
+ */
+class EBookDatabase
+{
+public:
+  EBookDatabase();
+  ~EBookDatabase();
+
+  bool open(const QString& filename);
+  void close();
+  bool isOpen() const;
+
+  QSqlQuery prepare(const QString& statement);
+  bool exec(QSqlQuery& query);
+  bool beginBatch();
+  bool commit();
+  bool isEmpty(const QString& table);
+
+protected:
+  QSqlDatabase m_database;
+  QString m_connection_name;
+  QHash<QString, QSqlQuery> m_queries;
+  bool m_in_batch;
+
+  bool createTables();
+
+  static int m_connection_count;
+  static const QStringList SCHEMA;
+};
+typedef QSharedPointer<EBookDatabase> Database;
+
+#endif // DATABASE_H
@@ -0,0 +1,170 @@
+#include "ebookblockindex.h"
+
+#include <QTextBlock>
+
+/*!
+ * \brief Samples the blocks of the chapter in document, replacing any
+ * index of the chapter there was.
+ *
+ * This walks every block once, it is done when a book is left rather
+ * than when it is opened.
+ */
+void
+EBookBlockIndex::index(int chapter, const QTextDocument* document)
+{
+  Chapter indexed;
+  int number = 0;
+  for (QTextBlock block = document->begin(); block.isValid();
+       block = block.next()) {
+    if (number % INTERVAL == 0) {
+      indexed.offsets.append(block.position());
+    }
+    number++;
+  }
+  indexed.blocks = number;
+  m_chapters.insert(chapter, indexed);
+}
+
+/*!
+ * \brief The character position of a block of the chapter in document.
+ *
+ * \return the position, or -1 if the chapter is not indexed, has changed
+ *         since or has no such block.
+ */
+int
+EBookBlockIndex::position(int chapter,
+                          int block,
+                          const QTextDocument* document) const
+{
+  QMap<int, Chapter>::const_iterator it = m_chapters.constFind(chapter);
+  if (it == m_chapters.constEnd() ||
+      it.value().blocks != document->blockCount() || block < 0 ||
+      block >= it.value().blocks) {
+    return -1;
+  }
+  int sample = block / INTERVAL;
+  if (sample >= it.value().offsets.size()) {
+    return -1;
+  }
+  QTextBlock found = document->findBlock(it.value().offsets.at(sample));
+  for (int i = sample * INTERVAL; i < block && found.isValid(); i++) {
+    found = found.next();
+  }
+  return (found.isValid() ? found.position() : -1);
+}
+
+bool
+EBookBlockIndex::contains(int chapter) const
+{
+  return m_chapters.contains(chapter);
+}
+
+bool
+EBookBlockIndex::isEmpty() const
+{
+  return m_chapters.isEmpty();
+}
+
+/*!
+ * \brief The index as stored in the library, the chapter, its block count
+ * and the gaps between its samples as variable length numbers.
+ */
+QByteArray
+EBookBlockIndex::toByteArray() const
+{
+  QByteArray data;
+  for (QMap<int, Chapter>::const_iterator it = m_chapters.constBegin();
+       it != m_chapters.constEnd();
+       ++it) {
+    appendNumber(data, quint32(it.key()));
+    appendNumber(data, quint32(it.value().blocks));
+    appendNumber(data, quint32(it.value().offsets.size()));
+    int previous = 0;
+    foreach (int offset, it.value().offsets) {
+      appendNumber(data, quint32(offset - previous));
+      previous = offset;
+    }
+  }
+  return data;
+}
+
+/*!
+ * \brief Reads an index written by toByteArray(), anything after a
+ * damaged chapter is dropped.
+ */
+EBookBlockIndex
+EBookBlockIndex::fromByteArray(const QByteArray& data)
+{
+  EBookBlockIndex index;
+  int offset = 0;
+  while (offset < data.size()) {
+    quint32 chapter, blocks, count;
+    if (!readNumber(data, offset, chapter) ||
+        !readNumber(data, offset, blocks) ||
+        !readNumber(data, offset, count) || count > blocks) {
+      break;
+    }
+    Chapter indexed;
+    indexed.blocks = int(blocks);
+    quint32 position = 0;
+    for (quint32 i = 0; i < count; i++) {
+      quint32 gap;
+      if (!readNumber(data, offset, gap)) {
+        return index;
+      }
+      position += gap;
+      indexed.offsets.append(int(position));
+    }
+    index.m_chapters.insert(int(chapter), indexed);
+  }
+  return index;
+}
+
+bool
+EBookBlockIndex::operator==(const EBookBlockIndex& other) const
+{
+  if (m_chapters.size() != other.m_chapters.size()) {
+    return false;
+  }
+  for (QMap<int, Chapter>::const_iterator it = m_chapters.constBegin();
+       it != m_chapters.constEnd();
+       ++it) {
+    QMap<int, Chapter>::const_iterator found =
+      other.m_chapters.constFind(it.key());
+    if (found == other.m_chapters.constEnd() ||
+        found.value().blocks != it.value().blocks ||
+        found.value().offsets != it.value().offsets) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Seven bits a byte, the top bit set on all but the last.
+ */
+void
+EBookBlockIndex::appendNumber(QByteArray& data, quint32 value)
+{
+  while (value >= 0x80) {
+    data.append(char((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  data.append(char(value));
+}
+
+bool
+EBookBlockIndex::readNumber(const QByteArray& data,
+                            int& offset,
+                            quint32& value)
+{
+  value = 0;
+  for (int shift = 0; shift < 32 && offset < data.size(); shift += 7) {
+    quint8 byte = quint8(data.at(offset++));
+    value |= quint32(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,53 @@
+#ifndef EBOOKBLOCKINDEX_H
+#define EBOOKBLOCKINDEX_H
+
+#include <QByteArray>
+#include <QMap>
+#include <QTextDocument>
+#include <QVector>
+
+#include "interface_global.h"
+
+/*!
+ * \brief Where every INTERVAL-th block of the chapters of a book starts.
+ *
+ * A book is left at a chapter and block, see EBookData, and the index is
+ * stored with it so that the block can be found again when the book is
+ * reopened from the nearest sample, stepping over fewer than INTERVAL
+ * blocks, rather than by walking the chapter from its start.
+ *
+ * The index of a chapter is only used while the chapter still has the
+ * number of blocks it had when it was indexed.
+ */
+class INTERFACESHARED_EXPORT EBookBlockIndex
+{
+public:
+  void index(int chapter, const QTextDocument* document);
+  int position(int chapter, int block, const QTextDocument* document) const;
+  bool contains(int chapter) const;
+  bool isEmpty() const;
+
+  QByteArray toByteArray() const;
+  static EBookBlockIndex fromByteArray(const QByteArray& data);
+
+  bool operator==(const EBookBlockIndex& other) const;
+  bool operator!=(const EBookBlockIndex& other) const
+  {
+    return !(*this == other);
+  }
+
+  static const int INTERVAL = 256; // blocks between samples.
+
+protected:
+  struct Chapter
+  {
+    int blocks = 0;
+    QVector<int> offsets; // of blocks 0, INTERVAL, 2 * INTERVAL...
+  };
+  QMap<int, Chapter> m_chapters;
+
+  static void appendNumber(QByteArray& data, quint32 value);
+  static bool readNumber(const QByteArray& data, int& offset, quint32& value);
+};
+
+#endif // EBOOKBLOCKINDEX_H
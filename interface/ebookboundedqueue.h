@@ -0,0 +1,83 @@
+#ifndef EBOOKBOUNDEDQUEUE_H
+#define EBOOKBOUNDEDQUEUE_H
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QQueue>
+#include <QWaitCondition>
+
+/*!
+ * \brief A queue between the stages of a pipeline that holds at most
+ * capacity values.
+ *
+ * push() waits while the queue is full, so a fast stage can never get more
+ * than capacity values ahead of a slow one, and pop() waits while it is
+ * empty. Once the stage before has finished it calls close(), after which
+ * pop() returns false as soon as the queue is empty.
+ */
+template<typename T>
+class EBookBoundedQueue
+{
+public:
+  explicit EBookBoundedQueue(int capacity)
+    : m_capacity(qMax(1, capacity))
+    , m_closed(false)
+  {}
+
+  /*!
+   * \brief Adds value, waiting for room. Values pushed after close() are
+   * dropped.
+   */
+  void push(const T& value)
+  {
+    QMutexLocker locker(&m_mutex);
+    while (m_queue.size() >= m_capacity && !m_closed) {
+      m_not_full.wait(&m_mutex);
+    }
+    if (m_closed) {
+      return;
+    }
+    m_queue.enqueue(value);
+    m_not_empty.wakeOne();
+  }
+
+  /*!
+   * \brief Takes the oldest value, waiting for one.
+   *
+   * \return false if the queue is closed and empty.
+   */
+  bool pop(T& value)
+  {
+    QMutexLocker locker(&m_mutex);
+    while (m_queue.isEmpty() && !m_closed) {
+      m_not_empty.wait(&m_mutex);
+    }
+    if (m_queue.isEmpty()) {
+      return false;
+    }
+    value = m_queue.dequeue();
+    m_not_full.wakeOne();
+    return true;
+  }
+
+  /*!
+   * \brief Marks the end of the values, any waiting pop() or push() returns.
+   */
+  void close()
+  {
+    QMutexLocker locker(&m_mutex);
+    m_closed = true;
+    m_not_empty.wakeAll();
+    m_not_full.wakeAll();
+  }
+
+protected:
+  QMutex m_mutex;
+  QWaitCondition m_not_empty;
+  QWaitCondition m_not_full;
+  QQueue<T> m_queue;
+  int m_capacity;
+  bool m_closed;
+};
+
+#endif // EBOOKBOUNDEDQUEUE_H
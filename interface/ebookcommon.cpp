@@ -201,30 +201,132 @@ QTextCursor TocDisplayDocument::endOfListItems()
 
 int TocDisplayDocument::lineCount()
 {
-  return m_toc_positioning.size();
+  return m_line_lengths.size();
 }
 
+/*!
+ * \brief Lays out the whole toc. The lines added with addLinePosition() are
+ * taken from it, so that they can be changed one at a time by setLine().
+ */
 void TocDisplayDocument::setTocString(QString toc_string)
 {
   m_toc_string = toc_string;
+  m_toc_dirty = false;
+  m_lines.clear();
+  m_toc_start.clear();
+  m_toc_end.clear();
+  int count = m_line_lengths.size();
+  if (count > 0) {
+    m_toc_start = toc_string.left(m_first_line_start);
+    m_lines.reserve(count);
+    for (int i = 0; i < count; i++) {
+      QPair<int, int> position = linePosition(i);
+      m_lines.append(toc_string.mid(position.first, position.second));
+    }
+    QPair<int, int> last = linePosition(count - 1);
+    m_toc_end = toc_string.mid(last.first + last.second);
+  }
   setHtml(toc_string);
+
+  // each toc line is one block of the list.
+  m_first_line_block = 0;
+  for (QTextBlock block = begin(); block.isValid(); block = block.next()) {
+    if (block.textList()) {
+      m_first_line_block = block.blockNumber();
+      break;
+    }
+  }
 }
 
 QString TocDisplayDocument::tocString()
 {
+  if (m_toc_dirty) {
+    QString toc_string = m_toc_start;
+    foreach (QString line, m_lines) {
+      toc_string += line;
+    }
+    toc_string += m_toc_end;
+    m_toc_string = toc_string;
+    m_toc_dirty = false;
+  }
   return m_toc_string;
 }
 
-void TocDisplayDocument::updateLinePosition(int line_index, QPair<int,int> data,
-    int old_line_offset)
+/*!
+ * \brief Replaces one toc line.
+ *
+ * Only the block of the line is changed and laid out again. An empty line
+ * hides the block. The toc string is put back together when it is next
+ * asked for.
+ *
+ * \param line the html of the line in the toc string, empty if it is
+ *        disabled.
+ * \param href the link of the line as shown.
+ * \param text the text of the line as shown.
+ */
+void TocDisplayDocument::setLine(int line_index,
+                                 const QString& line,
+                                 const QString& href,
+                                 const QString& text)
 {
-  m_toc_positioning[line_index] = data;
-  // update remaining start positions for change in modified text length.
-  if (line_index < m_toc_positioning.size() - 1) {
-    for (int i = line_index + 1; i < m_toc_positioning.size(); i++) {
-      QPair<int,int> position = m_toc_positioning.value(i);
-      position.first += old_line_offset; // this could be a negative value.
-    }
+  if (line_index < 0 || line_index >= m_lines.size()) {
+    return;
+  }
+  m_lines[line_index] = line;
+  updateLineLength(line_index, line.length());
+  m_toc_dirty = true;
+
+  QTextBlock block = findBlockByNumber(m_first_line_block + line_index);
+  if (!block.isValid()) {
+    return;
+  }
+  if (line.isEmpty()) {
+    block.setVisible(false);
+  } else {
+    QTextCursor cursor(block);
+    // keep the look of the link as it was laid out.
+    QTextCharFormat format = (block.begin() != block.end()
+                                ? block.begin().fragment().charFormat()
+                                : cursor.charFormat());
+    format.setAnchor(true);
+    format.setAnchorHref(href);
+    cursor.movePosition(QTextCursor::EndOfBlock, QTextCursor::KeepAnchor);
+    cursor.insertText(text, format);
+    block.setVisible(true);
+  }
+  markContentsDirty(block.position(), block.length());
+}
+
+/*!
+ * \brief Changes the length of a toc line, the lines after it move with
+ * it.
+ */
+void TocDisplayDocument::updateLineLength(int line_index, int length)
+{
+  if (line_index < 0 || line_index >= m_line_lengths.size()) {
+    return;
+  }
+  int delta = length - m_line_lengths.at(line_index);
+  m_line_lengths[line_index] = length;
+  addToLength(line_index, delta);
+}
+
+/*
+ * The total length of the lines before line_index.
+ */
+int TocDisplayDocument::lengthBefore(int line_index) const
+{
+  int sum = 0;
+  for (int i = line_index; i > 0; i -= (i & -i)) {
+    sum += m_length_tree.at(i - 1);
+  }
+  return sum;
+}
+
+void TocDisplayDocument::addToLength(int line_index, int delta)
+{
+  for (int i = line_index + 1; i <= m_length_tree.size(); i += (i & -i)) {
+    m_length_tree[i - 1] += delta;
   }
 }
 
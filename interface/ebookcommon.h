@@ -11,7 +11,9 @@
 #include <QPoint>
 #include <QSharedPointer>
 #include <QTextCursor>
+#include <QTextBlock>
 #include <QTextDocument>
+#include <QVector>
 #include <QtPlugin>
 
 
@@ -23,9 +25,10 @@ public:
   TocDisplayDocument(QObject* parent);
   ~TocDisplayDocument();
 
+  void clearLinePositions();
   void addLinePosition(int line_index, int start_position,
                        int length);
-  void updateLinePosition(int line_index, QPair<int, int> data, int old_line_offset);
+  void updateLineLength(int line_index, int length);
   QPair<int, int> linePosition(int index);
 //  void setLinePosition(int line_index, TocLinePosition position);
 //  void setEndOfListItems(QTextCursor& line_position);
@@ -33,11 +36,29 @@ public:
   int lineCount();
   void setTocString(QString toc_string);
   QString tocString();
+  void setLine(int line_index,
+               const QString& line,
+               const QString& href,
+               const QString& text);
 
 protected:
+  // the toc string is only put back together from its lines when it is
+  // asked for after a line has changed.
   QString m_toc_string;
-  QMap<int, QPair<int, int>> m_toc_positioning;
+  QString m_toc_start, m_toc_end;
+  QVector<QString> m_lines;
+  bool m_toc_dirty;
+  int m_first_line_block;
+  // the toc lines follow on from each other so only their lengths are kept,
+  // with a Fenwick tree of them so that a line start is found, and a line
+  // length changed, in O(log n).
+  int m_first_line_start;
+  QVector<int> m_line_lengths;
+  QVector<int> m_length_tree;
   QTextCursor m_end_of_listitems;
+
+  int lengthBefore(int line_index) const;
+  void addToLength(int line_index, int delta);
 };
 
 struct EPubNavPoint {
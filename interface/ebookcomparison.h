@@ -0,0 +1,47 @@
+#ifndef EBOOKCOMPARISON_H
+#define EBOOKCOMPARISON_H
+
+#include <QList>
+#include <QString>
+
+/*!
+ * \brief A file that differs between two versions of a book.
+ */
+struct EBookEntryDifference
+{
+  enum Change
+  {
+    ADDED,   // only in the changed book.
+    REMOVED, // only in the original book.
+    CHANGED,
+  };
+
+  QString path; // within the book.
+  Change change = CHANGED;
+  int chapter = -1; // the reading order position, -1 if not a chapter.
+  QString title;    // the table of contents title of a chapter.
+  bool text = false; // a text file, which has a diff if it changed.
+  QString diff;      // unified diff, see EBookTextDiff::unified().
+  int added_lines = 0;
+  int removed_lines = 0;
+};
+typedef QList<EBookEntryDifference> EBookEntryDifferenceList;
+
+/*!
+ * \brief The differences between two versions of a book, see
+ * IEBookInterface::compareBooks().
+ *
+ * The chapters come first in the reading order of the book, then the
+ * other files in order of their paths.
+ */
+struct EBookComparison
+{
+  QString original;
+  QString changed;
+  EBookEntryDifferenceList differences;
+  int unchanged = 0; // the files found equal.
+
+  bool isSame() const { return differences.isEmpty(); }
+};
+
+#endif // EBOOKCOMPARISON_H
@@ -0,0 +1,65 @@
+#ifndef EBOOKCONTENT_H
+#define EBOOKCONTENT_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+#include "ebookmetadata.h"
+
+/*!
+ * \brief A chapter of an EBookContent.
+ */
+struct EBookContentChapter
+{
+  QString href;  // the file name, unique within the book.
+  QString title; // the table of contents title, empty if it has none.
+  QString xhtml;
+};
+typedef QList<EBookContentChapter> EBookContentChapterList;
+
+/*!
+ * \brief A file that the chapters use, an image, stylesheet or font.
+ */
+struct EBookContentResource
+{
+  QString href;
+  QString media_type;
+  QByteArray data;
+};
+typedef QList<EBookContentResource> EBookContentResourceList;
+
+/*!
+ * \brief A whole book in no particular format, read by one plugin and
+ * written by another, see EBookConverter.
+ *
+ * Hrefs are relative to the root of the book and the chapters link to each
+ * other and to the resources by them, so a writer must keep them as they
+ * are. The chapters hold whatever markup the reader found until
+ * EBookConverter::transform() has made well formed xhtml of them.
+ */
+struct EBookContent
+{
+  Metadata metadata;
+  EBookContentChapterList chapters; // in reading order.
+  EBookContentResourceList resources;
+  QString cover_href; // the resource that is the cover, empty if none.
+
+  /*!
+   * \brief The bytes held by the chapters and resources, which is what
+   * bounds the memory used by a conversion.
+   */
+  qint64 bytes() const
+  {
+    qint64 total = 0;
+    foreach (const EBookContentChapter& chapter, chapters) {
+      total += qint64(chapter.xhtml.size()) * sizeof(QChar);
+    }
+    foreach (const EBookContentResource& resource, resources) {
+      total += resource.data.size();
+    }
+    return total;
+  }
+};
+
+#endif // EBOOKCONTENT_H
@@ -0,0 +1,253 @@
+#include "ebookconverter.h"
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
+
+#include "ebookboundedqueue.h"
+#include "ebookjobs.h"
+#include "ebooktrace.h"
+#include "iebookinterface.h"
+#include "xhtmlcleaner.h"
+
+/*
+ * A book on its way through the pipeline, the index is that of its
+ * conversion.
+ */
+struct EBookConvertingBook
+{
+  int index = -1;
+  EBookContent content;
+};
+
+/*!
+ * \brief Constructs a converter with two readers, a transformer for each
+ * core and a writer for every two cores.
+ */
+EBookConverter::EBookConverter()
+  : m_readers(2)
+  , m_transformers(qMax(1, QThread::idealThreadCount()))
+  , m_writers(qMax(1, QThread::idealThreadCount() / 2))
+  , m_queue_size(qMax(1, QThread::idealThreadCount()))
+{}
+
+int
+EBookConverter::readers() const
+{
+  return m_readers;
+}
+
+int
+EBookConverter::transformers() const
+{
+  return m_transformers;
+}
+
+int
+EBookConverter::writers() const
+{
+  return m_writers;
+}
+
+/*!
+ * \brief Sets the number of workers of each stage, each is at least one.
+ */
+void
+EBookConverter::setWorkers(int readers, int transformers, int writers)
+{
+  m_readers = qMax(1, readers);
+  m_transformers = qMax(1, transformers);
+  m_writers = qMax(1, writers);
+}
+
+int
+EBookConverter::queueSize() const
+{
+  return m_queue_size;
+}
+
+/*!
+ * \brief Sets the number of books that can wait between two stages.
+ */
+void
+EBookConverter::setQueueSize(int books)
+{
+  m_queue_size = qMax(1, books);
+}
+
+/*!
+ * \brief Converts the books, returning once every one has been written or
+ * has failed.
+ *
+ * \param progress if set is called as each book finishes, from whichever
+ *        worker finished it, one call at a time.
+ * \return the results in the order of conversions.
+ */
+EBookConversionResultList
+EBookConverter::convert(const QList<EBookConversion>& conversions,
+                        Progress progress)
+{
+  EBOOK_TRACE_SCOPE("EBookConverter::convert");
+  QVector<EBookConversionResult> results(conversions.size());
+  for (int i = 0; i < conversions.size(); i++) {
+    results[i].source = conversions.at(i).source;
+    results[i].target = conversions.at(i).target;
+  }
+
+  QMutex result_mutex;
+  auto finish = [&](int index, const QString& error) {
+    QMutexLocker locker(&result_mutex);
+    EBookConversionResult& result = results[index];
+    result.success = error.isEmpty();
+    result.error = error;
+    if (progress) {
+      progress(result);
+    }
+  };
+
+  EBookBoundedQueue<EBookConvertingBook> read_queue(m_queue_size);
+  EBookBoundedQueue<EBookConvertingBook> write_queue(m_queue_size);
+  QAtomicInt next(0);
+  QAtomicInt readers_left(m_readers);
+  QAtomicInt transformers_left(m_transformers);
+
+  // the last worker of a stage closes the queue to the next.
+  auto read = [&]() {
+    int index;
+    while ((index = next.fetchAndAddOrdered(1)) < conversions.size()) {
+      EBOOK_TRACE_SCOPE("EBookConverter::read");
+      const EBookConversion& conversion = conversions.at(index);
+      if (!conversion.reader || !conversion.writer) {
+        finish(index, tr("Books of this type cannot be converted"));
+        continue;
+      }
+      EBookConvertingBook book;
+      book.index = index;
+      if (!conversion.reader->readContent(conversion.source, book.content)) {
+        finish(index, tr("Unable to read the book"));
+        continue;
+      }
+      read_queue.push(book);
+    }
+    if (!readers_left.deref()) {
+      read_queue.close();
+    }
+  };
+
+  auto transform_books = [&]() {
+    EBookConvertingBook book;
+    while (read_queue.pop(book)) {
+      EBOOK_TRACE_SCOPE("EBookConverter::transform");
+      QString error;
+      if (transform(book.content, error)) {
+        write_queue.push(book);
+      } else {
+        finish(book.index, error);
+      }
+      // let the book go as soon as it has been handed on.
+      book = EBookConvertingBook();
+    }
+    if (!transformers_left.deref()) {
+      write_queue.close();
+    }
+  };
+
+  auto write = [&]() {
+    EBookConvertingBook book;
+    while (write_queue.pop(book)) {
+      EBOOK_TRACE_SCOPE("EBookConverter::write");
+      const EBookConversion& conversion = conversions.at(book.index);
+      if (conversion.writer->writeContent(book.content, conversion.target)) {
+        finish(book.index, QString());
+      } else {
+        finish(book.index, tr("Unable to write %1").arg(conversion.target));
+      }
+      book = EBookConvertingBook();
+    }
+  };
+
+  QThreadPool pool;
+  pool.setMaxThreadCount(m_readers + m_transformers + m_writers);
+  for (int i = 0; i < m_readers; i++) {
+    pool.start(new EBookJob<bool>([&read](QFutureInterface<bool>&) {
+      read();
+      return true;
+    }));
+  }
+  for (int i = 0; i < m_transformers; i++) {
+    pool.start(
+      new EBookJob<bool>([&transform_books](QFutureInterface<bool>&) {
+        transform_books();
+        return true;
+      }));
+  }
+  for (int i = 0; i < m_writers; i++) {
+    pool.start(new EBookJob<bool>([&write](QFutureInterface<bool>&) {
+      write();
+      return true;
+    }));
+  }
+  pool.waitForDone();
+
+  return results.toList();
+}
+
+/*!
+ * \brief The stage between reading and writing, which leaves a book that
+ * any writer can take.
+ *
+ * The chapters, and any other html pages, are made well formed xhtml by
+ * XhtmlCleaner and chapters with no title are given the text of their
+ * first heading. A book with no metadata is given empty metadata.
+ *
+ * \return false, with the reason in error, if the book cannot be written.
+ */
+bool
+EBookConverter::transform(EBookContent& content, QString& error)
+{
+  if (content.chapters.isEmpty()) {
+    error = tr("The book has no chapters");
+    return false;
+  }
+
+  QSet<QString> hrefs;
+  for (int i = 0; i < content.chapters.size(); i++) {
+    EBookContentChapter& chapter = content.chapters[i];
+    if (chapter.href.isEmpty() || hrefs.contains(chapter.href)) {
+      error = tr("The chapters of the book do not have unique names");
+      return false;
+    }
+    hrefs.insert(chapter.href);
+    QString title;
+    chapter.xhtml = XhtmlCleaner::clean(chapter.xhtml, &title);
+    if (chapter.title.isEmpty()) {
+      chapter.title = title;
+    }
+  }
+
+  bool has_cover = false;
+  for (int i = 0; i < content.resources.size(); i++) {
+    EBookContentResource& resource = content.resources[i];
+    if (resource.media_type == "application/xhtml+xml" ||
+        resource.media_type == "text/html") {
+      resource.data =
+        XhtmlCleaner::clean(QString::fromUtf8(resource.data)).toUtf8();
+      resource.media_type = "application/xhtml+xml";
+    }
+    if (resource.href == content.cover_href) {
+      has_cover = true;
+    }
+  }
+  if (!has_cover) {
+    content.cover_href.clear();
+  }
+
+  if (!content.metadata) {
+    content.metadata = Metadata(new EBookMetadata());
+  }
+  return true;
+}
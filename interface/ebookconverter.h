@@ -0,0 +1,88 @@
+#ifndef EBOOKCONVERTER_H
+#define EBOOKCONVERTER_H
+
+#include <QCoreApplication>
+#include <QList>
+#include <QString>
+
+#include <functional>
+
+#include "ebookcontent.h"
+#include "interface_global.h"
+
+class IEBookInterface;
+
+/*!
+ * \brief One book to convert, the plugin that reads it and the plugin that
+ * writes the converted copy to target.
+ */
+struct EBookConversion
+{
+  QString source;
+  QString target;
+  IEBookInterface* reader = nullptr;
+  IEBookInterface* writer = nullptr;
+};
+
+/*!
+ * \brief The outcome of one EBookConversion.
+ */
+struct EBookConversionResult
+{
+  QString source;
+  QString target;
+  bool success = false;
+  QString error; // empty if successful.
+};
+typedef QList<EBookConversionResult> EBookConversionResultList;
+
+/*!
+ * \brief Converts books between the formats of the book plugins.
+ *
+ * A book is read into an EBookContent by IEBookInterface::readContent(),
+ * made into well formed xhtml by transform() and written out again by
+ * IEBookInterface::writeContent() of another plugin.
+ *
+ * The three steps run as a pipeline, each stage on its own workers, with a
+ * bounded queue between one stage and the next. Reading is mostly waiting
+ * on the disk and writing mostly compressing, so while one book is
+ * written the next are being read and transformed. At most queueSize()
+ * books wait between two stages, so however many books are converted no
+ * more than about
+ *
+ *   readers + transformers + writers + 2 * queueSize()
+ *
+ * books are held in memory at once.
+ *
+ * The stages run on a thread pool of their own rather than the global
+ * pool, as they wait on the queues and would otherwise hold back every
+ * other job.
+ */
+class INTERFACESHARED_EXPORT EBookConverter
+{
+  Q_DECLARE_TR_FUNCTIONS(EBookConverter)
+public:
+  typedef std::function<void(const EBookConversionResult&)> Progress;
+
+  EBookConverter();
+
+  int readers() const;
+  int transformers() const;
+  int writers() const;
+  void setWorkers(int readers, int transformers, int writers);
+  int queueSize() const;
+  void setQueueSize(int books);
+
+  EBookConversionResultList convert(const QList<EBookConversion>& conversions,
+                                    Progress progress = Progress());
+
+  static bool transform(EBookContent& content, QString& error);
+
+protected:
+  int m_readers;
+  int m_transformers;
+  int m_writers;
+  int m_queue_size;
+};
+
+#endif // EBOOKCONVERTER_H
@@ -0,0 +1,197 @@
+#include "ebookimagecache.h"
+
+#include <QBuffer>
+#include <QImageReader>
+
+#include <qlogger/qlogger.h>
+
+using namespace qlogger;
+
+EBookImageCache::EBookImageCache(int megabytes)
+  : m_cache(qMax(0, megabytes) * 1024)
+{}
+
+void
+EBookImageCache::setSize(int megabytes)
+{
+  m_cache.setMaxCost(qMax(0, megabytes) * 1024);
+}
+
+int
+EBookImageCache::size() const
+{
+  return m_cache.maxCost() / 1024;
+}
+
+void
+EBookImageCache::clear()
+{
+  m_cache.clear();
+  m_entries.clear();
+}
+
+/*!
+ * \brief The image decoded from data, from the cache if it has already been
+ * decoded at this size.
+ */
+QImage
+EBookImageCache::image(const QString& id,
+                       const QByteArray& data,
+                       QSize image_size)
+{
+  QImage image = cached(id, image_size);
+  if (!image.isNull()) {
+    return image;
+  }
+  image = decodeImage(data, image_size);
+  if (!image.isNull()) {
+    insert(id, image_size, image);
+  }
+  return image;
+}
+
+/*!
+ * \brief The cached image, or a null image if there is none.
+ */
+QImage
+EBookImageCache::cached(const QString& id, QSize image_size)
+{
+  QImage* image = m_cache.object(key(id, image_size));
+  return (image ? *image : QImage());
+}
+
+void
+EBookImageCache::insert(const QString& id,
+                        QSize image_size,
+                        const QImage& image)
+{
+  // oversized images are simply not cached.
+  int cost = int((qint64(image.bytesPerLine()) * image.height()) / 1024);
+  QString image_key = key(id, image_size);
+  if (m_cache.insert(image_key, new QImage(image), qMax(1, cost))) {
+    Entry entry;
+    entry.id = id;
+    entry.size = image_size;
+    entry.cost = qMax(1, cost);
+    m_entries.insert(image_key, entry);
+    if (m_entries.size() > 2 * m_cache.count() + PRUNE_SLACK) {
+      prune();
+    }
+  }
+}
+
+/*!
+ * \brief The bytes held by the cached images.
+ */
+qint64
+EBookImageCache::bytes() const
+{
+  return qint64(m_cache.totalCost()) * 1024;
+}
+
+/*!
+ * \brief The bytes held by the cached images of the ids, at any size.
+ *
+ * The cache is not touched, so asking does not change which images are
+ * evicted first.
+ */
+qint64
+EBookImageCache::bytes(const QSet<QString>& ids) const
+{
+  qint64 total = 0;
+  for (QHash<QString, Entry>::const_iterator it = m_entries.constBegin();
+       it != m_entries.constEnd();
+       ++it) {
+    if (ids.contains(it.value().id) && m_cache.contains(it.key())) {
+      total += qint64(it.value().cost) * 1024;
+    }
+  }
+  return total;
+}
+
+/*!
+ * \brief The cached image of id whose width is closest to that of
+ * image_size, or a null image if none of its sizes are cached.
+ *
+ * This stands in while the image is decoded at the size wanted, and so
+ * becomes the most recently used.
+ */
+QImage
+EBookImageCache::closest(const QString& id, QSize image_size)
+{
+  QString found;
+  int best = -1;
+  for (QHash<QString, Entry>::const_iterator it = m_entries.constBegin();
+       it != m_entries.constEnd();
+       ++it) {
+    if (it.value().id != id || !m_cache.contains(it.key())) {
+      continue;
+    }
+    int difference = qAbs(it.value().size.width() - image_size.width());
+    if (best < 0 || difference < best) {
+      best = difference;
+      found = it.key();
+    }
+  }
+  if (best < 0) {
+    return QImage();
+  }
+  QImage* image = m_cache.object(found);
+  return (image ? *image : QImage());
+}
+
+/*
+ * Drops the entries of images that the cache has evicted.
+ */
+void
+EBookImageCache::prune()
+{
+  QHash<QString, Entry>::iterator it = m_entries.begin();
+  while (it != m_entries.end()) {
+    if (m_cache.contains(it.key())) {
+      ++it;
+    } else {
+      it = m_entries.erase(it);
+    }
+  }
+}
+
+QString
+EBookImageCache::key(const QString& id, QSize image_size)
+{
+  return QString("%1@%2x%3")
+    .arg(id)
+    .arg(image_size.width())
+    .arg(image_size.height());
+}
+
+/*!
+ * \brief Decodes compressed image data.
+ *
+ * If image_size is valid and the image is larger the image is decoded
+ * directly at the reduced size, keeping its aspect ratio, so the
+ * full resolution image is never built.
+ */
+QImage
+EBookImageCache::decodeImage(const QByteArray& data, QSize image_size)
+{
+  QByteArray image_data(data);
+  QBuffer buffer(&image_data);
+  buffer.open(QIODevice::ReadOnly);
+  QImageReader reader(&buffer);
+
+  QSize original_size = reader.size();
+  if (image_size.isValid() && original_size.isValid() &&
+      (original_size.width() > image_size.width() ||
+       original_size.height() > image_size.height())) {
+    reader.setScaledSize(
+      original_size.scaled(image_size, Qt::KeepAspectRatio));
+  }
+
+  QImage image = reader.read();
+  if (image.isNull()) {
+    QLOG_DEBUG(
+      QString("Unable to decode image : %1").arg(reader.errorString()));
+  }
+  return image;
+}
@@ -0,0 +1,59 @@
+#ifndef EBOOKIMAGECACHE_H
+#define EBOOKIMAGECACHE_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QSet>
+#include <QSize>
+#include <QString>
+
+/*!
+ * \brief A least recently used cache of decoded book images.
+ *
+ * Books keep only the compressed data of their images, an image is decoded
+ * when the layout first asks for it, at no more than the size it will be
+ * shown at, and held here until the cache grows past its size in megabytes.
+ * Images are kept for each size they were asked for.
+ */
+class EBookImageCache
+{
+public:
+  explicit EBookImageCache(int megabytes = DEFAULT_SIZE);
+
+  void setSize(int megabytes);
+  int size() const;
+  void clear();
+
+  QImage image(const QString& id,
+               const QByteArray& data,
+               QSize image_size = QSize());
+  QImage cached(const QString& id, QSize image_size);
+  QImage closest(const QString& id, QSize image_size);
+  void insert(const QString& id, QSize image_size, const QImage& image);
+  qint64 bytes() const;
+  qint64 bytes(const QSet<QString>& ids) const;
+
+  static QString key(const QString& id, QSize image_size);
+  static QImage decodeImage(const QByteArray& data, QSize image_size);
+
+  static const int DEFAULT_SIZE = 256; // MB
+  static const int PRUNE_SLACK = 64;
+
+protected:
+  struct Entry
+  {
+    QString id;
+    QSize size;
+    int cost; // in KB.
+  };
+
+  QCache<QString, QImage> m_cache; // cost is in KB.
+  // each key inserted, those evicted are pruned lazily.
+  QHash<QString, Entry> m_entries;
+
+  void prune();
+};
+
+#endif // EBOOKIMAGECACHE_H
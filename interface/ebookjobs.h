@@ -0,0 +1,87 @@
+#ifndef EBOOKJOBS_H
+#define EBOOKJOBS_H
+
+#include <QFuture>
+#include <QFutureInterface>
+#include <QRunnable>
+#include <QThreadPool>
+
+#include <functional>
+
+#include "interface_global.h"
+
+/*!
+ * \brief A job run by EBookJobs, the work and the future it reports to.
+ *
+ * The work is handed the QFutureInterface of the job so that a long job
+ * can look at isCanceled() and stop early, or report its progress.
+ */
+template<typename T>
+class EBookJob : public QRunnable
+{
+public:
+  typedef std::function<T(QFutureInterface<T>&)> Work;
+
+  explicit EBookJob(Work work)
+    : m_work(work)
+  {
+    m_interface.reportStarted();
+  }
+
+  QFuture<T> future() { return m_interface.future(); }
+
+  void run() override
+  {
+    // cancelled while it was still queued.
+    if (!m_interface.isCanceled()) {
+      T result = m_work(m_interface);
+      if (!m_interface.isCanceled()) {
+        m_interface.reportResult(result);
+      }
+    }
+    m_interface.reportFinished();
+  }
+
+protected:
+  Work m_work;
+  QFutureInterface<T> m_interface;
+};
+
+/*!
+ * \brief Runs the background work of the application and its plugins in
+ * one thread pool.
+ *
+ * The pool is Qt's global thread pool, which lives in QtCore and so is the
+ * same pool whichever plugin submits to it, and is the one that
+ * QtConcurrent already uses. It runs at most one thread for each core.
+ * Waiting jobs start in order of priority, then in the order they were
+ * submitted, and a job whose future is cancelled before it starts is never
+ * run.
+ *
+ * Results come back through the QFuture, which a QFutureWatcher turns into
+ * signals.
+ */
+class INTERFACESHARED_EXPORT EBookJobs
+{
+public:
+  enum Priority
+  {
+    LOW_PRIORITY = -1,
+    NORMAL_PRIORITY = 0,
+    HIGH_PRIORITY = 1,
+  };
+
+  template<typename T>
+  static QFuture<T> submit(typename EBookJob<T>::Work work,
+                           int priority = NORMAL_PRIORITY)
+  {
+    EBookJob<T>* job = new EBookJob<T>(work);
+    QFuture<T> future = job->future();
+    pool()->start(job, priority);
+    return future;
+  }
+
+  static QThreadPool* pool() { return QThreadPool::globalInstance(); }
+};
+
+#endif // EBOOKJOBS_H
@@ -4,8 +4,70 @@
 
 #include <qlogger/qlogger.h>
 
+#include "ebookstringpool.h"
+#include "lookuptable.h"
+
 using namespace qlogger;
 
+// languages, directions and schemes repeat across every book.
+static QString
+intern(const QString& value)
+{
+  return EBookStringPool::instance()->intern(value);
+}
+
+typedef LookupEntry<EBookMetadata::MetadataToken> MetadataTokenEntry;
+
+// the local names of the dc: elements, sorted by name.
+static constexpr MetadataTokenEntry DC_ELEMENTS[] = {
+  { "contributor", EBookMetadata::DC_CONTRIBUTOR },
+  { "coverage", EBookMetadata::DC_COVERAGE },
+  { "creator", EBookMetadata::DC_CREATOR },
+  { "date", EBookMetadata::DC_DATE },
+  { "description", EBookMetadata::DC_DESCRIPTION },
+  { "format", EBookMetadata::DC_FORMAT },
+  { "identifier", EBookMetadata::DC_IDENTIFIER },
+  { "language", EBookMetadata::DC_LANGUAGE },
+  { "publisher", EBookMetadata::DC_PUBLISHER },
+  { "relation", EBookMetadata::DC_RELATION },
+  { "rights", EBookMetadata::DC_RIGHTS },
+  { "source", EBookMetadata::DC_SOURCE },
+  { "subject", EBookMetadata::DC_SUBJECT },
+  { "title", EBookMetadata::DC_TITLE },
+  { "type", EBookMetadata::DC_TYPE },
+};
+static_assert(LookupTable::isSorted(DC_ELEMENTS),
+              "dc element names must be sorted");
+
+// the property values of refining metas, sorted by name.
+static constexpr MetadataTokenEntry REFINE_PROPERTIES[] = {
+  { "alternate-script", EBookMetadata::PROPERTY_ALTERNATE_SCRIPT },
+  { "dcterms:date", EBookMetadata::PROPERTY_DCTERMS_DATE },
+  { "display-seq", EBookMetadata::PROPERTY_DISPLAY_SEQ },
+  { "file-as", EBookMetadata::PROPERTY_FILE_AS },
+  { "language", EBookMetadata::PROPERTY_LANGUAGE },
+  { "role", EBookMetadata::PROPERTY_ROLE },
+  { "title-type", EBookMetadata::PROPERTY_TITLE_TYPE },
+};
+static_assert(LookupTable::isSorted(REFINE_PROPERTIES),
+              "refine properties must be sorted");
+
+// the calibre meta names, sorted by name.
+static constexpr MetadataTokenEntry CALIBRE_NAMES[] = {
+  { "calibre:author_link_map", EBookMetadata::CALIBRE_AUTHOR_LINK_MAP },
+  { "calibre:custom_metadata", EBookMetadata::CALIBRE_CUSTOM_METADATA },
+  { "calibre:publication_type", EBookMetadata::CALIBRE_PUBLICATION_TYPE },
+  { "calibre:rating", EBookMetadata::CALIBRE_RATING },
+  { "calibre:series", EBookMetadata::CALIBRE_SERIES },
+  { "calibre:series_index", EBookMetadata::CALIBRE_SERIES_INDEX },
+  { "calibre:timestamp", EBookMetadata::CALIBRE_TIMESTAMP },
+  { "calibre:title_sort", EBookMetadata::CALIBRE_TITLE_SORT },
+  { "calibre:user_categories", EBookMetadata::CALIBRE_USER_CATEGORIES },
+  { "calibre:user_metadata", EBookMetadata::CALIBRE_USER_METADATA },
+};
+static_assert(LookupTable::isSorted(CALIBRE_NAMES),
+              "calibre names must be sorted");
+
 EBookMetadata::EBookMetadata()
   : m_calibre(Calibre(new EBookCalibre()))
   , m_is_foaf(false)
@@ -129,6 +191,8 @@ EBookMetadata::write(QXmlStreamWriter* xml_writer)
     writeCoverageMetadata(xml_writer);
   }
 
+  writeNamedMetas(xml_writer);
+
   xml_writer->writeEndElement();
 
   return true;
@@ -195,6 +259,73 @@ EBookMetadata::setCalibre(const Calibre& calibre)
   m_calibre = calibre;
 }
 
+/*!
+ * \brief Renames the creators and sets the series of an edit.
+ *
+ * The file as names of a renamed creator are dropped, they were made from
+ * the name that is being corrected.
+ *
+ * \return true if anything was changed.
+ */
+bool
+EBookMetadata::applyEdit(const EBookMetadataEdit& edit)
+{
+  bool changed = false;
+  for (QMap<QString, QString>::const_iterator it = edit.creators.constBegin();
+       it != edit.creators.constEnd();
+       ++it) {
+    if (it.key() == it.value() || !m_creators_by_name.contains(it.key())) {
+      continue;
+    }
+    foreach (Creator creator, m_creators_by_name.values(it.key())) {
+      m_creators_by_name.remove(it.key(), creator);
+      creator->name = it.value();
+      creator->file_as_list.clear();
+      m_creators_by_name.insert(creator->name, creator);
+    }
+    for (int i = 0; i < m_creator_list.size(); i++) {
+      if (m_creator_list.at(i) == it.key()) {
+        m_creator_list[i] = it.value();
+      }
+    }
+    changed = true;
+  }
+  if (edit.set_series && m_calibre->seriesName() != edit.series) {
+    m_calibre->setSeriesName(edit.series);
+    if (edit.series.isEmpty()) {
+      m_calibre->setSeriesIndex(QString());
+    }
+    m_calibre->setModified(true);
+    changed = true;
+  }
+  return changed;
+}
+
+/*!
+ * \brief Returns the content of an unrecognised <meta name=""> tag, such as
+ * the EPUB 2 cover, or an empty string if there was none.
+ */
+QString
+EBookMetadata::extraMeta(const QString& name) const
+{
+  return m_extra_metas.value(name.toLower());
+}
+
+/*!
+ * \brief The dc:language values, the first is that of the book as a whole.
+ */
+QStringList
+EBookMetadata::languages() const
+{
+  QStringList languages;
+  foreach (Language language, m_languages) {
+    if (!language->language.isEmpty()) {
+      languages << language->language;
+    }
+  }
+  return languages;
+}
+
 void
 EBookMetadata::writeCreator(QXmlStreamWriter* xml_writer,
                             Creator shared_creator)
@@ -238,11 +369,11 @@ EBookMetadata::parsePublisherMetadata(const QDomElement& metadata_element)
   }
   node = node_map.namedItem("lang");
   if (!node.isNull()) {
-    shared_publisher->lang = node.nodeValue();
+    shared_publisher->lang = intern(node.nodeValue());
   }
   node = node_map.namedItem("dir");
   if (!node.isNull()) {
-    shared_publisher->dir = node.nodeValue();
+    shared_publisher->dir = intern(node.nodeValue());
   }
   node = node_map.namedItem("alt-rep");
   if (!node.isNull()) { // alt-rep element is NOT used in EPUB 2.0
@@ -250,7 +381,7 @@ EBookMetadata::parsePublisherMetadata(const QDomElement& metadata_element)
   }
   node = node_map.namedItem("alt-rep-lang");
   if (!node.isNull()) { // alt-rep-lang element is NOT used in EPUB 2.0
-    shared_publisher->alt_rep->lang = node.nodeValue();
+    shared_publisher->alt_rep->lang = intern(node.nodeValue());
   }
   node = node_map.namedItem("file-as");
   if (!node.isNull()) { // file-as element is NOT used in EPUB 2.0
@@ -300,11 +431,11 @@ EBookMetadata::parseRelationMetadata(const QDomElement& metadata_element)
   }
   node = node_map.namedItem("lang");
   if (!node.isNull()) {
-    shared_relation->lang = node.nodeValue();
+    shared_relation->lang = intern(node.nodeValue());
   }
   node = node_map.namedItem("dir");
   if (!node.isNull()) {
-    shared_relation->dir = node.nodeValue();
+    shared_relation->dir = intern(node.nodeValue());
   }
   shared_relation->name = metadata_element.text();
   relation = shared_relation;
@@ -322,11 +453,11 @@ EBookMetadata::parseCoverageMetadata(const QDomElement& metadata_element)
   }
   node = node_map.namedItem("lang");
   if (!node.isNull()) {
-    shared_coverage->lang = node.nodeValue();
+    shared_coverage->lang = intern(node.nodeValue());
   }
   node = node_map.namedItem("dir");
   if (!node.isNull()) {
-    shared_coverage->dir = node.nodeValue();
+    shared_coverage->dir = intern(node.nodeValue());
   }
   shared_coverage->name = metadata_element.text();
   coverage = shared_coverage;
@@ -344,11 +475,11 @@ EBookMetadata::parseRightsMetadata(const QDomElement& metadata_element)
   }
   node = node_map.namedItem("lang");
   if (!node.isNull()) {
-    shared_rights->lang = node.nodeValue();
+    shared_rights->lang = intern(node.nodeValue());
   }
   node = node_map.namedItem("dir");
   if (!node.isNull()) {
-    shared_rights->dir = node.nodeValue();
+    shared_rights->dir = intern(node.nodeValue());
   }
   shared_rights->name = metadata_element.text();
   rights = shared_rights;
@@ -359,44 +490,60 @@ EBookMetadata::parseDublinCoreMeta(QString tag_name,
                                    QDomElement& metadata_element,
                                    QDomNamedNodeMap& node_map)
 {
-  if (tag_name == "title") {
-    parseTitleMetadata(metadata_element);
-  } else if (tag_name == "creator") {
-    parseCreatorMetadata(metadata_element);
-  } else if (tag_name == "contributor") {
-    parseContributorMetadata(metadata_element);
-  } else if (tag_name == "description") {
-    parseDescriptionMetadata(metadata_element);
-  } else if (tag_name == "identifier") {
-    parseIdentifierMetadata(metadata_element);
-  } else if (tag_name == "language") {
-    parseLanguageMetadata(metadata_element);
-  } else if (tag_name == "description") {
-    parseDescriptionMetadata(metadata_element);
-  } else if (tag_name == "publisher") {
-    parsePublisherMetadata(metadata_element);
-  } else if (tag_name == "date") {
-    QDomNode id_node = node_map.namedItem("id");
-    date = QDateTime::fromString(metadata_element.text(), Qt::ISODate);
-    if (!id_node.isNull()) {
-      modified.id = id_node.nodeValue();
+  switch (LookupTable::find(DC_ELEMENTS, tag_name, UNKNOWN_TOKEN)) {
+    case DC_TITLE:
+      parseTitleMetadata(metadata_element);
+      break;
+    case DC_CREATOR:
+      parseCreatorMetadata(metadata_element);
+      break;
+    case DC_CONTRIBUTOR:
+      parseContributorMetadata(metadata_element);
+      break;
+    case DC_DESCRIPTION:
+      parseDescriptionMetadata(metadata_element);
+      break;
+    case DC_IDENTIFIER:
+      parseIdentifierMetadata(metadata_element);
+      break;
+    case DC_LANGUAGE:
+      parseLanguageMetadata(metadata_element);
+      break;
+    case DC_PUBLISHER:
+      parsePublisherMetadata(metadata_element);
+      break;
+    case DC_DATE: {
+      QDomNode id_node = node_map.namedItem("id");
+      date = QDateTime::fromString(metadata_element.text(), Qt::ISODate);
+      if (!id_node.isNull()) {
+        modified.id = id_node.nodeValue();
+      }
+      break;
     }
-  } else if (tag_name == "rights") {
-    parseRightsMetadata(metadata_element);
-  } else if (tag_name == "format") {
-    parseFormatMetadata(metadata_element);
-  } else if (tag_name == "relation") {
-    parseRelationMetadata(metadata_element);
-  } else if (tag_name == "coverage") {
-    parseCoverageMetadata(metadata_element);
-  } else if (tag_name == "source") {
-    parseSourceMetadata(metadata_element);
-  } else if (tag_name == "subject") {
-    parseSubjectMetadata(metadata_element);
-  } else if (tag_name == "type") {
-    parseTypeMetadata(metadata_element);
-  } else {
-    // TODO
+    case DC_RIGHTS:
+      parseRightsMetadata(metadata_element);
+      break;
+    case DC_FORMAT:
+      parseFormatMetadata(metadata_element);
+      break;
+    case DC_RELATION:
+      parseRelationMetadata(metadata_element);
+      break;
+    case DC_COVERAGE:
+      parseCoverageMetadata(metadata_element);
+      break;
+    case DC_SOURCE:
+      parseSourceMetadata(metadata_element);
+      break;
+    case DC_SUBJECT:
+      parseSubjectMetadata(metadata_element);
+      break;
+    case DC_TYPE:
+      parseTypeMetadata(metadata_element);
+      break;
+    default:
+      // TODO
+      break;
   }
 }
 
@@ -416,26 +563,40 @@ EBookMetadata::parseOpfMeta(QString tag_name,
 void
 EBookMetadata::parseCalibreMetas(QString id, QDomNode& node)
 {
-  if (id == "calibre:series")
-    m_calibre->setSeriesName(node.nodeValue());
-  else if (id == "calibre:series_index")
-    m_calibre->setSeriesIndex(node.nodeValue());
-  else if (id == "calibre:title_sort")
-    m_calibre->setTitleSort(node.nodeValue());
-  else if (id == "calibre:author_link_map")
-    m_calibre->setAuthorLinkMap(node.nodeValue());
-  else if (id == "calibre:timestamp")
-    m_calibre->setTimestamp(node.nodeValue());
-  else if (id == "calibre:rating")
-    m_calibre->setRating(node.nodeValue());
-  else if (id == "calibre:publication_type")
-    m_calibre->setPublicationType(node.nodeValue());
-  else if (id == "calibre:user_metadata")
-    m_calibre->setUserMetadata(node.nodeValue());
-  else if (id == "calibre:user_categories")
-    m_calibre->setUserCategories(node.nodeValue());
-  else if (id == "calibre:custom_metadata")
-    m_calibre->setCustomMetadata(node.nodeValue());
+  switch (LookupTable::find(CALIBRE_NAMES, id, UNKNOWN_TOKEN)) {
+    case CALIBRE_SERIES:
+      m_calibre->setSeriesName(node.nodeValue());
+      break;
+    case CALIBRE_SERIES_INDEX:
+      m_calibre->setSeriesIndex(node.nodeValue());
+      break;
+    case CALIBRE_TITLE_SORT:
+      m_calibre->setTitleSort(node.nodeValue());
+      break;
+    case CALIBRE_AUTHOR_LINK_MAP:
+      m_calibre->setAuthorLinkMap(node.nodeValue());
+      break;
+    case CALIBRE_TIMESTAMP:
+      m_calibre->setTimestamp(node.nodeValue());
+      break;
+    case CALIBRE_RATING:
+      m_calibre->setRating(node.nodeValue());
+      break;
+    case CALIBRE_PUBLICATION_TYPE:
+      m_calibre->setPublicationType(node.nodeValue());
+      break;
+    case CALIBRE_USER_METADATA:
+      m_calibre->setUserMetadata(node.nodeValue());
+      break;
+    case CALIBRE_USER_CATEGORIES:
+      m_calibre->setUserCategories(node.nodeValue());
+      break;
+    case CALIBRE_CUSTOM_METADATA:
+      m_calibre->setCustomMetadata(node.nodeValue());
+      break;
+    default:
+      break;
+  }
   m_calibre->setModified(false);
 }
 
@@ -456,11 +617,11 @@ EBookMetadata::parseCreatorContributorFoafAttributes(QString property,
   Foaf foaf = Foaf::fromString(property);
   QDomNode foaf_node = node_map.namedItem("scheme");
   if (!foaf_node.isNull()) {
-    foaf.setScheme(foaf_node.nodeValue().toLower());
+    foaf.setScheme(intern(foaf_node.nodeValue().toLower()));
   }
   foaf_node = node_map.namedItem("lang");
   if (!foaf_node.isNull()) {
-    foaf.setLang(foaf_node.nodeValue().toLower());
+    foaf.setLang(intern(foaf_node.nodeValue().toLower()));
   }
   foaf_node = node_map.namedItem("id");
   if (!foaf_node.isNull()) {
@@ -485,42 +646,44 @@ EBookMetadata::parseCreatorContributorRefines(Creator shared_creator,
 {
   QDomNode node = node_map.namedItem("property");
   if (!node.isNull()) {
-    QString property = node.nodeValue().toLower();
-    if (property == "role") {
+    QString property = node.nodeValue();
+    MetadataToken token =
+      LookupTable::find(REFINE_PROPERTIES, property, UNKNOWN_TOKEN);
+    if (token == PROPERTY_ROLE) {
       QDomNode node = node_map.namedItem("scheme");
       if (!node.isNull()) {
-        QString scheme = node.nodeValue().toLower();
-        if (scheme == "marc:relators") {
+        if (node.nodeValue().compare(QLatin1String("marc:relators"),
+                                     Qt::CaseInsensitive) == 0) {
           //            shared_creator->scheme = id;
           shared_creator->relator =
             MarcRelator::fromString(metadata_element.text());
           if (shared_creator->relator.type() == MarcRelator::NO_TYPE) {
-            shared_creator->string_creator = metadata_element.text();
+            shared_creator->string_creator = intern(metadata_element.text());
             QLOG_DEBUG(QString("An unexpected role has come up. %1")
                          .arg(metadata_element.text()))
           }
         } else {
           // TODO treat as a string if not a recognised scheme type;
-          shared_creator->string_scheme = metadata_element.text();
+          shared_creator->string_scheme = intern(metadata_element.text());
         }
       }
-    } else if (property == "alternate-script") {
+    } else if (token == PROPERTY_ALTERNATE_SCRIPT) {
       AltRep alt_rep = AltRep(new EBookAltRep());
       alt_rep->name = metadata_element.text();
       node = node_map.namedItem("lang");
       if (!node.isNull()) {
-        alt_rep->lang = node.nodeValue();
+        alt_rep->lang = intern(node.nodeValue());
       }
       shared_creator->alt_rep_list.append(alt_rep);
-    } else if (property == "file-as") {
+    } else if (token == PROPERTY_FILE_AS) {
       FileAs file_as = FileAs(new EBookFileAs());
       file_as->name = node.nodeValue();
       node = node_map.namedItem("lang");
       if (!node.isNull()) {
-        file_as->lang = node.nodeValue();
+        file_as->lang = intern(node.nodeValue());
       }
       shared_creator->file_as_list.append(file_as);
-    } else if (property.startsWith("foaf:")) {
+    } else if (LookupTable::startsWith(property, "foaf:")) {
       if (m_creators_by_id.contains(id)) {
         Creator shared_creator = m_creators_by_id.value(id);
         Foaf foaf = parseCreatorContributorFoafAttributes(property, node_map);
@@ -542,10 +705,11 @@ EBookMetadata::parseTitleRefines(QString id,
   Title shared_title = m_titles_by_id.value(id);
   QDomNode node = node_map.namedItem("property");
   if (!node.isNull()) {
-    QString property = node.nodeValue().toLower();
-    if (property == "title-type") {
+    MetadataToken token =
+      LookupTable::find(REFINE_PROPERTIES, node.nodeValue(), UNKNOWN_TOKEN);
+    if (token == PROPERTY_TITLE_TYPE) {
       // "title-type" is not used in 3.1 so ignore that node.
-    } else if (property == "display-seq") {
+    } else if (token == PROPERTY_DISPLAY_SEQ) {
       // refines/display-seq has been superceded in 3.1. Titles should
       // appear in the order required so reorder them in display-seq
       // order if these items appear in the metadata.
@@ -563,27 +727,24 @@ EBookMetadata::parseTitleRefines(QString id,
           m_ordered_titles.insert(new_seq, shared_title);
         }
       }
-    } else if (property == "alternate-script") {
+    } else if (token == PROPERTY_ALTERNATE_SCRIPT) {
       AltRep alt_rep = AltRep(new EBookAltRep());
       alt_rep->name = metadata_element.text();
       node = node_map.namedItem("lang");
       if (!node.isNull()) {
-        alt_rep->lang = node.nodeValue();
+        alt_rep->lang = intern(node.nodeValue());
       }
       shared_title->alt_rep_list.append(alt_rep);
-    } else if (property == "file-as") {
+    } else if (token == PROPERTY_FILE_AS) {
       FileAs file_as = FileAs(new EBookFileAs());
       file_as->name = node.nodeValue();
       node = node_map.namedItem("lang");
       if (!node.isNull()) {
-        file_as->lang = node.nodeValue();
+        file_as->lang = intern(node.nodeValue());
       }
       shared_title->file_as_list.append(file_as);
-    } else if (property.startsWith("dcterms:")) {
-      if (property == "dcterms:date") {
-        node = node_map.namedItem("scheme");
-        parseTitleDateRefines(shared_title, metadata_element);
-      }
+    } else if (token == PROPERTY_DCTERMS_DATE) {
+      parseTitleDateRefines(shared_title, metadata_element);
     }
   }
 }
@@ -604,10 +765,10 @@ EBookMetadata::parseRefineMetas(QDomElement& metadata_element,
     // is it a language?
     Language shared_language = m_languages.value(id);
     node = node_map.namedItem("property");
-    if (!node.isNull()) {
-      id = node.nodeValue().toLower();
-      if (id == "language")
-        shared_language->language = metadata_element.text();
+    if (!node.isNull() &&
+        LookupTable::find(REFINE_PROPERTIES, node.nodeValue(), UNKNOWN_TOKEN) ==
+          PROPERTY_LANGUAGE) {
+      shared_language->language = metadata_element.text();
     }
   } else if (m_creators_by_id.contains(id)) {
     // is it a creator
@@ -631,7 +792,7 @@ EBookMetadata::parseMetadataItem(const QDomNode& metadata_node)
   QDomNode node;
   QString id;
 
-  if (tag_name == "meta") {
+  if (tag_name == QLatin1String("meta")) {
     // refines are now deprecated however store their data and we will
     // try to convert them to 3.1
     node = node_map.namedItem("refines");
@@ -643,95 +804,96 @@ EBookMetadata::parseMetadataItem(const QDomNode& metadata_node)
     // metadata elements that do not refine other elements.
     node = node_map.namedItem("property");
     if (!node.isNull()) {
-      id = node.nodeValue().toLower();
-      DCTerms dcterms = DCTerms::fromString(id);
+      DCTerms dcterms = DCTerms::fromString(node.nodeValue());
       if (dcterms.isDCTerm()) {
-        if (dcterms.term() == DCTerms::DATE) {
-          parseDateModified(node_map, metadata_element.text());
-        } else if (dcterms.term() == DCTerms::SOURCE) {
-          if (!source.isNull()) {
-            source->source = metadata_element.text();
-          } else {
-            Source shared_source = Source(new EPubSource());
-            shared_source->source = metadata_element.text();
-            source = shared_source;
-          }
-        } else if (dcterms.term() == DCTerms::MODIFIED) {
-          modified.date =
-            QDateTime::fromString(metadata_element.text(), Qt::ISODate);
-        } else if (dcterms.term() == DCTerms::IDENTIFIER) {
-          // TODO
-        } else if (dcterms.term() == DCTerms::RIGHTS) {
-          if (!rights.isNull()) {
-            rights->name = metadata_element.text();
-          } else {
-            Rights shared_rights = Rights(new EBookRights());
-            shared_rights->name = metadata_element.text();
-            rights = shared_rights;
-          }
-        } else if (dcterms.term() == DCTerms::SUBJECT) {
-          // TODO
-        } else if (dcterms.term() == DCTerms::CREATOR) {
-          QString creator = metadata_element.text();
-          QStringList keys = contributors_by_name.keys();
-          if (!keys.contains(creator, Qt::CaseInsensitive)) {
-            // This might cause a contributor to be duplicated if the spelling
-            // is different. I think that that will have to be edited manually
-            // by the user.
-            Creator shared_creator = Creator(new EBookCreator());
-            shared_creator->name = creator;
-            m_creators_by_name.insert(creator, shared_creator);
-          }
-        } else if (dcterms.term() == DCTerms::CREATED) {
-          // TODO
-        } else if (dcterms.term() == DCTerms::LANGUAGE) {
-          // TODO
-        } else if (dcterms.term() == DCTerms::DESCRIPTION) {
-          // TODO
-        } else if (dcterms.term() == DCTerms::TITLE) {
-          QString title = metadata_element.text();
-          QStringList keys = m_titles_by_name.keys();
-          if (keys.contains(title, Qt::CaseInsensitive)) {
-            Title shared_title = Title(new EBookTitle());
-            shared_title->title = title;
-            m_titles_by_name.insert(title, shared_title);
+        switch (dcterms.term()) {
+          case DCTerms::DATE:
+            parseDateModified(node_map, metadata_element.text());
+            break;
+          case DCTerms::SOURCE:
+            if (!source.isNull()) {
+              source->source = metadata_element.text();
+            } else {
+              Source shared_source = Source(new EPubSource());
+              shared_source->source = metadata_element.text();
+              source = shared_source;
+            }
+            break;
+          case DCTerms::MODIFIED:
+            modified.date =
+              QDateTime::fromString(metadata_element.text(), Qt::ISODate);
+            break;
+          case DCTerms::RIGHTS:
+            if (!rights.isNull()) {
+              rights->name = metadata_element.text();
+            } else {
+              Rights shared_rights = Rights(new EBookRights());
+              shared_rights->name = metadata_element.text();
+              rights = shared_rights;
+            }
+            break;
+          case DCTerms::CREATOR: {
+            QString creator = metadata_element.text();
+            QStringList keys = contributors_by_name.keys();
+            if (!keys.contains(creator, Qt::CaseInsensitive)) {
+              // This might cause a contributor to be duplicated if the
+              // spelling is different. I think that that will have to be
+              // edited manually by the user.
+              Creator shared_creator = Creator(new EBookCreator());
+              shared_creator->name = creator;
+              m_creators_by_name.insert(creator, shared_creator);
+            }
+            break;
           }
-        } else if (dcterms.term() == DCTerms::PUBLISHER) {
-          if (publisher.isNull()) {
-            // TODO - maybe more than one publisher?
-            publisher = Publisher(new EPubPublisher());
-            publisher->name = metadata_element.text();
+          case DCTerms::TITLE: {
+            QString title = metadata_element.text();
+            QStringList keys = m_titles_by_name.keys();
+            if (!keys.contains(title, Qt::CaseInsensitive)) {
+              Title shared_title = Title(new EBookTitle());
+              shared_title->title = title;
+              m_titles_by_name.insert(title, shared_title);
+            }
+            break;
           }
-        } else if (dcterms.term() == DCTerms::CONTRIBUTOR) {
-          QString contributor = metadata_element.text();
-          QStringList keys = contributors_by_name.keys();
-          if (!keys.contains(contributor, Qt::CaseInsensitive)) {
-            // This might cause a contributor to be duplicated if the spelling
-            // is different. I think that that will have to be edited manually
-            // by the user.
-            Contributor shared_contributor =
-              Contributor(new EBookContributor());
-            shared_contributor->name = contributor;
-            contributors_by_name.insert(contributor, shared_contributor);
+          case DCTerms::PUBLISHER:
+            if (publisher.isNull()) {
+              // TODO - maybe more than one publisher?
+              publisher = Publisher(new EPubPublisher());
+              publisher->name = metadata_element.text();
+            }
+            break;
+          case DCTerms::CONTRIBUTOR: {
+            QString contributor = metadata_element.text();
+            QStringList keys = contributors_by_name.keys();
+            if (!keys.contains(contributor, Qt::CaseInsensitive)) {
+              // This might cause a contributor to be duplicated if the
+              // spelling is different. I think that that will have to be
+              // edited manually by the user.
+              Contributor shared_contributor =
+                Contributor(new EBookContributor());
+              shared_contributor->name = contributor;
+              contributors_by_name.insert(contributor, shared_contributor);
+            }
+            break;
           }
-        } else if (dcterms.term() == DCTerms::DATE) {
-        } else if (dcterms.term() == DCTerms::DATE_COPYRIGHTED) {
-          // TODO
-        } else if (dcterms.term() == DCTerms::DATE_ACCEPTED) {
-          // TODO
-        } else if (dcterms.term() == DCTerms::DATE_SUBMITTED) {
-          // TODO
-        } else if (dcterms.term() == DCTerms::IS_PART_OF) {
-          // TODO
-        } else if (dcterms.term() == DCTerms::ISSUED) {
-          // TODO
-        } else if (dcterms.term() == DCTerms::DATE) {
-          date = QDateTime::fromString(metadata_element.text(), Qt::ISODate);
-        } else if (dcterms.term() == DCTerms::LICENSE) {
-          // TODO
-        } else {
-          // TODO other dcterms.
-          QLOG_WARN(QString("Unknown DCTerms object : %1").arg(dcterms.code()));
+          case DCTerms::IDENTIFIER:
+          case DCTerms::SUBJECT:
+          case DCTerms::CREATED:
+          case DCTerms::LANGUAGE:
+          case DCTerms::DESCRIPTION:
+          case DCTerms::DATE_COPYRIGHTED:
+          case DCTerms::DATE_ACCEPTED:
+          case DCTerms::DATE_SUBMITTED:
+          case DCTerms::IS_PART_OF:
+          case DCTerms::ISSUED:
+          case DCTerms::LICENSE:
+            // TODO
+            break;
+          default:
+            // TODO other dcterms.
+            QLOG_WARN(
+              QString("Unknown DCTerms object : %1").arg(dcterms.code()));
+            break;
         }
       }
     }
@@ -739,19 +901,19 @@ EBookMetadata::parseMetadataItem(const QDomNode& metadata_node)
     // handle <meta> tags
     node = node_map.namedItem("name");
     if (!node.isNull()) {
-      id = node.nodeValue().toLower();
+      id = node.nodeValue();
       node = node_map.namedItem("content");
       if (!node.isNull()) {
         // Mostly calibre tags - maintain these
-        if (id.startsWith("calibre:")) {
+        if (LookupTable::startsWith(id, "calibre:")) {
           parseCalibreMetas(id, node);
         } else // a store for unknown stuff.
-          m_extra_metas.insert(id, node.nodeValue());
+          m_extra_metas.insert(id.toLower(), node.nodeValue());
       }
     }
-  } else if (metadata_element.prefix() == "dc") {
+  } else if (metadata_element.prefix() == QLatin1String("dc")) {
     parseDublinCoreMeta(tag_name, metadata_element, node_map);
-  } else if (metadata_element.prefix() == "opf") {
+  } else if (metadata_element.prefix() == QLatin1String("opf")) {
     // might not actually be any of these.
     // just throws a log warning at the moment.
     parseOpfMeta(tag_name, metadata_element, node_map);
@@ -780,11 +942,11 @@ EBookMetadata::parseTitleMetadata(QDomElement metadata_element)
   }
   node = node_map.namedItem("dir");
   if (!node.isNull()) { // dir element is NOT used in EPUB 2.0
-    shared_title->dir = node.nodeValue();
+    shared_title->dir = intern(node.nodeValue());
   }
   node = node_map.namedItem("lang");
   if (!node.isNull()) { // lang element is NOT used in EPUB 2.0
-    shared_title->lang = node.nodeValue();
+    shared_title->lang = intern(node.nodeValue());
   }
   node = node_map.namedItem("alt-rep");
   if (!node.isNull()) { // alt-rep element is NOT used in EPUB 2.0
@@ -792,7 +954,7 @@ EBookMetadata::parseTitleMetadata(QDomElement metadata_element)
     shared_alt_rep->name = node.nodeValue();
     node = node_map.namedItem("alt-rep-lang");
     if (!node.isNull()) { // alt-rep-lang element is NOT used in EPUB 2.0
-      shared_alt_rep->lang = node.nodeValue();
+      shared_alt_rep->lang = intern(node.nodeValue());
     }
     shared_title->alt_rep_list.append(shared_alt_rep);
   }
@@ -828,7 +990,7 @@ EBookMetadata::parseCreatorMetadata(QDomElement metadata_element)
   if (!node.isNull()) {
     creator->relator = MarcRelator::fromString(node.nodeValue());
     if (creator->relator.type() == MarcRelator::NO_TYPE) {
-      creator->string_creator = node.nodeValue();
+      creator->string_creator = intern(node.nodeValue());
       QLOG_DEBUG(
         QString("An unexpected role has come up. %1").arg(node.nodeValue()))
     }
@@ -863,7 +1025,7 @@ EBookMetadata::parseCreatorMetadata(QDomElement metadata_element)
     alt_rep->name = node.nodeValue();
     node = node_map.namedItem("alt-rep-lang"); // 3.0
     if (!node.isNull()) {
-      alt_rep->lang = node.nodeValue();
+      alt_rep->lang = intern(node.nodeValue());
     }
     creator->alt_rep_list.append(alt_rep);
   }
@@ -890,7 +1052,7 @@ EBookMetadata::parseContributorMetadata(QDomElement metadata_element)
   if (!node.isNull()) {
     shared_contributor->relator = MarcRelator::fromString(node.nodeValue());
     if (shared_contributor->relator.type() == MarcRelator::NO_TYPE) {
-      shared_contributor->string_creator = node.nodeValue();
+      shared_contributor->string_creator = intern(node.nodeValue());
       QLOG_DEBUG(
         QString("An unexpected role has come up. %1").arg(node.nodeValue()))
     }
@@ -924,7 +1086,7 @@ EBookMetadata::parseContributorMetadata(QDomElement metadata_element)
     alt_rep->name = node.nodeValue();
     node = node_map.namedItem("alt-rep-lang"); // 3.0
     if (!node.isNull()) {
-      alt_rep->lang = node.nodeValue();
+      alt_rep->lang = intern(node.nodeValue());
     }
     shared_contributor->alt_rep_list.append(alt_rep);
   }
@@ -950,7 +1112,7 @@ EBookMetadata::parseDescriptionMetadata(QDomElement metadata_element)
   }
   node = node_map.namedItem("dir");
   if (!node.isNull()) { // dir element is NOT used in EPUB 2.0
-    description->dir = node.nodeValue();
+    description->dir = intern(node.nodeValue());
   }
   node = node_map.namedItem("lang");
   if (!node.isNull()) { // lang element is NOT used in EPUB 2.0
@@ -1017,11 +1179,11 @@ EBookMetadata::parseSubjectMetadata(QDomElement metadata_element)
   }
   node = node_map.namedItem("lang");
   if (!node.isNull()) {
-    shared_subject->lang = node.nodeValue();
+    shared_subject->lang = intern(node.nodeValue());
   }
   node = node_map.namedItem("dir");
   if (!node.isNull()) {
-    shared_subject->dir = node.nodeValue();
+    shared_subject->dir = intern(node.nodeValue());
   }
   shared_subject->subject = metadata_element.text();
   subjects.insert(shared_subject->subject, shared_subject);
@@ -1387,6 +1549,47 @@ EBookMetadata::writeContributorMetadata(QXmlStreamWriter* xml_writer,
   return writeCreatorContibutor("dc:contributor", xml_writer, key);
 }
 
+/*
+ * The <meta name=""> tags, those of calibre and the unrecognised ones
+ * such as the EPUB 2 cover, whose names were folded to lower case when
+ * they were read.
+ */
+void
+EBookMetadata::writeNamedMetas(QXmlStreamWriter* xml_writer)
+{
+  QList<QPair<QString, QString>> metas;
+  metas << qMakePair(QString("calibre:series"), m_calibre->seriesName())
+        << qMakePair(QString("calibre:series_index"),
+                     m_calibre->seriesIndex())
+        << qMakePair(QString("calibre:title_sort"), m_calibre->titleSort())
+        << qMakePair(QString("calibre:author_link_map"),
+                     m_calibre->authorLinkMap())
+        << qMakePair(QString("calibre:timestamp"), m_calibre->timestamp())
+        << qMakePair(QString("calibre:rating"), m_calibre->rating())
+        << qMakePair(QString("calibre:publication_type"),
+                     m_calibre->publicationType())
+        << qMakePair(QString("calibre:user_metadata"),
+                     m_calibre->userMetadata())
+        << qMakePair(QString("calibre:user_categories"),
+                     m_calibre->userCategories())
+        << qMakePair(QString("calibre:custom_metadata"),
+                     m_calibre->customMetadata());
+  for (QMap<QString, QString>::const_iterator it = m_extra_metas.constBegin();
+       it != m_extra_metas.constEnd();
+       ++it) {
+    metas << qMakePair(it.key(), it.value());
+  }
+  for (int i = 0; i < metas.size(); i++) {
+    if (metas.at(i).second.isEmpty()) {
+      continue;
+    }
+    xml_writer->writeStartElement("meta");
+    xml_writer->writeAttribute("name", metas.at(i).first);
+    xml_writer->writeAttribute("content", metas.at(i).second);
+    xml_writer->writeEndElement();
+  }
+}
+
 void
 EBookMetadata::writeRoleAttribute(QXmlStreamWriter* xml_writer,
                                   MarcRelator relator)
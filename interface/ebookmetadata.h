@@ -7,6 +7,19 @@
 
 class QXmlStreamWriter;
 
+/*!
+ * \brief A change made to the metadata of many books at once, see
+ * EBookMetadata::applyEdit().
+ */
+struct EBookMetadataEdit
+{
+  QMap<QString, QString> creators; // a creator name -> its corrected name.
+  bool set_series = false;
+  QString series; // the calibre series, empty to remove it.
+
+  bool isEmpty() const { return (creators.isEmpty() && !set_series); }
+};
+
 class EBookMetadata : public EBookBaseMetadata
 {
 public:
@@ -30,6 +43,53 @@ public:
   Calibre calibre() const;
   void setCalibre(const Calibre& calibre);
 
+  bool applyEdit(const EBookMetadataEdit& edit);
+
+  QString extraMeta(const QString& name) const;
+  QStringList languages() const;
+
+  // the element, property and name attribute values that are parsed,
+  // mapped once from their strings, see parseMetadataItem().
+  enum MetadataToken
+  {
+    UNKNOWN_TOKEN = 0,
+    // dc: elements
+    DC_TITLE,
+    DC_CREATOR,
+    DC_CONTRIBUTOR,
+    DC_DESCRIPTION,
+    DC_IDENTIFIER,
+    DC_LANGUAGE,
+    DC_PUBLISHER,
+    DC_DATE,
+    DC_RIGHTS,
+    DC_FORMAT,
+    DC_RELATION,
+    DC_COVERAGE,
+    DC_SOURCE,
+    DC_SUBJECT,
+    DC_TYPE,
+    // <meta property=""> values of refines.
+    PROPERTY_ROLE,
+    PROPERTY_ALTERNATE_SCRIPT,
+    PROPERTY_FILE_AS,
+    PROPERTY_TITLE_TYPE,
+    PROPERTY_DISPLAY_SEQ,
+    PROPERTY_LANGUAGE,
+    PROPERTY_DCTERMS_DATE,
+    // <meta name=""> values written by calibre.
+    CALIBRE_SERIES,
+    CALIBRE_SERIES_INDEX,
+    CALIBRE_TITLE_SORT,
+    CALIBRE_AUTHOR_LINK_MAP,
+    CALIBRE_TIMESTAMP,
+    CALIBRE_RATING,
+    CALIBRE_PUBLICATION_TYPE,
+    CALIBRE_USER_METADATA,
+    CALIBRE_USER_CATEGORIES,
+    CALIBRE_CUSTOM_METADATA,
+  };
+
 protected:
   QString m_package_unique_identifier;
   QString m_package_unique_identifier_name;
@@ -115,6 +175,7 @@ protected:
   void writeRelationMetadata(QXmlStreamWriter* xml_writer);
   void writeRightsMetadata(QXmlStreamWriter* xml_writer);
   void writeCoverageMetadata(QXmlStreamWriter* xml_writer);
+  void writeNamedMetas(QXmlStreamWriter* xml_writer);
 
   void writeTitle(QXmlStreamWriter* xml_writer, Title shared_title);
   QString writeCreatorContibutor(QString tag_name,
@@ -0,0 +1,88 @@
+#include "ebooknameindex.h"
+
+#include <algorithm>
+
+#include <QSet>
+
+/*!
+ * \brief Adds a name, there can be more than one entry of the same name and
+ * completion, each is removed separately.
+ */
+void
+EBookNameIndex::insert(const QString& name, const QString& completion)
+{
+  Entry entry;
+  entry.key = fold(name);
+  if (entry.key.isEmpty() || completion.isEmpty()) {
+    return;
+  }
+  entry.completion = completion;
+  m_entries.insert(
+    std::upper_bound(m_entries.begin(), m_entries.end(), entry), entry);
+}
+
+void
+EBookNameIndex::remove(const QString& name, const QString& completion)
+{
+  Entry entry;
+  entry.key = fold(name);
+  entry.completion = completion;
+  QVector<Entry>::iterator it =
+    std::lower_bound(m_entries.begin(), m_entries.end(), entry);
+  if (it != m_entries.end() && it->key == entry.key &&
+      it->completion == completion) {
+    m_entries.erase(it);
+  }
+}
+
+void
+EBookNameIndex::clear()
+{
+  m_entries.clear();
+}
+
+/*!
+ * \brief The first limit completions of the names that start with prefix,
+ * in the order of the folded names, each completion once.
+ */
+QStringList
+EBookNameIndex::complete(const QString& prefix, int limit) const
+{
+  QStringList completions;
+  Entry entry;
+  entry.key = fold(prefix);
+  if (entry.key.isEmpty()) {
+    return completions;
+  }
+  QSet<QString> found;
+  for (QVector<Entry>::const_iterator it =
+         std::lower_bound(m_entries.constBegin(), m_entries.constEnd(), entry);
+       it != m_entries.constEnd() && completions.size() < limit &&
+       it->key.startsWith(entry.key);
+       ++it) {
+    if (!found.contains(it->completion)) {
+      found.insert(it->completion);
+      completions.append(it->completion);
+    }
+  }
+  return completions;
+}
+
+/*!
+ * \brief The name without accents or case and with its white space
+ * simplified, so that "Brontë" is found by "bront".
+ */
+QString
+EBookNameIndex::fold(const QString& name)
+{
+  QString decomposed =
+    name.simplified().normalized(QString::NormalizationForm_KD);
+  QString result;
+  result.reserve(decomposed.size());
+  foreach (QChar c, decomposed) {
+    if (!c.isMark()) {
+      result.append(c);
+    }
+  }
+  return result.toCaseFolded();
+}
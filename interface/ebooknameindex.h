@@ -0,0 +1,50 @@
+#ifndef EBOOKNAMEINDEX_H
+#define EBOOKNAMEINDEX_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "interface_global.h"
+
+/*!
+ * \brief Names kept sorted on their folded form for prefix completion.
+ *
+ * Each entry is a name that is matched and the completion it gives, so an
+ * author can be found by both the display and file as names and complete
+ * to the display name. Finding the first entry of a prefix is a binary
+ * search, and the matches are the entries that follow it, so complete()
+ * only touches the entries it returns. Inserting and removing move the
+ * entries after the one changed, which is a memmove of pointers.
+ *
+ * The index is not locked, its owner guards it with its own lock.
+ */
+class INTERFACESHARED_EXPORT EBookNameIndex
+{
+public:
+  void insert(const QString& name, const QString& completion);
+  void insert(const QString& name) { insert(name, name); }
+  void remove(const QString& name, const QString& completion);
+  void remove(const QString& name) { remove(name, name); }
+  void clear();
+  int size() const { return m_entries.size(); }
+
+  QStringList complete(const QString& prefix, int limit) const;
+
+  static QString fold(const QString& name);
+
+protected:
+  struct Entry
+  {
+    QString key; // the folded name.
+    QString completion;
+    bool operator<(const Entry& other) const
+    {
+      return (key < other.key ||
+              (key == other.key && completion < other.completion));
+    }
+  };
+  QVector<Entry> m_entries;
+};
+
+#endif // EBOOKNAMEINDEX_H
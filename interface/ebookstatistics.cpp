@@ -0,0 +1,114 @@
+#include "ebookstatistics.h"
+
+#include <QLocale>
+#include <QSet>
+
+#include "wordtokenizer.h"
+#include "xhtmlcleaner.h"
+#include "xhtmltokenizer.h"
+
+/*!
+ * \brief The minutes needed to read the words at WORDS_PER_MINUTE, rounded
+ * up.
+ */
+int
+EBookStatistics::readingMinutes() const
+{
+  return int((words + WORDS_PER_MINUTE - 1) / WORDS_PER_MINUTE);
+}
+
+/*!
+ * \brief The words and reading time, as shown in the library and status
+ * bar.
+ */
+QString
+EBookStatistics::summary() const
+{
+  QLocale locale;
+  return tr("%1 words, %2 to read")
+    .arg(locale.toString(words))
+    .arg(readingTime(readingMinutes()));
+}
+
+/*!
+ * \brief Counts the words and characters of plain text, the words are
+ * split by EBookWordTokenizer as for the spell checker.
+ */
+EBookTextCount
+EBookStatistics::countText(QStringView text)
+{
+  EBookTextCount count;
+  for (const EBookWordSpan& span : EBookWordTokenizer::words(text)) {
+    count.vocabulary.append(
+      text.mid(span.start, span.length).toString().toLower());
+  }
+  count.words = count.vocabulary.size();
+  for (QChar c : text) {
+    // images are shown as object replacement characters.
+    if (!c.isSpace() && c != QChar::ObjectReplacementCharacter) {
+      count.characters++;
+    }
+  }
+  return count;
+}
+
+/*!
+ * \brief The text of the body of an xhtml document, without building a
+ * QTextDocument.
+ *
+ * Entities are decoded and block elements end a line, so the words found
+ * are those of the document shown.
+ */
+QString
+EBookStatistics::xhtmlText(const QString& xhtml)
+{
+  static const QSet<QString> BLOCK_ELEMENTS = {
+    "address", "blockquote", "br", "dd", "div", "dt", "figcaption",
+    "h1", "h2", "h3", "h4", "h5", "h6", "hr", "li", "p", "pre", "td", "th",
+    "tr",
+  };
+
+  QString text;
+  text.reserve(xhtml.size() / 2);
+  bool in_head = false;
+  XhtmlTokenizer tokenizer(xhtml);
+  while (!tokenizer.atEnd()) {
+    XhtmlToken token = tokenizer.next();
+    switch (token.type) {
+      case XhtmlToken::TAG_START: {
+        QString name = token.name.toString().toLower();
+        if (name == "head") {
+          in_head = !token.closing;
+        } else if (BLOCK_ELEMENTS.contains(name)) {
+          text += QLatin1Char('\n');
+        }
+        break;
+      }
+      case XhtmlToken::TEXT:
+        if (!in_head) {
+          text += token.text.toString();
+        }
+        break;
+      case XhtmlToken::ENTITY:
+        if (!in_head) {
+          text += XhtmlCleaner::decode(token.text);
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  return text;
+}
+
+/*!
+ * \brief minutes as hours and minutes, "2 h 5 min" for instance.
+ */
+QString
+EBookStatistics::readingTime(int minutes)
+{
+  if (minutes < 60) {
+    return tr("%1 min").arg(minutes);
+  }
+  return tr("%1 h %2 min").arg(minutes / 60).arg(minutes % 60);
+}
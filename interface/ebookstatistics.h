@@ -0,0 +1,59 @@
+#ifndef EBOOKSTATISTICS_H
+#define EBOOKSTATISTICS_H
+
+#include <QCoreApplication>
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+
+#include "interface_global.h"
+
+/*!
+ * \brief The counts of a piece of text, a block of a document or the text
+ * of a chapter.
+ */
+struct EBookTextCount
+{
+  int words = 0;
+  int characters = 0; // not counting white space.
+  QStringList vocabulary; // the words in lower case, repeats included.
+};
+
+/*!
+ * \brief The size of a book or of one of its chapters.
+ *
+ * Those of an open book are kept up to date as it is edited, see
+ * EBookStatisticsTracker, and the book's are stored in its EBookData so
+ * that the library can show them without opening it.
+ */
+struct INTERFACESHARED_EXPORT EBookStatistics
+{
+  Q_DECLARE_TR_FUNCTIONS(EBookStatistics)
+public:
+  qint64 words = 0;
+  qint64 characters = 0; // not counting white space.
+  int unique_words = 0;  // ignoring case.
+  int chapters = 0;
+
+  bool isEmpty() const { return (words == 0 && characters == 0); }
+  int readingMinutes() const;
+  QString summary() const;
+
+  bool operator==(const EBookStatistics& other) const
+  {
+    return (words == other.words && characters == other.characters &&
+            unique_words == other.unique_words && chapters == other.chapters);
+  }
+  bool operator!=(const EBookStatistics& other) const
+  {
+    return !(*this == other);
+  }
+
+  static EBookTextCount countText(QStringView text);
+  static QString xhtmlText(const QString& xhtml);
+  static QString readingTime(int minutes);
+
+  static const int WORDS_PER_MINUTE = 250;
+};
+
+#endif // EBOOKSTATISTICS_H
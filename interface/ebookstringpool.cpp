@@ -0,0 +1,84 @@
+#include "ebookstringpool.h"
+
+#include <QReadLocker>
+#include <QWriteLocker>
+
+EBookStringPool::EBookStringPool() {}
+
+EBookStringPool*
+EBookStringPool::instance()
+{
+  static EBookStringPool pool;
+  return &pool;
+}
+
+/*!
+ * \brief The pooled copy of value, which is added to the pool if this is
+ * the first time it has been seen.
+ */
+QString
+EBookStringPool::intern(const QString& value)
+{
+  if (value.isEmpty() || value.size() > MAX_LENGTH) {
+    return value;
+  }
+  {
+    QReadLocker locker(&m_lock);
+    QSet<QString>::const_iterator it = m_strings.constFind(value);
+    if (it != m_strings.constEnd()) {
+      return *it;
+    }
+  }
+
+  QWriteLocker locker(&m_lock);
+  if (m_strings.size() + m_bytes.size() >= MAX_ENTRIES) {
+    return value;
+  }
+  // another thread may have added it while the lock was released.
+  return *m_strings.insert(value);
+}
+
+QByteArray
+EBookStringPool::intern(const QByteArray& value)
+{
+  if (value.isEmpty() || value.size() > MAX_LENGTH) {
+    return value;
+  }
+  {
+    QReadLocker locker(&m_lock);
+    QSet<QByteArray>::const_iterator it = m_bytes.constFind(value);
+    if (it != m_bytes.constEnd()) {
+      return *it;
+    }
+  }
+
+  QWriteLocker locker(&m_lock);
+  if (m_strings.size() + m_bytes.size() >= MAX_ENTRIES) {
+    return value;
+  }
+  return *m_bytes.insert(value);
+}
+
+/*!
+ * \brief The list with each of its values interned.
+ */
+QStringList
+EBookStringPool::intern(const QStringList& values)
+{
+  QStringList interned;
+  interned.reserve(values.size());
+  foreach (QString value, values) {
+    interned.append(intern(value));
+  }
+  return interned;
+}
+
+/*!
+ * \brief The number of values held.
+ */
+int
+EBookStringPool::count() const
+{
+  QReadLocker locker(&m_lock);
+  return m_strings.size() + m_bytes.size();
+}
@@ -0,0 +1,59 @@
+#ifndef EBOOKSTRINGPOOL_H
+#define EBOOKSTRINGPOOL_H
+
+#include <QByteArray>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+#include "interface_global.h"
+
+/*!
+ * \brief Keeps a single copy of each of the short values that books repeat
+ * over and over, media types, manifest properties, stylesheet links, class
+ * names, languages and schemes.
+ *
+ * intern() returns the pooled copy of a value, which is implicitly shared,
+ * so every manifest item or metadata entry holding the value shares its
+ * data. Two interned values are equal exactly when their data is the same,
+ * which same() checks first, only comparing the contents of values that
+ * are not. It can therefore also be handed values that were never
+ * interned.
+ *
+ * Values longer than MAX_LENGTH are returned unchanged, as is everything
+ * once the pool holds MAX_ENTRIES values. The interface library is linked
+ * into each plugin, so each plugin has its own pool shared by all of its
+ * books. intern() can be called from any thread.
+ */
+class INTERFACESHARED_EXPORT EBookStringPool
+{
+public:
+  static EBookStringPool* instance();
+
+  QString intern(const QString& value);
+  QByteArray intern(const QByteArray& value);
+  QStringList intern(const QStringList& values);
+  int count() const;
+
+  static bool same(const QString& first, const QString& second)
+  {
+    return (first.constData() == second.constData() || first == second);
+  }
+  static bool same(const QByteArray& first, const QByteArray& second)
+  {
+    return (first.constData() == second.constData() || first == second);
+  }
+
+  static const int MAX_LENGTH = 64;
+  static const int MAX_ENTRIES = 16384;
+
+protected:
+  EBookStringPool();
+
+  mutable QReadWriteLock m_lock;
+  QSet<QString> m_strings;
+  QSet<QByteArray> m_bytes;
+};
+
+#endif // EBOOKSTRINGPOOL_H
@@ -0,0 +1,240 @@
+#include "ebooktextdecoder.h"
+
+#include <cctype>
+
+#include <QTextCodec>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                  \
+  (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define EBOOK_DECODER_SSE2
+#endif
+
+#include <qlogger/qlogger.h>
+
+using namespace qlogger;
+
+const QByteArray EBookTextDecoder::UTF8 = "utf-8";
+const QByteArray EBookTextDecoder::FALLBACK = "windows-1252";
+
+/*!
+ * \brief Decodes data in whatever encoding it is in.
+ *
+ * \param data the entry as read from the book.
+ * \param encoding if not null set to the encoding that was used.
+ * \return the text.
+ */
+QString
+EBookTextDecoder::decode(const QByteArray& data, QByteArray* encoding)
+{
+  int bom_length = 0;
+  QByteArray declared = detectEncoding(data, &bom_length);
+  const char* begin = data.constData() + bom_length;
+  int size = data.size() - bom_length;
+
+  QString text;
+  if (declared.isEmpty() || declared == UTF8) {
+    if (decodeUtf8(begin, size, text)) {
+      if (encoding) {
+        *encoding = UTF8;
+      }
+      return text;
+    }
+    if (!declared.isEmpty()) {
+      // declared but broken, keep what can be read.
+      if (encoding) {
+        *encoding = UTF8;
+      }
+      return QString::fromUtf8(begin, size);
+    }
+    declared = FALLBACK;
+  }
+
+  QTextCodec* codec = QTextCodec::codecForName(declared);
+  if (!codec) {
+    QLOG_DEBUG(QString("Unknown text encoding %1, read as UTF-8")
+                 .arg(QString::fromLatin1(declared)));
+    if (encoding) {
+      *encoding = UTF8;
+    }
+    return QString::fromUtf8(begin, size);
+  }
+  if (encoding) {
+    *encoding = declared;
+  }
+  return codec->toUnicode(begin, size);
+}
+
+/*!
+ * \brief The encoding given by the byte order mark or declaration at the
+ * start of data, in lower case, or an empty array if there is neither.
+ *
+ * \param bom_length if not null set to the length of the byte order mark,
+ *        0 if there is none.
+ */
+QByteArray
+EBookTextDecoder::detectEncoding(const QByteArray& data, int* bom_length)
+{
+  const uchar* bytes = reinterpret_cast<const uchar*>(data.constData());
+  int size = data.size();
+  int length = 0;
+  QByteArray encoding;
+
+  if (size >= 3 && bytes[0] == 0xEF && bytes[1] == 0xBB && bytes[2] == 0xBF) {
+    length = 3;
+    encoding = UTF8;
+  } else if (size >= 2 && bytes[0] == 0xFF && bytes[1] == 0xFE) {
+    length = 2;
+    encoding = "utf-16le";
+  } else if (size >= 2 && bytes[0] == 0xFE && bytes[1] == 0xFF) {
+    length = 2;
+    encoding = "utf-16be";
+  } else {
+    encoding = declaredEncoding(data.constData(),
+                                qMin(size, int(DECLARATION_LIMIT)));
+  }
+
+  if (bom_length) {
+    *bom_length = length;
+  }
+  return encoding;
+}
+
+/*!
+ * \brief Converts UTF-8 data to text, checking that it is valid as it goes.
+ *
+ * A UTF-8 sequence never needs more UTF-16 code units than it has bytes, so
+ * the text is allocated once at the size of the data and shrunk in place
+ * at the end.
+ *
+ * \return false, leaving text unchanged, if data is not valid UTF-8, that
+ *         is if it holds a malformed or overlong sequence, a surrogate or a
+ *         code point over U+10FFFF.
+ */
+bool
+EBookTextDecoder::decodeUtf8(const char* data, int size, QString& text)
+{
+  QString result(size, Qt::Uninitialized);
+  ushort* out = reinterpret_cast<ushort*>(result.data());
+  const uchar* in = reinterpret_cast<const uchar*>(data);
+  int read = 0, written = 0;
+
+  while (read < size) {
+#ifdef EBOOK_DECODER_SSE2
+    // written never passes read, so a whole block always fits.
+    const __m128i zero = _mm_setzero_si128();
+    while (read + 16 <= size) {
+      __m128i block =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + read));
+      if (_mm_movemask_epi8(block) != 0) {
+        break;
+      }
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + written),
+                       _mm_unpacklo_epi8(block, zero));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + written + 8),
+                       _mm_unpackhi_epi8(block, zero));
+      read += 16;
+      written += 16;
+    }
+    if (read >= size) {
+      break;
+    }
+#endif
+    uchar c = in[read];
+    if (c < 0x80) {
+      out[written++] = c;
+      read++;
+      continue;
+    }
+
+    int length;
+    uint code, minimum;
+    if ((c & 0xE0) == 0xC0) {
+      length = 2;
+      code = c & 0x1F;
+      minimum = 0x80;
+    } else if ((c & 0xF0) == 0xE0) {
+      length = 3;
+      code = c & 0x0F;
+      minimum = 0x800;
+    } else if ((c & 0xF8) == 0xF0) {
+      length = 4;
+      code = c & 0x07;
+      minimum = 0x10000;
+    } else {
+      return false;
+    }
+    if (read + length > size) {
+      return false;
+    }
+    for (int i = 1; i < length; i++) {
+      uchar next = in[read + i];
+      if ((next & 0xC0) != 0x80) {
+        return false;
+      }
+      code = (code << 6) | (next & 0x3F);
+    }
+    if (code < minimum || code > 0x10FFFF ||
+        (code >= 0xD800 && code <= 0xDFFF)) {
+      return false;
+    }
+
+    if (code >= 0x10000) {
+      code -= 0x10000;
+      out[written++] = ushort(0xD800 + (code >> 10));
+      out[written++] = ushort(0xDC00 + (code & 0x3FF));
+    } else {
+      out[written++] = ushort(code);
+    }
+    read += length;
+  }
+
+  result.resize(written);
+  text = result;
+  return true;
+}
+
+/*
+ * The encoding of an <?xml encoding?> declaration or a @charset rule at the
+ * start of data, in lower case.
+ */
+QByteArray
+EBookTextDecoder::declaredEncoding(const char* data, int size)
+{
+  QByteArray head = QByteArray::fromRawData(data, size);
+  int start = 0;
+  while (start < size && isspace(uchar(data[start]))) {
+    start++;
+  }
+
+  int value = -1;
+  if (head.indexOf("<?xml", start) == start) {
+    int end = head.indexOf("?>", start);
+    int pos = head.indexOf("encoding", start);
+    if (end < 0 || pos < 0 || pos > end) {
+      return QByteArray();
+    }
+    pos += 8;
+    while (pos < end && (isspace(uchar(data[pos])) || data[pos] == '=')) {
+      pos++;
+    }
+    value = pos;
+  } else if (head.indexOf("@charset", start) == start) {
+    value = start + 8;
+    while (value < size && isspace(uchar(data[value]))) {
+      value++;
+    }
+  }
+  if (value < 0 || value >= size ||
+      (data[value] != '"' && data[value] != '\'')) {
+    return QByteArray();
+  }
+
+  char quote = data[value++];
+  int end = head.indexOf(quote, value);
+  if (end < 0) {
+    return QByteArray();
+  }
+  QByteArray encoding = head.mid(value, end - value).trimmed().toLower();
+  return (encoding == "utf8" ? UTF8 : encoding);
+}
@@ -0,0 +1,42 @@
+#ifndef EBOOKTEXTDECODER_H
+#define EBOOKTEXTDECODER_H
+
+#include <QByteArray>
+#include <QString>
+
+#include "interface_global.h"
+
+/*!
+ * \brief Decodes the text entries of a book, chapters, stylesheets, scripts
+ * and package documents, into a QString.
+ *
+ * The encoding is taken from a byte order mark, an \<?xml encoding?\>
+ * declaration or a leading \@charset rule, in that order, and is otherwise
+ * assumed to be UTF-8. UTF-8, by far the most common, is validated and
+ * converted to UTF-16 in the same pass straight into a string that is
+ * allocated once at its largest possible size, with runs of ASCII handled
+ * sixteen bytes at a time. Undeclared text that turns out not to be UTF-8
+ * is read as Windows-1252, which is what such books almost always are,
+ * and any other declared encoding is handed to QTextCodec.
+ *
+ * The byte order mark is dropped, the declaration is left in place.
+ * Everything is static and can be called from any thread.
+ */
+class INTERFACESHARED_EXPORT EBookTextDecoder
+{
+public:
+  static QString decode(const QByteArray& data, QByteArray* encoding = nullptr);
+  static QByteArray detectEncoding(const QByteArray& data,
+                                   int* bom_length = nullptr);
+  static bool decodeUtf8(const char* data, int size, QString& text);
+
+  static const QByteArray UTF8;
+  static const QByteArray FALLBACK;
+  // how far into the data a declaration is looked for.
+  static const int DECLARATION_LIMIT = 1024;
+
+protected:
+  static QByteArray declaredEncoding(const char* data, int size);
+};
+
+#endif // EBOOKTEXTDECODER_H
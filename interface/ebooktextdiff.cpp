@@ -0,0 +1,265 @@
+#include "ebooktextdiff.h"
+
+#include <QHash>
+
+/*!
+ * \brief Finds the differences between original and changed.
+ */
+EBookTextDiff::EBookTextDiff(const QString& original, const QString& changed)
+  : m_original(lines(original))
+  , m_changed(lines(changed))
+  , m_added(0)
+  , m_removed(0)
+{
+  int n = m_original.size();
+  int m = m_changed.size();
+  int prefix = 0;
+  while (prefix < n && prefix < m &&
+         m_original.at(prefix) == m_changed.at(prefix)) {
+    prefix++;
+  }
+  int suffix = 0;
+  while (suffix < n - prefix && suffix < m - prefix &&
+         m_original.at(n - 1 - suffix) == m_changed.at(m - 1 - suffix)) {
+    suffix++;
+  }
+
+  for (int i = 0; i < prefix; i++) {
+    m_lines.append({ ' ', i, i });
+  }
+
+  // the lines between are compared as numbers, equal lines sharing one.
+  QHash<QString, int> numbers;
+  auto number = [&numbers](const QString& line) {
+    QHash<QString, int>::iterator it = numbers.find(line);
+    if (it == numbers.end()) {
+      it = numbers.insert(line, numbers.size());
+    }
+    return it.value();
+  };
+  QVector<int> a, b;
+  for (int i = prefix; i < n - suffix; i++) {
+    a.append(number(m_original.at(i)));
+  }
+  for (int i = prefix; i < m - suffix; i++) {
+    b.append(number(m_changed.at(i)));
+  }
+  diff(a, b, prefix);
+
+  for (int i = 0; i < suffix; i++) {
+    m_lines.append({ ' ', n - suffix + i, m - suffix + i });
+  }
+}
+
+/*!
+ * \brief Returns true if the texts had no differences.
+ */
+bool
+EBookTextDiff::isEmpty() const
+{
+  return (m_added == 0 && m_removed == 0);
+}
+
+/*!
+ * \brief The number of lines only in the changed text.
+ */
+int
+EBookTextDiff::added() const
+{
+  return m_added;
+}
+
+/*!
+ * \brief The number of lines only in the original text.
+ */
+int
+EBookTextDiff::removed() const
+{
+  return m_removed;
+}
+
+/*!
+ * \brief The differences in unified diff format, as written by diff -u.
+ *
+ * \param context the number of unchanged lines shown around a change,
+ *        changes closer than twice this share a hunk.
+ * \return the diff, or an empty string if there were no differences.
+ */
+QString
+EBookTextDiff::unified(const QString& original_name,
+                       const QString& changed_name,
+                       int context) const
+{
+  QString result;
+  if (isEmpty()) {
+    return result;
+  }
+  result += QStringLiteral("--- %1\n+++ %2\n").arg(original_name, changed_name);
+
+  int count = m_lines.size();
+  int i = 0;
+  while (i < count) {
+    while (i < count && m_lines.at(i).type == ' ') {
+      i++;
+    }
+    if (i == count) {
+      break;
+    }
+
+    int start = qMax(0, i - context);
+    int end = i + 1;
+    for (int j = i + 1; j < count; j++) {
+      if (m_lines.at(j).type != ' ') {
+        end = j + 1;
+      } else if (j - end >= 2 * context) {
+        break;
+      }
+    }
+    end = qMin(count, end + context);
+
+    int a_count = 0;
+    int b_count = 0;
+    for (int j = start; j < end; j++) {
+      if (m_lines.at(j).type != '+') {
+        a_count++;
+      }
+      if (m_lines.at(j).type != '-') {
+        b_count++;
+      }
+    }
+    // an empty range is numbered by the line before it.
+    int a_start = m_lines.at(start).a + (a_count ? 1 : 0);
+    int b_start = m_lines.at(start).b + (b_count ? 1 : 0);
+    result += QStringLiteral("@@ -%1,%2 +%3,%4 @@\n")
+                .arg(a_start)
+                .arg(a_count)
+                .arg(b_start)
+                .arg(b_count);
+
+    for (int j = start; j < end; j++) {
+      const Line& line = m_lines.at(j);
+      result += QLatin1Char(line.type);
+      result +=
+        (line.type == '+' ? m_changed.at(line.b) : m_original.at(line.a));
+      result += QLatin1Char('\n');
+    }
+    i = end;
+  }
+  return result;
+}
+
+/*
+ * A final line break ends the last line rather than starting another.
+ */
+QStringList
+EBookTextDiff::lines(const QString& text)
+{
+  QStringList result = text.split(QLatin1Char('\n'));
+  if (result.last().isEmpty()) {
+    result.removeLast();
+  }
+  return result;
+}
+
+/*
+ * Myers' algorithm on the lines between the common prefix and suffix, a
+ * and b are their numbers. The furthest point reached on each diagonal is
+ * kept after every step so that the edits can be followed back from the
+ * end once it is reached.
+ */
+void
+EBookTextDiff::diff(const QVector<int>& a, const QVector<int>& b, int prefix)
+{
+  int n = a.size();
+  int m = b.size();
+  if (n == 0 || m == 0) {
+    replace(prefix, prefix + n, prefix, prefix + m);
+    return;
+  }
+
+  int limit = qMin(n + m, MAX_EDITS);
+  int offset = limit + 1;
+  QVector<int> v(2 * limit + 3, 0);
+  QVector<QVector<int>> trace; // the diagonals -d to d after step d.
+  int edits = -1;
+  for (int d = 0; d <= limit && edits < 0; d++) {
+    for (int k = -d; k <= d; k += 2) {
+      int x;
+      if (k == -d || (k != d && v.at(offset + k - 1) < v.at(offset + k + 1))) {
+        x = v.at(offset + k + 1);
+      } else {
+        x = v.at(offset + k - 1) + 1;
+      }
+      int y = x - k;
+      while (x < n && y < m && a.at(x) == b.at(y)) {
+        x++;
+        y++;
+      }
+      v[offset + k] = x;
+      if (x >= n && y >= m) {
+        edits = d;
+        break;
+      }
+    }
+    trace.append(v.mid(offset - d, 2 * d + 1));
+  }
+
+  if (edits < 0) {
+    replace(prefix, prefix + n, prefix, prefix + m);
+    return;
+  }
+
+  QVector<Line> backwards;
+  int x = n;
+  int y = m;
+  for (int d = edits; d > 0; d--) {
+    const QVector<int>& previous = trace.at(d - 1);
+    int k = x - y;
+    // previous holds the diagonals -(d - 1) to d - 1.
+    bool down = (k == -d || (k != d && previous.at(k - 1 + d - 1) <
+                                         previous.at(k + 1 + d - 1)));
+    int previous_k = (down ? k + 1 : k - 1);
+    int previous_x = previous.at(previous_k + d - 1);
+    int previous_y = previous_x - previous_k;
+    while (x > previous_x && y > previous_y) {
+      x--;
+      y--;
+      backwards.append({ ' ', prefix + x, prefix + y });
+    }
+    if (down) {
+      y--;
+      backwards.append({ '+', prefix + x, prefix + y });
+      m_added++;
+    } else {
+      x--;
+      backwards.append({ '-', prefix + x, prefix + y });
+      m_removed++;
+    }
+  }
+  while (x > 0 && y > 0) {
+    x--;
+    y--;
+    backwards.append({ ' ', prefix + x, prefix + y });
+  }
+
+  for (int i = backwards.size() - 1; i >= 0; i--) {
+    m_lines.append(backwards.at(i));
+  }
+}
+
+/*
+ * The original lines a_start to a_end all replaced by the changed lines
+ * b_start to b_end.
+ */
+void
+EBookTextDiff::replace(int a_start, int a_end, int b_start, int b_end)
+{
+  for (int i = a_start; i < a_end; i++) {
+    m_lines.append({ '-', i, b_start });
+    m_removed++;
+  }
+  for (int i = b_start; i < b_end; i++) {
+    m_lines.append({ '+', a_end, i });
+    m_added++;
+  }
+}
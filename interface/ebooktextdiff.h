@@ -0,0 +1,58 @@
+#ifndef EBOOKTEXTDIFF_H
+#define EBOOKTEXTDIFF_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "interface_global.h"
+
+/*!
+ * \brief The line by line differences between two versions of a text.
+ *
+ * The lines are matched with Myers' O(ND) algorithm once the lines that
+ * the two texts start and end with in common have been set aside, so an
+ * edit to one paragraph of a long chapter costs little more than the
+ * paragraph. Texts with more than MAX_EDITS differences are shown as the
+ * whole of the changed lines replaced rather than spending quadratic time
+ * and memory on finding the shortest edit.
+ */
+class INTERFACESHARED_EXPORT EBookTextDiff
+{
+public:
+  EBookTextDiff(const QString& original, const QString& changed);
+
+  bool isEmpty() const;
+  int added() const;
+  int removed() const;
+  QString unified(const QString& original_name,
+                  const QString& changed_name,
+                  int context = DEFAULT_CONTEXT) const;
+
+  static const int DEFAULT_CONTEXT = 3;
+  static const int MAX_EDITS = 1000;
+
+protected:
+  /*
+   * A line of the diff, a and b are the lines of the original and changed
+   * texts that come before it.
+   */
+  struct Line
+  {
+    char type; // ' ', '-' or '+'.
+    int a;
+    int b;
+  };
+
+  QStringList m_original;
+  QStringList m_changed;
+  QVector<Line> m_lines;
+  int m_added;
+  int m_removed;
+
+  void diff(const QVector<int>& a, const QVector<int>& b, int prefix);
+  void replace(int a_start, int a_end, int b_start, int b_end);
+  static QStringList lines(const QString& text);
+};
+
+#endif // EBOOKTEXTDIFF_H
@@ -0,0 +1,65 @@
+#include "ebooktoc.h"
+
+const QString EBookToc::TOC_TITLE = "<h2>%1</h2>";
+const QString EBookToc::LIST_START = "<html><body>";
+const QString EBookToc::LIST_END = "</body></html>";
+const QString EBookToc::SUB_LIST_START = "<ul>";
+const QString EBookToc::SUB_LIST_END = "</ul>";
+const QString EBookToc::LIST_ITEM = "<li><a href=\"%1\">%2</a>";
+
+bool
+EBookToc::isEmpty() const
+{
+  return entries.isEmpty();
+}
+
+/*!
+ * \brief The number of entries at every level.
+ */
+int
+EBookToc::count() const
+{
+  return count(entries);
+}
+
+/*!
+ * \brief The toc as nested html lists, as shown by the toc widget.
+ */
+QString
+EBookToc::toHtml() const
+{
+  QString html = LIST_START;
+  if (!title.isEmpty()) {
+    html += TOC_TITLE.arg(title.toHtmlEscaped());
+  }
+  html += SUB_LIST_START;
+  appendHtml(entries, html);
+  html += SUB_LIST_END;
+  html += LIST_END;
+  return html;
+}
+
+int
+EBookToc::count(const TocEntryList& entries)
+{
+  int total = entries.size();
+  foreach (SharedTocEntry entry, entries) {
+    total += count(entry->children);
+  }
+  return total;
+}
+
+void
+EBookToc::appendHtml(const TocEntryList& entries, QString& html)
+{
+  foreach (SharedTocEntry entry, entries) {
+    html += LIST_ITEM.arg(entry->href.toHtmlEscaped())
+              .arg(entry->label.toHtmlEscaped());
+    if (!entry->children.isEmpty()) {
+      html += SUB_LIST_START;
+      appendHtml(entry->children, html);
+      html += SUB_LIST_END;
+    }
+    html += "</li>";
+  }
+}
@@ -0,0 +1,53 @@
+#ifndef EBOOKTOC_H
+#define EBOOKTOC_H
+
+#include <QList>
+#include <QSharedPointer>
+#include <QString>
+
+class EBookTocEntry;
+typedef QSharedPointer<EBookTocEntry> SharedTocEntry;
+typedef QList<SharedTocEntry> TocEntryList;
+
+/*!
+ * \brief One entry of a table of contents and the entries below it.
+ */
+class EBookTocEntry
+{
+public:
+  QString label;
+  QString href; // the file, with a #fragment if it points into it.
+  TocEntryList children;
+};
+
+/*!
+ * \brief A table of contents as a tree.
+ *
+ * The book builds it once and the toc widget, the toc editor and anything
+ * else that needs it share the same entries, it is only turned into html
+ * by toHtml() when it is shown. Entries are not changed once they have been
+ * handed out, an edited toc is a new tree.
+ */
+class EBookToc
+{
+public:
+  QString title;
+  TocEntryList entries;
+
+  bool isEmpty() const;
+  int count() const;
+  QString toHtml() const;
+
+protected:
+  static int count(const TocEntryList& entries);
+  static void appendHtml(const TocEntryList& entries, QString& html);
+
+  static const QString TOC_TITLE;
+  static const QString LIST_START;
+  static const QString LIST_END;
+  static const QString SUB_LIST_START;
+  static const QString SUB_LIST_END;
+  static const QString LIST_ITEM;
+};
+
+#endif // EBOOKTOC_H
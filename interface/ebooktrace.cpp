@@ -0,0 +1,261 @@
+#include "ebooktrace.h"
+
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QThread>
+#include <QThreadStorage>
+#include <QVariant>
+
+// the application property that holds the registry.
+static const char* TRACE_PROPERTY = "ebookTraceRegistry";
+
+/*
+ * Marks the buffer of a thread as finished when the thread exits, the
+ * events in it are kept.
+ */
+struct EBookTraceThread
+{
+  SharedTraceBuffer buffer;
+  ~EBookTraceThread()
+  {
+    QMutexLocker locker(&buffer->mutex);
+    buffer->finished = true;
+  }
+};
+
+bool
+EBookTrace::isEnabled()
+{
+#ifdef EBOOK_TRACE_ENABLED
+  return true;
+#else
+  return false;
+#endif
+}
+
+/*!
+ * \brief Creates the registry and starts the clock, called once by the
+ * application before the plugins are loaded.
+ */
+void
+EBookTrace::install()
+{
+#ifdef EBOOK_TRACE_ENABLED
+  QCoreApplication* app = QCoreApplication::instance();
+  if (!app || app->property(TRACE_PROPERTY).isValid()) {
+    return;
+  }
+  // lives as long as the application.
+  EBookTraceRegistry* registry = new EBookTraceRegistry;
+  registry->clock.start();
+  app->setProperty(TRACE_PROPERTY, quintptr(registry));
+#endif
+}
+
+EBookTraceRegistry*
+EBookTrace::registry()
+{
+  static EBookTraceRegistry* registry = nullptr;
+  static QBasicAtomicInt found = Q_BASIC_ATOMIC_INITIALIZER(0);
+  if (!found.loadAcquire()) {
+    static QMutex mutex;
+    QMutexLocker locker(&mutex);
+    QCoreApplication* app = QCoreApplication::instance();
+    if (!app) {
+      return nullptr;
+    }
+    QVariant value = app->property(TRACE_PROPERTY);
+    if (!value.isValid()) {
+      return nullptr;
+    }
+    registry = reinterpret_cast<EBookTraceRegistry*>(value.value<quintptr>());
+    found.storeRelease(1);
+  }
+  return registry;
+}
+
+/*!
+ * \brief Microseconds since the trace was installed, or -1 if it has not
+ * been.
+ */
+qint64
+EBookTrace::now()
+{
+  EBookTraceRegistry* trace = registry();
+  return (trace ? trace->clock.nsecsElapsed() / 1000 : -1);
+}
+
+/*
+ * The buffer of the calling thread, created the first time the thread
+ * records an event.
+ */
+EBookTraceBuffer*
+EBookTrace::buffer()
+{
+  static QThreadStorage<EBookTraceThread*> threads;
+  if (threads.hasLocalData()) {
+    return threads.localData()->buffer.data();
+  }
+  EBookTraceRegistry* trace = registry();
+  if (!trace) {
+    return nullptr;
+  }
+  SharedTraceBuffer buffer(new EBookTraceBuffer);
+  buffer->events.resize(RING_SIZE);
+  QThread* thread = QThread::currentThread();
+  buffer->thread_id = quint64(quintptr(QThread::currentThreadId()));
+  buffer->thread_name = thread->objectName();
+  if (buffer->thread_name.isEmpty()) {
+    buffer->thread_name = (thread == QCoreApplication::instance()->thread()
+                             ? QString("Main")
+                             : QString("Thread %1").arg(buffer->thread_id));
+  }
+
+  QMutexLocker locker(&trace->mutex);
+  if (trace->buffers.size() >= MAX_BUFFERS) {
+    for (int i = 0; i < trace->buffers.size(); i++) {
+      if (trace->buffers.at(i)->finished) {
+        trace->buffers.removeAt(i);
+        break;
+      }
+    }
+  }
+  trace->buffers.append(buffer);
+  EBookTraceThread* local = new EBookTraceThread;
+  local->buffer = buffer;
+  threads.setLocalData(local);
+  return buffer.data();
+}
+
+/*!
+ * \brief Adds an event to the buffer of the calling thread.
+ */
+void
+EBookTrace::record(const char* name, qint64 start, qint64 duration)
+{
+  EBookTraceBuffer* events = buffer();
+  if (!events) {
+    return;
+  }
+  QMutexLocker locker(&events->mutex);
+  EBookTraceEvent& event = events->events[events->next];
+  event.name = name;
+  event.start = start;
+  event.duration = duration;
+  EBookTraceTotal& total = events->totals[name];
+  total.count++;
+  total.duration += duration;
+  if (++events->next == events->events.size()) {
+    events->next = 0;
+    events->wrapped = true;
+  }
+}
+
+/*!
+ * \brief The events of every thread, as a Chrome trace_event json object.
+ */
+QByteArray
+EBookTrace::toJson()
+{
+  QJsonArray events;
+  EBookTraceRegistry* trace = registry();
+  if (trace) {
+    QList<SharedTraceBuffer> buffers;
+    {
+      QMutexLocker locker(&trace->mutex);
+      buffers = trace->buffers;
+    }
+    qint64 pid = QCoreApplication::applicationPid();
+    foreach (SharedTraceBuffer buffer, buffers) {
+      QMutexLocker locker(&buffer->mutex);
+      QJsonObject name;
+      name.insert("name", "thread_name");
+      name.insert("ph", "M");
+      name.insert("pid", pid);
+      name.insert("tid", qint64(buffer->thread_id));
+      name.insert("args", QJsonObject{ { "name", buffer->thread_name } });
+      events.append(name);
+
+      int count = (buffer->wrapped ? buffer->events.size() : buffer->next);
+      int first = (buffer->wrapped ? buffer->next : 0);
+      for (int i = 0; i < count; i++) {
+        const EBookTraceEvent& event =
+          buffer->events.at((first + i) % buffer->events.size());
+        QJsonObject object;
+        object.insert("name", QString::fromLatin1(event.name));
+        object.insert("ph", "X");
+        object.insert("ts", event.start);
+        object.insert("dur", event.duration);
+        object.insert("pid", pid);
+        object.insert("tid", qint64(buffer->thread_id));
+        events.append(object);
+      }
+    }
+  }
+  QJsonObject root;
+  root.insert("traceEvents", events);
+  root.insert("displayTimeUnit", "ms");
+  return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+/*!
+ * \brief The totals of the events recorded by the calling thread.
+ *
+ * The application and each plugin record into buffers of their own, the
+ * totals of all of them are merged by name.
+ */
+EBookTraceTotals
+EBookTrace::threadTotals()
+{
+  EBookTraceTotals totals;
+  EBookTraceRegistry* trace = registry();
+  if (!trace) {
+    return totals;
+  }
+  QList<SharedTraceBuffer> buffers;
+  {
+    QMutexLocker locker(&trace->mutex);
+    buffers = trace->buffers;
+  }
+  // the application and each plugin keep their own buffer for the thread.
+  quint64 thread_id = quint64(quintptr(QThread::currentThreadId()));
+  foreach (SharedTraceBuffer buffer, buffers) {
+    QMutexLocker locker(&buffer->mutex);
+    if (buffer->thread_id != thread_id || buffer->finished) {
+      continue;
+    }
+    QHash<const char*, EBookTraceTotal>::const_iterator it =
+      buffer->totals.constBegin();
+    for (; it != buffer->totals.constEnd(); ++it) {
+      EBookTraceTotal& total = totals[QByteArray(it.key())];
+      total.count += it.value().count;
+      total.duration += it.value().duration;
+    }
+  }
+  return totals;
+}
+
+/*!
+ * \brief Throws away the events recorded so far, the totals are kept.
+ */
+void
+EBookTrace::clear()
+{
+  EBookTraceRegistry* trace = registry();
+  if (!trace) {
+    return;
+  }
+  QMutexLocker locker(&trace->mutex);
+  for (int i = trace->buffers.size() - 1; i >= 0; i--) {
+    SharedTraceBuffer buffer = trace->buffers.at(i);
+    QMutexLocker buffer_locker(&buffer->mutex);
+    buffer->next = 0;
+    buffer->wrapped = false;
+    if (buffer->finished) {
+      trace->buffers.removeAt(i);
+    }
+  }
+}
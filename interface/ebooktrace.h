@@ -0,0 +1,141 @@
+#ifndef EBOOKTRACE_H
+#define EBOOKTRACE_H
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+#include "interface_global.h"
+
+/*
+ * Tracing is built into debug builds. Release builds leave it out unless
+ * they are built with EBOOK_TRACING defined, for example with
+ * qmake "DEFINES+=EBOOK_TRACING".
+ */
+#if !defined(QT_NO_DEBUG) || defined(EBOOK_TRACING)
+#define EBOOK_TRACE_ENABLED
+#endif
+
+/*!
+ * \brief A timed scope, the name must be a string literal.
+ */
+struct EBookTraceEvent
+{
+  const char* name = nullptr;
+  qint64 start = 0; // microseconds since the trace was installed.
+  qint64 duration = 0;
+};
+
+/*!
+ * \brief The number of events of one name and their total duration.
+ */
+struct EBookTraceTotal
+{
+  qint64 count = 0;
+  qint64 duration = 0; // microseconds.
+};
+typedef QHash<QByteArray, EBookTraceTotal> EBookTraceTotals;
+
+/*!
+ * \brief The latest events of one thread, older events are overwritten.
+ *
+ * Only the thread itself writes to it, the lock is only ever contended
+ * while the trace is being saved.
+ */
+struct EBookTraceBuffer
+{
+  QMutex mutex;
+  QVector<EBookTraceEvent> events;
+  // every event since the thread started, by name, never overwritten.
+  QHash<const char*, EBookTraceTotal> totals;
+  int next = 0;
+  bool wrapped = false;
+  bool finished = false; // the thread has exited.
+  quint64 thread_id = 0;
+  QString thread_name;
+};
+typedef QSharedPointer<EBookTraceBuffer> SharedTraceBuffer;
+
+/*!
+ * \brief The buffers of every thread and the clock they are timed by.
+ */
+struct EBookTraceRegistry
+{
+  QMutex mutex;
+  QList<SharedTraceBuffer> buffers;
+  QElapsedTimer clock;
+};
+
+/*!
+ * \brief Records timed scopes in a ring buffer for each thread, and saves
+ * them as Chrome trace_event json, to be loaded in chrome://tracing.
+ *
+ * The interface library is linked into the application and into every
+ * plugin, so each has its own copy of this class. The registry is created
+ * once by install(), called by the application before any plugin is
+ * loaded, and is found by the other copies through a property of the
+ * application object. Nothing is recorded until it is installed.
+ *
+ * Use EBOOK_TRACE_SCOPE("name") to time the rest of a block, it compiles
+ * to nothing when tracing is not built in. Running totals of each name are
+ * also kept, which threadTotals() returns for live displays such as
+ * EBookProfileOverlay.
+ */
+class INTERFACESHARED_EXPORT EBookTrace
+{
+public:
+  static bool isEnabled();
+  static void install();
+  static void record(const char* name, qint64 start, qint64 duration);
+  static qint64 now();
+  static QByteArray toJson();
+  static EBookTraceTotals threadTotals();
+  static void clear();
+
+  // events kept for each thread.
+  static const int RING_SIZE = 8192;
+  // buffers of exited threads are dropped after this many.
+  static const int MAX_BUFFERS = 64;
+
+protected:
+  static EBookTraceRegistry* registry();
+  static EBookTraceBuffer* buffer();
+};
+
+/*!
+ * \brief Times the scope it is created in.
+ */
+class INTERFACESHARED_EXPORT EBookTraceScope
+{
+public:
+  explicit EBookTraceScope(const char* name)
+    : m_name(name)
+    , m_start(EBookTrace::now())
+  {}
+  ~EBookTraceScope()
+  {
+    if (m_start >= 0) {
+      EBookTrace::record(m_name, m_start, EBookTrace::now() - m_start);
+    }
+  }
+
+protected:
+  const char* m_name;
+  qint64 m_start;
+};
+
+#ifdef EBOOK_TRACE_ENABLED
+#define EBOOK_TRACE_CONCAT_(a, b) a##b
+#define EBOOK_TRACE_CONCAT(a, b) EBOOK_TRACE_CONCAT_(a, b)
+#define EBOOK_TRACE_SCOPE(name)                                               \
+  EBookTraceScope EBOOK_TRACE_CONCAT(ebook_trace_scope_, __LINE__)(name)
+#else
+#define EBOOK_TRACE_SCOPE(name)
+#endif
+
+#endif // EBOOKTRACE_H
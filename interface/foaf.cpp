@@ -1,5 +1,65 @@
 #include "foaf.h"
 
+#include "lookuptable.h"
+
+// the foaf names without their prefix, sorted by name.
+static constexpr LookupEntry<Foaf::Term> TERMS[] = {
+  { "account", Foaf::ACCOUNT },
+  { "accountName", Foaf::ACCOUNT_NAME },
+  { "accountServiceHomepage", Foaf::ACCOUNT_SERVICE_HOMEPAGE },
+  { "age", Foaf::AGE },
+  { "agent", Foaf::AGENT },
+  { "based_near", Foaf::BASED_NEAR },
+  { "currentProject", Foaf::CURRENT_PROJECT },
+  { "depiction", Foaf::DEPICTION },
+  { "depicts", Foaf::DEPICTS },
+  { "Document", Foaf::DOCUMENT },
+  { "familyname", Foaf::FAMILY_NAME },
+  { "givenname", Foaf::GIVEN_NAME },
+  { "Group", Foaf::GROUP },
+  { "homepage", Foaf::HOMEPAGE },
+  { "Image", Foaf::IMAGE },
+  { "img", Foaf::IMG },
+  { "interest", Foaf::INTEREST },
+  { "jabberID", Foaf::JABBER_ID },
+  { "knows", Foaf::KNOWS },
+  { "logo", Foaf::LOGO },
+  { "made", Foaf::MADE },
+  { "maker", Foaf::MAKER },
+  { "mbox", Foaf::MBOX },
+  { "mbox_sha1sum", Foaf::MBOX_SHA1SUM },
+  { "member", Foaf::MEMBER },
+  { "name", Foaf::NAME },
+  { "nick", Foaf::NICK },
+  { "OnlineAccount", Foaf::ONLINE_ACCOUNT },
+  { "openid", Foaf::OPENID },
+  { "Organization", Foaf::ORGANISATION },
+  { "page", Foaf::PAGE },
+  { "pastProject", Foaf::PAST_PROJECT },
+  { "person", Foaf::PERSON },
+  { "PersonalProfileDocument", Foaf::PERSONAL_PROFILE_DOCUMENT },
+  { "primaryTopic", Foaf::PRIMARY_TOPIC },
+  { "primaryTopicOf", Foaf::PRIMARY_TOPIC_OF },
+  { "Project", Foaf::PROJECT },
+  { "publications", Foaf::PUBLICATIONS },
+  { "schoolHomepage", Foaf::SCHOOL_HOMEPAGE },
+  { "sha1", Foaf::SHA1 },
+  { "thumbnail", Foaf::THUMBNAIL },
+  { "tipjar", Foaf::TIPJAR },
+  { "title", Foaf::TITLE },
+  { "topic", Foaf::TOPIC },
+  { "topic_interest", Foaf::TOPIC_INTEREST },
+  { "weblog", Foaf::WEBLOG },
+  { "workInfoHomepage", Foaf::WORK_INFO_HOMEPAGE },
+  { "workplaceHomepage", Foaf::WORKPLACE_HOMEPAGE },
+};
+static_assert(LookupTable::isSorted(TERMS), "foaf names must be sorted");
+
+static constexpr int TERM_COUNT = Foaf::LOGO + 1;
+static constexpr LookupIndex<TERM_COUNT> TERM_NAMES =
+  LookupTable::buildIndex<TERM_COUNT>(TERMS);
+static const char PREFIX[] = "foaf:";
+
 const QString Foaf::m_prefix = "foaf: http://xmlns.com/foaf/spec/";
 
 Foaf::Foaf()
@@ -26,232 +86,27 @@ bool Foaf::isFoaf()
 
 QString Foaf::toString(Foaf::Term term)
 {
-  switch (term) {
-  case AGENT:
-    return "foaf:agent";
-  case PERSON:
-    return "foaf:person";
-  case NAME:
-    return "foaf:name";
-  case TITLE:
-    return "foaf:title";
-  case IMG:
-    return "foaf:img";
-  case DEPICTION:
-    return "foaf:depiction";
-  case DEPICTS:
-    return "foaf:depicts";
-  case FAMILY_NAME:
-    return "foaf:familyname";
-  case GIVEN_NAME:
-    return "foaf:givenname";
-  case KNOWS:
-    return "foaf:knows";
-  case BASED_NEAR:
-    return "foaf:based_near";
-  case AGE:
-    return "foaf:age";
-  case MADE:
-    return "foaf:made";
-  case MAKER:
-    return "foaf:maker";
-  case PRIMARY_TOPIC:
-    return "foaf:primaryTopic";
-  case PRIMARY_TOPIC_OF:
-    return "foaf:primaryTopicOf";
-  case PROJECT:
-    return "foaf:Project";
-  case ORGANISATION:
-    return "foaf:Organization";
-  case GROUP:
-    return "foaf:Group";
-  case MEMBER:
-    return "foaf:member";
-  case DOCUMENT:
-    return "foaf:Document";
-  case IMAGE:
-    return "foaf:Image";
-  case NICK:
-    return "foaf:nick";
-  case MBOX:
-    return "foaf:mbox";
-  case HOMEPAGE:
-    return "foaf:homepage";
-  case WEBLOG:
-    return "foaf:weblog";
-  case OPENID:
-    return "foaf:openid";
-  case JABBER_ID:
-    return "foaf:jabberID";
-  case MBOX_SHA1SUM:
-    return "foaf:mbox_sha1sum";
-  case INTEREST:
-    return "foaf:interest";
-  case TOPIC_INTEREST:
-    return "foaf:topic_interest";
-  case TOPIC:
-    return "foaf:topic";
-  case PAGE:
-    return "foaf:page";
-  case WORKPLACE_HOMEPAGE:
-    return "foaf:workplaceHomepage";
-  case WORK_INFO_HOMEPAGE:
-    return "foaf:workInfoHomepage";
-  case SCHOOL_HOMEPAGE:
-    return "foaf:schoolHomepage";
-  case PUBLICATIONS:
-    return "foaf:publications";
-  case CURRENT_PROJECT:
-    return "foaf:currentProject";
-  case PAST_PROJECT:
-    return "foaf:pastProject";
-  case ACCOUNT:
-    return "foaf:account";
-  case ONLINE_ACCOUNT:
-    return "foaf:OnlineAccount";
-  case ACCOUNT_NAME:
-    return "foaf:accountName";
-  case ACCOUNT_SERVICE_HOMEPAGE:
-    return "foaf:accountServiceHomepage";
-  case PERSONAL_PROFILE_DOCUMENT:
-    return "foaf:PersonalProfileDocument";
-  case TIPJAR:
-    return "foaf:tipjar";
-  case SHA1:
-    return "foaf:sha1";
-  case THUMBNAIL:
-    return "foaf:thumbnail";
-  case LOGO:
-    return "foaf:logo";
-
-  default:
+  if (term <= NO_TERM || term >= TERM_COUNT || !TERM_NAMES.names[term]) {
     return "no_term";
   }
+  return QLatin1String(PREFIX) + QLatin1String(TERM_NAMES.names[term]);
 }
 
 Foaf Foaf::fromString(QString term_name)
 {
   Foaf terms;
-  QString name;
-  if (term_name.toLower().startsWith("foaf:")) {
-    QStringList splits = term_name.toLower().split(":");
-    if (splits.size() == 2) {
-      name = splits.at(1).toLower();
-    } else {
-      terms.setTerm(Term::NO_TERM);
-    }
-  }
-
-  if (name == "agent") {
-    terms.setTerm(AGENT);
-  } else if (name == "person") {
-    terms.setTerm(PERSON);
-  } else if (name == "name") {
-    terms.setTerm(NAME);
-  } else if (name == "title") {
-    terms.setTerm(TITLE);
-  } else if (name == "img") {
-    terms.setTerm(IMG);
-  } else if (name == "depiction") {
-    terms.setTerm(DEPICTION);
-  } else if (name == "depicts") {
-    terms.setTerm(DEPICTS);
-  } else if (name == "familyname") {
-    terms.setTerm(FAMILY_NAME);
-  } else if (name == "givenname") {
-    terms.setTerm(GIVEN_NAME);
-  } else if (name == "knows") {
-    terms.setTerm(KNOWS);
-  } else if (name == "based_near") {
-    terms.setTerm(BASED_NEAR);
-  } else if (name == "age") {
-    terms.setTerm(AGE);
-  } else if (name == "made") {
-    terms.setTerm(MADE);
-  } else if (name == "maker") {
-    terms.setTerm(MAKER);
-  } else if (name == "primarytopic") {
-    terms.setTerm(PRIMARY_TOPIC);
-  } else if (name == "primarytopicof") {
-    terms.setTerm(PRIMARY_TOPIC_OF);
-  } else if (name == "project") {
-    terms.setTerm(PROJECT);
-  } else if (name == "organization") {
-    terms.setTerm(ORGANISATION);
-  } else if (name == "group") {
-    terms.setTerm(GROUP);
-  } else if (name == "member") {
-    terms.setTerm(MEMBER);
-  } else if (name == "document") {
-    terms.setTerm(DOCUMENT);
-  } else if (name == "image") {
-    terms.setTerm(IMAGE);
-  } else if (name == "nick") {
-    terms.setTerm(NICK);
-  } else if (name == "mbox") {
-    terms.setTerm(MBOX);
-  } else if (name == "homepage") {
-    terms.setTerm(HOMEPAGE);
-  } else if (name == "weblog") {
-    terms.setTerm(WEBLOG);
-  } else if (name == "openid") {
-    terms.setTerm(OPENID);
-  } else if (name == "jabberid") {
-    terms.setTerm(JABBER_ID);
-  } else if (name == "mbox_sha1sum") {
-    terms.setTerm(MBOX_SHA1SUM);
-  } else if (name == "interest") {
-    terms.setTerm(INTEREST);
-  } else if (name == "topic_interest") {
-    terms.setTerm(TOPIC_INTEREST);
-  } else if (name == "topic") {
-    terms.setTerm(TOPIC);
-  } else if (name == "page") {
-    terms.setTerm(PAGE);
-  } else if (name == "workplacehomepage") {
-    terms.setTerm(WORKPLACE_HOMEPAGE);
-  } else if (name == "workinfohomepage") {
-    terms.setTerm(WORK_INFO_HOMEPAGE);
-  } else if (name == "schoolhomepage") {
-    terms.setTerm(SCHOOL_HOMEPAGE);
-  } else if (name == "publications") {
-    terms.setTerm(PUBLICATIONS);
-  } else if (name == "currentproject") {
-    terms.setTerm(CURRENT_PROJECT);
-  } else if (name == "pastproject") {
-    terms.setTerm(PAST_PROJECT);
-  } else if (name == "account") {
-    terms.setTerm(ACCOUNT);
-  } else if (name == "onlineaccount") {
-    terms.setTerm(ONLINE_ACCOUNT);
-  } else if (name == "accountname") {
-    terms.setTerm(ACCOUNT_NAME);
-  } else if (name == "accountservicehomepage") {
-    terms.setTerm(ACCOUNT_SERVICE_HOMEPAGE);
-  } else if (name == "personalprofiledocument") {
-    terms.setTerm(PERSONAL_PROFILE_DOCUMENT);
-  } else if (name == "tipjar") {
-    terms.setTerm(TIPJAR);
-  } else if (name == "sha1") {
-    terms.setTerm(SHA1);
-  } else if (name == "thumbnail") {
-    terms.setTerm(THUMBNAIL);
-  } else if (name == "logo") {
-    terms.setTerm(LOGO);
+  QStringView name;
+  if (LookupTable::startsWith(term_name, PREFIX)) {
+    name = QStringView(term_name).mid(int(sizeof(PREFIX)) - 1);
+    terms.setTerm(LookupTable::find(TERMS, name, Term::NO_TERM));
   }
-  terms.setCode(name);
+  terms.setCode(name.toString().toLower());
   return terms;
 }
 
 bool Foaf::isFoaf(QString tag_name)
 {
-  if (tag_name.toLower().startsWith("foaf:")) {
-    Foaf foaf = fromString(tag_name);
-    if (foaf.term() != NO_TERM)
-      return true;
-  }
-
-  return false;
+  return (fromString(tag_name).term() != NO_TERM);
 }
 
 QString Foaf::prefix()
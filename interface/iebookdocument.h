@@ -7,9 +7,34 @@
 
 #include "ebookcommon.h"
 #include "ebookmetadata.h"
+#include "ebooktoc.h"
 
 class IEBookInterface;
 
+/*!
+ * \brief The memory held by an open book, in bytes, for each kind of data.
+ *
+ * The figures are what the data structures hold, not what the allocator
+ * has handed out, so they are a little low, but they show which book and
+ * which structure is responsible.
+ */
+struct EBookMemoryUsage
+{
+  qint64 images = 0;        // decoded images in the image cache.
+  qint64 svgs = 0;          // rendered svgs in the image cache.
+  qint64 documents = 0;     // the xhtml of the chapters.
+  qint64 styles = 0;        // css and javascript.
+  qint64 resources = 0;     // compressed images and other entries.
+  qint64 text_document = 0; // the QTextDocument shown.
+  qint64 undo = 0;          // the undo history.
+
+  qint64 total() const
+  {
+    return images + svgs + documents + styles + resources + text_document +
+           undo;
+  }
+};
+
 class IEBookDocument
 {
 public:
@@ -28,6 +53,10 @@ public:
   //  virtual void setReadOnly(const bool readonly) = 0;
 
   virtual QString tocAsString() = 0;
+  /*!
+   * \brief The table of contents as a tree, empty if the document has none.
+   */
+  virtual EBookToc toc() { return EBookToc(); }
 
   virtual QString title() = 0;
   virtual void setTitle(const QString& title) = 0;
@@ -45,9 +74,89 @@ public:
   virtual QDate published() = 0;
   virtual void setPublished(const QDate& published) = 0;
 
-  virtual QString buildTocFromData() = 0;
+  virtual EBookToc buildTocFromData() = 0;
 
   virtual Metadata metadata() = 0;
+
+  /*!
+   * \brief Shows the chapter with the id used by the search index.
+   *
+   * Documents that always show the whole book can ignore this.
+   *
+   * \return true if the chapter is now shown.
+   */
+  virtual bool showChapter(const QString& /*id*/) { return false; }
+
+  /*!
+   * \brief Books that are shown a chapter at a time give the chapter
+   * shown, the number of chapters, and let the editor move between them.
+   *
+   * Documents that always show the whole book are a single chapter.
+   */
+  virtual int currentChapter() { return 0; }
+  virtual int chapterCount() { return 1; }
+  virtual bool setCurrentChapter(int /*index*/) { return false; }
+
+  /*!
+   * \brief The chapter that holds the file href, as used in the table of
+   * contents, or -1 if it is not known.
+   */
+  virtual int chapterOfHref(const QString& /*href*/) { return -1; }
+
+  /*!
+   * \brief The xhtml of the chapter shown, or an empty string if the
+   * document does not keep it.
+   */
+  virtual QString chapterSource() { return QString(); }
+
+  /*!
+   * \brief The xhtml of any chapter, and replacing it. Replacing the
+   * chapter shown loads it again.
+   */
+  virtual QString chapterSourceAt(int /*index*/) { return QString(); }
+  virtual bool setChapterSource(int /*index*/, const QString& /*source*/)
+  {
+    return false;
+  }
+
+  /*!
+   * \brief Loads the chapter shown again from the book, dropping any edits.
+   */
+  virtual bool reloadChapter() { return false; }
+
+  /*!
+   * \brief The memory held by the book. The undo history is kept by the
+   * editor and is not included.
+   */
+  virtual EBookMemoryUsage memoryUsage() { return EBookMemoryUsage(); }
+
+  /*!
+   * \brief Tells the document how far the view showing it is zoomed, 1.0
+   * being unzoomed, so that its images can be shown at a matching size.
+   *
+   * Documents that do not scale their images can ignore this.
+   */
+  virtual void setImageZoom(qreal /*zoom*/) {}
+
+  /*!
+   * \brief Tells the document the size of the view showing it, a page being
+   * a screenful, so that its chapters can be paginated at that size.
+   *
+   * Documents that do not paginate can ignore this.
+   */
+  virtual void setPageLayoutSize(const QSizeF& /*size*/) {}
+
+  /*!
+   * \brief The number of pages of a chapter at the page layout size, or -1
+   * if it has not been paginated yet.
+   */
+  virtual int chapterPageCount(int /*index*/) { return -1; }
+
+  /*!
+   * \brief The position in the QTextDocument of a chapter where one of its
+   * pages starts, or -1 if it has not been paginated or has fewer pages.
+   */
+  virtual int pagePosition(int /*index*/, int /*page*/) { return -1; }
 };
 
 /*!
@@ -63,10 +172,31 @@ public:
     : QTextDocument(parent)
   {}
 
+  /*!
+   * \brief An estimate of the memory held by the QTextDocument, its text
+   * and the layout and formats of each block.
+   */
+  qint64 textDocumentBytes() const
+  {
+    return qint64(characterCount()) * qint64(sizeof(QChar)) +
+           qint64(blockCount()) * BLOCK_OVERHEAD;
+  }
+
 signals:
   void loadCompleted();
+  void saveProgress(int value, int total);
+  void saveCompleted(bool success);
+  // sent either side of the contents being replaced by another chapter.
+  void chapterAboutToChange(int index);
+  void chapterChanged(int index);
+  // sent when the xhtml of a chapter has been replaced.
+  void chapterSourceChanged(int index);
+  // sent when the pages of a chapter are known, see chapterPageCount().
+  void chapterPaginated(int index);
 
 protected:
+  // the layout, format and fragment records of a block, measured roughly.
+  static const int BLOCK_OVERHEAD = 256;
 };
 
 /*!
@@ -1,17 +1,33 @@
 #ifndef IEBOOKINTERFACE_H
 #define IEBOOKINTERFACE_H
 
+#include <QImage>
+#include <QThread>
 #include <QtPlugin>
 
 #include "authors.h"
+#include "ebookcomparison.h"
+#include "ebookcontent.h"
 #include "iebookdocument.h"
 #include "interface_global.h"
 #include "iplugininterface.h"
 #include "library.h"
 #include "options.h"
+#include "searchindex.h"
 
 class EBookDocument;
 
+/*!
+ * \brief Bytes that a book file of a plugin's type holds at a fixed offset
+ * near its start, see IEBookInterface::signatures().
+ */
+struct EBookSignature
+{
+  int offset = 0;
+  QByteArray magic;
+};
+typedef QList<EBookSignature> EBookSignatureList;
+
 /*!
  * \brief The interface for all EBookEdit plugins.
  */
@@ -29,6 +45,198 @@ public:
   virtual QString fileFilter() = 0;
   virtual QString fileDescription() = 0;
   virtual EBookDocumentType type() const = 0;
+
+  /*!
+   * \brief The signatures that identify the plugin's files by their
+   * content, any one of them matching is enough.
+   *
+   * Signatures must lie within the first EBookTypeSniffer::SNIFF_SIZE
+   * bytes of a file. Plugins that give none are only found by suffix.
+   */
+  virtual EBookSignatureList signatures() const
+  {
+    return EBookSignatureList();
+  }
+
+  /*!
+   * \brief Reads only the metadata of a book.
+   *
+   * This is used by library scanning, where only the title, creators and
+   * similar are needed, and must never read any chapter content. It may be
+   * called from worker threads so must not touch any document created by
+   * createDocument().
+   *
+   * \return the metadata, or a null Metadata if it could not be read.
+   */
+  virtual Metadata readMetadata(const QString& /*path*/) { return Metadata(); }
+
+  /*!
+   * \brief Reads the text of every chapter of a book for the search index.
+   *
+   * As with readMetadata() this may be called from worker threads. The
+   * chapter ids must stay the same when the book is saved again so that
+   * unchanged chapters are not indexed again.
+   *
+   * \return the chapters in reading order, or an empty list if the book
+   *         could not be read.
+   */
+  virtual EBookChapterList readChapters(const QString& /*path*/)
+  {
+    return EBookChapterList();
+  }
+
+  /*!
+   * \brief Plugins that can split opening a book into parseDocument() and
+   * createParsedDocument() return true, the rest are opened with
+   * createDocument().
+   */
+  virtual bool parsesInBackground() const { return false; }
+
+  /*!
+   * \brief Reads and parses a book ready for createParsedDocument().
+   *
+   * This does all of the work of createDocument() that does not need the
+   * gui thread and so is called from worker threads. The parsed book is not
+   * changed again until it is handed to createParsedDocument(), and is
+   * moved to thread before it is returned.
+   *
+   * \return the parsed book, owned by the caller, or nullptr if it could not
+   *         be read.
+   */
+  virtual QObject* parseDocument(const QString& /*path*/, QThread* /*thread*/)
+  {
+    return nullptr;
+  }
+
+  /*!
+   * \brief Builds the document of a book parsed by parseDocument(), on the
+   * gui thread. The document takes the parsed book.
+   */
+  virtual IEBookDocument* createParsedDocument(QObject* /*parsed*/)
+  {
+    return nullptr;
+  }
+
+  /*!
+   * \brief Reads only the cover image of a book, scaled to fit size.
+   *
+   * This is used to build the library shelf thumbnails and should read no
+   * more of the book than it must to find the cover. As with readMetadata()
+   * this may be called from worker threads.
+   *
+   * \return the cover, or a null QImage if the book has none.
+   */
+  virtual QImage readCover(const QString& /*path*/, const QSize& /*size*/)
+  {
+    return QImage();
+  }
+
+  /*!
+   * \brief Checks a book for damage without creating a document.
+   *
+   * This is used by the command line tool and, as with readMetadata(), may
+   * be called from worker threads.
+   *
+   * \return true if the book was checked and nothing was wrong. Any
+   *         problems found are appended to problems, plugins that cannot
+   *         check their books append none and return false.
+   */
+  virtual bool verifyBook(const QString& /*path*/, QStringList& /*problems*/)
+  {
+    return false;
+  }
+
+  /*!
+   * \brief Reads a book and writes it out again without creating a
+   * document, to save_path or over the book if save_path is empty.
+   *
+   * The written book is checked as verifyBook() would before it replaces
+   * anything, a book that does not verify is left as it was.
+   *
+   * As with verifyBook() this may be called from worker threads.
+   *
+   * \return true if the book was saved. Any problems found in the written
+   *         book are appended to problems, plugins that cannot save their
+   *         books append none and return false.
+   */
+  virtual bool resaveBook(const QString& /*path*/,
+                          const QString& /*save_path*/,
+                          QStringList& /*problems*/)
+  {
+    return false;
+  }
+
+  /*!
+   * \brief Reads the chapters, resources and metadata of a book into
+   * content, for EBookConverter.
+   *
+   * As with verifyBook() this may be called from worker threads.
+   *
+   * \return true if the book was read, plugins that cannot read their books
+   *         this way return false.
+   */
+  virtual bool readContent(const QString& /*path*/, EBookContent& /*content*/)
+  {
+    return false;
+  }
+
+  /*!
+   * \brief Writes content out as a book of the plugin's type at path.
+   *
+   * The chapters have been made well formed xhtml by
+   * EBookConverter::transform(). As with verifyBook() this may be called
+   * from worker threads.
+   *
+   * \return true if the book was written, plugins that cannot write their
+   *         books return false.
+   */
+  virtual bool writeContent(const EBookContent& /*content*/,
+                            const QString& /*path*/)
+  {
+    return false;
+  }
+
+  /*!
+   * \brief Compares two versions of a book file by file without creating
+   * documents.
+   *
+   * As with verifyBook() this may be called from worker threads.
+   *
+   * \return true if both books were read, with the files that differ in
+   *         comparison, plugins that cannot compare their books return
+   *         false.
+   */
+  virtual bool compareBooks(const QString& /*original*/,
+                            const QString& /*changed*/,
+                            EBookComparison& /*comparison*/)
+  {
+    return false;
+  }
+
+  /*!
+   * \brief Applies a metadata edit to a book, rewriting only its metadata
+   * in place where the format allows.
+   *
+   * This is used to correct many books at once and, as with verifyBook(),
+   * may be called from worker threads. The metadata after the edit is
+   * returned in metadata.
+   *
+   * \return true if the book was written or the edit changed nothing,
+   *         plugins that cannot write their metadata return false.
+   */
+  virtual bool writeMetadata(const QString& /*path*/,
+                             const EBookMetadataEdit& /*edit*/,
+                             Metadata& /*metadata*/)
+  {
+    return false;
+  }
+
+  /*!
+   * \brief Supplies the application options to the plugin.
+   *
+   * Plugins that have no configurable values can ignore this.
+   */
+  virtual void setOptions(Options* /*options*/) {}
 };
 #define IEBookInterface_iid "uk.org.smelecomp.IEBookInterface/0.1.0"
 Q_DECLARE_INTERFACE(IEBookInterface, IEBookInterface_iid)
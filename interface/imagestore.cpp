@@ -0,0 +1,143 @@
+#include "imagestore.h"
+
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QPixmapCache>
+#include <QSaveFile>
+
+#include <qlogger/qlogger.h>
+
+using namespace qlogger;
+
+const QString EBookImageStore::CACHE_PREFIX = "image_store:";
+
+EBookImageStore::EBookImageStore() {}
+
+QString
+EBookImageStore::directory() const
+{
+  return m_directory;
+}
+
+void
+EBookImageStore::setDirectory(const QString& directory)
+{
+  m_directory = directory;
+}
+
+/*!
+ * \brief Stores pixmap as a PNG.
+ *
+ * \return the hash of the image, or an empty string if it was not stored.
+ */
+QString
+EBookImageStore::insert(const QPixmap& pixmap)
+{
+  if (pixmap.isNull()) {
+    return QString();
+  }
+  QByteArray png;
+  QBuffer buffer(&png);
+  buffer.open(QIODevice::WriteOnly);
+  if (!pixmap.save(&buffer, "PNG")) {
+    return QString();
+  }
+  QString hash = insert(png);
+  if (!hash.isEmpty()) {
+    QPixmapCache::insert(CACHE_PREFIX + hash, pixmap);
+  }
+  return hash;
+}
+
+/*!
+ * \brief Stores PNG data, nothing is written if the same image is already
+ * held.
+ *
+ * Unlike the pixmap version this can be called from any thread.
+ *
+ * \return the hash of the image, or an empty string if it was not stored.
+ */
+QString
+EBookImageStore::insert(const QByteArray& png)
+{
+  if (png.isEmpty() || m_directory.isEmpty()) {
+    return QString();
+  }
+  QString hash = QString::fromLatin1(
+    QCryptographicHash::hash(png, QCryptographicHash::Sha1).toHex());
+  if (contains(hash)) {
+    return hash;
+  }
+
+  QString filename = path(hash);
+  QDir dir;
+  dir.mkpath(QFileInfo(filename).path());
+  QSaveFile file(filename);
+  if (!file.open(QIODevice::WriteOnly) || file.write(png) != png.size() ||
+      !file.commit()) {
+    QLOG_DEBUG(QString("Unable to store image %1").arg(filename));
+    return QString();
+  }
+  return hash;
+}
+
+bool
+EBookImageStore::contains(const QString& hash) const
+{
+  return (isHash(hash) && QFile::exists(path(hash)));
+}
+
+/*!
+ * \brief Returns the image with hash, reading it only if it is not already
+ * in the QPixmapCache.
+ *
+ * Pixmaps can only be used in the GUI thread.
+ */
+QPixmap
+EBookImageStore::pixmap(const QString& hash) const
+{
+  QPixmap pixmap;
+  if (!isHash(hash)) {
+    return pixmap;
+  }
+  QString key = CACHE_PREFIX + hash;
+  if (!QPixmapCache::find(key, &pixmap)) {
+    if (pixmap.load(path(hash), "PNG")) {
+      QPixmapCache::insert(key, pixmap);
+    }
+  }
+  return pixmap;
+}
+
+/*!
+ * \brief Returns true if value has the form of an image hash.
+ */
+bool
+EBookImageStore::isHash(const QString& value)
+{
+  if (value.size() != 40) {
+    return false;
+  }
+  foreach (QChar c, value) {
+    if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*!
+ * \brief The file holding the image with hash.
+ *
+ * The images are spread over subdirectories named by the first two
+ * characters of their hash, to keep the directories small.
+ */
+QString
+EBookImageStore::path(const QString& hash) const
+{
+  return m_directory + QDir::separator() + hash.left(2) + QDir::separator() +
+         hash + ".png";
+}
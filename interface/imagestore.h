@@ -0,0 +1,40 @@
+#ifndef IMAGESTORE_H
+#define IMAGESTORE_H
+
+#include <QByteArray>
+#include <QPixmap>
+#include <QString>
+
+/*!
+ * \brief A content addressed store of PNG images on disk.
+ *
+ * Each image is held once, in a file named by the SHA-1 hash of its PNG
+ * data, and is referred to elsewhere by that hash. Images are only read
+ * when pixmap() is called and are then kept in the QPixmapCache, so the
+ * memory used is bounded by the cache limit rather than by the number of
+ * images stored.
+ */
+class EBookImageStore
+{
+public:
+  EBookImageStore();
+
+  QString directory() const;
+  void setDirectory(const QString& directory);
+
+  QString insert(const QPixmap& pixmap);
+  QString insert(const QByteArray& png);
+  bool contains(const QString& hash) const;
+  QPixmap pixmap(const QString& hash) const;
+
+  static bool isHash(const QString& value);
+
+protected:
+  QString m_directory;
+
+  QString path(const QString& hash) const;
+
+  static const QString CACHE_PREFIX;
+};
+
+#endif // IMAGESTORE_H
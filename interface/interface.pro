@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui xml svg
+QT       += core gui xml svg sql
 
 TARGET = interface
 TEMPLATE = lib
@@ -33,6 +33,8 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 SOURCES +=  \
     ebookcommon.cpp \
+    ebooktoc.cpp \
+    ebookimagecache.cpp \
     options.cpp \
     marcrelator.cpp \
     dcterms.cpp \
@@ -41,7 +43,24 @@ SOURCES +=  \
     authors.cpp \
     ebookmetadata.cpp \
     ebookbasemetadata.cpp \
-    series.cpp
+    series.cpp \
+    database.cpp \
+    searchindex.cpp \
+    imagestore.cpp \
+    uidgenerator.cpp \
+    changejournal.cpp \
+    xhtmltokenizer.cpp \
+    xhtmldom.cpp \
+    wordtokenizer.cpp \
+    ebooktrace.cpp \
+    ebookstringpool.cpp \
+    ebooktextdecoder.cpp \
+    xhtmlcleaner.cpp \
+    ebookconverter.cpp \
+    ebookstatistics.cpp \
+    ebooktextdiff.cpp \
+    ebookblockindex.cpp \
+    ebooknameindex.cpp
 
 HEADERS += \
     interface_global.h \
@@ -49,8 +68,12 @@ HEADERS += \
     iplugininterface.h \
     iebookinterface.h \
     ebookcommon.h \
+    ebooktoc.h \
+    ebookimagecache.h \
+    ebookjobs.h \
     iebookdocument.h \
     options.h \
+    lookuptable.h \
     marcrelator.h \
     dcterms.h \
     foaf.h \
@@ -58,7 +81,27 @@ HEADERS += \
     authors.h \
     ebookmetadata.h \
     ebookbasemetadata.h \
-    series.h
+    series.h \
+    database.h \
+    searchindex.h \
+    imagestore.h \
+    uidgenerator.h \
+    changejournal.h \
+    xhtmltokenizer.h \
+    xhtmldom.h \
+    wordtokenizer.h \
+    ebooktrace.h \
+    ebookstringpool.h \
+    ebooktextdecoder.h \
+    ebookcontent.h \
+    ebookboundedqueue.h \
+    xhtmlcleaner.h \
+    ebookconverter.h \
+    ebookstatistics.h \
+    ebookcomparison.h \
+    ebooktextdiff.h \
+    ebookblockindex.h \
+    ebooknameindex.h
 
 DISTFILES += \
     spellinterface.json \
@@ -4,6 +4,7 @@
 #include <QtPlugin>
 
 #include "ebookcommon.h"
+#include "ebookjobs.h"
 #include "interface_global.h"
 
 /*!
@@ -26,6 +27,19 @@ public:
   virtual int minorVersion() const = 0;
   virtual int buildVersion() const = 0;
   virtual void buildMenu() = 0;
+
+  /*!
+   * \brief Runs work in the background, in the thread pool shared by the
+   * application and every plugin, see EBookJobs.
+   *
+   * Plugins should use this rather than starting threads of their own.
+   */
+  template<typename T>
+  QFuture<T> submitJob(typename EBookJob<T>::Work work,
+                       int priority = EBookJobs::NORMAL_PRIORITY)
+  {
+    return EBookJobs::submit<T>(work, priority);
+  }
 };
 #define IPluginInterface_iid "uk.org.smelecomp.IPluginInterface/0.1.0"
 Q_DECLARE_INTERFACE(IPluginInterface, IPluginInterface_iid)
@@ -1,11 +1,20 @@
 #ifndef SPELLINTERFACE_H
 #define SPELLINTERFACE_H
 
+#include <QHash>
+#include <QMap>
+#include <QMetaType>
 #include <QObject>
 
 #include "interface_global.h"
 #include "iplugininterface.h"
 
+class Options;
+
+// the words of a batch, true if the word is correct.
+typedef QHash<QString, bool> SpellResults;
+Q_DECLARE_METATYPE(SpellResults)
+
 struct CountryData {
   QString loc_code;
   QString country_name;
@@ -33,10 +42,55 @@ public:
 
   virtual void checkWord(QString word) = 0;
   virtual void checkWords(QStringList words) = 0;
+  /*!
+   * \brief Checks words in a given language, a BCP 47 tag as in xml:lang,
+   * rather than in that of the book.
+   */
+  virtual void checkWords(QStringList words, QString language) {
+    Q_UNUSED(language)
+    checkWords(words);
+  }
+  /*!
+   * \brief Sets the language of the book, normally from its dc:language.
+   */
+  virtual void setLanguage(QString language) { Q_UNUSED(language) }
+  /*!
+   * \brief Checks every word of a book.
+   *
+   * Unlike checkWords() the words may run to hundreds of thousands, and
+   * may repeat, so plugins are free to check them in parallel. The results
+   * arrive in the same way as those of checkWords().
+   */
+  virtual void checkBook(QStringList words) { checkWords(words); }
   virtual void addWordToBookList(QString word) = 0;
   virtual void addWordToAuthorList(QString word) = 0;
   virtual void addWordMatch(QString word, QString match) = 0;
+  /*!
+   * \brief Replace the word lists and matches, with those kept in the
+   * library for the book being checked and its authors.
+   */
+  virtual void setBookList(QStringList words) { Q_UNUSED(words) }
+  virtual void setAuthorList(QStringList words) { Q_UNUSED(words) }
+  virtual void setWordMatches(QMap<QString, QString> matches) {
+    Q_UNUSED(matches)
+  }
   virtual void suggestions(QString word) = 0;
+  /*!
+   * \brief Drops any suggestions that have been asked for but not yet sent,
+   * for example when the menu that wanted them is closed.
+   */
+  virtual void cancelSuggestions() {}
+  /*!
+   * \brief Checks the grammar of whole sentences, plugins that can only
+   * check words ignore them.
+   */
+  virtual void checkSentences(QStringList sentences) { Q_UNUSED(sentences) }
+  /*!
+   * \brief Sets a checker on this machine, for plugins that hand the words
+   * to it while their own checks are under way.
+   */
+  virtual void setLocalChecker(ISpellInterface *checker) { Q_UNUSED(checker) }
+  virtual void setOptions(Options *options) { Q_UNUSED(options) }
 };
 #define SpellInterface_iid "uk.org.smelecomp.SpellInterface/0.1.0"
 Q_DECLARE_INTERFACE(ISpellInterface, SpellInterface_iid)
@@ -1,6 +1,10 @@
 #include "library.h"
 
-quint64 EBookData::m_highest_uid = 0;
+#include <algorithm>
+
+#include "database.h"
+
+EBookUidGenerator EBookData::m_uids;
 
 EBookLibraryDB::EBookLibraryDB(SeriesDB series_db)
   : m_series_db(series_db)
@@ -9,84 +13,359 @@ EBookLibraryDB::EBookLibraryDB(SeriesDB series_db)
 
 EBookLibraryDB::~EBookLibraryDB()
 {
-  saveLibrary();
+  save();
 }
 
 void
 EBookLibraryDB::setFilename(QString filename)
 {
   m_filename = filename;
+  m_journal.setFilename(filename);
 }
 
 bool
 EBookLibraryDB::save()
 {
+  QWriteLocker locker(&m_lock);
+  if (m_database) {
+    m_dirty.clear();
+    m_removed.clear();
+    m_modified = false;
+    return m_database->commit();
+  }
   return saveLibrary();
 }
 
+/*!
+ * \brief Loads the library from the database if one is set, otherwise from
+ * the yaml file.
+ *
+ * The first time an empty database is used the yaml file is read and copied
+ * into it.
+ */
 bool
 EBookLibraryDB::load(QString filename)
 {
   setFilename(filename);
+  QWriteLocker locker(&m_lock);
+  if (m_database) {
+    if (m_database->isEmpty("books") && QFile::exists(m_filename)) {
+      bool result = loadLibrary();
+      importIntoDatabase();
+      return result;
+    }
+    return loadDatabase();
+  }
   return loadLibrary();
 }
 
+/*!
+ * \brief Stores the books in database rather than the yaml file.
+ *
+ * Must be set before load() is called.
+ */
+void
+EBookLibraryDB::setDatabase(Database database)
+{
+  m_database = database;
+}
+
+/*!
+ * \brief Adds a book to the library, or replaces the book with the same uid.
+ *
+ * The library stores a copy of book_data, so later changes to it are not
+ * seen until it is passed in again.
+ *
+ * \return the uid of the book, which is allocated if it was 0.
+ */
 quint64
 EBookLibraryDB::insertOrUpdateBook(BookData book_data)
 {
   if (book_data->uid == 0) { // should already be set.
-    book_data->uid = ++EBookData::m_highest_uid;
-  }
-  if (m_book_data.contains(book_data->uid) && book_data->modified) {
-    BookData existing_book_data = m_book_data.value(book_data->uid);
-    existing_book_data->uid = book_data->uid;
-    existing_book_data->filename = book_data->filename;
-    existing_book_data->title = book_data->title;
-    existing_book_data->series = book_data->series;
-    existing_book_data->series_index = book_data->series_index;
-    existing_book_data->current_spine_index = book_data->current_spine_index;
-    existing_book_data->current_spine_lineno = book_data->current_spine_lineno;
-  } else {
-    m_book_data.insert(book_data->uid, book_data);
-    m_book_by_title.insertMulti(book_data->title.toLower(), book_data);
-    m_book_by_file.insert(book_data->filename, book_data);
+    book_data->uid = EBookData::nextUid();
+  }
+  BookData stored = BookData(new EBookData(*book_data));
+  bool existing;
+  {
+    QWriteLocker locker(&m_lock);
+    existing = m_book_data.contains(stored->uid);
+    if (existing) {
+      // the title and file may have changed so the indexes are rebuilt.
+      removeFromIndexes(m_book_data.value(stored->uid));
+    }
+    m_book_data.insert(stored->uid, stored);
+    addToIndexes(stored);
+    m_dirty.insert(stored->uid);
+    m_removed.remove(stored->uid);
     m_modified = true;
+    if (m_database) {
+      writeBook(stored);
+    }
+  }
+  // signalled outside the lock, receivers will read the library.
+  if (existing) {
+    emit bookChanged(stored->uid);
+  } else {
+    emit bookAdded(stored->uid);
+  }
+  return stored->uid;
+}
+
+/*!
+ * \brief Stores the content hash of a book.
+ *
+ * Unlike insertOrUpdateBook() no signal is emitted, nothing that is shown
+ * of the book has changed.
+ */
+void
+EBookLibraryDB::setContentHash(quint64 uid, const QString& hash)
+{
+  QWriteLocker locker(&m_lock);
+  BookData book = m_book_data.value(uid);
+  if (book.isNull() || book->content_hash == hash) {
+    return;
+  }
+  // books that have been handed out are never changed.
+  BookData stored = BookData(new EBookData(*book));
+  stored->content_hash = hash;
+  removeFromIndexes(book);
+  m_book_data.insert(uid, stored);
+  addToIndexes(stored);
+  m_dirty.insert(uid);
+  m_modified = true;
+  if (m_database) {
+    writeBook(stored);
+  }
+}
+
+/*!
+ * \brief Stores the spell checker word list and word matches of a book.
+ *
+ * As with setContentHash() no signal is emitted.
+ */
+void
+EBookLibraryDB::setWordLists(quint64 uid,
+                             const QStringList& book_words,
+                             const QMap<QString, QString>& word_matches)
+{
+  QWriteLocker locker(&m_lock);
+  BookData book = m_book_data.value(uid);
+  if (book.isNull() ||
+      (book->book_words == book_words && book->word_matches == word_matches)) {
+    return;
+  }
+  BookData stored = BookData(new EBookData(*book));
+  stored->book_words = book_words;
+  stored->word_matches = word_matches;
+  removeFromIndexes(book);
+  m_book_data.insert(uid, stored);
+  addToIndexes(stored);
+  m_dirty.insert(uid);
+  m_modified = true;
+  if (m_database) {
+    writeBook(stored);
+  }
+}
+
+/*!
+ * \brief Stores the statistics of a book.
+ *
+ * As with setContentHash() no signal is emitted.
+ */
+void
+EBookLibraryDB::setStatistics(quint64 uid, const EBookStatistics& statistics)
+{
+  QWriteLocker locker(&m_lock);
+  BookData book = m_book_data.value(uid);
+  if (book.isNull() || book->statistics == statistics) {
+    return;
+  }
+  BookData stored = BookData(new EBookData(*book));
+  stored->statistics = statistics;
+  removeFromIndexes(book);
+  m_book_data.insert(uid, stored);
+  addToIndexes(stored);
+  m_dirty.insert(uid);
+  m_modified = true;
+  if (m_database) {
+    writeBook(stored);
+  }
+}
+
+/*!
+ * \brief Stores the chapter and block a book was left at along with the
+ * block index of its chapters.
+ *
+ * As with setContentHash() no signal is emitted.
+ */
+void
+EBookLibraryDB::setPosition(quint64 uid,
+                            int spine_index,
+                            int lineno,
+                            const EBookBlockIndex& block_index)
+{
+  QWriteLocker locker(&m_lock);
+  BookData book = m_book_data.value(uid);
+  if (book.isNull() || (book->current_spine_index == spine_index &&
+                        book->current_spine_lineno == lineno &&
+                        book->block_index == block_index)) {
+    return;
+  }
+  BookData stored = BookData(new EBookData(*book));
+  stored->current_spine_index = spine_index;
+  stored->current_spine_lineno = lineno;
+  stored->block_index = block_index;
+  removeFromIndexes(book);
+  m_book_data.insert(uid, stored);
+  addToIndexes(stored);
+  m_dirty.insert(uid);
+  m_modified = true;
+  if (m_database) {
+    writeBook(stored);
   }
-  return book_data->uid;
 }
 
 bool
 EBookLibraryDB::removeBook(quint64 index)
 {
-  if (m_book_data.contains(index)) {
-    BookData book = m_book_data.value(index);
-    m_book_data.remove(index);
-    m_book_by_title.remove(book->title.toLower(), book);
-    m_book_by_file.remove(book->filename, book);
+  {
+    QWriteLocker locker(&m_lock);
+    if (!m_book_data.contains(index)) {
+      return false;
+    }
+    BookData book = m_book_data.take(index);
+    removeFromIndexes(book);
+    m_dirty.remove(index);
+    m_removed.insert(index);
     m_modified = true;
-    return true;
+    if (m_database) {
+      QSqlQuery query = m_database->prepare("DELETE FROM books WHERE uid = ?");
+      query.addBindValue(index);
+      m_database->exec(query);
+      QSqlQuery file_query =
+        m_database->prepare("DELETE FROM book_files WHERE book = ?");
+      file_query.addBindValue(index);
+      m_database->exec(file_query);
+      QSqlQuery words_query =
+        m_database->prepare("DELETE FROM book_words WHERE book = ?");
+      words_query.addBindValue(index);
+      m_database->exec(words_query);
+      QSqlQuery statistics_query =
+        m_database->prepare("DELETE FROM book_statistics WHERE book = ?");
+      statistics_query.addBindValue(index);
+      m_database->exec(statistics_query);
+      QSqlQuery block_query =
+        m_database->prepare("DELETE FROM book_block_index WHERE book = ?");
+      block_query.addBindValue(index);
+      m_database->exec(block_query);
+    }
   }
-  return false;
+  emit bookRemoved(index);
+  return true;
 }
 
 BookData
 EBookLibraryDB::bookByUid(quint64 uid)
 {
+  QReadLocker locker(&m_lock);
   return m_book_data.value(uid);
 }
 
 BookList
 EBookLibraryDB::bookByTitle(QString title)
 {
+  QReadLocker locker(&m_lock);
   return m_book_by_title.values(title.toLower());
 }
 
 BookData
 EBookLibraryDB::bookByFile(QString filename)
 {
+  QReadLocker locker(&m_lock);
   return m_book_by_file.value(filename);
 }
 
+BookList
+EBookLibraryDB::books()
+{
+  QReadLocker locker(&m_lock);
+  return m_book_data.values();
+}
+
+/*!
+ * \brief Finds the books whose titles contain fragment, ignoring case.
+ *
+ * Fragments of three or more characters are looked up in the trigram
+ * index, each candidate is then checked against the whole fragment.
+ * Shorter fragments only match the start of a title.
+ *
+ * \return at most limit books, sorted by title.
+ */
+BookList
+EBookLibraryDB::searchTitles(QString fragment, int limit)
+{
+  BookList books;
+  QString lower = fragment.toLower();
+  if (lower.isEmpty() || limit <= 0) {
+    return books;
+  }
+  QReadLocker locker(&m_lock);
+
+  if (lower.size() < 3) {
+    BookByString::const_iterator it = m_book_by_title.lowerBound(lower);
+    for (; it != m_book_by_title.constEnd() && books.size() < limit; ++it) {
+      if (!it.key().startsWith(lower)) {
+        break;
+      }
+      books.append(it.value());
+    }
+    return books;
+  }
+
+  // the rarest trigram gives the candidates, the rest must contain them.
+  QList<const TitleIndexEntry*> entries;
+  foreach (quint64 trigram, trigrams(lower)) {
+    TitleIndex::const_iterator it = m_title_index.constFind(trigram);
+    if (it == m_title_index.constEnd()) {
+      return books;
+    }
+    entries.append(&it.value());
+  }
+  std::sort(entries.begin(),
+            entries.end(),
+            [](const TitleIndexEntry* first, const TitleIndexEntry* second) {
+              return first->size() < second->size();
+            });
+
+  foreach (quint64 uid, *entries.first()) {
+    bool found = true;
+    for (int i = 1; i < entries.size(); i++) {
+      const TitleIndexEntry* entry = entries.at(i);
+      if (!std::binary_search(entry->begin(), entry->end(), uid)) {
+        found = false;
+        break;
+      }
+    }
+    if (!found) {
+      continue;
+    }
+    BookData book = m_book_data.value(uid);
+    if (book && book->title.toLower().contains(lower)) {
+      books.append(book);
+      if (books.size() >= limit) {
+        break;
+      }
+    }
+  }
+  std::sort(books.begin(),
+            books.end(),
+            [](const BookData& first, const BookData& second) {
+              return first->title.compare(second->title, Qt::CaseInsensitive) <
+                     0;
+            });
+  return books;
+}
+
 bool
 EBookLibraryDB::isModified()
 {
@@ -99,6 +378,67 @@ EBookLibraryDB::setModified(bool modified)
   m_modified = modified;
 }
 
+void
+EBookLibraryDB::addToIndexes(BookData book_data)
+{
+  QString title = book_data->title.toLower();
+  m_book_by_title.insert(title, book_data);
+  m_book_by_file.insert(book_data->filename, book_data);
+  m_indexed_keys.insert(book_data->uid, qMakePair(title, book_data->filename));
+  foreach (quint64 trigram, trigrams(title)) {
+    TitleIndexEntry& uids = m_title_index[trigram];
+    TitleIndexEntry::iterator it =
+      std::lower_bound(uids.begin(), uids.end(), book_data->uid);
+    if (it == uids.end() || *it != book_data->uid) {
+      uids.insert(it, book_data->uid);
+    }
+  }
+}
+
+void
+EBookLibraryDB::removeFromIndexes(BookData book_data)
+{
+  if (!m_indexed_keys.contains(book_data->uid)) {
+    return;
+  }
+  QPair<QString, QString> keys = m_indexed_keys.take(book_data->uid);
+  QString title = keys.first;
+  m_book_by_title.remove(title, book_data);
+  m_book_by_file.remove(keys.second, book_data);
+  foreach (quint64 trigram, trigrams(title)) {
+    TitleIndex::iterator index_it = m_title_index.find(trigram);
+    if (index_it == m_title_index.end()) {
+      continue;
+    }
+    TitleIndexEntry& uids = index_it.value();
+    TitleIndexEntry::iterator it =
+      std::lower_bound(uids.begin(), uids.end(), book_data->uid);
+    if (it != uids.end() && *it == book_data->uid) {
+      uids.erase(it);
+    }
+    if (uids.isEmpty()) {
+      m_title_index.erase(index_it);
+    }
+  }
+}
+
+/*!
+ * \brief The distinct three character sequences of text, each packed into a
+ * single key.
+ */
+QSet<quint64>
+EBookLibraryDB::trigrams(const QString& text)
+{
+  QSet<quint64> result;
+  for (int i = 0; i + 3 <= text.size(); i++) {
+    quint64 trigram = (quint64(text.at(i).unicode()) << 32) |
+                      (quint64(text.at(i + 1).unicode()) << 16) |
+                      quint64(text.at(i + 2).unicode());
+    result.insert(trigram);
+  }
+  return result;
+}
+
 bool
 EBookLibraryDB::loadLibrary()
 {
@@ -107,85 +447,411 @@ EBookLibraryDB::loadLibrary()
   }
 
   QFile file(m_filename);
-  if (file.exists()) {
+  bool exists = file.exists();
+  if (exists) {
     YAML::Node library_node = YAML::LoadFile(file);
     if (library_node.IsMap()) {
       for (YAML::const_iterator it = library_node.begin();
            it != library_node.end();
            ++it) {
-        BookData book = BookData(new EBookData());
-        book->uid = it->first.as<quint64>();
-
-        YAML::Node book_node = it->second;
-        book->title = book_node["title"].as<QString>();
-        book->filename = book_node["filename"].as<QString>();
-        book->series = book_node["series uid"].as<quint64>();
-        book->series_index = book_node["series index"].as<QString>();
-        book->current_spine_index = book_node["spine index"].as<int>();
-        book->current_spine_lineno = book_node["spine lineno"].as<int>();
-
-        EBookData::m_highest_uid =
-          (book->uid > EBookData::m_highest_uid ? book->uid
-                                                : EBookData::m_highest_uid);
-
+        BookData book = parseBook(it->first.as<quint64>(), it->second);
+        EBookData::m_uids.reserve(book->uid);
         m_book_data.insert(book->uid, book);
-        m_book_by_title.insert(book->title.toLower(), book);
-        m_book_by_file.insert(book->filename, book);
+        addToIndexes(book);
       }
     }
-    m_modified = false;
-    return true;
   }
 
-  return false;
+  // the changes saved since the file was last written.
+  std::vector<YAML::Node> changes = m_journal.read();
+  for (const YAML::Node& change : changes) {
+    if (!change.IsMap()) {
+      continue;
+    }
+    for (YAML::const_iterator it = change.begin(); it != change.end(); ++it) {
+      quint64 uid = it->first.as<quint64>();
+      if (m_book_data.contains(uid)) {
+        removeFromIndexes(m_book_data.take(uid));
+      }
+      if (it->second.IsNull()) { // removed
+        continue;
+      }
+      BookData book = parseBook(uid, it->second);
+      EBookData::m_uids.reserve(uid);
+      m_book_data.insert(uid, book);
+      addToIndexes(book);
+    }
+  }
+  m_dirty.clear();
+  m_removed.clear();
+  m_modified = false;
+  return (exists || !changes.empty());
 }
 
+/*!
+ * \brief Saves the books changed since the last save.
+ *
+ * Only the changed and removed books are appended to the journal, the
+ * whole file is written if it does not yet exist or once the journal has
+ * grown large enough to be worth folding back into it.
+ */
 bool
 EBookLibraryDB::saveLibrary()
 {
-  if (m_filename.isEmpty())
+  if (m_filename.isEmpty() || !m_modified) {
     return false;
+  }
+  bool result;
+  if (!QFile::exists(m_filename) || m_journal.needsCompaction() ||
+      (m_dirty.isEmpty() && m_removed.isEmpty())) {
+    result = writeLibraryFile();
+    if (result) {
+      m_journal.clear();
+    }
+  } else {
+    YAML::Emitter emitter;
+    emitter << YAML::BeginMap;
+    foreach (quint64 uid, m_dirty) {
+      BookData book_data = m_book_data.value(uid);
+      if (book_data) {
+        emitter << YAML::Key << uid;
+        emitter << YAML::Value;
+        emitBook(emitter, book_data);
+      }
+    }
+    foreach (quint64 uid, m_removed) {
+      emitter << YAML::Key << uid;
+      emitter << YAML::Value << YAML::Null;
+    }
+    emitter << YAML::EndMap;
+    result = m_journal.append(QString::fromUtf8(emitter.c_str()));
+  }
+  if (result) {
+    m_dirty.clear();
+    m_removed.clear();
+    m_modified = false;
+  }
+  return result;
+}
 
+/*!
+ * \brief Writes every book to the yaml file.
+ */
+bool
+EBookLibraryDB::writeLibraryFile()
+{
   QFile file(m_filename);
-  if (m_modified) {
-    if (file.open((QFile::ReadWrite | QFile::Truncate))) {
-      YAML::Emitter emitter;
-      emitter << YAML::Comment(
-        QString("A YAML File is supposed to be user readable/editable but\n"
-                "you need to be careful when manually editing.\n"
-                "Remember that the uid numbers stand for unique identifier\n"
-                "so if you edit these MAKE SURE THAT THEY ARE UNIQUE. If\n"
-                "you repeat one the second will overwrite the first."));
-
-      emitter << YAML::BeginMap; // books map
-      {
-        foreach (BookData book_data, m_book_data) {
-          emitter << YAML::Key << book_data->uid;
-          emitter << YAML::Value;
-          emitter << YAML::BeginMap;
-          emitter << YAML::Key << "title";
-          emitter << YAML::Value << book_data->title;
-          emitter << YAML::Key << "filename";
-          emitter << YAML::Value << book_data->filename;
-          emitter << YAML::Key << "series uid";
-          emitter << YAML::Value << book_data->series;
-          emitter << YAML::Key << "series index";
-          emitter << YAML::Value << book_data->series_index;
-          emitter << YAML::Key << "spine index";
-          emitter << YAML::Value << book_data->current_spine_index;
-          emitter << YAML::Key << "spine lineno";
-          emitter << YAML::Value << book_data->current_spine_lineno;
-          emitter << YAML::EndMap; // individual book map
+  if (!file.open((QFile::ReadWrite | QFile::Truncate))) {
+    return false;
+  }
+  YAML::Emitter emitter;
+  emitter << YAML::Comment(
+    QString("A YAML File is supposed to be user readable/editable but\n"
+            "you need to be careful when manually editing.\n"
+            "Remember that the uid numbers stand for unique identifier\n"
+            "so if you edit these MAKE SURE THAT THEY ARE UNIQUE. If\n"
+            "you repeat one the second will overwrite the first.\n"
+            "Recent changes may be in the .journal file beside this one."));
+
+  emitter << YAML::BeginMap; // books map
+  {
+    foreach (BookData book_data, m_book_data) {
+      emitter << YAML::Key << book_data->uid;
+      emitter << YAML::Value;
+      emitBook(emitter, book_data);
+    }
+  }
+  emitter << YAML::EndMap; // end books map
+
+  QTextStream out(&file);
+  out << emitter.c_str();
+  return true;
+}
+
+BookData
+EBookLibraryDB::parseBook(quint64 uid, const YAML::Node& book_node)
+{
+  BookData book = BookData(new EBookData());
+  book->uid = uid;
+  book->title = book_node["title"].as<QString>();
+  book->filename = book_node["filename"].as<QString>();
+  book->series = book_node["series uid"].as<quint64>();
+  book->series_index = book_node["series index"].as<QString>();
+  book->current_spine_index = book_node["spine index"].as<int>();
+  book->current_spine_lineno = book_node["spine lineno"].as<int>();
+  if (book_node["file size"]) {
+    book->file_size = book_node["file size"].as<qint64>();
+  }
+  if (book_node["file modified"]) {
+    book->file_modified = book_node["file modified"].as<qint64>();
+  }
+  if (book_node["content hash"]) {
+    book->content_hash = book_node["content hash"].as<QString>();
+  }
+  YAML::Node words_node = book_node["book words"];
+  if (words_node && words_node.IsSequence()) {
+    for (YAML::const_iterator it = words_node.begin(); it != words_node.end();
+         ++it) {
+      book->book_words << it->as<QString>();
+    }
+  }
+  YAML::Node matches_node = book_node["word matches"];
+  if (matches_node && matches_node.IsMap()) {
+    for (YAML::const_iterator it = matches_node.begin();
+         it != matches_node.end();
+         ++it) {
+      book->word_matches.insert(it->first.as<QString>(),
+                                it->second.as<QString>());
+    }
+  }
+  YAML::Node statistics_node = book_node["statistics"];
+  if (statistics_node && statistics_node.IsMap()) {
+    book->statistics.words = statistics_node["words"].as<qint64>();
+    book->statistics.characters = statistics_node["characters"].as<qint64>();
+    book->statistics.unique_words = statistics_node["unique words"].as<int>();
+    book->statistics.chapters = statistics_node["chapters"].as<int>();
+  }
+  if (book_node["block index"]) {
+    book->block_index = EBookBlockIndex::fromByteArray(QByteArray::fromBase64(
+      book_node["block index"].as<QString>().toLatin1()));
+  }
+  return book;
+}
+
+void
+EBookLibraryDB::emitBook(YAML::Emitter& emitter, BookData book_data)
+{
+  emitter << YAML::BeginMap;
+  emitter << YAML::Key << "title";
+  emitter << YAML::Value << book_data->title;
+  emitter << YAML::Key << "filename";
+  emitter << YAML::Value << book_data->filename;
+  emitter << YAML::Key << "series uid";
+  emitter << YAML::Value << book_data->series;
+  emitter << YAML::Key << "series index";
+  emitter << YAML::Value << book_data->series_index;
+  emitter << YAML::Key << "spine index";
+  emitter << YAML::Value << book_data->current_spine_index;
+  emitter << YAML::Key << "spine lineno";
+  emitter << YAML::Value << book_data->current_spine_lineno;
+  if (book_data->file_modified != 0) {
+    emitter << YAML::Key << "file size";
+    emitter << YAML::Value << book_data->file_size;
+    emitter << YAML::Key << "file modified";
+    emitter << YAML::Value << book_data->file_modified;
+  }
+  if (!book_data->content_hash.isEmpty()) {
+    emitter << YAML::Key << "content hash";
+    emitter << YAML::Value << book_data->content_hash;
+  }
+  if (!book_data->book_words.isEmpty()) {
+    emitter << YAML::Key << "book words";
+    emitter << YAML::Value << YAML::Flow << YAML::BeginSeq;
+    foreach (QString word, book_data->book_words) {
+      emitter << word;
+    }
+    emitter << YAML::EndSeq;
+  }
+  if (!book_data->word_matches.isEmpty()) {
+    emitter << YAML::Key << "word matches";
+    emitter << YAML::Value << YAML::BeginMap;
+    for (QMap<QString, QString>::const_iterator it =
+           book_data->word_matches.constBegin();
+         it != book_data->word_matches.constEnd();
+         ++it) {
+      emitter << YAML::Key << it.key();
+      emitter << YAML::Value << it.value();
+    }
+    emitter << YAML::EndMap;
+  }
+  if (!book_data->statistics.isEmpty()) {
+    emitter << YAML::Key << "statistics";
+    emitter << YAML::Value << YAML::Flow << YAML::BeginMap;
+    emitter << YAML::Key << "words";
+    emitter << YAML::Value << book_data->statistics.words;
+    emitter << YAML::Key << "characters";
+    emitter << YAML::Value << book_data->statistics.characters;
+    emitter << YAML::Key << "unique words";
+    emitter << YAML::Value << book_data->statistics.unique_words;
+    emitter << YAML::Key << "chapters";
+    emitter << YAML::Value << book_data->statistics.chapters;
+    emitter << YAML::EndMap;
+  }
+  if (!book_data->block_index.isEmpty()) {
+    emitter << YAML::Key << "block index";
+    emitter << YAML::Value
+            << QString(book_data->block_index.toByteArray().toBase64());
+  }
+  emitter << YAML::EndMap; // individual book map
+}
+
+bool
+EBookLibraryDB::loadDatabase()
+{
+  QSqlQuery query = m_database->prepare(
+    "SELECT uid, title, filename, series, series_index, spine_index, "
+    "spine_lineno FROM books");
+  if (!query.exec()) {
+    return false;
+  }
+  while (query.next()) {
+    BookData book = BookData(new EBookData());
+    book->uid = query.value(0).toULongLong();
+    book->title = query.value(1).toString();
+    book->filename = query.value(2).toString();
+    book->series = query.value(3).toULongLong();
+    book->series_index = query.value(4).toString();
+    book->current_spine_index = query.value(5).toInt();
+    book->current_spine_lineno = query.value(6).toInt();
+
+    EBookData::m_uids.reserve(book->uid);
+
+    m_book_data.insert(book->uid, book);
+    addToIndexes(book);
+  }
+
+  QSqlQuery file_query =
+    m_database->prepare("SELECT book, size, modified, content_hash FROM book_files");
+  if (file_query.exec()) {
+    while (file_query.next()) {
+      BookData book = m_book_data.value(file_query.value(0).toULongLong());
+      if (book) {
+        book->file_size = file_query.value(1).toLongLong();
+        book->file_modified = file_query.value(2).toLongLong();
+        book->content_hash = file_query.value(3).toString();
+      }
+    }
+  }
+
+  QSqlQuery words_query =
+    m_database->prepare("SELECT book, word, match FROM book_words");
+  if (words_query.exec()) {
+    while (words_query.next()) {
+      BookData book = m_book_data.value(words_query.value(0).toULongLong());
+      if (book) {
+        QString word = words_query.value(1).toString();
+        QString match = words_query.value(2).toString();
+        if (match.isEmpty()) {
+          book->book_words << word;
+        } else {
+          book->word_matches.insert(word, match);
         }
       }
-      emitter << YAML::EndMap; // end books map
+    }
+  }
 
-      QTextStream out(&file);
-      out << emitter.c_str();
+  QSqlQuery statistics_query = m_database->prepare(
+    "SELECT book, words, characters, unique_words, chapters "
+    "FROM book_statistics");
+  if (statistics_query.exec()) {
+    while (statistics_query.next()) {
+      BookData book =
+        m_book_data.value(statistics_query.value(0).toULongLong());
+      if (book) {
+        book->statistics.words = statistics_query.value(1).toLongLong();
+        book->statistics.characters = statistics_query.value(2).toLongLong();
+        book->statistics.unique_words = statistics_query.value(3).toInt();
+        book->statistics.chapters = statistics_query.value(4).toInt();
+      }
     }
+  }
 
-    return true;
+  QSqlQuery block_query =
+    m_database->prepare("SELECT book, data FROM book_block_index");
+  if (block_query.exec()) {
+    while (block_query.next()) {
+      BookData book = m_book_data.value(block_query.value(0).toULongLong());
+      if (book) {
+        book->block_index =
+          EBookBlockIndex::fromByteArray(block_query.value(1).toByteArray());
+      }
+    }
   }
-  return false;
+  m_modified = false;
+  return true;
+}
 
-} // library changed
+/*!
+ * \brief Copies the books read from the yaml file into the database.
+ */
+void
+EBookLibraryDB::importIntoDatabase()
+{
+  foreach (BookData book_data, m_book_data) {
+    writeBook(book_data);
+  }
+  m_database->commit();
+  m_modified = false;
+}
+
+void
+EBookLibraryDB::writeBook(BookData book_data)
+{
+  QSqlQuery query = m_database->prepare(
+    "INSERT OR REPLACE INTO books (uid, title, title_lower, filename, series, "
+    "series_index, spine_index, spine_lineno) VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
+  query.addBindValue(book_data->uid);
+  query.addBindValue(book_data->title);
+  query.addBindValue(book_data->title.toLower());
+  query.addBindValue(book_data->filename);
+  query.addBindValue(book_data->series);
+  query.addBindValue(book_data->series_index);
+  query.addBindValue(book_data->current_spine_index);
+  query.addBindValue(book_data->current_spine_lineno);
+  m_database->exec(query);
+
+  if (book_data->file_modified != 0 || !book_data->content_hash.isEmpty()) {
+    QSqlQuery file_query =
+      m_database->prepare("INSERT OR REPLACE INTO book_files (book, size, "
+                          "modified, content_hash) VALUES (?, ?, ?, ?)");
+    file_query.addBindValue(book_data->uid);
+    file_query.addBindValue(book_data->file_size);
+    file_query.addBindValue(book_data->file_modified);
+    file_query.addBindValue(book_data->content_hash);
+    m_database->exec(file_query);
+  }
+
+  QSqlQuery delete_query =
+    m_database->prepare("DELETE FROM book_words WHERE book = ?");
+  delete_query.addBindValue(book_data->uid);
+  m_database->exec(delete_query);
+  foreach (QString word, book_data->book_words) {
+    QSqlQuery words_query = m_database->prepare(
+      "INSERT OR REPLACE INTO book_words (book, word, match) VALUES (?, ?, ?)");
+    words_query.addBindValue(book_data->uid);
+    words_query.addBindValue(word);
+    words_query.addBindValue(QString(""));
+    m_database->exec(words_query);
+  }
+  for (QMap<QString, QString>::const_iterator it =
+         book_data->word_matches.constBegin();
+       it != book_data->word_matches.constEnd();
+       ++it) {
+    QSqlQuery words_query = m_database->prepare(
+      "INSERT OR REPLACE INTO book_words (book, word, match) VALUES (?, ?, ?)");
+    words_query.addBindValue(book_data->uid);
+    words_query.addBindValue(it.key());
+    words_query.addBindValue(it.value());
+    m_database->exec(words_query);
+  }
+
+  if (!book_data->statistics.isEmpty()) {
+    QSqlQuery statistics_query = m_database->prepare(
+      "INSERT OR REPLACE INTO book_statistics (book, words, characters, "
+      "unique_words, chapters) VALUES (?, ?, ?, ?, ?)");
+    statistics_query.addBindValue(book_data->uid);
+    statistics_query.addBindValue(book_data->statistics.words);
+    statistics_query.addBindValue(book_data->statistics.characters);
+    statistics_query.addBindValue(book_data->statistics.unique_words);
+    statistics_query.addBindValue(book_data->statistics.chapters);
+    m_database->exec(statistics_query);
+  }
+
+  if (!book_data->block_index.isEmpty()) {
+    QSqlQuery block_query = m_database->prepare(
+      "INSERT OR REPLACE INTO book_block_index (book, data) VALUES (?, ?)");
+    block_query.addBindValue(book_data->uid);
+    block_query.addBindValue(book_data->block_index.toByteArray());
+    m_database->exec(block_query);
+  }
+}
@@ -2,18 +2,32 @@
 #define LIBARAY_H
 
 #include <QFile>
+#include <QHash>
+#include <QMap>
 #include <QObject>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QStringList>
 #include <QTextStream>
+#include <QVector>
 
 #include <qyaml-cpp/QYamlCpp>
 
+#include "changejournal.h"
+#include "ebookblockindex.h"
+#include "ebookstatistics.h"
 #include "series.h"
+#include "uidgenerator.h"
 
 struct EBookData
 {
   EBookData()
     : uid(0)
     , series(0)
+    , current_spine_index(0)
+    , current_spine_lineno(0)
+    , file_size(0)
+    , file_modified(0)
     , modified(false)
   {}
   quint64 uid;
@@ -21,18 +35,45 @@ struct EBookData
   QString title;
   quint64 series;
   QString series_index;
+  // the chapter and block the book was left at, and where the blocks of
+  // the chapters start, so the block is found again without a walk.
   int current_spine_index;
   int current_spine_lineno;
+  EBookBlockIndex block_index;
+  // the size and modification time in ms of the file when its metadata
+  // was last read, a difference means the file has been changed since.
+  qint64 file_size;
+  qint64 file_modified;
+  // a hash of the book contents, used to find the same book imported more
+  // than once. Empty until it has been worked out for the current file.
+  QString content_hash;
+  // the words that are correct in this book alone, invented names for
+  // example, and the corrections of common mistakes, for the spell checker.
+  QStringList book_words;
+  QMap<QString, QString> word_matches;
+  // the size of the book when it was last open, empty if it never has been.
+  EBookStatistics statistics;
   bool modified;
 
-  static quint64 m_highest_uid;
-  static quint64 nextUid() { return ++m_highest_uid; }
+  static EBookUidGenerator m_uids;
+  static quint64 nextUid() { return m_uids.next(); }
 };
 typedef QSharedPointer<EBookData> BookData;
 typedef QList<BookData> BookList;
 typedef QMap<quint64, BookData> BookMap;
 typedef QMultiMap<QString, BookData> BookByString;
-
+// the sorted uids of the books whose titles contain a trigram.
+typedef QVector<quint64> TitleIndexEntry;
+typedef QHash<quint64, TitleIndexEntry> TitleIndex;
+
+/*!
+ * \brief The books of the library.
+ *
+ * Any thread may read the library, only the thread that owns the database
+ * may change it. insertOrUpdateBook() stores its own copy of the book, so
+ * a BookData handed out is never changed by the library and can be read
+ * without any lock.
+ */
 class EBookLibraryDB : public QObject
 {
   Q_OBJECT
@@ -44,19 +85,36 @@ public:
   void setFilename(QString filename);
   bool save();
   bool load(QString filename);
+  void setDatabase(Database database);
 
   // book stuff.
   quint64 insertOrUpdateBook(BookData book_data);
   bool removeBook(quint64 index);
+  void setContentHash(quint64 uid, const QString& hash);
+  void setWordLists(quint64 uid,
+                    const QStringList& book_words,
+                    const QMap<QString, QString>& word_matches);
+  void setStatistics(quint64 uid, const EBookStatistics& statistics);
+  void setPosition(quint64 uid,
+                   int spine_index,
+                   int lineno,
+                   const EBookBlockIndex& block_index);
 
   BookData bookByUid(quint64 uid);
   BookList bookByTitle(QString title);
   BookData bookByFile(QString filename);
+  BookList books();
+  BookList searchTitles(QString fragment, int limit = 100);
 
   bool isModified();
   void setModified(bool modified);
 
 signals:
+  // only emitted by insertOrUpdateBook() and removeBook(), not while the
+  // library is being loaded.
+  void bookAdded(quint64 uid);
+  void bookChanged(quint64 uid);
+  void bookRemoved(quint64 uid);
 
 public slots:
 
@@ -66,11 +124,32 @@ protected:
   BookMap m_book_data;
   BookByString m_book_by_title;
   BookByString m_book_by_file;
+  TitleIndex m_title_index;
+  // the title and file each book was indexed under, they may since have
+  // been changed in place.
+  QHash<quint64, QPair<QString, QString>> m_indexed_keys;
 
   bool m_modified;
+  // the books changed and removed since the last save.
+  QSet<quint64> m_dirty;
+  QSet<quint64> m_removed;
+  EBookChangeJournal m_journal;
+  Database m_database;
+  // guards the maps and indexes, the yaml file and database are only used
+  // by the owner.
+  mutable QReadWriteLock m_lock;
 
   bool loadLibrary();
   bool saveLibrary();
+  bool writeLibraryFile();
+  static BookData parseBook(quint64 uid, const YAML::Node& book_node);
+  static void emitBook(YAML::Emitter& emitter, BookData book_data);
+  bool loadDatabase();
+  void importIntoDatabase();
+  void writeBook(BookData book_data);
+  void addToIndexes(BookData book_data);
+  void removeFromIndexes(BookData book_data);
+  static QSet<quint64> trigrams(const QString& text);
 };
 typedef QSharedPointer<EBookLibraryDB> LibraryDB;
 
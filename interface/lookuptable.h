@@ -0,0 +1,137 @@
+#ifndef LOOKUPTABLE_H
+#define LOOKUPTABLE_H
+
+#include <QStringView>
+
+/*!
+ * \brief A name and the enum value that it maps to.
+ *
+ * Tables of these are defined once for each enum and used for both
+ * directions of the mapping. Names must be ascii.
+ */
+template<typename Enum>
+struct LookupEntry
+{
+  const char* name;
+  Enum value;
+};
+
+/*!
+ * \brief The enum value to name direction of a lookup table.
+ *
+ * Built at compile time by LookupTable::buildIndex().
+ */
+template<int COUNT>
+struct LookupIndex
+{
+  const char* names[COUNT];
+};
+
+/*!
+ * \brief Case insensitive string to enum lookups over sorted, compile time
+ * tables.
+ *
+ * find() is a binary search that compares the characters of the string
+ * directly with the table names, so no lowered copy of the string is made.
+ * A table that is not sorted fails to compile when checked with isSorted()
+ * in a static_assert.
+ */
+namespace LookupTable {
+
+constexpr char
+lower(char c)
+{
+  return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+}
+
+constexpr int
+compare(const char* a, const char* b)
+{
+  while (*a && lower(*a) == lower(*b)) {
+    ++a;
+    ++b;
+  }
+  return int(lower(*a)) - int(lower(*b));
+}
+
+template<typename Enum, int N>
+constexpr bool
+isSorted(const LookupEntry<Enum> (&table)[N])
+{
+  for (int i = 1; i < N; i++) {
+    if (compare(table[i - 1].name, table[i].name) >= 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template<int COUNT, typename Enum, int N>
+constexpr LookupIndex<COUNT>
+buildIndex(const LookupEntry<Enum> (&table)[N])
+{
+  LookupIndex<COUNT> index{};
+  for (int i = 0; i < N; i++) {
+    index.names[int(table[i].value)] = table[i].name;
+  }
+  return index;
+}
+
+inline int
+compare(QStringView text, const char* name)
+{
+  for (QChar c : text) {
+    if (!*name) {
+      return 1;
+    }
+    ushort t = c.unicode();
+    if (t >= 'A' && t <= 'Z') {
+      t += 'a' - 'A';
+    }
+    ushort n = ushort(uchar(lower(*name++)));
+    if (t != n) {
+      return (t < n ? -1 : 1);
+    }
+  }
+  return (*name ? -1 : 0);
+}
+
+/*!
+ * \brief Returns the value for text, or none if it is not in the table.
+ */
+template<typename Enum, int N>
+Enum
+find(const LookupEntry<Enum> (&table)[N], QStringView text, Enum none)
+{
+  int low = 0, high = N - 1;
+  while (low <= high) {
+    int middle = (low + high) / 2;
+    int result = compare(text, table[middle].name);
+    if (result == 0) {
+      return table[middle].value;
+    } else if (result < 0) {
+      high = middle - 1;
+    } else {
+      low = middle + 1;
+    }
+  }
+  return none;
+}
+
+/*!
+ * \brief Returns true if text starts with prefix, ignoring case.
+ */
+inline bool
+startsWith(QStringView text, const char* prefix)
+{
+  int length = 0;
+  while (prefix[length]) {
+    length++;
+  }
+  return (text.size() >= length &&
+          compare(text.left(length), prefix) == 0);
+}
+
+} // namespace LookupTable
+
+#endif // LOOKUPTABLE_H
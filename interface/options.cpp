@@ -1,5 +1,9 @@
 #include "options.h"
 
+#include <QSaveFile>
+
+#include "ebookjobs.h"
+
 QString Options::POSITION = "window";
 QString Options::DIALOG = "options dialog";
 QString Options::PREF_CURRENT_INDEX = "current book";
@@ -26,6 +30,13 @@ QString Options::DELETE_OLD_BOOK = "delete old book";
 QString Options::SHOW_TOC = "show toc";
 QString Options::TOC_POSITION = "toc position";
 QString Options::VIEW_STATE = "view state";
+QString Options::IMAGE_CACHE_SIZE = "image cache size";
+QString Options::COMPRESSION_LEVEL = "compression level";
+QString Options::SQLITE_STORAGE = "sqlite storage";
+QString Options::UNDO_STEPS = "undo steps";
+QString Options::UNDO_MEMORY = "undo memory";
+QString Options::SPELL_SERVER = "spell server";
+QString Options::SHOW_MEMORY_USAGE = "show memory usage";
 
 Options::Options(QObject* parent)
   : QObject(parent)
@@ -71,156 +82,266 @@ Options::Options(QObject* parent)
   meta_key = QPixmapCache::insert(QPixmap(":/icons/metadata"));
   bookshelf_key = QPixmapCache::insert(QPixmap(":/icons/bookshelf"));
   tree_key = QPixmapCache::insert(QPixmap(":/icons/tree"));
+
+  m_save_timer = new QTimer(this);
+  m_save_timer->setSingleShot(true);
+  m_save_timer->setInterval(SAVE_DELAY);
+  connect(m_save_timer, &QTimer::timeout, this, &Options::writeLater);
+  m_save_watcher = new QFutureWatcher<bool>(this);
+  connect(m_save_watcher,
+          &QFutureWatcher<bool>::finished,
+          this,
+          &Options::saveFinished);
 }
 
-Options::~Options() {}
+Options::~Options()
+{
+  // a save that is still waiting is written now.
+  if (m_save_timer->isActive()) {
+    save(m_save_filename);
+  }
+  waitForSave();
+}
 
+/*!
+ * \brief Writes the options to filename, or to the config file if it is
+ * empty, if any have changed since they were last written.
+ *
+ * This waits for any save started by saveLater(), use saveLater() for
+ * changes that come in bursts, window moves for instance.
+ */
 void
 Options::save(const QString filename)
 {
-  QFile* file;
-  if (filename.isEmpty())
-    file = new QFile(configFile());
-  else
-    file = new QFile(filename);
+  m_save_timer->stop();
+  waitForSave();
+  if (!m_pref_changed) {
+    return;
+  }
+  if (writeFile(filename.isEmpty() ? configFile() : filename, toYaml())) {
+    m_pref_changed = false;
+  }
+}
+
+/*!
+ * \brief Saves the options once they have stopped changing for SAVE_DELAY
+ * milliseconds.
+ *
+ * Each call pushes the save back, so a window drag is written once when it
+ * ends. The options are turned into yaml on this thread and written on a
+ * pool thread, to a temporary file that then replaces the config file.
+ */
+void
+Options::saveLater(const QString filename)
+{
+  m_save_filename = (filename.isEmpty() ? configFile() : filename);
+  m_save_timer->start();
+}
+
+/*!
+ * \brief Waits for a save started by saveLater() to be written.
+ */
+void
+Options::waitForSave()
+{
+  if (m_save_watcher->isRunning()) {
+    m_save_watcher->waitForFinished();
+  }
+}
+
+void
+Options::writeLater()
+{
+  if (m_save_watcher->isRunning()) {
+    // a file is only written by one save at a time.
+    m_save_timer->start();
+    return;
+  }
+  if (!m_pref_changed) {
+    return;
+  }
+  QString filename = m_save_filename;
+  QByteArray yaml = toYaml();
+  m_pref_changed = false;
+  m_save_watcher->setFuture(EBookJobs::submit<bool>(
+    [filename, yaml](QFutureInterface<bool>&) {
+      return writeFile(filename, yaml);
+    },
+    EBookJobs::LOW_PRIORITY));
+}
 
-  if (m_pref_changed) {
-    if (file->open((QFile::ReadWrite | QFile::Truncate))) {
-      YAML::Emitter emitter;
+void
+Options::saveFinished()
+{
+  if (!m_save_watcher->result()) {
+    // try again with the next change.
+    m_pref_changed = true;
+  }
+}
+
+QByteArray
+Options::toYaml() const
+{
+  YAML::Emitter emitter;
+  {
+    emitter << YAML::BeginMap;
+    emitter << YAML::Key << POSITION;
+    emitter << YAML::Value << m_rect;
+    emitter << YAML::Key << DIALOG;
+    emitter << YAML::Value << m_options_dlg_size;
+    emitter << YAML::Key << PREF_CURRENT_INDEX;
+    emitter << YAML::Value << m_currentindex;
+    emitter << YAML::Key << SHOW_TOC;
+    emitter << YAML::Value << m_toc_visible;
+    emitter << YAML::Key << TOC_POSITION;
+    emitter << YAML::Value
+            << (m_toc_position == Options::LEFT ? "LEFT" : "RIGHT");
+    emitter << YAML::Key << IMAGE_CACHE_SIZE;
+    emitter << YAML::Value << m_image_cache_size;
+    emitter << YAML::Key << COMPRESSION_LEVEL;
+    emitter << YAML::Value << m_compression_level;
+    emitter << YAML::Key << SQLITE_STORAGE;
+    emitter << YAML::Value << m_sqlite_storage;
+    emitter << YAML::Key << UNDO_STEPS;
+    emitter << YAML::Value << m_undo_steps;
+    emitter << YAML::Key << UNDO_MEMORY;
+    emitter << YAML::Value << m_undo_memory;
+    emitter << YAML::Key << SPELL_SERVER;
+    emitter << YAML::Value << m_spell_server;
+    emitter << YAML::Key << SHOW_MEMORY_USAGE;
+    emitter << YAML::Value << m_show_memory_usage;
+    emitter << YAML::Key << PREF_BOOKLIST;
+    {
+      // Start of PREF_BOOKLIST
+      emitter << YAML::BeginSeq;
+      foreach (QString book, m_current_files) {
+        emitter << book;
+      }
+      emitter << YAML::EndSeq;
+    } // End of PREF_BOOKLIST
+    emitter << YAML::Key << CODE_OPTIONS;
+    {
+      // Start of CODE_OPTIONS
+      emitter << YAML::BeginMap;
+      emitter << YAML::Key << CODE_FONT;
+      emitter << YAML::Value << m_code_font;
+      emitter << YAML::Key << CODE_NORMAL;
+      emitter << YAML::Value;
       {
         emitter << YAML::BeginMap;
-        emitter << YAML::Key << POSITION;
-        emitter << YAML::Value << m_rect;
-        emitter << YAML::Key << DIALOG;
-        emitter << YAML::Value << m_options_dlg_size;
-        emitter << YAML::Key << PREF_CURRENT_INDEX;
-        emitter << YAML::Value << m_currentindex;
-        emitter << YAML::Key << SHOW_TOC;
-        emitter << YAML::Value << m_toc_visible;
-        emitter << YAML::Key << TOC_POSITION;
-        emitter << YAML::Value
-                << (m_toc_position == Options::LEFT ? "LEFT" : "RIGHT");
-        emitter << YAML::Key << PREF_BOOKLIST;
-        {
-          // Start of PREF_BOOKLIST
-          emitter << YAML::BeginSeq;
-          foreach (QString book, m_current_files) {
-            emitter << book;
-          }
-          emitter << YAML::EndSeq;
-        } // End of PREF_BOOKLIST
-        emitter << YAML::Key << CODE_OPTIONS;
-        {
-          // Start of CODE_OPTIONS
-          emitter << YAML::BeginMap;
-          emitter << YAML::Key << CODE_FONT;
-          emitter << YAML::Value << m_code_font;
-          emitter << YAML::Key << CODE_NORMAL;
-          emitter << YAML::Value;
-          {
-            emitter << YAML::BeginMap;
-            emitter << YAML::Key << CODE_COLOR;
-            emitter << YAML::Value << m_normal_color;
-            emitter << YAML::Key << CODE_BACK;
-            emitter << YAML::Value << m_normal_back;
-            emitter << YAML::Key << CODE_WEIGHT;
-            emitter << YAML::Value << int(m_normal_weight);
-            emitter << YAML::Key << CODE_ITALIC;
-            emitter << YAML::Value << m_normal_italic;
-            emitter << YAML::EndMap;
-          }
-          emitter << YAML::Key << CODE_ATTRIBUTE;
-          emitter << YAML::Value;
-          {
-            emitter << YAML::BeginMap;
-            emitter << YAML::Key << CODE_COLOR;
-            emitter << YAML::Value << m_attribute_color;
-            emitter << YAML::Key << CODE_BACK;
-            emitter << YAML::Value << m_attribute_back;
-            emitter << YAML::Key << CODE_WEIGHT;
-            emitter << YAML::Value << int(m_attribute_weight);
-            emitter << YAML::Key << CODE_ITALIC;
-            emitter << YAML::Value << m_attribute_italic;
-            emitter << YAML::EndMap;
-          }
-          emitter << YAML::Key << CODE_TAG;
-          emitter << YAML::Value;
-          {
-            emitter << YAML::BeginMap;
-            emitter << YAML::Key << CODE_COLOR;
-            emitter << YAML::Value << m_tag_color;
-            emitter << YAML::Key << CODE_BACK;
-            emitter << YAML::Value << m_tag_back;
-            emitter << YAML::Key << CODE_WEIGHT;
-            emitter << YAML::Value << int(m_tag_weight);
-            emitter << YAML::Key << CODE_ITALIC;
-            emitter << YAML::Value << m_tag_italic;
-            emitter << YAML::EndMap;
-          }
-          emitter << YAML::Key << CODE_STRING;
-          emitter << YAML::Value;
-          {
-            emitter << YAML::BeginMap;
-            emitter << YAML::Key << CODE_COLOR;
-            emitter << YAML::Value << m_string_color;
-            emitter << YAML::Key << CODE_BACK;
-            emitter << YAML::Value << m_string_back;
-            emitter << YAML::Key << CODE_WEIGHT;
-            emitter << YAML::Value << int(m_string_weight);
-            emitter << YAML::Key << CODE_ITALIC;
-            emitter << YAML::Value << m_string_italic;
-            emitter << YAML::EndMap;
-          }
-          emitter << YAML::Key << CODE_ERROR;
-          emitter << YAML::Value;
-          {
-            emitter << YAML::BeginMap;
-            emitter << YAML::Key << CODE_COLOR;
-            emitter << YAML::Value << m_error_color;
-            emitter << YAML::Key << CODE_BACK;
-            emitter << YAML::Value << m_error_back;
-            emitter << YAML::Key << CODE_WEIGHT;
-            emitter << YAML::Value << m_error_weight;
-            emitter << YAML::Key << CODE_ITALIC;
-            emitter << YAML::Value << m_error_italic;
-            emitter << YAML::EndMap;
-          }
-          emitter << YAML::Key << CODE_STYLE;
-          emitter << YAML::Value;
-          {
-            emitter << YAML::BeginMap;
-            emitter << YAML::Key << CODE_COLOR;
-            emitter << YAML::Value << m_style_color;
-            emitter << YAML::Key << CODE_BACK;
-            emitter << YAML::Value << m_style_back;
-            emitter << YAML::Key << CODE_WEIGHT;
-            emitter << YAML::Value << m_style_weight;
-            emitter << YAML::Key << CODE_ITALIC;
-            emitter << YAML::Value << m_style_italic;
-            emitter << YAML::EndMap;
-          }
-          emitter << YAML::Key << CODE_SCRIPT;
-          emitter << YAML::Value;
-          {
-            emitter << YAML::BeginMap;
-            emitter << YAML::Key << CODE_COLOR;
-            emitter << YAML::Value << m_script_color;
-            emitter << YAML::Key << CODE_BACK;
-            emitter << YAML::Value << m_script_back;
-            emitter << YAML::Key << CODE_WEIGHT;
-            emitter << YAML::Value << m_script_weight;
-            emitter << YAML::Key << CODE_ITALIC;
-            emitter << YAML::Value << m_script_italic;
-            emitter << YAML::EndMap;
-          }
-        } // End of CODE_OPTIONS
+        emitter << YAML::Key << CODE_COLOR;
+        emitter << YAML::Value << m_normal_color;
+        emitter << YAML::Key << CODE_BACK;
+        emitter << YAML::Value << m_normal_back;
+        emitter << YAML::Key << CODE_WEIGHT;
+        emitter << YAML::Value << int(m_normal_weight);
+        emitter << YAML::Key << CODE_ITALIC;
+        emitter << YAML::Value << m_normal_italic;
         emitter << YAML::EndMap;
       }
-      QTextStream out(file);
-      out << emitter.c_str();
-      file->close();
-    }
+      emitter << YAML::Key << CODE_ATTRIBUTE;
+      emitter << YAML::Value;
+      {
+        emitter << YAML::BeginMap;
+        emitter << YAML::Key << CODE_COLOR;
+        emitter << YAML::Value << m_attribute_color;
+        emitter << YAML::Key << CODE_BACK;
+        emitter << YAML::Value << m_attribute_back;
+        emitter << YAML::Key << CODE_WEIGHT;
+        emitter << YAML::Value << int(m_attribute_weight);
+        emitter << YAML::Key << CODE_ITALIC;
+        emitter << YAML::Value << m_attribute_italic;
+        emitter << YAML::EndMap;
+      }
+      emitter << YAML::Key << CODE_TAG;
+      emitter << YAML::Value;
+      {
+        emitter << YAML::BeginMap;
+        emitter << YAML::Key << CODE_COLOR;
+        emitter << YAML::Value << m_tag_color;
+        emitter << YAML::Key << CODE_BACK;
+        emitter << YAML::Value << m_tag_back;
+        emitter << YAML::Key << CODE_WEIGHT;
+        emitter << YAML::Value << int(m_tag_weight);
+        emitter << YAML::Key << CODE_ITALIC;
+        emitter << YAML::Value << m_tag_italic;
+        emitter << YAML::EndMap;
+      }
+      emitter << YAML::Key << CODE_STRING;
+      emitter << YAML::Value;
+      {
+        emitter << YAML::BeginMap;
+        emitter << YAML::Key << CODE_COLOR;
+        emitter << YAML::Value << m_string_color;
+        emitter << YAML::Key << CODE_BACK;
+        emitter << YAML::Value << m_string_back;
+        emitter << YAML::Key << CODE_WEIGHT;
+        emitter << YAML::Value << int(m_string_weight);
+        emitter << YAML::Key << CODE_ITALIC;
+        emitter << YAML::Value << m_string_italic;
+        emitter << YAML::EndMap;
+      }
+      emitter << YAML::Key << CODE_ERROR;
+      emitter << YAML::Value;
+      {
+        emitter << YAML::BeginMap;
+        emitter << YAML::Key << CODE_COLOR;
+        emitter << YAML::Value << m_error_color;
+        emitter << YAML::Key << CODE_BACK;
+        emitter << YAML::Value << m_error_back;
+        emitter << YAML::Key << CODE_WEIGHT;
+        emitter << YAML::Value << m_error_weight;
+        emitter << YAML::Key << CODE_ITALIC;
+        emitter << YAML::Value << m_error_italic;
+        emitter << YAML::EndMap;
+      }
+      emitter << YAML::Key << CODE_STYLE;
+      emitter << YAML::Value;
+      {
+        emitter << YAML::BeginMap;
+        emitter << YAML::Key << CODE_COLOR;
+        emitter << YAML::Value << m_style_color;
+        emitter << YAML::Key << CODE_BACK;
+        emitter << YAML::Value << m_style_back;
+        emitter << YAML::Key << CODE_WEIGHT;
+        emitter << YAML::Value << m_style_weight;
+        emitter << YAML::Key << CODE_ITALIC;
+        emitter << YAML::Value << m_style_italic;
+        emitter << YAML::EndMap;
+      }
+      emitter << YAML::Key << CODE_SCRIPT;
+      emitter << YAML::Value;
+      {
+        emitter << YAML::BeginMap;
+        emitter << YAML::Key << CODE_COLOR;
+        emitter << YAML::Value << m_script_color;
+        emitter << YAML::Key << CODE_BACK;
+        emitter << YAML::Value << m_script_back;
+        emitter << YAML::Key << CODE_WEIGHT;
+        emitter << YAML::Value << m_script_weight;
+        emitter << YAML::Key << CODE_ITALIC;
+        emitter << YAML::Value << m_script_italic;
+        emitter << YAML::EndMap;
+      }
+    } // End of CODE_OPTIONS
+    emitter << YAML::EndMap;
+  }
+  return QByteArray(emitter.c_str());
+}
+
+/*
+ * Written to a temporary file that replaces the old one, so that a crash
+ * part way through never leaves half a file.
+ */
+bool
+Options::writeFile(const QString& filename, const QByteArray& yaml)
+{
+  QSaveFile file(filename);
+  if (!file.open(QIODevice::WriteOnly)) {
+    return false;
   }
+  file.write(yaml);
+  return file.commit();
 }
 
 void
@@ -257,6 +378,41 @@ Options::load(const QString filename)
     } else {
       m_toc_position = Options::LEFT;
     }
+    if (m_preferences[IMAGE_CACHE_SIZE]) {
+      m_image_cache_size = m_preferences[IMAGE_CACHE_SIZE].as<int>();
+    } else {
+      m_image_cache_size = DEF_IMAGE_CACHE_SIZE;
+    }
+    if (m_preferences[COMPRESSION_LEVEL]) {
+      m_compression_level = m_preferences[COMPRESSION_LEVEL].as<int>();
+    } else {
+      m_compression_level = DEF_COMPRESSION_LEVEL;
+    }
+    if (m_preferences[SQLITE_STORAGE]) {
+      m_sqlite_storage = m_preferences[SQLITE_STORAGE].as<bool>();
+    } else {
+      m_sqlite_storage = false;
+    }
+    if (m_preferences[UNDO_STEPS]) {
+      m_undo_steps = m_preferences[UNDO_STEPS].as<int>();
+    } else {
+      m_undo_steps = DEF_UNDO_STEPS;
+    }
+    if (m_preferences[UNDO_MEMORY]) {
+      m_undo_memory = m_preferences[UNDO_MEMORY].as<int>();
+    } else {
+      m_undo_memory = DEF_UNDO_MEMORY;
+    }
+    if (m_preferences[SPELL_SERVER]) {
+      m_spell_server = m_preferences[SPELL_SERVER].as<QString>();
+    } else {
+      m_spell_server.clear();
+    }
+    if (m_preferences[SHOW_MEMORY_USAGE]) {
+      m_show_memory_usage = m_preferences[SHOW_MEMORY_USAGE].as<bool>();
+    } else {
+      m_show_memory_usage = false;
+    }
     // Last books loaded in library.
     YAML::Node books = m_preferences[PREF_BOOKLIST];
     if (books && books.IsSequence()) {
@@ -818,6 +974,18 @@ Options::setConfigDirectory(const QString& config_directory)
   m_config_directory = config_directory;
 }
 
+QString
+Options::cacheDirectory() const
+{
+  return m_cache_directory;
+}
+
+void
+Options::setCacheDirectory(const QString& cache_directory)
+{
+  m_cache_directory = cache_directory;
+}
+
 QString
 Options::configFile() const
 {
@@ -892,6 +1060,145 @@ Options::setOptionsDlgSize(const QSize& options_dlg)
   m_pref_changed = true;
 }
 
+/*!
+ * \brief The size in megabytes of the decoded image cache for each book.
+ */
+int
+Options::imageCacheSize() const
+{
+  return m_image_cache_size;
+}
+
+void
+Options::setImageCacheSize(int image_cache_size)
+{
+  m_image_cache_size = image_cache_size;
+  m_pref_changed = true;
+}
+
+/*!
+ * \brief The number of edits of a chapter that the editor can undo one at a
+ * time, older edits are undone a block at a time.
+ */
+int
+Options::undoSteps() const
+{
+  return m_undo_steps;
+}
+
+void
+Options::setUndoSteps(int undo_steps)
+{
+  m_undo_steps = undo_steps;
+  m_pref_changed = true;
+}
+
+/*!
+ * \brief The size in megabytes of the older undo history kept in memory,
+ * anything beyond this is written to disk.
+ */
+int
+Options::undoMemory() const
+{
+  return m_undo_memory;
+}
+
+void
+Options::setUndoMemory(int undo_memory)
+{
+  m_undo_memory = undo_memory;
+  m_pref_changed = true;
+}
+
+/*!
+ * \brief The url of a remote spelling and grammar checker, empty if only
+ * the dictionaries on this machine are used.
+ */
+QString
+Options::spellServer() const
+{
+  return m_spell_server;
+}
+
+void
+Options::setSpellServer(const QString& spell_server)
+{
+  m_spell_server = spell_server;
+  m_pref_changed = true;
+}
+
+/*!
+ * \brief true if the memory held by the book shown is given in the status
+ * bar.
+ */
+bool
+Options::showMemoryUsage() const
+{
+  return m_show_memory_usage;
+}
+
+void
+Options::setShowMemoryUsage(bool show_memory_usage)
+{
+  m_show_memory_usage = show_memory_usage;
+  m_pref_changed = true;
+}
+
+/*!
+ * \brief The deflate level, 1 (fastest) to 9 (smallest), used for the text
+ * entries of saved books.
+ */
+int
+Options::compressionLevel() const
+{
+  return m_compression_level;
+}
+
+void
+Options::setCompressionLevel(int compression_level)
+{
+  m_compression_level = compression_level;
+  m_pref_changed = true;
+}
+
+/*!
+ * \brief Whether the library, authors and series are stored in an SQLite
+ * database rather than the yaml files.
+ *
+ * A change takes effect the next time the application starts.
+ */
+bool
+Options::sqliteStorage() const
+{
+  return m_sqlite_storage;
+}
+
+void
+Options::setSqliteStorage(bool sqlite_storage)
+{
+  m_sqlite_storage = sqlite_storage;
+  m_pref_changed = true;
+}
+
+/*!
+ * \brief Reads just the storage option from the configuration file.
+ *
+ * The databases are loaded before the rest of the options, see load().
+ */
+bool
+Options::readSqliteStorage(const QString& config_file)
+{
+  QFile file(config_file);
+  if (!file.exists()) {
+    return false;
+  }
+  YAML::Node preferences = YAML::LoadFile(file);
+  if (preferences[SQLITE_STORAGE]) {
+    return preferences[SQLITE_STORAGE].as<bool>();
+  }
+  return false;
+}
+
 int
 Options::currentIndex() const
 {
@@ -1180,6 +1487,50 @@ Options::setWeight(const CodeOptions options, const QFont::Weight weight)
   }
 }
 
+/*!
+ * \brief The format that the code editors highlight options with.
+ *
+ * The formats are held here once for every highlighter rather than by
+ * each one.
+ */
+const QTextCharFormat&
+Options::codeFormat(const CodeOptions options) const
+{
+  if (m_code_formats.isEmpty()) {
+    m_code_formats.resize(SCRIPT + 1);
+    for (int i = NORMAL; i <= SCRIPT; i++) {
+      CodeOptions option = CodeOptions(i);
+      QTextCharFormat& format = m_code_formats[i];
+      format.setForeground(color(option));
+      format.setBackground(background(option));
+      format.setFontWeight(weight(option));
+      format.setFontItalic(italic(option));
+    }
+  }
+  return m_code_formats.at(options);
+}
+
+/*!
+ * \brief Changes each time that the code formats are rebuilt.
+ */
+int
+Options::codeFormatVersion() const
+{
+  return m_code_format_version;
+}
+
+/*!
+ * \brief Rebuilds the code formats after the code options have changed,
+ * then emits codeFormatsChanged().
+ */
+void
+Options::updateCodeFormats()
+{
+  m_code_formats.clear();
+  m_code_format_version++;
+  emit codeFormatsChanged();
+}
+
 QColor
 Options::contrastingColor(const QColor color)
 {
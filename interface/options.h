@@ -3,11 +3,15 @@
 
 #include <QColor>
 #include <QFont>
+#include <QFutureWatcher>
 #include <QObject>
 #include <QPixmapCache>
 #include <QRect>
 #include <QSize>
 #include <QString>
+#include <QTextCharFormat>
+#include <QTimer>
+#include <QVector>
 
 #include <qyaml-cpp/QYamlCpp>
 //#include "qyaml-cpp.h"
@@ -46,6 +50,8 @@ public:
   ~Options();
 
   void save(const QString filename = QString());
+  void saveLater(const QString filename = QString());
+  void waitForSave();
   void load(const QString filename);
 
   TocPosition tocPosition() const;
@@ -65,6 +71,10 @@ public:
   QFont::Weight weight(const CodeOptions options) const;
   void setWeight(const CodeOptions options, const QFont::Weight weight);
 
+  const QTextCharFormat& codeFormat(const CodeOptions options) const;
+  int codeFormatVersion() const;
+  void updateCodeFormats();
+
   QRect rect() const;
   void setRect(const QRect& rect);
 
@@ -195,6 +205,8 @@ public:
 
   QString configDirectory() const;
   void setConfigDirectory(const QString& config_directory);
+  QString cacheDirectory() const;
+  void setCacheDirectory(const QString& cache_directory);
 
   QString configFile() const;
   void setConfigFile(const QString& config_file);
@@ -208,8 +220,31 @@ public:
   QString seriesFile() const;
   void setSeriesFile(const QString& series_file);
 
+  int imageCacheSize() const;
+  void setImageCacheSize(int image_cache_size);
+
+  int compressionLevel() const;
+  void setCompressionLevel(int compression_level);
+
+  int undoSteps() const;
+  void setUndoSteps(int undo_steps);
+
+  int undoMemory() const;
+  void setUndoMemory(int undo_memory);
+
+  QString spellServer() const;
+  void setSpellServer(const QString& spell_server);
+
+  bool showMemoryUsage() const;
+  void setShowMemoryUsage(bool show_memory_usage);
+
+  bool sqliteStorage() const;
+  void setSqliteStorage(bool sqlite_storage);
+  static bool readSqliteStorage(const QString& config_file);
+
 signals:
   void loadLibraryFiles(QStringList, int);
+  void codeFormatsChanged();
 
 protected:
   ViewState m_view_state = VIEW_LIBRARY_TREE;
@@ -218,6 +253,9 @@ protected:
 
   YAML::Node m_preferences;
   bool m_pref_changed = false;
+  QTimer* m_save_timer;
+  QFutureWatcher<bool>* m_save_watcher;
+  QString m_save_filename;
 
   QRect m_rect;
   QSize m_options_dlg_size;
@@ -256,14 +294,27 @@ protected:
   QColor m_style_back;
   bool m_style_italic;
   QFont::Weight m_style_weight;
+  // the formats built from the options above, shared by every highlighter.
+  // built when first asked for, the version changes each time they are
+  // rebuilt.
+  mutable QVector<QTextCharFormat> m_code_formats;
+  int m_code_format_version = 0;
 
   QString m_home_directiory;
   QString m_library_directory;
   QString m_config_directory;
+  QString m_cache_directory;
   QString m_config_file;
   QString m_lib_file;
   QString m_authors_file;
   QString m_series_file;
+  int m_image_cache_size = DEF_IMAGE_CACHE_SIZE; // MB
+  int m_compression_level = DEF_COMPRESSION_LEVEL; // 1 - 9
+  bool m_sqlite_storage = false;
+  int m_undo_steps = DEF_UNDO_STEPS;
+  int m_undo_memory = DEF_UNDO_MEMORY; // MB
+  QString m_spell_server; // empty for none.
+  bool m_show_memory_usage = false;
 
   // static tag strings.
   static const int DEF_WIDTH = 600;
@@ -272,6 +323,11 @@ protected:
   static const int DEF_Y = 0;
   static const int DEF_DLG_WIDTH = 300;
   static const int DEF_DLG_HEIGHT = 300;
+  static const int DEF_IMAGE_CACHE_SIZE = 256;
+  static const int DEF_COMPRESSION_LEVEL = 6;
+  static const int DEF_UNDO_STEPS = 100;
+  static const int DEF_UNDO_MEMORY = 16;
+  static const int SAVE_DELAY = 500; // ms
 
   static QString POSITION;
   static QString DIALOG;
@@ -299,6 +355,18 @@ protected:
   static QString SHOW_TOC;
   static QString TOC_POSITION;
   static QString VIEW_STATE;
+  static QString IMAGE_CACHE_SIZE;
+  static QString COMPRESSION_LEVEL;
+  static QString SQLITE_STORAGE;
+  static QString UNDO_STEPS;
+  static QString UNDO_MEMORY;
+  static QString SPELL_SERVER;
+  static QString SHOW_MEMORY_USAGE;
+
+  void writeLater();
+  void saveFinished();
+  QByteArray toYaml() const;
+  static bool writeFile(const QString& filename, const QByteArray& yaml);
 };
 
 #endif // OPTIONS_H
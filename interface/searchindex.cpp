@@ -0,0 +1,485 @@
+#include "searchindex.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+
+#include <algorithm>
+
+#include <qlogger/qlogger.h>
+
+#include "xhtmltokenizer.h"
+
+using namespace qlogger;
+
+const QString EBookSearchIndex::INDEX_SUFFIX = ".idx";
+
+EBookSearchIndex::EBookSearchIndex() {}
+
+QString
+EBookSearchIndex::directory() const
+{
+  return m_directory;
+}
+
+/*!
+ * \brief Sets the directory that the index files are stored in.
+ */
+void
+EBookSearchIndex::setDirectory(const QString& directory)
+{
+  m_directory = directory;
+}
+
+/*!
+ * \brief The paths of the index files in directory(), which can be read
+ * with readBook().
+ */
+QStringList
+EBookSearchIndex::indexFiles() const
+{
+  QStringList paths;
+  QDir dir(m_directory);
+  QStringList names =
+    dir.entryList(QStringList() << ("*" + INDEX_SUFFIX), QDir::Files);
+  foreach (QString name, names) {
+    paths << dir.absoluteFilePath(name);
+  }
+  return paths;
+}
+
+/*!
+ * \brief Adds a book to the index, replacing any earlier version of it.
+ *
+ * The book is not written, that is done by writeBook() when it is built.
+ */
+void
+EBookSearchIndex::insertBook(const EBookIndexedBook& book)
+{
+  if (book.uid == 0) {
+    return;
+  }
+  unindexBook(book.uid);
+  m_books.insert(book.uid, book);
+  for (int i = 0; i < book.chapters.size(); i++) {
+    const EBookIndexChapter& chapter = book.chapters.at(i);
+    QHash<QString, QByteArray>::const_iterator it = chapter.terms.constBegin();
+    for (; it != chapter.terms.constEnd(); ++it) {
+      ChapterRef ref;
+      ref.uid = book.uid;
+      ref.chapter = i;
+      m_terms[it.key()].append(ref);
+    }
+  }
+}
+
+/*!
+ * \brief Removes a book from the index and deletes its index file.
+ */
+void
+EBookSearchIndex::removeBook(quint64 uid)
+{
+  unindexBook(uid);
+  if (!m_directory.isEmpty()) {
+    QFile::remove(bookPath(m_directory, uid));
+  }
+}
+
+bool
+EBookSearchIndex::contains(quint64 uid) const
+{
+  return m_books.contains(uid);
+}
+
+/*!
+ * \brief Returns true if the book was indexed from the file as last modified
+ * at modified.
+ */
+bool
+EBookSearchIndex::isCurrent(quint64 uid, qint64 modified) const
+{
+  QHash<quint64, EBookIndexedBook>::const_iterator it = m_books.constFind(uid);
+  return (it != m_books.constEnd() && it.value().modified == modified);
+}
+
+EBookIndexedBook
+EBookSearchIndex::book(quint64 uid) const
+{
+  return m_books.value(uid);
+}
+
+QList<quint64>
+EBookSearchIndex::books() const
+{
+  return m_books.keys();
+}
+
+/*!
+ * \brief Finds the chapters that contain every word in query.
+ *
+ * Words are matched whole and without regard to case. The rarest word of
+ * the query is looked up in the index and the others only have to be found
+ * in the same chapter, a hit is returned for each occurrence of the rarest
+ * word.
+ *
+ * \return at most limit hits in the order they were indexed.
+ */
+EBookSearchHitList
+EBookSearchIndex::search(const QString& query, int limit) const
+{
+  EBookSearchHitList hits;
+  QStringList query_words = words(query);
+  query_words.removeDuplicates();
+  if (query_words.isEmpty()) {
+    return hits;
+  }
+  std::sort(query_words.begin(),
+            query_words.end(),
+            [this](const QString& first, const QString& second) {
+              return m_terms.value(first).size() <
+                     m_terms.value(second).size();
+            });
+
+  QString term = query_words.takeFirst();
+  const QVector<ChapterRef> refs = m_terms.value(term);
+  foreach (const ChapterRef& ref, refs) {
+    QHash<quint64, EBookIndexedBook>::const_iterator book_it =
+      m_books.constFind(ref.uid);
+    if (book_it == m_books.constEnd()) {
+      continue;
+    }
+    const EBookIndexChapter& chapter = book_it.value().chapters.at(ref.chapter);
+    bool found = true;
+    foreach (QString word, query_words) {
+      if (!chapter.terms.contains(word)) {
+        found = false;
+        break;
+      }
+    }
+    if (!found) {
+      continue;
+    }
+
+    QByteArray offsets = chapter.terms.value(term);
+    const char* data = offsets.constData();
+    const char* end = data + offsets.size();
+    quint32 count = 0, delta = 0, offset = 0;
+    readVarint(data, end, count);
+    for (quint32 i = 0; i < count && readVarint(data, end, delta); i++) {
+      offset += delta;
+      EBookSearchHit hit;
+      hit.uid = ref.uid;
+      hit.chapter = chapter.id;
+      hit.term = term;
+      hit.offset = int(offset);
+      hit.occurrence = int(i);
+      hits.append(hit);
+      if (hits.size() >= limit) {
+        return hits;
+      }
+    }
+  }
+  return hits;
+}
+
+/*!
+ * \brief Indexes the chapters of a book.
+ *
+ * Chapters that have the same id and text as a chapter of previous are
+ * copied from it rather than indexed again. This does not touch the index
+ * so it can be run in a worker thread.
+ */
+EBookIndexedBook
+EBookSearchIndex::buildBook(quint64 uid,
+                            qint64 modified,
+                            const EBookChapterList& chapters,
+                            const EBookIndexedBook& previous)
+{
+  QHash<QString, int> previous_chapters;
+  for (int i = 0; i < previous.chapters.size(); i++) {
+    previous_chapters.insert(previous.chapters.at(i).id, i);
+  }
+
+  EBookIndexedBook book;
+  book.uid = uid;
+  book.modified = modified;
+  foreach (const EBookChapterText& text, chapters) {
+    QByteArray hash = QCryptographicHash::hash(
+      QByteArray::fromRawData(reinterpret_cast<const char*>(text.text.utf16()),
+                              text.text.size() * int(sizeof(ushort))),
+      QCryptographicHash::Md5);
+
+    int index = previous_chapters.value(text.id, -1);
+    if (index >= 0 && previous.chapters.at(index).hash == hash) {
+      book.chapters.append(previous.chapters.at(index));
+      continue;
+    }
+
+    EBookIndexChapter chapter;
+    chapter.id = text.id;
+    chapter.hash = hash;
+    chapter.terms = indexText(text.text);
+    chapter.postings = encodePostings(chapter.terms);
+    book.chapters.append(chapter);
+  }
+  return book;
+}
+
+/*!
+ * \brief Reads a book written by writeBook().
+ *
+ * \return the book, or a book with a uid of 0 if the file could not be read.
+ */
+EBookIndexedBook
+EBookSearchIndex::readBook(const QString& path)
+{
+  EBookIndexedBook book;
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return book;
+  }
+
+  QDataStream in(&file);
+  in.setVersion(QDataStream::Qt_5_6);
+  quint32 magic = 0, version = 0;
+  in >> magic >> version;
+  if (magic != INDEX_MAGIC || version != INDEX_VERSION) {
+    QLOG_DEBUG(QString("Ignoring old search index %1").arg(path));
+    return book;
+  }
+
+  quint64 uid = 0;
+  qint64 modified = 0;
+  qint32 count = 0;
+  in >> uid >> modified >> count;
+  for (qint32 i = 0; i < count && in.status() == QDataStream::Ok; i++) {
+    EBookIndexChapter chapter;
+    in >> chapter.id >> chapter.hash >> chapter.postings;
+    if (!decodePostings(chapter.postings, chapter.terms)) {
+      QLOG_DEBUG(QString("Damaged search index %1").arg(path));
+      return book;
+    }
+    book.chapters.append(chapter);
+  }
+  if (in.status() != QDataStream::Ok) {
+    QLOG_DEBUG(QString("Damaged search index %1").arg(path));
+    book.chapters.clear();
+    return book;
+  }
+  book.uid = uid;
+  book.modified = modified;
+  return book;
+}
+
+/*!
+ * \brief Writes the index file of a book into directory.
+ *
+ * The old file is only replaced once the new one is complete.
+ */
+bool
+EBookSearchIndex::writeBook(const QString& directory,
+                            const EBookIndexedBook& book)
+{
+  QDir dir;
+  dir.mkpath(directory);
+  QSaveFile file(bookPath(directory, book.uid));
+  if (!file.open(QIODevice::WriteOnly)) {
+    QLOG_DEBUG(QString("Unable to write search index %1").arg(file.fileName()));
+    return false;
+  }
+
+  QDataStream out(&file);
+  out.setVersion(QDataStream::Qt_5_6);
+  out << INDEX_MAGIC << INDEX_VERSION;
+  out << book.uid << book.modified << qint32(book.chapters.size());
+  foreach (const EBookIndexChapter& chapter, book.chapters) {
+    out << chapter.id << chapter.hash << chapter.postings;
+  }
+  return file.commit();
+}
+
+QString
+EBookSearchIndex::bookPath(const QString& directory, quint64 uid)
+{
+  return directory + QDir::separator() + QString::number(uid) + INDEX_SUFFIX;
+}
+
+/*!
+ * \brief Splits plain text into the case folded words used by the index.
+ */
+QStringList
+EBookSearchIndex::words(const QString& text)
+{
+  QStringList result;
+  int length = text.size();
+  int i = 0;
+  while (i < length) {
+    while (i < length && !XhtmlTokenizer::isWordChar(text.at(i))) {
+      i++;
+    }
+    int start = i;
+    while (i < length && XhtmlTokenizer::isWordChar(text.at(i))) {
+      i++;
+    }
+    if (i > start) {
+      result << text.mid(start, i - start).toCaseFolded();
+    }
+  }
+  return result;
+}
+
+void
+EBookSearchIndex::unindexBook(quint64 uid)
+{
+  QHash<quint64, EBookIndexedBook>::iterator book_it = m_books.find(uid);
+  if (book_it == m_books.end()) {
+    return;
+  }
+  foreach (const EBookIndexChapter& chapter, book_it.value().chapters) {
+    QHash<QString, QByteArray>::const_iterator it = chapter.terms.constBegin();
+    for (; it != chapter.terms.constEnd(); ++it) {
+      QHash<QString, QVector<ChapterRef>>::iterator term_it =
+        m_terms.find(it.key());
+      if (term_it == m_terms.end()) {
+        continue;
+      }
+      QVector<ChapterRef>& refs = term_it.value();
+      refs.erase(std::remove_if(refs.begin(),
+                                refs.end(),
+                                [uid](const ChapterRef& ref) {
+                                  return ref.uid == uid;
+                                }),
+                 refs.end());
+      if (refs.isEmpty()) {
+        m_terms.erase(term_it);
+      }
+    }
+  }
+  m_books.erase(book_it);
+}
+
+/*!
+ * \brief Finds the words in the text of an xhtml document.
+ *
+ * Only text between tags is indexed, the offsets are those of the words in
+ * text.
+ */
+QHash<QString, QByteArray>
+EBookSearchIndex::indexText(const QString& text)
+{
+  QHash<QString, QVector<int>> offsets;
+  XhtmlTokenizer tokenizer(text);
+  while (!tokenizer.atEnd()) {
+    XhtmlToken token = tokenizer.next();
+    if (token.type != XhtmlToken::TEXT) {
+      continue;
+    }
+    int length = token.text.size();
+    int i = 0;
+    while (i < length) {
+      while (i < length && !XhtmlTokenizer::isWordChar(token.text.at(i))) {
+        i++;
+      }
+      int start = i;
+      while (i < length && XhtmlTokenizer::isWordChar(token.text.at(i))) {
+        i++;
+      }
+      if (i > start) {
+        QString word = token.text.mid(start, i - start).toString();
+        offsets[word.toCaseFolded()].append(token.start + start);
+      }
+    }
+  }
+
+  QHash<QString, QByteArray> terms;
+  QHash<QString, QVector<int>>::const_iterator it = offsets.constBegin();
+  for (; it != offsets.constEnd(); ++it) {
+    const QVector<int>& positions = it.value();
+    QByteArray data;
+    appendVarint(data, quint32(positions.size()));
+    int last = 0;
+    foreach (int position, positions) {
+      appendVarint(data, quint32(position - last));
+      last = position;
+    }
+    terms.insert(it.key(), data);
+  }
+  return terms;
+}
+
+/*!
+ * \brief Packs the postings of a chapter for the index file.
+ */
+QByteArray
+EBookSearchIndex::encodePostings(const QHash<QString, QByteArray>& terms)
+{
+  QByteArray data;
+  appendVarint(data, quint32(terms.size()));
+  QHash<QString, QByteArray>::const_iterator it = terms.constBegin();
+  for (; it != terms.constEnd(); ++it) {
+    QByteArray term = it.key().toUtf8();
+    appendVarint(data, quint32(term.size()));
+    data.append(term);
+    appendVarint(data, quint32(it.value().size()));
+    data.append(it.value());
+  }
+  return qCompress(data);
+}
+
+bool
+EBookSearchIndex::decodePostings(const QByteArray& postings,
+                                 QHash<QString, QByteArray>& terms)
+{
+  QByteArray data = qUncompress(postings);
+  const char* pos = data.constData();
+  const char* end = pos + data.size();
+  quint32 count = 0;
+  if (!readVarint(pos, end, count)) {
+    return false;
+  }
+  terms.reserve(int(count));
+  for (quint32 i = 0; i < count; i++) {
+    quint32 length = 0;
+    if (!readVarint(pos, end, length) || quint32(end - pos) < length) {
+      return false;
+    }
+    QString term = QString::fromUtf8(pos, int(length));
+    pos += length;
+    if (!readVarint(pos, end, length) || quint32(end - pos) < length) {
+      return false;
+    }
+    terms.insert(term, QByteArray(pos, int(length)));
+    pos += length;
+  }
+  return true;
+}
+
+/*!
+ * \brief Appends value in seven bit groups, the top bit of each byte is set
+ * if another follows.
+ */
+void
+EBookSearchIndex::appendVarint(QByteArray& data, quint32 value)
+{
+  while (value >= 0x80) {
+    data.append(char((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  data.append(char(value));
+}
+
+bool
+EBookSearchIndex::readVarint(const char*& data, const char* end, quint32& value)
+{
+  value = 0;
+  for (int shift = 0; data < end && shift < 32; shift += 7) {
+    quint8 byte = quint8(*data++);
+    value |= quint32(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,123 @@
+#ifndef SEARCHINDEX_H
+#define SEARCHINDEX_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/*!
+ * \brief The text of one chapter of a book, as returned by
+ * IEBookInterface::readChapters().
+ */
+struct EBookChapterText
+{
+  QString id;   // the chapter key, the spine idref for an epub.
+  QString text; // the chapter xhtml.
+};
+typedef QList<EBookChapterText> EBookChapterList;
+
+/*!
+ * \brief The indexed words of one chapter.
+ *
+ * postings is the compressed form stored in the index file, terms holds
+ * the same postings uncompressed, each as a count followed by the delta
+ * encoded character offsets of the word in the chapter text.
+ */
+struct EBookIndexChapter
+{
+  QString id;
+  QByteArray hash; // of the chapter text, unchanged chapters are reused.
+  QByteArray postings;
+  QHash<QString, QByteArray> terms;
+};
+
+struct EBookIndexedBook
+{
+  quint64 uid = 0;
+  qint64 modified = 0; // the file modification time when it was indexed.
+  QList<EBookIndexChapter> chapters;
+};
+typedef QList<EBookIndexedBook> EBookIndexedBookList;
+
+/*!
+ * \brief A word found by EBookSearchIndex::search().
+ *
+ * offset is the character offset of the word in the chapter text and
+ * occurrence the number of earlier times it appears in the chapter.
+ */
+struct EBookSearchHit
+{
+  quint64 uid = 0;
+  QString chapter;
+  QString term;
+  int offset = 0;
+  int occurrence = 0;
+};
+typedef QList<EBookSearchHit> EBookSearchHitList;
+
+/*!
+ * \brief A full text index of the books in the library.
+ *
+ * Each book is stored in its own file in directory(), so a book that is
+ * saved again only rewrites its own file, and within it only the chapters
+ * whose text has changed are indexed again.
+ *
+ * buildBook(), readBook() and writeBook() are static and can be run in
+ * worker threads, the books they return are then added with insertBook()
+ * in the thread that owns the index.
+ */
+class EBookSearchIndex
+{
+public:
+  EBookSearchIndex();
+
+  QString directory() const;
+  void setDirectory(const QString& directory);
+  QStringList indexFiles() const;
+
+  void insertBook(const EBookIndexedBook& book);
+  void removeBook(quint64 uid);
+  bool contains(quint64 uid) const;
+  bool isCurrent(quint64 uid, qint64 modified) const;
+  EBookIndexedBook book(quint64 uid) const;
+  QList<quint64> books() const;
+
+  EBookSearchHitList search(const QString& query, int limit = 1000) const;
+
+  static EBookIndexedBook buildBook(quint64 uid,
+                                    qint64 modified,
+                                    const EBookChapterList& chapters,
+                                    const EBookIndexedBook& previous);
+  static EBookIndexedBook readBook(const QString& path);
+  static bool writeBook(const QString& directory, const EBookIndexedBook& book);
+  static QString bookPath(const QString& directory, quint64 uid);
+  static QStringList words(const QString& text);
+
+protected:
+  struct ChapterRef
+  {
+    quint64 uid;
+    int chapter;
+  };
+
+  QString m_directory;
+  QHash<quint64, EBookIndexedBook> m_books;
+  QHash<QString, QVector<ChapterRef>> m_terms;
+
+  void unindexBook(quint64 uid);
+  static QHash<QString, QByteArray> indexText(const QString& text);
+  static QByteArray encodePostings(const QHash<QString, QByteArray>& terms);
+  static bool decodePostings(const QByteArray& postings,
+                             QHash<QString, QByteArray>& terms);
+  static void appendVarint(QByteArray& data, quint32 value);
+  static bool readVarint(const char*& data, const char* end, quint32& value);
+
+  static const quint32 INDEX_MAGIC = 0x42494458; // BIDX
+  static const quint32 INDEX_VERSION = 1;
+  static const QString INDEX_SUFFIX;
+};
+
+#endif // SEARCHINDEX_H
@@ -1,6 +1,8 @@
 #include "series.h"
 
-quint64 EBookSeriesData::m_highest_uid = 0;
+#include "database.h"
+
+EBookUidGenerator EBookSeriesData::m_uids;
 
 EBookSeriesData::EBookSeriesData()
   : uid(0)
@@ -14,54 +16,113 @@ EBookSeriesDB::EBookSeriesDB()
 
 EBookSeriesDB::EBookSeriesDB(const EBookSeriesDB& other)
 {
+  QReadLocker locker(&other.m_lock);
   m_filename = other.m_filename;
   m_series_map = other.m_series_map;
   m_series_by_name = other.m_series_by_name;
   m_series_list = other.m_series_list;
+  m_series_completions = other.m_series_completions;
 }
 
 EBookSeriesDB::~EBookSeriesDB()
 {
-  saveSeries();
+  save();
 }
 
 void
 EBookSeriesDB::setFilename(QString filename)
 {
   m_filename = filename;
+  m_journal.setFilename(filename);
 }
 
 bool
 EBookSeriesDB::save()
 {
+  QWriteLocker locker(&m_lock);
+  if (m_database) {
+    m_dirty.clear();
+    m_removed.clear();
+    m_series_changed = false;
+    return m_database->commit();
+  }
   return saveSeries();
 }
 
+/*!
+ * \brief Loads the series from the database if one is set, otherwise from
+ * the yaml file.
+ *
+ * The first time an empty database is used the yaml file is read and copied
+ * into it.
+ */
 bool
 EBookSeriesDB::load(QString filename)
 {
   setFilename(filename);
+  QWriteLocker locker(&m_lock);
+  if (m_database) {
+    if (m_database->isEmpty("series") && QFile::exists(m_filename)) {
+      // addSeries() writes each series read to the database.
+      bool result = loadSeries();
+      m_database->commit();
+      return result;
+    }
+    return loadDatabase();
+  }
   return loadSeries();
 }
 
+/*!
+ * \brief Stores the series in database rather than the yaml file.
+ *
+ * Must be set before load() is called.
+ */
+void
+EBookSeriesDB::setDatabase(Database database)
+{
+  m_database = database;
+}
+
+SeriesMap
+EBookSeriesDB::seriesMap()
+{
+  QReadLocker locker(&m_lock);
+  return m_series_map;
+}
+
 SeriesList
 EBookSeriesDB::seriesList()
 {
+  QReadLocker locker(&m_lock);
   return m_series_list;
 }
 
 SeriesData
 EBookSeriesDB::series(quint64 uid)
 {
+  QReadLocker locker(&m_lock);
   return m_series_map.value(uid);
 }
 
 SeriesData
 EBookSeriesDB::seriesByName(QString name)
 {
+  QReadLocker locker(&m_lock);
   return m_series_by_name.value(name.toLower());
 }
 
+/*!
+ * \brief The names of the series that start with prefix, ignoring case and
+ * accents.
+ */
+QStringList
+EBookSeriesDB::completeSeries(const QString& prefix, int limit)
+{
+  QReadLocker locker(&m_lock);
+  return m_series_completions.complete(prefix, limit);
+}
+
 bool
 EBookSeriesDB::loadSeries()
 {
@@ -82,68 +143,134 @@ EBookSeriesDB::loadSeries()
         //          YAML::Node series_node = it->second;
         series->name = it->second["name"].as<QString>();
 
-        EBookSeriesData::m_highest_uid =
-          (series->uid > EBookSeriesData::m_highest_uid
-             ? series->uid
-             : EBookSeriesData::m_highest_uid);
+        EBookSeriesData::m_uids.reserve(series->uid);
+        addSeries(series);
+      }
+    }
+  }
 
-        insertSeries(series);
+  // the changes saved since the file was last written.
+  for (const YAML::Node& change : m_journal.read()) {
+    if (!change.IsMap()) {
+      continue;
+    }
+    for (YAML::const_iterator it = change.begin(); it != change.end(); ++it) {
+      quint64 uid = it->first.as<quint64>();
+      if (m_series_map.contains(uid)) {
+        SeriesData old = m_series_map.take(uid);
+        m_series_by_name.remove(old->name.toLower());
+        m_series_list.removeOne(old->name);
+        m_series_completions.remove(old->name);
       }
+      if (it->second.IsNull()) { // removed
+        continue;
+      }
+      SeriesData series = SeriesData(new EBookSeriesData());
+      series->uid = uid;
+      series->name = it->second["name"].as<QString>();
+      EBookSeriesData::m_uids.reserve(uid);
+      addSeries(series);
     }
-    m_series_changed = false;
   }
+  m_dirty.clear();
+  m_removed.clear();
+  m_series_changed = false;
 
   return true;
 }
 
+/*!
+ * \brief Saves the series changed since the last save.
+ *
+ * As with EBookLibraryDB only the changes are appended to the journal
+ * until it is large enough to be folded back into the file.
+ */
 bool
 EBookSeriesDB::saveSeries()
 {
-  if (m_filename.isEmpty())
+  if (m_filename.isEmpty() || !m_series_changed) {
     return false;
+  }
+  bool result;
+  if (!QFile::exists(m_filename) || m_journal.needsCompaction() ||
+      (m_dirty.isEmpty() && m_removed.isEmpty())) {
+    result = writeSeriesFile();
+    if (result) {
+      m_journal.clear();
+    }
+  } else {
+    YAML::Emitter emitter;
+    emitter << YAML::BeginMap;
+    foreach (quint64 uid, m_dirty) {
+      SeriesData data = m_series_map.value(uid);
+      if (data) {
+        emitter << YAML::Key << uid;
+        emitter << YAML::Value;
+        emitter << YAML::BeginMap;
+        emitter << YAML::Key << "name";
+        emitter << YAML::Value << data->name;
+        emitter << YAML::EndMap;
+      }
+    }
+    foreach (quint64 uid, m_removed) {
+      emitter << YAML::Key << uid;
+      emitter << YAML::Value << YAML::Null;
+    }
+    emitter << YAML::EndMap;
+    result = m_journal.append(QString::fromUtf8(emitter.c_str()));
+  }
+  if (result) {
+    m_dirty.clear();
+    m_removed.clear();
+    m_series_changed = false;
+  }
+  return result;
+}
 
+bool
+EBookSeriesDB::writeSeriesFile()
+{
   QFile file(m_filename);
-  if (m_series_changed) {
-    if (file.open((QFile::ReadWrite | QFile::Truncate))) {
-      YAML::Emitter emitter;
-      emitter << YAML::Comment(
-        QString("A YAML File is supposed to be user readable/editable but\n"
-                "you need to be careful when manually editing.\n"
-                "Remember that the uid numbers stand for unique identifier\n"
-                "so if you edit these MAKE SURE THAT THEY ARE UNIQUE. If\n"
-                "you repeat one the second will overwrite the first."));
-
-      emitter << YAML::BeginMap; // series map
-      {
-        foreach (SeriesData data, m_series_map) {
-          emitter << YAML::Key << data->uid; // map key
-          emitter << YAML::Value;
-          emitter << YAML::BeginMap; // individual series data
-          emitter << YAML::Key << "name";
-          emitter << YAML::Value << data->name;
-          emitter << YAML::EndMap; // end individual series data
-        }
-      }
-      emitter << YAML::EndMap; // end series map
+  if (!file.open((QFile::ReadWrite | QFile::Truncate))) {
+    return false;
+  }
+  YAML::Emitter emitter;
+  emitter << YAML::Comment(
+    QString("A YAML File is supposed to be user readable/editable but\n"
+            "you need to be careful when manually editing.\n"
+            "Remember that the uid numbers stand for unique identifier\n"
+            "so if you edit these MAKE SURE THAT THEY ARE UNIQUE. If\n"
+            "you repeat one the second will overwrite the first.\n"
+            "Recent changes may be in the .journal file beside this one."));
 
-      QTextStream out(&file);
-      out << emitter.c_str();
+  emitter << YAML::BeginMap; // series map
+  {
+    foreach (SeriesData data, m_series_map) {
+      emitter << YAML::Key << data->uid; // map key
+      emitter << YAML::Value;
+      emitter << YAML::BeginMap; // individual series data
+      emitter << YAML::Key << "name";
+      emitter << YAML::Value << data->name;
+      emitter << YAML::EndMap; // end individual series data
     }
-
-    return true;
   }
-  return false;
+  emitter << YAML::EndMap; // end series map
+
+  QTextStream out(&file);
+  out << emitter.c_str();
+  return true;
 }
 
 quint64
 EBookSeriesDB::insertOrGetSeries(QString series)
 {
+  QWriteLocker locker(&m_lock);
   if (!m_series_by_name.contains(series.toLower())) {
     SeriesData series_data = SeriesData(new EBookSeriesData());
     quint64 uid = series_data->nextUid();
     series_data->uid = uid;
     series_data->name = series;
-    insertSeries(series_data);
+    addSeries(series_data);
     return uid;
   }
   return m_series_by_name.value(series.toLower())->uid;
@@ -151,20 +278,81 @@ EBookSeriesDB::insertOrGetSeries(QString series)
 
 void
 EBookSeriesDB::insertSeries(SeriesData series_data)
+{
+  QWriteLocker locker(&m_lock);
+  addSeries(series_data);
+}
+
+/*!
+ * \brief Adds a series, the caller must hold the write lock.
+ */
+void
+EBookSeriesDB::addSeries(SeriesData series_data)
 {
   m_series_map.insert(series_data->uid, series_data);
   m_series_by_name.insert(series_data->name.toLower(), series_data);
   m_series_list.append(series_data->name);
+  m_series_completions.insert(series_data->name);
+  m_dirty.insert(series_data->uid);
+  m_removed.remove(series_data->uid);
+  m_series_changed = true;
+  if (m_database) {
+    writeSeries(series_data);
+  }
 }
 
 bool
 EBookSeriesDB::removeSeries(quint64 index)
 {
+  QWriteLocker locker(&m_lock);
   if (m_series_map.contains(index)) {
     SeriesData data = m_series_map.value(index);
     m_series_map.remove(index);
     m_series_list.removeOne(data->name);
+    m_series_completions.remove(data->name);
+    m_dirty.remove(index);
+    m_removed.insert(index);
+    m_series_changed = true;
+    if (m_database) {
+      QSqlQuery query = m_database->prepare("DELETE FROM series WHERE uid = ?");
+      query.addBindValue(index);
+      m_database->exec(query);
+    }
     return true;
   }
   return false;
 }
+
+bool
+EBookSeriesDB::loadDatabase()
+{
+  QSqlQuery query = m_database->prepare("SELECT uid, name FROM series");
+  if (!query.exec()) {
+    return false;
+  }
+  while (query.next()) {
+    SeriesData series = SeriesData(new EBookSeriesData());
+    series->uid = query.value(0).toULongLong();
+    series->name = query.value(1).toString();
+
+    EBookSeriesData::m_uids.reserve(series->uid);
+
+    m_series_map.insert(series->uid, series);
+    m_series_by_name.insert(series->name.toLower(), series);
+    m_series_list.append(series->name);
+    m_series_completions.insert(series->name);
+  }
+  m_series_changed = false;
+  return true;
+}
+
+void
+EBookSeriesDB::writeSeries(SeriesData series_data)
+{
+  QSqlQuery query = m_database->prepare(
+    "INSERT OR REPLACE INTO series (uid, name, name_lower) VALUES (?, ?, ?)");
+  query.addBindValue(series_data->uid);
+  query.addBindValue(series_data->name);
+  query.addBindValue(series_data->name.toLower());
+  m_database->exec(query);
+}
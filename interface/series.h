@@ -3,10 +3,20 @@
 
 #include <QFile>
 #include <QObject>
+#include <QReadWriteLock>
+#include <QSet>
 #include <QTextStream>
 
 #include <qyaml-cpp/QYamlCpp>
 
+#include "changejournal.h"
+#include "ebooknameindex.h"
+#include "uidgenerator.h"
+
+// see database.h, QtSql is only needed where the database is used.
+class EBookDatabase;
+typedef QSharedPointer<EBookDatabase> Database;
+
 struct EBookSeriesData
 {
   EBookSeriesData();
@@ -14,14 +24,20 @@ struct EBookSeriesData
   quint64 uid;
   QString name;
 
-  static quint64 m_highest_uid;
-  static quint64 nextUid() { return ++m_highest_uid; }
+  static EBookUidGenerator m_uids;
+  static quint64 nextUid() { return m_uids.next(); }
 };
 typedef QSharedPointer<EBookSeriesData> SeriesData;
 typedef QMap<quint64, SeriesData> SeriesMap;
 typedef QMap<QString, SeriesData> SeriesByString;
 typedef QStringList SeriesList;
 
+/*!
+ * \brief The series of the library books.
+ *
+ * Any thread may read the series, only the thread that owns the database
+ * may change them. The series records are never changed once inserted.
+ */
 class EBookSeriesDB : public QObject
 {
   Q_OBJECT
@@ -34,16 +50,21 @@ public:
   void setFilename(QString filename);
   bool save();
   bool load(QString filename);
+  void setDatabase(Database database);
 
   // series data stuff
   quint64 insertOrGetSeries(QString series);
   void insertSeries(SeriesData series_data);
   bool removeSeries(quint64 index);
 
-  SeriesMap seriesMap() { return m_series_map; }
+  SeriesMap seriesMap();
   SeriesList seriesList();
   SeriesData series(quint64 uid);
   SeriesData seriesByName(QString name);
+  QStringList completeSeries(const QString& prefix,
+                             int limit = COMPLETION_LIMIT);
+
+  static const int COMPLETION_LIMIT = 20; // suggestions offered at once.
 
 protected:
   QString m_filename;
@@ -51,11 +72,21 @@ protected:
   SeriesMap m_series_map;
   SeriesByString m_series_by_name;
   SeriesList m_series_list;
+  EBookNameIndex m_series_completions;
+  // the series changed and removed since the last save.
+  QSet<quint64> m_dirty;
+  QSet<quint64> m_removed;
+  EBookChangeJournal m_journal;
+  Database m_database;
+  // guards the maps, the yaml file and database are only used by the owner.
+  mutable QReadWriteLock m_lock;
 
   bool loadSeries();
   bool saveSeries();
-
-  static quint64 m_highest_uid;
+  bool writeSeriesFile();
+  bool loadDatabase();
+  void addSeries(SeriesData series_data);
+  void writeSeries(SeriesData series_data);
 };
 typedef QSharedPointer<EBookSeriesDB> SeriesDB;
 
@@ -0,0 +1,31 @@
+#include "uidgenerator.h"
+
+EBookUidGenerator::EBookUidGenerator(quint64 highest)
+  : m_highest(highest)
+{}
+
+/*!
+ * \brief Returns a new id, one higher than any handed out or reserved.
+ */
+quint64
+EBookUidGenerator::next()
+{
+  return m_highest.fetchAndAddOrdered(1) + 1;
+}
+
+/*!
+ * \brief Marks uid as used.
+ */
+void
+EBookUidGenerator::reserve(quint64 uid)
+{
+  quint64 highest = m_highest.loadAcquire();
+  while (uid > highest && !m_highest.testAndSetOrdered(highest, uid, highest)) {
+  }
+}
+
+quint64
+EBookUidGenerator::highest() const
+{
+  return m_highest.loadAcquire();
+}
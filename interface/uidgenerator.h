@@ -0,0 +1,26 @@
+#ifndef UIDGENERATOR_H
+#define UIDGENERATOR_H
+
+#include <QAtomicInteger>
+
+/*!
+ * \brief Hands out unique ids from any thread.
+ *
+ * The library, author and series records each share one of these, ids
+ * read back from a file or database are passed to reserve() so that they
+ * are never handed out again.
+ */
+class EBookUidGenerator
+{
+public:
+  explicit EBookUidGenerator(quint64 highest = 0);
+
+  quint64 next();
+  void reserve(quint64 uid);
+  quint64 highest() const;
+
+protected:
+  QAtomicInteger<quint64> m_highest;
+};
+
+#endif // UIDGENERATOR_H
@@ -0,0 +1,161 @@
+#include "wordtokenizer.h"
+
+#include <QTextBoundaryFinder>
+
+namespace {
+
+/* Character classes for the Latin-1 range. */
+struct Latin1Table
+{
+  enum
+  {
+    WORD = 1,   // can be part of a word.
+    LETTER = 2, // a letter, every word must hold one.
+  };
+  quint8 flags[256];
+
+  Latin1Table()
+  {
+    for (int c = 0; c < 256; c++) {
+      bool letter = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                    c == 0xAA || c == 0xB5 || c == 0xBA ||
+                    (c >= 0xC0 && c != 0xD7 && c != 0xF7);
+      bool digit = (c >= '0' && c <= '9');
+      flags[c] = (letter ? WORD | LETTER : 0) | (digit ? WORD : 0);
+    }
+  }
+};
+
+const Latin1Table latin1_table;
+
+inline quint8
+latin1Flags(QChar c)
+{
+  ushort u = c.unicode();
+  return (u < 256 ? latin1_table.flags[u] : 0);
+}
+
+} // end of anonymous namespace
+
+/*!
+ * \brief Finds the words of text.
+ */
+WordSpans
+EBookWordTokenizer::words(QStringView text)
+{
+  WordSpans spans;
+  const QChar* data = text.data();
+  int length = text.size();
+  for (int i = 0; i < length; i++) {
+    if (data[i].unicode() > 0xFF && !isApostrophe(data[i])) {
+      unicodeWords(text, spans);
+      return spans;
+    }
+  }
+  latin1Words(text, spans);
+  return spans;
+}
+
+/*!
+ * \brief Returns the words of text as strings.
+ */
+QStringList
+EBookWordTokenizer::wordList(const QString& text)
+{
+  QStringList list;
+  WordSpans spans = words(QStringView(text));
+  list.reserve(spans.size());
+  for (const EBookWordSpan& span : spans) {
+    list.append(text.mid(span.start, span.length));
+  }
+  return list;
+}
+
+/*!
+ * \brief true if c can be part of a word.
+ */
+bool
+EBookWordTokenizer::isWordChar(QChar c)
+{
+  if (c.unicode() < 256) {
+    return (latin1Flags(c) & Latin1Table::WORD) != 0;
+  }
+  return c.isLetterOrNumber() || c.isMark();
+}
+
+bool
+EBookWordTokenizer::isApostrophe(QChar c)
+{
+  return (c == '\'' || c.unicode() == 0x2019);
+}
+
+void
+EBookWordTokenizer::latin1Words(QStringView text, WordSpans& spans)
+{
+  const QChar* data = text.data();
+  int length = text.size();
+  int i = 0;
+  while (i < length) {
+    while (i < length && !(latin1Flags(data[i]) & Latin1Table::WORD)) {
+      i++;
+    }
+    int start = i;
+    bool letter = false;
+    while (i < length) {
+      quint8 flags = latin1Flags(data[i]);
+      if (flags & Latin1Table::WORD) {
+        letter |= (flags & Latin1Table::LETTER) != 0;
+        i++;
+      } else if (isApostrophe(data[i]) && i > start && i + 1 < length &&
+                 (latin1Flags(data[i + 1]) & Latin1Table::LETTER)) {
+        i++;
+      } else {
+        break;
+      }
+    }
+    if (i > start && letter) {
+      EBookWordSpan span;
+      span.start = start;
+      span.length = i - start;
+      spans.append(span);
+    }
+  }
+}
+
+/*!
+ * \brief Splits text on the unicode word boundaries, which already keep an
+ * apostrophe between letters inside the word.
+ */
+void
+EBookWordTokenizer::unicodeWords(QStringView text, WordSpans& spans)
+{
+  QTextBoundaryFinder finder(
+    QTextBoundaryFinder::Word, text.data(), text.size());
+  int start = 0;
+  while (start >= 0 && start < text.size()) {
+    int end = finder.toNextBoundary();
+    if (end < 0) {
+      break;
+    }
+    QStringView word = text.mid(start, end - start);
+    if ((finder.boundaryReasons() & QTextBoundaryFinder::EndOfItem) &&
+        hasLetter(word)) {
+      EBookWordSpan span;
+      span.start = start;
+      span.length = end - start;
+      spans.append(span);
+    }
+    start = end;
+  }
+}
+
+bool
+EBookWordTokenizer::hasLetter(QStringView word)
+{
+  for (QChar c : word) {
+    if (c.isLetter()) {
+      return true;
+    }
+  }
+  return false;
+}
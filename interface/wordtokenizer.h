@@ -0,0 +1,44 @@
+#ifndef WORDTOKENIZER_H
+#define WORDTOKENIZER_H
+
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+#include <QVector>
+
+/*!
+ * \brief A word found by EBookWordTokenizer, as an offset into the text.
+ */
+struct EBookWordSpan
+{
+  int start = 0;
+  int length = 0;
+};
+typedef QVector<EBookWordSpan> WordSpans;
+
+/*!
+ * \brief Splits plain text, normally the text of a single QTextBlock, into
+ * the words that are spell checked.
+ *
+ * Text that is all Latin-1, which is nearly all of an english book, is
+ * classified from a lookup table. Anything else is split with a
+ * QTextBoundaryFinder. Either way an apostrophe, straight or curly, between
+ * two letters is part of the word so don't and o'clock are single words,
+ * while quotes around a word are not. Words without any letter, numbers for
+ * example, are skipped.
+ */
+class EBookWordTokenizer
+{
+public:
+  static WordSpans words(QStringView text);
+  static QStringList wordList(const QString& text);
+  static bool isWordChar(QChar c);
+
+protected:
+  static bool isApostrophe(QChar c);
+  static void latin1Words(QStringView text, WordSpans& spans);
+  static void unicodeWords(QStringView text, WordSpans& spans);
+  static bool hasLetter(QStringView word);
+};
+
+#endif // WORDTOKENIZER_H
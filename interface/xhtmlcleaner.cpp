@@ -0,0 +1,412 @@
+#include "xhtmlcleaner.h"
+
+#include "lookuptable.h"
+
+const QString XhtmlCleaner::XHTML_NAMESPACE = "http://www.w3.org/1999/xhtml";
+const QString XhtmlCleaner::EPUB_NAMESPACE = "http://www.idpf.org/2007/ops";
+
+// the html named entities that turn up in books, sorted by name.
+static constexpr LookupEntry<ushort> HTML_ENTITIES[] = {
+  { "bull", 0x2022 },   { "cent", 0x00A2 },   { "copy", 0x00A9 },
+  { "deg", 0x00B0 },    { "emsp", 0x2003 },   { "ensp", 0x2002 },
+  { "euro", 0x20AC },   { "hellip", 0x2026 }, { "laquo", 0x00AB },
+  { "ldquo", 0x201C },  { "lsquo", 0x2018 },  { "mdash", 0x2014 },
+  { "middot", 0x00B7 }, { "nbsp", 0x00A0 },   { "ndash", 0x2013 },
+  { "para", 0x00B6 },   { "pound", 0x00A3 },  { "raquo", 0x00BB },
+  { "rdquo", 0x201D },  { "reg", 0x00AE },    { "rsquo", 0x2019 },
+  { "sect", 0x00A7 },   { "shy", 0x00AD },    { "thinsp", 0x2009 },
+  { "times", 0x00D7 },  { "trade", 0x2122 },  { "yen", 0x00A5 },
+  { "zwj", 0x200D },    { "zwnj", 0x200C },
+};
+static_assert(LookupTable::isSorted(HTML_ENTITIES),
+              "html entities must be sorted");
+
+XhtmlCleaner::XhtmlCleaner(const QString& html)
+  : m_html(html)
+{}
+
+/*!
+ * \brief Returns html as a well formed xhtml document.
+ *
+ * \param title if not null is set to the text of the first h1, h2 or h3,
+ *        or of the title element if there is no heading.
+ */
+QString
+XhtmlCleaner::clean(const QString& html, QString* title)
+{
+  XhtmlCleaner cleaner(html);
+  cleaner.run();
+  if (title) {
+    QString text =
+      (cleaner.m_heading.isEmpty() ? cleaner.m_title : cleaner.m_heading);
+    *title = text.simplified();
+  }
+  return cleaner.document();
+}
+
+void
+XhtmlCleaner::run()
+{
+  m_markup.reserve(m_html.size() + m_html.size() / 8);
+  XhtmlTokenizer tokenizer(m_html);
+  while (!tokenizer.atEnd()) {
+    XhtmlToken token = tokenizer.next();
+    switch (token.type) {
+      case XhtmlToken::TAG_START:
+        if (token.closing) {
+          endTag(tokenizer, token);
+        } else {
+          startTag(tokenizer, token);
+        }
+        break;
+      case XhtmlToken::TEXT:
+      case XhtmlToken::ERROR:
+        addText(token.text);
+        break;
+      case XhtmlToken::ENTITY:
+        addEntity(token.text);
+        break;
+      case XhtmlToken::STYLE_TEXT:
+      case XhtmlToken::SCRIPT_TEXT: {
+        QString text = token.text.toString();
+        if (text.contains('<') || text.contains('&')) {
+          m_markup += "/*<![CDATA[*/" + text + "/*]]>*/";
+        } else {
+          m_markup += text;
+        }
+        break;
+      }
+      case XhtmlToken::COMMENT: {
+        // an unfinished comment would swallow the rest of the document.
+        QString text = token.text.toString();
+        if (text.size() >= 7 && text.endsWith("-->")) {
+          m_markup += text;
+        }
+        break;
+      }
+      default:
+        // declarations are replaced by our own.
+        break;
+    }
+  }
+  closeTo(0);
+}
+
+/*
+ * The tag name has been read, the attributes are collected up to the end of
+ * the tag so that they can be checked before the tag is written.
+ */
+void
+XhtmlCleaner::startTag(XhtmlTokenizer& tokenizer, const XhtmlToken& start)
+{
+  QString name = start.name.toString();
+  if (!isKnownPrefix(start.name, false)) {
+    skipTag(tokenizer);
+    return;
+  }
+  if (!inSvg()) {
+    name = name.toLower();
+  }
+
+  QVector<Attribute> attributes;
+  QString attribute_name;
+  bool empty = false;
+  while (!tokenizer.atEnd()) {
+    XhtmlToken token = tokenizer.next();
+    if (token.type == XhtmlToken::TAG_END) {
+      empty = token.closing;
+      break;
+    }
+    if (token.type == XhtmlToken::ATTRIBUTE_NAME) {
+      if (!attribute_name.isEmpty()) {
+        // the last attribute had no value.
+        attributes.append(Attribute(attribute_name, attribute_name));
+      }
+      attribute_name = (isKnownPrefix(token.name, true) ? token.name.toString()
+                                                         : QString());
+    } else if (token.type == XhtmlToken::ATTRIBUTE_VALUE) {
+      if (!attribute_name.isEmpty()) {
+        attributes.append(Attribute(attribute_name, token.name.toString()));
+      }
+      attribute_name.clear();
+    }
+  }
+  if (!attribute_name.isEmpty()) {
+    attributes.append(Attribute(attribute_name, attribute_name));
+  }
+
+  if (name == "html") {
+    if (m_has_html) {
+      return;
+    }
+    m_has_html = true;
+    attributes.prepend(Attribute("xmlns:epub", EPUB_NAMESPACE));
+    attributes.prepend(Attribute("xmlns", XHTML_NAMESPACE));
+  } else if (name == "head") {
+    m_has_head = true;
+  } else if (name == "body") {
+    m_has_body = true;
+  }
+
+  m_markup += '<';
+  m_markup += name;
+  QStringList written;
+  foreach (const Attribute& attribute, attributes) {
+    if (written.contains(attribute.first)) {
+      continue;
+    }
+    written.append(attribute.first);
+    m_markup += ' ';
+    m_markup += attribute.first;
+    m_markup += "=\"";
+    m_markup += escape(attribute.second, true);
+    m_markup += '"';
+  }
+
+  if (empty || isVoidElement(name)) {
+    m_markup += "/>";
+    return;
+  }
+  m_markup += '>';
+  m_open.append(name);
+  // only the text of the first heading and title is kept.
+  if ((name == "h1" || name == "h2" || name == "h3") && m_heading.isEmpty() &&
+      m_heading_depth == 0) {
+    m_heading_depth = m_open.size();
+  } else if (name == "title" && m_title.isEmpty() && m_title_depth == 0) {
+    m_title_depth = m_open.size();
+  }
+}
+
+void
+XhtmlCleaner::endTag(XhtmlTokenizer& tokenizer, const XhtmlToken& start)
+{
+  skipTag(tokenizer);
+  QString name = start.name.toString();
+  if (!inSvg()) {
+    name = name.toLower();
+  }
+  int index = m_open.lastIndexOf(name);
+  if (index >= 0) {
+    closeTo(index);
+  }
+}
+
+/*
+ * Closes the open elements from the innermost out to index.
+ */
+void
+XhtmlCleaner::closeTo(int index)
+{
+  while (m_open.size() > index) {
+    QString name = m_open.takeLast();
+    m_markup += "</";
+    m_markup += name;
+    m_markup += '>';
+    if (name == "head") {
+      m_head_end = m_markup.size();
+    }
+    if (m_open.size() < m_heading_depth) {
+      m_heading_depth = -1; // done.
+    }
+    if (m_open.size() < m_title_depth) {
+      m_title_depth = -1;
+    }
+  }
+}
+
+void
+XhtmlCleaner::addText(QStringView text)
+{
+  QString plain = text.toString();
+  m_markup += escape(plain, false);
+  addTitleText(plain);
+}
+
+void
+XhtmlCleaner::addEntity(QStringView text)
+{
+  m_markup += entity(text);
+  addTitleText(decode(text));
+}
+
+void
+XhtmlCleaner::addTitleText(const QString& text)
+{
+  if (m_heading_depth > 0 && m_heading.size() < MAX_TITLE_LENGTH) {
+    m_heading += text;
+  }
+  if (m_title_depth > 0 && m_title.size() < MAX_TITLE_LENGTH) {
+    m_title += text;
+  }
+}
+
+/*
+ * The cleaned markup with an xml declaration, wrapped in whatever html,
+ * head and body elements it was missing.
+ */
+QString
+XhtmlCleaner::document() const
+{
+  QString document = "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+                     "<!DOCTYPE html>\n";
+  if (m_has_html) {
+    return document + m_markup;
+  }
+  document += QString("<html xmlns=\"%1\" xmlns:epub=\"%2\">\n")
+                .arg(XHTML_NAMESPACE, EPUB_NAMESPACE);
+  if (m_has_body) {
+    return document + m_markup + "\n</html>\n";
+  }
+  if (m_has_head) {
+    document += m_markup.left(m_head_end);
+  } else {
+    document += QString("<head>\n<title>%1</title>\n</head>\n")
+                  .arg(escape(m_heading.simplified(), false));
+  }
+  return document + "<body>\n" + m_markup.mid(m_head_end) +
+         "\n</body>\n</html>\n";
+}
+
+bool
+XhtmlCleaner::inSvg() const
+{
+  return m_open.contains("svg");
+}
+
+void
+XhtmlCleaner::skipTag(XhtmlTokenizer& tokenizer)
+{
+  while (!tokenizer.atEnd()) {
+    if (tokenizer.next().type == XhtmlToken::TAG_END) {
+      return;
+    }
+  }
+}
+
+bool
+XhtmlCleaner::isVoidElement(const QString& name)
+{
+  static const QStringList VOID_ELEMENTS = {
+    "area", "base",  "br",    "col",    "embed", "hr",  "img",
+    "input", "link", "meta",  "param",  "source", "track", "wbr",
+  };
+  return VOID_ELEMENTS.contains(name);
+}
+
+/*
+ * Only the prefixes that an epub reader knows are kept, anything else would
+ * make the document badly formed as its namespace is never declared.
+ */
+bool
+XhtmlCleaner::isKnownPrefix(QStringView name, bool attribute)
+{
+  QString text = name.toString();
+  int colon = text.indexOf(':');
+  if (colon < 0) {
+    return true;
+  }
+  QString prefix = text.left(colon);
+  return (attribute && (prefix == "xml" || prefix == "xmlns" ||
+                        prefix == "xlink" || prefix == "epub"));
+}
+
+/*
+ * Entities already in the text are kept, as character references if xml
+ * does not know them, any other '&' is escaped.
+ */
+QString
+XhtmlCleaner::escape(const QString& text, bool attribute)
+{
+  QString escaped;
+  escaped.reserve(text.size());
+  for (int i = 0; i < text.size(); i++) {
+    QChar c = text.at(i);
+    if (c == '&') {
+      int end = text.indexOf(';', i);
+      if (end > i + 1 && end - i < 34) {
+        QString value = entity(QStringView(text).mid(i, end - i + 1));
+        if (!value.startsWith(QLatin1String("&amp;"))) {
+          escaped += value;
+          i = end;
+          continue;
+        }
+      }
+      escaped += "&amp;";
+    } else if (c == '<') {
+      escaped += "&lt;";
+    } else if (c == '>') {
+      escaped += "&gt;";
+    } else if (c == '"' && attribute) {
+      escaped += "&quot;";
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+/*
+ * An entity as xml can read it. Unknown entities are escaped so that they
+ * show as written.
+ */
+QString
+XhtmlCleaner::entity(QStringView entity)
+{
+  QStringView name = entity.mid(1, entity.size() - 2);
+  if (name.isEmpty()) {
+    return "&amp;" + entity.mid(1).toString();
+  }
+  if (name.at(0) == '#') {
+    bool ok = false;
+    uint code;
+    if (name.size() > 1 && (name.at(1) == 'x' || name.at(1) == 'X')) {
+      code = name.mid(2).toString().toUInt(&ok, 16);
+    } else {
+      code = name.mid(1).toString().toUInt(&ok, 10);
+    }
+    if (ok && code > 0 && code <= 0x10FFFF) {
+      return entity.toString();
+    }
+  } else if (XhtmlTokenizer::equals(name, QLatin1String("amp")) ||
+             XhtmlTokenizer::equals(name, QLatin1String("lt")) ||
+             XhtmlTokenizer::equals(name, QLatin1String("gt")) ||
+             XhtmlTokenizer::equals(name, QLatin1String("quot")) ||
+             XhtmlTokenizer::equals(name, QLatin1String("apos"))) {
+    return entity.toString();
+  } else {
+    ushort code = LookupTable::find(HTML_ENTITIES, name, ushort(0));
+    if (code) {
+      return QString("&#%1;").arg(code);
+    }
+  }
+  return "&amp;" + entity.mid(1).toString();
+}
+
+/*!
+ * \brief The character of an entity, or the entity as written if it is
+ * unknown.
+ */
+QString
+XhtmlCleaner::decode(QStringView text)
+{
+  QString value = entity(text);
+  if (value.startsWith("&#")) {
+    bool ok = false;
+    uint code = (value.at(2) == 'x' || value.at(2) == 'X'
+                   ? value.mid(3, value.size() - 4).toUInt(&ok, 16)
+                   : value.mid(2, value.size() - 3).toUInt(&ok, 10));
+    return (ok ? QString::fromUcs4(&code, 1) : QString());
+  } else if (value == "&amp;") {
+    return "&";
+  } else if (value == "&lt;") {
+    return "<";
+  } else if (value == "&gt;") {
+    return ">";
+  } else if (value == "&quot;") {
+    return "\"";
+  } else if (value == "&apos;") {
+    return "'";
+  }
+  return text.toString();
+}
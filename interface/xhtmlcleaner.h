@@ -0,0 +1,78 @@
+#ifndef XHTMLCLEANER_H
+#define XHTMLCLEANER_H
+
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+#include <QVector>
+
+#include "xhtmltokenizer.h"
+
+/*!
+ * \brief Makes well formed xhtml of the loose html found in books, mobi
+ * markup for instance, so that it can be written into an epub.
+ *
+ * A single pass is made over the text with XhtmlTokenizer:
+ * - element names are lower cased outside of svg and void elements are
+ *   closed,
+ * - attribute values are quoted and escaped, attributes with no value are
+ *   given their name as a value and repeated attributes are dropped,
+ * - closing tags close any element left open inside them, closing tags
+ *   with no open element are dropped, and anything still open at the end is
+ *   closed,
+ * - elements and attributes with an undeclared prefix, mbp:pagebreak for
+ *   instance, are dropped, the content of the elements is kept,
+ * - stray '<' and '&' are escaped and the html named entities that xml does
+ *   not know are written as character references,
+ * - the declarations are replaced and the document is wrapped in html, head
+ *   and body elements if it has none.
+ */
+class XhtmlCleaner
+{
+public:
+  static QString clean(const QString& html, QString* title = nullptr);
+  static QString decode(QStringView entity);
+
+protected:
+  typedef QPair<QString, QString> Attribute;
+
+  XhtmlCleaner(const QString& html);
+
+  QString m_html;
+  QString m_markup;
+  QStringList m_open; // the open elements, innermost last.
+  bool m_has_html = false;
+  bool m_has_head = false;
+  bool m_has_body = false;
+  int m_head_end = 0; // the end of the head element in m_markup.
+  // the depth of the first heading and title element while inside them,
+  // -1 once they have been read.
+  int m_heading_depth = 0;
+  int m_title_depth = 0;
+  QString m_heading;
+  QString m_title;
+
+  void run();
+  void startTag(XhtmlTokenizer& tokenizer, const XhtmlToken& start);
+  void endTag(XhtmlTokenizer& tokenizer, const XhtmlToken& start);
+  void closeTo(int index);
+  void addText(QStringView text);
+  void addEntity(QStringView entity);
+  void addTitleText(const QString& text);
+  QString document() const;
+  bool inSvg() const;
+
+  static void skipTag(XhtmlTokenizer& tokenizer);
+  static bool isVoidElement(const QString& name);
+  static bool isKnownPrefix(QStringView name, bool attribute);
+  static QString escape(const QString& text, bool attribute);
+  static QString entity(QStringView entity);
+
+  static const int MAX_TITLE_LENGTH = 256;
+
+  static const QString XHTML_NAMESPACE;
+  static const QString EPUB_NAMESPACE;
+};
+
+#endif // XHTMLCLEANER_H
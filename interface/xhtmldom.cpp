@@ -0,0 +1,437 @@
+#include "xhtmldom.h"
+
+#include <new>
+
+#include <QVarLengthArray>
+
+#include "xhtmltokenizer.h"
+
+bool
+XhtmlDomNode::nameIs(QLatin1String value) const
+{
+  return (type == ELEMENT && XhtmlTokenizer::equals(name, value));
+}
+
+bool
+XhtmlDomNode::hasAttribute(QLatin1String attribute_name) const
+{
+  for (int i = 0; i < attribute_count; i++) {
+    if (XhtmlTokenizer::equals(attributes[i].name, attribute_name)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/*!
+ * \brief The value of an attribute, or an empty view if the node does not
+ * have it.
+ */
+QStringView
+XhtmlDomNode::attribute(QLatin1String attribute_name) const
+{
+  for (int i = 0; i < attribute_count; i++) {
+    if (XhtmlTokenizer::equals(attributes[i].name, attribute_name)) {
+      return attributes[i].value;
+    }
+  }
+  return QStringView();
+}
+
+/*!
+ * \brief The source between the start and closing tags of an element, the
+ * whole source of any other node.
+ */
+QStringView
+XhtmlDomNode::content() const
+{
+  if (type != ELEMENT && type != DOCUMENT) {
+    return text;
+  }
+  return text.mid(content_start - start, content_end - content_start);
+}
+
+/*!
+ * \brief The node after this one in document order, children first, or
+ * nullptr once the nodes of within have all been gone through.
+ */
+XhtmlDomNode*
+XhtmlDomNode::next(const XhtmlDomNode* within) const
+{
+  if (first_child) {
+    return first_child;
+  }
+  const XhtmlDomNode* node = this;
+  while (node && node != within) {
+    if (node->next_sibling) {
+      return node->next_sibling;
+    }
+    node = node->parent;
+  }
+  return nullptr;
+}
+
+XhtmlDom::XhtmlDom()
+  : m_root(nullptr)
+  , m_node_count(0)
+  , m_free(nullptr)
+  , m_available(0)
+  , m_ids_built(false)
+{}
+
+XhtmlDom::XhtmlDom(const QString& source)
+  : XhtmlDom()
+{
+  parse(source);
+}
+
+XhtmlDom::~XhtmlDom()
+{
+  clear();
+}
+
+/*!
+ * \brief Builds the tree of source, dropping any earlier tree.
+ */
+void
+XhtmlDom::parse(const QString& source)
+{
+  clear();
+  m_source = source;
+  QStringView text(m_source);
+
+  m_root = createNode(XhtmlDomNode::DOCUMENT, 0, text.size(), nullptr);
+  m_root->content_start = 0;
+  m_root->content_end = text.size();
+
+  XhtmlDomNode* current = m_root;
+  // the element whose start tag is being read, if any.
+  XhtmlDomNode* open = nullptr;
+  bool in_closing_tag = false;
+  int closing_start = 0;
+  QStringView closing_name;
+  QVarLengthArray<XhtmlDomAttribute, 16> attributes;
+
+  XhtmlTokenizer tokenizer(text);
+  while (!tokenizer.atEnd()) {
+    XhtmlToken token = tokenizer.next();
+
+    switch (token.type) {
+      case XhtmlToken::TAG_START:
+        if (token.closing) {
+          in_closing_tag = true;
+          closing_start = token.start;
+          closing_name = token.name;
+        } else {
+          open = createNode(
+            XhtmlDomNode::ELEMENT, token.start, token.end(), current);
+          open->name = token.name;
+          attributes.clear();
+        }
+        break;
+
+      case XhtmlToken::ATTRIBUTE_NAME:
+        if (open) {
+          XhtmlDomAttribute attribute;
+          attribute.name = token.name;
+          attributes.append(attribute);
+        }
+        break;
+
+      case XhtmlToken::ATTRIBUTE_VALUE:
+        if (open && !attributes.isEmpty()) {
+          attributes.last().value = token.name;
+        }
+        break;
+
+      case XhtmlToken::TAG_END:
+        if (open) {
+          if (!attributes.isEmpty()) {
+            XhtmlDomAttribute* copy = static_cast<XhtmlDomAttribute*>(
+              allocate(int(sizeof(XhtmlDomAttribute)) * attributes.size()));
+            for (int i = 0; i < attributes.size(); i++) {
+              new (copy + i) XhtmlDomAttribute(attributes.at(i));
+            }
+            open->attributes = copy;
+            open->attribute_count = attributes.size();
+          }
+          open->content_start = token.end();
+          if (token.closing || isVoidElement(open->name)) {
+            close(open, token.end(), token.end());
+          } else {
+            current = open;
+          }
+          open = nullptr;
+
+        } else if (in_closing_tag) {
+          // elements left open inside the closed one are closed with it.
+          XhtmlDomNode* node = current;
+          while (node != m_root && node->name != closing_name) {
+            node = node->parent;
+          }
+          if (node != m_root) {
+            while (current != node) {
+              close(current, closing_start, closing_start);
+              current = current->parent;
+            }
+            close(node, closing_start, token.end());
+            current = node->parent;
+          }
+          in_closing_tag = false;
+        }
+        break;
+
+      case XhtmlToken::TAG_SPACE:
+      case XhtmlToken::TAG_EQUALS:
+        break;
+
+      default: {
+        XhtmlDomNode::Type type = XhtmlDomNode::TEXT;
+        if (token.type == XhtmlToken::ENTITY) {
+          type = XhtmlDomNode::ENTITY;
+        } else if (token.type == XhtmlToken::STYLE_TEXT ||
+                   token.type == XhtmlToken::SCRIPT_TEXT) {
+          type = XhtmlDomNode::RAW_TEXT;
+        } else if (token.type == XhtmlToken::COMMENT) {
+          type = XhtmlDomNode::COMMENT;
+        } else if (token.type == XhtmlToken::DECLARATION) {
+          type = XhtmlDomNode::DECLARATION;
+        }
+        XhtmlDomNode* node =
+          createNode(type, token.start, token.end(), current);
+        node->content_start = node->start;
+        node->content_end = node->end;
+        break;
+      }
+    }
+  }
+
+  // the source ended inside a tag or before closing tags.
+  if (open) {
+    open->content_start = text.size();
+    close(open, text.size(), text.size());
+  }
+  while (current != m_root) {
+    close(current, text.size(), text.size());
+    current = current->parent;
+  }
+}
+
+/*!
+ * \brief Drops the tree, all of the nodes go with the arena blocks.
+ */
+void
+XhtmlDom::clear()
+{
+  // the nodes and attributes only hold views, there is nothing to
+  // destruct.
+  foreach (char* block, m_blocks) {
+    delete[] block;
+  }
+  m_blocks.clear();
+  m_free = nullptr;
+  m_available = 0;
+  m_root = nullptr;
+  m_node_count = 0;
+  m_ids.clear();
+  m_ids_built = false;
+  m_source.clear();
+}
+
+/*!
+ * \brief The source that the nodes refer to.
+ */
+const QString&
+XhtmlDom::source() const
+{
+  return m_source;
+}
+
+/*!
+ * \brief The DOCUMENT node, nullptr if nothing has been parsed.
+ */
+XhtmlDomNode*
+XhtmlDom::root() const
+{
+  return m_root;
+}
+
+int
+XhtmlDom::nodeCount() const
+{
+  return m_node_count;
+}
+
+/*!
+ * \brief The first element named name in document order, searching the
+ * whole document if within is nullptr.
+ */
+XhtmlDomNode*
+XhtmlDom::firstElement(QLatin1String name, const XhtmlDomNode* within) const
+{
+  if (!within) {
+    within = m_root;
+  }
+  if (!within) {
+    return nullptr;
+  }
+  for (XhtmlDomNode* node = within->first_child; node;
+       node = node->next(within)) {
+    if (node->nameIs(name)) {
+      return node;
+    }
+  }
+  return nullptr;
+}
+
+/*!
+ * \brief The elements named name in document order.
+ */
+QVector<XhtmlDomNode*>
+XhtmlDom::elements(QLatin1String name, const XhtmlDomNode* within) const
+{
+  QVector<XhtmlDomNode*> found;
+  if (!within) {
+    within = m_root;
+  }
+  if (!within) {
+    return found;
+  }
+  for (XhtmlDomNode* node = within->first_child; node;
+       node = node->next(within)) {
+    if (node->nameIs(name)) {
+      found.append(node);
+    }
+  }
+  return found;
+}
+
+/*!
+ * \brief The element with the id, the first if there is more than one, or
+ * nullptr.
+ */
+XhtmlDomNode*
+XhtmlDom::elementById(QStringView id) const
+{
+  if (!m_root) {
+    return nullptr;
+  }
+  if (!m_ids_built) {
+    for (XhtmlDomNode* node = m_root->first_child; node;
+         node = node->next(m_root)) {
+      if (node->isElement()) {
+        QStringView value = node->attribute(QLatin1String("id"));
+        if (!value.isEmpty() && !m_ids.contains(value)) {
+          m_ids.insert(value, node);
+        }
+      }
+    }
+    m_ids_built = true;
+  }
+  return m_ids.value(id, nullptr);
+}
+
+/*!
+ * \brief The text of node and all of its descendants, entities are left as
+ * they are in the source.
+ */
+QString
+XhtmlDom::textContent(const XhtmlDomNode* node)
+{
+  QString text;
+  if (!node) {
+    return text;
+  }
+  if (node->type == XhtmlDomNode::TEXT || node->type == XhtmlDomNode::ENTITY) {
+    return node->text.toString();
+  }
+  for (XhtmlDomNode* child = node->first_child; child;
+       child = child->next(node)) {
+    if (child->type == XhtmlDomNode::TEXT ||
+        child->type == XhtmlDomNode::ENTITY) {
+      text.append(child->text);
+    }
+  }
+  return text;
+}
+
+/*!
+ * \brief true for the html elements that never have content.
+ */
+bool
+XhtmlDom::isVoidElement(QStringView name)
+{
+  static const char* const VOID_ELEMENTS[] = {
+    "area", "base",  "br",    "col",   "embed",  "hr",    "img",
+    "input", "link", "meta",  "param", "source", "track", "wbr",
+  };
+  for (const char* element : VOID_ELEMENTS) {
+    if (XhtmlTokenizer::equals(name, QLatin1String(element))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+ * Hands out size bytes of the current block, starting a new block when it
+ * is used up. Everything allocated is pointer aligned.
+ */
+void*
+XhtmlDom::allocate(int size)
+{
+  const int alignment = int(sizeof(void*));
+  size = (size + alignment - 1) & ~(alignment - 1);
+  if (size > m_available) {
+    int block_size = qMax(int(BLOCK_SIZE), size);
+    char* block = new char[block_size];
+    m_blocks.append(block);
+    m_free = block;
+    m_available = block_size;
+  }
+  void* memory = m_free;
+  m_free += size;
+  m_available -= size;
+  return memory;
+}
+
+XhtmlDomNode*
+XhtmlDom::createNode(XhtmlDomNode::Type type,
+                     int start,
+                     int end,
+                     XhtmlDomNode* parent)
+{
+  XhtmlDomNode* node = new (allocate(int(sizeof(XhtmlDomNode))))
+    XhtmlDomNode();
+  node->type = type;
+  node->start = start;
+  node->end = end;
+  node->content_start = node->content_end = end;
+  node->text = QStringView(m_source).mid(start, end - start);
+  node->attributes = nullptr;
+  node->attribute_count = 0;
+  node->parent = parent;
+  node->first_child = node->last_child = node->next_sibling = nullptr;
+  if (parent) {
+    if (parent->last_child) {
+      parent->last_child->next_sibling = node;
+    } else {
+      parent->first_child = node;
+    }
+    parent->last_child = node;
+  }
+  m_node_count++;
+  return node;
+}
+
+/*
+ * Sets the end of an element once its closing tag, or that of its parent,
+ * has been found.
+ */
+void
+XhtmlDom::close(XhtmlDomNode* node, int content_end, int end)
+{
+  node->content_end = qMax(node->content_start, content_end);
+  node->end = qMax(node->content_end, end);
+  node->text = QStringView(m_source).mid(node->start, node->end - node->start);
+}
@@ -0,0 +1,127 @@
+#ifndef XHTMLDOM_H
+#define XHTMLDOM_H
+
+#include <QHash>
+#include <QLatin1String>
+#include <QString>
+#include <QStringView>
+#include <QVector>
+
+/*!
+ * \brief An attribute of an XhtmlDomNode, both are views into the source.
+ */
+struct XhtmlDomAttribute
+{
+  QStringView name;
+  QStringView value; // without the quotes, entities are left as they are.
+};
+
+/*!
+ * \brief A node of an XhtmlDom.
+ *
+ * Nodes hold no data of their own, every name, value and text is a view
+ * into the source of the dom, and the node is only valid while the dom is.
+ * start and end are the offsets of the whole node in the source, for an
+ * element from the '<' of its start tag to just after the '>' of its
+ * closing tag, content_start and content_end those of what lies between
+ * the two tags.
+ */
+struct XhtmlDomNode
+{
+  enum Type
+  {
+    DOCUMENT = 0, // the root, holds the top level nodes.
+    ELEMENT,
+    TEXT,
+    ENTITY,      // &amp; &#160; etc.
+    RAW_TEXT,    // the content of a <style> or <script> element.
+    COMMENT,
+    DECLARATION, // <!DOCTYPE ...>, <?xml ...?> etc.
+  };
+
+  Type type;
+  QStringView name; // the tag name of an ELEMENT.
+  QStringView text; // the source of the node.
+  int start, end;
+  int content_start, content_end;
+  const XhtmlDomAttribute* attributes;
+  int attribute_count;
+  XhtmlDomNode* parent;
+  XhtmlDomNode* first_child;
+  XhtmlDomNode* last_child;
+  XhtmlDomNode* next_sibling;
+
+  bool isElement() const { return (type == ELEMENT); }
+  bool nameIs(QLatin1String value) const;
+  bool hasAttribute(QLatin1String attribute_name) const;
+  QStringView attribute(QLatin1String attribute_name) const;
+  QStringView content() const;
+  XhtmlDomNode* next(const XhtmlDomNode* within) const;
+};
+
+/*!
+ * \brief A light weight, read only, document tree of an xhtml chapter.
+ *
+ * The source is tokenized once with XhtmlTokenizer, no characters are
+ * copied, the dom keeps a shallow copy of the source and every node refers
+ * into it. The nodes and their attributes are allocated from an arena that
+ * belongs to the dom, a few large blocks that are freed together, so
+ * building and dropping the tree of a chapter costs a handful of
+ * allocations however many nodes it has.
+ *
+ * Missing closing tags are closed with their parent and stray closing tags
+ * are ignored, as a browser would, so any chapter can be parsed. Void html
+ * elements, \<br\> \<img\> etc., never have children.
+ *
+ * A dom can be queried from any number of threads once parsed, but
+ * elementById() builds its table on first use so should first be called
+ * from the thread that parsed it.
+ */
+class XhtmlDom
+{
+public:
+  XhtmlDom();
+  explicit XhtmlDom(const QString& source);
+  ~XhtmlDom();
+
+  void parse(const QString& source);
+  void clear();
+
+  const QString& source() const;
+  XhtmlDomNode* root() const;
+  int nodeCount() const;
+
+  XhtmlDomNode* firstElement(QLatin1String name,
+                             const XhtmlDomNode* within = nullptr) const;
+  QVector<XhtmlDomNode*> elements(QLatin1String name,
+                                  const XhtmlDomNode* within = nullptr) const;
+  XhtmlDomNode* elementById(QStringView id) const;
+  static QString textContent(const XhtmlDomNode* node);
+
+  static bool isVoidElement(QStringView name);
+
+  static const int BLOCK_SIZE = 32 * 1024;
+
+protected:
+  QString m_source;
+  XhtmlDomNode* m_root;
+  int m_node_count;
+  // the arena.
+  QVector<char*> m_blocks;
+  char* m_free;
+  int m_available;
+  mutable QHash<QStringView, XhtmlDomNode*> m_ids;
+  mutable bool m_ids_built;
+
+  void* allocate(int size);
+  XhtmlDomNode* createNode(XhtmlDomNode::Type type,
+                           int start,
+                           int end,
+                           XhtmlDomNode* parent);
+  void close(XhtmlDomNode* node, int content_end, int end);
+
+private:
+  Q_DISABLE_COPY(XhtmlDom)
+};
+
+#endif // XHTMLDOM_H
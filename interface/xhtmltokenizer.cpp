@@ -0,0 +1,423 @@
+#include "xhtmltokenizer.h"
+
+namespace {
+
+/* Character classes for the ASCII range. Anything outside this range falls
+ * back to the QChar unicode tables. */
+struct AsciiTable
+{
+  bool name[128];
+  bool word[128];
+
+  AsciiTable()
+  {
+    for (int c = 0; c < 128; c++) {
+      bool alnum = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                   (c >= '0' && c <= '9');
+      name[c] = alnum || c == '-' || c == '_' || c == ':' || c == '.';
+      word[c] = alnum || c == '_';
+    }
+  }
+};
+
+const AsciiTable ascii_table;
+
+// entity names longer than this are treated as plain text.
+const int MAX_ENTITY_LENGTH = 32;
+
+} // end of anonymous namespace
+
+bool
+XhtmlToken::nameIs(QLatin1String value) const
+{
+  return XhtmlTokenizer::equals(name, value);
+}
+
+/*!
+ * \brief Constructs a tokenizer for the text.
+ *
+ * \param text the text to tokenize, this must remain valid for the life of
+ *        the tokenizer and of any tokens it returns.
+ * \param state the state() returned at the end of the previous piece of text,
+ *        or TEXT_STATE for the start of a document.
+ */
+XhtmlTokenizer::XhtmlTokenizer(QStringView text, int state)
+  : m_text(text)
+  , m_data(text.data())
+  , m_length(int(text.size()))
+  , m_pos(0)
+  , m_state(state & STATE_MASK)
+  , m_raw_kind((state >> RAW_KIND_SHIFT) & 0x03)
+  , m_raw_content((state & RAW_CONTENT_FLAG) != 0)
+  , m_tag_closing((state & TAG_CLOSING_FLAG) != 0)
+{}
+
+bool
+XhtmlTokenizer::atEnd() const
+{
+  return m_pos >= m_length;
+}
+
+/*!
+ * \brief Returns the next token, or a NO_TOKEN token at the end of the text.
+ */
+XhtmlToken
+XhtmlTokenizer::next()
+{
+  if (m_pos >= m_length) {
+    return XhtmlToken();
+  }
+
+  switch (m_state) {
+    case TAG_STATE:
+      return nextInTag();
+    case DOUBLE_QUOTE_STATE:
+      return nextQuoted('"', m_pos, false);
+    case SINGLE_QUOTE_STATE:
+      return nextQuoted('\'', m_pos, false);
+    case COMMENT_STATE:
+      return nextComment(m_pos);
+    case DECLARATION_STATE:
+      return nextDeclaration(m_pos);
+    default:
+      if (m_raw_content) {
+        return nextRawText();
+      }
+      return nextText();
+  }
+}
+
+int
+XhtmlTokenizer::position() const
+{
+  return m_pos;
+}
+
+/*!
+ * \brief The state of the tokenizer at the current position.
+ *
+ * This can be passed to a new tokenizer to continue tokenizing text that has
+ * been split into pieces.
+ */
+int
+XhtmlTokenizer::state() const
+{
+  int state = m_state | (m_raw_kind << RAW_KIND_SHIFT);
+  if (m_raw_content) {
+    state |= RAW_CONTENT_FLAG;
+  }
+  if (m_tag_closing) {
+    state |= TAG_CLOSING_FLAG;
+  }
+  return state;
+}
+
+/*!
+ * \brief true if c can be part of a tag or attribute name.
+ */
+bool
+XhtmlTokenizer::isNameChar(QChar c)
+{
+  ushort u = c.unicode();
+  if (u < 128) {
+    return ascii_table.name[u];
+  }
+  return c.isLetterOrNumber();
+}
+
+/*!
+ * \brief true if c can be part of a word, the equivalent of the \\w
+ * regular expression class.
+ */
+bool
+XhtmlTokenizer::isWordChar(QChar c)
+{
+  ushort u = c.unicode();
+  if (u < 128) {
+    return ascii_table.word[u];
+  }
+  return c.isLetterOrNumber() || c.isMark();
+}
+
+bool
+XhtmlTokenizer::equals(QStringView view, QLatin1String value)
+{
+  if (view.size() != value.size()) {
+    return false;
+  }
+  const char* chars = value.data();
+  for (int i = 0; i < value.size(); i++) {
+    if (view.at(i) != QLatin1Char(chars[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+XhtmlToken
+XhtmlTokenizer::makeToken(XhtmlToken::Type type, int start, int end) const
+{
+  XhtmlToken token;
+  token.type = type;
+  token.start = start;
+  token.length = end - start;
+  token.text = m_text.mid(start, end - start);
+  return token;
+}
+
+XhtmlToken
+XhtmlTokenizer::nextText()
+{
+  int start = m_pos;
+  QChar c = m_data[m_pos];
+
+  if (c == '<') {
+    if (startsWithAt(QLatin1String("<!--"), m_pos)) {
+      m_state = COMMENT_STATE;
+      m_pos += 4;
+      return nextComment(start);
+    }
+    if (m_pos + 1 < m_length &&
+        (m_data[m_pos + 1] == '!' || m_data[m_pos + 1] == '?')) {
+      m_state = DECLARATION_STATE;
+      m_pos += 2;
+      return nextDeclaration(start);
+    }
+    return nextTagStart();
+  }
+
+  if (c == '&') {
+    int i = m_pos + 1;
+    int limit = qMin(m_length, i + MAX_ENTITY_LENGTH);
+    while (i < limit && (isNameChar(m_data[i]) || m_data[i] == '#')) {
+      i++;
+    }
+    if (i < m_length && i > m_pos + 1 && m_data[i] == ';') {
+      m_pos = i + 1;
+      return makeToken(XhtmlToken::ENTITY, start, m_pos);
+    }
+    m_pos++;
+    return makeToken(XhtmlToken::TEXT, start, m_pos);
+  }
+
+  // plain text, only the two special characters need checking.
+  const ushort* data = reinterpret_cast<const ushort*>(m_data);
+  int i = m_pos + 1;
+  while (i < m_length && data[i] != '<' && data[i] != '&') {
+    i++;
+  }
+  m_pos = i;
+  return makeToken(XhtmlToken::TEXT, start, m_pos);
+}
+
+XhtmlToken
+XhtmlTokenizer::nextRawText()
+{
+  QLatin1String closer(m_raw_kind == STYLE_RAW ? "</style" : "</script");
+  int index = indexOf(closer, m_pos);
+  if (index == m_pos) {
+    m_raw_content = false;
+    return nextTagStart();
+  }
+
+  int start = m_pos;
+  m_pos = (index < 0 ? m_length : index);
+  return makeToken(m_raw_kind == STYLE_RAW ? XhtmlToken::STYLE_TEXT
+                                           : XhtmlToken::SCRIPT_TEXT,
+                   start,
+                   m_pos);
+}
+
+XhtmlToken
+XhtmlTokenizer::nextTagStart()
+{
+  int start = m_pos;
+  int i = m_pos + 1;
+  bool closing = false;
+  if (i < m_length && m_data[i] == '/') {
+    closing = true;
+    i++;
+  }
+
+  int name_start = i;
+  while (i < m_length && isNameChar(m_data[i])) {
+    i++;
+  }
+  if (i == name_start) {
+    // a '<' that does not start a tag.
+    m_pos = start + 1;
+    return makeToken(XhtmlToken::ERROR, start, m_pos);
+  }
+
+  XhtmlToken token = makeToken(XhtmlToken::TAG_START, start, i);
+  token.name = m_text.mid(name_start, i - name_start);
+  token.closing = closing;
+
+  m_tag_closing = closing;
+  m_raw_kind = 0;
+  if (!closing) {
+    if (token.nameIs(QLatin1String("style"))) {
+      m_raw_kind = STYLE_RAW;
+    } else if (token.nameIs(QLatin1String("script"))) {
+      m_raw_kind = SCRIPT_RAW;
+    }
+  }
+  m_state = TAG_STATE;
+  m_pos = i;
+  return token;
+}
+
+XhtmlToken
+XhtmlTokenizer::nextInTag()
+{
+  int start = m_pos;
+  QChar c = m_data[m_pos];
+
+  if (c.isSpace()) {
+    int i = m_pos + 1;
+    while (i < m_length && m_data[i].isSpace()) {
+      i++;
+    }
+    m_pos = i;
+    return makeToken(XhtmlToken::TAG_SPACE, start, m_pos);
+  }
+
+  if (c == '>') {
+    m_pos++;
+    m_state = TEXT_STATE;
+    m_raw_content = (m_raw_kind != 0 && !m_tag_closing);
+    if (!m_raw_content) {
+      m_raw_kind = 0;
+    }
+    m_tag_closing = false;
+    return makeToken(XhtmlToken::TAG_END, start, m_pos);
+  }
+
+  if (c == '/' && m_pos + 1 < m_length && m_data[m_pos + 1] == '>') {
+    m_pos += 2;
+    m_state = TEXT_STATE;
+    m_raw_kind = 0;
+    m_raw_content = false;
+    m_tag_closing = false;
+    XhtmlToken token = makeToken(XhtmlToken::TAG_END, start, m_pos);
+    token.closing = true;
+    return token;
+  }
+
+  if (c == '=') {
+    m_pos++;
+    return makeToken(XhtmlToken::TAG_EQUALS, start, m_pos);
+  }
+
+  if (c == '"' || c == '\'') {
+    m_state = (c == '"' ? DOUBLE_QUOTE_STATE : SINGLE_QUOTE_STATE);
+    m_pos++;
+    return nextQuoted(c, start, true);
+  }
+
+  if (c == '<') {
+    // a second open tag character.
+    m_pos++;
+    return makeToken(XhtmlToken::ERROR, start, m_pos);
+  }
+
+  if (isNameChar(c)) {
+    int i = m_pos + 1;
+    while (i < m_length && isNameChar(m_data[i])) {
+      i++;
+    }
+    m_pos = i;
+    XhtmlToken token = makeToken(XhtmlToken::ATTRIBUTE_NAME, start, m_pos);
+    token.name = token.text;
+    return token;
+  }
+
+  // an unquoted attribute value.
+  int i = m_pos + 1;
+  while (i < m_length && !m_data[i].isSpace() && m_data[i] != '>' &&
+         m_data[i] != '<' &&
+         !(m_data[i] == '/' && i + 1 < m_length && m_data[i + 1] == '>')) {
+    i++;
+  }
+  m_pos = i;
+  XhtmlToken token = makeToken(XhtmlToken::ATTRIBUTE_VALUE, start, m_pos);
+  token.name = token.text;
+  return token;
+}
+
+XhtmlToken
+XhtmlTokenizer::nextQuoted(QChar quote, int start, bool opened)
+{
+  int i = m_pos;
+  while (i < m_length && m_data[i] != quote) {
+    i++;
+  }
+
+  int value_start = (opened ? start + 1 : start);
+  int value_end = i;
+  if (i < m_length) {
+    m_pos = i + 1;
+    m_state = TAG_STATE;
+  } else {
+    // the value continues in the next piece of text.
+    m_pos = m_length;
+  }
+
+  XhtmlToken token = makeToken(XhtmlToken::ATTRIBUTE_VALUE, start, m_pos);
+  token.name = m_text.mid(value_start, value_end - value_start);
+  return token;
+}
+
+XhtmlToken
+XhtmlTokenizer::nextComment(int start)
+{
+  int index = indexOf(QLatin1String("-->"), m_pos);
+  if (index < 0) {
+    m_pos = m_length;
+  } else {
+    m_pos = index + 3;
+    m_state = TEXT_STATE;
+  }
+  return makeToken(XhtmlToken::COMMENT, start, m_pos);
+}
+
+XhtmlToken
+XhtmlTokenizer::nextDeclaration(int start)
+{
+  int i = m_pos;
+  while (i < m_length && m_data[i] != '>') {
+    i++;
+  }
+  if (i < m_length) {
+    m_pos = i + 1;
+    m_state = TEXT_STATE;
+  } else {
+    m_pos = m_length;
+  }
+  return makeToken(XhtmlToken::DECLARATION, start, m_pos);
+}
+
+int
+XhtmlTokenizer::indexOf(QLatin1String value, int from) const
+{
+  if (value.size() == 0) {
+    return from;
+  }
+  QChar first(QLatin1Char(value.data()[0]));
+  int last = m_length - value.size();
+  for (int i = from; i <= last; i++) {
+    if (m_data[i] == first && startsWithAt(value, i)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+bool
+XhtmlTokenizer::startsWithAt(QLatin1String value, int index) const
+{
+  if (index + value.size() > m_length) {
+    return false;
+  }
+  return equals(m_text.mid(index, value.size()), value);
+}
@@ -0,0 +1,111 @@
+#ifndef XHTMLTOKENIZER_H
+#define XHTMLTOKENIZER_H
+
+#include <QLatin1String>
+#include <QString>
+#include <QStringView>
+
+/*!
+ * \brief A single token returned by XhtmlTokenizer.
+ *
+ * The text and name members are views into the tokenized text, no
+ * characters are copied so the token must not outlive that text.
+ */
+struct XhtmlToken
+{
+  enum Type
+  {
+    NO_TOKEN = 0,
+    TEXT,           // plain text between tags.
+    ENTITY,         // &amp; &#160; etc.
+    STYLE_TEXT,     // the content of a <style> element.
+    SCRIPT_TEXT,    // the content of a <script> element.
+    TAG_START,      // '<' or '</' and the tag name.
+    TAG_END,        // '>' or '/>'.
+    TAG_SPACE,      // white space inside a tag.
+    TAG_EQUALS,     // the '=' between an attribute name and value.
+    ATTRIBUTE_NAME, // an attribute name.
+    ATTRIBUTE_VALUE, // an attribute value including any quotes.
+    COMMENT,         // <!-- ... -->, or part of one.
+    DECLARATION,     // <!DOCTYPE ...>, <?xml ...?> etc.
+    ERROR,           // a special character out of place.
+  };
+
+  Type type = NO_TOKEN;
+  int start = 0;
+  int length = 0;
+  QStringView text;
+  // the tag name for TAG_START, the unquoted value for ATTRIBUTE_VALUE.
+  QStringView name;
+  // true for a TAG_START of a closing tag or a TAG_END of an empty tag.
+  bool closing = false;
+
+  int end() const { return start + length; }
+  bool nameIs(QLatin1String value) const;
+};
+
+/*!
+ * \brief A zero copy XHTML tokenizer.
+ *
+ * The tokenizer makes a single forward pass over a piece of text returning
+ * tag, attribute, text and entity tokens as views into the original text.
+ * ASCII characters, which make up almost all of the markup in an ebook,
+ * are classified using a lookup table rather than the full unicode tables.
+ *
+ * Text can be tokenized in pieces, a line at a time for instance, by passing
+ * the state() at the end of one piece to the tokenizer for the next.
+ */
+class XhtmlTokenizer
+{
+public:
+  enum State
+  {
+    TEXT_STATE = 0,
+    TAG_STATE,
+    DOUBLE_QUOTE_STATE,
+    SINGLE_QUOTE_STATE,
+    COMMENT_STATE,
+    DECLARATION_STATE,
+  };
+
+  XhtmlTokenizer(QStringView text, int state = TEXT_STATE);
+
+  bool atEnd() const;
+  XhtmlToken next();
+  int position() const;
+  int state() const;
+
+  static bool isNameChar(QChar c);
+  static bool isWordChar(QChar c);
+  static bool equals(QStringView view, QLatin1String value);
+
+protected:
+  QStringView m_text;
+  const QChar* m_data;
+  int m_length;
+  int m_pos;
+  int m_state;
+  int m_raw_kind;      // 0, STYLE_RAW or SCRIPT_RAW
+  bool m_raw_content;  // true inside the content of a style/script element.
+  bool m_tag_closing;  // the current tag is a closing tag.
+
+  static const int STYLE_RAW = 1;
+  static const int SCRIPT_RAW = 2;
+  static const int STATE_MASK = 0x0F;
+  static const int RAW_KIND_SHIFT = 4;
+  static const int RAW_CONTENT_FLAG = 0x40;
+  static const int TAG_CLOSING_FLAG = 0x80;
+
+  XhtmlToken makeToken(XhtmlToken::Type type, int start, int end) const;
+  XhtmlToken nextText();
+  XhtmlToken nextRawText();
+  XhtmlToken nextTagStart();
+  XhtmlToken nextInTag();
+  XhtmlToken nextQuoted(QChar quote, int start, bool opened);
+  XhtmlToken nextComment(int start);
+  XhtmlToken nextDeclaration(int start);
+  int indexOf(QLatin1String value, int from) const;
+  bool startsWithAt(QLatin1String value, int index) const;
+};
+
+#endif // XHTMLTOKENIZER_H
@@ -1,21 +1,54 @@
 #include "epubcontainer.h"
 
+#include <quazip5/quacrc32.h>
 #include <quazip5/quazip.h>
 #include <quazip5/quazipfile.h>
 
 #include <QDebug>
 #include <QDir>
 #include <QDomDocument>
+#include <QFileInfo>
+#include <QFutureWatcher>
 #include <QImage>
 #include <QImageReader>
+#include <QRegularExpression>
+#include <QSaveFile>
 #include <QScopedPointer>
 #include <QSharedPointer>
+#include <QThreadPool>
+#include <QtEndian>
+#include <QUrl>
+#include <QXmlStreamReader>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+
+#ifdef Q_OS_WIN
+#ifndef NOMINMAX
+#define NOMINMAX // std::min and std::max are used below.
+#endif
+#include <windows.h>
+#endif
 
 #include <csvsplitter/csvsplitter.h>
 #include <qlogger/qlogger.h>
 
 #include "ebookcommon.h"
 #include "ebookmetadata.h"
+#include "ebookstringpool.h"
+#include "ebooktextdecoder.h"
+#include "ebooktextdiff.h"
+#include "ebooktrace.h"
+#include "epubentrydevice.h"
+#include "epubfontregistry.h"
+#include "epubparsecache.h"
+#include "epubresourcestore.h"
+#include "epubstylesheetcache.h"
+#include "lookuptable.h"
+#include "xhtmldom.h"
+#include "xhtmltokenizer.h"
 
 using namespace qlogger;
 
@@ -23,19 +56,39 @@ const QString EPubContainer::METADATA_FOLDER = "META-INF";
 const QString EPubContainer::MIMETYPE_FILE = "mimetype";
 const QByteArray EPubContainer::MIMETYPE = "application/epub+zip";
 const QString EPubContainer::CONTAINER_FILE = "META-INF/container.xml";
+const QString EPubContainer::ENCRYPTION_FILE = "META-INF/encryption.xml";
 const QString EPubContainer::TOC_FILE = "toc.ncx";
+const QString EPubContainer::CONTENT_FOLDER = "OEBPS";
+const QString EPubContainer::CONTENT_PACKAGE_FILE = "OEBPS/content.opf";
+
+const QByteArray EPubContainer::GIF_TYPE =
+  EBookStringPool::instance()->intern(QByteArray("image/gif"));
+const QByteArray EPubContainer::JPEG_TYPE =
+  EBookStringPool::instance()->intern(QByteArray("image/jpeg"));
+const QByteArray EPubContainer::PNG_TYPE =
+  EBookStringPool::instance()->intern(QByteArray("image/png"));
+const QByteArray EPubContainer::SVG_TYPE =
+  EBookStringPool::instance()->intern(QByteArray("image/svg+xml"));
+const QByteArray EPubContainer::XHTML_TYPE =
+  EBookStringPool::instance()->intern(QByteArray("application/xhtml+xml"));
+const QByteArray EPubContainer::CSS_TYPE =
+  EBookStringPool::instance()->intern(QByteArray("text/css"));
+const QByteArray EPubContainer::JAVASCRIPT_TYPE =
+  EBookStringPool::instance()->intern(QByteArray("text/javascript"));
+const QByteArray EPubContainer::OPENTYPE_TYPE =
+  EBookStringPool::instance()->intern(
+    QByteArray("application/vnd.ms-opentype"));
+const QByteArray EPubContainer::WOFF_TYPE =
+  EBookStringPool::instance()->intern(QByteArray("application/font-woff"));
 
 const QString EPubContainer::TITLE = "title";
 const QString EPubContainer::CREATOR = "creator";
 const QString EPubContainer::IDENTIFIER = "identifier";
 const QString EPubContainer::LANGUAGE = "language";
 
-const QString EPubContainer::TOC_TITLE = "<h2>%1</h2>";
-const QString EPubContainer::LIST_START = "<html><body><ul>";
-const QString EPubContainer::LIST_END = "</ul></body></html>";
-const QString EPubContainer::LIST_ITEM = "<li><a href=\"%1\">%2</li>";
-const QString EPubContainer::LIST_BUILD_ITEM = "<li><a href=\"%1#%2\">%3</li>";
+const QString EPubContainer::OPS_NAMESPACE = "http://www.idpf.org/2007/ops";
 const QString EPubContainer::LIST_FILEPOS = "position%1";
+const QString EPubContainer::ANCHOR_POINT = "<a id=\"%1\"></a>";
 const QString EPubContainer::HTML_DOCTYPE =
   "<!DOCTYPE html PUBLIC "
   "\"-//W3C//DTD XHTML 1.1//EN\" "
@@ -43,22 +96,198 @@ const QString EPubContainer::HTML_DOCTYPE =
 const QString EPubContainer::XML_HEADER =
   "<?xml version='1.0' encoding='utf-8'?>";
 const QString EPubContainer::HTML_XMLNS = "http://www.w3.org/1999/xhtml";
+const QString EPubContainer::PACKAGE_WRAPPER = "<package%1>%2</package>";
 // const QString EPubContainer::HEAD_META_CONTENT =
 //  "<meta http-equiv=\"Content-Type\" "
 //  "content=\"text/html; charset=utf-8\"/>";
 
+// the guide reference types, sorted by name.
+static constexpr LookupEntry<EPubGuideItem::GuideType> GUIDE_TYPES[] = {
+  { "acknowledgements", EPubGuideItem::acknowledgements },
+  { "bibliography", EPubGuideItem::bibliography },
+  { "colophon", EPubGuideItem::colophon },
+  { "copyright-page", EPubGuideItem::copyright_page },
+  { "cover", EPubGuideItem::cover },
+  { "dedication", EPubGuideItem::dedication },
+  { "epigraph", EPubGuideItem::epigraph },
+  { "foreword", EPubGuideItem::foreword },
+  { "glossary", EPubGuideItem::glossary },
+  { "index", EPubGuideItem::index },
+  { "loi", EPubGuideItem::loi },
+  { "lot", EPubGuideItem::lot },
+  { "notes", EPubGuideItem::notes },
+  { "preface", EPubGuideItem::preface },
+  { "text", EPubGuideItem::text },
+  { "title-page", EPubGuideItem::title_page },
+  { "toc", EPubGuideItem::toc },
+};
+static_assert(LookupTable::isSorted(GUIDE_TYPES),
+              "guide types must be sorted");
+static constexpr LookupIndex<EPubGuideItem::text + 1> GUIDE_TYPE_NAMES =
+  LookupTable::buildIndex<EPubGuideItem::text + 1>(GUIDE_TYPES);
+
+EPubGuideItem::GuideType
+EPubGuideItem::fromString(QString type)
+{
+  // unknown types are treated as text.
+  return LookupTable::find(GUIDE_TYPES, type, GuideType::text);
+}
+
+QString
+EPubGuideItem::toString(GuideType type)
+{
+  return QString::fromLatin1(GUIDE_TYPE_NAMES.names[type]);
+}
+
+/*!
+ * \brief Adds an item, whose categories must already be set, or replaces
+ * the item with the same id.
+ */
+void
+EPubManifest::insert(SharedManifestItem item)
+{
+  QHash<QString, int>::const_iterator it = m_by_id.constFind(item->id);
+  int index;
+  if (it != m_by_id.constEnd()) {
+    index = it.value();
+    SharedManifestItem old = m_items.at(index);
+    m_by_href.remove(old->href);
+    m_by_path.remove(old->path);
+    m_items[index] = item;
+  } else {
+    index = m_items.size();
+    m_items.append(item);
+    m_by_id.insert(item->id, index);
+  }
+  m_by_href.insert(item->href, index);
+  m_by_path.insert(item->path, index);
+}
+
+void
+EPubManifest::clear()
+{
+  m_items.clear();
+  m_by_id.clear();
+  m_by_href.clear();
+  m_by_path.clear();
+}
+
+/*!
+ * \brief The items in any of categories, in package order.
+ */
+SharedManifestItemList
+EPubManifest::items(int categories) const
+{
+  SharedManifestItemList list;
+  foreach (SharedManifestItem item, m_items) {
+    if (categories == ALL || (item->categories & categories)) {
+      list.append(item);
+    }
+  }
+  return list;
+}
+
+/*!
+ * \brief The ids of the items in any of categories, in package order.
+ */
+QStringList
+EPubManifest::ids(int categories) const
+{
+  QStringList list;
+  foreach (SharedManifestItem item, m_items) {
+    if (categories == ALL || (item->categories & categories)) {
+      list.append(item->id);
+    }
+  }
+  return list;
+}
+
+QStringList
+EPubManifest::hrefs(int categories) const
+{
+  QStringList list;
+  foreach (SharedManifestItem item, m_items) {
+    if (categories == ALL || (item->categories & categories)) {
+      list.append(item->href);
+    }
+  }
+  return list;
+}
+
+bool
+EPubManifest::contains(const QString& id, int categories) const
+{
+  return !item(id, categories).isNull();
+}
+
+/*!
+ * \brief The item with id if it is in any of categories, otherwise a null
+ * item.
+ */
+SharedManifestItem
+EPubManifest::item(const QString& id, int categories) const
+{
+  QHash<QString, int>::const_iterator it = m_by_id.constFind(id);
+  if (it == m_by_id.constEnd()) {
+    return SharedManifestItem();
+  }
+  SharedManifestItem found = m_items.at(it.value());
+  // items in no category, the ncx for example, are still found with ALL.
+  if (categories != ALL && !(found->categories & categories)) {
+    return SharedManifestItem();
+  }
+  return found;
+}
+
+SharedManifestItem
+EPubManifest::itemByHref(const QString& href) const
+{
+  QHash<QString, int>::const_iterator it = m_by_href.constFind(href);
+  return (it == m_by_href.constEnd() ? SharedManifestItem()
+                                     : m_items.at(it.value()));
+}
+
+SharedManifestItem
+EPubManifest::itemByPath(const QString& path) const
+{
+  QHash<QString, int>::const_iterator it = m_by_path.constFind(path);
+  return (it == m_by_path.constEnd() ? SharedManifestItem()
+                                     : m_items.at(it.value()));
+}
+
 EPubContainer::EPubContainer(QObject* parent)
   : QObject(parent)
   , m_archive(nullptr)
+  , m_lazy_loading(true)
+  , m_compression_level(DEFAULT_COMPRESSION_LEVEL)
+  , m_image_cache(DEFAULT_IMAGE_CACHE_SIZE)
   , m_metadata(new EBookMetadata())
 {}
 
-EPubContainer::~EPubContainer() {}
+EPubContainer::~EPubContainer()
+{
+  // let a background save complete rather than lose it.
+  waitForSave();
+  writeParseCache();
+  closeFile();
+  EPubFontRegistry::instance()->releaseFonts(this);
+  EPubResourceStore::instance()->release(this);
+}
 
 bool
 EPubContainer::loadFile(const QString path)
 {
+  EBOOK_TRACE_SCOPE("EPubContainer::loadFile");
   // open the epub as a zip file
+  waitForSave();
+  closeFile();
+  m_image_cache.clear();
+  EPubFontRegistry::instance()->releaseFonts(this);
+  EPubResourceStore::instance()->release(this);
+  m_encrypted_entries.clear();
+  m_encryption_read = false;
+  m_hot_documents.clear();
+  markChanged();
   m_archive = new QuaZip(path);
   m_filename = path; // stored against modification;
   if (!m_archive->open(QuaZip::mdUnzip)) {
@@ -67,12 +296,17 @@ EPubContainer::loadFile(const QString path)
   }
 
   // get list of filenames from zip file
-  m_files = m_archive->getFileNameList();
-  if (m_files.isEmpty()) {
+  mapArchive();
+  if (!buildEntryIndex() || m_files.isEmpty()) {
     QLOG_DEBUG(tr("Failed to read %1").arg(path));
     return false;
   }
 
+  // an unchanged book can be rebuilt without any xml parsing.
+  if (readParseCache()) {
+    return true;
+  }
+
   // Get and check that the mimetype is correct.
   // According to the standard this must be unencrypted.
   if (!parseMimetype()) {
@@ -83,1095 +317,4211 @@ EPubContainer::loadFile(const QString path)
     return false;
   }
 
+  m_parse_cache_dirty = true;
   return true;
 }
 
-QString
-EPubContainer::filename()
+/*!
+ * \brief Opens an epub for its metadata only.
+ *
+ * The package file is read as far as the end of the metadata element, the
+ * manifest, spine and toc are left empty. An up to date parse cache is still
+ * used but a metadata only parse is never written to it.
+ *
+ * \param path the epub file.
+ * \return true if the metadata was read, otherwise false.
+ */
+bool
+EPubContainer::loadMetadata(const QString path)
 {
-  return m_filename;
+  m_metadata_only = true;
+  bool result = loadFile(path);
+  m_metadata_only = false;
+  // the cache only holds complete parses.
+  m_parse_cache_dirty = false;
+  return result;
 }
 
-void
-EPubContainer::setFilename(QString filename)
+/*!
+ * \brief Reads only the cover image of an epub, at no more than image_size.
+ *
+ * The package file is read for its metadata, manifest and guide, the spine
+ * and toc are skipped and no parse cache is read or written. The cover is
+ * the cover-image manifest item, else the item named by the EPUB 2
+ * <meta name="cover">, else the first image of the guide's cover page. Only
+ * the archive entries of the package file, the cover page and the image
+ * itself are read.
+ *
+ * This may be called from worker threads.
+ *
+ * \return the cover, or a null QImage if none was found.
+ */
+QImage
+EPubContainer::extractCover(const QString& path, QSize image_size)
 {
-  m_filename = filename;
+  EBOOK_TRACE_SCOPE("EPubContainer::extractCover");
+  EPubContainer container;
+  container.m_cover_only = true;
+  bool loaded = container.loadFile(path);
+  // the cache only holds complete parses.
+  container.m_parse_cache_dirty = false;
+  if (!loaded) {
+    return QImage();
+  }
+  QImage cover = container.coverImage(image_size);
+  if (cover.isNull()) {
+    cover = container.guideCover(image_size);
+  }
+  return cover;
 }
 
+/*
+ * The guide's cover reference is usually an xhtml page that shows the
+ * cover, its first img or svg image element names the image.
+ */
 QImage
-EPubContainer::image(const QString& id, QSize image_size)
+EPubContainer::guideCover(QSize image_size)
 {
-  QImage image;
-  if (m_manifest.images.contains(id)) {
-    image = m_manifest.images.value(id);
-
-  } else if (m_manifest.rendered_svg_images.contains(id)) {
-    image = m_manifest.rendered_svg_images.value(id);
-
-  } else if (m_manifest.svg_images.contains(id)) {
-    QSvgRenderer renderer(m_manifest.svg_images.value(id)->path);
-
-    QSize svgSize(renderer.viewBox().size());
-    if (svgSize.isValid()) {
-      svgSize.scale(image_size, Qt::KeepAspectRatio);
-    } else {
-      svgSize = image_size;
-    }
-
-    image = QImage(svgSize, QImage::Format_ARGB32);
-    QPainter painter(&image);
-    renderer.render(&painter);
-    painter.end();
-
-    m_manifest.rendered_svg_images.insert(id, image);
-
-  } else {
-    QLOG_DEBUG(tr("Unable to find image file for id %1").arg(id));
+  QString href = m_guide_cover.section('#', 0, 0);
+  SharedManifestItem item = m_manifest.itemByHref(href);
+  if (!item) {
     return QImage();
   }
+  if (item->categories & (EPubManifest::IMAGE | EPubManifest::SVG)) {
+    return image(item->id, image_size);
+  }
 
-  return image;
+  QByteArray data;
+  if (!readArchiveEntry(m_archive, item->path, data)) {
+    return QImage();
+  }
+  QString page_folder = item->path.left(item->path.lastIndexOf('/') + 1);
+  QXmlStreamReader reader(data);
+  while (!reader.atEnd()) {
+    if (reader.readNext() != QXmlStreamReader::StartElement) {
+      continue;
+    }
+    QString src;
+    if (reader.name() == QLatin1String("img")) {
+      src = reader.attributes().value(QLatin1String("src")).toString();
+    } else if (reader.name() == QLatin1String("image")) {
+      // svg uses xlink:href, svg 2 plain href.
+      foreach (QXmlStreamAttribute attribute, reader.attributes()) {
+        if (attribute.name() == QLatin1String("href")) {
+          src = attribute.value().toString();
+        }
+      }
+    }
+    if (src.isEmpty()) {
+      continue;
+    }
+    SharedManifestItem image_item =
+      m_manifest.itemByPath(QDir::cleanPath(page_folder + src));
+    if (image_item) {
+      return image(image_item->id, image_size);
+    }
+  }
+  return QImage();
 }
 
-QStringList
-EPubContainer::itemKeys()
+/*!
+ * \brief Closes the underlying archive.
+ *
+ * Once the archive is closed any manifest items that have not yet been
+ * loaded can no longer be accessed.
+ *
+ * \return true if an archive was open, otherwise false.
+ */
+bool
+EPubContainer::closeFile()
 {
-  return m_manifest.items.keys();
+  if (!m_archive) {
+    return false;
+  }
+  // a prefetch reads from the archive mapping.
+  waitForPrefetch();
+  if (m_archive->isOpen()) {
+    m_archive->close();
+  }
+  delete m_archive;
+  m_archive = nullptr;
+  m_files.clear();
+  m_entry_index.clear();
+
+  if (m_mapped_data) {
+    // image data read from stored entries points into the mapping.
+    for (QHash<QString, QByteArray>::iterator it =
+           m_manifest.image_data.begin();
+         it != m_manifest.image_data.end();
+         ++it) {
+      it.value().detach();
+    }
+    m_mapped_file.unmap(m_mapped_data);
+    m_mapped_data = nullptr;
+    m_mapped_size = 0;
+  }
+  m_mapped_file.close();
+  return true;
 }
 
-SharedManifestItem
-EPubContainer::item(QString key)
+/*!
+ * \brief Sets the directory holding the binary parse caches.
+ *
+ * If this is empty, the default, no parse cache is used.
+ */
+void
+EPubContainer::setParseCacheDirectory(const QString& directory)
 {
-  return m_manifest.items.value(key);
+  m_parse_cache_directory = directory;
 }
 
 QString
-EPubContainer::css(QString key)
+EPubContainer::parseCacheDirectory() const
 {
-  return m_manifest.css.value(key);
+  return m_parse_cache_directory;
 }
 
-QString
-EPubContainer::javascript(QString key)
+/*!
+ * \brief Rebuilds the container from the parse cache of the current file.
+ *
+ * \return true if there was an up to date cache, otherwise false in which
+ *         case the container is unchanged.
+ */
+bool
+EPubContainer::readParseCache()
 {
-  return m_manifest.javascript.value(key);
+  if (m_parse_cache_directory.isEmpty()) {
+    return false;
+  }
+
+  EPubParseCache cache;
+  if (!cache.read(
+        EPubParseCache::cacheFilename(m_parse_cache_directory, m_filename),
+        m_filename)) {
+    return false;
+  }
+
+  m_mimetype = MIMETYPE;
+  m_container_version = cache.container_version;
+  m_container_xmlns = cache.container_xmlns;
+  m_container_fullpath = cache.container_fullpath;
+  m_container_mediatype = cache.container_mediatype;
+
+  m_version = cache.version;
+  m_package_xmlns = cache.package_xmlns;
+  m_package_language = cache.package_language;
+  m_package_prefix = cache.package_prefix;
+  m_package_direction = cache.package_direction;
+  m_package_id = cache.package_id;
+  m_metadata->setUniqueIdentifierName(cache.unique_identifier_name);
+  m_metadata->setIsFoaf(cache.is_foaf);
+
+  parseMetadataXml(cache.metadata_xml);
+  m_metadata_xml = cache.metadata_xml;
+
+  m_manifest.id = cache.manifest_id;
+  foreach (SharedManifestItem item, cache.items) {
+    indexManifestItem(item);
+  }
+
+  m_spine.id = cache.spine_id;
+  m_spine.toc = cache.spine_toc;
+  m_spine.page_progression_dir = cache.page_progression_dir;
+  foreach (SharedSpineItem item, cache.spine_items) {
+    m_spine.items.insert(item->idref, item);
+    m_spine.ordered_items.append(item->idref);
+  }
+
+  m_manifest.toc_title = cache.toc_title;
+  m_manifest.toc_roots = cache.toc_roots;
+  m_manifest.toc_items = cache.toc_items;
+  m_manifest.toc_paths = cache.toc_paths;
+  m_toc = EBookToc();
+
+  m_parse_cache_dirty = false;
+  return true;
 }
 
-QString
-EPubContainer::itemDocument(QString key)
+/*!
+ * \brief Writes the parse cache of the current file if it has changed.
+ *
+ * The cache holds the parsed container, package and toc data and the
+ * bodies of any unmodified chapters that have been loaded so far.
+ *
+ * \return true if the cache was written, otherwise false.
+ */
+bool
+EPubContainer::writeParseCache()
 {
-  return item(key)->document_string;
-}
+  if (m_parse_cache_directory.isEmpty() || !m_parse_cache_dirty ||
+      m_filename.isEmpty()) {
+    return false;
+  }
 
-// void setStartCursor(SharedTextCursor start) {
-//  m_manif
-//}
+  EPubParseCache cache;
+  cache.container_version = m_container_version;
+  cache.container_xmlns = m_container_xmlns;
+  cache.container_fullpath = m_container_fullpath;
+  cache.container_mediatype = m_container_mediatype;
+
+  cache.version = m_version;
+  cache.package_xmlns = m_package_xmlns;
+  cache.package_language = m_package_language;
+  cache.package_prefix = m_package_prefix;
+  cache.package_direction = m_package_direction;
+  cache.package_id = m_package_id;
+  cache.unique_identifier_name = m_metadata->uniqueIdentifierName();
+  cache.is_foaf = m_metadata->isFoaf();
+  cache.metadata_xml = m_metadata_xml;
+
+  cache.manifest_id = m_manifest.id;
+  cache.items = m_manifest.items().toList();
+
+  cache.spine_id = m_spine.id;
+  cache.spine_toc = m_spine.toc;
+  cache.page_progression_dir = m_spine.page_progression_dir;
+  foreach (QString idref, m_spine.ordered_items) {
+    SharedSpineItem item = m_spine.items.value(idref);
+    if (item) {
+      cache.spine_items.append(item);
+    }
+  }
+
+  cache.toc_title = m_manifest.toc_title;
+  cache.toc_roots = m_manifest.toc_roots;
+  cache.toc_items = m_manifest.toc_items;
+  cache.toc_paths = m_manifest.toc_paths;
+
+  if (!cache.write(
+        EPubParseCache::cacheFilename(m_parse_cache_directory, m_filename),
+        m_filename)) {
+    return false;
+  }
+  m_parse_cache_dirty = false;
+  return true;
+}
 
 /*!
- * \brief The ordered list of Spine keys.
+ * \brief Memory maps the archive file.
  *
- * \return a QStringList of spine keys;
+ * Entries that are stored uncompressed, the mimetype and usually many of
+ * the images and fonts, can then be read as views into the mapping
+ * without being copied, see mappedEntry(). If the file cannot be mapped
+ * entries are read through QuaZip as normal.
+ *
+ * \return true if the file was mapped, otherwise false.
  */
-QStringList
-EPubContainer::spineKeys()
+bool
+EPubContainer::mapArchive()
 {
-  return m_spine.ordered_items;
+  m_mapped_file.setFileName(m_filename);
+  if (!m_mapped_file.open(QIODevice::ReadOnly)) {
+    QLOG_DEBUG(tr("Unable to map %1").arg(m_filename));
+    return false;
+  }
+  m_mapped_size = m_mapped_file.size();
+  m_mapped_data = m_mapped_file.map(0, m_mapped_size);
+  if (!m_mapped_data) {
+    QLOG_DEBUG(tr("Unable to map %1").arg(m_filename));
+    m_mapped_file.close();
+    m_mapped_size = 0;
+    return false;
+  }
+  return true;
 }
 
-QStringList
-EPubContainer::imageKeys()
+/*!
+ * \brief Reads the central directory of the archive once.
+ *
+ * The file names and the directory position of each entry are stored so
+ * that later entry lookups are a hash lookup followed by a direct seek
+ * rather than a search of the central directory by name.
+ *
+ * \return true if the central directory was read, otherwise false.
+ */
+bool
+EPubContainer::buildEntryIndex()
 {
-  return m_manifest.images.keys();
+  m_files.clear();
+  m_entry_index.clear();
+
+  unzFile unz_file = m_archive->getUnzFile();
+  for (bool more = m_archive->goToFirstFile(); more;
+       more = m_archive->goToNextFile()) {
+    unz64_file_pos position;
+    if (unzGetFilePos64(unz_file, &position) != UNZ_OK) {
+      QLOG_DEBUG(tr("Unable to index %1").arg(m_filename));
+      return false;
+    }
+    QuaZipFileInfo64 info;
+    if (!m_archive->getCurrentFileInfo(&info)) {
+      QLOG_DEBUG(tr("Unable to index %1").arg(m_filename));
+      return false;
+    }
+
+    EPubArchiveEntry entry;
+    entry.position = position;
+    entry.crc = info.crc;
+    entry.uncompressed_size = qint64(info.uncompressedSize);
+    // unencrypted stored entries can be read directly from the mapping.
+    if (m_mapped_data && info.method == 0 && !(info.flags & 1) &&
+        unzOpenCurrentFile2(unz_file, nullptr, nullptr, 1) == UNZ_OK) {
+      qint64 offset = qint64(unzGetCurrentFileZStreamPos64(unz_file));
+      unzCloseCurrentFile(unz_file);
+      if (offset + qint64(info.compressedSize) <= m_mapped_size) {
+        entry.data_offset = offset;
+        entry.size = qint64(info.compressedSize);
+      }
+    }
+
+    m_files.append(info.name);
+    m_entry_index.insert(info.name, entry);
+  }
+
+  if (m_archive->getZipError() != UNZ_OK) {
+    QLOG_DEBUG(tr("Failed to read the central directory of %1 : error %2")
+                 .arg(m_filename)
+                 .arg(m_archive->getZipError()));
+    return false;
+  }
+  return true;
 }
 
-QStringList
-EPubContainer::cssKeys()
+/*!
+ * \brief Makes path the current entry of the archive.
+ *
+ * Entries are found using the index built by buildEntryIndex(), the
+ * positions are valid for any QuaZip handle on the same file so this can
+ * also be used with the per-thread handles of the parallel loader.
+ *
+ * \return true if the entry was found, otherwise false.
+ */
+bool
+EPubContainer::setCurrentEntry(QuaZip* archive, const QString& path) const
 {
-  return m_manifest.css.keys();
+  return goToEntry(archive, m_entry_index, path);
 }
 
-QStringList
-EPubContainer::jsKeys()
+bool
+EPubContainer::goToEntry(QuaZip* archive,
+                         const EPubEntryIndex& index,
+                         const QString& path)
 {
-  return m_manifest.javascript.keys();
+  EPubEntryIndex::const_iterator it = index.constFind(path);
+  if (it == index.constEnd()) {
+    // not in the index, let QuaZip search for it.
+    return archive->setCurrentFile(path);
+  }
+
+  // QuaZipFile will only open an entry once QuaZip has a current file.
+  if (!archive->hasCurrentFile() && !archive->goToFirstFile()) {
+    return false;
+  }
+  unz64_file_pos position = it.value().position;
+  return (unzGoToFilePos64(archive->getUnzFile(), &position) == UNZ_OK);
 }
 
-QString
-EPubContainer::tocAsString()
+/*!
+ * \brief Whether manifest items are loaded on first access.
+ *
+ * When true, the default, loadFile() only parses the OPF package file and
+ * the table of contents. Images, html, css and javascript entries are
+ * decompressed the first time they are requested.
+ */
+bool
+EPubContainer::lazyLoading() const
 {
-  //  TocDisplayDocument* toc_document = new TocDisplayDocument(this);
-  //  toc_document->setHtml(m_manifest.formatted_toc_string);
-  //  return toc_document;
-  return m_manifest.formatted_toc_string;
+  return m_lazy_loading;
 }
 
-QStringList
-EPubContainer::creators()
+/*!
+ * \brief Sets whether manifest items are loaded on first access.
+ *
+ * This must be set before loadFile() is called to have any effect.
+ */
+void
+EPubContainer::setLazyLoading(bool lazy_loading)
 {
-  return m_metadata->creatorList();
+  m_lazy_loading = lazy_loading;
 }
 
-Metadata
-EPubContainer::metadata()
+QString
+EPubContainer::filename()
 {
-  return m_metadata;
+  return m_filename;
 }
 
-EPubManifest
-EPubContainer::manifest()
+void
+EPubContainer::setFilename(QString filename)
 {
-  return m_manifest;
+  m_filename = filename;
 }
 
-bool
-EPubContainer::parseMimetype()
+QImage
+EPubContainer::image(const QString& id, QSize image_size)
 {
-  if (m_files.contains(MIMETYPE_FILE)) {
-    m_archive->setCurrentFile(MIMETYPE_FILE);
-    QuaZipFile mimetypeFile(m_archive);
+  QImage image;
+  if (m_manifest.contains(id, EPubManifest::IMAGE)) {
+    if (!loadManifestItem(m_manifest.item(id))) {
+      return QImage();
+    }
 
-    if (!mimetypeFile.open(QIODevice::ReadOnly)) {
-      int error = m_archive->getZipError();
-      QLOG_DEBUG(tr("Unable to open mimetype file : error %1").arg(error));
-      return false;
+    image =
+      m_image_cache.image(id, m_manifest.image_data.value(id), image_size);
+
+  } else if (m_manifest.contains(id, EPubManifest::SVG)) {
+    SharedManifestItem svg_item = m_manifest.item(id);
+    if (svg_item->media_type != "image/svg+xml" ||
+        !loadManifestItem(svg_item)) {
+      QLOG_DEBUG(tr("Unable to render svg image for id %1").arg(id));
+      return QImage();
     }
 
-    m_mimetype = mimetypeFile.readAll();
+    QImage cached = m_image_cache.cached(id, image_size);
+    if (!cached.isNull()) {
+      return cached;
+    }
+
+    // rendered in the background, imageRendered() is emitted when done.
+    prepareImage(id, image_size);
+    image = QImage(image_size.isValid() ? image_size : QSize(1, 1),
+                   QImage::Format_ARGB32);
+    image.fill(Qt::transparent);
+
+  } else {
+    QLOG_DEBUG(tr("Unable to find image file for id %1").arg(id));
+    return QImage();
+  }
+
+  return image;
+}
+
+/*!
+ * \brief The image already decoded or rendered at image_size, or a null
+ * image if it is not in the image cache.
+ */
+QImage
+EPubContainer::cachedImage(const QString& id, QSize image_size)
+{
+  return m_image_cache.cached(id, image_size);
+}
+
+/*!
+ * \brief The image in the image cache whose size is closest to image_size,
+ * or a null image if none of its sizes are.
+ */
+QImage
+EPubContainer::closestImage(const QString& id, QSize image_size)
+{
+  return m_image_cache.closest(id, image_size);
+}
+
+/*!
+ * \brief Returns the cover image, reading only its own archive entry.
+ *
+ * EPUB 3 marks the cover with the cover-image manifest property, EPUB 2
+ * names its manifest id in a <meta name="cover"> tag.
+ */
+QImage
+EPubContainer::coverImage(QSize image_size)
+{
+  if (m_manifest.cover_image) {
+    return image(m_manifest.cover_image->id, image_size);
+  }
+  if (m_metadata) {
+    QString id = m_metadata->extraMeta("cover");
+    if (m_manifest.contains(id, EPubManifest::IMAGE)) {
+      return image(id, image_size);
+    }
+  }
+  return QImage();
+}
+
+/*!
+ * \brief Opens a manifest item for reading as a stream.
+ *
+ * Nothing is loaded or cached, the entry is read as the device is read,
+ * so this is how media overlays, audio, video and other large items should
+ * be played or previewed. The device is returned open and owned by the
+ * caller.
+ *
+ * \return the device, or nullptr if the item is missing or could not be
+ *         opened.
+ */
+QIODevice*
+EPubContainer::itemDevice(const QString& id, QObject* parent)
+{
+  SharedManifestItem item = m_manifest.item(id);
+  if (!item) {
+    QLOG_DEBUG(tr("No manifest item %1 in %2").arg(id).arg(m_filename));
+    return nullptr;
+  }
+  EPubEntryIndex::const_iterator it = m_entry_index.constFind(item->path);
+  if (it == m_entry_index.constEnd()) {
+    QLOG_DEBUG(tr("Unable to find %1 in archive").arg(item->path));
+    return nullptr;
+  }
+
+  EPubEntryDevice* device =
+    new EPubEntryDevice(m_filename, item->path, it.value(), parent);
+  if (!device->open(QIODevice::ReadOnly)) {
+    delete device;
+    return nullptr;
+  }
+  return device;
+}
+
+/*!
+ * \brief Registers the embedded fonts that a chapter uses.
+ *
+ * Only the @font-face rules of the chapter's stylesheets whose family is
+ * named by a font-family of the stylesheets or of the chapter itself are
+ * registered, see EPubFontRegistry. Fonts stay registered until the book
+ * is closed.
+ */
+void
+EPubContainer::registerFonts(const QString& chapter_id)
+{
+  SharedManifestItem chapter = m_manifest.item(chapter_id);
+  if (!chapter) {
+    return;
+  }
+
+  QStringList stylesheets;
+  QString chapter_folder = QFileInfo(chapter->href).path();
+  foreach (QString link, chapter->css_links) {
+    QString href = QDir::cleanPath(chapter_folder + '/' + link);
+    if (m_manifest.itemByHref(href)) {
+      stylesheets.append(href);
+    }
+  }
+  if (stylesheets.isEmpty()) {
+    // loadChapter() links every stylesheet.
+    stylesheets = cssKeys();
+  }
+
+  QSet<QString> families = fontFamilies(itemDocument(chapter_id));
+  QList<EPubFontFace> faces;
+  foreach (QString href, stylesheets) {
+    QString text = css(href);
+    families += fontFamilies(text);
+    QString css_folder = QFileInfo(href).path();
+    foreach (EPubFontFace face, fontFaces(text)) {
+      for (int i = 0; i < face.sources.size(); i++) {
+        face.sources[i] = QDir::cleanPath(css_folder + '/' + face.sources[i]);
+      }
+      faces.append(face);
+    }
+  }
+
+  foreach (EPubFontFace face, faces) {
+    if (!families.contains(face.family)) {
+      continue;
+    }
+    // the first source that is an embedded font.
+    foreach (QString href, face.sources) {
+      SharedManifestItem font = m_manifest.itemByHref(href);
+      if (font && (font->categories & EPubManifest::FONT) &&
+          registerFont(font)) {
+        break;
+      }
+    }
+  }
+}
+
+/*!
+ * \brief Sets the size of the decoded image cache in megabytes.
+ *
+ * Only the compressed image data is held permanently, decoded images are
+ * kept in a least recently used cache of this size.
+ */
+void
+EPubContainer::setImageCacheSize(int megabytes)
+{
+  m_image_cache.setSize(megabytes);
+}
+
+int
+EPubContainer::imageCacheSize() const
+{
+  return m_image_cache.size();
+}
+
+/*!
+ * \brief The memory held by the manifest and the image cache.
+ *
+ * The mapped archive is left out, its pages belong to the file and are
+ * dropped by the kernel as needed.
+ */
+EBookMemoryUsage
+EPubContainer::memoryUsage() const
+{
+  EBookMemoryUsage usage;
+  QSet<QString> svg_ids = m_manifest.ids(EPubManifest::SVG).toSet();
+  usage.svgs = m_image_cache.bytes(svg_ids);
+  usage.images = m_image_cache.bytes() - usage.svgs;
+
+  foreach (SharedManifestItem item, m_manifest.items()) {
+    usage.documents += qint64(item->document_string.size()) * sizeof(QChar) +
+                       item->compressed_document.size();
+  }
+  foreach (QString css, m_manifest.css) {
+    usage.styles += qint64(css.size()) * sizeof(QChar);
+  }
+  foreach (QString javascript, m_manifest.javascript) {
+    usage.styles += qint64(javascript.size()) * sizeof(QChar);
+  }
+  foreach (QByteArray data, m_manifest.image_data) {
+    usage.resources += data.size();
+  }
+  return usage;
+}
+
+/*!
+ * \brief Sets the deflate level used for text entries when saving.
+ *
+ * 1 is the fastest and 9 the smallest. Media that is already compressed,
+ * see isPrecompressedMediaType(), is always stored.
+ */
+void
+EPubContainer::setCompressionLevel(int level)
+{
+  m_compression_level = qBound(1, level, 9);
+}
+
+int
+EPubContainer::compressionLevel() const
+{
+  return m_compression_level;
+}
+
+/*!
+ * \brief Starts decoding an image, or rendering an svg, at image_size on
+ * the global thread pool.
+ *
+ * The result is added to the image cache and imageRendered() is emitted.
+ * Requests for an id and size that is already cached or being decoded are
+ * ignored.
+ */
+void
+EPubContainer::prepareImage(const QString& id, QSize image_size)
+{
+  QString key = EBookImageCache::key(id, image_size);
+  if (m_pending_images.contains(key) ||
+      !m_image_cache.cached(id, image_size).isNull()) {
+    return;
+  }
+  bool is_svg = m_manifest.contains(id, EPubManifest::SVG);
+  if (!is_svg && !m_manifest.contains(id, EPubManifest::IMAGE)) {
+    return;
+  }
+  if (!loadManifestItem(m_manifest.item(id))) {
+    return;
+  }
+  m_pending_images.insert(key);
+
+  QByteArray data = m_manifest.image_data.value(id);
+  // the decode can outlive the archive mapping.
+  data.detach();
+  QFutureWatcher<QImage>* watcher = new QFutureWatcher<QImage>(this);
+  connect(watcher,
+          &QFutureWatcher<QImage>::finished,
+          this,
+          [this, watcher, id, key, image_size]() {
+            QImage image = watcher->result();
+            m_pending_images.remove(key);
+            watcher->deleteLater();
+            if (image.isNull()) {
+              QLOG_DEBUG(tr("Unable to decode image for id %1").arg(id));
+              return;
+            }
+            m_image_cache.insert(id, image_size, image);
+            emit imageRendered(id, image_size, image);
+          });
+  if (is_svg) {
+    watcher->setFuture(
+      QtConcurrent::run(&EPubContainer::renderSvg, data, image_size));
+  } else {
+    watcher->setFuture(
+      QtConcurrent::run(&EBookImageCache::decodeImage, data, image_size));
+  }
+}
+
+/*!
+ * \brief Renders svg data to an image.
+ *
+ * This is run in a pool thread. The image is scaled to fit image_size,
+ * keeping its aspect ratio, or at the svg's own size if image_size
+ * is invalid.
+ */
+QImage
+EPubContainer::renderSvg(QByteArray data, QSize image_size)
+{
+  QSvgRenderer renderer(data);
+  if (!renderer.isValid()) {
+    return QImage();
+  }
+
+  QSize svg_size(renderer.viewBox().size());
+  if (svg_size.isValid() && image_size.isValid()) {
+    svg_size.scale(image_size, Qt::KeepAspectRatio);
+  } else if (!svg_size.isValid()) {
+    svg_size = image_size;
+  }
+  if (!svg_size.isValid()) {
+    return QImage();
+  }
+
+  QImage image(svg_size, QImage::Format_ARGB32);
+  image.fill(Qt::transparent);
+  QPainter painter(&image);
+  renderer.render(&painter);
+  painter.end();
+  return image;
+}
+
+QStringList
+EPubContainer::itemKeys()
+{
+  return m_manifest.ids();
+}
+
+SharedManifestItem
+EPubContainer::item(QString key)
+{
+  return m_manifest.item(key);
+}
+
+QString
+EPubContainer::css(QString key)
+{
+  loadManifestItem(m_manifest.itemByHref(key));
+  return m_manifest.css.value(key);
+}
+
+QString
+EPubContainer::javascript(QString key)
+{
+  loadManifestItem(m_manifest.item(key, EPubManifest::JAVASCRIPT));
+  return m_manifest.javascript.value(key);
+}
+
+QString
+EPubContainer::itemDocument(QString key)
+{
+  SharedManifestItem manifest_item = item(key);
+  if (!loadManifestItem(manifest_item)) {
+    return QString();
+  }
+  return documentString(manifest_item);
+}
+
+/*!
+ * \brief Replaces the body of an html manifest item and marks it as modified.
+ *
+ * Only modified items are re-encoded when the file is saved.
+ */
+void
+EPubContainer::setItemDocument(QString key, QString document)
+{
+  SharedManifestItem manifest_item = item(key);
+  if (!manifest_item) {
+    return;
+  }
+  manifest_item->document_string = document;
+  // compressed again if the chapter falls out of use.
+  manifest_item->compressed_document.clear();
+  manifest_item->loaded = true;
+  manifest_item->modified = true;
+  touchDocument(manifest_item);
+  markChanged();
+}
+
+/*!
+ * \brief Loads html manifest items in the background.
+ *
+ * This is used to prepare the chapters that are likely to be needed next,
+ * so that a later itemDocument() call does not have to touch the archive.
+ * The worker decodes copies of the items, the results are merged back into
+ * the manifest on this thread and only for items that have not been loaded
+ * in the meantime. Keys requested while a prefetch is running are queued
+ * until it has finished.
+ *
+ * \param keys the manifest keys of the items to load.
+ */
+void
+EPubContainer::prefetchItems(const QStringList& keys)
+{
+  if (m_prefetch_watcher) {
+    foreach (QString key, keys) {
+      if (!m_prefetch_queue.contains(key)) {
+        m_prefetch_queue.append(key);
+      }
+    }
+    return;
+  }
+
+  SharedManifestItemList copies;
+  foreach (QString key, keys) {
+    SharedManifestItem manifest_item = item(key);
+    if (!manifest_item || manifest_item->loaded ||
+        manifest_item->media_type != "application/xhtml+xml") {
+      continue;
+    }
+    copies.append(SharedManifestItem(new EPubManifestItem(*manifest_item)));
+  }
+  if (copies.isEmpty() || !m_archive) {
+    return;
+  }
+
+  QString filename = m_filename;
+  m_prefetch_watcher = new QFutureWatcher<QList<EPubLoadedItem>>(this);
+  connect(m_prefetch_watcher,
+          &QFutureWatcher<QList<EPubLoadedItem>>::finished,
+          this,
+          &EPubContainer::prefetchThreadFinished);
+  m_prefetch_watcher->setFuture(
+    QtConcurrent::run([this, filename, copies]() {
+      return loadItemChunk(filename, copies);
+    }));
+}
+
+/*!
+ * \brief Returns true while a prefetchItems() worker is running.
+ */
+bool
+EPubContainer::isPrefetching() const
+{
+  return (m_prefetch_watcher != nullptr);
+}
+
+/*!
+ * \brief Blocks until any running prefetch has finished.
+ */
+void
+EPubContainer::waitForPrefetch()
+{
+  if (!m_prefetch_watcher) {
+    return;
+  }
+  m_prefetch_queue.clear();
+  m_prefetch_watcher->waitForFinished();
+  prefetchThreadFinished();
+}
+
+void
+EPubContainer::prefetchThreadFinished()
+{
+  if (!m_prefetch_watcher) {
+    // already handled by waitForPrefetch().
+    return;
+  }
+  QList<EPubLoadedItem> results = m_prefetch_watcher->result();
+  m_prefetch_watcher->deleteLater();
+  m_prefetch_watcher = nullptr;
+
+  foreach (EPubLoadedItem loaded, results) {
+    SharedManifestItem manifest_item = item(loaded.item->id);
+    if (!manifest_item || manifest_item->loaded) {
+      continue;
+    }
+    manifest_item->document_string = loaded.item->document_string;
+    manifest_item->compressed_document = loaded.item->compressed_document;
+    manifest_item->css_links = loaded.item->css_links;
+    manifest_item->body_class = loaded.item->body_class;
+    loaded.item = manifest_item;
+    storeManifestItem(loaded);
+  }
+
+  if (!m_prefetch_queue.isEmpty()) {
+    QStringList keys = m_prefetch_queue;
+    m_prefetch_queue.clear();
+    prefetchItems(keys);
+  }
+}
+
+/*!
+ * \brief Releases the body of an unchanged html manifest item.
+ *
+ * The item is read from the archive again the next time that it is
+ * needed. Modified items are kept as they only exist in memory.
+ */
+void
+EPubContainer::unloadItem(const QString& key)
+{
+  SharedManifestItem manifest_item = item(key);
+  if (!manifest_item || !manifest_item->loaded || manifest_item->modified ||
+      manifest_item->media_type != "application/xhtml+xml") {
+    return;
+  }
+  manifest_item->document_string.clear();
+  manifest_item->compressed_document.clear();
+  manifest_item->loaded = false;
+  m_hot_documents.removeOne(key);
+}
+
+/*!
+ * \brief Compresses the body of a chapter to be kept while it is not in
+ * use, see uncompressDocument().
+ *
+ * Chapters are compressed as UTF-8 with a fast zlib level, text compresses
+ * to around a third of its UTF-8 size and a sixth of its size in memory.
+ */
+QByteArray
+EPubContainer::compressDocument(const QString& document)
+{
+  if (document.isEmpty()) {
+    return QByteArray();
+  }
+  return qCompress(document.toUtf8(), DOCUMENT_COMPRESSION_LEVEL);
+}
+
+QString
+EPubContainer::uncompressDocument(const QByteArray& compressed)
+{
+  if (compressed.isEmpty()) {
+    return QString();
+  }
+  return QString::fromUtf8(qUncompress(compressed));
+}
+
+/*
+ * The body of a loaded chapter. If keep is true the chapter, uncompressed
+ * if it has to be, is kept as one of the HOT_DOCUMENTS, otherwise a
+ * compressed chapter is uncompressed for the caller alone, so that passes
+ * over the whole book do not push out the chapters in use.
+ */
+QString
+EPubContainer::documentString(SharedManifestItem item, bool keep)
+{
+  if (!item->document_string.isEmpty() ||
+      item->compressed_document.isEmpty()) {
+    if (keep) {
+      touchDocument(item);
+    }
+    return item->document_string;
+  }
+  QString document = uncompressDocument(item->compressed_document);
+  if (keep) {
+    item->document_string = document;
+    touchDocument(item);
+  }
+  return document;
+}
+
+/*
+ * Makes a chapter the most recently used, compressing the least recently
+ * used once there are more than HOT_DOCUMENTS.
+ */
+void
+EPubContainer::touchDocument(SharedManifestItem item)
+{
+  if (!m_hot_documents.isEmpty() && m_hot_documents.first() == item->id) {
+    return;
+  }
+  m_hot_documents.removeOne(item->id);
+  m_hot_documents.prepend(item->id);
+  while (m_hot_documents.size() > HOT_DOCUMENTS) {
+    SharedManifestItem cold = m_manifest.item(m_hot_documents.takeLast());
+    if (cold) {
+      releaseDocument(cold);
+    }
+  }
+}
+
+/*
+ * Drops the uncompressed body of a chapter, compressing it first unless
+ * the compressed copy is still current.
+ */
+void
+EPubContainer::releaseDocument(SharedManifestItem item)
+{
+  if (item->document_string.isEmpty()) {
+    return;
+  }
+  if (item->compressed_document.isEmpty()) {
+    item->compressed_document = compressDocument(item->document_string);
+  }
+  item->document_string.clear();
+}
+
+/*!
+ * \brief The edit version of the book, which changes whenever the book is
+ * loaded or changed.
+ */
+quint64
+EPubContainer::editVersion() const
+{
+  return m_edit_version;
+}
+
+/*!
+ * \brief Records a change to the book, the next snapshot() is taken afresh.
+ *
+ * Changes made through the container are recorded by the container, those
+ * made to the metadata() in place must be recorded by the caller.
+ */
+void
+EPubContainer::markChanged()
+{
+  m_edit_version++;
+  m_snapshot.clear();
+}
+
+/*!
+ * \brief The body of a chapter, uncompressing it if it was not in use when
+ * the snapshot was taken, or an empty string if it was not loaded.
+ */
+QString
+EPubBookSnapshot::document(const QString& id) const
+{
+  QHash<QString, QString>::const_iterator it = documents.constFind(id);
+  if (it != documents.constEnd()) {
+    return it.value();
+  }
+  return EPubContainer::uncompressDocument(compressed_documents.value(id));
+}
+
+/*!
+ * \brief An immutable copy of the book for use on other threads.
+ *
+ * The same snapshot is returned until the book is changed, so asking for
+ * one is cheap. This must be called on the thread that owns the container,
+ * the snapshot itself can then be handed to any thread.
+ */
+SharedBookSnapshot
+EPubContainer::snapshot()
+{
+  if (m_snapshot && m_snapshot->version == m_edit_version) {
+    return m_snapshot;
+  }
+  QSharedPointer<EPubBookSnapshot> snapshot(new EPubBookSnapshot());
+  snapshot->version = m_edit_version;
+  snapshot->filename = m_filename;
+  snapshot->metadata_xml = m_metadata_xml;
+  if (m_metadata) {
+    snapshot->unique_identifier = uniqueIdentifier();
+    OrderedTitleMap titles = m_metadata->orderedTitles();
+    if (!titles.isEmpty() && !titles.first().isNull()) {
+      snapshot->title = titles.first()->title;
+    }
+    snapshot->creators = m_metadata->creatorList();
+  }
+  snapshot->language = language();
+  foreach (SharedManifestItem manifest_item, m_manifest.items()) {
+    EPubSnapshotItem item;
+    item.id = manifest_item->id;
+    item.href = manifest_item->href;
+    item.path = manifest_item->path;
+    item.media_type = manifest_item->media_type;
+    item.properties = manifest_item->properties;
+    item.categories = manifest_item->categories;
+    snapshot->manifest.append(item.id);
+    snapshot->items.insert(item.id, item);
+    if (manifest_item->loaded && isType(manifest_item, XHTML_TYPE)) {
+      if (!manifest_item->document_string.isEmpty()) {
+        snapshot->documents.insert(item.id, manifest_item->document_string);
+      } else if (!manifest_item->compressed_document.isEmpty()) {
+        snapshot->compressed_documents.insert(
+          item.id, manifest_item->compressed_document);
+      }
+    }
+  }
+  snapshot->spine = m_spine.ordered_items;
+  snapshot->css = m_manifest.css;
+  m_snapshot = snapshot;
+  return m_snapshot;
+}
+
+// void setStartCursor(SharedTextCursor start) {
+//  m_manif
+//}
+
+/*!
+ * \brief The ordered list of Spine keys.
+ *
+ * \return a QStringList of spine keys;
+ */
+QStringList
+EPubContainer::spineKeys()
+{
+  return m_spine.ordered_items;
+}
+
+QStringList
+EPubContainer::imageKeys()
+{
+  QStringList keys;
+  foreach (SharedManifestItem item, m_manifest.items()) {
+    // xhtml with the svg property is not an image.
+    if ((item->categories & EPubManifest::IMAGE) || isType(item, SVG_TYPE)) {
+      keys.append(item->id);
+    }
+  }
+  return keys;
+}
+
+QStringList
+EPubContainer::cssKeys()
+{
+  return m_manifest.hrefs(EPubManifest::CSS);
+}
+
+QStringList
+EPubContainer::jsKeys()
+{
+  return m_manifest.ids(EPubManifest::JAVASCRIPT);
+}
+
+QString
+EPubContainer::tocAsString()
+{
+  return toc().toHtml();
+}
+
+/*!
+ * \brief The toc tree read from the toc file.
+ *
+ * The entries are made once from the toc items and shared by every caller
+ * until the toc file is read again.
+ */
+EBookToc
+EPubContainer::toc()
+{
+  if (m_toc.isEmpty() && !m_manifest.toc_roots.isEmpty()) {
+    m_toc.title = m_manifest.toc_title;
+    foreach (int playorder, m_manifest.toc_roots) {
+      SharedTocItem toc_item = m_manifest.toc_items.value(playorder);
+      if (toc_item) {
+        m_toc.entries.append(tocEntry(toc_item));
+      }
+    }
+  }
+  return m_toc;
+}
+
+SharedTocEntry
+EPubContainer::tocEntry(SharedTocItem toc_item)
+{
+  SharedTocEntry entry(new EBookTocEntry());
+  entry->label = toc_item->label;
+  entry->href = toc_item->source;
+  foreach (SharedTocItem sub_item, toc_item->sub_items) {
+    entry->children.append(tocEntry(sub_item));
+  }
+  return entry;
+}
+
+QStringList
+EPubContainer::creators()
+{
+  return m_metadata->creatorList();
+}
+
+/*!
+ * \brief The language of the book, from its first dc:language or else the
+ * xml:lang of the package.
+ */
+QString
+EPubContainer::language()
+{
+  QStringList languages = m_metadata->languages();
+  if (!languages.isEmpty()) {
+    return languages.first();
+  }
+  return m_package_language;
+}
+
+Metadata
+EPubContainer::metadata()
+{
+  return m_metadata;
+}
+
+EPubManifest
+EPubContainer::manifest()
+{
+  return m_manifest;
+}
+
+bool
+EPubContainer::parseMimetype()
+{
+  if (m_files.contains(MIMETYPE_FILE)) {
+    setCurrentEntry(m_archive, MIMETYPE_FILE);
+    QuaZipFile mimetypeFile(m_archive);
+
+    if (!mimetypeFile.open(QIODevice::ReadOnly)) {
+      int error = m_archive->getZipError();
+      QLOG_DEBUG(tr("Unable to open mimetype file : error %1").arg(error));
+      return false;
+    }
+
+    m_mimetype = mimetypeFile.readAll();
     if (m_mimetype != MIMETYPE) {
       QLOG_DEBUG(tr("Unexpected mimetype %1").arg(QString(m_mimetype)));
     }
-  } else {
-    QLOG_DEBUG(tr("Unable to find mimetype in file"));
+  } else {
+    QLOG_DEBUG(tr("Unable to find mimetype in file"));
+    return false;
+  }
+  return true;
+}
+
+bool
+EPubContainer::parseContainer()
+{
+  if (m_files.contains(CONTAINER_FILE)) {
+    setCurrentEntry(m_archive, CONTAINER_FILE);
+    QuaZipFile containerFile(m_archive);
+    containerFile.setZip(m_archive);
+
+    if (!containerFile.open(QIODevice::ReadOnly)) {
+      int error = m_archive->getZipError();
+      QLOG_DEBUG(tr("Unable to open container file error %1").arg(error));
+      return false;
+    }
+
+    QString container =
+      EBookTextDecoder::decode(containerFile.readAll());
+    QDomDocument container_document;
+    container_document.setContent(container);
+    QDomElement root_elem = container_document.documentElement();
+    QDomNamedNodeMap att_map = root_elem.attributes();
+    m_container_version = root_elem.attribute("version");
+    m_container_xmlns = root_elem.attribute("xmlns");
+
+    QDomNodeList root_files = root_elem.elementsByTagName("rootfiles");
+    if (root_files.size() > 0) {
+      QDomElement rootfiles_elem = root_files.at(0).toElement();
+      QDomNodeList root_nodes = root_elem.elementsByTagName("rootfile");
+      for (int i = 0; i < root_nodes.count(); i++) {
+        QDomElement root_element = root_nodes.at(i).toElement();
+        m_container_fullpath = root_element.attribute("full-path");
+        m_container_mediatype = root_element.attribute("media-type");
+        if (m_container_fullpath.isEmpty()) {
+          QLOG_WARN(tr("Invalid root file entry"));
+          continue;
+        }
+        if (parsePackageFile(m_container_fullpath)) {
+          return true;
+        }
+      }
+    }
+
+  } else {
+    QLOG_DEBUG(tr("Unable to find container information"));
+    return false;
+  }
+
+  // Limitations:
+  //  - We only read one rootfile
+  //  - We don't read the following from META-INF/
+  //     - manifest.xml (unknown contents, just reserved)
+  //     - metadata.xml (unused according to spec, just reserved)
+  //     - rights.xml (reserved for DRM, not standardized)
+  //     - signatures.xml (signatures for files, standardized)
+  // Actually these are rarely included in an epub file anyway.
+
+  QLOG_DEBUG(tr("Unable to find and use any content files"));
+  return false;
+}
+
+// void EPubContainer::createChapterAnchorPoints(SharedSpineItem spine_item)
+//{
+//  SharedManifestItem manifest_item =
+//  m_manifest.items.value(spine_item->idref); if (manifest_item) {
+//    SharedTocItem toc_item = m_manifest.toc_paths.value(manifest_item->href);
+//    if (toc_item) {
+//      if (!toc_item->chapter_tag.isEmpty()) {
+//        // toc has a label added.
+//        QString tag("<a id=\"%1\"></a>");
+//        tag = tag.arg(toc_item->chapter_tag);
+//        QString document = manifest_item->document_string;
+//        QRegularExpression body_tag("<body[^>]*> ");
+//        QRegularExpressionMatch match = body_tag.match(document);
+//        if (match.hasMatch()) {
+//          //        int start = match.capturedStart();
+//          int end = match.capturedEnd();
+//          document.insert(end, tag);
+//        }
+//      }
+
+//      if (!toc_item->sub_items.isEmpty()) {
+//      }
+//    }
+//  }
+//}
+
+/*!
+ * \brief Reads the package file, see parsePackageContent(), and then the
+ * table of contents that it names.
+ */
+bool
+EPubContainer::parsePackageFile(QString& full_path)
+{
+  EBOOK_TRACE_SCOPE("EPubContainer::parsePackageFile");
+  QByteArray data;
+  if (!readArchiveEntry(m_archive, full_path, data)) {
+    QLOG_DEBUG(tr("Malformed content file, unable to get content metadata"));
+    return false;
+  }
+  parsePackageContent(EBookTextDecoder::decode(data), full_path);
+
+  if (m_metadata_only || m_cover_only) {
+    return true;
+  }
+  if (!m_spine.toc.isEmpty() || m_manifest.nav) { // EPUB2.0 or 3.0 toc
+    parseTocFile();
+  }
+
+  //    /*
+  //     * At this point not all books have anchors added for chapter links.
+  //     Calibre
+  //     * adds in anchors at the end of the previous chapter. For
+  //     simplicities sake I
+  //     * am adding them at the start of the new chapter.
+  //     * Also remember that some
+  //     */
+  //    createChapterAnchorPoints(spine_item);
+
+  //  parseLandmarkItem();
+  //  parseBindingsItem(); // Tis is used for non-epb standard media types.
+
+  return true;
+}
+
+/*!
+ * \brief Reads a package file with a single QXmlStreamReader pass.
+ *
+ * The manifest and spine are built directly from the reader's events. The
+ * metadata element is cut out of the package as text, along with the
+ * namespace declarations of the package element, and only that fragment is
+ * handed to EBookMetadata as a DOM. The same fragment is stored in the parse
+ * cache.
+ *
+ * \param content the decoded package file.
+ * \param full_path the path of the package file in the archive, which the
+ * paths of the manifest items are relative to.
+ */
+void
+EPubContainer::parsePackageContent(const QString& content,
+                                   const QString& full_path)
+{
+  // Extract current path, for resolving relative paths
+  QString content_file_folder;
+  int separator_index = full_path.lastIndexOf('/');
+  if (separator_index > 0) {
+    content_file_folder = full_path.left(separator_index + 1);
+  }
+
+  QString namespaces;
+  m_metadata_xml.clear();
+  QXmlStreamReader reader(content);
+
+  while (!reader.atEnd()) {
+    if (reader.readNext() != QXmlStreamReader::StartElement) {
+      continue;
+    }
+    QStringRef name = reader.name();
+
+    if (name == QLatin1String("package")) {
+      foreach (QXmlStreamNamespaceDeclaration declaration,
+               reader.namespaceDeclarations()) {
+        if (declaration.prefix().isEmpty()) {
+          m_package_xmlns = declaration.namespaceUri().toString().toLower();
+          namespaces += QString(" xmlns=\"%1\"")
+                          .arg(declaration.namespaceUri().toString());
+        } else {
+          namespaces += QString(" xmlns:%1=\"%2\"")
+                          .arg(declaration.prefix().toString())
+                          .arg(declaration.namespaceUri().toString());
+        }
+      }
+      parsePackageAttributes(reader.attributes());
+
+    } else if (name == QLatin1String("metadata")) {
+      // the start tag begins at the last '<' before the current offset.
+      int start = content.lastIndexOf('<', int(reader.characterOffset()) - 1);
+      reader.skipCurrentElement();
+      int end = int(reader.characterOffset());
+      if (start >= 0 && end > start) {
+        m_metadata_xml =
+          PACKAGE_WRAPPER.arg(namespaces, content.mid(start, end - start));
+      }
+      if (m_metadata_only) {
+        break;
+      }
+
+    } else if (name == QLatin1String("manifest")) {
+      m_manifest.id = reader.attributes().value(QLatin1String("id")).toString();
+
+    } else if (name == QLatin1String("item")) {
+      parseManifestItem(reader.attributes(), content_file_folder);
+
+    } else if (name == QLatin1String("spine")) {
+      // Parse out the document guide
+      // please note that this has been superceded by landmarks in EPUB 3.0
+      QXmlStreamAttributes attributes = reader.attributes();
+      if (attributes.hasAttribute(QLatin1String("id"))) { // optional
+        m_spine.id = attributes.value(QLatin1String("id")).toString();
+      }
+      if (attributes.hasAttribute(QLatin1String("toc"))) { // optional
+        m_spine.toc = attributes.value(QLatin1String("toc")).toString();
+      }
+      if (attributes.hasAttribute(
+            QLatin1String("page-progression-dir"))) { // optional
+        m_spine.page_progression_dir =
+          attributes.value(QLatin1String("page-progression-dir")).toString();
+      }
+
+    } else if (name == QLatin1String("itemref")) {
+      if (!m_cover_only) {
+        parseSpineItem(reader.attributes());
+      }
+
+    } else if (name == QLatin1String("guide")) {
+      //    parseGuideItem(); // this has been superceded by landmarks.
+      if (!m_cover_only) {
+        reader.skipCurrentElement();
+      }
+
+    } else if (name == QLatin1String("reference") && m_cover_only) {
+      // only reached inside the guide.
+      QXmlStreamAttributes attributes = reader.attributes();
+      if (attributes.value(QLatin1String("type")) == QLatin1String("cover") &&
+          m_guide_cover.isEmpty()) {
+        m_guide_cover = attributes.value(QLatin1String("href")).toString();
+      }
+    }
+  }
+
+  if (reader.hasError()) {
+    QLOG_DEBUG(tr("Error in content file %1 : %2")
+                 .arg(full_path)
+                 .arg(reader.errorString()));
+  }
+
+  parseMetadataXml(m_metadata_xml);
+}
+
+void
+EPubContainer::parsePackageAttributes(const QXmlStreamAttributes& attributes)
+{
+  foreach (QXmlStreamAttribute attribute, attributes) {
+    QStringRef name = attribute.qualifiedName();
+    QString value = attribute.value().toString().toLower();
+    // parse package attributes.
+    if (name == QLatin1String("version")) {
+      if (value == "2.0") {
+        m_version = 2;
+      } else if (value == "3.0") {
+        m_version = 3;
+      }
+    } else if (name == QLatin1String("unique-identifier")) {
+      m_metadata->setUniqueIdentifierName(value);
+    } else if (name == QLatin1String("xml:lang")) {
+      m_package_language = value;
+    } else if (name == QLatin1String("prefix")) { // Only 3.0
+      // TODO - handle prefix mapping - may not need this, just store value.
+      m_package_prefix = value;
+    } else if (name == QLatin1String("dir")) { // Only 3.0
+      m_package_direction = value;
+    } else if (name == QLatin1String("id")) { // Only 3.0
+      m_package_id = value;
+    }
+  }
+}
+
+/*!
+ * \brief Passes the cut out metadata element to EBookMetadata.
+ *
+ * \param metadata_xml the metadata element wrapped in a package element
+ *        that declares the package's namespaces.
+ */
+void
+EPubContainer::parseMetadataXml(const QString& metadata_xml)
+{
+  QDomDocument metadata_document;
+  metadata_document.setContent(metadata_xml, true);
+  m_metadata->parse(metadata_document.elementsByTagName("metadata"));
+  // a save only writes the package again once these change.
+  m_written_metadata = metadataChildren();
+}
+
+/*!
+ * \brief Extracts the stylesheet links and body class from an html file.
+ *
+ * Only the head of the document is read, the reader stops as soon as the
+ * \<body\> start tag has been reached so the chapter body is never parsed.
+ */
+void
+EPubContainer::extractHeadInformationFromHtmlFile(SharedManifestItem item,
+                                                  QString container)
+{
+  QXmlStreamReader reader(container);
+
+  while (!reader.atEnd()) {
+    QXmlStreamReader::TokenType token = reader.readNext();
+    if (token != QXmlStreamReader::StartElement) {
+      continue;
+    }
+
+    QStringRef name = reader.name();
+    if (name == QLatin1String("link")) {
+      QXmlStreamAttributes attributes = reader.attributes();
+      if (attributes.value(QLatin1String("rel")) ==
+            QLatin1String("stylesheet") &&
+          attributes.value(QLatin1String("type")) ==
+            QLatin1String("text/css")) {
+        QString href = attributes.value(QLatin1String("href")).toString();
+        if (!href.isEmpty()) {
+          item->css_links.append(EBookStringPool::instance()->intern(href));
+        }
+      }
+
+    } else if (name == QLatin1String("body")) {
+      QString att =
+        reader.attributes().value(QLatin1String("class")).toString();
+      if (!att.isEmpty()) {
+        item->body_class = EBookStringPool::instance()->intern(att);
+      }
+      // everything needed is in the head, or on the body tag itself.
+      break;
+    }
+  }
+
+  if (reader.hasError() &&
+      reader.error() != QXmlStreamReader::PrematureEndOfDocumentError) {
+    QLOG_DEBUG(tr("Error reading head of %1 : %2")
+                 .arg(item->path)
+                 .arg(reader.errorString()));
+  }
+}
+
+bool
+EPubContainer::parseManifestItem(const QXmlStreamAttributes& attributes,
+                                 const QString current_folder)
+{
+  EBOOK_TRACE_SCOPE("EPubContainer::parseManifestItem");
+  QString value;
+  SharedManifestItem item = SharedManifestItem(new EPubManifestItem());
+
+  if (attributes.hasAttribute(QLatin1String("href"))) {
+    value = attributes.value(QLatin1String("href")).toString();
+    QString path = QDir::cleanPath(current_folder + value);
+    item->href = value;
+    item->path = path;
+  } else {
+    QLOG_DEBUG(tr("Warning invalid manifest item : no href value"))
+  }
+
+  if (attributes.hasAttribute(QLatin1String("id"))) {
+    item->id = attributes.value(QLatin1String("id")).toString();
+  } else {
+    QLOG_DEBUG(tr("Warning invalid manifest item : no id value"))
+  }
+
+  if (attributes.hasAttribute(QLatin1String("media-type"))) {
+    // interned, so that isType() compares by pointer.
+    item->media_type = EBookStringPool::instance()->intern(
+      attributes.value(QLatin1String("media-type")).toString().toLatin1());
+  } else {
+    QLOG_DEBUG(tr("Warning invalid manifest item : no media-type value"))
+  }
+
+  if (attributes.hasAttribute(QLatin1String("properties"))) {
+    value = attributes.value(QLatin1String("properties")).toString();
+    // space separated list
+    QStringList properties = EBookStringPool::instance()->intern(
+      value.split(' ', QString::SkipEmptyParts));
+    item->properties = properties;
+
+    foreach (QString prop, properties) {
+      if (prop != "cover-image" && prop != "nav" && prop != "svg" &&
+          prop != "switch" && prop != "mathml" && prop != "remote-resources" &&
+          prop != "scripted") {
+        // one of the exmples had a data-nav element which is NOT standard.
+        // not certain what to do with these.
+        item->non_standard_properties.insert("properties", value);
+      }
+    }
+  }
+
+  if (attributes.hasAttribute(QLatin1String("fallback"))) {
+    item->fallback = attributes.value(QLatin1String("fallback")).toString();
+  }
+
+  if (attributes.hasAttribute(QLatin1String("media-overlay"))) {
+    item->media_overlay =
+      attributes.value(QLatin1String("media-overlay")).toString();
+  }
+
+  indexManifestItem(item);
+
+  if (!m_lazy_loading) {
+    return loadManifestItem(item);
+  }
+  return true;
+}
+
+/*!
+ * \brief Sets the categories of a manifest item from its media type and
+ * properties, and adds it to the manifest.
+ *
+ * Only the item records are built here, the entry data itself is read by
+ * loadManifestItem(), either on first access or straight away if lazy
+ * loading has been turned off.
+ */
+void
+EPubContainer::indexManifestItem(SharedManifestItem item)
+{
+  if (isType(item, GIF_TYPE) || isType(item, JPEG_TYPE) ||
+      isType(item, PNG_TYPE)) {
+
+    if (!QImageReader::supportedMimeTypes().contains(item->media_type)) {
+      QLOG_DEBUG(QString("Requested image type %1 is an unsupported type")
+                   .arg(QString(item->media_type)));
+    }
+    item->categories |= EPubManifest::IMAGE;
+
+  } else if (isType(item, OPENTYPE_TYPE) || isType(item, WOFF_TYPE)) {
+    item->categories |= EPubManifest::FONT;
+
+  } else if (isType(item, SVG_TYPE)) {
+    item->categories |= EPubManifest::SVG;
+
+  } else if (isType(item, XHTML_TYPE)) {
+    item->categories |= EPubManifest::HTML;
+
+  } else if (isType(item, CSS_TYPE)) {
+    item->categories |= EPubManifest::CSS;
+
+  } else if (isType(item, JAVASCRIPT_TYPE)) {
+    item->categories |= EPubManifest::JAVASCRIPT;
+  }
+
+  foreach (QString prop, item->properties) {
+    if (prop == "cover-image") {
+      // only one cover-image allowed.
+      m_manifest.cover_image = item;
+    } else if (prop == "nav") {
+      // only one nav allowed.
+      m_manifest.nav = item;
+    } else if (prop == "svg") {
+      item->categories |= EPubManifest::SVG;
+    } else if (prop == "switch") {
+      item->categories |= EPubManifest::SWITCH;
+    } else if (prop == "mathml") {
+      item->categories |= EPubManifest::MATHML;
+    } else if (prop == "remote-resources") {
+      item->categories |= EPubManifest::REMOTE;
+    } else if (prop == "scripted") {
+      item->categories |= EPubManifest::SCRIPTED;
+    }
+  }
+
+  if (!item->media_overlay.isEmpty()) {
+    item->categories |= EPubManifest::MEDIA_OVERLAY;
+  }
+
+  m_manifest.insert(item);
+}
+
+/*!
+ * \brief Reads the data for a manifest item from the archive.
+ *
+ * The data is processed according to the items media type and cached in the
+ * manifest so that subsequent requests do not touch the archive again. Items
+ * that have already been loaded, or that have no cacheable data, are ignored.
+ *
+ * \param item the manifest item to load.
+ * \return true if the item was loaded, otherwise false.
+ */
+bool
+EPubContainer::loadManifestItem(SharedManifestItem item)
+{
+  if (item.isNull()) {
+    return false;
+  }
+  if (item->loaded || !isCachedItem(item)) {
+    return true;
+  }
+
+  QByteArray data;
+  if (!readArchiveEntry(m_archive, item->path, data)) {
+    return false;
+  }
+
+  storeManifestItem(decodeManifestItem(item, data));
+  return true;
+}
+
+/*!
+ * \brief Forces all of the manifest items to be loaded.
+ *
+ * This is needed before operations that need the entire book in memory,
+ * saving for example. Items that are not yet loaded are decompressed and
+ * decoded in parallel, see loadItemsParallel().
+ *
+ * \return true if all items were loaded, otherwise false.
+ */
+bool
+EPubContainer::loadAllItems()
+{
+  SharedManifestItemList unloaded;
+  foreach (SharedManifestItem item, m_manifest.items()) {
+    if (!item->loaded && isCachedItem(item)) {
+      unloaded.append(item);
+    }
+  }
+
+  if (unloaded.size() > 1) {
+    return loadItemsParallel(unloaded);
+  }
+
+  bool result = true;
+  foreach (SharedManifestItem item, unloaded) {
+    if (!loadManifestItem(item)) {
+      result = false;
+    }
+  }
+  return result;
+}
+
+/*!
+ * \brief Checks the book for damage, see IEBookInterface::verifyBook().
+ *
+ * Every archive entry is read in full so that its checksum is checked,
+ * including stored entries which are otherwise read from the mapping
+ * unchecked. Every manifest item must be in the archive, every spine item
+ * in the manifest and every xhtml item must be well formed.
+ *
+ * \param problems the problems found are appended to this.
+ * \return true if none were found, otherwise false.
+ */
+bool
+EPubContainer::verify(QStringList& problems)
+{
+  EBOOK_TRACE_SCOPE("EPubContainer::verify");
+  int found = problems.size();
+
+  foreach (SharedManifestItem item, m_manifest.items()) {
+    if (!m_entry_index.contains(item->path)) {
+      problems.append(tr("Manifest item %1 is missing its file %2")
+                        .arg(item->id)
+                        .arg(item->path));
+    }
+  }
+
+  foreach (QString idref, m_spine.ordered_items) {
+    if (!m_manifest.contains(idref)) {
+      problems.append(tr("Spine item %1 is not in the manifest").arg(idref));
+    }
+  }
+
+  foreach (QString name, m_files) {
+    if (!setCurrentEntry(m_archive, name)) {
+      problems.append(tr("Unable to find %1 in archive").arg(name));
+      continue;
+    }
+    QuaZipFile entry(m_archive);
+    if (!entry.open(QIODevice::ReadOnly)) {
+      problems.append(tr("Unable to open file %1 : error %2")
+                        .arg(name)
+                        .arg(entry.getZipError()));
+      continue;
+    }
+    // only html is checked further, anything else is inflated a chunk at a
+    // time so that large media is not held in memory.
+    SharedManifestItem item = m_manifest.itemByPath(name);
+    bool html = (item && (item->categories & EPubManifest::HTML));
+    QByteArray data;
+    if (html) {
+      data = entry.readAll();
+    } else {
+      QByteArray chunk(COPY_CHUNK_SIZE, Qt::Uninitialized);
+      while (entry.read(chunk.data(), chunk.size()) > 0) {
+        // dropped, reading it is enough for the crc to be checked.
+      }
+    }
+    entry.close();
+    // a checksum mismatch is only reported when the entry is closed.
+    if (entry.getZipError() != UNZ_OK) {
+      problems.append(
+        tr("%1 is damaged : error %2").arg(name).arg(entry.getZipError()));
+      continue;
+    }
+
+    if (html) {
+      QXmlStreamReader reader(data);
+      while (!reader.atEnd()) {
+        reader.readNext();
+      }
+      if (reader.hasError()) {
+        problems.append(tr("%1 is not well formed : %2 at line %3")
+                          .arg(name)
+                          .arg(reader.errorString())
+                          .arg(reader.lineNumber()));
+      }
+    }
+  }
+
+  return (problems.size() == found);
+}
+
+/*!
+ * \brief Reads the loaded book into content for EBookConverter.
+ *
+ * The spine items are the chapters and every other local manifest item is
+ * a resource, apart from the navigation documents as the writer makes its
+ * own. Hrefs are kept relative to the package file so that the links
+ * between the items still work.
+ */
+bool
+EPubContainer::readContent(EBookContent& content)
+{
+  EBOOK_TRACE_SCOPE("EPubContainer::readContent");
+  content.metadata = m_metadata;
+
+  QSet<QString> chapter_ids;
+  foreach (QString idref, m_spine.ordered_items) {
+    SharedManifestItem item = m_manifest.item(idref);
+    if (!item || chapter_ids.contains(idref)) {
+      continue;
+    }
+    QByteArray data;
+    if (!readArchiveEntry(m_archive, item->path, data)) {
+      return false;
+    }
+    EBookContentChapter chapter;
+    chapter.href = item->href;
+    chapter.xhtml = EBookTextDecoder::decode(data);
+    SharedTocItem toc_item = m_manifest.toc_paths.value(item->href);
+    if (toc_item) {
+      chapter.title = toc_item->label;
+    }
+    content.chapters.append(chapter);
+    chapter_ids.insert(idref);
+  }
+
+  foreach (SharedManifestItem item, m_manifest.items()) {
+    if (chapter_ids.contains(item->id) || item == m_manifest.nav ||
+        (item->categories & EPubManifest::REMOTE) ||
+        item->media_type == "application/x-dtbncx+xml") {
+      continue;
+    }
+    QByteArray data;
+    if (!readArchiveEntry(m_archive, item->path, data)) {
+      return false;
+    }
+    EBookContentResource resource;
+    resource.href = item->href;
+    resource.media_type = QString::fromLatin1(item->media_type);
+    // a mapped entry is only valid while the archive is open.
+    resource.data = QByteArray(data.constData(), data.size());
+    content.resources.append(resource);
+  }
+
+  if (m_manifest.cover_image) {
+    content.cover_href = m_manifest.cover_image->href;
+  }
+  return true;
+}
+
+/*!
+ * \brief Compares two versions of an epub file by file.
+ *
+ * The central directories of the two archives are read and their entries
+ * matched by path. An entry with the same CRC-32 and size in both is taken
+ * as unchanged without being decompressed, so comparing a book with a copy
+ * in which one chapter was edited reads only that chapter from each. The
+ * xhtml and package files that changed are then read and diffed in
+ * parallel, see diffEntryChunk().
+ *
+ * The chapters are numbered and titled from the spine and table of
+ * contents of the changed book, or of the original for chapters that were
+ * removed.
+ *
+ * \return true if both archives were read, otherwise false.
+ */
+bool
+EPubContainer::compareFiles(const QString& original,
+                            const QString& changed,
+                            EBookComparison& comparison)
+{
+  EBOOK_TRACE_SCOPE("EPubContainer::compareFiles");
+  comparison = EBookComparison();
+  comparison.original = original;
+  comparison.changed = changed;
+
+  QStringList original_files, changed_files;
+  EPubEntryIndex original_index, changed_index;
+  if (!readCentralDirectory(original, original_files, original_index) ||
+      !readCentralDirectory(changed, changed_files, changed_index)) {
+    return false;
+  }
+
+  QStringList text_paths;
+  bool removed = false;
+  foreach (QString path, changed_files) {
+    EPubEntryIndex::const_iterator it = original_index.constFind(path);
+    EPubArchiveEntry entry = changed_index.value(path);
+    if (it != original_index.constEnd() && it.value().crc == entry.crc &&
+        it.value().uncompressed_size == entry.uncompressed_size) {
+      comparison.unchanged++;
+    } else if (it != original_index.constEnd() && isTextEntry(path)) {
+      text_paths.append(path);
+    } else {
+      EBookEntryDifference difference;
+      difference.path = path;
+      difference.change = (it == original_index.constEnd()
+                             ? EBookEntryDifference::ADDED
+                             : EBookEntryDifference::CHANGED);
+      difference.text = isTextEntry(path);
+      comparison.differences.append(difference);
+    }
+  }
+  foreach (QString path, original_files) {
+    if (!changed_index.contains(path)) {
+      EBookEntryDifference difference;
+      difference.path = path;
+      difference.change = EBookEntryDifference::REMOVED;
+      difference.text = isTextEntry(path);
+      comparison.differences.append(difference);
+      removed = true;
+    }
+  }
+
+  if (!text_paths.isEmpty()) {
+    int thread_count =
+      qMax(1, QThreadPool::globalInstance()->maxThreadCount());
+    int chunk_size = (text_paths.size() + thread_count - 1) / thread_count;
+    QList<QStringList> chunks;
+    for (int i = 0; i < text_paths.size(); i += chunk_size) {
+      chunks.append(text_paths.mid(i, chunk_size));
+    }
+    std::function<EBookEntryDifferenceList(const QStringList&)> worker =
+      [original, original_index, changed, changed_index](
+        const QStringList& chunk) {
+        return diffEntryChunk(
+          original, original_index, changed, changed_index, chunk);
+      };
+    QFuture<EBookEntryDifferenceList> future =
+      QtConcurrent::mapped(chunks, worker);
+    future.waitForFinished();
+    foreach (EBookEntryDifferenceList results, future.results()) {
+      comparison.differences.append(results);
+    }
+  }
+
+  if (!comparison.differences.isEmpty()) {
+    EPubContainer changed_book;
+    if (changed_book.loadFile(changed)) {
+      changed_book.describeChapters(comparison.differences, false);
+    }
+  }
+  if (removed) {
+    EPubContainer original_book;
+    if (original_book.loadFile(original)) {
+      original_book.describeChapters(comparison.differences, true);
+    }
+  }
+
+  std::sort(comparison.differences.begin(),
+            comparison.differences.end(),
+            [](const EBookEntryDifference& a, const EBookEntryDifference& b) {
+              if ((a.chapter < 0) != (b.chapter < 0)) {
+                return (a.chapter >= 0);
+              }
+              if (a.chapter != b.chapter) {
+                return (a.chapter < b.chapter);
+              }
+              return (a.path < b.path);
+            });
+  return true;
+}
+
+/*
+ * Reads only the central directory of an archive, the entries' names,
+ * positions, sizes and checksums.
+ */
+bool
+EPubContainer::readCentralDirectory(const QString& filename,
+                                    QStringList& files,
+                                    EPubEntryIndex& index)
+{
+  QuaZip archive(filename);
+  if (!archive.open(QuaZip::mdUnzip)) {
+    QLOG_DEBUG(tr("Failed to open %1").arg(filename));
+    return false;
+  }
+
+  unzFile unz_file = archive.getUnzFile();
+  for (bool more = archive.goToFirstFile(); more;
+       more = archive.goToNextFile()) {
+    EPubArchiveEntry entry;
+    QuaZipFileInfo64 info;
+    if (unzGetFilePos64(unz_file, &entry.position) != UNZ_OK ||
+        !archive.getCurrentFileInfo(&info)) {
+      QLOG_DEBUG(tr("Unable to index %1").arg(filename));
+      return false;
+    }
+    entry.crc = info.crc;
+    entry.uncompressed_size = qint64(info.uncompressedSize);
+    files.append(info.name);
+    index.insert(info.name, entry);
+  }
+
+  if (archive.getZipError() != UNZ_OK) {
+    QLOG_DEBUG(tr("Failed to read the central directory of %1 : error %2")
+                 .arg(filename)
+                 .arg(archive.getZipError()));
+    return false;
+  }
+  return true;
+}
+
+/*!
+ * \brief Worker method for compareFiles(), diffs the changed text entries
+ * of chunk.
+ *
+ * This runs in a pool thread so opens its own QuaZip handles on the two
+ * archives.
+ */
+EBookEntryDifferenceList
+EPubContainer::diffEntryChunk(const QString& original,
+                              const EPubEntryIndex& original_index,
+                              const QString& changed,
+                              const EPubEntryIndex& changed_index,
+                              const QStringList& chunk)
+{
+  EBookEntryDifferenceList results;
+  QuaZip original_archive(original);
+  QuaZip changed_archive(changed);
+  bool opened = (original_archive.open(QuaZip::mdUnzip) &&
+                 changed_archive.open(QuaZip::mdUnzip));
+  if (!opened) {
+    QLOG_DEBUG(tr("Failed to open %1 or %2").arg(original).arg(changed));
+  }
+
+  QString original_name = QFileInfo(original).fileName();
+  QString changed_name = QFileInfo(changed).fileName();
+  foreach (QString path, chunk) {
+    EBookEntryDifference difference;
+    difference.path = path;
+    difference.change = EBookEntryDifference::CHANGED;
+    difference.text = true;
+    QByteArray original_data, changed_data;
+    if (opened &&
+        readEntry(&original_archive, original_index, path, original_data) &&
+        readEntry(&changed_archive, changed_index, path, changed_data)) {
+      // decoded as the book is, so that a UTF-16 or legacy encoded entry
+      // is compared as text.
+      EBookTextDiff diff(EBookTextDecoder::decode(original_data),
+                         EBookTextDecoder::decode(changed_data));
+      difference.diff = diff.unified(original_name + '/' + path,
+                                     changed_name + '/' + path);
+      difference.added_lines = diff.added();
+      difference.removed_lines = diff.removed();
+    }
+    results.append(difference);
+  }
+  return results;
+}
+
+/*
+ * Reads an entry from an archive other than the container's own.
+ */
+bool
+EPubContainer::readEntry(QuaZip* archive,
+                         const EPubEntryIndex& index,
+                         const QString& path,
+                         QByteArray& data)
+{
+  if (!goToEntry(archive, index, path)) {
+    QLOG_DEBUG(tr("Unable to find %1 in archive").arg(path));
+    return false;
+  }
+  QuaZipFile entry(archive);
+  if (!entry.open(QIODevice::ReadOnly)) {
+    QLOG_DEBUG(tr("Unable to open file %1 : error %2")
+                 .arg(path)
+                 .arg(archive->getZipError()));
+    return false;
+  }
+  data = entry.readAll();
+  entry.close();
+  return true;
+}
+
+/*
+ * The entries that compareFiles() diffs, the xhtml chapters and the
+ * package file.
+ */
+bool
+EPubContainer::isTextEntry(const QString& path)
+{
+  QString suffix = QFileInfo(path).suffix().toLower();
+  return (suffix == "xhtml" || suffix == "html" || suffix == "htm" ||
+          suffix == "opf");
+}
+
+/*
+ * Registers an embedded font, undoing its obfuscation if it has any. An
+ * obfuscated font is only read from the archive and deobfuscated if it is
+ * not already registered or cached.
+ */
+bool
+EPubContainer::registerFont(SharedManifestItem font)
+{
+  EPubEntryIndex::const_iterator it = m_entry_index.constFind(font->path);
+  if (it == m_entry_index.constEnd()) {
+    return false;
+  }
+  readEncryption();
+
+  EPubFontRegistry* registry = EPubFontRegistry::instance();
+  EPubFontRegistry::Obfuscation obfuscation =
+    EPubFontRegistry::NO_OBFUSCATION;
+  QByteArray obfuscation_key;
+  if (m_encrypted_entries.contains(font->path)) {
+    obfuscation =
+      EPubFontRegistry::obfuscation(m_encrypted_entries.value(font->path));
+    obfuscation_key =
+      EPubFontRegistry::obfuscationKey(obfuscation, uniqueIdentifier());
+    if (obfuscation == EPubFontRegistry::NO_OBFUSCATION ||
+        obfuscation_key.isEmpty()) {
+      QLOG_DEBUG(tr("Unable to decrypt font %1").arg(font->path));
+      return false;
+    }
+  }
+
+  QByteArray key = EPubFontRegistry::fontKey(it.value().crc,
+                                             it.value().uncompressed_size,
+                                             obfuscation,
+                                             obfuscation_key);
+  if (registry->addOwner(this, key)) {
+    return true;
+  }
+
+  QByteArray data;
+  if (obfuscation == EPubFontRegistry::NO_OBFUSCATION ||
+      !registry->cachedFont(key, data)) {
+    if (!readArchiveEntry(m_archive, font->path, data)) {
+      return false;
+    }
+    if (obfuscation != EPubFontRegistry::NO_OBFUSCATION) {
+      data =
+        EPubFontRegistry::deobfuscate(data, obfuscation, obfuscation_key);
+      registry->cacheFont(key, data);
+    }
+  }
+  // QFontDatabase keeps the data, it must not be a view into the mapping.
+  data.detach();
+  return !registry->addFont(this, key, data).isEmpty();
+}
+
+/*
+ * Reads the algorithms of the encrypted entries from encryption.xml, only
+ * once and only when a font is first registered.
+ */
+void
+EPubContainer::readEncryption()
+{
+  if (m_encryption_read) {
+    return;
+  }
+  m_encryption_read = true;
+  QByteArray data;
+  if (!m_entry_index.contains(ENCRYPTION_FILE) ||
+      !readArchiveEntry(m_archive, ENCRYPTION_FILE, data)) {
+    return;
+  }
+
+  QXmlStreamReader reader(data);
+  QString algorithm;
+  while (!reader.atEnd()) {
+    QXmlStreamReader::TokenType token = reader.readNext();
+    if (token != QXmlStreamReader::StartElement) {
+      continue;
+    }
+    QStringRef name = reader.name();
+    if (name == QLatin1String("EncryptedData")) {
+      algorithm.clear();
+    } else if (name == QLatin1String("EncryptionMethod")) {
+      algorithm =
+        reader.attributes().value(QLatin1String("Algorithm")).toString();
+    } else if (name == QLatin1String("CipherReference")) {
+      QString uri =
+        reader.attributes().value(QLatin1String("URI")).toString();
+      m_encrypted_entries.insert(QUrl::fromPercentEncoding(uri.toUtf8()),
+                                 algorithm);
+    }
+  }
+  if (reader.hasError()) {
+    QLOG_DEBUG(tr("Unable to read %1 : %2")
+                 .arg(ENCRYPTION_FILE)
+                 .arg(reader.errorString()));
+  }
+}
+
+/*
+ * The value of the dc:identifier named by the package's unique-identifier,
+ * which fonts are obfuscated with.
+ */
+QString
+EPubContainer::uniqueIdentifier() const
+{
+  QString id = m_metadata->uniqueIdentifierName();
+  QXmlStreamReader reader(m_metadata_xml);
+  while (!reader.atEnd()) {
+    if (reader.readNext() == QXmlStreamReader::StartElement &&
+        reader.name() == QLatin1String("identifier") &&
+        reader.attributes().value(QLatin1String("id")) == id) {
+      return reader.readElementText().trimmed();
+    }
+  }
+  return QString();
+}
+
+/*
+ * The @font-face rules of a stylesheet, with their families folded to
+ * lower case and the urls of their sources.
+ */
+QList<EPubFontFace>
+EPubContainer::fontFaces(const QString& css)
+{
+  static const QRegularExpression font_face_rule(
+    "@font-face\\s*\\{([^}]*)\\}",
+    QRegularExpression::CaseInsensitiveOption);
+  static const QRegularExpression family_declaration(
+    "font-family\\s*:\\s*([^;}]+)",
+    QRegularExpression::CaseInsensitiveOption);
+  static const QRegularExpression source_url(
+    "url\\(\\s*['\"]?([^'\")]+)['\"]?\\s*\\)",
+    QRegularExpression::CaseInsensitiveOption);
+
+  QList<EPubFontFace> faces;
+  QRegularExpressionMatchIterator rules = font_face_rule.globalMatch(css);
+  while (rules.hasNext()) {
+    QString rule = rules.next().captured(1);
+    QRegularExpressionMatch family = family_declaration.match(rule);
+    if (!family.hasMatch()) {
+      continue;
+    }
+    EPubFontFace face;
+    face.family = fontFamilyName(family.captured(1).section(',', 0, 0));
+    QRegularExpressionMatchIterator urls = source_url.globalMatch(rule);
+    while (urls.hasNext()) {
+      face.sources.append(urls.next().captured(1).trimmed());
+    }
+    faces.append(face);
+  }
+  return faces;
+}
+
+/*
+ * Every family named by a font-family declaration in text, which is a
+ * stylesheet or the style attributes and elements of a chapter, folded to
+ * lower case. The families of @font-face rules are included but are only
+ * used to register the font when something else names them too.
+ */
+QSet<QString>
+EPubContainer::fontFamilies(const QString& text)
+{
+  static const QRegularExpression family_declaration(
+    "font-family\\s*:\\s*([^;}>]+)",
+    QRegularExpression::CaseInsensitiveOption);
+
+  QMap<QString, int> counts;
+  QRegularExpressionMatchIterator declarations =
+    family_declaration.globalMatch(text);
+  while (declarations.hasNext()) {
+    QString value = declarations.next().captured(1);
+    foreach (QString family, value.split(',')) {
+      counts[fontFamilyName(family)]++;
+    }
+  }
+  // a family only named by its own @font-face rule is not used.
+  QSet<QString> families;
+  foreach (EPubFontFace face, fontFaces(text)) {
+    counts[face.family]--;
+  }
+  for (QMap<QString, int>::const_iterator it = counts.constBegin();
+       it != counts.constEnd();
+       ++it) {
+    if (it.value() > 0 && !it.key().isEmpty()) {
+      families.insert(it.key());
+    }
+  }
+  return families;
+}
+
+/*
+ * Strips the quotes and white space from a family name and folds it to
+ * lower case, the quotes of a style attribute may be entities.
+ */
+QString
+EPubContainer::fontFamilyName(const QString& family)
+{
+  QString name = family;
+  name.replace(QLatin1String("&quot;"), QLatin1String("\""));
+  name.replace(QLatin1String("&#39;"), QLatin1String("'"));
+  name.remove(QLatin1Char('"')).remove(QLatin1Char('\''));
+  name.remove(QLatin1String("!important"), Qt::CaseInsensitive);
+  return name.trimmed().toLower();
+}
+
+/*
+ * Gives the differences that are chapters of this book their spine
+ * position and table of contents title, only those that were removed if
+ * removed is true and only the others if not.
+ */
+void
+EPubContainer::describeChapters(EBookEntryDifferenceList& differences,
+                                bool removed)
+{
+  QHash<QString, int> chapters; // path -> spine position.
+  for (int i = 0; i < m_spine.ordered_items.size(); i++) {
+    SharedManifestItem item = m_manifest.item(m_spine.ordered_items.at(i));
+    if (item && !chapters.contains(item->path)) {
+      chapters.insert(item->path, i);
+    }
+  }
+
+  for (int i = 0; i < differences.size(); i++) {
+    EBookEntryDifference& difference = differences[i];
+    if ((difference.change == EBookEntryDifference::REMOVED) != removed ||
+        !chapters.contains(difference.path)) {
+      continue;
+    }
+    difference.chapter = chapters.value(difference.path);
+    SharedManifestItem item = m_manifest.itemByPath(difference.path);
+    SharedTocItem toc_item = m_manifest.toc_paths.value(item->href);
+    if (toc_item) {
+      difference.title = toc_item->label;
+    }
+  }
+}
+
+/*!
+ * \brief Loads a list of manifest items using the global thread pool.
+ *
+ * The items are split into one chunk per available thread. Each worker opens
+ * its own read-only QuaZip handle on the epub file as QuaZip handles cannot
+ * be shared between threads. The decoded results are merged back into the
+ * manifest on the calling thread once all of the workers have finished.
+ *
+ * \param items the items to load.
+ * \return true if all items were loaded, otherwise false.
+ */
+bool
+EPubContainer::loadItemsParallel(SharedManifestItemList items)
+{
+  int thread_count = qMax(1, QThreadPool::globalInstance()->maxThreadCount());
+  int chunk_size = (items.size() + thread_count - 1) / thread_count;
+
+  QList<SharedManifestItemList> chunks;
+  for (int i = 0; i < items.size(); i += chunk_size) {
+    chunks.append(items.mid(i, chunk_size));
+  }
+
+  QString filename = m_filename;
+  std::function<QList<EPubLoadedItem>(const SharedManifestItemList&)> worker =
+    [this, filename](const SharedManifestItemList& chunk) {
+      return loadItemChunk(filename, chunk);
+    };
+  QFuture<QList<EPubLoadedItem>> future = QtConcurrent::mapped(chunks, worker);
+  future.waitForFinished();
+
+  int loaded_count = 0;
+  foreach (QList<EPubLoadedItem> results, future.results()) {
+    foreach (EPubLoadedItem loaded, results) {
+      storeManifestItem(loaded);
+      loaded_count++;
+    }
+  }
+
+  if (loaded_count != items.size()) {
+    QLOG_DEBUG(tr("Only loaded %1 of %2 items from %3")
+                 .arg(loaded_count)
+                 .arg(items.size())
+                 .arg(filename));
+    return false;
+  }
+  return true;
+}
+
+/*!
+ * \brief Worker method for loadItemsParallel().
+ *
+ * This runs in a pool thread so must only touch the items that it has
+ * been given and never the shared manifest maps.
+ */
+QList<EPubLoadedItem>
+EPubContainer::loadItemChunk(const QString& filename,
+                             SharedManifestItemList chunk)
+{
+  QList<EPubLoadedItem> results;
+  QuaZip archive(filename);
+  if (!archive.open(QuaZip::mdUnzip)) {
+    QLOG_DEBUG(tr("Failed to open %1").arg(filename));
+    return results;
+  }
+
+  foreach (SharedManifestItem item, chunk) {
+    QByteArray data;
+    if (readArchiveEntry(&archive, item->path, data)) {
+      results.append(decodeManifestItem(item, data));
+    }
+  }
+
+  archive.close();
+  return results;
+}
+
+bool
+EPubContainer::isCachedItem(SharedManifestItem item) const
+{
+  // fonts etc. are not cached.
+  return ((item->categories & EPubManifest::IMAGE) ||
+          isType(item, SVG_TYPE) || isType(item, XHTML_TYPE) ||
+          isType(item, CSS_TYPE) || isType(item, JAVASCRIPT_TYPE));
+}
+
+/*!
+ * \brief Returns a stored entry as a view into the memory mapped archive.
+ *
+ * No data is copied. The view is only valid until the archive is closed,
+ * closeFile() takes a copy of any image that is still using it.
+ *
+ * \return true if the entry is stored and the archive is mapped,
+ *         otherwise false.
+ */
+bool
+EPubContainer::mappedEntry(const QString& path, QByteArray& data) const
+{
+  if (!m_mapped_data) {
+    return false;
+  }
+  EPubEntryIndex::const_iterator it = m_entry_index.constFind(path);
+  if (it == m_entry_index.constEnd() || it.value().data_offset < 0) {
     return false;
   }
+  data = QByteArray::fromRawData(
+    reinterpret_cast<const char*>(m_mapped_data + it.value().data_offset),
+    int(it.value().size));
   return true;
 }
 
 bool
-EPubContainer::parseContainer()
+EPubContainer::readArchiveEntry(QuaZip* archive,
+                                const QString& path,
+                                QByteArray& data)
 {
-  if (m_files.contains(CONTAINER_FILE)) {
-    m_archive->setCurrentFile(CONTAINER_FILE);
-    QuaZipFile containerFile(m_archive);
-    containerFile.setZip(m_archive);
+  if (!archive || !archive->isOpen()) {
+    QLOG_DEBUG(tr("Archive is not open, unable to read %1").arg(path));
+    return false;
+  }
 
-    if (!containerFile.open(QIODevice::ReadOnly)) {
-      int error = m_archive->getZipError();
-      QLOG_DEBUG(tr("Unable to open container file error %1").arg(error));
-      return false;
+  if (mappedEntry(path, data)) {
+    return true;
+  }
+
+  if (!setCurrentEntry(archive, path)) {
+    QLOG_DEBUG(tr("Unable to find %1 in archive").arg(path));
+    return false;
+  }
+  QuaZipFile item_file(archive);
+  item_file.setZip(archive);
+
+  if (!item_file.open(QIODevice::ReadOnly)) {
+    int error = archive->getZipError();
+    QLOG_DEBUG(tr("Unable to open file %1 : error %2").arg(path).arg(error));
+    return false;
+  }
+
+  data = item_file.readAll();
+  item_file.close();
+  return true;
+}
+
+/*!
+ * \brief Converts the raw entry data into its cached form.
+ *
+ * This only modifies the item itself so is safe to call from a worker
+ * thread. The result should be passed to storeManifestItem().
+ */
+EPubLoadedItem
+EPubContainer::decodeManifestItem(SharedManifestItem item,
+                                  const QByteArray& data)
+{
+  EPubLoadedItem loaded;
+  loaded.item = item;
+
+  if (isType(item, GIF_TYPE) || isType(item, JPEG_TYPE) ||
+      isType(item, PNG_TYPE)) {
+    // only decoded on request, see EBookImageCache::decodeImage().
+    loaded.data = sharedResource(item, data);
+
+  } else if (isType(item, SVG_TYPE)) {
+    // only rendered on request, see prepareImage().
+    loaded.data = sharedResource(item, data);
+
+  } else if (isType(item, XHTML_TYPE)) {
+    parseHtmlItem(item, data);
+
+  } else if (isType(item, CSS_TYPE)) {
+    // shared with any other open book that uses the same stylesheet.
+    loaded.text = EPubStylesheetCache::instance()->stylesheet(data);
+
+  } else if (isType(item, JAVASCRIPT_TYPE)) {
+    loaded.text = EBookTextDecoder::decode(data);
+  }
+
+  return loaded;
+}
+
+/*
+ * Image data read into memory is shared with any other open book that has
+ * the same entry. Data read from the mapping is left as a view into it, it
+ * takes no memory of its own.
+ */
+QByteArray
+EPubContainer::sharedResource(SharedManifestItem item,
+                              const QByteArray& data) const
+{
+  EPubEntryIndex::const_iterator it = m_entry_index.constFind(item->path);
+  if (it == m_entry_index.constEnd() || it.value().data_offset >= 0) {
+    return data;
+  }
+  return EPubResourceStore::instance()->share(
+    this, it.value().crc, it.value().uncompressed_size, data);
+}
+
+void
+EPubContainer::storeManifestItem(const EPubLoadedItem& loaded)
+{
+  SharedManifestItem item = loaded.item;
+  if (isType(item, GIF_TYPE) || isType(item, JPEG_TYPE) ||
+      isType(item, PNG_TYPE)) {
+    m_manifest.image_data.insert(item->id, loaded.data);
+
+  } else if (isType(item, SVG_TYPE)) {
+    m_manifest.image_data.insert(item->id, loaded.data);
+
+  } else if (isType(item, CSS_TYPE)) {
+    m_manifest.css.insert(item->href, loaded.text);
+
+  } else if (isType(item, JAVASCRIPT_TYPE)) {
+    m_manifest.javascript.insert(item->id, loaded.text);
+
+  } else if (isType(item, XHTML_TYPE)) {
+    // a new chapter body for the parse cache.
+    m_parse_cache_dirty = true;
+    touchDocument(item);
+  }
+  item->loaded = true;
+  // the snapshot gains the item.
+  markChanged();
+}
+
+void
+EPubContainer::parseHtmlItem(SharedManifestItem item, const QByteArray& data)
+{
+  // decoded once, the xml declaration and DOCTYPE are left in place as
+  // only the head and body are kept and both are rewritten on save.
+  QString container = EBookTextDecoder::decode(data);
+
+  extractHeadInformationFromHtmlFile(item, container);
+
+  EPubHtmlSections sections = scanHtmlSections(container);
+  if (sections.body_start >= 0) {
+    item->document_string =
+      container.midRef(sections.body_start,
+                       sections.body_end - sections.body_start)
+        .trimmed()
+        .toString();
+  } else {
+    item->document_string.clear();
+  }
+  // done here, on the loading thread, so that the chapter only has to be
+  // dropped once it is no longer in use.
+  item->compressed_document = compressDocument(item->document_string);
+}
+
+/*!
+ * \brief Finds the \<head\> and \<body\> contents of an html document.
+ *
+ * This makes a single forward pass over the document tokens up to the
+ * opening body tag and then a single reverse search for the closing body
+ * tag, so large chapters are never copied or backtracked over.
+ *
+ * \param document the html document.
+ * \return the offsets of the sections, any not found are -1.
+ */
+EPubHtmlSections
+EPubContainer::scanHtmlSections(const QString& document)
+{
+  EPubHtmlSections sections;
+  XhtmlTokenizer tokenizer(document);
+  bool in_head_tag = false, in_body_tag = false;
+
+  while (!tokenizer.atEnd()) {
+    XhtmlToken token = tokenizer.next();
+
+    if (token.type == XhtmlToken::TAG_START) {
+      if (token.nameIs(QLatin1String("head"))) {
+        if (token.closing) {
+          sections.head_end = token.start;
+        } else {
+          in_head_tag = true;
+        }
+      } else if (!token.closing && token.nameIs(QLatin1String("body"))) {
+        sections.body_tag_start = token.start;
+        in_body_tag = true;
+      }
+
+    } else if (token.type == XhtmlToken::TAG_END) {
+      if (in_head_tag) {
+        sections.head_start = token.end();
+        in_head_tag = false;
+      } else if (in_body_tag) {
+        sections.body_start = token.end();
+        int body_end = document.lastIndexOf(QLatin1String("</body"));
+        sections.body_end =
+          (body_end >= sections.body_start ? body_end : document.length());
+        break;
+      }
     }
+  }
 
-    QString container(containerFile.readAll());
-    QDomDocument container_document;
-    container_document.setContent(container);
-    QDomElement root_elem = container_document.documentElement();
-    QDomNamedNodeMap att_map = root_elem.attributes();
-    m_container_version = root_elem.attribute("version");
-    m_container_xmlns = root_elem.attribute("xmlns");
+  return sections;
+}
 
-    QDomNodeList root_files = root_elem.elementsByTagName("rootfiles");
-    if (root_files.size() > 0) {
-      QDomElement rootfiles_elem = root_files.at(0).toElement();
-      QDomNodeList root_nodes = root_elem.elementsByTagName("rootfile");
-      for (int i = 0; i < root_nodes.count(); i++) {
-        QDomElement root_element = root_nodes.at(i).toElement();
-        m_container_fullpath = root_element.attribute("full-path");
-        m_container_mediatype = root_element.attribute("media-type");
-        if (m_container_fullpath.isEmpty()) {
-          QLOG_WARN(tr("Invalid root file entry"));
+SharedSpineItem
+EPubContainer::parseSpineItem(const QXmlStreamAttributes& attributes)
+{
+  SharedSpineItem item = SharedSpineItem(new EPubSpineItem());
+  QString value;
+
+  // TODO EPUB2 toc element - convert to EPUB3
+
+  if (attributes.hasAttribute(QLatin1String("idref"))) {
+    item->idref = attributes.value(QLatin1String("idref")).toString();
+  } else {
+    QLOG_DEBUG(tr("Warning invalid manifest itemref : no idref value"))
+  }
+
+  if (attributes.hasAttribute(QLatin1String("id"))) {
+    item->id = attributes.value(QLatin1String("id")).toString();
+  }
+
+  if (attributes.hasAttribute(QLatin1String("linear"))) {
+    value = attributes.value(QLatin1String("linear")).toString();
+    if (value == "yes" || value == "no") {
+      if (value == "yes")
+        item->linear = true; // false by default.
+    } else {
+      QLOG_DEBUG(tr("Warning invalid manifest itemref : linear MUST be "
+                    "either yes or no not %1")
+                   .arg(value))
+    }
+  }
+
+  if (attributes.hasAttribute(QLatin1String("properties"))) {
+    value = attributes.value(QLatin1String("properties")).toString();
+    // space separated list
+    QStringList properties = value.split(' ', QString::SkipEmptyParts);
+
+    foreach (QString prop, properties) {
+      if (prop == "page-spread-left") {
+        item->page_spread_left = true;
+      } else if (prop == "page-spread-right") {
+        item->page_spread_right = true;
+      }
+    }
+  }
+
+  m_spine.items.insert(item->idref, item);
+  m_spine.ordered_items.append(item->idref);
+  return item;
+}
+
+bool
+EPubContainer::saveSpineItem()
+{
+  // TODO save spine manfest section
+}
+
+/*!
+ * \brief Extracts every complete anchor from an html document.
+ *
+ * The document is parsed once into an XhtmlDom, the text of each anchor is
+ * that of its descendants with any nested tags removed. Anchors that are
+ * empty tags or never closed are skipped. It only reads the document so is
+ * safe to run in a pool thread.
+ */
+QList<EPubTocAnchor>
+EPubContainer::extractAnchors(const QString& document)
+{
+  QList<EPubTocAnchor> anchors;
+  XhtmlDom dom(document);
+
+  foreach (const XhtmlDomNode* element, dom.elements(QLatin1String("a"))) {
+    QString href = element->attribute(QLatin1String("href")).toString();
+    if (href.isEmpty() || element->content_end == element->end) {
+      continue;
+    }
+    EPubTocAnchor anchor;
+    int hash = href.indexOf('#');
+    if (hash < 0) {
+      anchor.file = href;
+    } else {
+      anchor.file = href.left(hash);
+      anchor.fragment = href.mid(hash + 1);
+      anchor.has_fragment = true;
+    }
+    anchor.text = XhtmlDom::textContent(element);
+    anchors.append(anchor);
+  }
+
+  return anchors;
+}
+
+/*!
+ * \brief Builds a table of contents from the anchors in the html items.
+ *
+ * The html items are loaded if necessary, then scanned for anchors in
+ * parallel. The results are merged in spine order, followed by any html
+ * items that are not in the spine.
+ *
+ * Links to a whole file are given an anchor point at the start of that
+ * file, these are all added together once the anchors have been found.
+ *
+ * \param changed_keys if not null, set to the keys of the html items that
+ *        anchor points were added to.
+ * \return the table of contents, a flat list of the anchors found.
+ */
+EBookToc
+EPubContainer::buildTocfromHtml(QStringList* changed_keys)
+{
+  EBookToc toc;
+
+  // spine order first, then anything that is not in the spine.
+  SharedManifestItemList ordered_items;
+  QSet<QString> ordered_ids;
+  foreach (QString idref, m_spine.ordered_items) {
+    SharedManifestItem item = m_manifest.item(idref);
+    if (item && item->media_type == "application/xhtml+xml") {
+      ordered_items.append(item);
+      ordered_ids.insert(item->id);
+    }
+  }
+  SharedManifestItemList unloaded;
+  foreach (SharedManifestItem item, m_manifest.items(EPubManifest::HTML)) {
+    if (!ordered_ids.contains(item->id)) {
+      ordered_items.append(item);
+    }
+    if (!item->loaded) {
+      unloaded.append(item);
+    }
+  }
+  if (!unloaded.isEmpty()) {
+    loadItemsParallel(unloaded);
+  }
+
+  QHash<QString, SharedManifestItem> items_by_href;
+  foreach (SharedManifestItem item, ordered_items) {
+    items_by_href.insert(item->href, item);
+  }
+
+  // compressed chapters are uncompressed by the workers, and only for as
+  // long as they are scanned. Nothing changes the items while this waits.
+  std::function<QList<EPubTocAnchor>(const SharedManifestItem&)> scan =
+    [](const SharedManifestItem& item) {
+      return extractAnchors(
+        item->document_string.isEmpty()
+          ? uncompressDocument(item->compressed_document)
+          : item->document_string);
+    };
+  QFuture<QList<EPubTocAnchor>> future =
+    QtConcurrent::mapped(ordered_items, scan);
+  future.waitForFinished();
+
+  // links to a whole file are pointed at an anchor at the start of its
+  // body, one for each file however many links there are to it.
+  QHash<QString, QString> file_anchors;
+  QMap<QString, EPubAnchorBatch> batches;
+  int pos = 0;
+  for (int i = 0; i < ordered_items.size(); i++) {
+    foreach (EPubTocAnchor anchor, future.resultAt(i)) {
+      if (!anchor.file.isEmpty() && !anchor.fragment.isEmpty()) {
+        // existing file + anchor points exist.
+        toc.entries.append(
+          builtTocEntry(anchor.file, anchor.fragment, anchor.text));
+      } else if (!anchor.file.isEmpty()) {
+        // existing file but no anchor point.
+        SharedManifestItem item = items_by_href.value(anchor.file);
+        if (!item) {
           continue;
         }
-        if (parsePackageFile(m_container_fullpath)) {
-          return true;
+        QString pos_tag = file_anchors.value(anchor.file);
+        if (pos_tag.isEmpty()) {
+          QString document = documentString(item, false);
+          do {
+            pos_tag = LIST_FILEPOS.arg(pos++);
+          } while (document.contains(QString("id=\"%1\"").arg(pos_tag)));
+          file_anchors.insert(anchor.file, pos_tag);
+          EPubAnchorBatch& batch = batches[item->id];
+          batch.key = item->id;
+          batch.document = document;
+          batch.anchors.append(qMakePair(0, pos_tag));
+        }
+        toc.entries.append(builtTocEntry(anchor.file, pos_tag, anchor.text));
+      } else if (!anchor.fragment.isEmpty()) {
+        // existing anchor tag but no file.
+        // TODO find file and add to anchor.
+      }
+    }
+  }
+
+  QStringList keys = insertAnchorPoints(batches.values());
+  if (changed_keys) {
+    *changed_keys = keys;
+  }
+  return toc;
+}
+
+/*!
+ * \brief Adds anchor points to html items.
+ *
+ * Each item gets all of its anchors in one pass, and the items are done in
+ * parallel, so the cost is linear in the size of the items however many
+ * anchors are added.
+ *
+ * \return the keys of the items that were changed.
+ */
+QStringList
+EPubContainer::insertAnchorPoints(const QList<EPubAnchorBatch>& batches)
+{
+  QStringList keys;
+  if (batches.isEmpty()) {
+    return keys;
+  }
+  QFuture<QString> future =
+    QtConcurrent::mapped(batches, &EPubContainer::insertAnchors);
+  future.waitForFinished();
+  for (int i = 0; i < batches.size(); i++) {
+    setItemDocument(batches.at(i).key, future.resultAt(i));
+    keys.append(batches.at(i).key);
+  }
+  return keys;
+}
+
+/*!
+ * \brief Inserts the anchors of one batch into its document.
+ *
+ * The anchors are sorted by offset and the document copied once with them
+ * put in place. It only reads the batch so is safe to run in a pool
+ * thread.
+ */
+QString
+EPubContainer::insertAnchors(const EPubAnchorBatch& batch)
+{
+  QList<QPair<int, QString>> anchors = batch.anchors;
+  std::stable_sort(anchors.begin(),
+                   anchors.end(),
+                   [](const QPair<int, QString>& a,
+                      const QPair<int, QString>& b) {
+                     return a.first < b.first;
+                   });
+
+  const QString& document = batch.document;
+  QString result;
+  result.reserve(document.size() + anchors.size() * 32);
+  int last = 0;
+  foreach (const QPair<int, QString>& anchor, anchors) {
+    int offset = qBound(last, anchor.first, document.size());
+    result.append(document.midRef(last, offset - last));
+    result.append(ANCHOR_POINT.arg(anchor.second));
+    last = offset;
+  }
+  result.append(document.midRef(last));
+  return result;
+}
+
+SharedTocEntry
+EPubContainer::builtTocEntry(const QString& file,
+                             const QString& fragment,
+                             const QString& label)
+{
+  SharedTocEntry entry(new EBookTocEntry());
+  entry->href = file + QLatin1Char('#') + fragment;
+  entry->label = label;
+  return entry;
+}
+
+/*!
+ * \brief Builds the toc tree from the toc file.
+ *
+ * The spine's NCX file is used if there is one, otherwise the EPUB 3
+ * navigation document. Either is read with a single QXmlStreamReader pass,
+ * so large reference works do not need a DOM of their toc.
+ */
+bool
+EPubContainer::parseTocFile()
+{
+  EBOOK_TRACE_SCOPE("EPubContainer::parseTocFile");
+  SharedManifestItem toc_item = m_manifest.item(m_spine.toc);
+  if (!toc_item) {
+    toc_item = m_manifest.nav;
+  }
+  if (!toc_item) {
+    QLOG_DEBUG(tr("No toc file found"));
+    return false;
+  }
+
+  QByteArray data;
+  if (!readArchiveEntry(m_archive, toc_item->path, data)) {
+    QLOG_DEBUG(tr("Unable to open toc file %1").arg(toc_item->path));
+    return false;
+  }
+
+  m_toc_chapter_index = -1;
+  m_manifest.toc_title.clear();
+  m_manifest.toc_roots.clear();
+  m_toc = EBookToc();
+
+  QXmlStreamReader reader(data);
+  if (toc_item->media_type == "application/xhtml+xml") {
+    parseNavDocument(reader);
+  } else {
+    parseNcxDocument(reader);
+  }
+  if (reader.hasError()) {
+    QLOG_DEBUG(tr("Error in toc file %1 : %2")
+                 .arg(toc_item->path)
+                 .arg(reader.errorString()));
+  }
+  return true;
+}
+
+/*!
+ * \brief Reads the navMap of an NCX file.
+ *
+ * Each navPoint becomes a toc item, nested navPoints become the sub items of
+ * their parent.
+ */
+void
+EPubContainer::parseNcxDocument(QXmlStreamReader& reader)
+{
+  QList<SharedTocItem> parents;
+  bool in_title = false, in_label = false;
+
+  while (!reader.atEnd()) {
+    QXmlStreamReader::TokenType token = reader.readNext();
+
+    if (token == QXmlStreamReader::StartElement) {
+      QStringRef name = reader.name();
+      if (name == QLatin1String("navPoint")) {
+        m_toc_chapter_index++;
+        QXmlStreamAttributes attributes = reader.attributes();
+        SharedTocItem toc_item = SharedTocItem(new EPubTocItem());
+        toc_item->id = attributes.value(QLatin1String("id")).toString();
+        toc_item->tag_class =
+          attributes.value(QLatin1String("class")).toString();
+        toc_item->playorder =
+          attributes.value(QLatin1String("playOrder")).toInt();
+        parents.append(toc_item);
+
+      } else if (name == QLatin1String("content") && !parents.isEmpty()) {
+        setTocItemSource(
+          parents.last(),
+          reader.attributes().value(QLatin1String("src")).toString());
+
+      } else if (name == QLatin1String("text")) {
+        QString text = reader.readElementText();
+        if (in_label && !parents.isEmpty()) {
+          parents.last()->label = text;
+        } else if (in_title) {
+          m_manifest.toc_title = text;
         }
+
+      } else if (name == QLatin1String("navLabel")) {
+        in_label = true;
+      } else if (name == QLatin1String("docTitle")) {
+        in_title = true;
+      }
+
+    } else if (token == QXmlStreamReader::EndElement) {
+      QStringRef name = reader.name();
+      if (name == QLatin1String("navPoint") && !parents.isEmpty()) {
+        SharedTocItem toc_item = parents.takeLast();
+        addTocItem(toc_item,
+                   parents.isEmpty() ? SharedTocItem() : parents.last());
+
+      } else if (name == QLatin1String("navLabel")) {
+        in_label = false;
+      } else if (name == QLatin1String("docTitle")) {
+        in_title = false;
+      }
+    }
+  }
+}
+
+/*!
+ * \brief Reads the toc nav element of an EPUB 3 navigation document.
+ *
+ * The nested ordered lists of the nav element map directly on to the toc
+ * tree. Navigation documents have no play order so items are numbered in
+ * document order.
+ */
+void
+EPubContainer::parseNavDocument(QXmlStreamReader& reader)
+{
+  QList<SharedTocItem> parents;
+  bool in_toc = false;
+  int list_depth = 0;
+
+  while (!reader.atEnd()) {
+    QXmlStreamReader::TokenType token = reader.readNext();
+
+    if (token == QXmlStreamReader::StartElement) {
+      QStringRef name = reader.name();
+      if (name == QLatin1String("nav")) {
+        in_toc = (reader.attributes().value(OPS_NAMESPACE,
+                                            QLatin1String("type")) ==
+                  QLatin1String("toc"));
+        continue;
+      }
+      if (!in_toc) {
+        continue;
+      }
+
+      if (name == QLatin1String("ol")) {
+        list_depth++;
+
+      } else if (name == QLatin1String("li")) {
+        m_toc_chapter_index++;
+        SharedTocItem toc_item = SharedTocItem(new EPubTocItem());
+        toc_item->id =
+          reader.attributes().value(QLatin1String("id")).toString();
+        toc_item->playorder = m_toc_chapter_index + 1;
+        parents.append(toc_item);
+
+      } else if ((name == QLatin1String("a") ||
+                  name == QLatin1String("span")) &&
+                 !parents.isEmpty()) {
+        SharedTocItem toc_item = parents.last();
+        setTocItemSource(
+          toc_item,
+          reader.attributes().value(QLatin1String("href")).toString());
+        toc_item->label =
+          reader.readElementText(QXmlStreamReader::IncludeChildElements)
+            .simplified();
+
+      } else if (name.startsWith(QLatin1Char('h')) && name.size() == 2 &&
+                 list_depth == 0) {
+        m_manifest.toc_title =
+          reader.readElementText(QXmlStreamReader::IncludeChildElements)
+            .simplified();
+      }
+
+    } else if (token == QXmlStreamReader::EndElement && in_toc) {
+      QStringRef name = reader.name();
+      if (name == QLatin1String("li") && !parents.isEmpty()) {
+        SharedTocItem toc_item = parents.takeLast();
+        addTocItem(toc_item,
+                   parents.isEmpty() ? SharedTocItem() : parents.last());
+
+      } else if (name == QLatin1String("ol")) {
+        list_depth--;
+
+      } else if (name == QLatin1String("nav")) {
+        // only the first toc nav is used.
+        break;
       }
     }
+  }
+}
 
+/*!
+ * \brief Sets the source of a toc item from its link.
+ *
+ * Links that point into the middle of a chapter are also given a
+ * chapter tag.
+ */
+void
+EPubContainer::setTocItemSource(SharedTocItem toc_item, const QString& link)
+{
+  toc_item->source = link;
+  if (link.indexOf(QLatin1Char('#')) <= 0) {
+    toc_item->chapter_tag.clear();
   } else {
-    QLOG_DEBUG(tr("Unable to find container information"));
-    return false;
+    toc_item->chapter_tag = QString("#part%1").arg(m_toc_chapter_index);
   }
+}
 
-  // Limitations:
-  //  - We only read one rootfile
-  //  - We don't read the following from META-INF/
-  //     - manifest.xml (unknown contents, just reserved)
-  //     - metadata.xml (unused according to spec, just reserved)
-  //     - rights.xml (reserved for DRM, not standardized)
-  //     - signatures.xml (signatures for files, standardized)
-  // Actually these are rarely included in an epub file anyway.
+/*!
+ * \brief Adds a completed toc item to the toc maps and to its parent, or to
+ * the top level of the toc if it has none.
+ */
+void
+EPubContainer::addTocItem(SharedTocItem toc_item, SharedTocItem parent)
+{
+  m_manifest.toc_items.insert(toc_item->playorder, toc_item);
+  m_manifest.toc_paths.insert(toc_item->source, toc_item);
+  if (parent) {
+    parent->sub_items.insert(toc_item->playorder, toc_item);
+  } else {
+    m_manifest.toc_roots.append(toc_item->playorder);
+  }
+}
 
-  QLOG_DEBUG(tr("Unable to find and use any content files"));
-  return false;
+bool
+EPubContainer::parseGuideItem(const QDomNode& guideItem)
+{
+  // TODO this has been superceded by the landmark in EPUB 3.0
 }
 
-// void EPubContainer::createChapterAnchorPoints(SharedSpineItem spine_item)
-//{
-//  SharedManifestItem manifest_item =
-//  m_manifest.items.value(spine_item->idref); if (manifest_item) {
-//    SharedTocItem toc_item = m_manifest.toc_paths.value(manifest_item->href);
-//    if (toc_item) {
-//      if (!toc_item->chapter_tag.isEmpty()) {
-//        // toc has a label added.
-//        QString tag("<a id=\"%1\"></a>");
-//        tag = tag.arg(toc_item->chapter_tag);
-//        QString document = manifest_item->document_string;
-//        QRegularExpression body_tag("<body[^>]*> ");
-//        QRegularExpressionMatch match = body_tag.match(document);
-//        if (match.hasMatch()) {
-//          //        int start = match.capturedStart();
-//          int end = match.capturedEnd();
-//          document.insert(end, tag);
-//        }
-//      }
+bool
+EPubContainer::parseLandmarksItem(const QDomNode& guideItem)
+{
+  // TODO load landmarks
+}
 
-//      if (!toc_item->sub_items.isEmpty()) {
-//      }
-//    }
-//  }
-//}
+bool
+EPubContainer::saveLandmarksItem()
+{
+  // TODO save landmarks
+}
 
 bool
-EPubContainer::parsePackageFile(QString& full_path)
+EPubContainer::parseBindingsItem(const QDomNode& bindingsItem)
+{}
+
+bool
+EPubContainer::saveBindingsItem()
 {
-  m_archive->setCurrentFile(full_path);
-  QuaZipFile contentFile(m_archive);
-  contentFile.setZip(m_archive);
+  // TODO save bindings.
+}
 
-  if (!contentFile.open(QIODevice::ReadOnly)) {
-    QLOG_DEBUG(tr("Malformed content file, unable to get content metadata"));
+/*!
+ * \brief Saves the epub file.
+ *
+ * Only the container, any modified manifest items and, if the metadata has
+ * changed, the package file are re-encoded. All other entries, including
+ * items that have been loaded but not modified, are copied across as raw
+ * compressed data without being inflated and deflated again.
+ *
+ * The new archive is written to a temporary file which then replaces the
+ * target file so that the source archive remains readable during the save.
+ *
+ * \param filepath the path to save to, the current filename if empty.
+ * \return true if the save succeeded, otherwise false.
+ */
+bool
+EPubContainer::saveFile(const QString& filepath)
+{
+  EBOOK_TRACE_SCOPE("EPubContainer::saveFile");
+  if (!waitForSave()) {
     return false;
   }
 
-  QMap<QString, DomDocument> map;
-  m_current_rootfile = map;
-  m_rootfiles.insert(full_path, m_current_rootfile);
+  EPubSaveSnapshot snapshot;
+  if (!createSaveSnapshot(filepath, snapshot)) {
+    return false;
+  }
+  return writeSnapshot(snapshot, nullptr) && finishSave(snapshot);
+}
 
-  QString content(contentFile.readAll());
+/*!
+ * \brief Saves the epub file as saveFile() does, but only replaces the
+ * target once the written file has been opened as an epub and verified.
+ *
+ * If the written file does not verify the target is left as it was and
+ * the temporary file is removed.
+ *
+ * \param filepath the path to save to, the current filename if empty.
+ * \param problems any problems found in the written file are appended to
+ *        this.
+ * \return true if the save succeeded, otherwise false.
+ */
+bool
+EPubContainer::saveFileVerified(const QString& filepath, QStringList& problems)
+{
+  if (!waitForSave()) {
+    return false;
+  }
 
-  DomDocument package_document(new QDomDocument());
-  // handles more than one package.
-  m_current_rootfile.insert(full_path, package_document);
+  EPubSaveSnapshot snapshot;
+  if (!createSaveSnapshot(filepath, snapshot) ||
+      !writeSnapshot(snapshot, nullptr)) {
+    return false;
+  }
 
-  package_document->setContent(content, true); // turn on namespace processing
-  // parse root element attributes.
-  QDomElement root_element = package_document->documentElement();
-  QDomNamedNodeMap node_map = root_element.attributes();
-  QDomNode node;
-  for (int i = 0; i < node_map.size(); i++) {
-    QDomNode node = node_map.item(i);
-    QString name = node.nodeName();
-    QString value = node.nodeValue().toLower();
-    // parse package attributes.
-    if (name == "version") {
-      if (value == "2.0") {
-        m_version = 2;
-      } else if (value == "3.0") {
-        m_version = 3;
-      }
-    } else if (name == "xmlns") {
-      m_package_xmlns = value;
-    } else if (name == "unique-identifier") {
-      m_metadata->setUniqueIdentifierName(value);
-    } else if (name == "xml:lang") {
-      m_package_language = value;
-    } else if (name == "prefix") { // Only 3.0
-      // TODO - handle prefix mapping - may not need this, just store value.
-      m_package_prefix = value;
-    } else if (name == "dir") { // Only 3.0
-      m_package_direction = value;
-    } else if (name == "id") { // Only 3.0
-      m_package_id = value;
-    } else if (name == "prefix") {
-      m_metadata->setIsFoaf(true);
+  QString temp_path = snapshot.save_path + ".tmp";
+  bool verified;
+  {
+    EPubContainer written;
+    verified = (written.loadFile(temp_path) && written.verify(problems));
+  }
+  if (!verified) {
+    if (problems.isEmpty()) {
+      problems.append(tr("The saved book cannot be read as an epub"));
     }
+    QFile::remove(temp_path);
+    return false;
   }
+  return finishSave(snapshot);
+}
 
-  // parse metadata.
-  QDomNodeList metadata_node_list =
-    package_document->elementsByTagName("metadata");
-  m_metadata->parse(metadata_node_list);
-
-  // Extract current path, for resolving relative paths
-  QString content_file_folder;
-  int separator_index = full_path.lastIndexOf('/');
-  if (separator_index > 0) {
-    content_file_folder = full_path.left(separator_index + 1);
+/*!
+ * \brief Saves the epub file on the global thread pool.
+ *
+ * Everything that the save needs from the manifest and metadata is copied
+ * into a snapshot first, so the book can continue to be edited while the
+ * archive is written. saveProgress() is emitted as each entry is written
+ * and saveFinished() once the temporary file has replaced the target file.
+ *
+ * \param filepath the path to save to, the current filename if empty.
+ * \return true if the save was started, otherwise false.
+ */
+bool
+EPubContainer::saveFileAsync(const QString& filepath)
+{
+  if (m_save_watcher) {
+    QLOG_DEBUG(tr("A save of %1 is already in progress").arg(m_filename));
+    return false;
   }
 
-  // Parse out all the components/items in the epub
-  // should only have one manifest.
-  QDomNodeList manifest_node_list =
-    package_document->elementsByTagName("manifest");
-  for (int i = 0; i < manifest_node_list.count(); i++) {
-    QDomElement manifest_element = manifest_node_list.at(i).toElement();
-    node_map = manifest_element.attributes();
-    node = node_map.namedItem("id");
-    if (!node.isNull()) {
-      m_manifest.id = node.nodeValue();
-    }
-    QDomNodeList manifest_item_list =
-      manifest_element.elementsByTagName("item");
-
-    for (int j = 0; j < manifest_item_list.count(); j++) {
-      parseManifestItem(manifest_item_list.at(j), content_file_folder);
-    }
-  }
-
-  // Parse out the document guide
-  // please note that this has been superceded by landmarks in EPUB 3.0
-  QDomNodeList spine_node_list = package_document->elementsByTagName("spine");
-  for (int i = 0; i < spine_node_list.count(); i++) {
-    QDomElement spine_element = spine_node_list.at(i).toElement();
-    SharedSpineItem spine_item = SharedSpineItem(new EPubSpineItem());
-    node_map = spine_element.attributes();
-    node = node_map.namedItem("id");
-    if (!node.isNull()) { // optional
-      m_spine.id = node.nodeValue();
-    }
-    node = node_map.namedItem("toc");
-    if (!node.isNull()) { // optional
-      m_spine.toc = node.nodeValue();
-    }
-    node = node_map.namedItem("page-progression-dir");
-    if (!node.isNull()) { // optional
-      m_spine.page_progression_dir = node.nodeValue();
-    }
-
-    QDomNodeList spineItemList = spine_element.elementsByTagName("itemref");
-    for (int j = 0; j < spineItemList.count(); j++) {
-      spine_item = parseSpineItem(spineItemList.at(j), spine_item);
-    }
-
-    if (!m_spine.toc.isEmpty()) { // EPUB2.0 toc
-      parseTocFile();
-    }
-
-    //    /*
-    //     * At this point not all books have anchors added for chapter links.
-    //     Calibre
-    //     * adds in anchors at the end of the previous chapter. For
-    //     simplicities sake I
-    //     * am adding them at the start of the new chapter.
-    //     * Also remember that some
-    //     */
-    //    createChapterAnchorPoints(spine_item);
-  }
-
-  //  QDomNodeList guide_node_list =
-  //  package_document->elementsByTagName("guide"); for (int i = 0; i <
-  //  guide_node_list.count(); i++) {
-  //    QDomElement spine_element = guide_node_list.at(i).toElement();
-  //    SharedGuideItem item = SharedGuideItem(new EPubGuideItem());
-  //    node_map = spine_element.attributes();
-  //    node = node_map.namedItem("id");
-  //    if (!node.isNull()) { // optional
-  //      m_spine.id = node.nodeValue();
-  //    }
-  //    node = node_map.namedItem("toc");
-  //    if (!node.isNull()) { // optional
-  //      m_spine.toc = node.nodeValue();
-  //    }
-  //    node = node_map.namedItem("page-progression-dir");
-  //    if (!node.isNull()) { // optional
-  //      m_spine.page_progression_dir = node.nodeValue();
-  //    }
-
-  //    QDomNodeList spineItemList = spine_element.elementsByTagName("itemref");
-  //    for (int j = 0; j < spineItemList.count(); j++) {
-  //      parseSpineItem(spineItemList.at(j));
-  //    }
-  //  }
-
-  //    parseGuideItem(); // this has been superceded by landmarks.
-  //  parseLandmarkItem();
-  //  parseBindingsItem(); // Tis is used for non-epb standard media types.
+  QSharedPointer<EPubSaveSnapshot> snapshot(new EPubSaveSnapshot());
+  if (!createSaveSnapshot(filepath, *snapshot)) {
+    return false;
+  }
 
+  QFutureInterface<bool> future_interface;
+  future_interface.reportStarted();
+
+  QFutureWatcher<bool>* watcher = new QFutureWatcher<bool>(this);
+  connect(watcher,
+          &QFutureWatcher<bool>::progressValueChanged,
+          this,
+          [this, watcher](int value) {
+            emit saveProgress(value, watcher->progressMaximum());
+          });
+  connect(watcher,
+          &QFutureWatcher<bool>::finished,
+          this,
+          &EPubContainer::saveThreadFinished);
+  watcher->setFuture(future_interface.future());
+  m_save_watcher = watcher;
+  m_save_snapshot = snapshot;
+
+  QtConcurrent::run([snapshot, future_interface]() mutable {
+    bool result = writeSnapshot(*snapshot, &future_interface);
+    future_interface.reportResult(result);
+    future_interface.reportFinished();
+  });
   return true;
 }
 
-void
-EPubContainer::extractHeadInformationFromHtmlFile(SharedManifestItem item,
-                                                  QString container)
+/*!
+ * \brief true while a saveFileAsync() is running.
+ */
+bool
+EPubContainer::isSaving() const
 {
-  QDomDocument doc;
-  doc.setContent(container);
-
-  QDomNodeList node_list = doc.elementsByTagName(QLatin1String("head"));
-
-  if (!node_list.isEmpty()) {
-    QDomNode head_node = node_list.at(0); // should only be one head element
-    QDomElement head_elem = head_node.toElement();
-    QDomNodeList link_list = head_elem.elementsByTagName(QLatin1String("link"));
-    for (int i = 0; i < link_list.length(); i++) {
-      QDomNode link = link_list.at(i);
-      QDomElement link_elem = link.toElement();
-      QString rel = link_elem.attribute(QLatin1String("rel"));
-      if (!rel.isEmpty()) {
-        if (rel == QLatin1String("stylesheet")) {
-          QString type = link_elem.attribute(QLatin1String("type"));
-          if (!type.isEmpty()) {
-            if (type == QLatin1String("text/css")) {
-              QString href = link_elem.attribute(QLatin1String("href"));
-              if (!href.isEmpty()) {
-                item->css_links.append(href);
-              }
-            }
-          }
-        }
-      }
-    }
-  }
-
-  node_list = doc.elementsByTagName(QLatin1String("body"));
+  return (m_save_watcher != nullptr);
+}
 
-  if (!node_list.isEmpty()) {
-    QDomNode body_node = node_list.item(0); // should only be one
-    QDomElement body_elem = body_node.toElement();
-    QString att = body_elem.attribute(QLatin1String("class"));
-    if (!att.isEmpty()) {
-      item->body_class = att;
-    }
+/*!
+ * \brief Blocks until any running saveFileAsync() has finished.
+ *
+ * \return false if the running save failed, otherwise true.
+ */
+bool
+EPubContainer::waitForSave()
+{
+  if (!m_save_watcher) {
+    return true;
   }
+  m_save_watcher->waitForFinished();
+  return saveThreadFinished();
 }
 
 bool
-EPubContainer::parseManifestItem(const QDomNode& manifest_node,
-                                 const QString current_folder)
+EPubContainer::saveThreadFinished()
 {
-  QDomElement metadata_element = manifest_node.toElement();
-  QString tag_name = metadata_element.tagName();
-  QDomNamedNodeMap node_map = metadata_element.attributes();
-  QDomNode node;
-  QString name, value;
-
-  if (tag_name == "item") {
-    SharedManifestItem item = SharedManifestItem(new EPubManifestItem());
-    node = node_map.namedItem("href");
-    if (!node.isNull()) {
-      value = node.nodeValue();
-      QString path = QDir::cleanPath(current_folder + value);
-      item->href = value;
-      item->path = path;
-    } else {
-      QLOG_DEBUG(tr("Warning invalid manifest item : no href value"))
-    }
-
-    node = node_map.namedItem("id");
-    if (!node.isNull()) {
-      value = node.nodeValue();
-      item->id = value;
-    } else {
-      QLOG_DEBUG(tr("Warning invalid manifest item : no id value"))
-    }
+  if (!m_save_watcher) {
+    // already handled by waitForSave().
+    return true;
+  }
 
-    node = node_map.namedItem("media-type");
-    if (!node.isNull()) {
-      value = node.nodeValue();
-      item->media_type = value.toLatin1();
-      if (item->media_type == "image/gif" || item->media_type == "image/jpeg" ||
-          item->media_type == "image/png") {
+  QFutureWatcher<bool>* watcher = m_save_watcher;
+  QSharedPointer<EPubSaveSnapshot> snapshot = m_save_snapshot;
+  m_save_watcher = nullptr;
+  m_save_snapshot.clear();
 
-        if (!QImageReader::supportedMimeTypes().contains(item->media_type)) {
-          QLOG_DEBUG(QString("Requested image type %1 is an unsupported type")
-                       .arg(QString(item->media_type)));
-        }
+  bool result = watcher->result() && finishSave(*snapshot);
+  watcher->deleteLater();
+  emit saveFinished(result);
+  return result;
+}
 
-        m_archive->setCurrentFile(item->path);
-        QuaZipFile image_file(m_archive);
-        image_file.setZip(m_archive);
+/*!
+ * \brief Copies everything needed to save the book.
+ *
+ * This runs on the calling thread. The container, modified html items and
+ * a package file with changed metadata are encoded here, everything else is
+ * listed to be copied raw from the source archive.
+ */
+bool
+EPubContainer::createSaveSnapshot(const QString& filepath,
+                                  EPubSaveSnapshot& snapshot)
+{
+  QString save_path = (filepath.isEmpty() ? m_filename : filepath);
+  if (!m_archive || !m_archive->isOpen()) {
+    QLOG_DEBUG(tr("No open epub to save to %1").arg(save_path));
+    return false;
+  }
 
-        if (!image_file.open(QIODevice::ReadOnly)) {
-          //          m_archive->getZipError();
-          QLOG_DEBUG(tr("Unable to open image file %1").arg(item->path));
-        }
+  snapshot.source_path = m_filename;
+  snapshot.save_path = save_path;
+  snapshot.index = m_entry_index;
+  snapshot.compression_level = m_compression_level;
+
+  // the mimetype must be the first entry.
+  EPubSaveEntry mimetype;
+  mimetype.path = MIMETYPE_FILE;
+  mimetype.data = MIMETYPE;
+  mimetype.raw = false;
+  snapshot.entries.append(mimetype);
+
+  EPubSaveEntry container;
+  container.path = CONTAINER_FILE;
+  container.media_type = "application/xml";
+  container.data = containerData();
+  container.raw = false;
+  snapshot.entries.append(container);
+
+  // the package file is copied raw unless the metadata has changed, then
+  // only its metadata element is written again.
+  QString metadata = metadataChildren();
+  if (metadata != m_written_metadata) {
+    EPubSaveEntry package;
+    package.path = m_container_fullpath;
+    package.media_type = m_container_mediatype;
+    package.data = metadataPackageData(metadata);
+    package.raw = false;
+    if (package.data.isEmpty()) {
+      return false;
+    }
+    snapshot.entries.append(package);
+    snapshot.package_written = true;
+    snapshot.metadata = metadata;
+  }
 
-        QByteArray data = image_file.readAll();
-        QImage image = QImage::fromData(data);
-        m_manifest.images.insert(item->id, image);
+  foreach (QString path, m_files) {
+    if (path == MIMETYPE_FILE || path == CONTAINER_FILE ||
+        (path == m_container_fullpath && snapshot.package_written)) {
+      // already rewritten.
+      continue;
+    }
 
-      } else if (item->media_type == "application/vnd.ms-opentype" ||
-                 item->media_type == "application/font-woff") {
-        m_manifest.fonts.insert(item->id, item);
+    EPubSaveEntry entry;
+    entry.path = path;
+    SharedManifestItem item = m_manifest.itemByPath(path);
+    if (item && item->modified &&
+        item->media_type == "application/xhtml+xml") {
+      if (!loadManifestItem(item)) {
+        return false;
+      }
+      entry.media_type = item->media_type;
+      entry.data = htmlItemData(item);
+      entry.raw = false;
+      snapshot.documents.insert(item->id, documentString(item, false));
+    }
+    snapshot.entries.append(entry);
+  }
+  return true;
+}
 
-      } else if (item->media_type == "application/xhtml+xml") {
-        m_archive->setCurrentFile(item->path);
-        QuaZipFile itemFile(m_archive);
-        itemFile.setZip(m_archive);
+/*!
+ * \brief Writes a snapshot to a temporary file next to the save path.
+ *
+ * This only uses the snapshot, opening its own handle on the source
+ * archive, so it is safe to run in a pool thread.
+ *
+ * \param snapshot the snapshot to write.
+ * \param progress if not null the progress is reported to it.
+ * \return true if the temporary file was written, otherwise false.
+ */
+bool
+EPubContainer::writeSnapshot(const EPubSaveSnapshot& snapshot,
+                             QFutureInterface<bool>* progress)
+{
+  // on the pool for saveFileAsync().
+  EBOOK_TRACE_SCOPE("EPubContainer::writeSnapshot");
+  QFileInfo info(snapshot.save_path);
+  QDir dir;
+  dir.mkpath(info.path());
 
-        if (!itemFile.open(QIODevice::ReadOnly)) {
-          int error = m_archive->getZipError();
-          QLOG_DEBUG(tr("Unable to open container file error %1").arg(error));
-          return false;
-        }
+  QuaZip source_zip(snapshot.source_path);
+  if (!source_zip.open(QuaZip::mdUnzip)) {
+    QLOG_DEBUG(tr("Failed to open %1").arg(snapshot.source_path));
+    return false;
+  }
 
-        QString container(itemFile.readAll());
-        // remove xml header string. This will be reinserted by QXmlStreamWriter
-        int length = container.trimmed().length();
-        if (container.trimmed().startsWith(XML_HEADER)) {
-          length -= XML_HEADER.length();
-          container = container.right(length).trimmed();
-        }
-        // Remove DOCTYPE if exists. Again this will be reinserted later.
-        if (container.trimmed().startsWith(HTML_DOCTYPE)) {
-          length = container.length();
-          length -= HTML_DOCTYPE.length();
-          container = container.right(length).trimmed();
-        }
+  QString temp_path = snapshot.save_path + ".tmp";
+  QFile::remove(temp_path);
+  QuaZip save_zip(temp_path);
+  if (!save_zip.open(QuaZip::mdCreate)) {
+    int error = save_zip.getZipError();
+    QLOG_DEBUG(
+      tr("Unable to create %1 : error %2").arg(temp_path).arg(error));
+    return false;
+  }
 
-        extractHeadInformationFromHtmlFile(item, container);
-
-        QString in_body;
-        QRegularExpression regex("<body[^>]*>((.|[\n\r])*)<\\/body>");
-        QRegularExpressionMatch match = regex.match(container);
-        int start, end;
-        if (match.isValid()) {
-          in_body = match.captured(0);
-          regex = QRegularExpression("<body[^>]*>");
-          match = regex.match(in_body);
-          if (match.isValid()) {
-            start = match.capturedEnd(0);
-            regex = QRegularExpression("<\\/body>");
-            match = regex.match(in_body);
-            if (match.isValid()) {
-              end = match.capturedStart(0);
-              in_body = in_body.mid(start, end - start);
-            }
-          }
-        }
+  if (progress) {
+    progress->setProgressRange(0, snapshot.entries.size());
+  }
 
-        item->document_string = in_body.trimmed();
-        m_manifest.html_items.append(item);
-      } else if (item->media_type == "text/css") {
-        m_archive->setCurrentFile(item->path);
-        QuaZipFile itemFile(m_archive);
-        itemFile.setZip(m_archive);
-
-        if (!itemFile.open(QIODevice::ReadOnly)) {
-          int error = m_archive->getZipError();
-          QLOG_DEBUG(tr("Unable to open css file error %1").arg(error));
-          return false;
-        }
+  bool result = true;
+  for (int i = 0; i < snapshot.entries.size() && result; i++) {
+    const EPubSaveEntry& entry = snapshot.entries.at(i);
+    if (entry.raw) {
+      result = copyRawEntry(&source_zip, &save_zip, snapshot.index, entry.path);
+    } else {
+      result = writeEntry(&save_zip,
+                          entry.path,
+                          entry.media_type,
+                          entry.data,
+                          snapshot.compression_level);
+    }
+    if (progress) {
+      progress->setProgressValue(i + 1);
+    }
+  }
 
-        QString css_string(itemFile.readAll());
-        css_string.replace("@charset \"", "@charset\"");
-        m_manifest.css.insert(item->href, css_string);
+  save_zip.close();
+  source_zip.close();
+  if (!result) {
+    QFile::remove(temp_path);
+  }
+  return result;
+}
 
-      } else if (item->media_type == "text/javascript") {
-        m_archive->setCurrentFile(item->path);
-        QuaZipFile itemFile(m_archive);
-        itemFile.setZip(m_archive);
+/*!
+ * \brief Moves a loaded container to a copy of its file.
+ *
+ * The copy must be identical to the current file, which is the case when a
+ * book is copied into the library, as the parsed package and any loaded
+ * items are kept and only the archive is reopened.
+ *
+ * \param filename the path of the copy.
+ * \return true if the copy was opened, otherwise false.
+ */
+bool
+EPubContainer::reopenFile(const QString& filename)
+{
+  if (!waitForSave()) {
+    return false;
+  }
+  closeFile();
+  m_filename = filename;
+  if (!reopenArchive()) {
+    return false;
+  }
+  // the parse cache is keyed on the path of the file.
+  m_parse_cache_dirty = true;
+  writeParseCache();
+  return true;
+}
 
-        if (!itemFile.open(QIODevice::ReadOnly)) {
-          int error = m_archive->getZipError();
-          QLOG_DEBUG(tr("Unable to open javascript file error %1").arg(error));
-          return false;
-        }
+/*!
+ * \brief Opens m_filename again after the archive has been closed, without
+ * parsing the package.
+ */
+bool
+EPubContainer::reopenArchive()
+{
+  m_archive = new QuaZip(m_filename);
+  if (!m_archive->open(QuaZip::mdUnzip)) {
+    QLOG_DEBUG(tr("Failed to reopen %1").arg(m_filename));
+    return false;
+  }
+  mapArchive();
+  return buildEntryIndex();
+}
 
-        QString js_string(itemFile.readAll());
-        m_manifest.javascript.insert(item->id, js_string);
-      }
-    } else {
-      QLOG_DEBUG(tr("Warning invalid manifest item : no media-type value"))
-    }
-
-    node = node_map.namedItem("properties");
-    if (!node.isNull()) {
-      name = node.nodeName();
-      value = node.nodeValue();
-      // space separated list
-      QStringList properties = value.split(' ', QString::SkipEmptyParts);
-      item->properties = properties;
-
-      foreach (QString prop, properties) {
-        if (prop == "cover-image") {
-          // only one cover-image allowed.
-          m_manifest.cover_image = item;
-          //          m_manifest.images.insert(item->id, item);
-        } else if (prop == "nav") {
-          // only one nav allowed.
-          m_manifest.nav = item;
-        } else if (prop == "svg") {
-          m_manifest.svg_images.insert(item->id, item);
-          //          m_manifest.images.insert(item->id, item);
-        } else if (prop == "switch") {
-          m_manifest.switches.insert(item->id, item);
-        } else if (prop == "mathml") {
-          m_manifest.mathml.insert(item->id, item);
-        } else if (prop == "remote-resources") {
-          m_manifest.remotes.insert(item->id, item);
-        } else if (prop == "scripted") {
-          m_manifest.scripted.insert(item->id, item);
-        } else {
-          // one of the exmples had a data-nav element which is NOT standard.
-          // not certain what to do with these.
-          item->non_standard_properties.insert(name, value);
-        }
-      }
+/*!
+ * \brief Returns true if any html item has been changed since it was loaded
+ * or saved.
+ */
+bool
+EPubContainer::hasModifiedItems() const
+{
+  foreach (SharedManifestItem item, m_manifest.items()) {
+    if ((item->categories & EPubManifest::HTML) && item->modified) {
+      return true;
     }
+  }
+  return false;
+}
 
-    node = node_map.namedItem("fallback");
-    if (!node.isNull()) {
-      value = node.nodeValue();
-      item->fallback = value;
-    }
+/*!
+ * \brief Applies a metadata edit and saves it in place, see saveMetadata().
+ *
+ * \return true if the book was saved or the edit changed nothing.
+ */
+bool
+EPubContainer::writeMetadata(const EBookMetadataEdit& edit)
+{
+  if (!m_metadata) {
+    return false;
+  }
+  if (!m_metadata->applyEdit(edit)) {
+    return true;
+  }
+  return saveMetadata();
+}
+
+/*
+ * The children of the metadata element as m_metadata writes them.
+ */
+QString
+EPubContainer::metadataChildren()
+{
+  QByteArray written;
+  QXmlStreamWriter xml_writer(&written);
+  m_metadata->write(&xml_writer);
+  QString metadata = QString::fromUtf8(written);
+  int start = metadata.indexOf('>') + 1;
+  int end = metadata.lastIndexOf(QLatin1String("</metadata>"));
+  return (end > start ? metadata.mid(start, end - start) : QString());
+}
+
+/*
+ * The package file as it is in the archive with the children of its
+ * metadata element replaced, the manifest, spine and guide are copied
+ * unchanged. The start tag of the metadata element is kept as it declares
+ * the dc and opf prefixes that the metadata is written with.
+ *
+ * Returns an empty array if the package file could not be read.
+ */
+QByteArray
+EPubContainer::metadataPackageData(const QString& children)
+{
+  QByteArray data;
+  if (!readArchiveEntry(m_archive, m_container_fullpath, data)) {
+    QLOG_DEBUG(tr("Unable to read %1").arg(m_container_fullpath));
+    return QByteArray();
+  }
 
-    node = node_map.namedItem("media-overlay");
-    if (!node.isNull()) {
-      value = node.nodeValue();
-      item->media_overlay = value;
-      m_manifest.media_overlay.insert(item->id, item);
-    }
+  QString package = QString::fromUtf8(data);
+  if (!replaceMetadataChildren(package, children)) {
+    QLOG_DEBUG(
+      tr("No metadata element in %1").arg(m_container_fullpath));
+    return QByteArray();
+  }
+  // the parse cache is written from the fragment.
+  replaceMetadataChildren(m_metadata_xml, children);
+  return package.toUtf8();
+}
 
-    m_manifest.items.insert(item->id, item);
+/*
+ * Replaces what is between the start and end tags of the metadata element
+ * of an opf document, the element may have a namespace prefix.
+ */
+bool
+EPubContainer::replaceMetadataChildren(QString& document,
+                                       const QString& children)
+{
+  static const QRegularExpression start_tag(
+    "<(?:\\w+:)?metadata(?:\\s[^>]*)?>");
+  static const QRegularExpression end_tag("</(?:\\w+:)?metadata\\s*>");
+  QRegularExpressionMatch start = start_tag.match(document);
+  if (!start.hasMatch()) {
+    return false;
+  }
+  QRegularExpressionMatch end = end_tag.match(document, start.capturedEnd());
+  if (!end.hasMatch()) {
+    return false;
   }
+  document.replace(start.capturedEnd(),
+                   end.capturedStart() - start.capturedEnd(),
+                   children);
   return true;
 }
 
-SharedSpineItem
-EPubContainer::parseSpineItem(const QDomNode& spine_node, SharedSpineItem item)
+/*!
+ * \brief Saves a change to the metadata without copying the archive.
+ *
+ * The metadata element of the package file is written again, the rest of
+ * the package is kept as it was, see metadataPackageData(). The new
+ * package file is appended to the end of the epub along
+ * with a new central directory that points at it in place of the old one,
+ * every other entry is left where it is. The old package file and central
+ * directory remain in the file as unreferenced data.
+ *
+ * Zip readers only look for the end of central directory record in the
+ * last 64k of the file. If the new entry, central directory and end record
+ * fit in that 64k the old end record is still found until the new one is
+ * written, so they are appended in place and an interrupted save leaves
+ * the original book readable. Anything larger is appended to a copy of the
+ * epub that only replaces the book once it is complete.
+ *
+ * Only plain zip archives can be patched, for zip64 archives or if the
+ * patch fails for any other reason false is returned and saveFile() should
+ * be used instead.
+ *
+ * \return true if the package file was replaced, otherwise false.
+ */
+bool
+EPubContainer::saveMetadata()
 {
-  QDomElement metadata_element = spine_node.toElement();
-  QString tag_name = metadata_element.tagName();
-  QDomNamedNodeMap node_map = metadata_element.attributes();
-  QDomNode node;
-  QString name, value;
-
-  if (tag_name == "itemref") {
-
-    // TODO EPUB2 toc element - convert to EPUB3
-
-    node = node_map.namedItem("idref");
-    if (!node.isNull()) {
-      value = node.nodeValue();
-      item->idref = value;
-    } else {
-      QLOG_DEBUG(tr("Warning invalid manifest itemref : no idref value"))
-    }
-
-    node = node_map.namedItem("id");
-    if (!node.isNull()) {
-      value = node.nodeValue();
-      item->id = value;
-    }
+  if (!waitForSave() || !m_archive || !m_archive->isOpen()) {
+    return false;
+  }
 
-    node = node_map.namedItem("linear");
-    if (!node.isNull()) {
-      value = node.nodeValue();
-      if (value == "yes" || value == "no") {
-        if (value == "yes")
-          item->linear = true; // false by default.
-      } else {
-        QLOG_DEBUG(tr("Warning invalid manifest itemref : linear MUST be "
-                      "either yes or no not %1")
-                     .arg(value))
-      }
-    }
+  QString metadata = metadataChildren();
+  QByteArray package = metadataPackageData(metadata);
+  if (package.isEmpty()) {
+    return false;
+  }
+  QByteArray compressed = qCompress(package, m_compression_level);
+  // qCompress() adds a 4 byte size and wraps the deflate data in a zlib
+  // header and adler32 trailer, the zip entry needs just the deflate data.
+  if (compressed.size() < 10) {
+    return false;
+  }
+  compressed = compressed.mid(6, compressed.size() - 10);
+  quint32 crc = QuaCrc32().calculate(package);
 
-    node = node_map.namedItem("properties");
-    if (!node.isNull()) {
-      name = node.nodeName();
-      value = node.nodeValue();
-      // space separated list
-      QStringList properties = value.split(' ', QString::SkipEmptyParts);
+  // the mapping and central directory are out of date once the file
+  // changes.
+  closeFile();
+  bool result = appendPackageEntry(
+    m_filename, m_container_fullpath, package, compressed, crc);
 
-      foreach (QString prop, properties) {
-        if (prop == "page-spread-left") {
-          item->page_spread_left = true;
-        } else if (prop == "page-spread-right") {
-          item->page_spread_right = true;
-        }
-      }
-    }
+  if (!reopenArchive()) {
+    return false;
+  }
 
-    m_spine.items.insert(item->idref, item);
-    m_spine.ordered_items.append(item->idref);
+  if (result) {
+    m_written_metadata = metadata;
+    m_parse_cache_dirty = true;
+    writeParseCache();
+    emit saveFinished(true);
   }
-  return item;
+  return result;
 }
 
+/*!
+ * \brief Appends a deflated entry and a central directory that uses it
+ * instead of the existing entry of the same path.
+ *
+ * This is the worker for saveMetadata(). The data is appended to the file
+ * itself only while the old end record stays within ZIP_EOCD_SEARCH bytes
+ * of the end, otherwise to a QSaveFile copy.
+ */
 bool
-EPubContainer::saveSpineItem()
+EPubContainer::appendPackageEntry(const QString& filename,
+                                  const QString& path,
+                                  const QByteArray& data,
+                                  const QByteArray& compressed,
+                                  quint32 crc)
 {
-  // TODO save spine manfest section
-}
-
-SharedTocItem
-EPubContainer::parseNavPoint(QDomElement navpoint, QString& formatted_toc_data)
-{
-  m_toc_chapter_index++;
-  SharedTocItem toc_item = SharedTocItem(new EPubTocItem());
-  //  QDomNamedNodeMap attributes = navpoint.attributes();
-  QString value = navpoint.attribute("class");
-  if (!value.isEmpty()) {
-    toc_item->tag_class = value;
-  } else {
-    //            QLOG_DEBUG(tr("Warning invalid manifest itemref : no
-    //            idref value"))
+  QFile file(filename);
+  if (!file.open(QIODevice::ReadOnly)) {
+    QLOG_DEBUG(tr("Unable to open %1").arg(filename));
+    return false;
   }
 
-  value = navpoint.attribute("id");
-  if (!value.isEmpty()) {
-    toc_item->id = value;
-  } else {
-    //            QLOG_DEBUG(tr("Warning invalid manifest itemref : no
-    //            idref value"))
+  // the end of central directory record, followed by up to 64k of comment.
+  qint64 file_size = file.size();
+  qint64 tail_size = qMin(file_size, qint64(ZIP_EOCD_SEARCH));
+  file.seek(file_size - tail_size);
+  QByteArray tail = file.read(tail_size);
+  int eocd = -1;
+  for (int i = tail.size() - ZIP_EOCD_SIZE; i >= 0; i--) {
+    if (readUInt32(tail, i) == ZIP_EOCD_SIGNATURE) {
+      eocd = i;
+      break;
+    }
+  }
+  if (eocd < 0) {
+    QLOG_DEBUG(tr("No central directory found in %1").arg(filename));
+    return false;
   }
 
-  value = navpoint.attribute("playOrder");
-  if (!value.isEmpty()) {
-    toc_item->playorder = value.toInt();
-  } else {
-    //            QLOG_DEBUG(tr("Warning invalid manifest itemref : no
-    //            idref value"))
+  quint16 entry_count = readUInt16(tail, eocd + 10);
+  quint32 directory_size = readUInt32(tail, eocd + 12);
+  quint32 directory_offset = readUInt32(tail, eocd + 16);
+  QByteArray comment = tail.mid(eocd + ZIP_EOCD_SIZE);
+  if (entry_count == 0xFFFF || directory_offset == 0xFFFFFFFF ||
+      file_size + data.size() + directory_size + 0x10000 > 0xFFFFFFFFLL) {
+    QLOG_DEBUG(tr("%1 is too large to patch in place").arg(filename));
+    return false;
   }
 
-  QDomElement navlabel = navpoint.firstChildElement("navLabel");
-  if (!navlabel.isNull()) {
-    QDomElement text = navlabel.firstChild().toElement();
-    if (text.tagName() == "text") {
-      toc_item->label = text.text();
-    }
+  file.seek(directory_offset);
+  QByteArray directory = file.read(directory_size);
+  if (directory.size() != int(directory_size)) {
+    return false;
   }
 
-  QDomElement content = navpoint.firstChildElement("content");
-  value = content.attribute("src");
-  if (!value.isEmpty()) {
-    // if no chapter fragment then add one in.
-    int index = value.indexOf("#");
-    if (index <= 0) {
-      toc_item->source = value;
-      toc_item->chapter_tag.clear();
+  // copy every central directory record except that of path.
+  QByteArray encoded_path = path.toUtf8();
+  QByteArray new_directory;
+  QByteArray old_record;
+  int offset = 0;
+  for (int i = 0; i < entry_count; i++) {
+    if (offset + ZIP_CDFH_SIZE > directory.size() ||
+        readUInt32(directory, offset) != ZIP_CDFH_SIGNATURE) {
+      QLOG_DEBUG(tr("Corrupt central directory in %1").arg(filename));
+      return false;
+    }
+    int record_size = ZIP_CDFH_SIZE + readUInt16(directory, offset + 28) +
+                      readUInt16(directory, offset + 30) +
+                      readUInt16(directory, offset + 32);
+    QByteArray record = directory.mid(offset, record_size);
+    if (record.mid(ZIP_CDFH_SIZE, readUInt16(directory, offset + 28)) ==
+        encoded_path) {
+      old_record = record;
     } else {
-      QString tag;
-      tag = QString("#part%1").arg(m_toc_chapter_index);
-      value += tag;
-      toc_item->chapter_tag = tag;
+      new_directory += record;
     }
-  } else {
-    //            QLOG_DEBUG(tr("Warning invalid manifest itemref : no
-    //            idref value"))
+    offset += record_size;
+  }
+  if (old_record.isEmpty()) {
+    QLOG_DEBUG(tr("%1 is not in %2").arg(path).arg(filename));
+    return false;
   }
 
-  formatted_toc_data += LIST_ITEM.arg(toc_item->source).arg(toc_item->label);
-
-  // parse nested navPoints.
-  QDomElement sub_navpoint = navpoint.firstChildElement("navPoint");
-  if (!sub_navpoint.isNull()) {
-    formatted_toc_data += LIST_START;
-
-    while (!sub_navpoint.isNull()) {
-      SharedTocItem sub_item = parseNavPoint(sub_navpoint, formatted_toc_data);
-
-      toc_item->sub_items.insert(sub_item->playorder, sub_item);
-      sub_navpoint = sub_navpoint.nextSiblingElement("navPoint");
+  QDateTime now = QDateTime::currentDateTime();
+  quint16 dos_time = quint16((now.time().hour() << 11) |
+                             (now.time().minute() << 5) |
+                             (now.time().second() / 2));
+  quint16 dos_date = quint16(((now.date().year() - 1980) << 9) |
+                             (now.date().month() << 5) | now.date().day());
+
+  // the new entry goes after everything that is already in the file.
+  quint32 entry_offset = quint32(file_size);
+  QByteArray local;
+  appendUInt32(local, ZIP_LFH_SIGNATURE);
+  appendUInt16(local, 20); // version needed to extract.
+  appendUInt16(local, 0);  // flags.
+  appendUInt16(local, 8);  // deflated.
+  appendUInt16(local, dos_time);
+  appendUInt16(local, dos_date);
+  appendUInt32(local, crc);
+  appendUInt32(local, quint32(compressed.size()));
+  appendUInt32(local, quint32(data.size()));
+  appendUInt16(local, quint16(encoded_path.size()));
+  appendUInt16(local, 0); // no extra field.
+  local += encoded_path;
+  local += compressed;
+
+  // the new central directory record keeps the attributes of the old one.
+  QByteArray record;
+  appendUInt32(record, ZIP_CDFH_SIGNATURE);
+  appendUInt16(record, readUInt16(old_record, 4)); // version made by.
+  appendUInt16(record, 20);
+  appendUInt16(record, 0);
+  appendUInt16(record, 8);
+  appendUInt16(record, dos_time);
+  appendUInt16(record, dos_date);
+  appendUInt32(record, crc);
+  appendUInt32(record, quint32(compressed.size()));
+  appendUInt32(record, quint32(data.size()));
+  appendUInt16(record, quint16(encoded_path.size()));
+  appendUInt16(record, 0); // no extra field.
+  appendUInt16(record, 0); // no comment.
+  appendUInt16(record, 0); // disk number.
+  appendUInt16(record, readUInt16(old_record, 36)); // internal attributes.
+  appendUInt32(record, readUInt32(old_record, 38)); // external attributes.
+  appendUInt32(record, entry_offset);
+  record += encoded_path;
+  new_directory += record;
+
+  quint32 new_directory_offset = entry_offset + quint32(local.size());
+  QByteArray end_record;
+  appendUInt32(end_record, ZIP_EOCD_SIGNATURE);
+  appendUInt16(end_record, 0);
+  appendUInt16(end_record, 0);
+  appendUInt16(end_record, entry_count);
+  appendUInt16(end_record, entry_count);
+  appendUInt32(end_record, quint32(new_directory.size()));
+  appendUInt32(end_record, new_directory_offset);
+  appendUInt16(end_record, quint16(comment.size()));
+  end_record += comment;
+
+  // until the end record is complete readers search back from the end of
+  // the file for the old one, see saveMetadata().
+  qint64 appended = local.size() + new_directory.size() + end_record.size();
+  if (ZIP_EOCD_SIZE + comment.size() + appended <= ZIP_EOCD_SEARCH) {
+    file.close();
+    if (!file.open(QIODevice::ReadWrite)) {
+      QLOG_DEBUG(tr("Unable to open %1 for writing").arg(filename));
+      return false;
     }
-
-    formatted_toc_data += LIST_END;
+    // the end record is written last.
+    file.seek(file_size);
+    if (file.write(local) != local.size() ||
+        file.write(new_directory) != new_directory.size() || !file.flush() ||
+        file.write(end_record) != end_record.size() || !file.flush()) {
+      QLOG_DEBUG(tr("Unable to write the package file to %1").arg(filename));
+      file.resize(file_size);
+      return false;
+    }
+    return true;
   }
 
-  return toc_item;
+  // too large to leave the old end record findable, so the entries are
+  // copied across raw and the copy renamed over the book once complete.
+  QSaveFile save(filename);
+  if (!save.open(QIODevice::WriteOnly)) {
+    QLOG_DEBUG(tr("Unable to open %1 for writing").arg(filename));
+    return false;
+  }
+  file.seek(0);
+  while (!file.atEnd()) {
+    QByteArray chunk = file.read(ZIP_COPY_CHUNK);
+    if (chunk.isEmpty() || save.write(chunk) != chunk.size()) {
+      QLOG_DEBUG(tr("Unable to copy %1").arg(filename));
+      save.cancelWriting();
+      return false;
+    }
+  }
+  file.close();
+  if (save.write(local) != local.size() ||
+      save.write(new_directory) != new_directory.size() ||
+      save.write(end_record) != end_record.size() || !save.commit()) {
+    QLOG_DEBUG(tr("Unable to write the package file to %1").arg(filename));
+    return false;
+  }
+  return true;
 }
 
-void
-EPubContainer::handleSubNavpoints(QDomElement elem,
-                                  QString& formatted_toc_string)
+quint16
+EPubContainer::readUInt16(const QByteArray& data, int offset)
 {
-  QDomElement subpoint = elem.firstChildElement("navPoint");
-  while (!subpoint.isNull()) {
-    SharedTocItem toc_item = parseNavPoint(subpoint, formatted_toc_string);
-    m_manifest.toc_items.insert(toc_item->playorder, toc_item);
-    m_manifest.toc_paths.insert(toc_item->source, toc_item);
-
-    handleSubNavpoints(subpoint, formatted_toc_string);
-
-    subpoint = elem.nextSiblingElement("navPoint");
-  }
+  return qFromLittleEndian<quint16>(
+    reinterpret_cast<const uchar*>(data.constData() + offset));
 }
 
-QString
-EPubContainer::extractTagText(int anchor_start, QString document_string)
-{
-  int i = anchor_start;
-  bool in_dquotes = false, in_squotes = false, in_tag = false,
-       in_close_tag = false;
-  QChar first;
-  QString text;
-  while (i < document_string.length()) {
-    first = document_string.at(i);
-    if (first == '<') {
-      if (!in_dquotes && !in_squotes) {
-        in_tag = true;
-      }
-    } else if (first == '>') {
-      if (!in_dquotes && !in_squotes) {
-        if (in_tag) {
-          in_tag = false;
-        } else if (in_close_tag) {
-          in_close_tag = false;
-        }
-      }
-    } else if (first == '\"') {
-      if (in_dquotes)
-        in_dquotes = false;
-      else {
-        in_dquotes = true;
-      }
-    } else if (first == '\'') {
-      if (in_squotes)
-        in_squotes = false;
-      else {
-        in_squotes = true;
-      }
-    } else if (first == '/') {
-      if (in_tag) {
-        in_close_tag = true;
-        in_tag = false;
-      }
-    } else {
-      if (!in_tag && !in_close_tag) {
-        // store everything if not in_quotes and not in_tag
-        text += first;
-      }
-      if (in_close_tag) {
-        if (first == 'a') { // end of the anchor tag.
-          break;
-        }
-      }
-    }
-    i++;
-  }
-  return text;
+quint32
+EPubContainer::readUInt32(const QByteArray& data, int offset)
+{
+  return qFromLittleEndian<quint32>(
+    reinterpret_cast<const uchar*>(data.constData() + offset));
 }
 
-QString
-EPubContainer::buildTocfromHtml()
-{
-  QString formatted_toc_string = LIST_START;
-
-  QRegularExpression re_anchor_complete(
-    "<a[\\s]+([^>]+)>((?:.(?!\\<\\/a\\>))*.)</a>");
-  QRegularExpression re_anchor_tag("<a[^>]*>");
-  QRegularExpression re_href("href=\\\"[^\"]*\"");
-  int anchor_start, pos = 0;
-
-  foreach (SharedManifestItem item, m_manifest.html_items) {
-    QString document_string = item->document_string;
-    if (!document_string.isEmpty()) {
-      QRegularExpressionMatchIterator i =
-        re_anchor_complete.globalMatch(document_string);
-      QRegularExpressionMatch anchor_complete_match, anchor_tag_match,
-        href_match;
-      QString anchor_complete, anchor_tag, href_attr;
-
-      while (i.hasNext()) {
-        anchor_complete_match = i.next();
-        anchor_complete = anchor_complete_match.captured(0);
-        anchor_start =
-          anchor_complete_match.capturedStart(0); // start of open anchor tag.
-
-        anchor_tag_match = re_anchor_tag.match(anchor_complete);
-        if (anchor_tag_match.hasMatch()) {
-          anchor_tag = anchor_tag_match.captured(0);
-          anchor_start +=
-            anchor_tag_match.capturedLength(0); // end of open anchor tag
-
-          QString text = extractTagText(anchor_start, document_string);
-
-          href_match = re_href.match(anchor_tag);
-          if (href_match.hasMatch()) {
-            href_attr = href_match.captured(0);
-            href_attr = href_attr.mid(6, href_attr.length() - 7);
-            QStringList splits = href_attr.split("#", QString::KeepEmptyParts);
-            if (splits.length() == 1) {
-              QString filename = splits.at(0);
-              SharedManifestItemList files = m_manifest.html_items;
-              foreach (SharedManifestItem item, files) {
-                QString href = item->href;
-                if (href == filename) {
-                  // TODO add anchor & make anchor tag.
-                }
-              }
-            } else if (!splits.at(0).isEmpty() && !splits.at(1).isEmpty()) {
-              // existing file + anchor points exist.
-              formatted_toc_string +=
-                LIST_BUILD_ITEM.arg(splits.at(0)).arg(splits.at(1)).arg(text);
-            } else if (!splits.at(0).isEmpty() && splits.at(1).isEmpty()) {
-              // existing file but no anchor point.
-              QString pos_tag = LIST_FILEPOS.arg(pos++);
-              formatted_toc_string +=
-                LIST_BUILD_ITEM.arg(splits.at(0)).arg(pos_tag).arg(text);
-              // TODO introduce anchor tag
-            } else if (splits.at(0).isEmpty() && !splits.at(1).isEmpty()) {
-              // existing anchor tag but no file.
-              // TODO find file and add to anchor.
-            } else {
-              // TODO no existing anchor point ??? not certain we ever get
-              // here. may need to move this outside last regex match.
-            }
-          }
-        }
-      }
-    }
-  }
+void
+EPubContainer::appendUInt16(QByteArray& data, quint16 value)
+{
+  uchar bytes[2];
+  qToLittleEndian(value, bytes);
+  data.append(reinterpret_cast<const char*>(bytes), 2);
+}
 
-  formatted_toc_string += LIST_END;
-  return formatted_toc_string;
+void
+EPubContainer::appendUInt32(QByteArray& data, quint32 value)
+{
+  uchar bytes[4];
+  qToLittleEndian(value, bytes);
+  data.append(reinterpret_cast<const char*>(bytes), 4);
 }
 
+/*!
+ * \brief Writes content as a new epub 3 book at path.
+ *
+ * The chapters and resources are written under OEBPS with their hrefs
+ * unchanged, with a package file and a navigation document made from the
+ * chapter titles. As with saveFile() the book is written to a temporary
+ * file which then replaces path.
+ *
+ * This uses no container so may be called from worker threads.
+ */
 bool
-EPubContainer::parseTocFile()
+EPubContainer::writeContent(const EBookContent& content,
+                            const QString& path,
+                            int compression_level)
 {
-  QString toc_id = m_spine.toc;
-  SharedManifestItem toc_item = m_manifest.items.value(toc_id);
-  QString toc_path = toc_item->path;
-
-  m_archive->setCurrentFile(toc_path);
-  QuaZipFile toc_file(m_archive);
-  toc_file.setZip(m_archive);
+  EBOOK_TRACE_SCOPE("EPubContainer::writeContent");
+  QDir dir;
+  dir.mkpath(QFileInfo(path).path());
 
-  if (!toc_file.open(QIODevice::ReadOnly)) {
-    m_archive->getZipError();
-    QLOG_DEBUG(tr("Unable to open toc file %1").arg(toc_path));
+  // the nav must not replace a chapter or resource of the same name.
+  QSet<QString> hrefs;
+  foreach (const EBookContentChapter& chapter, content.chapters) {
+    hrefs.insert(chapter.href);
   }
-
-  QByteArray data = toc_file.readAll();
-  DomDocument document = DomDocument(new QDomDocument());
-  document->setContent(data);
-  QString formatted_toc_string;
-  QDomElement root = document->documentElement();
-  QDomNodeList node_list = document->elementsByTagName("docTitle");
-
-  if (!node_list.isEmpty()) {
-    QDomNode title_node = node_list.at(0);
-    QDomElement title_text = title_node.firstChild().toElement();
-    if (title_text.tagName() == "text") {
-      formatted_toc_string += TOC_TITLE.arg(title_text.text());
-    }
+  foreach (const EBookContentResource& resource, content.resources) {
+    hrefs.insert(resource.href);
+  }
+  QString nav_href = "nav.xhtml";
+  for (int i = 1; hrefs.contains(nav_href); i++) {
+    nav_href = QString("nav%1.xhtml").arg(i);
   }
-  formatted_toc_string += LIST_START;
-
-  m_toc_chapter_index = -1;
-  node_list = document->elementsByTagName("navMap");
-  if (!node_list.isEmpty()) {
-    QString name, value;
-    QDomNode node = node_list.at(0);
-    QDomElement elem = node.toElement();
-    QDomElement navpoint = elem.firstChildElement("navPoint");
-    while (!navpoint.isNull()) {
-      SharedTocItem toc_item = parseNavPoint(navpoint, formatted_toc_string);
-      m_manifest.toc_items.insert(toc_item->playorder, toc_item);
-      m_manifest.toc_paths.insert(toc_item->source, toc_item);
-
-      handleSubNavpoints(navpoint, formatted_toc_string);
 
-      navpoint = navpoint.nextSiblingElement("navPoint");
-    }
+  QString temp_path = path + ".tmp";
+  QFile::remove(temp_path);
+  QuaZip save_zip(temp_path);
+  if (!save_zip.open(QuaZip::mdCreate)) {
+    int error = save_zip.getZipError();
+    QLOG_DEBUG(
+      tr("Unable to create %1 : error %2").arg(temp_path).arg(error));
+    return false;
   }
 
-  formatted_toc_string += LIST_END;
+  QString folder = CONTENT_FOLDER + QLatin1Char('/');
+  QString xhtml_type = QString::fromLatin1(XHTML_TYPE);
+  bool result =
+    writeEntry(&save_zip, MIMETYPE_FILE, QString(), MIMETYPE, 0) &&
+    writeEntry(&save_zip,
+               CONTAINER_FILE,
+               QString(),
+               contentContainerData(),
+               compression_level) &&
+    writeEntry(&save_zip,
+               CONTENT_PACKAGE_FILE,
+               QString(),
+               contentPackageData(content, nav_href),
+               compression_level) &&
+    writeEntry(&save_zip,
+               folder + nav_href,
+               xhtml_type,
+               contentNavData(content),
+               compression_level);
+  for (int i = 0; i < content.chapters.size() && result; i++) {
+    const EBookContentChapter& chapter = content.chapters.at(i);
+    result = writeEntry(&save_zip,
+                        folder + chapter.href,
+                        xhtml_type,
+                        chapter.xhtml.toUtf8(),
+                        compression_level);
+  }
+  for (int i = 0; i < content.resources.size() && result; i++) {
+    const EBookContentResource& resource = content.resources.at(i);
+    result = writeEntry(&save_zip,
+                        folder + resource.href,
+                        resource.media_type,
+                        resource.data,
+                        compression_level);
+  }
 
-  m_manifest.formatted_toc_string = formatted_toc_string;
+  save_zip.close();
+  if (!result) {
+    QFile::remove(temp_path);
+    return false;
+  }
+  QFile::remove(path);
+  if (!QFile::rename(temp_path, path)) {
+    QLOG_DEBUG(tr("Unable to rename %1 to %2").arg(temp_path).arg(path));
+    return false;
+  }
+  return true;
 }
 
+/*
+ * Renames a file over another in a single step, so the target is either
+ * the old or the new file even if the save is interrupted. QFile::rename()
+ * will not replace an existing file.
+ */
 bool
-EPubContainer::parseGuideItem(const QDomNode& guideItem)
+EPubContainer::replaceFile(const QString& from, const QString& to)
 {
-  // TODO this has been superceded by the landmark in EPUB 3.0
+#ifdef Q_OS_WIN
+  return (MoveFileExW(reinterpret_cast<const wchar_t*>(
+                        QDir::toNativeSeparators(from).utf16()),
+                      reinterpret_cast<const wchar_t*>(
+                        QDir::toNativeSeparators(to).utf16()),
+                      MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) !=
+          0);
+#else
+  return (std::rename(QFile::encodeName(from).constData(),
+                      QFile::encodeName(to).constData()) == 0);
+#endif
 }
 
+/*!
+ * \brief Replaces the save path with the written temporary file.
+ *
+ * The source archive is closed while it is replaced then reopened. If the
+ * temporary file cannot replace the save path the target is left as it was
+ * and the source archive is reopened. Items that have not been edited again
+ * since the snapshot are marked as unmodified.
+ */
 bool
-EPubContainer::parseLandmarksItem(const QDomNode& guideItem)
+EPubContainer::finishSave(const EPubSaveSnapshot& snapshot)
 {
-  // TODO load landmarks
-}
+  QString temp_path = snapshot.save_path + ".tmp";
+
+  // the source archive must be released before it can be replaced.
+  closeFile();
+  if (!replaceFile(temp_path, snapshot.save_path)) {
+    QLOG_DEBUG(tr("Unable to rename %1 to %2")
+                 .arg(temp_path)
+                 .arg(snapshot.save_path));
+    QFile::remove(temp_path);
+    // the book has not been touched, so it can still be read.
+    reopenArchive();
+    return false;
+  }
 
-bool
-EPubContainer::saveLandmarksItem()
-{
-  // TODO save landmarks
-}
+  m_filename = snapshot.save_path;
+  if (!reopenArchive()) {
+    return false;
+  }
+  if (snapshot.package_written) {
+    m_written_metadata = snapshot.metadata;
+  }
 
-bool
-EPubContainer::parseBindingsItem(const QDomNode& bindingsItem)
-{}
+  QMap<QString, QString>::const_iterator it = snapshot.documents.constBegin();
+  for (; it != snapshot.documents.constEnd(); ++it) {
+    SharedManifestItem item = m_manifest.item(it.key());
+    if (item && documentString(item, false) == it.value()) {
+      item->modified = false;
+    }
+  }
 
-bool
-EPubContainer::saveBindingsItem()
-{
-  // TODO save bindings.
+  // the old cache no longer matches the file.
+  m_parse_cache_dirty = true;
+  writeParseCache();
+  return true;
 }
 
+/*!
+ * \brief Copies an entry from the source archive without recompressing it.
+ *
+ * The compressed data, compression method, level and crc are copied across
+ * unchanged, COPY_CHUNK_SIZE bytes at a time.
+ */
 bool
-EPubContainer::saveFile(const QString& filepath)
+EPubContainer::copyRawEntry(QuaZip* source_zip,
+                            QuaZip* save_zip,
+                            const EPubEntryIndex& index,
+                            const QString& path)
 {
-  QFileInfo info;
-  if (filepath.isEmpty())
-    info = QFileInfo(m_filename);
-  else
-    info = QFileInfo(filepath);
-  QString path = info.path();
-  QString name = info.fileName();
-  //  path = path + QDir::separator() + "temp";
-  QDir dir;
-  dir.mkpath(path);
+  if (!goToEntry(source_zip, index, path)) {
+    QLOG_DEBUG(tr("Unable to find %1 in source archive").arg(path));
+    return false;
+  }
 
-  QuaZip temp_file(path + QDir::separator() + name);
-  if (temp_file.open(QuaZip::mdAdd)) {
+  QuaZipFileInfo64 info;
+  if (!source_zip->getCurrentFileInfo(&info)) {
+    int error = source_zip->getZipError();
+    QLOG_DEBUG(tr("Unable to read info for %1 : error %2").arg(path).arg(error));
+    return false;
+  }
 
-    if (!writeMimetype(&temp_file)) {
-      return false;
-    }
-    if (!writeContainer(&temp_file)) {
+  QuaZipFile in_file(source_zip);
+  int method = 0, level = 0;
+  if (!in_file.open(QIODevice::ReadOnly, &method, &level, true)) {
+    int error = source_zip->getZipError();
+    QLOG_DEBUG(tr("Unable to open %1 : error %2").arg(path).arg(error));
+    return false;
+  }
+
+  QuaZipFile out_file(save_zip);
+  if (!out_file.open(QIODevice::WriteOnly,
+                     QuaZipNewInfo(info),
+                     nullptr,
+                     info.crc,
+                     method,
+                     level,
+                     true)) {
+    int error = save_zip->getZipError();
+    QLOG_DEBUG(tr("Unable to write %1 : error %2").arg(path).arg(error));
+    return false;
+  }
+  // a chunk at a time, an audio or video entry can be hundreds of MB.
+  QByteArray chunk(COPY_CHUNK_SIZE, Qt::Uninitialized);
+  qint64 size;
+  while ((size = in_file.read(chunk.data(), chunk.size())) > 0) {
+    if (out_file.write(chunk.constData(), size) != size) {
+      QLOG_DEBUG(tr("Unable to copy all of %1").arg(path));
       return false;
     }
-    // TODO the rest
   }
-  m_filename = filepath;
-
-  temp_file.close();
-
-  // TODO backup/rename etc.
-  // TODO remove temp file/dir - maybe on application close/cleanup
-
+  in_file.close();
+  if (size < 0) {
+    QLOG_DEBUG(tr("Unable to read all of %1").arg(path));
+    return false;
+  }
+  out_file.close();
   return true;
 }
 
+/*!
+ * \brief Writes a complete entry to the save archive in a single write.
+ *
+ * The mimetype, which the standard requires to be uncompressed, and media
+ * that is already compressed are stored, everything else is deflated at
+ * the given level.
+ */
 bool
-EPubContainer::writeMimetype(QuaZip* save_zip)
+EPubContainer::writeEntry(QuaZip* save_zip,
+                          const QString& path,
+                          const QString& media_type,
+                          const QByteArray& data,
+                          int compression_level)
 {
-  QuaZipFile mimetype_file(save_zip);
+  int method = Z_DEFLATED, level = compression_level;
+  if (path == MIMETYPE_FILE || isPrecompressedMediaType(media_type)) {
+    method = 0;
+    level = 0;
+  }
 
-  if (!mimetype_file.open(QIODevice::WriteOnly,
-                          QuaZipNewInfo(MIMETYPE_FILE, MIMETYPE_FILE))) {
+  QuaZipFile entry_file(save_zip);
+  if (!entry_file.open(QIODevice::WriteOnly,
+                       QuaZipNewInfo(path),
+                       nullptr,
+                       0,
+                       method,
+                       level)) {
     int error = save_zip->getZipError();
-    QLOG_DEBUG(tr("Unable to write mimetype file : error %1").arg(error));
+    QLOG_DEBUG(tr("Unable to write %1 : error %2").arg(path).arg(error));
     return false;
   }
 
-  qint64 size = mimetype_file.write(MIMETYPE);
-  if (size != m_mimetype.size()) {
-    QLOG_DEBUG(tr("Unexpected mimetype size %1 should be %2")
+  qint64 size = entry_file.write(data);
+  entry_file.close();
+  if (size != data.size()) {
+    QLOG_DEBUG(tr("Unexpected %1 size %2 should be %3")
+                 .arg(path)
                  .arg(size)
-                 .arg(m_mimetype.size()));
+                 .arg(data.size()));
     return false;
   }
   return true;
 }
 
+/*!
+ * \brief true for media types whose content is already compressed.
+ *
+ * Deflating these costs time for little or no reduction in size.
+ */
 bool
-EPubContainer::writeContainer(QuaZip* save_zip)
+EPubContainer::isPrecompressedMediaType(const QString& media_type)
 {
-  QuaZipFile container_file(save_zip);
-
-  if (!container_file.open(QIODevice::WriteOnly,
-                           QuaZipNewInfo(CONTAINER_FILE, CONTAINER_FILE))) {
-    int error = save_zip->getZipError();
-    QLOG_DEBUG(tr("Unable to write container file : error %1").arg(error));
-    return false;
-  }
+  return (media_type == "image/jpeg" || media_type == "image/png" ||
+          media_type == "image/gif" || media_type == "font/woff" ||
+          media_type == "font/woff2" || media_type == "application/font-woff" ||
+          media_type == "audio/mpeg" || media_type == "audio/mp4" ||
+          media_type == "video/mp4");
+}
 
-  QXmlStreamWriter xml_writer(&container_file);
+QByteArray
+EPubContainer::containerData()
+{
+  QByteArray data;
+  QXmlStreamWriter xml_writer(&data);
   xml_writer.setAutoFormatting(true);
   xml_writer.writeStartDocument("1.0");
 
@@ -1189,102 +4539,191 @@ EPubContainer::writeContainer(QuaZip* save_zip)
   xml_writer.writeEndElement();
 
   xml_writer.writeEndDocument();
-  container_file.close();
-
-  writePackageFile(save_zip);
 
-  foreach (SharedManifestItem item, m_manifest.html_items) {
-    QuaZipFile item_file(save_zip);
-    item_file.setFileName(item->path);
+  return data;
+}
 
-    if (!item_file.open(QIODevice::WriteOnly,
-                        QuaZipNewInfo(item->path, item->path))) {
-      int error = save_zip->getZipError();
-      QLOG_DEBUG(tr("Unable to write html/xhtml file : error %1").arg(error));
-      return false;
-    }
+/*
+ * The container file of a book written by writeContent().
+ */
+QByteArray
+EPubContainer::contentContainerData()
+{
+  QByteArray data;
+  QXmlStreamWriter xml_writer(&data);
+  xml_writer.setAutoFormatting(true);
+  xml_writer.writeStartDocument("1.0");
 
-    /* We have to use QTextStream rather than QXmlStreamWriter because the xml
-     * stream escapes '<', '>' and several other characters. */
-    QTextStream out(&item_file);
-    out << QStringLiteral("<html xmlns=\"http://www.w3.org/1999/xhtml\">\n");
-    out << HTML_DOCTYPE << "\n";
-    out << QStringLiteral("<head>\n");
-    out << QStringLiteral("<title>");
-    Title shared_title = m_metadata->orderedTitles().first();
-    if (shared_title) {
-      out << shared_title->title;
-    }
-    out << QStringLiteral("</title>\n");
-    out << QStringLiteral("<meta http-equiv=\"Content-Type\" "
-                          "content=\"text/html; charset=utf-8\"/>\n");
-    foreach (QString href, item->css_links) {
-      out << QString(
-               "<link href=\"%1\" rel=\"stylesheet\" type=\"text/css\"/>\n")
-               .arg(href);
-    }
-    out << QStringLiteral("</head>\n");
-    out << QStringLiteral("<body");
-    if (!item->body_class.isEmpty()) {
-      out << QString(" class=\"%1\">\n").arg(item->body_class);
-    } else {
-      out << QStringLiteral(">\n");
-    }
-    out << item->document_string;
-    out << QStringLiteral("</body>\n");
-    out << QStringLiteral("</html>\n");
-    out.flush();
+  xml_writer.writeStartElement("container");
+  xml_writer.writeAttribute("version", "1.0");
+  xml_writer.writeAttribute("xmlns",
+                            "urn:oasis:names:tc:opendocument:xmlns:container");
+  xml_writer.writeStartElement("rootfiles");
+  xml_writer.writeStartElement("rootfile");
+  xml_writer.writeAttribute("full-path", CONTENT_PACKAGE_FILE);
+  xml_writer.writeAttribute("media-type", "application/oebps-package+xml");
+  xml_writer.writeEndElement();
+  xml_writer.writeEndElement();
+  xml_writer.writeEndElement();
 
-    item_file.close();
-  }
-  return true;
+  xml_writer.writeEndDocument();
+  return data;
 }
 
-bool
-EPubContainer::writePackageFile(QuaZip* save_zip)
+/*
+ * The package file of a book written by writeContent(), the manifest ids
+ * are made from the positions of the chapters and resources.
+ */
+QByteArray
+EPubContainer::contentPackageData(const EBookContent& content,
+                                  const QString& nav_href)
 {
-  QuaZipFile package_file(save_zip);
-
-  if (!package_file.open(
-        QIODevice::WriteOnly,
-        QuaZipNewInfo(m_container_fullpath, m_container_fullpath))) {
-    int error = save_zip->getZipError();
-    QLOG_DEBUG(tr("Unable to write container file : error %1").arg(error));
-    return false;
-  }
-
-  QXmlStreamWriter xml_writer(&package_file);
+  QByteArray data;
+  QXmlStreamWriter xml_writer(&data);
   xml_writer.setAutoFormatting(true);
   xml_writer.writeStartDocument("1.0");
 
   xml_writer.writeStartElement("package");
   xml_writer.writeAttribute("version", "3.0");
-  xml_writer.writeAttribute("unique-identifier",
-                            m_metadata->uniqueIdentifierName());
-  xml_writer.writeAttribute("xmlns", m_package_xmlns);
-  if (m_metadata->isFoaf()) {
-    xml_writer.writeAttribute("prefix", Foaf::prefix());
-  }
-  if (!m_package_language.isEmpty()) { // Optional in EPUB 2.0
-    xml_writer.writeAttribute("xml:lang", m_package_language);
+  xml_writer.writeAttribute("xmlns", "http://www.idpf.org/2007/opf");
+  xml_writer.writeAttribute("xmlns:dc", "http://purl.org/dc/elements/1.1/");
+  if (content.metadata) {
+    if (!content.metadata->uniqueIdentifierName().isEmpty()) {
+      xml_writer.writeAttribute("unique-identifier",
+                                content.metadata->uniqueIdentifierName());
+    }
+    if (content.metadata->isFoaf()) {
+      xml_writer.writeAttribute("prefix", Foaf::prefix());
+    }
+    content.metadata->write(&xml_writer);
   }
-  if (!m_package_prefix.isEmpty()) {
-    xml_writer.writeAttribute("prefix", m_package_prefix);
+
+  QString xhtml_type = QString::fromLatin1(XHTML_TYPE);
+  xml_writer.writeStartElement("manifest");
+  xml_writer.writeEmptyElement("item");
+  xml_writer.writeAttribute("id", "nav");
+  xml_writer.writeAttribute("href", nav_href);
+  xml_writer.writeAttribute("media-type", xhtml_type);
+  xml_writer.writeAttribute("properties", "nav");
+  for (int i = 0; i < content.chapters.size(); i++) {
+    xml_writer.writeEmptyElement("item");
+    xml_writer.writeAttribute("id", QString("chapter%1").arg(i + 1));
+    xml_writer.writeAttribute("href", content.chapters.at(i).href);
+    xml_writer.writeAttribute("media-type", xhtml_type);
   }
-  if (!m_package_direction.isEmpty()) {
-    xml_writer.writeAttribute("dir", m_package_direction);
+  for (int i = 0; i < content.resources.size(); i++) {
+    const EBookContentResource& resource = content.resources.at(i);
+    xml_writer.writeEmptyElement("item");
+    xml_writer.writeAttribute("id", QString("resource%1").arg(i + 1));
+    xml_writer.writeAttribute("href", resource.href);
+    xml_writer.writeAttribute("media-type", resource.media_type);
+    if (resource.href == content.cover_href) {
+      xml_writer.writeAttribute("properties", "cover-image");
+    }
   }
-  if (!m_package_id.isEmpty()) {
-    xml_writer.writeAttribute("id", m_package_id);
+  xml_writer.writeEndElement();
+
+  xml_writer.writeStartElement("spine");
+  for (int i = 0; i < content.chapters.size(); i++) {
+    xml_writer.writeEmptyElement("itemref");
+    xml_writer.writeAttribute("idref", QString("chapter%1").arg(i + 1));
   }
+  xml_writer.writeEndElement();
 
-  m_metadata->write(&xml_writer);
+  xml_writer.writeEndElement();
+  xml_writer.writeEndDocument();
+  return data;
+}
+
+/*
+ * The navigation document of a book written by writeContent(), a flat list
+ * of the chapters. Chapters with no title are given their number.
+ */
+QByteArray
+EPubContainer::contentNavData(const EBookContent& content)
+{
+  QByteArray data;
+  QXmlStreamWriter xml_writer(&data);
+  xml_writer.setAutoFormatting(true);
+  xml_writer.writeStartDocument("1.0");
+  xml_writer.writeDTD("<!DOCTYPE html>");
+
+  xml_writer.writeStartElement("html");
+  xml_writer.writeAttribute("xmlns", HTML_XMLNS);
+  xml_writer.writeAttribute("xmlns:epub", OPS_NAMESPACE);
+  xml_writer.writeStartElement("head");
+  xml_writer.writeTextElement("title", tr("Contents"));
+  xml_writer.writeEndElement();
+
+  xml_writer.writeStartElement("body");
+  xml_writer.writeStartElement("nav");
+  xml_writer.writeAttribute("epub:type", "toc");
+  xml_writer.writeTextElement("h1", tr("Contents"));
+  xml_writer.writeStartElement("ol");
+  for (int i = 0; i < content.chapters.size(); i++) {
+    const EBookContentChapter& chapter = content.chapters.at(i);
+    xml_writer.writeStartElement("li");
+    xml_writer.writeStartElement("a");
+    xml_writer.writeAttribute("href", chapter.href);
+    xml_writer.writeCharacters(chapter.title.isEmpty()
+                                 ? tr("Chapter %1").arg(i + 1)
+                                 : chapter.title);
+    xml_writer.writeEndElement();
+    xml_writer.writeEndElement();
+  }
+  xml_writer.writeEndElement();
+  xml_writer.writeEndElement();
+  xml_writer.writeEndElement();
 
   xml_writer.writeEndElement();
   xml_writer.writeEndDocument();
+  return data;
+}
 
-  package_file.close();
+QByteArray
+EPubContainer::htmlItemData(SharedManifestItem item)
+{
+  /* We have to build the text ourselves rather than use QXmlStreamWriter
+   * because the xml stream escapes '<', '>' and several other characters.
+   * The whole document is built in one buffer and converted to UTF-8 once
+   * rather than going through many small stream writes. */
+  QString document = documentString(item, false);
+  QString out;
+  out.reserve(document.size() + 1024);
+  // the declaration and doctype must come before the root element.
+  out += XML_HEADER;
+  out += QLatin1Char('\n');
+  out += HTML_DOCTYPE;
+  out += QLatin1Char('\n');
+  out += QStringLiteral("<html xmlns=\"");
+  out += HTML_XMLNS;
+  out += QStringLiteral("\">\n");
+  out += QStringLiteral("<head>\n");
+  out += QStringLiteral("<title>");
+  OrderedTitleMap titles = m_metadata->orderedTitles();
+  if (!titles.isEmpty() && !titles.first().isNull()) {
+    out += titles.first()->title.toHtmlEscaped();
+  }
+  out += QStringLiteral("</title>\n");
+  out += QStringLiteral("<meta http-equiv=\"Content-Type\" "
+                        "content=\"text/html; charset=utf-8\"/>\n");
+  foreach (QString href, item->css_links) {
+    out += QStringLiteral("<link href=\"");
+    out += href.toHtmlEscaped();
+    out += QStringLiteral("\" rel=\"stylesheet\" type=\"text/css\"/>\n");
+  }
+  out += QStringLiteral("</head>\n");
+  out += QStringLiteral("<body");
+  if (!item->body_class.isEmpty()) {
+    out += QStringLiteral(" class=\"");
+    out += item->body_class.toHtmlEscaped();
+    out += QStringLiteral("\">\n");
+  } else {
+    out += QStringLiteral(">\n");
+  }
+  out += document;
+  out += QStringLiteral("</body>\n");
+  out += QStringLiteral("</html>\n");
 
-  // TODO - the rest of the saves.
-  return true;
+  return out.toUtf8();
 }
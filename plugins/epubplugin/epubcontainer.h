@@ -1,7 +1,11 @@
 #ifndef EPUBCONTAINER_H
 #define EPUBCONTAINER_H
 
+#include <QCache>
 #include <QDomNode>
+#include <QFile>
+#include <QFutureInterface>
+#include <QFutureWatcher>
 #include <QHash>
 #include <QList>
 #include <QMap>
@@ -14,14 +18,22 @@
 #include <QStringLiteral>
 #include <QTextStream>
 #include <QVector>
+#include <QXmlStreamReader>
 #include <QtSvg>
 
 #include <quazip5/quazip.h>
 #include <quazip5/quazipfile.h>
+#include <quazip5/unzip.h>
 
 #include "authors.h"
 #include "dcterms.h"
 #include "ebookcommon.h"
+#include "ebookcomparison.h"
+#include "ebookcontent.h"
+#include "ebookimagecache.h"
+#include "ebookstringpool.h"
+#include "ebooktoc.h"
+#include "iebookdocument.h"
 #include "foaf.h"
 #include "library.h"
 #include "marcrelator.h"
@@ -68,6 +80,9 @@ struct EPubManifestItem
   QString path;
   //  SharedDomDocument dom_document;
   QString document_string;
+  // the qCompress()ed UTF-8 of document_string, kept while the chapter is
+  // not in use and document_string is empty, see EPubContainer.
+  QByteArray compressed_document;
   QStringList css_links;
   QString body_class;
   // these should point to the start and end of each chapter block;
@@ -79,11 +94,54 @@ struct EPubManifestItem
   QString fallback;
   QString media_overlay;
   QMap<QString, QString> non_standard_properties;
+  // the EPubManifest::Category bits of the item.
+  quint16 categories = 0;
+  // true once the entry has been decompressed and its data cached.
+  bool loaded = false;
+  // true if the document has been changed since it was loaded or saved.
+  bool modified = false;
 };
 typedef QSharedPointer<EPubManifestItem> SharedManifestItem;
-typedef QMap<QString, SharedManifestItem> SharedManifestItemMap;
 typedef QList<SharedManifestItem> SharedManifestItemList;
 
+// character offsets of the sections of an html document, any sections that
+// are not found are set to -1.
+struct EPubHtmlSections
+{
+  int head_start = -1;     // first character after <head>
+  int head_end = -1;       // the '<' of </head>
+  int body_tag_start = -1; // the '<' of <body>
+  int body_start = -1;     // first character after <body ...>
+  int body_end = -1;       // the '<' of </body>
+};
+
+// an anchor found in an html document by buildTocfromHtml().
+struct EPubTocAnchor
+{
+  QString file;
+  QString fragment;
+  QString text;
+  bool has_fragment = false;
+};
+
+// anchor points to be added to an html item, each is the offset in its
+// document and the anchor id.
+struct EPubAnchorBatch
+{
+  QString key;
+  QString document;
+  QList<QPair<int, QString>> anchors;
+};
+
+// decoded entry data, built on a worker thread and then merged back into the
+// manifest on the thread that owns the container.
+struct EPubLoadedItem
+{
+  SharedManifestItem item;
+  QByteArray data;
+  QString text;
+};
+
 class EPubTocItem;
 typedef QSharedPointer<EPubTocItem> SharedTocItem;
 typedef QMap<int, SharedTocItem> SharedTocItemMap;
@@ -100,28 +158,64 @@ public:
   QString chapter_tag;
 };
 
+/*!
+ * \brief The manifest items of a book, each stored once in package order.
+ *
+ * The media type and property groups that items belong to are the bits of
+ * EPubManifestItem::categories. Items are found by id, href or archive
+ * path through hash indexes into the item vector, and contains() checks
+ * the category bit of the item found, so every lookup is O(1). Listing a
+ * category walks the vector in package order.
+ */
 class EPubManifest
 {
 public:
+  enum Category
+  {
+    HTML = 0x0001,
+    IMAGE = 0x0002, // gif, jpeg and png, not svg.
+    SVG = 0x0004,   // svg images and xhtml with the svg property.
+    CSS = 0x0008,
+    JAVASCRIPT = 0x0010,
+    FONT = 0x0020,
+    MATHML = 0x0040,
+    SWITCH = 0x0080,
+    REMOTE = 0x0100,
+    SCRIPTED = 0x0200,
+    MEDIA_OVERLAY = 0x0400,
+    ALL = 0xffff,
+  };
+
+  void insert(SharedManifestItem item);
+  void clear();
+  int size() const { return m_items.size(); }
+  const QVector<SharedManifestItem>& items() const { return m_items; }
+  SharedManifestItemList items(int categories) const;
+  QStringList ids(int categories = ALL) const;
+  QStringList hrefs(int categories = ALL) const;
+
+  bool contains(const QString& id, int categories = ALL) const;
+  SharedManifestItem item(const QString& id, int categories = ALL) const;
+  SharedManifestItem itemByHref(const QString& href) const;
+  SharedManifestItem itemByPath(const QString& path) const;
+
   QString id;
   SharedManifestItem cover_image; // 0 or 1
   SharedManifestItem nav;         // 1
-  SharedManifestItemMap items;    // all items
-  SharedManifestItemList html_items;
-  SharedManifestItemMap mathml;              // subset of items for math markup
-  SharedManifestItemMap svg_images;          // subset of items for images
-  QMap<QString, QImage> rendered_svg_images; // rendered svg images
-  QMap<QString, QImage> images;
-  SharedManifestItemMap remotes;
-  SharedManifestItemMap scripted;
-  SharedManifestItemMap switches;
-  QMap<QString, QString> css;          // all items
-  QMap<QString, QString> javascript;   // all items
-  SharedManifestItemMap fonts;         // all items
-  SharedManifestItemMap media_overlay; // all items
-  QString formatted_toc_string;
+  // the loaded data of the lazily loaded resources.
+  QHash<QString, QByteArray> image_data; // compressed image and svg data.
+  QHash<QString, QString> css;           // keyed on href
+  QHash<QString, QString> javascript;    // keyed on id
+  QString toc_title;
+  QList<int> toc_roots; // play order of the top level toc items.
   SharedTocItemMap toc_items;
   SharedTocItemPathMap toc_paths;
+
+protected:
+  QVector<SharedManifestItem> m_items;
+  QHash<QString, int> m_by_id;
+  QHash<QString, int> m_by_href;
+  QHash<QString, int> m_by_path;
 };
 
 class EPubSpineItem
@@ -187,90 +281,94 @@ public:
   QString title;
   QString href;
 
-  static GuideType fromString(QString type)
-  {
-    if (type == "cover") {
-      return GuideType::cover;
-    } else if (type == "title-page") {
-      return GuideType::title_page;
-    } else if (type == "toc") {
-      return GuideType::toc;
-    } else if (type == "index") {
-      return GuideType::index;
-    } else if (type == "glossary") {
-      return GuideType::glossary;
-    } else if (type == "acknowledgements") {
-      return GuideType::acknowledgements;
-    } else if (type == "bibliography") {
-      return GuideType::bibliography;
-    } else if (type == "colophon") {
-      return GuideType::colophon;
-    } else if (type == "copyright-page") {
-      return GuideType::copyright_page;
-    } else if (type == "dedication") {
-      return GuideType::dedication;
-    } else if (type == "epigraph") {
-      return GuideType::epigraph;
-    } else if (type == "foreword") {
-      return GuideType::foreword;
-    } else if (type == "loi") { // list of illustrations
-      return GuideType::loi;
-    } else if (type == "lot") { // list of tables
-      return GuideType::lot;
-    } else if (type == "notes") {
-      return GuideType::notes;
-    } else if (type == "preface") {
-      return GuideType::preface;
-    } else {
-      /*if (type == "text") { */
-      return GuideType::text;
-    }
-  }
-
-  static QString toString(GuideType type)
-  {
-    switch (type) {
-      case cover:
-        return "cover";
-      case title_page:
-        return "title-page";
-      case toc:
-        return "toc";
-      case index:
-        return "index";
-      case glossary:
-        return "glossary";
-      case acknowledgements:
-        return "acknowledgements";
-      case bibliography:
-        return "bibliography";
-      case colophon:
-        return "colophon";
-      case copyright_page:
-        return "copyright-page";
-      case dedication:
-        return "dedication";
-      case epigraph:
-        return "epigraph";
-      case foreword:
-        return "foreword";
-      case loi:
-        return "loi";
-      case lot:
-        return "lot";
-      case notes:
-        return "notes";
-      case preface:
-        return "preface";
-      case text:
-        return "text";
-    }
-  }
+  static GuideType fromString(QString type);
+  static QString toString(GuideType type);
 };
 typedef QSharedPointer<EPubGuideItem> SharedGuideItem;
 typedef QMap<QString, SharedGuideItem> SharedGuideItemMap;
 typedef QStringList GuideItemList;
 
+struct EPubArchiveEntry
+{
+  unz64_file_pos position; // the central directory position.
+  qint64 data_offset = -1; // file offset of a stored entry's data, else -1.
+  qint64 size = 0;         // the size of a stored entry.
+  quint32 crc = 0;         // the CRC-32 of the uncompressed data.
+  qint64 uncompressed_size = 0;
+};
+//! The archive entries keyed by path.
+typedef QHash<QString, EPubArchiveEntry> EPubEntryIndex;
+
+// an @font-face rule of a stylesheet, see EPubContainer::registerFonts().
+struct EPubFontFace
+{
+  QString family;      // folded to lower case.
+  QStringList sources; // the urls of the src descriptor.
+};
+
+struct EPubSaveEntry
+{
+  QString path;
+  QString media_type;
+  QByteArray data; // the new data if not copied raw.
+  bool raw = true; // copied raw from the source archive.
+};
+
+/*!
+ * \brief Everything needed to write a book, independent of the container.
+ */
+struct EPubSaveSnapshot
+{
+  QString source_path;
+  QString save_path;
+  EPubEntryIndex index;
+  QList<EPubSaveEntry> entries; // in archive order.
+  QMap<QString, QString> documents; // id -> saved document of edited items.
+  bool package_written = false; // false if the package is copied raw.
+  QString metadata; // the metadataChildren() written to the package.
+  int compression_level = 6;
+};
+
+// a manifest item as it was when an EPubBookSnapshot was taken.
+struct EPubSnapshotItem
+{
+  QString id;
+  QString href;
+  QString path;
+  QByteArray media_type;
+  QStringList properties;
+  quint16 categories = 0; // the EPubManifest::Category bits.
+};
+
+/*!
+ * \brief An immutable copy of a book at one edit version of its container.
+ *
+ * Everything is held by value in implicitly shared Qt types, so taking a
+ * snapshot copies no text and a snapshot can be read from any thread while
+ * the container goes on being edited. Only the chapters that were loaded
+ * when it was taken have their documents.
+ */
+struct EPubBookSnapshot
+{
+  quint64 version = 0; // see EPubContainer::editVersion().
+  QString filename;
+  QString unique_identifier;
+  QString title;
+  QStringList creators;
+  QString language;
+  QString metadata_xml; // the <metadata> element as it was read.
+  QStringList manifest; // the ids of the items in package order.
+  QHash<QString, EPubSnapshotItem> items; // keyed on id.
+  QStringList spine;                      // the spine idrefs in order.
+  QHash<QString, QString> documents;      // id -> chapter body.
+  // id -> compressed body of the chapters that were not in use.
+  QHash<QString, QByteArray> compressed_documents;
+  QHash<QString, QString> css; // keyed on href.
+
+  QString document(const QString& id) const;
+};
+typedef QSharedPointer<const EPubBookSnapshot> SharedBookSnapshot;
+
 class EPubContainer : public QObject
 {
   Q_OBJECT
@@ -279,13 +377,48 @@ public:
   ~EPubContainer();
 
   bool loadFile(const QString path);
+  bool loadMetadata(const QString path);
+  static QImage extractCover(const QString& path, QSize image_size = QSize());
   QString filename();
   void setFilename(QString filename);
+  bool reopenFile(const QString& filename);
   bool saveFile(const QString& filepath = QString());
+  bool saveFileVerified(const QString& filepath, QStringList& problems);
+  bool saveFileAsync(const QString& filepath = QString());
+  bool isSaving() const;
+  bool saveMetadata();
+  bool writeMetadata(const EBookMetadataEdit& edit);
+  bool hasModifiedItems() const;
+  bool waitForSave();
   bool closeFile();
+  bool lazyLoading() const;
+  void setLazyLoading(bool lazy_loading);
+  bool loadAllItems();
+  bool verify(QStringList& problems);
+  bool readContent(EBookContent& content);
+  static bool writeContent(const EBookContent& content,
+                           const QString& path,
+                           int compression_level = DEFAULT_COMPRESSION_LEVEL);
+  static bool compareFiles(const QString& original,
+                           const QString& changed,
+                           EBookComparison& comparison);
   //  QByteArray epubItem(const QString& id) const;
   //  QSharedPointer<QuaZipFile> zipFile(const QString& path);
   QImage image(const QString& id, QSize image_size = QSize());
+  QImage cachedImage(const QString& id, QSize image_size);
+  QImage closestImage(const QString& id, QSize image_size);
+  void prepareImage(const QString& id, QSize image_size);
+  QImage coverImage(QSize image_size = QSize());
+  QIODevice* itemDevice(const QString& id, QObject* parent = nullptr);
+  void registerFonts(const QString& chapter_id);
+  int imageCacheSize() const;
+  void setImageCacheSize(int megabytes);
+  EBookMemoryUsage memoryUsage() const;
+  int compressionLevel() const;
+  void setCompressionLevel(int level);
+  QString parseCacheDirectory() const;
+  void setParseCacheDirectory(const QString& directory);
+  bool writeParseCache();
   // metadata is stored in a QMultiHash to allow multiple values
   // of a key. eg. there might be more than one "creator" tag.
   QStringList itemKeys();
@@ -293,20 +426,36 @@ public:
   QString css(QString key);
   QString javascript(QString key);
   QString itemDocument(QString key);
+  void setItemDocument(QString key, QString document);
+  void prefetchItems(const QStringList& keys);
+  bool isPrefetching() const;
+  void unloadItem(const QString& key);
+  static QByteArray compressDocument(const QString& document);
+  static QString uncompressDocument(const QByteArray& compressed);
+  quint64 editVersion() const;
+  void markChanged();
+  SharedBookSnapshot snapshot();
   QStringList spineKeys();
   QStringList imageKeys();
   QStringList cssKeys();
   QStringList jsKeys();
   QString tocAsString();
+  EBookToc toc();
   QStringList creators();
+  QString language();
 
   Metadata metadata();
   EPubManifest manifest();
 
-  QString buildTocfromHtml();
+  EBookToc buildTocfromHtml(QStringList* changed_keys = nullptr);
 
 signals:
   void errorHappened(const QString& error);
+  void imageRendered(const QString& id,
+                     QSize image_size,
+                     const QImage& image);
+  void saveProgress(int value, int total);
+  void saveFinished(bool success);
 
 public slots:
 
@@ -329,19 +478,102 @@ protected:
   EBookAuthorsDB* m_authors;
 
   bool parseMimetype();
-  bool writeMimetype(QuaZip* save_zip);
   bool parseContainer();
-  bool writeContainer(QuaZip* save_zip);
+  QByteArray containerData();
   bool parsePackageFile(QString& full_path);
-  bool writePackageFile(QuaZip* save_zip);
-
-  bool parseManifestItem(const QDomNode& manifest_node,
+  void parsePackageContent(const QString& content, const QString& full_path);
+  void parsePackageAttributes(const QXmlStreamAttributes& attributes);
+  void parseMetadataXml(const QString& metadata_xml);
+  QString metadataChildren();
+  QByteArray metadataPackageData(const QString& children);
+  static bool replaceMetadataChildren(QString& document,
+                                      const QString& children);
+  QByteArray htmlItemData(SharedManifestItem item);
+  bool createSaveSnapshot(const QString& filepath, EPubSaveSnapshot& snapshot);
+  static bool writeSnapshot(const EPubSaveSnapshot& snapshot,
+                            QFutureInterface<bool>* progress);
+  bool finishSave(const EPubSaveSnapshot& snapshot);
+  static bool replaceFile(const QString& from, const QString& to);
+  bool reopenArchive();
+  static bool appendPackageEntry(const QString& filename,
+                                 const QString& path,
+                                 const QByteArray& data,
+                                 const QByteArray& compressed,
+                                 quint32 crc);
+  static quint16 readUInt16(const QByteArray& data, int offset);
+  static quint32 readUInt32(const QByteArray& data, int offset);
+  static void appendUInt16(QByteArray& data, quint16 value);
+  static void appendUInt32(QByteArray& data, quint32 value);
+  bool saveThreadFinished();
+  static bool copyRawEntry(QuaZip* source_zip,
+                           QuaZip* save_zip,
+                           const EPubEntryIndex& index,
+                           const QString& path);
+  static bool writeEntry(QuaZip* save_zip,
+                         const QString& path,
+                         const QString& media_type,
+                         const QByteArray& data,
+                         int compression_level);
+  static bool isPrecompressedMediaType(const QString& media_type);
+  static QByteArray contentContainerData();
+  static QByteArray contentPackageData(const EBookContent& content,
+                                       const QString& nav_href);
+  static QByteArray contentNavData(const EBookContent& content);
+  static bool readCentralDirectory(const QString& filename,
+                                   QStringList& files,
+                                   EPubEntryIndex& index);
+  static EBookEntryDifferenceList diffEntryChunk(
+    const QString& original,
+    const EPubEntryIndex& original_index,
+    const QString& changed,
+    const EPubEntryIndex& changed_index,
+    const QStringList& chunk);
+  static bool readEntry(QuaZip* archive,
+                        const EPubEntryIndex& index,
+                        const QString& path,
+                        QByteArray& data);
+  static bool isTextEntry(const QString& path);
+  bool registerFont(SharedManifestItem font);
+  void readEncryption();
+  QString uniqueIdentifier() const;
+  static QList<EPubFontFace> fontFaces(const QString& css);
+  static QSet<QString> fontFamilies(const QString& text);
+  static QString fontFamilyName(const QString& family);
+  void describeChapters(EBookEntryDifferenceList& differences,
+                        bool removed);
+
+  bool readParseCache();
+  void indexManifestItem(SharedManifestItem item);
+  bool parseManifestItem(const QXmlStreamAttributes& attributes,
                          const QString current_folder);
+  bool loadManifestItem(SharedManifestItem item);
+  bool loadItemsParallel(SharedManifestItemList items);
+  QList<EPubLoadedItem> loadItemChunk(const QString& filename,
+                                      SharedManifestItemList chunk);
+  void prefetchThreadFinished();
+  void waitForPrefetch();
+  bool isCachedItem(SharedManifestItem item) const;
+  bool mapArchive();
+  bool buildEntryIndex();
+  bool mappedEntry(const QString& path, QByteArray& data) const;
+  bool setCurrentEntry(QuaZip* archive, const QString& path) const;
+  static bool goToEntry(QuaZip* archive,
+                        const EPubEntryIndex& index,
+                        const QString& path);
+  bool readArchiveEntry(QuaZip* archive,
+                        const QString& path,
+                        QByteArray& data);
+  EPubLoadedItem decodeManifestItem(SharedManifestItem item,
+                                    const QByteArray& data);
+  void storeManifestItem(const EPubLoadedItem& loaded);
+  void parseHtmlItem(SharedManifestItem item, const QByteArray& data);
+  QByteArray sharedResource(SharedManifestItem item,
+                            const QByteArray& data) const;
+  static EPubHtmlSections scanHtmlSections(const QString& document);
   void extractHeadInformationFromHtmlFile(SharedManifestItem item,
                                           QString container);
 
-  SharedSpineItem parseSpineItem(const QDomNode& metadata_element,
-                                 SharedSpineItem item);
+  SharedSpineItem parseSpineItem(const QXmlStreamAttributes& attributes);
   bool saveSpineItem();
   bool parseTocFile();
   bool parseGuideItem(const QDomNode& guideItem);
@@ -351,10 +583,34 @@ protected:
   bool saveBindingsItem();
 
   const QuaZip* getFile(const QString& path);
+  static QImage renderSvg(QByteArray data, QSize image_size);
+  QImage guideCover(QSize image_size);
 
   QuaZip* m_archive = nullptr;
+  bool m_lazy_loading;
+  int m_compression_level; // deflate level for text entries.
+  QFutureWatcher<bool>* m_save_watcher = nullptr;
+  QSharedPointer<EPubSaveSnapshot> m_save_snapshot;
+  QFutureWatcher<QList<EPubLoadedItem>>* m_prefetch_watcher = nullptr;
+  QStringList m_prefetch_queue; // requested while a prefetch was running.
+  QString m_parse_cache_directory;
+  bool m_parse_cache_dirty = false; // the parse cache needs rewriting.
+  bool m_metadata_only = false;      // stop after the package metadata.
+  bool m_cover_only = false; // only the metadata, manifest and guide.
+  QString m_guide_cover;     // the href of the guide's cover reference.
+  QString m_metadata_xml; // the <metadata> element in a <package> wrapper.
+  QString m_written_metadata; // metadataChildren() as the file has them.
+  EBookImageCache m_image_cache; // decoded images and svgs.
+  QSet<QString> m_pending_images; // keys being decoded or rendered.
   QString m_filename;
   QStringList m_files;
+  EPubEntryIndex m_entry_index;
+  QFile m_mapped_file;
+  uchar* m_mapped_data = nullptr;
+  qint64 m_mapped_size = 0;
+  // path -> algorithm of the entries in encryption.xml, see readEncryption().
+  QHash<QString, QString> m_encrypted_entries;
+  bool m_encryption_read = false;
 
   // metadata/manifest/spine etc.
   QByteArray m_mimetype;
@@ -362,43 +618,93 @@ protected:
   EPubManifest m_manifest;
   EPubSpine m_spine;
 
-  // might be more than one root content file.
-  QMap<QString, QMap<QString, DomDocument>> m_rootfiles;
-  QMap<QString, DomDocument> m_current_rootfile;
   // a map of dom elements within the  that might be modified.
   QMap<QString, QDomElement*> m_metadata_nodes;
   int m_toc_chapter_index;
 
-  SharedTocItem parseNavPoint(QDomElement navpoint,
-                              QString& formatted_toc_data);
-
-  void createAnchorPointForChapter(SharedTocItem toc_item,
-                                   SharedManifestItem manifest_item);
+  // made from the toc items when it is first asked for.
+  EBookToc m_toc;
+
+  // bumped by every change, the snapshot is kept until the next one.
+  quint64 m_edit_version = 0;
+  SharedBookSnapshot m_snapshot;
+
+  // the ids of the chapters held uncompressed, most recently used first.
+  QStringList m_hot_documents;
+  QString documentString(SharedManifestItem item, bool keep = true);
+  void touchDocument(SharedManifestItem item);
+  void releaseDocument(SharedManifestItem item);
+
+  void parseNcxDocument(QXmlStreamReader& reader);
+  void parseNavDocument(QXmlStreamReader& reader);
+  void setTocItemSource(SharedTocItem toc_item, const QString& link);
+  void addTocItem(SharedTocItem toc_item, SharedTocItem parent);
+  static SharedTocEntry tocEntry(SharedTocItem toc_item);
+  static SharedTocEntry builtTocEntry(const QString& file,
+                                      const QString& fragment,
+                                      const QString& label);
+
+  QStringList insertAnchorPoints(const QList<EPubAnchorBatch>& batches);
+  static QString insertAnchors(const EPubAnchorBatch& batch);
   //  void createChapterAnchorPoints(SharedSpineItem spine_item);
-  void handleSubNavpoints(QDomElement navpoint, QString& formatted_toc_string);
-  QString extractTagText(int anchor_start, QString document_string);
-
+  static QList<EPubTocAnchor> extractAnchors(const QString& document);
+
+  static const int DEFAULT_IMAGE_CACHE_SIZE = 256; // MB
+  static const int DEFAULT_COMPRESSION_LEVEL = 6;
+  // the chapter shown, its neighbours and one being paginated.
+  static const int HOT_DOCUMENTS = 4;
+  static const int DOCUMENT_COMPRESSION_LEVEL = 1;
+  static const int COPY_CHUNK_SIZE = 1024 * 1024;
+  // zip record signatures and fixed sizes, see appendPackageEntry().
+  static const quint32 ZIP_LFH_SIGNATURE = 0x04034b50;
+  static const quint32 ZIP_CDFH_SIGNATURE = 0x02014b50;
+  static const quint32 ZIP_EOCD_SIGNATURE = 0x06054b50;
+  static const int ZIP_CDFH_SIZE = 46;
+  static const int ZIP_EOCD_SIZE = 22;
+  // readers search this far back from the end for the end record.
+  static const int ZIP_EOCD_SEARCH = ZIP_EOCD_SIZE + 0xFFFF;
+  static const int ZIP_COPY_CHUNK = 1024 * 1024;
   static const QString MIMETYPE_FILE;
   static const QByteArray MIMETYPE;
   static const QString METADATA_FOLDER;
   static const QString CONTAINER_FILE;
+  static const QString ENCRYPTION_FILE;
   static const QString TOC_FILE;
+  // where writeContent() puts the book.
+  static const QString CONTENT_FOLDER;
+  static const QString CONTENT_PACKAGE_FILE;
+
+  // the media types that are dispatched on, interned.
+  static const QByteArray GIF_TYPE;
+  static const QByteArray JPEG_TYPE;
+  static const QByteArray PNG_TYPE;
+  static const QByteArray SVG_TYPE;
+  static const QByteArray XHTML_TYPE;
+  static const QByteArray CSS_TYPE;
+  static const QByteArray JAVASCRIPT_TYPE;
+  static const QByteArray OPENTYPE_TYPE;
+  static const QByteArray WOFF_TYPE;
+
+  // manifest media types are interned, so this nearly always compares
+  // pointers.
+  static bool isType(SharedManifestItem item, const QByteArray& type)
+  {
+    return EBookStringPool::same(item->media_type, type);
+  }
 
   static const QString TITLE;
   static const QString CREATOR;
   static const QString IDENTIFIER;
   static const QString LANGUAGE;
 
-  static const QString TOC_TITLE;
-  static const QString LIST_START;
-  static const QString LIST_END;
-  static const QString LIST_ITEM;
-  static const QString LIST_BUILD_ITEM;
+  static const QString OPS_NAMESPACE;
   static const QString LIST_FILEPOS;
+  static const QString ANCHOR_POINT;
 
   static const QString HTML_DOCTYPE;
   static const QString XML_HEADER;
   static const QString HTML_XMLNS;
+  static const QString PACKAGE_WRAPPER;
   //  static const QString HEAD_META_CONTENT;
 };
 
@@ -29,7 +29,7 @@ EPubDocument::EPubDocument(EPubDocumentPrivate& d)
   : ITextDocument(d.q_ptr)
 {}
 
-QString
+EBookToc
 EPubDocument::buildTocFromData()
 {
   Q_D(EPubDocument);
@@ -59,6 +59,17 @@ EPubDocument::openDocument(const QString& path)
   d->openDocument(path);
 }
 
+/*!
+ * \brief Opens a book that has already been loaded into a container, on
+ * another thread for instance. The document takes the container.
+ */
+void
+EPubDocument::openParsedDocument(EPubContainer* container)
+{
+  Q_D(EPubDocument);
+  d->openParsedDocument(container);
+}
+
 void
 EPubDocument::saveDocument(const QString& path)
 {
@@ -96,6 +107,13 @@ EPubDocument::setFilename(const QString& filename)
 
 QString
 EPubDocument::tocAsString()
+{
+  Q_D(EPubDocument);
+  return d->toc().toHtml();
+}
+
+EBookToc
+EPubDocument::toc()
 {
   Q_D(EPubDocument);
   return d->toc();
@@ -133,8 +151,7 @@ QString
 EPubDocument::language()
 {
   Q_D(EPubDocument);
-  // TODO
-  return QString();
+  return d->language();
 }
 
 void
@@ -191,6 +208,168 @@ EPubDocument::setPublisher(const QString& publisher)
   d->setPublisher(publisher);
 }
 
+void
+EPubDocument::setImageCacheSize(int megabytes)
+{
+  Q_D(EPubDocument);
+  d->setImageCacheSize(megabytes);
+}
+
+EBookMemoryUsage
+EPubDocument::memoryUsage()
+{
+  Q_D(EPubDocument);
+  return d->memoryUsage();
+}
+
+void
+EPubDocument::setImageZoom(qreal zoom)
+{
+  Q_D(EPubDocument);
+  d->setImageZoom(zoom);
+}
+
+void
+EPubDocument::setPageLayoutSize(const QSizeF& size)
+{
+  Q_D(EPubDocument);
+  d->setPageLayoutSize(size);
+}
+
+int
+EPubDocument::chapterPageCount(int index)
+{
+  Q_D(EPubDocument);
+  return d->chapterPageCount(index);
+}
+
+int
+EPubDocument::pagePosition(int index, int page)
+{
+  Q_D(EPubDocument);
+  return d->pagePosition(index, page);
+}
+
+void
+EPubDocument::setCompressionLevel(int level)
+{
+  Q_D(EPubDocument);
+  d->setCompressionLevel(level);
+}
+
+void
+EPubDocument::setParseCacheDirectory(const QString& directory)
+{
+  Q_D(EPubDocument);
+  d->setParseCacheDirectory(directory);
+}
+
+/*!
+ * \brief The position in the spine of the chapter that is loaded into the
+ * document.
+ */
+int
+EPubDocument::currentChapter()
+{
+  Q_D(EPubDocument);
+  return d->currentChapter();
+}
+
+int
+EPubDocument::chapterCount()
+{
+  Q_D(EPubDocument);
+  return d->chapterCount();
+}
+
+/*!
+ * \brief Replaces the document contents with another chapter.
+ *
+ * The chapters either side of it are prepared in the background.
+ */
+bool
+EPubDocument::setCurrentChapter(int index)
+{
+  Q_D(EPubDocument);
+  return d->setCurrentChapter(index);
+}
+
+/*!
+ * \brief Replaces the document contents with the chapter that has the spine
+ * idref id, as stored in the search index.
+ */
+bool
+EPubDocument::showChapter(const QString& id)
+{
+  Q_D(EPubDocument);
+  return d->showChapter(id);
+}
+
+/*!
+ * \brief The position in the spine of the chapter with the file href, so
+ * that a table of contents link can move to another chapter.
+ */
+int
+EPubDocument::chapterOfHref(const QString& href)
+{
+  Q_D(EPubDocument);
+  return d->chapterOfHref(href);
+}
+
+/*!
+ * \brief The body of the spine item shown, its document_string.
+ */
+QString
+EPubDocument::chapterSource()
+{
+  Q_D(EPubDocument);
+  return d->chapterSource();
+}
+
+/*!
+ * \brief The body of any spine item, read without loading it into the
+ * document.
+ */
+QString
+EPubDocument::chapterSourceAt(int index)
+{
+  Q_D(EPubDocument);
+  return d->chapterSourceAt(index);
+}
+
+/*!
+ * \brief Replaces the body of a spine item, marking the book modified.
+ */
+bool
+EPubDocument::setChapterSource(int index, const QString& source)
+{
+  Q_D(EPubDocument);
+  return d->setChapterSource(index, source);
+}
+
+bool
+EPubDocument::reloadChapter()
+{
+  Q_D(EPubDocument);
+  return d->reloadChapter();
+}
+
+/*!
+ * \brief Images and stylesheets are read from the epub on demand.
+ *
+ * Anything that the book does not hold is passed on to QTextDocument.
+ */
+QVariant
+EPubDocument::loadResource(int type, const QUrl& name)
+{
+  Q_D(EPubDocument);
+  QVariant resource = d->loadResource(type, name);
+  if (resource.isValid()) {
+    return resource;
+  }
+  return ITextDocument::loadResource(type, name);
+}
+
 Metadata
 EPubDocument::metadata()
 {
@@ -198,6 +377,17 @@ EPubDocument::metadata()
   return d->metadata();
 }
 
+/*!
+ * \brief An immutable copy of the book that background work can read while
+ * the book is edited, see EPubContainer::snapshot().
+ */
+SharedBookSnapshot
+EPubDocument::snapshot()
+{
+  Q_D(EPubDocument);
+  return d->snapshot();
+}
+
 IEBookInterface*
 EPubDocument::plugin()
 {
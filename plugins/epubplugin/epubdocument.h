@@ -50,6 +50,7 @@ public:
 
   bool loaded();
   void openDocument(const QString& path) override;
+  void openParsedDocument(EPubContainer* container);
   void saveDocument(const QString& path = QString()) override;
   //  void clearCache();
   EPubContents* cloneData();
@@ -60,13 +61,14 @@ public:
   void setFilename(const QString& filename) override;
 
   QString tocAsString() override;
+  EBookToc toc() override;
 
   // IEBookDocument interface
   IEBookInterface* plugin() override;
   void setPlugin(IEBookInterface* plugin) override;
   QDate published() override;
   void setPublished(const QDate& published) override;
-  QString buildTocFromData() override;
+  EBookToc buildTocFromData() override;
 
   EBookDocumentType type() const override { return EPUB; }
   bool isModified() override;
@@ -85,11 +87,32 @@ public:
   void setPublisher(const QString& publisher) override;
 
   Metadata metadata();
+  SharedBookSnapshot snapshot();
+  void setImageCacheSize(int megabytes);
+  void setCompressionLevel(int level);
+  void setParseCacheDirectory(const QString& directory);
+
+  int currentChapter() override;
+  int chapterCount() override;
+  bool setCurrentChapter(int index) override;
+  bool showChapter(const QString& id) override;
+  int chapterOfHref(const QString& href) override;
+  QString chapterSource() override;
+  QString chapterSourceAt(int index) override;
+  bool setChapterSource(int index, const QString& source) override;
+  bool reloadChapter() override;
+  EBookMemoryUsage memoryUsage() override;
+  void setImageZoom(qreal zoom) override;
+  void setPageLayoutSize(const QSizeF& size) override;
+  int chapterPageCount(int index) override;
+  int pagePosition(int index, int page) override;
 
 protected:
   EPubDocumentPrivate* d_ptr;
   EPubDocument(EPubDocumentPrivate& doc);
 
+  QVariant loadResource(int type, const QUrl& name) override;
+
   bool m_modified, m_readonly;
 
   // IEBookDocument interface
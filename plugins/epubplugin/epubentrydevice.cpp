@@ -0,0 +1,172 @@
+#include "epubentrydevice.h"
+
+#include <qlogger/qlogger.h>
+
+using namespace qlogger;
+
+EPubEntryDevice::EPubEntryDevice(const QString& archive,
+                                 const QString& path,
+                                 const EPubArchiveEntry& entry,
+                                 QObject* parent)
+  : QIODevice(parent)
+  , m_path(path)
+  , m_entry(entry)
+  , m_file(archive)
+  , m_zip(archive)
+  , m_zip_entry(&m_zip)
+{}
+
+EPubEntryDevice::~EPubEntryDevice()
+{
+  close();
+}
+
+/*!
+ * \brief Opens the entry, only QIODevice::ReadOnly is supported.
+ *
+ * The device is always unbuffered, the underlying file or inflater does
+ * its own buffering.
+ */
+bool
+EPubEntryDevice::open(OpenMode mode)
+{
+  if (mode & QIODevice::WriteOnly) {
+    QLOG_DEBUG(tr("%1 can only be opened for reading").arg(m_path));
+    return false;
+  }
+  if (!openEntry()) {
+    return false;
+  }
+  return QIODevice::open(mode | QIODevice::Unbuffered);
+}
+
+void
+EPubEntryDevice::close()
+{
+  if (!isOpen()) {
+    return;
+  }
+  QIODevice::close();
+  m_zip_entry.close();
+  m_zip.close();
+  m_file.close();
+}
+
+bool
+EPubEntryDevice::isSequential() const
+{
+  return false;
+}
+
+/*!
+ * \brief The uncompressed size of the entry.
+ */
+qint64
+EPubEntryDevice::size() const
+{
+  return m_entry.uncompressed_size;
+}
+
+bool
+EPubEntryDevice::seek(qint64 pos)
+{
+  if (!isOpen() || pos < 0 || pos > size() || !QIODevice::seek(pos)) {
+    return false;
+  }
+  if (stored()) {
+    return m_file.seek(m_entry.data_offset + pos);
+  }
+
+  if (pos < m_zip_entry.pos()) {
+    // inflated from the start again.
+    m_zip_entry.close();
+    if (!openEntry()) {
+      return false;
+    }
+  }
+  return skip(pos - m_zip_entry.pos());
+}
+
+qint64
+EPubEntryDevice::readData(char* data, qint64 maxlen)
+{
+  if (stored()) {
+    return m_file.read(data, qMin(maxlen, size() - pos()));
+  }
+  return m_zip_entry.read(data, maxlen);
+}
+
+qint64
+EPubEntryDevice::writeData(const char* /*data*/, qint64 /*len*/)
+{
+  return -1;
+}
+
+/*
+ * Only stored entries that the container found in its mapping have their
+ * data offset, anything else is read through QuaZip.
+ */
+bool
+EPubEntryDevice::stored() const
+{
+  return (m_entry.data_offset >= 0);
+}
+
+/*
+ * Opens the entry positioned at its start, uses the central directory
+ * position from the container's index so the archive is not searched.
+ */
+bool
+EPubEntryDevice::openEntry()
+{
+  if (stored()) {
+    if ((!m_file.isOpen() && !m_file.open(QIODevice::ReadOnly)) ||
+        !m_file.seek(m_entry.data_offset)) {
+      QLOG_DEBUG(tr("Unable to read %1 from %2")
+                   .arg(m_path)
+                   .arg(m_file.fileName()));
+      return false;
+    }
+    return true;
+  }
+
+  if (!m_zip.isOpen() && !m_zip.open(QuaZip::mdUnzip)) {
+    QLOG_DEBUG(tr("Failed to open %1 : error %2")
+                 .arg(m_zip.getZipName())
+                 .arg(m_zip.getZipError()));
+    return false;
+  }
+  // QuaZipFile will only open an entry once QuaZip has a current file.
+  unz64_file_pos position = m_entry.position;
+  if ((!m_zip.hasCurrentFile() && !m_zip.goToFirstFile()) ||
+      unzGoToFilePos64(m_zip.getUnzFile(), &position) != UNZ_OK) {
+    QLOG_DEBUG(tr("Unable to find %1 in archive").arg(m_path));
+    return false;
+  }
+  if (!m_zip_entry.open(QIODevice::ReadOnly)) {
+    QLOG_DEBUG(tr("Unable to open file %1 : error %2")
+                 .arg(m_path)
+                 .arg(m_zip.getZipError()));
+    return false;
+  }
+  return true;
+}
+
+/*
+ * Inflates and drops length bytes, a chunk at a time.
+ */
+bool
+EPubEntryDevice::skip(qint64 length)
+{
+  QByteArray chunk(CHUNK_SIZE, Qt::Uninitialized);
+  while (length > 0) {
+    qint64 read =
+      m_zip_entry.read(chunk.data(), qMin(length, qint64(CHUNK_SIZE)));
+    if (read <= 0) {
+      QLOG_DEBUG(tr("Unable to seek in %1").arg(m_path));
+      return false;
+    }
+    length -= read;
+  }
+  return true;
+}
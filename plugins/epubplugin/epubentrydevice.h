@@ -0,0 +1,59 @@
+#ifndef EPUBENTRYDEVICE_H
+#define EPUBENTRYDEVICE_H
+
+#include <QFile>
+#include <QIODevice>
+
+#include <quazip5/quazip.h>
+#include <quazip5/quazipfile.h>
+#include <quazip5/unzip.h>
+
+#include "epubcontainer.h"
+
+/*!
+ * \brief A read only, seekable device over a single entry of an epub.
+ *
+ * The entry is read as it is needed rather than all at once, so audio,
+ * video and other large entries can be played or previewed without
+ * holding them in memory, see EPubContainer::itemDevice().
+ *
+ * A stored entry is read straight from the archive file, so seeking is
+ * free. A deflated entry can only be inflated forwards, so seeking forward
+ * skips the data between and seeking backwards starts the entry again.
+ *
+ * The device opens its own handle on the archive, so it can be used on
+ * any one thread and outlives the container that created it.
+ */
+class EPubEntryDevice : public QIODevice
+{
+  Q_OBJECT
+public:
+  EPubEntryDevice(const QString& archive,
+                  const QString& path,
+                  const EPubArchiveEntry& entry,
+                  QObject* parent = nullptr);
+  ~EPubEntryDevice() override;
+
+  bool open(OpenMode mode) override;
+  void close() override;
+  bool isSequential() const override;
+  qint64 size() const override;
+  bool seek(qint64 pos) override;
+
+protected:
+  QString m_path;
+  EPubArchiveEntry m_entry;
+  QFile m_file;           // the archive, for a stored entry.
+  QuaZip m_zip;           // the archive, for a deflated entry.
+  QuaZipFile m_zip_entry; // the inflated entry.
+
+  qint64 readData(char* data, qint64 maxlen) override;
+  qint64 writeData(const char* data, qint64 len) override;
+  bool stored() const;
+  bool openEntry();
+  bool skip(qint64 length);
+
+  static const int CHUNK_SIZE = 64 * 1024;
+};
+
+#endif // EPUBENTRYDEVICE_H
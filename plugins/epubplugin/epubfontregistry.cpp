@@ -0,0 +1,238 @@
+#include "epubfontregistry.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFontDatabase>
+#include <QSaveFile>
+
+#include <qlogger/qlogger.h>
+
+using namespace qlogger;
+
+const QString EPubFontRegistry::IDPF_ALGORITHM =
+  "http://www.idpf.org/2008/embedding";
+const QString EPubFontRegistry::ADOBE_ALGORITHM =
+  "http://ns.adobe.com/pdf/enc#RC";
+const QString EPubFontRegistry::SUFFIX = ".font";
+
+EPubFontRegistry::EPubFontRegistry() {}
+
+EPubFontRegistry*
+EPubFontRegistry::instance()
+{
+  static EPubFontRegistry registry;
+  return &registry;
+}
+
+QString
+EPubFontRegistry::cacheDirectory() const
+{
+  return m_directory;
+}
+
+/*!
+ * \brief Sets the directory holding the deobfuscated fonts.
+ *
+ * If this is empty, the default, obfuscated fonts are deobfuscated every
+ * time they are registered.
+ */
+void
+EPubFontRegistry::setCacheDirectory(const QString& directory)
+{
+  m_directory = directory;
+}
+
+/*!
+ * \brief Adds owner to a font that is already registered.
+ *
+ * \return true if the font was registered, otherwise false and the font
+ *         must be read and passed to addFont().
+ */
+bool
+EPubFontRegistry::addOwner(const void* owner, const QByteArray& key)
+{
+  QHash<QByteArray, RegisteredFont>::iterator it = m_fonts.find(key);
+  if (it == m_fonts.end()) {
+    return false;
+  }
+  it.value().owners.insert(owner);
+  return true;
+}
+
+/*!
+ * \brief Registers a font with QFontDatabase for owner.
+ *
+ * \return the families of the font, empty if it could not be registered.
+ */
+QStringList
+EPubFontRegistry::addFont(const void* owner,
+                          const QByteArray& key,
+                          const QByteArray& data)
+{
+  if (addOwner(owner, key)) {
+    return QFontDatabase::applicationFontFamilies(m_fonts.value(key).id);
+  }
+  int id = QFontDatabase::addApplicationFontFromData(data);
+  if (id < 0) {
+    QLOG_DEBUG(
+      QString("Unable to register font %1").arg(QString(key.toHex())));
+    return QStringList();
+  }
+  RegisteredFont font;
+  font.id = id;
+  font.owners.insert(owner);
+  m_fonts.insert(key, font);
+  return QFontDatabase::applicationFontFamilies(id);
+}
+
+/*!
+ * \brief Releases all of the fonts of owner, removing those that no other
+ * owner is using from QFontDatabase.
+ */
+void
+EPubFontRegistry::releaseFonts(const void* owner)
+{
+  QHash<QByteArray, RegisteredFont>::iterator it = m_fonts.begin();
+  while (it != m_fonts.end()) {
+    it.value().owners.remove(owner);
+    if (it.value().owners.isEmpty()) {
+      QFontDatabase::removeApplicationFont(it.value().id);
+      it = m_fonts.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+/*!
+ * \brief Reads a deobfuscated font from the cache directory.
+ *
+ * \return true if the font was cached, otherwise false.
+ */
+bool
+EPubFontRegistry::cachedFont(const QByteArray& key, QByteArray& data) const
+{
+  if (m_directory.isEmpty()) {
+    return false;
+  }
+  QFile file(m_directory + QDir::separator() + QString(key.toHex()) + SUFFIX);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  data = file.readAll();
+  return !data.isEmpty();
+}
+
+/*!
+ * \brief Writes a deobfuscated font to the cache directory.
+ */
+void
+EPubFontRegistry::cacheFont(const QByteArray& key,
+                            const QByteArray& data) const
+{
+  if (m_directory.isEmpty()) {
+    return;
+  }
+  QDir().mkpath(m_directory);
+  // written whole or not at all, a partial font is never read back.
+  QSaveFile file(m_directory + QDir::separator() + QString(key.toHex()) +
+                 SUFFIX);
+  if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() ||
+      !file.commit()) {
+    QLOG_DEBUG(QString("Unable to cache font %1").arg(file.fileName()));
+  }
+}
+
+/*!
+ * \brief The key of a font, from the crc and size of its archive entry and
+ * the obfuscation that is undone.
+ *
+ * The crc is of the data as it is stored, so the same font obfuscated for
+ * two books has two keys.
+ */
+QByteArray
+EPubFontRegistry::fontKey(quint32 crc,
+                          qint64 size,
+                          Obfuscation obfuscation,
+                          const QByteArray& obfuscation_key)
+{
+  QByteArray data;
+  QDataStream stream(&data, QIODevice::WriteOnly);
+  stream << crc << size << qint32(obfuscation) << obfuscation_key;
+  return QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+}
+
+/*!
+ * \brief The obfuscation of an encryption.xml algorithm, NO_OBFUSCATION for
+ * real encryption, which cannot be undone.
+ */
+EPubFontRegistry::Obfuscation
+EPubFontRegistry::obfuscation(const QString& algorithm)
+{
+  if (algorithm == IDPF_ALGORITHM) {
+    return IDPF_OBFUSCATION;
+  } else if (algorithm == ADOBE_ALGORITHM) {
+    return ADOBE_OBFUSCATION;
+  }
+  return NO_OBFUSCATION;
+}
+
+/*!
+ * \brief The key that a font was obfuscated with, derived from the unique
+ * identifier of the book.
+ *
+ * The IDPF key is the SHA-1 of the identifier without any white space, the
+ * Adobe key is the 16 bytes of the identifier's uuid.
+ *
+ * \return the key, or an empty key if there is none.
+ */
+QByteArray
+EPubFontRegistry::obfuscationKey(Obfuscation obfuscation,
+                                 const QString& unique_identifier)
+{
+  if (obfuscation == IDPF_OBFUSCATION) {
+    QString identifier = unique_identifier;
+    identifier.remove(QChar(0x20))
+      .remove(QChar(0x09))
+      .remove(QChar(0x0d))
+      .remove(QChar(0x0a));
+    return QCryptographicHash::hash(identifier.toUtf8(),
+                                    QCryptographicHash::Sha1);
+
+  } else if (obfuscation == ADOBE_OBFUSCATION) {
+    QString uuid = unique_identifier.trimmed();
+    if (uuid.startsWith("urn:uuid:", Qt::CaseInsensitive)) {
+      uuid = uuid.mid(9);
+    }
+    uuid.remove('-');
+    QByteArray key = QByteArray::fromHex(uuid.toLatin1());
+    if (key.size() == 16) {
+      return key;
+    }
+  }
+  return QByteArray();
+}
+
+/*!
+ * \brief Undoes the obfuscation of a font, the start of the font is
+ * XORed with the key.
+ */
+QByteArray
+EPubFontRegistry::deobfuscate(const QByteArray& data,
+                              Obfuscation obfuscation,
+                              const QByteArray& obfuscation_key)
+{
+  if (obfuscation == NO_OBFUSCATION || obfuscation_key.isEmpty()) {
+    return data;
+  }
+  int length = (obfuscation == IDPF_OBFUSCATION ? IDPF_LENGTH : ADOBE_LENGTH);
+  QByteArray result = data;
+  char* bytes = result.data();
+  int key_size = obfuscation_key.size();
+  for (int i = 0; i < qMin(length, result.size()); i++) {
+    bytes[i] ^= obfuscation_key.at(i % key_size);
+  }
+  return result;
+}
@@ -0,0 +1,78 @@
+#ifndef EPUBFONTREGISTRY_H
+#define EPUBFONTREGISTRY_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+/*!
+ * \brief The embedded fonts of all open books that are registered with
+ * QFontDatabase.
+ *
+ * A font is keyed by a hash of its entry's crc and size and of the
+ * obfuscation undone, so a font shipped by more than one book is only
+ * registered once. Each book that uses a font is an owner of it, the font
+ * is removed from QFontDatabase once its last owner releases it.
+ *
+ * Fonts that were obfuscated are kept deobfuscated in the cache directory,
+ * so the obfuscation is only undone the first time the font is used.
+ *
+ * Fonts can only be registered on the gui thread.
+ */
+class EPubFontRegistry
+{
+public:
+  enum Obfuscation
+  {
+    NO_OBFUSCATION,
+    IDPF_OBFUSCATION,  // the IDPF font obfuscation of EPUB 3.
+    ADOBE_OBFUSCATION, // the older Adobe font mangling.
+  };
+
+  static EPubFontRegistry* instance();
+
+  QString cacheDirectory() const;
+  void setCacheDirectory(const QString& directory);
+
+  bool addOwner(const void* owner, const QByteArray& key);
+  QStringList addFont(const void* owner,
+                      const QByteArray& key,
+                      const QByteArray& data);
+  void releaseFonts(const void* owner);
+
+  bool cachedFont(const QByteArray& key, QByteArray& data) const;
+  void cacheFont(const QByteArray& key, const QByteArray& data) const;
+
+  static QByteArray fontKey(quint32 crc,
+                            qint64 size,
+                            Obfuscation obfuscation,
+                            const QByteArray& obfuscation_key);
+  static Obfuscation obfuscation(const QString& algorithm);
+  static QByteArray obfuscationKey(Obfuscation obfuscation,
+                                   const QString& unique_identifier);
+  static QByteArray deobfuscate(const QByteArray& data,
+                                Obfuscation obfuscation,
+                                const QByteArray& obfuscation_key);
+
+protected:
+  EPubFontRegistry();
+
+  struct RegisteredFont
+  {
+    int id = -1; // the QFontDatabase application font id.
+    QSet<const void*> owners;
+  };
+
+  QString m_directory;
+  QHash<QByteArray, RegisteredFont> m_fonts;
+
+  static const QString IDPF_ALGORITHM;
+  static const QString ADOBE_ALGORITHM;
+  static const int IDPF_LENGTH = 1040;  // bytes obfuscated.
+  static const int ADOBE_LENGTH = 1024; // bytes obfuscated.
+  static const QString SUFFIX;
+};
+
+#endif // EPUBFONTREGISTRY_H
@@ -0,0 +1,245 @@
+#include "epubparsecache.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <qlogger/qlogger.h>
+
+using namespace qlogger;
+
+EPubParseCache::EPubParseCache()
+  : version(0)
+  , is_foaf(false)
+{}
+
+/*!
+ * \brief The name of the cache file for an epub file.
+ *
+ * \param cache_directory the directory holding the cache files.
+ * \param source the path of the epub file.
+ */
+QString
+EPubParseCache::cacheFilename(const QString& cache_directory,
+                              const QString& source)
+{
+  QByteArray hash = QCryptographicHash::hash(
+    QFileInfo(source).absoluteFilePath().toUtf8(), QCryptographicHash::Sha1);
+  return cache_directory + QDir::separator() +
+         QString::fromLatin1(hash.toHex()) + ".cache";
+}
+
+/*!
+ * \brief Reads the cache file built for source.
+ *
+ * \return false if there is no cache file or if source has been changed
+ *         since it was written, otherwise true.
+ */
+bool
+EPubParseCache::read(const QString& cache_file, const QString& source)
+{
+  QFile file(cache_file);
+  if (!file.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+
+  QDataStream in(&file);
+  in.setVersion(QDataStream::Qt_5_9);
+
+  quint32 magic = 0, cache_version = 0;
+  in >> magic >> cache_version;
+  if (magic != MAGIC || cache_version != VERSION) {
+    QLOG_DEBUG(QString("Ignoring out of date parse cache %1").arg(cache_file));
+    return false;
+  }
+
+  QFileInfo info(source);
+  QString path;
+  qint64 modified = 0, size = 0;
+  in >> path >> modified >> size;
+  if (path != info.absoluteFilePath() ||
+      modified != info.lastModified().toMSecsSinceEpoch() ||
+      size != info.size()) {
+    // the book has changed since it was cached.
+    return false;
+  }
+
+  qint32 package_version = 0;
+  in >> container_version >> container_xmlns >> container_fullpath >>
+    container_mediatype;
+  in >> package_version >> package_xmlns >> package_language >>
+    package_prefix >> package_direction >> package_id >>
+    unique_identifier_name >> is_foaf >> metadata_xml;
+  version = package_version;
+
+  qint32 count = 0;
+  in >> manifest_id >> count;
+  items.clear();
+  for (int i = 0; i < count && in.status() == QDataStream::Ok; i++) {
+    items.append(readManifestItem(in));
+  }
+
+  in >> spine_id >> spine_toc >> page_progression_dir >> count;
+  spine_items.clear();
+  for (int i = 0; i < count && in.status() == QDataStream::Ok; i++) {
+    SharedSpineItem item(new EPubSpineItem());
+    in >> item->id >> item->idref >> item->linear >> item->page_spread_left >>
+      item->page_spread_right;
+    spine_items.append(item);
+  }
+
+  in >> toc_title >> toc_roots >> count;
+  toc_items.clear();
+  for (int i = 0; i < count && in.status() == QDataStream::Ok; i++) {
+    SharedTocItem item = readTocItem(in);
+    toc_items.insert(item->playorder, item);
+  }
+  in >> count;
+  toc_paths.clear();
+  for (int i = 0; i < count && in.status() == QDataStream::Ok; i++) {
+    QString toc_path;
+    in >> toc_path;
+    toc_paths.insert(toc_path, readTocItem(in));
+  }
+
+  if (in.status() != QDataStream::Ok) {
+    QLOG_DEBUG(QString("Corrupt parse cache %1").arg(cache_file));
+    return false;
+  }
+  return true;
+}
+
+/*!
+ * \brief Writes the cache file for source.
+ *
+ * The file is written to a temporary file that replaces cache_file once it
+ * is complete, so a partly written cache is never read.
+ */
+bool
+EPubParseCache::write(const QString& cache_file, const QString& source) const
+{
+  QDir dir;
+  dir.mkpath(QFileInfo(cache_file).path());
+
+  QSaveFile file(cache_file);
+  if (!file.open(QIODevice::WriteOnly)) {
+    QLOG_DEBUG(QString("Unable to write parse cache %1").arg(cache_file));
+    return false;
+  }
+
+  QDataStream out(&file);
+  out.setVersion(QDataStream::Qt_5_9);
+
+  QFileInfo info(source);
+  out << MAGIC << VERSION;
+  out << info.absoluteFilePath() << info.lastModified().toMSecsSinceEpoch()
+      << info.size();
+
+  out << container_version << container_xmlns << container_fullpath
+      << container_mediatype;
+  out << qint32(version) << package_xmlns << package_language
+      << package_prefix << package_direction << package_id
+      << unique_identifier_name << is_foaf << metadata_xml;
+
+  out << manifest_id << qint32(items.size());
+  foreach (SharedManifestItem item, items) {
+    writeManifestItem(out, item);
+  }
+
+  out << spine_id << spine_toc << page_progression_dir
+      << qint32(spine_items.size());
+  foreach (SharedSpineItem item, spine_items) {
+    out << item->id << item->idref << item->linear << item->page_spread_left
+        << item->page_spread_right;
+  }
+
+  out << toc_title << toc_roots << qint32(toc_items.size());
+  foreach (SharedTocItem item, toc_items) {
+    writeTocItem(out, item);
+  }
+  out << qint32(toc_paths.size());
+  for (SharedTocItemPathMap::const_iterator it = toc_paths.constBegin();
+       it != toc_paths.constEnd();
+       ++it) {
+    out << it.key();
+    writeTocItem(out, it.value());
+  }
+
+  if (out.status() != QDataStream::Ok || !file.commit()) {
+    QLOG_DEBUG(QString("Unable to write parse cache %1").arg(cache_file));
+    return false;
+  }
+  return true;
+}
+
+void
+EPubParseCache::writeManifestItem(QDataStream& out, SharedManifestItem item)
+{
+  out << item->href << item->path << item->id << item->media_type
+      << item->properties << item->fallback << item->media_overlay
+      << item->non_standard_properties;
+
+  // only unchanged chapter bodies are cached, anything else is reloaded.
+  bool cached_body = (item->loaded && !item->modified &&
+                      item->media_type == "application/xhtml+xml");
+  out << cached_body;
+  if (cached_body) {
+    // the bodies are cached as they are kept when not in use.
+    QByteArray compressed = item->compressed_document;
+    if (compressed.isEmpty()) {
+      compressed = EPubContainer::compressDocument(item->document_string);
+    }
+    out << compressed << item->css_links << item->body_class;
+  }
+}
+
+SharedManifestItem
+EPubParseCache::readManifestItem(QDataStream& in)
+{
+  SharedManifestItem item(new EPubManifestItem());
+  in >> item->href >> item->path >> item->id >> item->media_type >>
+    item->properties >> item->fallback >> item->media_overlay >>
+    item->non_standard_properties;
+  // shared with every other book, as when the package file is parsed.
+  EBookStringPool* pool = EBookStringPool::instance();
+  item->media_type = pool->intern(item->media_type);
+  item->properties = pool->intern(item->properties);
+
+  bool cached_body = false;
+  in >> cached_body;
+  if (cached_body) {
+    in >> item->compressed_document >> item->css_links >> item->body_class;
+    item->css_links = pool->intern(item->css_links);
+    item->body_class = pool->intern(item->body_class);
+    item->loaded = true;
+  }
+  return item;
+}
+
+void
+EPubParseCache::writeTocItem(QDataStream& out, SharedTocItem item)
+{
+  out << item->id << qint32(item->playorder) << item->tag_class << item->label
+      << item->source << item->chapter_tag << qint32(item->sub_items.size());
+  foreach (SharedTocItem sub_item, item->sub_items) {
+    writeTocItem(out, sub_item);
+  }
+}
+
+SharedTocItem
+EPubParseCache::readTocItem(QDataStream& in)
+{
+  SharedTocItem item(new EPubTocItem());
+  qint32 playorder = 0, count = 0;
+  in >> item->id >> playorder >> item->tag_class >> item->label >>
+    item->source >> item->chapter_tag >> count;
+  item->playorder = playorder;
+  for (int i = 0; i < count && in.status() == QDataStream::Ok; i++) {
+    SharedTocItem sub_item = readTocItem(in);
+    item->sub_items.insert(sub_item->playorder, sub_item);
+  }
+  return item;
+}
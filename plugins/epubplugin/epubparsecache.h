@@ -0,0 +1,76 @@
+#ifndef EPUBPARSECACHE_H
+#define EPUBPARSECACHE_H
+
+#include <QDataStream>
+#include <QString>
+
+#include "epubcontainer.h"
+
+/*!
+ * \brief A binary cache of the parsed structure of an epub file.
+ *
+ * The cache holds everything that EPubContainer::loadFile() builds from the
+ * container, package and toc files, along with the extracted chapter
+ * bodies, so a book that has not changed since it was cached can be
+ * reopened without parsing any xml. Only the metadata is kept as xml,
+ * EBookMetadata has no other serialised form, but that is a small part of
+ * the package file.
+ *
+ * A cache file is only valid for the path, modification time and size
+ * of the epub file that it was built from.
+ */
+class EPubParseCache
+{
+public:
+  EPubParseCache();
+
+  static QString cacheFilename(const QString& cache_directory,
+                               const QString& source);
+
+  bool read(const QString& cache_file, const QString& source);
+  bool write(const QString& cache_file, const QString& source) const;
+
+  // container
+  QString container_version;
+  QString container_xmlns;
+  QString container_fullpath;
+  QString container_mediatype;
+
+  // package
+  int version;
+  QString package_xmlns;
+  QString package_language;
+  QString package_prefix;
+  QString package_direction;
+  QString package_id;
+  QString unique_identifier_name;
+  bool is_foaf;
+  QString metadata_xml; // the <metadata> element in a <package> wrapper
+
+  // manifest, html items include their chapter bodies if loaded.
+  QString manifest_id;
+  SharedManifestItemList items;
+
+  // spine
+  QString spine_id;
+  QString spine_toc;
+  QString page_progression_dir;
+  QList<SharedSpineItem> spine_items; // in spine order
+
+  // toc
+  QString toc_title;
+  QList<int> toc_roots;
+  SharedTocItemMap toc_items;
+  SharedTocItemPathMap toc_paths;
+
+protected:
+  static const quint32 MAGIC = 0x45504331; // "EPC1"
+  static const quint32 VERSION = 4;
+
+  static void writeManifestItem(QDataStream& out, SharedManifestItem item);
+  static SharedManifestItem readManifestItem(QDataStream& in);
+  static void writeTocItem(QDataStream& out, SharedTocItem item);
+  static SharedTocItem readTocItem(QDataStream& in);
+};
+
+#endif // EPUBPARSECACHE_H
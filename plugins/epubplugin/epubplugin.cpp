@@ -3,6 +3,7 @@
 #include "ebookcommon.h"
 #include "epubcontainer.h"
 #include "epubdocument.h"
+#include "epubfontregistry.h"
 
 const QString EPubPlugin::m_plugin_name = "EPub Reader";
 const QString EPubPlugin::m_plugin_group = "Book Reader";
@@ -21,6 +22,7 @@ const QString EPubPlugin::m_file_description = "EPub Document";
 
 EPubPlugin::EPubPlugin(QObject* parent)
   : QObject(parent)
+  , m_options(nullptr)
 {
 }
 
@@ -32,11 +34,235 @@ EPubPlugin::EPubPlugin(QObject* parent)
  */
 IEBookDocument* EPubPlugin::createDocument(QString path)
 {
-  m_document = new EPubDocument(this);
+  EPubDocument* document = new EPubDocument(this);
+  if (m_options) {
+    document->setImageCacheSize(m_options->imageCacheSize());
+    document->setCompressionLevel(m_options->compressionLevel());
+    if (!m_options->cacheDirectory().isEmpty()) {
+      document->setParseCacheDirectory(m_options->cacheDirectory() +
+                                       QDir::separator() + "epub");
+    }
+  }
+  m_document = document;
   m_document->openDocument(path);
   return m_document;
 }
 
+/*!
+ * \brief Opens the epub and parses its package, manifest and toc, run in a
+ * worker thread.
+ *
+ * \return the loaded EPubContainer, or nullptr.
+ */
+QObject* EPubPlugin::parseDocument(const QString& path, QThread* thread)
+{
+  EPubContainer* container = new EPubContainer();
+  if (m_options) {
+    container->setImageCacheSize(m_options->imageCacheSize());
+    container->setCompressionLevel(m_options->compressionLevel());
+    if (!m_options->cacheDirectory().isEmpty()) {
+      container->setParseCacheDirectory(m_options->cacheDirectory() +
+                                        QDir::separator() + "epub");
+    }
+  }
+  if (!container->loadFile(path)) {
+    delete container;
+    return nullptr;
+  }
+  container->moveToThread(thread);
+  return container;
+}
+
+/*!
+ * \brief Creates an EBookDocument from a container loaded by
+ * parseDocument(), only the first chapter is laid out here.
+ */
+IEBookDocument* EPubPlugin::createParsedDocument(QObject* parsed)
+{
+  EPubContainer* container = qobject_cast<EPubContainer*>(parsed);
+  if (!container) {
+    delete parsed;
+    return nullptr;
+  }
+  EPubDocument* document = new EPubDocument(this);
+  document->openParsedDocument(container);
+  m_document = document;
+  return m_document;
+}
+
+/*!
+ * \brief Reads the metadata of an epub from its container and package files.
+ *
+ * No manifest item is read, nor is the toc.
+ */
+Metadata EPubPlugin::readMetadata(const QString& path)
+{
+  EPubContainer container;
+  if (m_options && !m_options->cacheDirectory().isEmpty()) {
+    container.setParseCacheDirectory(m_options->cacheDirectory() +
+                                     QDir::separator() + "epub");
+  }
+  if (!container.loadMetadata(path)) {
+    return Metadata();
+  }
+  return container.metadata();
+}
+
+/*!
+ * \brief Reads the html of each spine item for the search index.
+ *
+ * The chapter ids are the spine idrefs.
+ */
+EBookChapterList EPubPlugin::readChapters(const QString& path)
+{
+  EBookChapterList chapters;
+  EPubContainer container;
+  if (m_options && !m_options->cacheDirectory().isEmpty()) {
+    container.setParseCacheDirectory(m_options->cacheDirectory() +
+                                     QDir::separator() + "epub");
+  }
+  if (!container.loadFile(path)) {
+    return chapters;
+  }
+  foreach (QString key, container.spineKeys()) {
+    EBookChapterText chapter;
+    chapter.id = key;
+    chapter.text = container.itemDocument(key);
+    // the container only needs to keep the chapter being read.
+    container.unloadItem(key);
+    chapters.append(chapter);
+  }
+  return chapters;
+}
+
+/*!
+ * \brief Reads the cover image for the library shelf.
+ *
+ * Only the package file, the cover page if there is one and the cover
+ * entry are read, see EPubContainer::extractCover().
+ */
+QImage EPubPlugin::readCover(const QString& path, const QSize& size)
+{
+  return EPubContainer::extractCover(path, size);
+}
+
+/*!
+ * \brief Checks every archive entry, the manifest, the spine and the html
+ * of an epub.
+ *
+ * The parse cache is not used, so the package file is always parsed.
+ */
+bool EPubPlugin::verifyBook(const QString& path, QStringList& problems)
+{
+  EPubContainer container;
+  if (!container.loadFile(path)) {
+    problems.append(tr("%1 cannot be read as an epub").arg(path));
+    return false;
+  }
+  return container.verify(problems);
+}
+
+/*!
+ * \brief Reads an epub and saves it again, which rewrites its container
+ * file and copies every other entry across.
+ *
+ * The written book is read back and verified before it replaces anything,
+ * see EPubContainer::saveFileVerified().
+ */
+bool EPubPlugin::resaveBook(const QString& path,
+                            const QString& save_path,
+                            QStringList& problems)
+{
+  EPubContainer container;
+  if (m_options) {
+    container.setCompressionLevel(m_options->compressionLevel());
+  }
+  if (!container.loadFile(path)) {
+    problems.append(tr("%1 cannot be read as an epub").arg(path));
+    return false;
+  }
+  return container.saveFileVerified(save_path, problems);
+}
+
+/*!
+ * \brief Reads an epub for conversion, see EPubContainer::readContent().
+ */
+bool EPubPlugin::readContent(const QString& path, EBookContent& content)
+{
+  EPubContainer container;
+  if (!container.loadFile(path)) {
+    return false;
+  }
+  return container.readContent(content);
+}
+
+/*!
+ * \brief Writes a converted book as an epub, see
+ * EPubContainer::writeContent().
+ */
+bool EPubPlugin::writeContent(const EBookContent& content, const QString& path)
+{
+  if (m_options) {
+    return EPubContainer::writeContent(
+      content, path, m_options->compressionLevel());
+  }
+  return EPubContainer::writeContent(content, path);
+}
+
+/*!
+ * \brief Compares two versions of an epub, see EPubContainer::compareFiles().
+ */
+bool EPubPlugin::compareBooks(const QString& original,
+                              const QString& changed,
+                              EBookComparison& comparison)
+{
+  return EPubContainer::compareFiles(original, changed, comparison);
+}
+
+/*!
+ * \brief Edits the metadata of an epub, only its package file is rewritten,
+ * see EPubContainer::writeMetadata().
+ */
+bool EPubPlugin::writeMetadata(const QString& path,
+                               const EBookMetadataEdit& edit,
+                               Metadata& metadata)
+{
+  EPubContainer container;
+  if (m_options) {
+    container.setCompressionLevel(m_options->compressionLevel());
+  }
+  if (!container.loadMetadata(path) || !container.writeMetadata(edit)) {
+    return false;
+  }
+  metadata = container.metadata();
+  return true;
+}
+
+/*!
+ * \brief Sets the application options used when creating documents.
+ */
+void EPubPlugin::setOptions(Options* options)
+{
+  m_options = options;
+  if (m_options && !m_options->cacheDirectory().isEmpty()) {
+    EPubFontRegistry::instance()->setCacheDirectory(
+      m_options->cacheDirectory() + QDir::separator() + "epub" +
+      QDir::separator() + "fonts");
+  }
+}
+
+/*!
+ * \brief An epub must start with an uncompressed mimetype entry, so its
+ * name and contents follow the 30 byte zip local file header.
+ */
+EBookSignatureList EPubPlugin::signatures() const
+{
+  EBookSignature signature;
+  signature.offset = 30;
+  signature.magic = "mimetypeapplication/epub+zip";
+  return EBookSignatureList() << signature;
+}
+
 /*!
  * \brief Creates a code version of the EBookDocument.
  *
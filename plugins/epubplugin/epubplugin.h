@@ -16,7 +16,7 @@ class EPubDocument;
 class INTERFACESHARED_EXPORT EPubPlugin : public QObject, public IEBookInterface
 {
   Q_OBJECT
-  Q_PLUGIN_METADATA(IID IEBookInterface_iid FILE "ebookinterface.json")
+  Q_PLUGIN_METADATA(IID IEBookInterface_iid FILE "epubplugin.json")
   Q_INTERFACES(IPluginInterface)
   Q_INTERFACES(IEBookInterface)
 
@@ -24,7 +24,25 @@ public:
   EPubPlugin(QObject* parent = nullptr);
 
   IEBookDocument* createDocument(QString path) override;
+  bool parsesInBackground() const override { return true; }
+  QObject* parseDocument(const QString& path, QThread* thread) override;
+  IEBookDocument* createParsedDocument(QObject* parsed) override;
   IEBookDocument* createCodeDocument() override;
+  Metadata readMetadata(const QString& path) override;
+  EBookChapterList readChapters(const QString& path) override;
+  QImage readCover(const QString& path, const QSize& size) override;
+  bool verifyBook(const QString& path, QStringList& problems) override;
+  bool resaveBook(const QString& path,
+                  const QString& save_path,
+                  QStringList& problems) override;
+  bool readContent(const QString& path, EBookContent& content) override;
+  bool writeContent(const EBookContent& content, const QString& path) override;
+  bool compareBooks(const QString& original,
+                    const QString& changed,
+                    EBookComparison& comparison) override;
+  bool writeMetadata(const QString& path,
+                     const EBookMetadataEdit& edit,
+                     Metadata& metadata) override;
   //  void saveDocument(IEBookDocument* m_document) override;
 
   // IPluginInterface interface
@@ -46,6 +64,8 @@ public:
   {
     return EPUB;
   }
+  void setOptions(Options* options) override;
+  EBookSignatureList signatures() const override;
 
 protected:
   // static variables for IPluginInterface.
@@ -61,7 +81,7 @@ protected:
   static const QString m_file_description;
 
   // variables for IEBookInterface;
-//  Options* m_options;
+  Options* m_options;
   IEBookDocument* m_document;
 };
 
@@ -6,7 +6,7 @@
 
 TEMPLATE       = lib
 CONFIG         += plugin
-QT             += core gui xml svg
+QT             += core gui xml svg concurrent
 CONFIG += c++14
 
 VERSION_MAJOR = 0
@@ -30,6 +30,11 @@ SOURCES += \
     epubplugin.cpp \
     epubcontainer.cpp \
     epubdocument.cpp \
+    epubentrydevice.cpp \
+    epubfontregistry.cpp \
+    epubparsecache.cpp \
+    epubresourcestore.cpp \
+    epubstylesheetcache.cpp \
     private/epubdocument_p.cpp
 
 HEADERS += \
@@ -37,6 +42,11 @@ HEADERS += \
     epubplugin_global.h \
     epubcontainer.h \
     epubdocument.h \
+    epubentrydevice.h \
+    epubfontregistry.h \
+    epubparsecache.h \
+    epubresourcestore.h \
+    epubstylesheetcache.h \
     private/epubdocument_p.h
 
 DISTFILES += \
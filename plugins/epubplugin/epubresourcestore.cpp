@@ -0,0 +1,77 @@
+#include "epubresourcestore.h"
+
+#include <QMutexLocker>
+
+EPubResourceStore::EPubResourceStore() {}
+
+EPubResourceStore*
+EPubResourceStore::instance()
+{
+  static EPubResourceStore store;
+  return &store;
+}
+
+/*!
+ * \brief Returns the stored copy of data, making owner one of its owners.
+ *
+ * If no open book has the resource data is stored as it is and returned.
+ * The data must not be a view into a mapping, it is kept after the book
+ * that gave it has closed.
+ *
+ * \param owner the book that holds the data.
+ * \param crc the CRC-32 of the archive entry.
+ * \param size the uncompressed size of the archive entry.
+ * \param data the data of the entry.
+ */
+QByteArray
+EPubResourceStore::share(const void* owner,
+                         quint32 crc,
+                         qint64 size,
+                         const QByteArray& data)
+{
+  if (data.size() != size) {
+    // not the data of the entry, a damaged archive most likely.
+    return data;
+  }
+
+  QMutexLocker locker(&m_mutex);
+  QVector<Resource>& resources = m_resources[qMakePair(crc, size)];
+  for (int i = 0; i < resources.size(); i++) {
+    Resource& resource = resources[i];
+    // comparing is cheaper than hashing both and cannot be fooled.
+    if (resource.data == data) {
+      resource.owners.insert(owner);
+      return resource.data;
+    }
+  }
+  Resource resource;
+  resource.data = data;
+  resource.owners.insert(owner);
+  resources.append(resource);
+  return data;
+}
+
+/*!
+ * \brief Removes owner from the owners of all of its resources, dropping
+ * those that no longer have an owner.
+ */
+void
+EPubResourceStore::release(const void* owner)
+{
+  QMutexLocker locker(&m_mutex);
+  QHash<Key, QVector<Resource>>::iterator it = m_resources.begin();
+  while (it != m_resources.end()) {
+    QVector<Resource>& resources = it.value();
+    for (int i = resources.size() - 1; i >= 0; i--) {
+      resources[i].owners.remove(owner);
+      if (resources.at(i).owners.isEmpty()) {
+        resources.remove(i);
+      }
+    }
+    if (resources.isEmpty()) {
+      it = m_resources.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
@@ -0,0 +1,55 @@
+#ifndef EPUBRESOURCESTORE_H
+#define EPUBRESOURCESTORE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QPair>
+#include <QSet>
+#include <QVector>
+
+/*!
+ * \brief A process wide store of the image data of all open books.
+ *
+ * Books from the same publisher ship the same logos, ornaments and covers.
+ * Resources are keyed by the CRC-32 and size of their archive entry, which
+ * are known from the central directory without reading the entry, and a
+ * match is confirmed by comparing the data itself, so two books only share
+ * data that is identical. A resource seen before is returned as the stored
+ * copy, implicitly shared with every other book that holds it.
+ *
+ * Each book that holds a resource is an owner of it, the store drops its
+ * copy once the last owner releases it. Books keep their own copies.
+ *
+ * Stylesheets and fonts are shared by EPubStylesheetCache and
+ * EPubFontRegistry.
+ *
+ * share() and release() can be called from any thread.
+ */
+class EPubResourceStore
+{
+public:
+  static EPubResourceStore* instance();
+
+  QByteArray share(const void* owner,
+                   quint32 crc,
+                   qint64 size,
+                   const QByteArray& data);
+  void release(const void* owner);
+
+protected:
+  EPubResourceStore();
+
+  struct Resource
+  {
+    QByteArray data;
+    QSet<const void*> owners;
+  };
+  typedef QPair<quint32, qint64> Key; // the entry's crc and size.
+
+  QMutex m_mutex;
+  // more than one resource per key only if their crcs collide.
+  QHash<Key, QVector<Resource>> m_resources;
+};
+
+#endif // EPUBRESOURCESTORE_H
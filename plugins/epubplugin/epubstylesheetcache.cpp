@@ -0,0 +1,123 @@
+#include "epubstylesheetcache.h"
+
+#include <QCryptographicHash>
+#include <QMutexLocker>
+
+#include "ebooktextdecoder.h"
+
+EPubStylesheetCache::EPubStylesheetCache()
+  : m_stylesheets(DEFAULT_MAX_COST)
+{}
+
+EPubStylesheetCache*
+EPubStylesheetCache::instance()
+{
+  static EPubStylesheetCache cache;
+  return &cache;
+}
+
+/*!
+ * \brief Returns the minified form of a raw stylesheet.
+ *
+ * If the same stylesheet has been seen before the stored copy is returned,
+ * so it shares its data with every other book that uses it. Books keep their
+ * copy if it is later dropped from the cache.
+ *
+ * \param data the stylesheet as read from the epub.
+ */
+QString
+EPubStylesheetCache::stylesheet(const QByteArray& data)
+{
+  QByteArray key = QCryptographicHash::hash(data, QCryptographicHash::Sha1);
+
+  QMutexLocker locker(&m_mutex);
+  QString* cached = m_stylesheets.object(key);
+  if (cached) {
+    return *cached;
+  }
+  locker.unlock();
+
+  QString css_string = EBookTextDecoder::decode(data);
+  css_string.replace("@charset \"", "@charset\"");
+  QString minified = minify(css_string);
+
+  locker.relock();
+  int cost = qMax(1, int((qint64(minified.size()) * 2) / 1024));
+  m_stylesheets.insert(key, new QString(minified), cost);
+  return minified;
+}
+
+int
+EPubStylesheetCache::maxCost() const
+{
+  QMutexLocker locker(&m_mutex);
+  return m_stylesheets.maxCost();
+}
+
+void
+EPubStylesheetCache::setMaxCost(int kilobytes)
+{
+  QMutexLocker locker(&m_mutex);
+  m_stylesheets.setMaxCost(kilobytes);
+}
+
+/*!
+ * \brief Removes comments and unnecessary whitespace from a stylesheet.
+ *
+ * Runs of whitespace are reduced to a single space, and removed entirely
+ * next to braces, semi-colons and commas. Whitespace elsewhere is kept as
+ * it can be significant, in descendant selectors for example. Quoted
+ * strings are copied unchanged.
+ */
+QString
+EPubStylesheetCache::minify(const QString& css)
+{
+  QString out;
+  out.reserve(css.size());
+  bool pending_space = false;
+
+  for (int i = 0; i < css.size(); i++) {
+    QChar c = css.at(i);
+
+    if (c == QLatin1Char('/') && i + 1 < css.size() &&
+        css.at(i + 1) == QLatin1Char('*')) {
+      int end = css.indexOf(QLatin1String("*/"), i + 2);
+      i = (end < 0 ? css.size() : end + 1);
+      pending_space = true;
+      continue;
+    }
+
+    if (c.isSpace()) {
+      pending_space = true;
+      continue;
+    }
+
+    bool is_separator = (c == QLatin1Char('{') || c == QLatin1Char('}') ||
+                         c == QLatin1Char(';') || c == QLatin1Char(','));
+    if (pending_space && !is_separator && !out.isEmpty()) {
+      QChar last = out.at(out.size() - 1);
+      if (last != QLatin1Char('{') && last != QLatin1Char('}') &&
+          last != QLatin1Char(';') && last != QLatin1Char(',')) {
+        out += QLatin1Char(' ');
+      }
+    }
+    pending_space = false;
+
+    if (c == QLatin1Char('"') || c == QLatin1Char('\'')) {
+      int end = i + 1;
+      while (end < css.size() && css.at(end) != c) {
+        if (css.at(end) == QLatin1Char('\\')) {
+          end++;
+        }
+        end++;
+      }
+      out += css.midRef(i, qMin(end, css.size() - 1) - i + 1);
+      i = end;
+      continue;
+    }
+
+    out += c;
+  }
+
+  return out;
+}
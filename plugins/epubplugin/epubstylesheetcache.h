@@ -0,0 +1,39 @@
+#ifndef EPUBSTYLESHEETCACHE_H
+#define EPUBSTYLESHEETCACHE_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QMutex>
+#include <QString>
+
+/*!
+ * \brief A process wide store of the stylesheets of all open books.
+ *
+ * Stylesheets are keyed by a hash of their raw content and are minified
+ * when they are first inserted. Books that ship the same stylesheet, which
+ * is nearly every book converted by calibre, then share a single implicitly
+ * shared copy of it rather than each holding their own.
+ *
+ * stylesheet() can be called from any thread.
+ */
+class EPubStylesheetCache
+{
+public:
+  static EPubStylesheetCache* instance();
+
+  QString stylesheet(const QByteArray& data);
+  int maxCost() const;
+  void setMaxCost(int kilobytes);
+
+  static QString minify(const QString& css);
+
+protected:
+  EPubStylesheetCache();
+
+  static const int DEFAULT_MAX_COST = 8192; // in kilobytes.
+
+  mutable QMutex m_mutex;
+  QCache<QByteArray, QString> m_stylesheets; // cost in kilobytes.
+};
+
+#endif // EPUBSTYLESHEETCACHE_H
@@ -1,17 +1,80 @@
 #include "epubdocument_p.h"
+#include "ebooktrace.h"
+
+#include <QAbstractTextDocumentLayout>
+#include <QFileInfo>
+#include <QFontDatabase>
+#include <QTextBlock>
+#include <QTextLayout>
+#include <QtConcurrent>
 
 #include <csvsplitter/csvsplitter.h>
 #include <qlogger/qlogger.h>
 using namespace qlogger;
 
+const qreal EPubDocumentPrivate::IMAGE_ZOOMS[] = { 0.5, 1.0, 1.5, 2.0 };
+
 EPubDocumentPrivate::EPubDocumentPrivate(EPubDocument* parent)
   : q_ptr(parent)
   , m_loaded(false)
+  , m_current_document_index(0)
+  , m_current_document_lineno(0)
   , m_container(new EPubContainer(q_ptr))
-{}
+  , m_modified(false)
+  , m_image_zoom_step(1)
+  , m_layout_watcher(nullptr)
+  , m_chapter_edited(false)
+{
+  m_layout_timer.setSingleShot(true);
+  m_layout_timer.setInterval(0);
+  QObject::connect(&m_layout_timer,
+                   &QTimer::timeout,
+                   q_ptr,
+                   [this]() { layoutNextChapter(); });
+  connectContainer();
+}
 
 EPubDocumentPrivate::~EPubDocumentPrivate() {}
 
+void
+EPubDocumentPrivate::connectContainer()
+{
+  // svg images and the other zooms of images are decoded in the background,
+  // replace the stand in resource when the size shown arrives.
+  QObject::connect(
+    m_container,
+    &EPubContainer::imageRendered,
+    q_ptr,
+    [this](const QString& id, QSize image_size, const QImage& image) {
+      if (!m_chapter_images.contains(id) ||
+          image_size != imageSize(m_image_zoom_step)) {
+        return;
+      }
+      q_ptr->addResource(
+        QTextDocument::ImageResource, QUrl(id), QVariant(image));
+      q_ptr->markContentsDirty(0, q_ptr->characterCount());
+    });
+  // loading a chapter is done with undo off, anything else is an edit that
+  // leaves its pages out of date.
+  QObject::connect(q_ptr,
+                   &QTextDocument::contentsChange,
+                   q_ptr,
+                   [this](int /*position*/, int /*removed*/, int /*added*/) {
+                     if (q_ptr->isUndoRedoEnabled()) {
+                       m_chapter_edited = true;
+                     }
+                   });
+  // books are saved in the background.
+  QObject::connect(m_container,
+                   &EPubContainer::saveProgress,
+                   q_ptr,
+                   &EPubDocument::saveProgress);
+  QObject::connect(m_container,
+                   &EPubContainer::saveFinished,
+                   q_ptr,
+                   &EPubDocument::saveCompleted);
+}
+
 bool
 EPubDocumentPrivate::loaded()
 {
@@ -28,11 +91,37 @@ EPubDocumentPrivate::openDocument(const QString& path)
   //    m_data->toc = m_container->toc();
 }
 
+/*!
+ * \brief Replaces the empty container with one that has already loaded its
+ * file, and shows the first chapter.
+ */
+void
+EPubDocumentPrivate::openParsedDocument(EPubContainer* container)
+{
+  if (!container) {
+    return;
+  }
+  delete m_container;
+  m_container = container;
+  m_container->setParent(q_ptr);
+  connectContainer();
+  showLoadedDocument();
+}
+
 void
 EPubDocumentPrivate::saveDocument(const QString& path)
 {
-  if (m_modified)
-    m_container->saveFile(path);
+  if (!m_modified) {
+    return;
+  }
+  // a metadata only change can be patched into the existing file, anything
+  // else needs the archive rewriting.
+  if (path.isEmpty() && !m_container->hasModifiedItems() &&
+      m_container->saveMetadata()) {
+    m_modified = false;
+    return;
+  }
+  m_container->saveFileAsync(path);
 }
 
 QString
@@ -42,6 +131,23 @@ EPubDocumentPrivate::filename()
   return m_container->filename();
 }
 
+/*!
+ * \brief Changes the file of the document.
+ *
+ * Once the document is loaded the file is assumed to be an identical copy,
+ * the library import for example, so the parsed book is kept rather than
+ * opening it again.
+ */
+void
+EPubDocumentPrivate::setFilename(const QString& filename)
+{
+  if (m_loaded) {
+    m_container->reopenFile(filename);
+  } else {
+    m_container->setFilename(filename);
+  }
+}
+
 // void EPubDocumentPrivate::clearCache() { /*m_renderedSvgs.clear();*/ }
 
 // void EPubDocumentPrivate::setDocumentPath(const QString& documentPath)
@@ -49,10 +155,33 @@ EPubDocumentPrivate::filename()
 //  m_documentPath = documentPath;
 //}
 
-QString
+/*
+ * Chapters that were given anchor points for the new toc are changed, as
+ * if they had been edited.
+ */
+EBookToc
 EPubDocumentPrivate::buildTocFromFiles()
 {
-  return m_container->buildTocfromHtml();
+  Q_Q(EPubDocument);
+
+  QStringList changed_keys;
+  EBookToc toc = m_container->buildTocfromHtml(&changed_keys);
+  if (changed_keys.isEmpty()) {
+    return toc;
+  }
+  m_modified = true;
+  QStringList spine_keys = m_container->spineKeys();
+  foreach (QString key, changed_keys) {
+    int index = spine_keys.indexOf(key);
+    if (index < 0) {
+      continue;
+    }
+    emit q->chapterSourceChanged(index);
+    if (index == m_current_document_index && m_loaded) {
+      loadChapter(index);
+    }
+  }
+  return toc;
 }
 
 bool
@@ -64,15 +193,55 @@ EPubDocumentPrivate::isModified() const
 void
 EPubDocumentPrivate::loadDocument()
 {
+  EBOOK_TRACE_SCOPE("EPubDocument::loadDocument");
   Q_Q(EPubDocument);
 
   if (!m_container->loadFile(q->filename())) {
     return;
   }
+  showLoadedDocument();
+}
+
+void
+EPubDocumentPrivate::showLoadedDocument()
+{
+  Q_Q(EPubDocument);
+
+  m_current_document_index = 0;
+  m_href_chapters.clear();
+  if (!loadChapter(m_current_document_index)) {
+    return;
+  }
+  m_loaded = true;
+
+  // so that the next open of an unchanged book can skip the xml parsing.
+  m_container->writeParseCache();
+
+  emit q->loadCompleted();
+}
+
+/*!
+ * \brief Replaces the contents of the document with a spine item.
+ *
+ * Only one chapter is held in the QTextDocument at a time, its neighbours
+ * are prepared in the background by updateChapterWindow().
+ *
+ * \param index the position of the chapter in the spine.
+ * \return true if the chapter was loaded, otherwise false.
+ */
+bool
+EPubDocumentPrivate::loadChapter(int index)
+{
+  Q_Q(EPubDocument);
+
+  QStringList spine_keys = m_container->spineKeys();
+  if (index < 0 || index >= spine_keys.size()) {
+    QLOG_WARN(QString("No spine item at %1").arg(index))
+    return false;
+  }
 
-  // add the images as resources
-  QSize image_size(int(q->pageSize().width() - q->documentMargin() * 4),
-                   int(q->pageSize().height() - q->documentMargin() * 4));
+  // images and stylesheets are only read when the layout asks for them, see
+  // loadResource().
   //  foreach (QString name, m_container->imageKeys()) {
   //    SharedManifestItem item = m_container->item(name);
   //    QImage image = m_container->image(name, image_size);
@@ -95,100 +264,599 @@ EPubDocumentPrivate::loadDocument()
   //                   QVariant(data));
   //  }
 
-  //  QStringList spine_items = m_container->spineKeys();
+  // loading the chapter shown again does not change the chapter.
+  bool changing = (!m_loaded || index != m_current_document_index);
+  if (m_loaded && changing) {
+    emit q->chapterAboutToChange(m_current_document_index);
+  }
+  if (m_chapter_edited) {
+    // paginated again now that the edits are done with.
+    m_chapter_pages.remove(m_current_document_index);
+    m_chapter_edited = false;
+  }
+  // loading a chapter is not an edit that can be undone, turning undo off
+  // and on again also drops the history of the chapter before.
+  q->setUndoRedoEnabled(false);
+  q->clear();
+  m_chapter_images.clear();
   QTextCursor cursor(q_ptr);
   cursor.movePosition(QTextCursor::End);
   //  SharedTextCursor cursor = SharedTextCursor(new QTextCursor(q_ptr));
 
+  QString doc_string = chapterHtml(index);
+  if (doc_string.isEmpty()) {
+    QLOG_WARN(QString("Got an empty document"))
+    q->setUndoRedoEnabled(true);
+    return false;
+  }
+  cursor.insertHtml(doc_string);
+  q->setUndoRedoEnabled(true);
+  q->setBaseUrl(QUrl()); // base url to empty.
+  m_current_document_index = index;
+  updateChapterWindow();
+  if (changing) {
+    emit q->chapterChanged(index);
+  }
+  return true;
+}
+
+/*!
+ * \brief Prefetches the chapters around the current one and releases the
+ * rest.
+ */
+void
+EPubDocumentPrivate::updateChapterWindow()
+{
+  QStringList spine_keys = m_container->spineKeys();
+  QStringList neighbours;
+  for (int i = 0; i < spine_keys.size(); i++) {
+    int distance = qAbs(i - m_current_document_index);
+    if (distance == 0) {
+      continue;
+    } else if (distance <= CHAPTER_WINDOW) {
+      neighbours.append(spine_keys.at(i));
+    } else {
+      m_container->unloadItem(spine_keys.at(i));
+    }
+  }
+  m_container->prefetchItems(neighbours);
+  paginateChapters();
+}
+
+/*
+ * The html that a chapter is laid out from, linking every stylesheet, or
+ * an empty string if the chapter has no document.
+ */
+QString
+EPubDocumentPrivate::chapterHtml(int index)
+{
+  QString key = m_container->spineKeys().at(index);
+  QString document = m_container->itemDocument(key);
+  if (document.isEmpty()) {
+    return QString();
+  }
+  // the embedded fonts must be known before the chapter is laid out.
+  m_container->registerFonts(key);
+
   QString doc_string = "<html>";
   doc_string += "<head>";
-  foreach (QString key, m_container->manifest().css.keys()) {
-    q->addResource(QTextDocument::StyleSheetResource,
-                   QUrl(key),
-                   QVariant(m_container->manifest().css.value(key)));
+  foreach (QString css_key, m_container->cssKeys()) {
     doc_string +=
       QString("<link href=\"%1\" rel=\"stylesheet\" type=\"text/css\"/>")
-        .arg(key);
+        .arg(css_key);
   }
   doc_string += "</head>";
   doc_string += "<body class=\"calibre\">";
+  doc_string += document;
+  doc_string += "</body>";
+  doc_string += "</html>";
+  return doc_string;
+}
+
+/*!
+ * \brief Sets the size of a page, the view's, and paginates the chapters
+ * around the current one again at that size.
+ *
+ * A change of the default font, by a zoom for instance, paginates them
+ * again too.
+ */
+void
+EPubDocumentPrivate::setPageLayoutSize(const QSizeF& size)
+{
+  Q_Q(EPubDocument);
+  if (size == m_page_layout_size && q->defaultFont() == m_page_font) {
+    return;
+  }
+  m_page_layout_size = size;
+  m_page_font = q->defaultFont();
+  m_chapter_pages.clear();
+  m_layout_queue.clear();
+  paginateChapters();
+}
 
-  foreach (QString name, m_container->imageKeys()) {
-    SharedManifestItem item = m_container->item(name);
-    QImage image = m_container->image(name, image_size);
-    q->addResource(QTextDocument::ImageResource, QUrl(name), QVariant(image));
+int
+EPubDocumentPrivate::chapterPageCount(int index) const
+{
+  if (!m_chapter_pages.contains(index)) {
+    return -1;
   }
+  return m_chapter_pages.value(index).size();
+}
 
-  QTextBlockFormat pageBreak;
-  pageBreak.setPageBreakPolicy(QTextFormat::PageBreak_AlwaysBefore);
-  //  for (const QString& chapter : spine_items) {
-  SharedManifestItem item = m_container->item(
-    /*chapter*/ m_container->spineKeys().at(m_current_document_index));
-  //    SharedDomDocument shared_domdocument = item->dom_document;
-  QString document = item->document_string;
-  if (document.isEmpty()) {
-    QLOG_WARN(QString("Got an empty document"))
+int
+EPubDocumentPrivate::pagePosition(int index, int page) const
+{
+  QList<int> positions = m_chapter_pages.value(index);
+  if (page < 0 || page >= positions.size()) {
+    return -1;
+  }
+  return positions.at(page);
+}
+
+/*
+ * Queues the chapter shown and those either side of it that have not been
+ * paginated, the chapter after first as it is the one most likely next.
+ */
+void
+EPubDocumentPrivate::paginateChapters()
+{
+  if (!m_page_layout_size.isValid() || m_page_layout_size.isEmpty()) {
     return;
   }
-  doc_string += document;
+  QList<int> chapters;
+  chapters << m_current_document_index;
+  for (int distance = 1; distance <= CHAPTER_WINDOW; distance++) {
+    chapters << m_current_document_index + distance
+             << m_current_document_index - distance;
+  }
+  m_layout_queue.clear();
+  foreach (int chapter, chapters) {
+    if (chapter >= 0 && chapter < chapterCount() &&
+        !m_chapter_pages.contains(chapter)) {
+      m_layout_queue.append(chapter);
+    }
+  }
+  if (!m_layout_watcher) {
+    startLayout();
+  }
+}
 
-  //    // mark the start of the block
-  //    int start = cursor.position();
-  //    //    item->start = SharedTextCursor(new QTextCursor(*cursor.data()));
+/*
+ * Paginates the next queued chapter on the global thread pool.
+ *
+ * Where the platform cannot lay out text outside the GUI thread, see
+ * QFontDatabase::supportsThreadedFontRendering(), the chapters are
+ * paginated on the GUI thread instead, one each time the event loop comes
+ * round, see layoutNextChapter().
+ */
+void
+EPubDocumentPrivate::startLayout()
+{
+  if (!QFontDatabase::supportsThreadedFontRendering()) {
+    if (m_paginator || !m_layout_queue.isEmpty()) {
+      m_layout_timer.start();
+    }
+    return;
+  }
 
-  ////    QString data = shared_domdocument->toString();
-  //    cursor.insertHtml(document);
-  //    cursor.insertBlock(pageBreak);
+  EPubLayoutJob job;
+  if (!takeLayoutJob(job)) {
+    return;
+  }
 
-  //    // mark the end of the block
-  //    int end = cursor.position();
+  m_layout_watcher = new QFutureWatcher<EPubChapterPages>(q_ptr);
+  QObject::connect(m_layout_watcher,
+                   &QFutureWatcher<EPubChapterPages>::finished,
+                   q_ptr,
+                   [this]() { layoutFinished(); });
+  m_layout_watcher->setFuture(
+    QtConcurrent::run([job]() { return paginate(job); }));
+}
 
-  //    item->start_cursor = QTextCursor(q_ptr);
-  //    item->start_cursor.setPosition(start);
-  //    item->end_cursor = QTextCursor(q_ptr);
-  //    item->end_cursor.setPosition(end);
-  //}
-  doc_string += "</body>";
-  doc_string += "</html>";
+/*
+ * Copies the next queued chapter and everything needed to lay it out into
+ * a job.
+ *
+ * Returns false if no queued chapter is left.
+ */
+bool
+EPubDocumentPrivate::takeLayoutJob(EPubLayoutJob& job)
+{
+  Q_Q(EPubDocument);
+  while (!m_layout_queue.isEmpty() && job.html.isEmpty()) {
+    job.chapter = m_layout_queue.takeFirst();
+    job.html = chapterHtml(job.chapter);
+  }
+  if (job.html.isEmpty()) {
+    return false;
+  }
+  foreach (QString key, m_container->cssKeys()) {
+    job.stylesheets.insert(key, m_container->css(key));
+  }
+  // images not decoded yet are laid out as missing images, until their
+  // chapter is shown.
+  QSize image_size = imageSize(m_image_zoom_step);
+  foreach (QString key, m_container->imageKeys()) {
+    if (job.html.contains(key)) {
+      QImage image = m_container->closestImage(key, image_size);
+      if (!image.isNull()) {
+        job.images.insert(key, image);
+      }
+    }
+  }
+  job.font = m_page_font;
+  job.margin = q->documentMargin();
+  job.page_size = m_page_layout_size;
+  return true;
+}
 
-  cursor.insertHtml(doc_string);
-  q->setBaseUrl(QUrl()); // base url to empty.
-  m_loaded = true;
+/*
+ * Keeps the pages of a chapter unless the page size or font has changed
+ * while it was laid out, and starts on the next chapter.
+ */
+void
+EPubDocumentPrivate::layoutFinished()
+{
+  Q_Q(EPubDocument);
+  EPubChapterPages pages = m_layout_watcher->result();
+  m_layout_watcher->deleteLater();
+  m_layout_watcher = nullptr;
 
-  emit q->loadCompleted();
+  if (pages.page_size == m_page_layout_size && pages.font == m_page_font) {
+    m_chapter_pages.insert(pages.chapter, pages.positions);
+    emit q->chapterPaginated(pages.chapter);
+  } else if (!m_layout_queue.contains(pages.chapter)) {
+    m_layout_queue.prepend(pages.chapter);
+  }
+  startLayout();
+}
+
+/*
+ * Lays out the chapter being paginated on the GUI thread for LAYOUT_SLICE
+ * ms, starting on the next queued chapter if there is none, and comes back
+ * once the event loop has run. A chapter laid out at a page size or font
+ * that has since changed is dropped and queued again by paginateChapters().
+ */
+void
+EPubDocumentPrivate::layoutNextChapter()
+{
+  Q_Q(EPubDocument);
+  if (m_paginator && (m_paginator->pages().page_size != m_page_layout_size ||
+                      m_paginator->pages().font != m_page_font)) {
+    m_paginator.reset();
+  }
+  if (!m_paginator) {
+    EPubLayoutJob job;
+    if (!takeLayoutJob(job)) {
+      return;
+    }
+    // the html is parsed in this pass, the layout in the following ones.
+    m_paginator.reset(new EPubPaginator(job));
+    m_layout_timer.start();
+    return;
+  }
+
+  if (m_paginator->layout(LAYOUT_SLICE)) {
+    EPubChapterPages pages = m_paginator->pages();
+    m_paginator.reset();
+    m_layout_queue.removeAll(pages.chapter);
+    m_chapter_pages.insert(pages.chapter, pages.positions);
+    emit q->chapterPaginated(pages.chapter);
+  }
+  if (m_paginator || !m_layout_queue.isEmpty()) {
+    m_layout_timer.start();
+  }
+}
+
+/*!
+ * \brief Lays out a chapter in a QTextDocument of the worker's own and
+ * finds where its pages start.
+ *
+ * This runs on the global thread pool, it only uses the job. Where text
+ * cannot be laid out on other threads the chapter is laid out in slices on
+ * the GUI thread instead, see layoutNextChapter().
+ */
+EPubChapterPages
+EPubDocumentPrivate::paginate(const EPubLayoutJob& job)
+{
+  EBOOK_TRACE_SCOPE("EPubDocumentPrivate::paginate");
+  EPubPaginator paginator(job);
+  paginator.layout();
+  return paginator.pages();
+}
+
+EPubPaginator::EPubPaginator(const EPubLayoutJob& job)
+  : m_page(-1)
+{
+  m_pages.chapter = job.chapter;
+  m_pages.page_size = job.page_size;
+  m_pages.font = job.font;
+
+  m_document.setDefaultFont(job.font);
+  m_document.setDocumentMargin(job.margin);
+  for (QHash<QString, QString>::const_iterator it =
+         job.stylesheets.constBegin();
+       it != job.stylesheets.constEnd();
+       ++it) {
+    m_document.addResource(
+      QTextDocument::StyleSheetResource, QUrl(it.key()), it.value());
+  }
+  for (QHash<QString, QImage>::const_iterator it = job.images.constBegin();
+       it != job.images.constEnd();
+       ++it) {
+    m_document.addResource(
+      QTextDocument::ImageResource, QUrl(it.key()), it.value());
+  }
+  m_document.setPageSize(job.page_size);
+  QTextCursor cursor(&m_document);
+  cursor.insertHtml(job.html);
+  m_block = m_document.begin();
+}
+
+/*!
+ * \brief Finds the pages of the next blocks of the chapter for up to msecs
+ * ms, or of all of them if msecs is negative.
+ *
+ * A whole document is laid out lazily by QTextDocumentLayout, asking for
+ * the position of a block only lays it out as far as that block, so the
+ * cost is spread over the calls.
+ *
+ * \return true once every block has been done.
+ */
+bool
+EPubPaginator::layout(int msecs)
+{
+  QAbstractTextDocumentLayout* layout = m_document.documentLayout();
+  qreal height = m_pages.page_size.height();
+  QElapsedTimer elapsed;
+  elapsed.start();
+  while (m_block.isValid() && (msecs < 0 || elapsed.elapsed() < msecs)) {
+    // the lines of a block are only there once the layout has passed it,
+    // lines are moved onto the next page rather than split across two.
+    QTextBlock next = m_block.next();
+    if (next.isValid()) {
+      layout->blockBoundingRect(next);
+    } else {
+      m_document.pageCount();
+    }
+    qreal top = layout->blockBoundingRect(m_block).top();
+    QTextLayout* block_layout = m_block.layout();
+    for (int i = 0; i < block_layout->lineCount(); i++) {
+      QTextLine line = block_layout->lineAt(i);
+      int line_page = int((top + line.y()) / height);
+      // a page taken up by a single tall image starts where it does.
+      while (m_page < line_page) {
+        m_pages.positions.append(m_block.position() + line.textStart());
+        m_page++;
+      }
+    }
+    m_block = next;
+  }
+  if (m_block.isValid()) {
+    return false;
+  }
+  if (m_pages.positions.isEmpty()) {
+    m_pages.positions.append(0);
+  }
+  return true;
+}
+
+int
+EPubDocumentPrivate::currentChapter() const
+{
+  return m_current_document_index;
+}
+
+int
+EPubDocumentPrivate::chapterCount()
+{
+  return m_container->spineKeys().size();
+}
+
+/*!
+ * \brief Moves the document to another spine item.
+ *
+ * \param index the position of the chapter in the spine.
+ * \return true if the chapter was loaded, otherwise false.
+ */
+bool
+EPubDocumentPrivate::setCurrentChapter(int index)
+{
+  if (index == m_current_document_index && m_loaded) {
+    return true;
+  }
+  return loadChapter(index);
+}
+
+/*!
+ * \brief Moves the document to the spine item with the idref id.
+ */
+bool
+EPubDocumentPrivate::showChapter(const QString& id)
+{
+  int index = m_container->spineKeys().indexOf(id);
+  if (index < 0) {
+    return false;
+  }
+  return setCurrentChapter(index);
+}
+
+/*!
+ * \brief Finds the spine item of a file href, any fragment is ignored.
+ *
+ * Table of contents links are relative to the navigation file rather than
+ * to the package, so a href that matches neither the manifest href nor the
+ * full path is matched on its file name alone.
+ *
+ * \return the position of the chapter in the spine, or -1.
+ */
+int
+EPubDocumentPrivate::chapterOfHref(const QString& href)
+{
+  if (m_href_chapters.isEmpty()) {
+    QStringList spine_keys = m_container->spineKeys();
+    // the first chapter with a file name wins, later ones do not replace
+    // it.
+    for (int i = spine_keys.size() - 1; i >= 0; i--) {
+      SharedManifestItem item = m_container->item(spine_keys.at(i));
+      if (item.isNull()) {
+        continue;
+      }
+      m_href_chapters.insert(item->href, i);
+      m_href_chapters.insert(item->path, i);
+      m_href_chapters.insert(QFileInfo(item->href).fileName(), i);
+    }
+  }
+  QString file = href.section('#', 0, 0);
+  if (file.isEmpty()) {
+    return -1;
+  }
+  int index = m_href_chapters.value(file, -1);
+  if (index < 0) {
+    index = m_href_chapters.value(QFileInfo(file).fileName(), -1);
+  }
+  return index;
 }
 
 QString
-EPubDocumentPrivate::toc()
+EPubDocumentPrivate::chapterSource()
 {
-  return m_container->tocAsString();
+  QStringList spine_keys = m_container->spineKeys();
+  if (m_current_document_index < 0 ||
+      m_current_document_index >= spine_keys.size()) {
+    return QString();
+  }
+  return m_container->itemDocument(spine_keys.at(m_current_document_index));
 }
 
-// QVariant EPubDocumentPrivate::loadResource(int type, const QUrl& url)
-//{
-//  Q_Q(EPubDocument);
+/*!
+ * \brief The body of a spine item.
+ *
+ * Items that were not loaded before are released again once they are
+ * outside the window around the chapter shown, so that reading the whole
+ * book does not keep it all in memory.
+ */
+QString
+EPubDocumentPrivate::chapterSourceAt(int index)
+{
+  QStringList spine_keys = m_container->spineKeys();
+  if (index < 0 || index >= spine_keys.size()) {
+    return QString();
+  }
+  QString key = spine_keys.at(index);
+  SharedManifestItem item = m_container->item(key);
+  if (item.isNull()) {
+    return QString();
+  }
+  bool loaded = item->loaded;
+  QString source = m_container->itemDocument(key);
+  if (!loaded && qAbs(index - m_current_document_index) > CHAPTER_WINDOW) {
+    m_container->unloadItem(key);
+  }
+  return source;
+}
+
+/*!
+ * \brief Replaces the body of a spine item.
+ *
+ * The chapter shown is loaded again, any other chapter is only laid out
+ * when it is next shown.
+ */
+bool
+EPubDocumentPrivate::setChapterSource(int index, const QString& source)
+{
+  Q_Q(EPubDocument);
+
+  QStringList spine_keys = m_container->spineKeys();
+  if (index < 0 || index >= spine_keys.size() || source.isEmpty()) {
+    return false;
+  }
+  m_container->setItemDocument(spine_keys.at(index), source);
+  m_chapter_pages.remove(index);
+  m_modified = true;
+  emit q->chapterSourceChanged(index);
+  if (index == m_current_document_index && m_loaded) {
+    return loadChapter(index);
+  }
+  return true;
+}
+
+/*!
+ * \brief Replaces the chapter shown with the chapter as it is in the book.
+ */
+bool
+EPubDocumentPrivate::reloadChapter()
+{
+  return loadChapter(m_current_document_index);
+}
 
-//  if (url.scheme() == "svgcache") {
-//    return getSvgImage(url.path());
-//  }
+EBookToc
+EPubDocumentPrivate::toc()
+{
+  return m_container->toc();
+}
 
-//  QSharedPointer<QIODevice> ioDevice = m_container->zipFile(url.path());
-//  if (!ioDevice) {
-//    //    qWarning() << "Unable to get io device for" << url;
-//    return QVariant();
-//  }
-//  QByteArray data = ioDevice->readAll();
+/*!
+ * \brief Resolves an image or stylesheet when the layout first needs it.
+ *
+ * The data comes from the container, which only reads the manifest item from
+ * the archive on first use. The result is added as a resource so that later
+ * layouts of the same chapter do not ask again, the resources are dropped
+ * when the next chapter is loaded.
+ *
+ * \return the resource, or an invalid QVariant if the container does not
+ *         hold it.
+ */
+QVariant
+EPubDocumentPrivate::loadResource(int type, const QUrl& name)
+{
+  Q_Q(EPubDocument);
 
-//  if (type == QTextDocument::StyleSheetResource) {
-//    QString cssData = QString::fromLocal8Bit(data);
-//    cssData.replace("@charset \"", "@charset\"");
-//    data = cssData.toLocal8Bit();
-//  }
+  QString key = name.toString();
+  QVariant resource;
 
-//  q->addResource(type, url, data);
+  if (type == QTextDocument::ImageResource) {
+    if (!m_container->imageKeys().contains(key)) {
+      return resource;
+    }
+    QSize image_size = imageSize(m_image_zoom_step);
+    QImage image = m_container->cachedImage(key, image_size);
+    if (image.isNull()) {
+      // after a zoom the closest size already decoded stands in until this
+      // one arrives, only images never decoded before are decoded here.
+      image = m_container->closestImage(key, image_size);
+      if (image.isNull()) {
+        // svg images return a placeholder until the background render
+        // arrives.
+        image = m_container->image(key, image_size);
+      } else {
+        m_container->prepareImage(key, image_size);
+      }
+    }
+    if (!image.isNull()) {
+      resource = QVariant(image);
+      m_chapter_images.insert(key);
+      // the zooms either side are ready before the view reaches them.
+      if (m_image_zoom_step > 0) {
+        m_container->prepareImage(key, imageSize(m_image_zoom_step - 1));
+      }
+      if (m_image_zoom_step < IMAGE_ZOOM_COUNT - 1) {
+        m_container->prepareImage(key, imageSize(m_image_zoom_step + 1));
+      }
+    }
 
-//  return data;
-//}
+  } else if (type == QTextDocument::StyleSheetResource) {
+    if (!m_container->cssKeys().contains(key)) {
+      return resource;
+    }
+    resource = QVariant(m_container->css(key));
+  }
+
+  if (resource.isValid()) {
+    q->addResource(type, name, resource);
+  }
+  return resource;
+}
 
 EPubContents*
 EPubDocumentPrivate::cloneData()
@@ -287,16 +955,98 @@ EPubDocumentPrivate::setTitle(QString title)
   if (!first.isNull()) {
     first->title = title;
     m_modified = true;
+    m_container->markChanged();
   } else {
     first = Title(new EBookTitle());
     first->title = title;
     m_container->metadata()->orderedTitles().insert(1, first);
     m_modified = true;
+    m_container->markChanged();
   }
 }
 
+void
+EPubDocumentPrivate::setImageCacheSize(int megabytes)
+{
+  m_container->setImageCacheSize(megabytes);
+}
+
+/*
+ * The size images are decoded at for a zoom step, the page less its
+ * margins at 1.0. Images are never decoded larger than they are, so at the
+ * higher zooms large images are shown at their full resolution.
+ */
+QSize
+EPubDocumentPrivate::imageSize(int step) const
+{
+  Q_Q(const EPubDocument);
+  qreal zoom = IMAGE_ZOOMS[step];
+  return QSize(
+    int((q->pageSize().width() - q->documentMargin() * 4) * zoom),
+    int((q->pageSize().height() - q->documentMargin() * 4) * zoom));
+}
+
+/*!
+ * \brief Shows the images of the chapter at the zoom step closest to zoom.
+ *
+ * Images already decoded at that step are swapped in at once, the rest are
+ * shown at the closest size decoded so far until their own arrives.
+ */
+void
+EPubDocumentPrivate::setImageZoom(qreal zoom)
+{
+  Q_Q(EPubDocument);
+  int step = 0;
+  for (int i = 1; i < IMAGE_ZOOM_COUNT; i++) {
+    if (qAbs(IMAGE_ZOOMS[i] - zoom) < qAbs(IMAGE_ZOOMS[step] - zoom)) {
+      step = i;
+    }
+  }
+  if (step == m_image_zoom_step) {
+    return;
+  }
+  m_image_zoom_step = step;
+  foreach (QString key, m_chapter_images) {
+    loadResource(QTextDocument::ImageResource, QUrl(key));
+  }
+  q->markContentsDirty(0, q->characterCount());
+}
+
+EBookMemoryUsage
+EPubDocumentPrivate::memoryUsage() const
+{
+  Q_Q(const EPubDocument);
+  EBookMemoryUsage usage = m_container->memoryUsage();
+  usage.text_document = q->textDocumentBytes();
+  return usage;
+}
+
+void
+EPubDocumentPrivate::setCompressionLevel(int level)
+{
+  m_container->setCompressionLevel(level);
+}
+
+void
+EPubDocumentPrivate::setParseCacheDirectory(const QString& directory)
+{
+  m_container->setParseCacheDirectory(directory);
+}
+
+QString
+EPubDocumentPrivate::language() const
+{
+  return m_container->language();
+}
+
 Metadata
 EPubDocumentPrivate::metadata()
 {
   return m_container->metadata();
 }
+
+SharedBookSnapshot
+EPubDocumentPrivate::snapshot()
+{
+  return m_container->snapshot();
+}
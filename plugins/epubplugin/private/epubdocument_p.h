@@ -2,15 +2,62 @@
 #define EPUBDOCUMENT_P_H
 
 #include <QElapsedTimer>
+#include <QFont>
+#include <QFutureWatcher>
+#include <QHash>
 #include <QImage>
 #include <QObject>
 #include <QPainter>
+#include <QSet>
 #include <QSvgRenderer>
+#include <QScopedPointer>
+#include <QTextBlock>
 #include <QTextCursor>
+#include <QTextDocument>
+#include <QTimer>
 
 #include "epubcontainer.h"
 #include "epubdocument.h"
 
+// a chapter to be paginated in a worker, with everything that its own
+// QTextDocument needs to lay it out, see EPubDocumentPrivate::paginate().
+struct EPubLayoutJob
+{
+  int chapter = -1;
+  QString html;
+  QHash<QString, QString> stylesheets; // href -> css.
+  QHash<QString, QImage> images;       // id -> image, as decoded so far.
+  QFont font;
+  qreal margin = 0;
+  QSizeF page_size;
+};
+
+// the positions that the pages of a chapter start at.
+struct EPubChapterPages
+{
+  int chapter = -1;
+  QSizeF page_size;
+  QFont font;
+  QList<int> positions;
+};
+
+// lays out a chapter in a QTextDocument of its own a slice at a time and
+// finds where its pages start, see EPubDocumentPrivate::paginate().
+class EPubPaginator
+{
+public:
+  explicit EPubPaginator(const EPubLayoutJob& job);
+
+  bool layout(int msecs = -1);
+  const EPubChapterPages& pages() const { return m_pages; }
+
+private:
+  QTextDocument m_document;
+  QTextBlock m_block; // the next block to find the pages of.
+  int m_page;         // the page of the last line found.
+  EPubChapterPages m_pages;
+};
+
 class EPubDocumentPrivate : public ITextDocumentPrivate
 {
 public:
@@ -21,8 +68,10 @@ public:
 
   bool loaded();
   void openDocument(const QString& path);
+  void openParsedDocument(EPubContainer* container);
   void saveDocument(const QString& path = QString());
   QString filename();
+  void setFilename(const QString& filename);
   //  void clearCache();
   EPubContents* cloneData();
   void setClonedData(EPubContents* cloneData);
@@ -34,29 +83,87 @@ public:
   IEBookInterface* plugin() { return m_plugin; }
   void setPlugin(IEBookInterface* plugin) { m_plugin = plugin; }
 
-  QString language() const {}
+  QString language() const;
   void setLanguage(const QString& language) {}
   QDateTime date() const {}
   void setDate(const QDateTime& date) {}
   //  void setDocumentPath(const QString& documentPath);
   Metadata metadata();
+  SharedBookSnapshot snapshot();
+  void setImageCacheSize(int megabytes);
+  EBookMemoryUsage memoryUsage() const;
+  void setImageZoom(qreal zoom);
+  void setCompressionLevel(int level);
+  void setParseCacheDirectory(const QString& directory);
 
-  QString buildTocFromFiles();
+  EBookToc buildTocFromFiles();
 
   bool isModified() const;
 
+  int currentChapter() const;
+  int chapterCount();
+  bool setCurrentChapter(int index);
+  bool showChapter(const QString& id);
+  int chapterOfHref(const QString& href);
+  QString chapterSource();
+  QString chapterSourceAt(int index);
+  bool setChapterSource(int index, const QString& source);
+  bool reloadChapter();
+  void setPageLayoutSize(const QSizeF& size);
+  int chapterPageCount(int index) const;
+  int pagePosition(int index, int page) const;
+
 protected:
   //  QString m_documentPath;
   bool m_loaded;
-  bool m_current_document_index;
-  bool m_current_document_lineno;
+  int m_current_document_index;
+  int m_current_document_lineno;
   EPubContainer* m_container;
   bool m_modified;
+  // the spine position of each chapter by its href, its full path and its
+  // file name, built when first needed.
+  QHash<QString, int> m_href_chapters;
+  // the images added as resources of the chapter shown.
+  QSet<QString> m_chapter_images;
+  int m_image_zoom_step; // index into IMAGE_ZOOMS.
+  // the chapters are paginated at this size and font, see paginate().
+  QSizeF m_page_layout_size;
+  QFont m_page_font;
+  QHash<int, QList<int>> m_chapter_pages; // chapter -> page positions.
+  QList<int> m_layout_queue;              // chapters waiting for a worker.
+  QFutureWatcher<EPubChapterPages>* m_layout_watcher;
+  // paginates a chapter on the GUI thread each time the event loop comes
+  // round, where text cannot be laid out on other threads.
+  QTimer m_layout_timer;
+  QScopedPointer<EPubPaginator> m_paginator; // the chapter being laid out.
+  bool m_chapter_edited; // the chapter shown has been edited.
+
+  // the number of spine items either side of the current one that are kept
+  // loaded, anything further away is released.
+  static const int CHAPTER_WINDOW = 1;
+  // the zooms that images are decoded at, views zoomed in between are
+  // shown the closest.
+  static const qreal IMAGE_ZOOMS[];
+  static const int IMAGE_ZOOM_COUNT = 4;
+  // how long each pass of a GUI thread pagination lays out for.
+  static const int LAYOUT_SLICE = 5; // ms.
 
   EPubDocumentPrivate(EPubDocumentPrivate& d);
   void loadDocument();
-  QString toc();
-  //  virtual QVariant loadResource(int, const QUrl&);
+  void connectContainer();
+  void showLoadedDocument();
+  bool loadChapter(int index);
+  void updateChapterWindow();
+  QString chapterHtml(int index);
+  void paginateChapters();
+  void startLayout();
+  bool takeLayoutJob(EPubLayoutJob& job);
+  void layoutFinished();
+  void layoutNextChapter();
+  static EPubChapterPages paginate(const EPubLayoutJob& job);
+  EBookToc toc();
+  QVariant loadResource(int type, const QUrl& name);
+  QSize imageSize(int step) const;
   //  void fixImages(SharedDomDocument newDocument);
   //  const QImage& getSvgImage(const QString& id);
 
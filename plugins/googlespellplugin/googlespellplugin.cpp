@@ -0,0 +1,523 @@
+#include "googlespellplugin.h"
+
+#include <QDir>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QNetworkRequest>
+
+#include <qlogger/qlogger.h>
+
+#include "hunspellcache.h"
+#include "options.h"
+
+using namespace qlogger;
+
+const QString GoogleSpellPlugin::m_plugin_name = "Google Spell";
+const QString GoogleSpellPlugin::m_plugin_group = "Spellchecker";
+const QString GoogleSpellPlugin::m_vendor = "SM Electronic Components";
+const int GoogleSpellPlugin::m_major_version = GOOGLE_VERSION_MAJOR;
+const int GoogleSpellPlugin::m_minor_version = GOOGLE_VERSION_MINOR;
+const int GoogleSpellPlugin::m_build_version = GOOGLE_VERSION_BUILD;
+const QString GoogleSpellPlugin::m_version =
+    QString("%1.%2.%3")
+        .arg(GoogleSpellPlugin::m_major_version)
+        .arg(GoogleSpellPlugin::m_minor_version)
+        .arg(GoogleSpellPlugin::m_build_version);
+bool GoogleSpellPlugin::m_loaded = false;
+
+GoogleSpellPlugin::GoogleSpellPlugin(QObject *parent)
+    : QObject(parent), m_local(nullptr), m_options(nullptr),
+      m_network(new QNetworkAccessManager(this)), m_in_flight(0) {
+  qRegisterMetaType<SpellResults>("SpellResults");
+  m_batch_timer.setSingleShot(true);
+  m_batch_timer.setInterval(BATCH_DELAY);
+  connect(&m_batch_timer, &QTimer::timeout, this,
+          &GoogleSpellPlugin::sendBatches);
+}
+
+GoogleSpellPlugin::~GoogleSpellPlugin() { HunspellCache::instance()->save(); }
+
+/*!
+ * \brief Sets the checker whose verdicts are sent while the server is
+ * asked, normally Hunspell.
+ *
+ * The checker is another plugin, so its signals are connected by name.
+ */
+void GoogleSpellPlugin::setLocalChecker(ISpellInterface *checker) {
+  QObject *local = dynamic_cast<QObject *>(m_local);
+  if (local) {
+    disconnect(local, nullptr, this, nullptr);
+  }
+  m_local = checker;
+  local = dynamic_cast<QObject *>(m_local);
+  if (!local) {
+    return;
+  }
+  connect(local, SIGNAL(wordCorrect(QString)), this,
+          SIGNAL(wordCorrect(QString)));
+  connect(local, SIGNAL(wordUnknown(QString)), this,
+          SIGNAL(wordUnknown(QString)));
+  connect(local, SIGNAL(wordMatched(QString, QString)), this,
+          SIGNAL(wordMatched(QString, QString)));
+  connect(local, SIGNAL(wordSuggestions(QStringList)), this,
+          SIGNAL(wordSuggestions(QStringList)));
+  connect(local, SIGNAL(wordsChecked(SpellResults)), this,
+          SLOT(localWordsChecked(SpellResults)));
+  m_local->setLanguage(m_language);
+}
+
+/*!
+ * \brief Reads the server from the options, and the verdicts it gave in
+ * earlier sessions from the spelling cache.
+ */
+void GoogleSpellPlugin::setOptions(Options *options) {
+  m_options = options;
+  if (!m_options) {
+    return;
+  }
+  HunspellCache::instance()->setDirectory(m_options->configDirectory() +
+                                          QDir::separator() + "spelling");
+  m_server = QUrl(m_options->spellServer());
+  if (!m_server.isValid() || m_server.host().isEmpty()) {
+    m_server.clear();
+    return;
+  }
+  loadCache(m_language);
+  // open the connection now, rather than on the first batch.
+  if (m_server.scheme() == "https") {
+    m_network->connectToHostEncrypted(m_server.host(),
+                                      quint16(m_server.port(443)));
+  } else {
+    m_network->connectToHost(m_server.host(), quint16(m_server.port(80)));
+  }
+}
+
+/*
+ * Reads the server's verdicts from earlier sessions, they are thrown away
+ * if they came from a different server.
+ */
+void GoogleSpellPlugin::loadCache(const QString &language) {
+  if (m_server.isEmpty()) {
+    return;
+  }
+  HunspellCache::instance()->load(cacheName(language),
+                                  qint64(qHash(m_server.toString())));
+}
+
+void GoogleSpellPlugin::checkWord(QString word) {
+  checkWords(QStringList() << word);
+}
+
+/*!
+ * \brief Checks words against the word lists, the word matches and the
+ * server's cached verdicts, then hands those left to the local checker
+ * and queues them for the server.
+ */
+void GoogleSpellPlugin::checkWords(QStringList words) {
+  QStringList unknown = uncheckedWords(m_language, words);
+  if (!unknown.isEmpty() && m_local) {
+    m_local->checkWords(unknown);
+  }
+}
+
+/*!
+ * \brief Checks words in a language other than that of the book.
+ *
+ * \param language - a BCP 47 language tag, if empty the book language is
+ * used.
+ */
+void GoogleSpellPlugin::checkWords(QStringList words, QString language) {
+  if (language.isEmpty()) {
+    checkWords(words);
+    return;
+  }
+  loadCache(language);
+  QStringList unknown = uncheckedWords(language, words);
+  if (!unknown.isEmpty() && m_local) {
+    m_local->checkWords(unknown, language);
+  }
+}
+
+void GoogleSpellPlugin::setLanguage(QString language) {
+  m_language = language;
+  loadCache(m_language);
+  if (m_local) {
+    m_local->setLanguage(language);
+  }
+}
+
+/*!
+ * \brief Checks all the words of a book.
+ *
+ * The local checker checks the book in parallel as usual, the words go to
+ * the server in full batches.
+ */
+void GoogleSpellPlugin::checkBook(QStringList words) {
+  words.removeDuplicates();
+  QStringList unknown = uncheckedWords(m_language, words);
+  if (!unknown.isEmpty() && m_local) {
+    m_local->checkBook(unknown);
+  }
+}
+
+/*!
+ * \brief Queues whole sentences for the server's grammar check, the issues
+ * found are sent by sentenceChecked().
+ */
+void GoogleSpellPlugin::checkSentences(QStringList sentences) {
+  if (!serverAvailable()) {
+    return;
+  }
+  QStringList &queue = m_sentences[m_language];
+  foreach (QString sentence, sentences) {
+    if (!sentence.trimmed().isEmpty()) {
+      queue << sentence;
+    }
+  }
+  if (queue.size() >= MAX_BATCH_SENTENCES) {
+    sendBatches();
+  } else if (!queue.isEmpty() && !m_batch_timer.isActive()) {
+    m_batch_timer.start();
+  }
+}
+
+/*
+ * Sends the verdicts that are already known and queues the other words
+ * for the server.
+ *
+ * Returns the words that must go to the local checker, without repeats.
+ */
+QStringList GoogleSpellPlugin::uncheckedWords(const QString &language,
+                                              const QStringList &words) {
+  HunspellCache *cache = HunspellCache::instance();
+  QString name = cacheName(language);
+  SpellResults known;
+  QStringList unknown;
+  QSet<QString> seen;
+  foreach (QString word, words) {
+    if (m_book_list.contains(word) || m_author_list.contains(word)) {
+      known.insert(word, true);
+      emit wordCorrect(word);
+      continue;
+    }
+    QString word_match = m_words_matched.value(word);
+    if (!word_match.isEmpty()) {
+      emit wordMatched(word, word_match);
+      continue;
+    }
+    bool correct;
+    if (cache->lookup(name, word, correct)) {
+      known.insert(word, correct);
+      if (correct)
+        emit wordCorrect(word);
+      else
+        emit wordUnknown(word);
+    } else if (!seen.contains(word)) {
+      seen.insert(word);
+      unknown << word;
+    }
+  }
+  if (!known.isEmpty()) {
+    emit wordsChecked(known);
+  }
+  queueWords(language, unknown);
+  return unknown;
+}
+
+void GoogleSpellPlugin::queueWords(const QString &language,
+                                   const QStringList &words) {
+  if (!serverAvailable()) {
+    return;
+  }
+  QString name = cacheName(language);
+  QStringList &queue = m_words[language];
+  foreach (QString word, words) {
+    QString key = name + '/' + word;
+    if (!m_queued.contains(key)) {
+      m_queued.insert(key);
+      queue << word;
+    }
+  }
+  if (queue.size() >= MAX_BATCH_WORDS) {
+    sendBatches();
+  } else if (!queue.isEmpty() && !m_batch_timer.isActive()) {
+    // the words typed in the next BATCH_DELAY go in the same batch.
+    m_batch_timer.start();
+  }
+}
+
+/*
+ * The server is asked once it is set, but left alone for RETRY_DELAY after
+ * a batch has failed.
+ */
+bool GoogleSpellPlugin::serverAvailable() const {
+  if (m_server.isEmpty()) {
+    return false;
+  }
+  return (!m_failed.isValid() || m_failed.hasExpired(RETRY_DELAY));
+}
+
+/*
+ * Sends the queued words and sentences, at most MAX_IN_FLIGHT batches at a
+ * time, the rest go as the replies come back.
+ */
+void GoogleSpellPlugin::sendBatches() {
+  m_batch_timer.stop();
+  if (!serverAvailable()) {
+    m_words.clear();
+    m_sentences.clear();
+    m_queued.clear();
+    return;
+  }
+  m_failed.invalidate();
+
+  QSet<QString> languages = m_words.keys().toSet();
+  languages += m_sentences.keys().toSet();
+  foreach (QString language, languages) {
+    QStringList &words = m_words[language];
+    QStringList &sentences = m_sentences[language];
+    while ((!words.isEmpty() || !sentences.isEmpty()) &&
+           m_in_flight < MAX_IN_FLIGHT) {
+      post(language, words.mid(0, MAX_BATCH_WORDS),
+           sentences.mid(0, MAX_BATCH_SENTENCES));
+      words = words.mid(MAX_BATCH_WORDS);
+      sentences = sentences.mid(MAX_BATCH_SENTENCES);
+    }
+    if (words.isEmpty()) {
+      m_words.remove(language);
+    }
+    if (sentences.isEmpty()) {
+      m_sentences.remove(language);
+    }
+  }
+}
+
+void GoogleSpellPlugin::post(const QString &language,
+                             const QStringList &words,
+                             const QStringList &sentences) {
+  QJsonObject batch;
+  batch.insert("language", language);
+  batch.insert("words", QJsonArray::fromStringList(words));
+  batch.insert("sentences", QJsonArray::fromStringList(sentences));
+
+  QNetworkRequest request(m_server);
+  request.setHeader(QNetworkRequest::ContentTypeHeader, "application/json");
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+  request.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+#endif
+  QNetworkReply *reply = m_network->post(
+      request, QJsonDocument(batch).toJson(QJsonDocument::Compact));
+  m_in_flight++;
+  connect(reply, &QNetworkReply::finished, this,
+          [this, reply, language]() { batchFinished(reply, language); });
+  QTimer::singleShot(REQUEST_TIMEOUT, reply, &QNetworkReply::abort);
+}
+
+/*
+ * Handles the server's answer to a batch. The verdicts are cached, and
+ * only those that differ from the local checker's are sent on.
+ */
+void GoogleSpellPlugin::batchFinished(QNetworkReply *reply,
+                                      QString language) {
+  m_in_flight--;
+  reply->deleteLater();
+  QString name = cacheName(language);
+
+  QJsonDocument document;
+  if (reply->error() == QNetworkReply::NoError) {
+    document = QJsonDocument::fromJson(reply->readAll());
+  }
+  if (!document.isObject()) {
+    QLOG_DEBUG(tr("Spell server error : %1").arg(reply->errorString()))
+    // the local verdicts stand.
+    m_failed.start();
+    m_queued.clear();
+    m_provisional.clear();
+    return;
+  }
+
+  QJsonObject answer = document.object();
+  QJsonObject words = answer.value("words").toObject();
+  SpellResults results, changed;
+  for (QJsonObject::const_iterator it = words.constBegin();
+       it != words.constEnd(); ++it) {
+    QString word = it.key();
+    bool correct = it.value().toBool();
+    results.insert(word, correct);
+    m_queued.remove(name + '/' + word);
+    SpellResults::iterator local = m_provisional.find(word);
+    if (local != m_provisional.end()) {
+      bool same = (local.value() == correct);
+      m_provisional.erase(local);
+      if (same) {
+        continue;
+      }
+    }
+    changed.insert(word, correct);
+    if (correct)
+      emit wordCorrect(word);
+    else
+      emit wordUnknown(word);
+  }
+  HunspellCache::instance()->insert(name, results);
+  if (!changed.isEmpty()) {
+    emit wordsChecked(changed);
+  }
+
+  foreach (QJsonValue value, answer.value("sentences").toArray()) {
+    QJsonObject sentence = value.toObject();
+    emit sentenceChecked(sentence.value("text").toString(),
+                         sentence.value("issues").toArray().toVariantList());
+  }
+
+  if (!m_words.isEmpty() || !m_sentences.isEmpty()) {
+    sendBatches();
+  }
+}
+
+/*
+ * The local verdicts are sent at once, and kept so that the server's are
+ * only sent if they differ. Any that the server has already answered,
+ * because Hunspell was slower, are put right.
+ */
+void GoogleSpellPlugin::localWordsChecked(SpellResults results) {
+  HunspellCache *cache = HunspellCache::instance();
+  QString name = cacheName(m_language);
+  SpellResults answered;
+  for (SpellResults::iterator it = results.begin(); it != results.end();
+       ++it) {
+    bool correct;
+    if (cache->lookup(name, it.key(), correct)) {
+      if (correct != it.value()) {
+        it.value() = correct;
+        answered.insert(it.key(), correct);
+      }
+    } else if (serverAvailable()) {
+      m_provisional.insert(it.key(), it.value());
+    }
+  }
+  emit wordsChecked(results);
+  for (SpellResults::const_iterator it = answered.constBegin();
+       it != answered.constEnd(); ++it) {
+    if (it.value())
+      emit wordCorrect(it.key());
+    else
+      emit wordUnknown(it.key());
+  }
+}
+
+/*!
+ * \brief Suggestions come from the local checker, so that the menu that
+ * wants them never waits on the network.
+ */
+void GoogleSpellPlugin::suggestions(QString word) {
+  if (m_local) {
+    m_local->suggestions(word);
+  }
+}
+
+void GoogleSpellPlugin::cancelSuggestions() {
+  if (m_local) {
+    m_local->cancelSuggestions();
+  }
+}
+
+void GoogleSpellPlugin::addWordToBookList(QString word) {
+  m_book_list.insert(word);
+  if (m_local) {
+    m_local->addWordToBookList(word);
+  }
+}
+
+void GoogleSpellPlugin::addWordToAuthorList(QString word) {
+  m_author_list.insert(word);
+  if (m_local) {
+    m_local->addWordToAuthorList(word);
+  }
+}
+
+void GoogleSpellPlugin::addWordMatch(QString word, QString match) {
+  m_words_matched[word] = match;
+  if (m_local) {
+    m_local->addWordMatch(word, match);
+  }
+}
+
+void GoogleSpellPlugin::setBookList(QStringList words) {
+  m_book_list = words.toSet();
+  if (m_local) {
+    m_local->setBookList(words);
+  }
+}
+
+void GoogleSpellPlugin::setAuthorList(QStringList words) {
+  m_author_list = words.toSet();
+  if (m_local) {
+    m_local->setAuthorList(words);
+  }
+}
+
+void GoogleSpellPlugin::setWordMatches(QMap<QString, QString> matches) {
+  m_words_matched.clear();
+  for (QMap<QString, QString>::const_iterator it = matches.constBegin();
+       it != matches.constEnd(); ++it) {
+    m_words_matched.insert(it.key(), it.value());
+  }
+  if (m_local) {
+    m_local->setWordMatches(matches);
+  }
+}
+
+QString GoogleSpellPlugin::pluginGroup() const { return m_plugin_group; }
+
+QString GoogleSpellPlugin::pluginName() const { return m_plugin_name; }
+
+QString GoogleSpellPlugin::vendor() const { return m_vendor; }
+
+bool GoogleSpellPlugin::loaded() const { return m_loaded; }
+
+void GoogleSpellPlugin::setLoaded(bool loaded) { m_loaded = loaded; }
+
+QString GoogleSpellPlugin::version() const { return m_version; }
+
+int GoogleSpellPlugin::majorVersion() const { return m_major_version; }
+
+int GoogleSpellPlugin::minorVersion() const { return m_minor_version; }
+
+int GoogleSpellPlugin::buildVersion() const { return m_build_version; }
+
+void GoogleSpellPlugin::buildMenu() {
+  // TODO.
+}
+
+// the dictionaries are those of the local checker.
+
+CountryData *GoogleSpellPlugin::dictionary(QString language_code) {
+  return (m_local ? m_local->dictionary(language_code) : nullptr);
+}
+
+QStringList GoogleSpellPlugin::languageCodes(QString language_code) {
+  return (m_local ? m_local->languageCodes(language_code) : QStringList());
+}
+
+QStringList GoogleSpellPlugin::compatibleLanguageCodes(QString language_code) {
+  return (m_local ? m_local->compatibleLanguageCodes(language_code)
+                  : QStringList());
+}
+
+QString GoogleSpellPlugin::language() {
+  return (m_local ? m_local->language() : QString());
+}
+
+QString GoogleSpellPlugin::country() {
+  return (m_local ? m_local->country() : QString());
+}
+
+QString GoogleSpellPlugin::path() {
+  return (m_local ? m_local->path() : QString());
+}
+
+QString GoogleSpellPlugin::bcp47() {
+  return (m_local ? m_local->bcp47() : m_language);
+}
@@ -0,0 +1,158 @@
+#ifndef GOOGLESPELLPLUGIN_H
+#define GOOGLESPELLPLUGIN_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QSet>
+#include <QTimer>
+#include <QUrl>
+#include <QVariantList>
+#include <QtPlugin>
+
+#include "interface_global.h"
+#include "ispellinterface.h"
+
+class Options;
+
+/*!
+ * \brief A spelling and grammar checker that asks a remote server.
+ *
+ * Words and sentences are never sent one at a time. They are queued and
+ * sent together once BATCH_DELAY has passed since the first of them, or
+ * as soon as a batch is full, and every batch goes through one
+ * QNetworkAccessManager, so they share a single kept alive connection,
+ * multiplexed over HTTP/2 where the server offers it.
+ *
+ * The network is never waited on. The words are handed to the local
+ * checker, normally Hunspell, at the same time, and its verdicts are sent
+ * first. Those that the server gives differently follow when it answers,
+ * and if the server cannot be reached the local verdicts stand.
+ *
+ * The server's verdicts are kept in the same cache as those of Hunspell,
+ * under a separate name for each language, and saved with it, so a word is
+ * only ever sent once. The cache is thrown away if the server is changed.
+ *
+ * The server is sent a json object with "language", "words" and
+ * "sentences" arrays, and answers with a "words" object holding true for
+ * each word that is correct and false for any that is not, and a
+ * "sentences" array of objects holding the "text" of each sentence and the
+ * "issues" found in it.
+ */
+class INTERFACESHARED_EXPORT GoogleSpellPlugin : public QObject,
+                                                 public ISpellInterface {
+  Q_OBJECT
+  Q_PLUGIN_METADATA(IID SpellInterface_iid FILE "google.json")
+  Q_INTERFACES(IPluginInterface)
+  Q_INTERFACES(ISpellInterface)
+public:
+  explicit GoogleSpellPlugin(QObject *parent = nullptr);
+  ~GoogleSpellPlugin();
+
+  // IPluginInterface interface
+  QString pluginGroup() const override;
+  QString pluginName() const override;
+  QString vendor() const override;
+  bool loaded() const override;
+  void setLoaded(bool loaded) override;
+  QString version() const override;
+  int majorVersion() const override;
+  int minorVersion() const override;
+  int buildVersion() const override;
+  void buildMenu() override;
+
+  // ISpellInterface interface
+  CountryData *dictionary(QString language_code) override;
+  QStringList languageCodes(QString language_code) override;
+  QStringList compatibleLanguageCodes(QString language_code) override;
+  QString language() override;
+  QString country() override;
+  QString path() override;
+  QString bcp47() override;
+
+  void checkWord(QString word) override;
+  void checkWords(QStringList words) override;
+  void checkWords(QStringList words, QString language) override;
+  void setLanguage(QString language) override;
+  void checkBook(QStringList words) override;
+  void checkSentences(QStringList sentences) override;
+  void suggestions(QString word) override;
+  void cancelSuggestions() override;
+  void addWordToBookList(QString word) override;
+  void addWordToAuthorList(QString word) override;
+  void addWordMatch(QString word, QString match) override;
+  void setBookList(QStringList words) override;
+  void setAuthorList(QStringList words) override;
+  void setWordMatches(QMap<QString, QString> matches) override;
+  void setLocalChecker(ISpellInterface *checker) override;
+  void setOptions(Options *options) override;
+
+signals:
+  void wordCorrect(QString);
+  void wordUnknown(QString);
+  void wordMatched(QString, QString);
+  void wordSuggestions(QStringList);
+  // the results of a batch of checkWords(), true if the word is correct.
+  void wordsChecked(SpellResults);
+  // the issues found in a sentence, each a map of "offset", "length" and
+  // "message".
+  void sentenceChecked(QString sentence, QVariantList issues);
+
+protected slots:
+  void localWordsChecked(SpellResults results);
+
+protected:
+  static const QString m_plugin_group;
+  static const QString m_plugin_name;
+  static const QString m_vendor;
+  static const QString m_version;
+  static const int m_major_version;
+  static const int m_minor_version;
+  static const int m_build_version;
+  static bool m_loaded;
+
+  ISpellInterface *m_local;
+  Options *m_options;
+  QNetworkAccessManager *m_network;
+  QUrl m_server;
+  QString m_language; // that of the book.
+
+  QSet<QString> m_book_list;
+  QSet<QString> m_author_list;
+  QHash<QString, QString> m_words_matched;
+
+  // waiting for the next batch, by language.
+  QHash<QString, QStringList> m_words;
+  QHash<QString, QStringList> m_sentences;
+  QSet<QString> m_queued;
+  // the local verdicts on the words sent, only changes are sent on.
+  SpellResults m_provisional;
+  QTimer m_batch_timer;
+  int m_in_flight;
+  // set while the server is left alone after a failed batch.
+  QElapsedTimer m_failed;
+
+  QStringList uncheckedWords(const QString &language,
+                             const QStringList &words);
+  void queueWords(const QString &language, const QStringList &words);
+  void sendBatches();
+  void post(const QString &language, const QStringList &words,
+            const QStringList &sentences);
+  void batchFinished(QNetworkReply *reply, QString language);
+  bool serverAvailable() const;
+  void loadCache(const QString &language);
+  static QString cacheName(const QString &language) {
+    return "remote_" + (language.isEmpty() ? QString("default") : language);
+  }
+
+  static const int BATCH_DELAY = 250; // ms
+  static const int MAX_BATCH_WORDS = 500;
+  static const int MAX_BATCH_SENTENCES = 50;
+  // batches sent at once, all on the one connection.
+  static const int MAX_IN_FLIGHT = 4;
+  static const int REQUEST_TIMEOUT = 10000; // ms
+  static const int RETRY_DELAY = 60000;     // ms
+};
+
+#endif // GOOGLESPELLPLUGIN_H
@@ -0,0 +1,47 @@
+TEMPLATE        = lib
+CONFIG         += plugin
+QT             += core gui network
+CONFIG += c++14
+
+TARGET          = googlespellplugin
+DESTDIR = $$OUT_PWD/..
+
+VERSION_MAJOR = 0
+VERSION_MINOR = 1
+VERSION_BUILD = 0
+
+DEFINES += \
+       "GOOGLE_VERSION_MAJOR=$$VERSION_MAJOR" \
+       "GOOGLE_VERSION_MINOR=$$VERSION_MINOR" \
+       "GOOGLE_VERSION_BUILD=$$VERSION_BUILD"
+
+# the verdicts are kept in the same cache as those of Hunspell.
+INCLUDEPATH += $$PWD/../hunspellplugin
+DEPENDPATH += $$PWD/../hunspellplugin
+
+HEADERS         = \
+    googlespellplugin.h \
+    ../hunspellplugin/hunspellcache.h
+
+SOURCES         = \
+    googlespellplugin.cpp \
+    ../hunspellplugin/hunspellcache.cpp
+
+DISTFILES += \
+    google.json
+
+# QLogger library
+unix|win32: LIBS += -lqloggerlib
+
+win32:CONFIG(release, debug|release): LIBS += -L$$OUT_PWD/../../interface/ -linterface
+else:win32:CONFIG(debug, debug|release): LIBS += -L$$OUT_PWD/../../interface/ -linterface
+else:unix: LIBS += -L$$OUT_PWD/../../interface/ -linterface
+
+INCLUDEPATH += $$PWD/../../interface
+DEPENDPATH += $$PWD/../../interface
+
+win32-g++:CONFIG(release, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../../interface/libinterface.a
+else:win32-g++:CONFIG(debug, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../../interface/libinterfaced.a
+else:win32:!win32-g++:CONFIG(release, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../../interface/interface.lib
+else:win32:!win32-g++:CONFIG(debug, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../../interface/interfaced.lib
+else:unix: PRE_TARGETDEPS += $$OUT_PWD/../../interface/libinterface.a
@@ -0,0 +1,178 @@
+#include "hunspellcache.h"
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QMutexLocker>
+#include <QSaveFile>
+
+const QString HunspellCache::CACHE_SUFFIX = ".spellcache";
+
+HunspellCache::HunspellCache() {}
+
+HunspellCache::~HunspellCache()
+{
+  save();
+}
+
+HunspellCache*
+HunspellCache::instance()
+{
+  static HunspellCache cache;
+  return &cache;
+}
+
+/*!
+ * \brief Sets the directory the caches are saved in, they are only kept
+ * in memory until it is set.
+ */
+void
+HunspellCache::setDirectory(const QString& directory)
+{
+  QMutexLocker locker(&m_mutex);
+  m_directory = directory;
+}
+
+bool
+HunspellCache::contains(const QString& dictionary, const QString& word) const
+{
+  QMutexLocker locker(&m_mutex);
+  return m_results.value(dictionary).contains(word);
+}
+
+/*!
+ * \brief Finds the verdict on word.
+ *
+ * \return true if the word has been checked against dictionary, in which
+ *         case correct is set.
+ */
+bool
+HunspellCache::lookup(const QString& dictionary,
+                      const QString& word,
+                      bool& correct) const
+{
+  QMutexLocker locker(&m_mutex);
+  QHash<QString, SpellResults>::const_iterator dict =
+    m_results.constFind(dictionary);
+  if (dict == m_results.constEnd()) {
+    return false;
+  }
+  SpellResults::const_iterator it = dict->constFind(word);
+  if (it == dict->constEnd()) {
+    return false;
+  }
+  correct = it.value();
+  return true;
+}
+
+void
+HunspellCache::insert(const QString& dictionary, const SpellResults& results)
+{
+  if (results.isEmpty()) {
+    return;
+  }
+  QMutexLocker locker(&m_mutex);
+  SpellResults& dict = m_results[dictionary];
+  for (SpellResults::const_iterator it = results.constBegin();
+       it != results.constEnd();
+       ++it) {
+    dict.insert(it.key(), it.value());
+  }
+  m_changed.insert(dictionary);
+}
+
+void
+HunspellCache::clear(const QString& dictionary)
+{
+  QMutexLocker locker(&m_mutex);
+  m_results.remove(dictionary);
+  m_changed.insert(dictionary);
+}
+
+/*!
+ * \brief Reads the saved cache of dictionary.
+ *
+ * Nothing is read if the cache is already loaded. A cache written for an
+ * older copy of the dictionary is ignored.
+ *
+ * \param dictionary_modified the modification time of the dictionary file.
+ * \return true if a saved cache was read.
+ */
+bool
+HunspellCache::load(const QString& dictionary, qint64 dictionary_modified)
+{
+  QMutexLocker locker(&m_mutex);
+  if (m_dictionary_modified.contains(dictionary)) {
+    return false;
+  }
+  m_dictionary_modified.insert(dictionary, dictionary_modified);
+  if (m_directory.isEmpty()) {
+    return false;
+  }
+
+  QFile file(path(dictionary));
+  if (!file.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+  QDataStream in(&file);
+  in.setVersion(QDataStream::Qt_5_6);
+  quint32 magic = 0, version = 0;
+  qint64 modified = 0;
+  in >> magic >> version >> modified;
+  if (magic != CACHE_MAGIC || version != CACHE_VERSION ||
+      modified != dictionary_modified) {
+    return false;
+  }
+  SpellResults results;
+  in >> results;
+  if (in.status() != QDataStream::Ok) {
+    return false;
+  }
+  // anything checked before the load is kept.
+  SpellResults& dict = m_results[dictionary];
+  for (SpellResults::const_iterator it = dict.constBegin();
+       it != dict.constEnd();
+       ++it) {
+    results.insert(it.key(), it.value());
+  }
+  dict = results;
+  return true;
+}
+
+/*!
+ * \brief Writes the caches that have changed since they were loaded.
+ */
+bool
+HunspellCache::save()
+{
+  QMutexLocker locker(&m_mutex);
+  if (m_directory.isEmpty()) {
+    return false;
+  }
+  QDir dir;
+  dir.mkpath(m_directory);
+  bool result = true;
+  foreach (QString dictionary, m_changed) {
+    QSaveFile file(path(dictionary));
+    if (!file.open(QIODevice::WriteOnly)) {
+      result = false;
+      continue;
+    }
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_6);
+    out << CACHE_MAGIC << CACHE_VERSION
+        << m_dictionary_modified.value(dictionary)
+        << m_results.value(dictionary);
+    result = (file.commit() && result);
+  }
+  if (result) {
+    m_changed.clear();
+  }
+  return result;
+}
+
+QString
+HunspellCache::path(const QString& dictionary) const
+{
+  return m_directory + QDir::separator() + dictionary + CACHE_SUFFIX;
+}
@@ -0,0 +1,60 @@
+#ifndef HUNSPELLCACHE_H
+#define HUNSPELLCACHE_H
+
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+
+#include "ispellinterface.h"
+
+/*!
+ * \brief A process wide store of the words already checked by Hunspell.
+ *
+ * The verdicts are kept per dictionary and are shared by every open book,
+ * so each word is only sent to Hunspell once. The cache of each dictionary
+ * is saved to its own file in the config directory and is thrown away if
+ * the dictionary has been changed since it was written.
+ *
+ * Only the dictionary verdicts are held. The book and author word lists
+ * and the word matches are checked before the cache, so a change to them
+ * is seen at once and never leaves a stale verdict behind.
+ *
+ * Every method can be called from any thread.
+ */
+class HunspellCache
+{
+public:
+  static HunspellCache* instance();
+
+  void setDirectory(const QString& directory);
+
+  bool contains(const QString& dictionary, const QString& word) const;
+  bool lookup(const QString& dictionary,
+              const QString& word,
+              bool& correct) const;
+  void insert(const QString& dictionary, const SpellResults& results);
+  void clear(const QString& dictionary);
+
+  bool load(const QString& dictionary, qint64 dictionary_modified);
+  bool save();
+
+protected:
+  HunspellCache();
+  ~HunspellCache();
+
+  QString path(const QString& dictionary) const;
+
+  mutable QMutex m_mutex;
+  QString m_directory;
+  QHash<QString, SpellResults> m_results;
+  // the modification time of each dictionary when it was loaded.
+  QHash<QString, qint64> m_dictionary_modified;
+  QSet<QString> m_changed;
+
+  static const quint32 CACHE_MAGIC = 0x42535043; // BSPC
+  static const quint32 CACHE_VERSION = 1;
+  static const QString CACHE_SUFFIX;
+};
+
+#endif // HUNSPELLCACHE_H
@@ -1,95 +1,147 @@
 #include "hunspellchecker.h"
 
+#include "ebookjobs.h"
+#include "hunspelldictionaries.h"
+#include "hunspellpool.h"
+
 /*!
- * \brief A spell checker thread that checks words in a separate
- * thread for higher speeds.
+ * \brief Checks words in the background for higher speeds.
+ *
+ * Words are queued in batches by checkWord() and checkWords(), each batch
+ * with the dictionary it is checked against. Each batch is a job in the
+ * thread pool shared with the rest of the application, see EBookJobs, so
+ * no thread is kept waiting while there is nothing to check. The results
+ * of each batch are sent back together by wordsChecked(). The dictionaries
+ * are shared with the rest of the process through HunspellDictionaries, so
+ * a dictionary is loaded once however many books use it.
+ *
+ * Suggestions are asked for by the user so their jobs are given a higher
+ * priority than any waiting batch. Suggestions that have not yet been
+ * started can be dropped with cancelSuggestions().
  *
- * \param dict_path
  * \param parent
  */
 HunspellChecker::HunspellChecker(QObject* parent)
-  : QThread(parent)
-  , m_running(true)
-  , m_dict_path(QString())
-{}
-
-HunspellChecker::HunspellChecker(QString dict_path, QObject* parent)
-  : QThread(parent)
-  , m_running(true)
-  , m_dict_path(dict_path + QDir::separator() + "dict")
-{}
+  : QObject(parent)
+{
+  qRegisterMetaType<SpellResults>("SpellResults");
+}
 
-HunspellChecker::~HunspellChecker() {}
+HunspellChecker::~HunspellChecker()
+{
+  stopRunning();
+}
 
+/*!
+ * \brief Drops every batch and suggestion that has not yet been started.
+ *
+ * The jobs only use the shared dictionaries so any that are running are
+ * left to finish, their results are not sent.
+ */
 void
 HunspellChecker::stopRunning()
 {
-  m_running = false;
+  foreach (QFutureWatcher<SpellResults>* watcher, m_batches) {
+    watcher->cancel();
+  }
+  cancelSuggestions();
 }
 
 /*!
- * \brief Checks a word against various word lists and dictionaries.
- *
- * The plugin first checks the word against maintained Author/Book word lists
- * and a list of words already checked by the spell checker, then
- * against a map of words against a match defined by the user and finally if no
- * in any of those it is passed to the spell checker.
+ * \brief Queues a single word to be checked.
  *
+ * \param dictionary - the name of the dictionary, in the form en_US.
  * \param word - a QString containing the word to check.
  */
 void
-HunspellChecker::checkWord(QString word)
+HunspellChecker::checkWord(QString dictionary, QString word)
 {
-  m_words_to_test.append(word);
+  checkWords(dictionary, QStringList() << word);
 }
 
+/*!
+ * \brief Queues a number of words to be checked as one batch.
+ *
+ * \param dictionary - the name of the dictionary, in the form en_US.
+ * \param words - a QStringList containing the words to check.
+ */
 void
-HunspellChecker::suggestions(QString word)
+HunspellChecker::checkWords(QString dictionary, QStringList words)
 {
-  m_suggestion_words.append(word);
+  if (words.isEmpty()) {
+    return;
+  }
+  QFutureWatcher<SpellResults>* watcher =
+    new QFutureWatcher<SpellResults>(this);
+  connect(watcher,
+          &QFutureWatcher<SpellResults>::finished,
+          this,
+          [this, watcher, dictionary]() {
+            batchFinished(watcher, dictionary);
+          });
+  m_batches.append(watcher);
+  watcher->setFuture(EBookJobs::submit<SpellResults>(
+    [dictionary, words](QFutureInterface<SpellResults>&) {
+      HunspellPool* pool = HunspellDictionaries::instance()->pool(dictionary);
+      return pool->check(words);
+    }));
 }
 
-/*
- * The run loop.
+/*!
+ * \brief Queues a word for suggestions, sent by wordSuggestions().
+ *
+ * \param dictionary - the name of the dictionary, in the form en_US.
+ * \param word - a QString containing the misspelt word.
  */
 void
-HunspellChecker::run()
+HunspellChecker::suggestions(QString dictionary, QString word)
 {
-  // TODO allow the user to set the libraries.
-  QString dic = m_dict_path + QDir::separator() + "en_US.dic";
-  QString aff = m_dict_path + QDir::separator() + "en_US.aff";
-
-  Hunspell* m_hunspell =
-    new Hunspell(dic.toStdString().c_str(), aff.toStdString().c_str());
-
-  QString word;
-  QStringList suggestions;
-
-  while (m_running) {
-
-    suggestions.clear();
+  QFutureWatcher<QStringList>* watcher = new QFutureWatcher<QStringList>(this);
+  connect(watcher,
+          &QFutureWatcher<QStringList>::finished,
+          this,
+          [this, watcher, dictionary, word]() {
+            suggestionFinished(watcher, dictionary, word);
+          });
+  m_suggestions.append(watcher);
+  watcher->setFuture(EBookJobs::submit<QStringList>(
+    [dictionary, word](QFutureInterface<QStringList>&) {
+      HunspellPool* pool = HunspellDictionaries::instance()->pool(dictionary);
+      return pool->suggest(word);
+    },
+    EBookJobs::HIGH_PRIORITY));
+}
 
-    if (m_words_to_test.isEmpty() && m_suggestion_words.isEmpty()) {
-      thread()->msleep(300);
-    }
+/*!
+ * \brief Drops the suggestion requests that have not yet been started.
+ */
+void
+HunspellChecker::cancelSuggestions()
+{
+  foreach (QFutureWatcher<QStringList>* watcher, m_suggestions) {
+    watcher->cancel();
+  }
+}
 
-    if (!m_words_to_test.isEmpty()) {
-      word = m_words_to_test.at(0);
-      bool result = m_hunspell->spell(word.toStdString());
-      if (result) {
-        emit wordCorrect(word);
-      } else {
-        emit wordUnknown(word);
-      }
-    }
+void
+HunspellChecker::batchFinished(QFutureWatcher<SpellResults>* watcher,
+                               QString dictionary)
+{
+  m_batches.removeOne(watcher);
+  if (!watcher->isCanceled()) {
+    emit wordsChecked(dictionary, watcher->result());
+  }
+  watcher->deleteLater();
+}
 
-    if (!m_suggestion_words.isEmpty()) {
-      word = m_suggestion_words.at(0);
-      std::vector<std::string> list = m_hunspell->suggest(word.toStdString());
-      for (std::string str : list) {
-        suggestions.append(QString::fromStdString(str));
-      }
-      emit wordSuggestions(suggestions);
-    }
+void
+HunspellChecker::suggestionFinished(QFutureWatcher<QStringList>* watcher,
+                                    QString dictionary,
+                                    QString word)
+{
+  m_suggestions.removeOne(watcher);
+  if (!watcher->isCanceled()) {
+    emit wordSuggestions(dictionary, word, watcher->result());
   }
+  watcher->deleteLater();
 }
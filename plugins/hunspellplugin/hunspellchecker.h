@@ -1,37 +1,46 @@
 #ifndef HUNSPELLCHECKER_H
 #define HUNSPELLCHECKER_H
 
-#include <QThread>
-#include <QDir>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QStringList>
 
-#include <hunspell/hunspell.hxx>
+#include "ispellinterface.h"
 
-class HunspellChecker : public QThread
+class HunspellPool;
+
+class HunspellChecker : public QObject
 {
     Q_OBJECT
 
 public:
     HunspellChecker(QObject* parent = nullptr);
-    HunspellChecker(QString dict_path, QObject* parent = nullptr);
     ~HunspellChecker();
 
     void stopRunning();
-    void checkWord(QString word);
-    void suggestions(QString word);
+    void checkWord(QString dictionary, QString word);
+    void checkWords(QString dictionary, QStringList words);
+    void suggestions(QString dictionary, QString word);
+    void cancelSuggestions();
 
 signals:
-    void wordCorrect(QString);
-    void wordUnknown(QString);
-    void wordSuggestions(QStringList);
+    void wordsChecked(QString dictionary, SpellResults results);
+    void wordSuggestions(QString dictionary,
+                         QString word,
+                         QStringList suggestions);
 
 protected:
-    bool m_running;
-    QString m_dict_path;
-
-    QStringList m_words_to_test;
-    QStringList m_suggestion_words;
-
-    void run();
+    // the jobs that have not yet finished.
+    QList<QFutureWatcher<SpellResults>*> m_batches;
+    QList<QFutureWatcher<QStringList>*> m_suggestions;
+
+    void batchFinished(QFutureWatcher<SpellResults>* watcher,
+                       QString dictionary);
+    void suggestionFinished(QFutureWatcher<QStringList>* watcher,
+                            QString dictionary,
+                            QString word);
 };
 
 #endif // HUNSPELLCHECKER_H
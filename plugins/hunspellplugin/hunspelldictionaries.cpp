@@ -0,0 +1,171 @@
+#include "hunspelldictionaries.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
+
+#include "hunspellpool.h"
+
+// used when no installed dictionary matches the language of a book.
+const QString HunspellDictionaries::DEFAULT_DICTIONARY = "en_US";
+
+HunspellDictionaries::HunspellDictionaries()
+  : m_scanned(false)
+{}
+
+HunspellDictionaries::~HunspellDictionaries()
+{
+  qDeleteAll(m_pools);
+}
+
+HunspellDictionaries*
+HunspellDictionaries::instance()
+{
+  static HunspellDictionaries dictionaries;
+  return &dictionaries;
+}
+
+/*!
+ * \brief Sets the directory that holds the .dic and .aff files.
+ *
+ * Dictionaries that are already loaded are kept.
+ */
+void
+HunspellDictionaries::setDirectory(const QString& directory)
+{
+  QMutexLocker locker(&m_mutex);
+  if (directory == m_directory) {
+    return;
+  }
+  m_directory = directory;
+  m_scanned = false;
+  m_names.clear();
+}
+
+QString
+HunspellDictionaries::directory() const
+{
+  QMutexLocker locker(&m_mutex);
+  return m_directory;
+}
+
+/*!
+ * \brief The names of the dictionaries that have both a .dic and an .aff
+ * file.
+ */
+QStringList
+HunspellDictionaries::available()
+{
+  QMutexLocker locker(&m_mutex);
+  scan();
+  return m_available;
+}
+
+/*!
+ * \brief Matches a language tag to a dictionary.
+ *
+ * en-GB matches en_GB if there is one, otherwise any en dictionary. If
+ * nothing matches, or language is empty, the default dictionary is used.
+ */
+QString
+HunspellDictionaries::dictionaryName(const QString& language)
+{
+  QString tag = language.trimmed();
+  tag.replace('-', '_');
+  QMutexLocker locker(&m_mutex);
+  if (m_names.contains(tag)) {
+    return m_names.value(tag);
+  }
+  scan();
+
+  QString name;
+  if (!tag.isEmpty()) {
+    // only the language and region subtags are used, en_Latn_GB is en_GB.
+    QStringList subtags = tag.split('_', QString::SkipEmptyParts);
+    QString primary = subtags.first().toLower();
+    QString region;
+    for (int i = 1; i < subtags.size() && region.isEmpty(); i++) {
+      QString subtag = subtags.at(i);
+      if (subtag.size() == 2 || (subtag.size() == 3 && subtag.at(0).isDigit())) {
+        region = subtag.toUpper();
+      }
+    }
+    if (!region.isEmpty() && m_available.contains(primary + "_" + region)) {
+      name = primary + "_" + region;
+    } else if (m_available.contains(primary)) {
+      name = primary;
+    } else {
+      foreach (QString dictionary, m_available) {
+        if (dictionary.startsWith(primary + "_")) {
+          name = dictionary;
+          break;
+        }
+      }
+    }
+  }
+  if (name.isEmpty()) {
+    name = DEFAULT_DICTIONARY;
+  }
+  m_names.insert(tag, name);
+  return name;
+}
+
+/*!
+ * \brief The path of the .dic file of a dictionary.
+ */
+QString
+HunspellDictionaries::dictionaryFile(const QString& dictionary) const
+{
+  QMutexLocker locker(&m_mutex);
+  return m_directory + QDir::separator() + dictionary + ".dic";
+}
+
+/*!
+ * \brief The path of the .aff file of a dictionary.
+ */
+QString
+HunspellDictionaries::affixFile(const QString& dictionary) const
+{
+  QMutexLocker locker(&m_mutex);
+  return m_directory + QDir::separator() + dictionary + ".aff";
+}
+
+/*!
+ * \brief The pool of a dictionary, created the first time it is asked
+ * for.
+ *
+ * No dictionary is read here, that waits until the pool is first used.
+ */
+HunspellPool*
+HunspellDictionaries::pool(const QString& dictionary)
+{
+  QMutexLocker locker(&m_mutex);
+  HunspellPool* pool = m_pools.value(dictionary);
+  if (!pool) {
+    QString base = m_directory + QDir::separator() + dictionary;
+    pool = new HunspellPool(base + ".aff", base + ".dic");
+    m_pools.insert(dictionary, pool);
+  }
+  return pool;
+}
+
+/*
+ * Reads the names of the dictionaries, the mutex must be held.
+ */
+void
+HunspellDictionaries::scan()
+{
+  if (m_scanned) {
+    return;
+  }
+  m_scanned = true;
+  m_available.clear();
+  QDir dir(m_directory);
+  foreach (QFileInfo info, dir.entryInfoList(QStringList() << "*.dic",
+                                             QDir::Files | QDir::Readable,
+                                             QDir::Name)) {
+    if (dir.exists(info.completeBaseName() + ".aff")) {
+      m_available << info.completeBaseName();
+    }
+  }
+}
@@ -0,0 +1,57 @@
+#ifndef HUNSPELLDICTIONARIES_H
+#define HUNSPELLDICTIONARIES_H
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+class HunspellPool;
+
+/*!
+ * \brief The process wide set of Hunspell dictionaries.
+ *
+ * Each dictionary, a .dic and .aff pair in the dictionary directory, has a
+ * single HunspellPool that is created the first time the dictionary is
+ * used and is shared by every book and every thread that checks words in
+ * its language. A Hunspell object cannot be used by two threads at once so
+ * the pool hands each thread its own, the first is made at once and the
+ * others only if threads are waiting for them.
+ *
+ * Languages are given as BCP 47 tags, as in dc:language and xml:lang, and
+ * are matched to the dictionary names, which are of the form en_US.
+ *
+ * Every method can be called from any thread.
+ */
+class HunspellDictionaries
+{
+public:
+  static HunspellDictionaries* instance();
+
+  void setDirectory(const QString& directory);
+  QString directory() const;
+
+  QStringList available();
+  QString dictionaryName(const QString& language);
+  QString dictionaryFile(const QString& dictionary) const;
+  QString affixFile(const QString& dictionary) const;
+
+  HunspellPool* pool(const QString& dictionary);
+
+  static const QString DEFAULT_DICTIONARY;
+
+protected:
+  HunspellDictionaries();
+  ~HunspellDictionaries();
+
+  mutable QMutex m_mutex;
+  QString m_directory;
+  QStringList m_available; // read from the directory when first needed.
+  bool m_scanned;
+  QHash<QString, QString> m_names; // language tag to dictionary.
+  QHash<QString, HunspellPool*> m_pools;
+
+  void scan();
+};
+
+#endif // HUNSPELLDICTIONARIES_H
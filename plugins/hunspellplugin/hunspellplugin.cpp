@@ -1,7 +1,15 @@
 #include "hunspellplugin.h"
 
 #include "ebookcommon.h"
+#include "hunspellcache.h"
 #include "hunspellchecker.h"
+#include "hunspelldictionaries.h"
+#include "options.h"
+
+#include <QFileInfo>
+#include <QRegExp>
+#include <QSet>
+#include <QtConcurrent>
 #include "ispellinterface.h"
 
 const QString HunspellPlugin::m_plugin_name = "Hunspell";
@@ -17,66 +25,77 @@ const QString HunspellPlugin::m_version =
         .arg(HunspellPlugin::m_build_version);
 bool HunspellPlugin::m_loaded = false;
 
-HunspellPlugin::HunspellPlugin(QObject *parent) : QObject(parent) {
+HunspellPlugin::HunspellPlugin(QObject *parent)
+    : QObject(parent), m_suggestion_cache(SUGGESTION_CACHE_SIZE),
+      m_checker(nullptr),
+      m_dictionary(HunspellDictionaries::DEFAULT_DICTIONARY),
+      m_options(nullptr) {
 
   m_checker = new HunspellChecker(this);
 
-  // pass correct words to correct word handler.
-  connect(m_checker, &HunspellChecker::wordCorrect, this,
-          &HunspellPlugin::receivedWordCorrect);
-  // pass unknown words straight through.
-  connect(m_checker, &HunspellChecker::wordUnknown, this,
-          &HunspellPlugin::wordUnknown);
-  // pass suggestions straight through
+  // pass the checked words to the checked words handler.
+  connect(m_checker, &HunspellChecker::wordsChecked, this,
+          &HunspellPlugin::receivedWordsChecked);
+  // pass suggestions on through the suggestion cache.
   connect(m_checker, &HunspellChecker::wordSuggestions, this,
-          &HunspellPlugin::wordSuggestions);
-
-  // start thread
-  //  m_checker->start();
+          &HunspellPlugin::receivedSuggestions);
+  connect(&m_book_watcher, &QFutureWatcher<SpellResults>::resultsReadyAt,
+          this, &HunspellPlugin::bookShardsChecked);
+  connect(&m_book_watcher, &QFutureWatcher<SpellResults>::finished, this,
+          &HunspellPlugin::bookCheckFinished);
 }
 
 HunspellPlugin::HunspellPlugin(Options *options, QString dict_path,
                                QObject *parent)
-    : QObject(parent), m_options(options) {
-
-  // create spell checker thread.
-  m_checker = new HunspellChecker(dict_path, this);
-
-  // pass correct words to correct word handler.
-  connect(m_checker, &HunspellChecker::wordCorrect, this,
-          &HunspellPlugin::receivedWordCorrect);
-  // pass unknown words straight through.
-  connect(m_checker, &HunspellChecker::wordUnknown, this,
-          &HunspellPlugin::wordUnknown);
-  // pass suggestions straight through
+    : QObject(parent), m_suggestion_cache(SUGGESTION_CACHE_SIZE),
+      m_checker(nullptr),
+      m_dictionary(HunspellDictionaries::DEFAULT_DICTIONARY),
+      m_options(options) {
+
+  HunspellDictionaries::instance()->setDirectory(dict_path +
+                                                 QDir::separator() + "dict");
+
+  // create the spell checker.
+  m_checker = new HunspellChecker(this);
+
+  // pass the checked words to the checked words handler.
+  connect(m_checker, &HunspellChecker::wordsChecked, this,
+          &HunspellPlugin::receivedWordsChecked);
+  // pass suggestions on through the suggestion cache.
   connect(m_checker, &HunspellChecker::wordSuggestions, this,
-          &HunspellPlugin::wordSuggestions);
+          &HunspellPlugin::receivedSuggestions);
+  connect(&m_book_watcher, &QFutureWatcher<SpellResults>::resultsReadyAt,
+          this, &HunspellPlugin::bookShardsChecked);
+  connect(&m_book_watcher, &QFutureWatcher<SpellResults>::finished, this,
+          &HunspellPlugin::bookCheckFinished);
+
+  // the words checked in earlier sessions.
+  if (m_options) {
+    HunspellCache::instance()->setDirectory(m_options->configDirectory() +
+                                            QDir::separator() + "spelling");
+  }
+  loadCache(m_dictionary);
+}
 
-  // start thread
-  m_checker->start();
+HunspellPlugin::~HunspellPlugin() {
+  m_book_queue.clear();
+  m_book_watcher.cancel();
+  m_book_watcher.waitForFinished();
+  HunspellCache::instance()->save();
 }
 
 /*!
  * \brief Checks a word against various word lists and dictionaries.
  *
- * The plugin first checks the word against maintained Author/Book word lists
- * and a list of words already checked by the spell checker, then
- * against a map of words against a match defined by the user and finally if no
- * in any of those it is passed to the spell checker.
+ * The plugin first checks the word against maintained Author/Book word lists,
+ * then against a map of words against a match defined by the user, then
+ * against the words already checked by the spell checker in any book and
+ * finally if not in any of those it is passed to the spell checker.
  *
  * \param word - a QString containing the word to check.
  */
 void HunspellPlugin::checkWord(QString word) {
-  if (m_book_list.contains(word) || m_author_list.contains(word) ||
-      m_good_words.contains(word)) {
-    emit wordCorrect(word);
-  } else {
-    QString word_match = m_words_matched[word];
-    if (word_match.isEmpty())
-      m_checker->checkWord(word);
-    else
-      emit wordMatched(word, word_match);
-  }
+  checkWords(QStringList() << word);
 }
 
 /*!
@@ -87,13 +106,177 @@ void HunspellPlugin::checkWord(QString word) {
  * against a map of words against a match defined by the user and finally if no
  * in any of those it is passed to the spell checker.
  *
- * This method passes each word individually to be checked by
- * checkWord(QString).
+ * The words that are not in any list are passed to the spell checker as
+ * a single batch, their results arrive together in wordsChecked().
  *
  * \param words - a QStringList containing a number of words to check.
  */
 void HunspellPlugin::checkWords(QStringList words) {
-  foreach (QString word, words) { checkWord(word); }
+  QStringList unknown = uncheckedWords(m_dictionary, words);
+  if (!unknown.isEmpty()) {
+    m_checker->checkWords(m_dictionary, unknown);
+  }
+}
+
+/*!
+ * \brief Checks words in a language other than that of the book, for
+ * example the words of a span with its own xml:lang.
+ *
+ * The dictionary for the language is shared by every book that uses it and
+ * is only loaded the first time it is needed.
+ *
+ * \param words - a QStringList containing a number of words to check.
+ * \param language - a BCP 47 language tag, if empty the book language is
+ * used.
+ */
+void HunspellPlugin::checkWords(QStringList words, QString language) {
+  if (language.isEmpty()) {
+    checkWords(words);
+    return;
+  }
+  QString dictionary =
+      HunspellDictionaries::instance()->dictionaryName(language);
+  loadCache(dictionary);
+  QStringList unknown = uncheckedWords(dictionary, words);
+  if (!unknown.isEmpty()) {
+    m_checker->checkWords(dictionary, unknown);
+  }
+}
+
+/*!
+ * \brief Sets the language of the book, normally from its dc:language.
+ *
+ * \param language - a BCP 47 language tag, if empty or if there is no
+ * dictionary for the language the default dictionary is used.
+ */
+void HunspellPlugin::setLanguage(QString language) {
+  QString dictionary =
+      HunspellDictionaries::instance()->dictionaryName(language);
+  if (dictionary == m_dictionary) {
+    return;
+  }
+  m_dictionary = dictionary;
+  loadCache(m_dictionary);
+}
+
+/*!
+ * \brief Sets the options, the cache of checked words is saved in the
+ * config directory.
+ */
+void HunspellPlugin::setOptions(Options *options) {
+  m_options = options;
+  if (m_options) {
+    HunspellCache::instance()->setDirectory(m_options->configDirectory() +
+                                            QDir::separator() + "spelling");
+  }
+  loadCache(m_dictionary);
+}
+
+/*
+ * Reads the words checked against dictionary in earlier sessions.
+ */
+void HunspellPlugin::loadCache(const QString &dictionary) {
+  HunspellCache::instance()->load(
+      dictionary,
+      QFileInfo(HunspellDictionaries::instance()->dictionaryFile(dictionary))
+          .lastModified()
+          .toMSecsSinceEpoch());
+}
+
+/*!
+ * \brief Checks all the words of a book.
+ *
+ * The words are checked against the lists and the cache as in
+ * checkWords(), then those left are split into shards that are checked in
+ * parallel by a pool of Hunspell objects, one for each core. The results of
+ * each shard are merged into the cache as they arrive. The pool is that of
+ * the book's dictionary, from HunspellDictionaries, so it is shared with
+ * every other book in the same language.
+ *
+ * If a book is already being checked the words are checked once it has
+ * finished.
+ *
+ * \param words - a QStringList containing the words of the book.
+ */
+void HunspellPlugin::checkBook(QStringList words) {
+  words.removeDuplicates();
+  if (m_book_watcher.isRunning()) {
+    m_book_queue += words;
+    return;
+  }
+  QStringList unknown = uncheckedWords(m_dictionary, words);
+  if (unknown.isEmpty() || !m_checker) {
+    return;
+  }
+  m_book_dictionary = m_dictionary;
+  HunspellPool *pool = HunspellDictionaries::instance()->pool(m_dictionary);
+
+  QList<QStringList> shards;
+  int shard_size = qMin(int(SHARD_SIZE),
+                        (unknown.size() + pool->size() - 1) / pool->size());
+  for (int i = 0; i < unknown.size(); i += shard_size) {
+    shards.append(unknown.mid(i, shard_size));
+  }
+  m_book_watcher.setFuture(
+      QtConcurrent::mapped(shards, HunspellShardCheck(pool)));
+}
+
+void HunspellPlugin::bookShardsChecked(int begin, int end) {
+  for (int i = begin; i < end; i++) {
+    receivedWordsChecked(m_book_dictionary, m_book_watcher.resultAt(i));
+  }
+}
+
+void HunspellPlugin::bookCheckFinished() {
+  if (!m_book_queue.isEmpty()) {
+    QStringList words = m_book_queue;
+    m_book_queue.clear();
+    checkBook(words);
+  }
+}
+
+/*!
+ * \brief Reports the words that are in the word lists, the word matches
+ * or the cache.
+ *
+ * The lists are tried first, through their Bloom filters, so that the
+ * names that fill most books never reach the cache or Hunspell.
+ *
+ * \return the words that must be checked by Hunspell, without repeats.
+ */
+QStringList HunspellPlugin::uncheckedWords(const QString &dictionary,
+                                           const QStringList &words) {
+  HunspellCache *cache = HunspellCache::instance();
+  SpellResults known;
+  QStringList unknown;
+  QSet<QString> queued;
+  foreach (QString word, words) {
+    if (m_book_list.contains(word) || m_author_list.contains(word)) {
+      known.insert(word, true);
+      emit wordCorrect(word);
+      continue;
+    }
+    QString word_match = m_words_matched.value(word);
+    if (!word_match.isEmpty()) {
+      emit wordMatched(word, word_match);
+      continue;
+    }
+    bool correct;
+    if (cache->lookup(dictionary, word, correct)) {
+      known.insert(word, correct);
+      if (correct)
+        emit wordCorrect(word);
+      else
+        emit wordUnknown(word);
+    } else if (!queued.contains(word)) {
+      queued.insert(word);
+      unknown << word;
+    }
+  }
+  if (!known.isEmpty()) {
+    emit wordsChecked(known);
+  }
+  return unknown;
 }
 
 ///*!
@@ -147,16 +330,65 @@ void HunspellPlugin::checkWords(QStringList words) {
 //  m_words_matched[word] = match;
 //}
 
-void HunspellPlugin::suggestions(QString word) { m_checker->suggestions(word); }
+/*!
+ * \brief Asks for suggestions for a misspelt word, sent by wordSuggestions().
+ *
+ * Only the latest request is wanted, the user has moved on from any
+ * earlier ones, so those still waiting are cancelled. Suggestions that have
+ * already been worked out are sent straight away.
+ */
+void HunspellPlugin::suggestions(QString word) {
+  QString key = suggestionKey(m_dictionary, word);
+  QStringList *suggestions = m_suggestion_cache.object(key);
+  if (suggestions) {
+    m_suggestion_word.clear();
+    m_checker->cancelSuggestions();
+    emit wordSuggestions(*suggestions);
+    return;
+  }
+  if (key == m_suggestion_word) {
+    return;
+  }
+  m_suggestion_word = key;
+  m_checker->cancelSuggestions();
+  m_checker->suggestions(m_dictionary, word);
+}
+
+void HunspellPlugin::cancelSuggestions() {
+  m_suggestion_word.clear();
+  m_checker->cancelSuggestions();
+}
 
 /*
- * Handles a word is correct signal from the spell checker.
+ * Handles suggestions from the spell checker. They are always cached, even
+ * once cancelled, but only sent if they are still wanted.
  */
-void HunspellPlugin::receivedWordCorrect(QString word) {
-  if (!m_good_words.contains(word)) {
-    m_good_words.append(word);
+void HunspellPlugin::receivedSuggestions(QString dictionary, QString word,
+                                         QStringList suggestions) {
+  QString key = suggestionKey(dictionary, word);
+  m_suggestion_cache.insert(key, new QStringList(suggestions));
+  if (key == m_suggestion_word) {
+    m_suggestion_word.clear();
+    emit wordSuggestions(suggestions);
   }
-  emit wordCorrect(word);
+}
+
+/*
+ * Handles a checked batch from the spell checker, the verdicts are
+ * remembered so that the words are not checked again.
+ */
+void HunspellPlugin::receivedWordsChecked(QString dictionary,
+                                          SpellResults results) {
+  HunspellCache::instance()->insert(dictionary, results);
+  for (SpellResults::const_iterator it = results.constBegin();
+       it != results.constEnd(); ++it) {
+    if (it.value()) {
+      emit wordCorrect(it.key());
+    } else {
+      emit wordUnknown(it.key());
+    }
+  }
+  emit wordsChecked(results);
 }
 
 QString HunspellPlugin::pluginGroup() const { return m_plugin_group; }
@@ -185,14 +417,28 @@ CountryData *HunspellPlugin::dictionary(QString language_code) {
   return m_data;
 }
 
+/*!
+ * \brief The dictionaries that are installed, only those for language_code
+ * if it is given.
+ */
 QStringList HunspellPlugin::languageCodes(QString language_code) {
-  // TODO just a placeholder.
-  return QStringList();
+  QStringList available = HunspellDictionaries::instance()->available();
+  if (language_code.isEmpty()) {
+    return available;
+  }
+  QString primary = language_code.section(QRegExp("[-_]"), 0, 0).toLower();
+  QStringList codes;
+  foreach (QString dictionary, available) {
+    if (dictionary == primary || dictionary.startsWith(primary + "_")) {
+      codes << dictionary;
+    }
+  }
+  return codes;
 }
 
 QStringList HunspellPlugin::compatibleLanguageCodes(QString language_code) {
-  // TODO just a placeholder.
-  return QStringList();
+  // any dictionary of the same language, en_GB for en-US for example.
+  return languageCodes(language_code);
 }
 
 QString HunspellPlugin::language() { return m_data->language_name; }
@@ -204,15 +450,39 @@ QString HunspellPlugin::path() { return m_data->path; }
 QString HunspellPlugin::bcp47() { return m_data->bcp47; }
 
 void HunspellPlugin::addWordToBookList(QString word) {
-  m_book_list.append(word);
+  m_book_list.insert(word);
 }
 
 void HunspellPlugin::addWordToAuthorList(QString word) {
-  m_author_list.append(word);
+  m_author_list.insert(word);
 }
 
 void HunspellPlugin::addWordMatch(QString word, QString match) {
   m_words_matched[word] = match;
 }
 
+/*!
+ * \brief Replaces the book list, with that stored in the library for the
+ * book being checked.
+ */
+void HunspellPlugin::setBookList(QStringList words) {
+  m_book_list.setWords(words);
+}
+
+/*!
+ * \brief Replaces the author list, with the words stored in the library
+ * for the authors of the book being checked.
+ */
+void HunspellPlugin::setAuthorList(QStringList words) {
+  m_author_list.setWords(words);
+}
+
+void HunspellPlugin::setWordMatches(QMap<QString, QString> matches) {
+  m_words_matched.clear();
+  for (QMap<QString, QString>::const_iterator it = matches.constBegin();
+       it != matches.constEnd(); ++it) {
+    m_words_matched.insert(it.key(), it.value());
+  }
+}
+
 //== HunspellChecker ==========================================================
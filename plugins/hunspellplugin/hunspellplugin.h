@@ -1,27 +1,32 @@
 #ifndef HUNSPELLPLUGIN_H
 #define HUNSPELLPLUGIN_H
 
+#include <QCache>
 #include <QDir>
+#include <QFutureWatcher>
 #include <QMap>
 #include <QThread>
 #include <QtPlugin>
 
+#include "hunspellchecker.h"
+#include "hunspellpool.h"
+#include "hunspellwordlist.h"
 #include "interface_global.h"
 #include "ispellinterface.h"
 
-class HunspellChecker;
 class Options;
 
 class INTERFACESHARED_EXPORT HunspellPlugin : public QObject,
                                               public ISpellInterface {
   Q_OBJECT
-  Q_PLUGIN_METADATA(IID SpellInterface_iid FILE "spellinterface.json")
+  Q_PLUGIN_METADATA(IID SpellInterface_iid FILE "hunspell.json")
   Q_INTERFACES(IPluginInterface)
   Q_INTERFACES(ISpellInterface)
 public:
   explicit HunspellPlugin(QObject *parent = nullptr);
   explicit HunspellPlugin(Options *options, QString dict_path = QString(),
                           QObject *parent = nullptr);
+  ~HunspellPlugin();
 
   // IPluginInterface interface
   QString pluginGroup() const override;
@@ -46,16 +51,26 @@ public:
 
   void checkWord(QString word) override;
   void checkWords(QStringList words) override;
+  void checkWords(QStringList words, QString language) override;
+  void setLanguage(QString language) override;
+  void checkBook(QStringList words) override;
   void suggestions(QString word) override;
+  void cancelSuggestions() override;
   void addWordToBookList(QString word) override;
   void addWordToAuthorList(QString word) override;
   void addWordMatch(QString word, QString match) override;
+  void setBookList(QStringList words) override;
+  void setAuthorList(QStringList words) override;
+  void setWordMatches(QMap<QString, QString> matches) override;
+  void setOptions(Options *options) override;
 
 signals:
   void wordCorrect(QString);
   void wordUnknown(QString);
   void wordMatched(QString, QString);
   void wordSuggestions(QStringList);
+  // the results of a batch of checkWords(), true if the word is correct.
+  void wordsChecked(SpellResults);
 
 protected:
   static const QString m_plugin_group;
@@ -67,17 +82,39 @@ protected:
   static const int m_build_version;
   static bool m_loaded;
 
-  QStringList m_book_list;
-  QStringList m_good_words;
-  QStringList m_author_list;
+  HunspellWordList m_book_list;
+  HunspellWordList m_author_list;
   QHash<QString, QString> m_words_matched;
+  // the suggestions already worked out, the same misspelling is usually
+  // repeated throughout a book.
+  QCache<QString, QStringList> m_suggestion_cache;
+  QString m_suggestion_word; // the word waiting for suggestions.
 
   CountryData *m_data;
 
   HunspellChecker *m_checker;
+  QString m_dictionary; // that of the book language.
+  QFutureWatcher<SpellResults> m_book_watcher;
+  QString m_book_dictionary; // that of the running book check.
+  QStringList m_book_queue; // waiting for the running book check.
   Options *m_options;
 
-  void receivedWordCorrect(QString);
+  void receivedWordsChecked(QString dictionary, SpellResults results);
+  void receivedSuggestions(QString dictionary, QString word,
+                           QStringList suggestions);
+  void bookShardsChecked(int begin, int end);
+  void bookCheckFinished();
+  QStringList uncheckedWords(const QString &dictionary,
+                             const QStringList &words);
+  void loadCache(const QString &dictionary);
+  static QString suggestionKey(const QString &dictionary,
+                               const QString &word) {
+    return dictionary + '/' + word;
+  }
+
+  // small enough that the shards are spread evenly over the pool.
+  static const int SHARD_SIZE = 1000;
+  static const int SUGGESTION_CACHE_SIZE = 1000;
 };
 
 #endif // HUNSPELLPLUGIN_H
@@ -1,6 +1,6 @@
 TEMPLATE        = lib
 CONFIG         += plugin
-QT             += core gui widgets
+QT             += core gui widgets concurrent
 CONFIG += c++14
 
 TARGET          = hunspellplugin
@@ -22,11 +22,19 @@ DEFINES += \
 
 HEADERS         = \
     hunspellplugin.h \
-    hunspellchecker.h
+    hunspellcache.h \
+    hunspellchecker.h \
+    hunspelldictionaries.h \
+    hunspellpool.h \
+    hunspellwordlist.h
 
 SOURCES         = \
     hunspellplugin.cpp \
-    hunspellchecker.cpp
+    hunspellcache.cpp \
+    hunspellchecker.cpp \
+    hunspelldictionaries.cpp \
+    hunspellpool.cpp \
+    hunspellwordlist.cpp
 
 DISTFILES += \
     hunspell.json
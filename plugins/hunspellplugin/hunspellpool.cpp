@@ -0,0 +1,150 @@
+#include "hunspellpool.h"
+
+#include <QMutexLocker>
+#include <QThread>
+
+#include "ebooktrace.h"
+
+HunspellUtf8Words::HunspellUtf8Words(const QStringList& words)
+{
+  int length = 0;
+  foreach (const QString& word, words) {
+    length += word.size();
+  }
+  m_data.reserve(length + length / 4);
+  m_offsets.reserve(words.size() + 1);
+  foreach (const QString& word, words) {
+    m_offsets.append(m_data.size());
+    const QChar* data = word.constData();
+    int size = word.size();
+    bool ascii = true;
+    for (int i = 0; i < size && ascii; i++) {
+      ascii = (data[i].unicode() < 0x80);
+    }
+    if (ascii) {
+      int start = m_data.size();
+      m_data.resize(start + size);
+      char* out = m_data.data() + start;
+      for (int i = 0; i < size; i++) {
+        out[i] = char(data[i].unicode());
+      }
+    } else {
+      m_data.append(word.toUtf8());
+    }
+  }
+  m_offsets.append(m_data.size());
+}
+
+int
+HunspellUtf8Words::size() const
+{
+  return m_offsets.size() - 1;
+}
+
+/*!
+ * \brief Copies a word into buffer, which only allocates if it has to grow.
+ */
+void
+HunspellUtf8Words::word(int index, std::string& buffer) const
+{
+  int start = m_offsets.at(index);
+  buffer.assign(m_data.constData() + start, m_offsets.at(index + 1) - start);
+}
+
+/*!
+ * \param size the most Hunspell objects that are created, if 0 one for
+ *        each core.
+ */
+HunspellPool::HunspellPool(const QString& aff, const QString& dic, int size)
+  : m_aff(aff)
+  , m_dic(dic)
+  , m_size(size > 0 ? size : qMax(1, QThread::idealThreadCount()))
+  , m_created(0)
+{}
+
+HunspellPool::~HunspellPool()
+{
+  qDeleteAll(m_all);
+}
+
+int
+HunspellPool::size() const
+{
+  return m_size;
+}
+
+/*!
+ * \brief Checks words, blocking until a Hunspell object is free.
+ *
+ * Can be called from any thread.
+ */
+SpellResults
+HunspellPool::check(const QStringList& words)
+{
+  // each spelling batch and each shard of a book check.
+  EBOOK_TRACE_SCOPE("HunspellPool::check");
+  // converted before a Hunspell object is taken.
+  HunspellUtf8Words utf8(words);
+  std::string buffer;
+  buffer.reserve(WORD_BUFFER_SIZE);
+
+  Hunspell* hunspell = acquire();
+  SpellResults results;
+  results.reserve(words.size());
+  for (int i = 0; i < utf8.size(); i++) {
+    utf8.word(i, buffer);
+    results.insert(words.at(i), hunspell->spell(buffer));
+  }
+  release(hunspell);
+  return results;
+}
+
+/*!
+ * \brief The suggestions for a misspelt word, blocking until a Hunspell
+ * object is free.
+ *
+ * Can be called from any thread.
+ */
+QStringList
+HunspellPool::suggest(const QString& word)
+{
+  QByteArray utf8 = word.toUtf8();
+  Hunspell* hunspell = acquire();
+  QStringList suggestions;
+  std::vector<std::string> list =
+    hunspell->suggest(std::string(utf8.constData(), utf8.size()));
+  for (const std::string& str : list) {
+    suggestions.append(QString::fromUtf8(str.data(), int(str.size())));
+  }
+  release(hunspell);
+  return suggestions;
+}
+
+Hunspell*
+HunspellPool::acquire()
+{
+  QMutexLocker locker(&m_mutex);
+  while (m_free.isEmpty() && m_created >= m_size) {
+    m_released.wait(&m_mutex);
+  }
+  if (!m_free.isEmpty()) {
+    return m_free.takeLast();
+  }
+  m_created++;
+  locker.unlock();
+
+  // loading the dictionary is slow, the other threads are not held up.
+  Hunspell* hunspell =
+    new Hunspell(m_aff.toStdString().c_str(), m_dic.toStdString().c_str());
+  locker.relock();
+  m_all.append(hunspell);
+  return hunspell;
+}
+
+void
+HunspellPool::release(Hunspell* hunspell)
+{
+  QMutexLocker locker(&m_mutex);
+  m_free.append(hunspell);
+  m_released.wakeOne();
+}
@@ -0,0 +1,92 @@
+#ifndef HUNSPELLPOOL_H
+#define HUNSPELLPOOL_H
+
+#include <QByteArray>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QWaitCondition>
+
+#include <string>
+
+#include <hunspell/hunspell.hxx>
+
+#include "hunspellchecker.h"
+
+/*!
+ * \brief The UTF-8 form of a list of words, held end to end in one block.
+ *
+ * The words are converted together rather than each becoming its own
+ * std::string, ASCII words, nearly all of them, are copied straight in.
+ * word() copies one into a buffer that the caller reuses, so checking a
+ * batch costs a couple of allocations rather than one or two a word.
+ */
+class HunspellUtf8Words
+{
+public:
+  explicit HunspellUtf8Words(const QStringList& words);
+
+  int size() const;
+  void word(int index, std::string& buffer) const;
+
+protected:
+  QByteArray m_data;
+  QVector<int> m_offsets; // the start of each word, and the end of the last.
+};
+
+/*!
+ * \brief A pool of Hunspell objects that all use the same dictionary.
+ *
+ * A Hunspell object cannot be used by two threads at once, so each thread
+ * checking words takes its own from the pool with check(). They are only
+ * created, each loading its own copy of the dictionary, as the threads
+ * need them.
+ */
+class HunspellPool
+{
+public:
+  HunspellPool(const QString& aff, const QString& dic, int size = 0);
+  ~HunspellPool();
+
+  int size() const;
+  SpellResults check(const QStringList& words);
+  QStringList suggest(const QString& word);
+
+protected:
+  QString m_aff, m_dic;
+  int m_size;
+  int m_created;
+  QMutex m_mutex;
+  QWaitCondition m_released;
+  QList<Hunspell*> m_free;
+  QList<Hunspell*> m_all;
+
+  Hunspell* acquire();
+  void release(Hunspell* hunspell);
+
+  // longer words make the buffer grow.
+  static const int WORD_BUFFER_SIZE = 64;
+};
+
+/*!
+ * \brief Checks a shard of words with a HunspellPool, for
+ * QtConcurrent::mapped().
+ */
+struct HunspellShardCheck
+{
+  typedef SpellResults result_type;
+
+  HunspellShardCheck(HunspellPool* pool)
+    : m_pool(pool)
+  {}
+  SpellResults operator()(const QStringList& words)
+  {
+    return m_pool->check(words);
+  }
+
+  HunspellPool* m_pool;
+};
+
+#endif // HUNSPELLPOOL_H
@@ -0,0 +1,107 @@
+#include "hunspellwordlist.h"
+
+#include <QHash>
+
+namespace {
+
+// the probe step, odd so that the probes step through every bit.
+inline uint
+secondHash(const QString& word)
+{
+  return qHash(word, 0x9e3779b9) | 1;
+}
+
+} // end of anonymous namespace
+
+HunspellWordList::HunspellWordList()
+  : m_bits(MINIMUM_BITS / 64, 0)
+  , m_mask(MINIMUM_BITS - 1)
+{}
+
+void
+HunspellWordList::clear()
+{
+  m_words.clear();
+  m_bits = QVector<quint64>(MINIMUM_BITS / 64, 0);
+  m_mask = MINIMUM_BITS - 1;
+}
+
+void
+HunspellWordList::setWords(const QStringList& words)
+{
+  m_words = words.toSet();
+  rebuild();
+}
+
+void
+HunspellWordList::insert(const QString& word)
+{
+  if (m_words.contains(word)) {
+    return;
+  }
+  m_words.insert(word);
+  if (uint(m_words.size()) * BITS_PER_WORD > m_mask + 1) {
+    rebuild();
+  } else {
+    setBits(word);
+  }
+}
+
+bool
+HunspellWordList::contains(const QString& word) const
+{
+  if (m_words.isEmpty()) {
+    return false;
+  }
+  uint hash = qHash(word);
+  uint step = secondHash(word);
+  for (int i = 0; i < HASH_COUNT; i++) {
+    uint bit = (hash + i * step) & m_mask;
+    if (!(m_bits.at(bit >> 6) & (Q_UINT64_C(1) << (bit & 63)))) {
+      return false;
+    }
+  }
+  return m_words.contains(word);
+}
+
+bool
+HunspellWordList::isEmpty() const
+{
+  return m_words.isEmpty();
+}
+
+QStringList
+HunspellWordList::words() const
+{
+  QStringList words = m_words.toList();
+  words.sort();
+  return words;
+}
+
+/*
+ * Sizes the filter for the words in the set and sets their bits.
+ */
+void
+HunspellWordList::rebuild()
+{
+  uint bits = MINIMUM_BITS;
+  while (bits < uint(m_words.size()) * BITS_PER_WORD) {
+    bits <<= 1;
+  }
+  m_bits = QVector<quint64>(bits / 64, 0);
+  m_mask = bits - 1;
+  foreach (QString word, m_words) {
+    setBits(word);
+  }
+}
+
+void
+HunspellWordList::setBits(const QString& word)
+{
+  uint hash = qHash(word);
+  uint step = secondHash(word);
+  for (int i = 0; i < HASH_COUNT; i++) {
+    uint bit = (hash + i * step) & m_mask;
+    m_bits[bit >> 6] |= (Q_UINT64_C(1) << (bit & 63));
+  }
+}
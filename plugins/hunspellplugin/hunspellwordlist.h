@@ -0,0 +1,43 @@
+#ifndef HUNSPELLWORDLIST_H
+#define HUNSPELLWORDLIST_H
+
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+/*!
+ * \brief A set of words, for the book and author word lists, with a Bloom
+ * filter in front of it.
+ *
+ * Nearly every word checked is not in the lists, the filter rejects those
+ * with a few bit tests and only the rest are looked up in the hash set. The
+ * filter is grown, and rebuilt from the set, so that it keeps about ten
+ * bits for each word, which gives roughly one false hit in a hundred.
+ */
+class HunspellWordList
+{
+public:
+  HunspellWordList();
+
+  void clear();
+  void setWords(const QStringList& words);
+  void insert(const QString& word);
+  bool contains(const QString& word) const;
+  bool isEmpty() const;
+  QStringList words() const;
+
+protected:
+  QSet<QString> m_words;
+  QVector<quint64> m_bits;
+  uint m_mask; // the number of bits less one, a power of two less one.
+
+  void rebuild();
+  void setBits(const QString& word);
+
+  static const int HASH_COUNT = 3;
+  static const int BITS_PER_WORD = 10;
+  static const uint MINIMUM_BITS = 1024;
+};
+
+#endif // HUNSPELLWORDLIST_H
@@ -27,14 +27,91 @@ MobiDocument::MobiDocument(MobiDocumentPrivate& d)
   : ITextDocument(d.q_ptr)
 {}
 
-QString
+EBookToc
 MobiDocument::buildTocFromData()
-{}
+{
+  return EBookToc();
+}
 
 Metadata
 MobiDocument::metadata()
 {}
 
+int
+MobiDocument::currentChapter()
+{
+  Q_D(MobiDocument);
+  return d->currentChapter();
+}
+
+int
+MobiDocument::chapterCount()
+{
+  Q_D(MobiDocument);
+  return d->chapterCount();
+}
+
+bool
+MobiDocument::setCurrentChapter(int index)
+{
+  Q_D(MobiDocument);
+  return d->loadChapter(index);
+}
+
+QString
+MobiDocument::chapterSource()
+{
+  Q_D(MobiDocument);
+  return d->chapterSource(d->currentChapter());
+}
+
+QString
+MobiDocument::chapterSourceAt(int index)
+{
+  Q_D(MobiDocument);
+  return d->chapterSource(index);
+}
+
+bool
+MobiDocument::reloadChapter()
+{
+  Q_D(MobiDocument);
+  return d->reloadChapter();
+}
+
+EBookMemoryUsage
+MobiDocument::memoryUsage()
+{
+  Q_D(MobiDocument);
+  return d->memoryUsage();
+}
+
+/*!
+ * \brief Sets the size of the decoded image cache in megabytes.
+ */
+void
+MobiDocument::setImageCacheSize(int megabytes)
+{
+  Q_D(MobiDocument);
+  d->setImageCacheSize(megabytes);
+}
+
+/*!
+ * \brief Images are decoded from the book's resource records on demand.
+ *
+ * Anything that the book does not hold is passed on to QTextDocument.
+ */
+QVariant
+MobiDocument::loadResource(int type, const QUrl& name)
+{
+  Q_D(MobiDocument);
+  QVariant resource = d->loadResource(type, name);
+  if (resource.isValid()) {
+    return resource;
+  }
+  return ITextDocument::loadResource(type, name);
+}
+
 QString
 MobiDocument::filename()
 {
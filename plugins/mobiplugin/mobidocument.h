@@ -65,14 +65,26 @@ public:
   // IEBookDocument interface
   bool isModified() override {}
 
-  QString buildTocFromData() override;
+  EBookToc buildTocFromData() override;
 
   Metadata metadata();
 
+  int currentChapter() override;
+  int chapterCount() override;
+  bool setCurrentChapter(int index) override;
+  QString chapterSource() override;
+  QString chapterSourceAt(int index) override;
+  bool reloadChapter() override;
+  EBookMemoryUsage memoryUsage() override;
+
+  void setImageCacheSize(int megabytes);
+
 protected:
   MobiDocumentPrivate* d_ptr;
   MobiDocument(MobiDocumentPrivate& d);
 
+  QVariant loadResource(int type, const QUrl& name) override;
+
   // static variables for IPluginInterface.
   static const QString m_plugin_group;
   static const QString m_plugin_name;
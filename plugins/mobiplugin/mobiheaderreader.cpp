@@ -0,0 +1,192 @@
+#include "mobiheaderreader.h"
+
+#include <QFile>
+#include <QTextCodec>
+#include <QtEndian>
+
+#include <qlogger/qlogger.h>
+
+using namespace qlogger;
+
+namespace {
+
+inline quint32
+readUInt32(const QByteArray& data, int offset)
+{
+  return qFromBigEndian<quint32>(
+    reinterpret_cast<const uchar*>(data.constData() + offset));
+}
+
+inline quint16
+readUInt16(const QByteArray& data, int offset)
+{
+  return qFromBigEndian<quint16>(
+    reinterpret_cast<const uchar*>(data.constData() + offset));
+}
+
+} // end of anonymous namespace
+
+MobiHeaderReader::MobiHeaderReader()
+  : m_utf8(true)
+{}
+
+/*!
+ * \brief Reads the headers of the file at path.
+ *
+ * \return true if the file has a MOBI header, otherwise false.
+ */
+bool
+MobiHeaderReader::read(const QString& path)
+{
+  m_full_name.clear();
+  m_exth.clear();
+
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    QLOG_DEBUG(QString("Unable to open mobi file %1").arg(path));
+    return false;
+  }
+
+  QByteArray header = file.read(PDB_HEADER_SIZE);
+  if (header.size() < PDB_HEADER_SIZE) {
+    QLOG_DEBUG(QString("Not a PalmDB file %1").arg(path));
+    return false;
+  }
+  int record_count = readUInt16(header, PDB_HEADER_SIZE - 2);
+  if (record_count < 1) {
+    return false;
+  }
+
+  // record 0 runs up to the start of record 1, or to the end of the file.
+  QByteArray record_info = file.read(2 * PDB_RECORD_INFO_SIZE);
+  if (record_info.size() < PDB_RECORD_INFO_SIZE) {
+    return false;
+  }
+  qint64 start = readUInt32(record_info, 0);
+  qint64 end = (record_count > 1 && record_info.size() >= 12
+                  ? readUInt32(record_info, PDB_RECORD_INFO_SIZE)
+                  : file.size());
+  if (end <= start || end > file.size() || !file.seek(start)) {
+    QLOG_DEBUG(QString("Bad record list in mobi file %1").arg(path));
+    return false;
+  }
+
+  return parseRecord0(file.read(end - start));
+}
+
+/*!
+ * \brief The full name from the MOBI header.
+ */
+QString
+MobiHeaderReader::fullName() const
+{
+  return m_full_name;
+}
+
+/*!
+ * \brief The updated title of the EXTH header if it has one, otherwise the
+ * full name.
+ */
+QString
+MobiHeaderReader::title() const
+{
+  QString title = exthString(EXTH_UPDATED_TITLE);
+  return (title.isEmpty() ? m_full_name : title);
+}
+
+QStringList
+MobiHeaderReader::creators() const
+{
+  return exthStrings(EXTH_AUTHOR);
+}
+
+QString
+MobiHeaderReader::publisher() const
+{
+  return exthString(EXTH_PUBLISHER);
+}
+
+/*!
+ * \brief The first EXTH string record with the tag, or an empty string.
+ */
+QString
+MobiHeaderReader::exthString(int tag) const
+{
+  QStringList strings = exthStrings(tag);
+  return (strings.isEmpty() ? QString() : strings.first());
+}
+
+/*!
+ * \brief All of the EXTH string records with the tag, in file order.
+ */
+QStringList
+MobiHeaderReader::exthStrings(int tag) const
+{
+  QStringList strings;
+  QList<QByteArray> values = m_exth.values(tag);
+  // QMultiMap gives the most recently inserted first.
+  for (int i = values.size() - 1; i >= 0; i--) {
+    strings << decode(values.at(i));
+  }
+  return strings;
+}
+
+/*
+ * Record 0 is the PalmDOC header followed by the MOBI header, the EXTH
+ * header follows the MOBI header if its flag is set. The full name is
+ * found through an offset from the start of the record.
+ */
+bool
+MobiHeaderReader::parseRecord0(const QByteArray& record)
+{
+  int mobi = PALMDOC_HEADER_SIZE;
+  if (record.size() < mobi + 0x74 || record.mid(mobi, 4) != "MOBI") {
+    QLOG_DEBUG(QString("No MOBI header found"));
+    return false;
+  }
+  // lengths and offsets are checked as 64 bit values so that those of a
+  // damaged file cannot wrap round into range.
+  qint64 header_length = readUInt32(record, mobi + 4);
+  m_utf8 = (readUInt32(record, mobi + 12) == UTF8_ENCODING);
+
+  qint64 name_offset = readUInt32(record, 0x54);
+  qint64 name_length = readUInt32(record, 0x58);
+  if (name_offset + name_length <= record.size()) {
+    m_full_name = decode(record.mid(int(name_offset), int(name_length)));
+  }
+
+  quint32 exth_flags = readUInt32(record, mobi + 0x70);
+  qint64 exth = mobi + header_length;
+  if ((exth_flags & EXTH_FLAG) && exth + 12 <= record.size() &&
+      record.mid(int(exth), 4) == "EXTH") {
+    parseExth(record.mid(int(exth)));
+  }
+  return true;
+}
+
+void
+MobiHeaderReader::parseExth(const QByteArray& exth)
+{
+  quint32 count = readUInt32(exth, 8);
+  int offset = 12;
+  for (quint32 i = 0; i < count && offset + 8 <= exth.size(); i++) {
+    int tag = int(readUInt32(exth, offset));
+    // 64 bit, so a damaged length cannot go negative or wrap round.
+    qint64 length = readUInt32(exth, offset + 4);
+    if (length < 8 || offset + length > exth.size()) {
+      break;
+    }
+    m_exth.insert(tag, exth.mid(offset + 8, int(length) - 8));
+    offset += int(length);
+  }
+}
+
+QString
+MobiHeaderReader::decode(const QByteArray& data) const
+{
+  if (m_utf8) {
+    return QString::fromUtf8(data);
+  }
+  QTextCodec* codec = QTextCodec::codecForName("Windows-1252");
+  return (codec ? codec->toUnicode(data) : QString::fromLatin1(data));
+}
@@ -0,0 +1,53 @@
+#ifndef MOBIHEADERREADER_H
+#define MOBIHEADERREADER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QMultiMap>
+#include <QString>
+#include <QStringList>
+
+/*!
+ * \brief Reads the metadata of a mobi or azw file from its headers alone.
+ *
+ * Only the PalmDB header, its record list and record 0, which holds the
+ * MOBI and EXTH headers, are read from the file. No other record is
+ * touched and nothing is decompressed, so it is cheap enough to run over a
+ * whole library of Kindle files.
+ */
+class MobiHeaderReader
+{
+public:
+  MobiHeaderReader();
+
+  bool read(const QString& path);
+
+  QString fullName() const;
+  QString title() const;
+  QStringList creators() const;
+  QString publisher() const;
+  QString exthString(int tag) const;
+  QStringList exthStrings(int tag) const;
+
+protected:
+  QString m_full_name;
+  bool m_utf8;
+  // the raw data of each EXTH record, keyed on its tag.
+  QMultiMap<int, QByteArray> m_exth;
+
+  bool parseRecord0(const QByteArray& record);
+  void parseExth(const QByteArray& exth);
+  QString decode(const QByteArray& data) const;
+
+  static const int PDB_HEADER_SIZE = 78;
+  static const int PDB_RECORD_INFO_SIZE = 8;
+  static const int PALMDOC_HEADER_SIZE = 16;
+  static const int EXTH_FLAG = 0x40;
+  static const int UTF8_ENCODING = 65001;
+
+  static const int EXTH_AUTHOR = 100;
+  static const int EXTH_PUBLISHER = 101;
+  static const int EXTH_UPDATED_TITLE = 503;
+};
+
+#endif // MOBIHEADERREADER_H
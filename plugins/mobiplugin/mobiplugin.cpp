@@ -1,6 +1,11 @@
 #include "mobiplugin.h"
 
 #include "mobidocument.h"
+#include "mobiheaderreader.h"
+
+#include <QFile>
+
+#include <mobi.h>
 
 const QString MobiPlugin::m_plugin_name = "Mobi Reader";
 const QString MobiPlugin::m_plugin_group = "Book Reader";
@@ -13,10 +18,14 @@ const QString MobiPlugin::m_version = QString("%1.%2.%3")
                                       .arg(MobiPlugin::m_minor_version)
                                       .arg(MobiPlugin::m_build_version);
 bool MobiPlugin::m_loaded = false;
-const QString MobiPlugin::m_file_filter = "*.mobi";
+const QString MobiPlugin::m_file_filter = "*.mobi *.azw *.azw3";
 const QString MobiPlugin::m_file_description = "Mobi Document";
 
-MobiPlugin::MobiPlugin(QObject* parent) : QObject(parent) {}
+MobiPlugin::MobiPlugin(QObject* parent)
+  : QObject(parent)
+  , m_options(nullptr)
+  , m_document(nullptr)
+{}
 
 //MobiPlugin::MobiPlugin(Options* options, QObject* parent) :
 //  QObject(parent), m_options(options)
@@ -72,13 +81,219 @@ void MobiPlugin::buildMenu() {}
 
 IEBookDocument* MobiPlugin::createDocument(QString path)
 {
-  m_document = new MobiDocument(this);
+  MobiDocument* document = new MobiDocument(this);
+  if (m_options) {
+    document->setImageCacheSize(m_options->imageCacheSize());
+  }
+  m_document = document;
   m_document->openDocument(path);
   return m_document;
 }
 
 IEBookDocument* MobiPlugin::createCodeDocument() {}
 
+/*!
+ * \brief Reads the title and authors of a mobi from its headers.
+ *
+ * Only the PalmDB header and record 0 are read from the file, see
+ * MobiHeaderReader, so the text records are never loaded.
+ */
+Metadata MobiPlugin::readMetadata(const QString& path)
+{
+  MobiHeaderReader reader;
+  if (!reader.read(path)) {
+    return Metadata();
+  }
+
+  Metadata metadata(new EBookMetadata());
+  QString name = reader.title();
+  if (!name.isEmpty()) {
+    Title title(new EBookTitle());
+    title->title = name;
+    OrderedTitleMap titles;
+    titles.insert(1, title);
+    metadata->setOrderedTitles(titles);
+  }
+  metadata->setCreatorList(reader.creators());
+  return metadata;
+}
+
+/*!
+ * \brief Reads the text of a mobi for the search index.
+ *
+ * A mobi is shown as a single document and cannot be saved, so the whole
+ * of the rawml is returned as one chapter.
+ */
+EBookChapterList MobiPlugin::readChapters(const QString& path)
+{
+  EBookChapterList chapters;
+  MOBIData* mobi_data = mobi_init();
+  if (mobi_data == nullptr) {
+    return chapters;
+  }
+  if (mobi_load_filename(mobi_data, QFile::encodeName(path).constData()) !=
+      MOBI_SUCCESS) {
+    mobi_free(mobi_data);
+    return chapters;
+  }
+
+  size_t size = mobi_get_text_maxsize(mobi_data);
+  QByteArray data(int(size), '\0');
+  if (mobi_get_rawml(mobi_data, data.data(), &size) == MOBI_SUCCESS) {
+    EBookChapterText chapter;
+    chapter.id = "text";
+    chapter.text = QString::fromUtf8(data.constData(), int(size));
+    chapters.append(chapter);
+  }
+
+  mobi_free(mobi_data);
+  return chapters;
+}
+
+/*!
+ * \brief Reads the cover image for the library shelf.
+ *
+ * The EXTH cover offset is relative to the first resource record, the
+ * thumbnail record is used if there is no full sized cover. No text is
+ * decompressed.
+ */
+QImage MobiPlugin::readCover(const QString& path, const QSize& size)
+{
+  QImage image;
+  MOBIData* mobi_data = mobi_init();
+  if (mobi_data == nullptr) {
+    return image;
+  }
+  if (mobi_load_filename(mobi_data, QFile::encodeName(path).constData()) !=
+      MOBI_SUCCESS) {
+    mobi_free(mobi_data);
+    return image;
+  }
+
+  MOBIExthHeader* exth =
+    mobi_get_exthrecord_by_tag(mobi_data, EXTH_COVEROFFSET);
+  if (exth == nullptr) {
+    exth = mobi_get_exthrecord_by_tag(mobi_data, EXTH_THUMBOFFSET);
+  }
+  if (exth) {
+    uint32_t offset = mobi_decode_exthvalue(
+      static_cast<unsigned char*>(exth->data), exth->size);
+    size_t first = mobi_get_first_resource_record(mobi_data);
+    const MOBIPdbRecord* record =
+      mobi_get_record_by_seqnumber(mobi_data, first + offset);
+    if (record && record->data) {
+      image.loadFromData(record->data, int(record->size));
+      if (!image.isNull() && size.isValid()) {
+        image =
+          image.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+      }
+    }
+  }
+
+  mobi_free(mobi_data);
+  return image;
+}
+
+/*!
+ * \brief Reads a mobi for conversion.
+ *
+ * libmobi rebuilds the markup of the book, one part for each kf8 file or a
+ * single part for an older mobi, with its links and image references
+ * rewritten to the names used here: part%05u.html, flow%05u.css and
+ * resource%05u followed by the resource extension. The parts become the
+ * chapters and are not split so that those links still work.
+ */
+bool MobiPlugin::readContent(const QString& path, EBookContent& content)
+{
+  MOBIData* mobi_data = mobi_init();
+  if (mobi_data == nullptr) {
+    return false;
+  }
+  if (mobi_load_filename(mobi_data, QFile::encodeName(path).constData()) !=
+      MOBI_SUCCESS) {
+    mobi_free(mobi_data);
+    return false;
+  }
+  MOBIRawml* rawml = mobi_init_rawml(mobi_data);
+  if (rawml == nullptr) {
+    mobi_free(mobi_data);
+    return false;
+  }
+  if (mobi_parse_rawml(rawml, mobi_data) != MOBI_SUCCESS) {
+    mobi_free_rawml(rawml);
+    mobi_free(mobi_data);
+    return false;
+  }
+
+  for (MOBIPart* part = rawml->markup; part; part = part->next) {
+    EBookContentChapter chapter;
+    chapter.href = QString("part%1.html").arg(part->uid, 5, 10, QChar('0'));
+    chapter.xhtml = QString::fromUtf8(reinterpret_cast<char*>(part->data),
+                                      int(part->size));
+    content.chapters.append(chapter);
+  }
+
+  // the first flow is the text itself, the rest are stylesheets.
+  if (rawml->flow) {
+    for (MOBIPart* part = rawml->flow->next; part; part = part->next) {
+      EBookContentResource resource;
+      resource.href = QString("flow%1.css").arg(part->uid, 5, 10, QChar('0'));
+      resource.media_type = "text/css";
+      resource.data =
+        QByteArray(reinterpret_cast<char*>(part->data), int(part->size));
+      content.resources.append(resource);
+    }
+  }
+
+  uint32_t cover_uid = MOBI_NOTSET;
+  MOBIExthHeader* exth =
+    mobi_get_exthrecord_by_tag(mobi_data, EXTH_COVEROFFSET);
+  if (exth) {
+    cover_uid = mobi_decode_exthvalue(
+      static_cast<unsigned char*>(exth->data), exth->size);
+  }
+  for (MOBIPart* part = rawml->resources; part; part = part->next) {
+    MOBIFileMeta meta = mobi_get_filemeta_by_type(part->type);
+    EBookContentResource resource;
+    resource.href = QString("resource%1.%2")
+                      .arg(part->uid, 5, 10, QChar('0'))
+                      .arg(QString::fromLatin1(meta.extension));
+    resource.media_type = QString::fromLatin1(meta.mime_type);
+    resource.data =
+      QByteArray(reinterpret_cast<char*>(part->data), int(part->size));
+    if (part->uid == cover_uid) {
+      content.cover_href = resource.href;
+    }
+    content.resources.append(resource);
+  }
+
+  mobi_free_rawml(rawml);
+  mobi_free(mobi_data);
+
+  content.metadata = readMetadata(path);
+  return !content.chapters.isEmpty();
+}
+
+/*!
+ * \brief Sets the application options used when creating documents.
+ */
+void MobiPlugin::setOptions(Options* options)
+{
+  m_options = options;
+}
+
+/*!
+ * \brief Mobi and azw files are Palm databases whose type and creator, at
+ * offset 60 of the database header, are BOOKMOBI.
+ */
+EBookSignatureList MobiPlugin::signatures() const
+{
+  EBookSignature signature;
+  signature.offset = 60;
+  signature.magic = "BOOKMOBI";
+  return EBookSignatureList() << signature;
+}
+
 QString MobiPlugin::fileFilter()
 {
   return m_file_filter;
@@ -13,7 +13,7 @@ class MobiDocument;
 class INTERFACESHARED_EXPORT MobiPlugin : public QObject, public IEBookInterface
 {
   Q_OBJECT
-  Q_PLUGIN_METADATA(IID IEBookInterface_iid FILE "ebookinterface.json")
+  Q_PLUGIN_METADATA(IID IEBookInterface_iid FILE "mobiplugin.json")
   Q_INTERFACES(IPluginInterface)
   Q_INTERFACES(IEBookInterface)
 public:
@@ -34,6 +34,12 @@ public:
   // IEBookInterface interface
   IEBookDocument* createDocument(QString path) override;
   IEBookDocument* createCodeDocument() override;
+  Metadata readMetadata(const QString& path) override;
+  EBookChapterList readChapters(const QString& path) override;
+  QImage readCover(const QString& path, const QSize& size) override;
+  bool readContent(const QString& path, EBookContent& content) override;
+  void setOptions(Options* options) override;
+  EBookSignatureList signatures() const override;
   EBookDocumentType type() const override
   {
     return MOBI;
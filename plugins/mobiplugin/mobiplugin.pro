@@ -31,12 +31,14 @@ DESTDIR = $$OUT_PWD/..
 SOURCES += \
     mobiplugin.cpp \
     mobidocument.cpp \
+    mobiheaderreader.cpp \
     private/mobidocument_p.cpp
 
 HEADERS += \
     mobiplugin.h \
     mobiplugin_global.h \
     mobidocument.h \
+    mobiheaderreader.h \
     private/mobidocument_p.h
 
 DISTFILES += \
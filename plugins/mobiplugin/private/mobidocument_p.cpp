@@ -3,8 +3,10 @@
 #include <qlogger/qlogger.h>
 using namespace qlogger;
 
+const QByteArray MobiDocumentPrivate::PAGE_BREAK = "<mbp:pagebreak";
+
 MobiDocumentPrivate::MobiDocumentPrivate(MobiDocument* parent) :
-    q_ptr(parent), m_loaded(false)
+    q_ptr(parent), m_loaded(false), m_current_chapter(0)
 {
 }
 
@@ -119,18 +121,21 @@ void MobiDocumentPrivate::openDocument(const QString& path)
   MOBIData* mobi_data = mobi_init();
   if (mobi_data == nullptr) {
     QLOG_DEBUG(QString("Unable to create MOBI_DATA object"));
+    return;
   }
 
   MOBI_RET mobi_ret = mobi_load_filename(mobi_data, path.toStdString().c_str());
   if (mobi_ret != MOBI_SUCCESS) {
     mobi_free(mobi_data);
     QLOG_DEBUG(QString("Unable to read mobi document"));
+    return;
   }
 
   MOBIRawml* rawml = mobi_init_rawml(mobi_data);
   if (rawml == nullptr) {
     mobi_free(mobi_data);
     QLOG_DEBUG(QString("Unable to read mobi document"));
+    return;
   }
 
   mobi_ret = mobi_parse_rawml(rawml, mobi_data);
@@ -138,6 +143,7 @@ void MobiDocumentPrivate::openDocument(const QString& path)
     mobi_free(mobi_data);
     mobi_free_rawml(rawml);
     QLOG_DEBUG(QString("Unable to read mobi document"));
+    return;
   }
 
   m_drm_key = mobi_data->drm_key;
@@ -150,12 +156,18 @@ void MobiDocumentPrivate::openDocument(const QString& path)
   m_title = m_mobi_header->full_name;
 
   extractExthTags(mobi_data);
-  extractAllRecords(mobi_data);
+  extractChapters(rawml);
+  extractImages(rawml);
 
   /* Free MOBIRawml structure */
   mobi_free_rawml(rawml);
   /* Free MOBIData structure */
   mobi_free(mobi_data);
+
+  if (loadChapter(0)) {
+    m_loaded = true;
+    emit q->loadCompleted();
+  }
 }
 
 void MobiDocumentPrivate::saveDocument()
@@ -163,29 +175,164 @@ void MobiDocumentPrivate::saveDocument()
   // TODO save mobidocument
 }
 
-void MobiDocumentPrivate::extractAllRecords(MOBIData* mobi_data)
+/*
+ * The text records have already been decompressed and split into parts by
+ * mobi_parse_rawml(), so the parts are copied as they are rather than
+ * decompressing the whole of the text a second time. A KF8 book has a part
+ * for each of its files. An older book is a single part, which is split at
+ * its page breaks.
+ */
+void MobiDocumentPrivate::extractChapters(const MOBIRawml* rawml)
+{
+  m_chapters.clear();
+  m_current_chapter = 0;
+  const MOBIPart* part = rawml->markup;
+  bool single_part = (part && !part->next);
+  while (part) {
+    QByteArray markup(reinterpret_cast<const char*>(part->data),
+                      int(part->size));
+    if (single_part) {
+      splitAtPageBreaks(markup);
+    } else if (!markup.isEmpty()) {
+      m_chapters.append(markup);
+    }
+    part = part->next;
+  }
+  if (m_chapters.isEmpty()) {
+    QLOG_DEBUG(QString("No text found in mobi document"));
+  }
+}
+
+void MobiDocumentPrivate::splitAtPageBreaks(const QByteArray& markup)
+{
+  int start = 0;
+  int page_break = markup.indexOf(PAGE_BREAK, 1);
+  while (page_break > 0) {
+    m_chapters.append(markup.mid(start, page_break - start));
+    start = page_break;
+    page_break = markup.indexOf(PAGE_BREAK, start + PAGE_BREAK.size());
+  }
+  m_chapters.append(markup.mid(start));
+}
+
+/*
+ * Only the image records are copied, they stay compressed until the layout
+ * asks for them. The names are the ones that libmobi gives the resources
+ * when it rebuilds the links in the markup.
+ */
+void MobiDocumentPrivate::extractImages(const MOBIRawml* rawml)
+{
+  m_images.clear();
+  m_image_cache.clear();
+  for (const MOBIPart* part = rawml->resources; part; part = part->next) {
+    MOBIFileMeta meta = mobi_get_filemeta_by_type(part->type);
+    if (!QByteArray(meta.mime_type).startsWith("image/") || !part->data) {
+      continue;
+    }
+    QString name = QString("resource%1.%2")
+                     .arg(qulonglong(part->uid), 5, 10, QLatin1Char('0'))
+                     .arg(QString::fromLatin1(meta.extension));
+    m_images.insert(name,
+                    QByteArray(reinterpret_cast<const char*>(part->data),
+                               int(part->size)));
+  }
+}
+
+void MobiDocumentPrivate::setImageCacheSize(int megabytes)
+{
+  m_image_cache.setSize(megabytes);
+}
+
+/*
+ * The chapters are held as utf-8 and the images as their compressed
+ * records, MOBI books have no svgs, css or javascript of their own.
+ */
+EBookMemoryUsage MobiDocumentPrivate::memoryUsage() const
+{
+  Q_Q(const MobiDocument);
+  EBookMemoryUsage usage;
+  usage.images = m_image_cache.bytes();
+  foreach (const QByteArray& chapter, m_chapters) {
+    usage.documents += chapter.size();
+  }
+  foreach (const QByteArray& image, m_images) {
+    usage.resources += image.size();
+  }
+  usage.text_document = q->textDocumentBytes();
+  return usage;
+}
+
+/*
+ * The image is decoded at no more than the page size and added to the
+ * document, so that later layouts of the same chapter do not ask again.
+ */
+QVariant MobiDocumentPrivate::loadResource(int type, const QUrl& name)
 {
   Q_Q(MobiDocument);
-  const size_t maxlen = mobi_get_text_maxsize(mobi_data);
-  size_t size = maxlen;
-  char* data = new char[maxlen];
-  MOBI_RET mobi_ret = mobi_get_rawml(mobi_data, data, &size);
 
-  if (mobi_ret != MOBI_SUCCESS) {
-    // TODO logging
+  QVariant resource;
+  QString key = name.toString();
+  if (type != QTextDocument::ImageResource || !m_images.contains(key)) {
+    return resource;
   }
+  QSize image_size(int(q->pageSize().width() - q->documentMargin() * 4),
+                   int(q->pageSize().height() - q->documentMargin() * 4));
+  QImage image = m_image_cache.image(key, m_images.value(key), image_size);
+  if (!image.isNull()) {
+    resource = QVariant(image);
+    q->addResource(type, name, resource);
+  }
+  return resource;
+}
+
+int MobiDocumentPrivate::currentChapter() const
+{
+  return m_current_chapter;
+}
+
+int MobiDocumentPrivate::chapterCount() const
+{
+  return m_chapters.size();
+}
+
+/*
+ * Only the chapter shown is decoded and laid out, the rest of the book is
+ * held as the utf-8 that libmobi gave.
+ */
+bool MobiDocumentPrivate::loadChapter(int index)
+{
+  Q_Q(MobiDocument);
 
-  QString full_data(data);
-  delete[] data;
+  if (index < 0 || index >= m_chapters.size()) {
+    QLOG_WARN(QString("No mobi chapter at %1").arg(index))
+    return false;
+  }
 
+  bool changing = (!m_loaded || index != m_current_chapter);
+  if (m_loaded && changing) {
+    emit q->chapterAboutToChange(m_current_chapter);
+  }
+  q->setUndoRedoEnabled(false);
+  q->clear();
   QTextCursor cursor(q_ptr);
-  cursor.movePosition(QTextCursor::End);
-  QTextBlockFormat pageBreak;
-  pageBreak.setPageBreakPolicy(QTextFormat::PageBreak_AlwaysBefore);
-  cursor.insertHtml(full_data);
-  cursor.insertBlock(pageBreak);
-  //  q->setBaseUrl(QUrl());
-  m_loaded = true;
-
-  emit q->loadCompleted();
+  cursor.insertHtml(QString::fromUtf8(m_chapters.at(index)));
+  q->setUndoRedoEnabled(true);
+  m_current_chapter = index;
+  if (changing) {
+    emit q->chapterChanged(index);
+  }
+  return true;
+}
+
+QString MobiDocumentPrivate::chapterSource(int index) const
+{
+  if (index < 0 || index >= m_chapters.size()) {
+    return QString();
+  }
+  return QString::fromUtf8(m_chapters.at(index));
+}
+
+bool MobiDocumentPrivate::reloadChapter()
+{
+  return loadChapter(m_current_chapter);
 }
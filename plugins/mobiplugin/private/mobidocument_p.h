@@ -2,9 +2,11 @@
 #define MOBIDOCUMENT_P_H
 
 #include <QFile>
+#include <QMap>
 
 #include <mobi.h>
 
+#include "ebookimagecache.h"
 #include "mobidocument.h"
 
 enum ExthBinaryType {
@@ -113,8 +115,25 @@ public:
   QString title() {}
   void setTitle(QString title) {}
 
+  int currentChapter() const;
+  int chapterCount() const;
+  bool loadChapter(int index);
+  QString chapterSource(int index) const;
+  bool reloadChapter();
+
+  void setImageCacheSize(int megabytes);
+  EBookMemoryUsage memoryUsage() const;
+  QVariant loadResource(int type, const QUrl &name);
+
 protected:
   bool m_loaded;
+  // the utf-8 markup of each chapter, only decoded when it is shown.
+  QList<QByteArray> m_chapters;
+  int m_current_chapter;
+  // the compressed image records, keyed on the file names that libmobi
+  // gives them in the markup.
+  QMap<QString, QByteArray> m_images;
+  EBookImageCache m_image_cache;
   QMultiMap<QString, QString> m_exth_tags;
   QMultiMap<ExthBinaryType, QString> m_binary;
   QMultiMap<QString, uint32_t> m_exth_numerics;
@@ -133,10 +152,14 @@ protected:
   MOBIPdbRecord *m_mobi_record;
 
   void extractExthTags(MOBIData *mobi_data);
-  void extractAllRecords(MOBIData *mobi_data);
+  void extractChapters(const MOBIRawml *rawml);
+  void splitAtPageBreaks(const QByteArray &markup);
+  void extractImages(const MOBIRawml *rawml);
 
   void parseExthTagType(MOBIExthMeta tag, char *exth_string);
 
+  static const QByteArray PAGE_BREAK;
+
 private:
   Q_DECLARE_PUBLIC(MobiDocument)
 };
@@ -1,17 +1,42 @@
 #ifndef IOCRINTERFACE_H
 #define IOCRINTERFACE_H
 
+#include <QStringList>
 #include <QtPlugin>
 
 #include "interface_global.h"
 #include <iplugininterface.h>
 
+/*!
+ * \brief The interface for plugins that turn scanned pages into text.
+ *
+ * The pages are recognised in the background. As each page is finished,
+ * and every page before it, it is added to the chapter and the plugin
+ * sends pageRecognised(int page, QString html), then finished() once the
+ * last page is done.
+ */
 class INTERFACESHARED_EXPORT IOcrInterface : public IPluginInterface
 {
 public:
   ~IOcrInterface()
   {
   }
+
+  /*!
+   * \brief Starts recognising the image files of pages, in reading order.
+   *
+   * \param language - the Tesseract name of the page language, eng for
+   *        instance.
+   * \return false if pages are already being recognised.
+   */
+  virtual bool recognisePages(const QStringList& pages,
+                              const QString& language = QString()) = 0;
+  virtual void cancel() = 0;
+  virtual bool isRunning() const = 0;
+  /*!
+   * \brief The xhtml of a chapter holding every page recognised so far.
+   */
+  virtual QString chapterHtml() const = 0;
 };
 #define IOcrPluginInterface_iid "uk.org.smelecomp.IOcrPluginInterface/0.1.0"
 Q_DECLARE_INTERFACE(IOcrInterface, IOcrPluginInterface_iid)
@@ -0,0 +1,110 @@
+#include "ocrengine.h"
+
+#include <QThreadStorage>
+
+#include <tesseract/baseapi.h>
+#include <tesseract/resultiterator.h>
+
+#include <qlogger/qlogger.h>
+
+using namespace qlogger;
+
+const QString OcrEngine::DEFAULT_LANGUAGE = "eng";
+
+namespace {
+
+QThreadStorage<OcrEngine*> thread_engines;
+
+} // end of anonymous namespace
+
+/*!
+ * \brief Starts an engine, the language data is found by Tesseract
+ * through TESSDATA_PREFIX or its installed data directory.
+ */
+OcrEngine::OcrEngine(const QString& language)
+  : m_api(new tesseract::TessBaseAPI())
+  , m_language(language.isEmpty() ? DEFAULT_LANGUAGE : language)
+  , m_valid(false)
+{
+  m_valid = (m_api->Init(nullptr, m_language.toUtf8().constData()) == 0);
+  if (m_valid) {
+    m_api->SetPageSegMode(tesseract::PSM_AUTO);
+  } else {
+    QLOG_DEBUG(QString("Unable to start Tesseract for %1").arg(m_language))
+  }
+}
+
+OcrEngine::~OcrEngine()
+{
+  m_api->End();
+  delete m_api;
+}
+
+bool OcrEngine::isValid() const
+{
+  return m_valid;
+}
+
+QString OcrEngine::language() const
+{
+  return m_language;
+}
+
+/*!
+ * \brief Recognises a page prepared by Scan.
+ *
+ * \return the paragraphs of the page in reading order, or an empty list if
+ *         nothing could be read.
+ */
+QStringList OcrEngine::recognise(const QImage& page)
+{
+  QStringList paragraphs;
+  if (!m_valid || page.isNull()) {
+    return paragraphs;
+  }
+  QImage grey = page.convertToFormat(QImage::Format_Grayscale8);
+  m_api->SetImage(grey.constBits(),
+                  grey.width(),
+                  grey.height(),
+                  1,
+                  grey.bytesPerLine());
+  if (m_api->Recognize(nullptr) != 0) {
+    QLOG_DEBUG(QString("Tesseract was unable to read the page"))
+    m_api->Clear();
+    return paragraphs;
+  }
+
+  tesseract::ResultIterator* it = m_api->GetIterator();
+  if (it) {
+    do {
+      char* text = it->GetUTF8Text(tesseract::RIL_PARA);
+      if (text) {
+        // the lines of a paragraph are joined back together.
+        QString paragraph = QString::fromUtf8(text).simplified();
+        if (!paragraph.isEmpty()) {
+          paragraphs.append(paragraph);
+        }
+        delete[] text;
+      }
+    } while (it->Next(tesseract::RIL_PARA));
+    delete it;
+  }
+  m_api->Clear();
+  return paragraphs;
+}
+
+/*!
+ * \brief The engine of the calling thread, started the first time it is
+ * needed or when the language changes.
+ */
+OcrEngine* OcrEngine::forThread(const QString& language)
+{
+  QString wanted = (language.isEmpty() ? DEFAULT_LANGUAGE : language);
+  OcrEngine* engine = thread_engines.localData();
+  if (!engine || engine->language() != wanted) {
+    // the old engine is deleted by QThreadStorage.
+    engine = new OcrEngine(wanted);
+    thread_engines.setLocalData(engine);
+  }
+  return engine;
+}
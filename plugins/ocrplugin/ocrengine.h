@@ -0,0 +1,39 @@
+#ifndef OCRENGINE_H
+#define OCRENGINE_H
+
+#include <QImage>
+#include <QString>
+#include <QStringList>
+
+namespace tesseract {
+class TessBaseAPI;
+}
+
+/*!
+ * \brief A Tesseract engine for one language.
+ *
+ * An engine cannot be used by two threads at once and is slow to set up,
+ * so each thread that recognises pages keeps one of its own, given by
+ * forThread(). It is deleted when the thread ends.
+ */
+class OcrEngine
+{
+public:
+  explicit OcrEngine(const QString& language);
+  ~OcrEngine();
+
+  bool isValid() const;
+  QString language() const;
+  QStringList recognise(const QImage& page);
+
+  static OcrEngine* forThread(const QString& language);
+
+  static const QString DEFAULT_LANGUAGE;
+
+protected:
+  tesseract::TessBaseAPI* m_api;
+  QString m_language;
+  bool m_valid;
+};
+
+#endif // OCRENGINE_H
@@ -1,6 +1,160 @@
 #include "ocrplugin.h"
 
+#include "ocrengine.h"
+#include "scan.h"
+
+const QString OcrPlugin::CHAPTER_TEMPLATE =
+  "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+  "<!DOCTYPE html>\n"
+  "<html xmlns=\"http://www.w3.org/1999/xhtml\">\n"
+  "<head>\n<title></title>\n</head>\n"
+  "<body>\n%1</body>\n"
+  "</html>\n";
+
 OcrPlugin::OcrPlugin(QObject* parent)
   : QObject(parent)
+  , m_next_page(0)
+{
+}
+
+OcrPlugin::~OcrPlugin()
+{
+  cancel();
+}
+
+/*!
+ * \brief Starts recognising pages, see IOcrInterface::recognisePages().
+ *
+ * The chapter of any earlier pages is cleared.
+ */
+bool OcrPlugin::recognisePages(const QStringList& pages,
+                               const QString& language)
+{
+  if (isRunning()) {
+    return false;
+  }
+  m_language = language;
+  m_page_html = QVector<QString>(pages.size());
+  m_page_done = QVector<bool>(pages.size(), false);
+  m_next_page = 0;
+  m_body.clear();
+
+  for (int page = 0; page < pages.size(); page++) {
+    QString path = pages.at(page);
+    QFutureWatcher<QImage>* watcher = new QFutureWatcher<QImage>(this);
+    connect(watcher,
+            &QFutureWatcher<QImage>::finished,
+            this,
+            [this, page, watcher]() { pagePrepared(page, watcher); });
+    m_jobs.append(watcher);
+    watcher->setFuture(submitJob<QImage>(
+      [path](QFutureInterface<QImage>&) {
+        Scan scan(path);
+        scan.prepare();
+        return scan.image();
+      },
+      EBookJobs::LOW_PRIORITY));
+  }
+  if (pages.isEmpty()) {
+    emit finished();
+  }
+  return true;
+}
+
+/*!
+ * \brief Stops recognising pages, those already added to the chapter are
+ * kept.
+ *
+ * Pages being worked on are left to finish in the background but their
+ * results are dropped.
+ */
+void OcrPlugin::cancel()
+{
+  foreach (QFutureWatcherBase* watcher, m_jobs) {
+    watcher->disconnect(this);
+    watcher->cancel();
+    watcher->deleteLater();
+  }
+  m_jobs.clear();
+}
+
+bool OcrPlugin::isRunning() const
+{
+  return !m_jobs.isEmpty();
+}
+
+QString OcrPlugin::chapterHtml() const
+{
+  return CHAPTER_TEMPLATE.arg(m_body);
+}
+
+/*
+ * The first stage is done, the page is handed on to be recognised.
+ */
+void OcrPlugin::pagePrepared(int page, QFutureWatcher<QImage>* watcher)
+{
+  m_jobs.removeOne(watcher);
+  watcher->deleteLater();
+  QImage image = (watcher->isCanceled() ? QImage() : watcher->result());
+
+  QString language = m_language;
+  QFutureWatcher<QStringList>* recognised =
+    new QFutureWatcher<QStringList>(this);
+  connect(recognised,
+          &QFutureWatcher<QStringList>::finished,
+          this,
+          [this, page, recognised]() { pageDone(page, recognised); });
+  m_jobs.append(recognised);
+  recognised->setFuture(submitJob<QStringList>(
+    [image, language](QFutureInterface<QStringList>&) {
+      if (image.isNull()) {
+        return QStringList();
+      }
+      return OcrEngine::forThread(language)->recognise(image);
+    },
+    EBookJobs::NORMAL_PRIORITY));
+}
+
+void OcrPlugin::pageDone(int page, QFutureWatcher<QStringList>* watcher)
+{
+  m_jobs.removeOne(watcher);
+  watcher->deleteLater();
+  QStringList paragraphs =
+    (watcher->isCanceled() ? QStringList() : watcher->result());
+  m_page_html[page] = pageHtml(page, paragraphs);
+  m_page_done[page] = true;
+  addPages();
+  if (m_jobs.isEmpty()) {
+    emit finished();
+  }
+}
+
+/*
+ * Adds the pages that are done to the chapter, as long as every page
+ * before them has been added.
+ */
+void OcrPlugin::addPages()
+{
+  while (m_next_page < m_page_done.size() && m_page_done.at(m_next_page)) {
+    QString html = m_page_html.at(m_next_page);
+    m_body += html;
+    // only the chapter is wanted from here on.
+    m_page_html[m_next_page].clear();
+    emit pageRecognised(m_next_page, html);
+    m_next_page++;
+  }
+}
+
+/*
+ * A page is a div holding a paragraph for each paragraph found, an
+ * unreadable page gives an empty div so that the page numbers still match.
+ */
+QString OcrPlugin::pageHtml(int page, const QStringList& paragraphs)
 {
+  QString html = QString("<div class=\"page\" id=\"page%1\">\n").arg(page + 1);
+  foreach (QString paragraph, paragraphs) {
+    html += "<p>" + paragraph.toHtmlEscaped() + "</p>\n";
+  }
+  html += "</div>\n";
+  return html;
 }
@@ -1,11 +1,28 @@
 #ifndef OCRPLUGIN_H
 #define OCRPLUGIN_H
 
+#include <QFutureWatcher>
+#include <QImage>
+#include <QList>
 #include <QObject>
+#include <QVector>
 
 #include "iocrinterface.h"
 #include "ocrplugin_global.h"
 
+/*!
+ * \brief Recognises scanned pages into the xhtml of a chapter.
+ *
+ * Each page goes through two stages, each a job in the shared thread pool
+ * (see EBookJobs). The first loads, straightens and binarizes it with Scan,
+ * the second recognises it with the Tesseract engine of the pool thread
+ * that runs it, see OcrEngine. Pages go through the stages side by side,
+ * and recognition is given the higher priority so that prepared pages do
+ * not pile up in memory while more are prepared.
+ *
+ * Pages are added to the chapter in reading order as soon as they and
+ * every page before them are done.
+ */
 class OCRPLUGINSHARED_EXPORT OcrPlugin : public QObject, public IOcrInterface
 {
   Q_OBJECT
@@ -15,6 +32,13 @@ class OCRPLUGINSHARED_EXPORT OcrPlugin : public QObject, public IOcrInterface
 
 public:
   OcrPlugin(QObject* parent = nullptr);
+  ~OcrPlugin();
+
+  bool recognisePages(const QStringList& pages,
+                      const QString& language = QString()) override;
+  void cancel() override;
+  bool isRunning() const override;
+  QString chapterHtml() const override;
 
   QString pluginGroup() const
   {
@@ -54,6 +78,26 @@ public:
   void buildMenu()
   {
   }
+
+signals:
+  void pageRecognised(int page, QString html);
+  void finished();
+
+protected:
+  QString m_language;
+  QList<QFutureWatcherBase*> m_jobs;
+  // the xhtml of each page, and whether it has been done.
+  QVector<QString> m_page_html;
+  QVector<bool> m_page_done;
+  int m_next_page; // the first page not yet added to the chapter.
+  QString m_body;
+
+  void pagePrepared(int page, QFutureWatcher<QImage>* watcher);
+  void pageDone(int page, QFutureWatcher<QStringList>* watcher);
+  void addPages();
+  static QString pageHtml(int page, const QStringList& paragraphs);
+
+  static const QString CHAPTER_TEMPLATE;
 };
 
 #endif // OCRPLUGIN_H
@@ -19,17 +19,21 @@ DEFINES += \
 SOURCES += \
     ocrplugin.cpp \
     iocrinterface.cpp \
+    ocrengine.cpp \
     scan.cpp
 
 HEADERS += \
     ocrplugin.h \
     ocrplugin_global.h \
     iocrinterface.h \
+    ocrengine.h \
     scan.h
 
 DISTFILES += \
     ocrplugin.json
 
+unix|win32: LIBS += -ltesseract
+unix|win32: LIBS += -lqloggerlib
 
 win32:CONFIG(release, debug|release): LIBS += -L$$OUT_PWD/../../interface/ -linterface
 else:win32:CONFIG(debug, debug|release): LIBS += -L$$OUT_PWD/../../interface/ -linterfaced
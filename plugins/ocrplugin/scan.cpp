@@ -1,6 +1,208 @@
 #include "scan.h"
 
+#include <QPainter>
+#include <QPoint>
+#include <QVector>
+
+#include <cmath>
 
 Scan::Scan()
+  : m_skew(0.0)
+{
+}
+
+Scan::Scan(const QString& path)
+  : m_path(path)
+  , m_skew(0.0)
+{
+}
+
+/*!
+ * \brief Loads and prepares the page.
+ *
+ * This only works on QImages so can be run in any thread.
+ *
+ * \return false if the image could not be read.
+ */
+bool Scan::prepare()
+{
+  QImage loaded(m_path);
+  if (loaded.isNull()) {
+    m_image = QImage();
+    return false;
+  }
+  QImage grey = toGrey(loaded);
+  int threshold = otsuThreshold(grey);
+  m_skew = findSkew(grey, threshold);
+  if (m_skew != 0.0) {
+    grey = rotate(grey, m_skew);
+    threshold = otsuThreshold(grey);
+  }
+  m_image = binarize(grey, threshold);
+  return true;
+}
+
+bool Scan::isNull() const
+{
+  return m_image.isNull();
+}
+
+QString Scan::path() const
+{
+  return m_path;
+}
+
+QImage Scan::image() const
+{
+  return m_image;
+}
+
+/*!
+ * \brief The angle, in degrees, that the page was turned through to
+ * straighten it.
+ */
+double Scan::skew() const
+{
+  return m_skew;
+}
+
+QImage Scan::toGrey(const QImage& image)
+{
+  return image.convertToFormat(QImage::Format_Grayscale8);
+}
+
+/*!
+ * \brief The grey level that best splits the page into ink and paper, by
+ * Otsu's method.
+ */
+int Scan::otsuThreshold(const QImage& grey)
+{
+  QVector<qint64> histogram(256, 0);
+  for (int y = 0; y < grey.height(); y++) {
+    const uchar* line = grey.constScanLine(y);
+    for (int x = 0; x < grey.width(); x++) {
+      histogram[line[x]]++;
+    }
+  }
+
+  qint64 total = qint64(grey.width()) * grey.height();
+  double sum = 0;
+  for (int i = 0; i < 256; i++) {
+    sum += double(i) * histogram.at(i);
+  }
+  double sum_below = 0, best = 0;
+  qint64 below = 0;
+  int threshold = 128;
+  for (int i = 0; i < 256; i++) {
+    below += histogram.at(i);
+    if (below == 0) {
+      continue;
+    }
+    qint64 above = total - below;
+    if (above == 0) {
+      break;
+    }
+    sum_below += double(i) * histogram.at(i);
+    double mean_below = sum_below / below;
+    double mean_above = (sum - sum_below) / above;
+    double difference = mean_below - mean_above;
+    double between = double(below) * above * difference * difference;
+    if (between > best) {
+      best = between;
+      threshold = i;
+    }
+  }
+  return threshold;
+}
+
+/*!
+ * \brief Black ink on a white page, pixels at or below threshold are ink.
+ */
+QImage Scan::binarize(const QImage& grey, int threshold)
+{
+  QImage binary(grey.size(), QImage::Format_Grayscale8);
+  for (int y = 0; y < grey.height(); y++) {
+    const uchar* in = grey.constScanLine(y);
+    uchar* out = binary.scanLine(y);
+    for (int x = 0; x < grey.width(); x++) {
+      out[x] = (in[x] <= threshold ? 0 : 255);
+    }
+  }
+  return binary;
+}
+
+/*!
+ * \brief The angle, in degrees, to turn the page through to make its
+ * lines of text level.
+ *
+ * The ink of a scaled down copy of the page is projected onto its rows at
+ * each angle tried. The lines of text are level at the angle where the
+ * rows are most sharply split into full and empty ones, which is where the
+ * sum of the squares of the row counts is greatest.
+ */
+double Scan::findSkew(const QImage& grey, int threshold)
+{
+  QImage sample = grey;
+  if (sample.width() > SKEW_SAMPLE_WIDTH) {
+    sample = grey.scaledToWidth(SKEW_SAMPLE_WIDTH, Qt::FastTransformation);
+  }
+  QVector<QPoint> ink;
+  for (int y = 0; y < sample.height(); y++) {
+    const uchar* line = sample.constScanLine(y);
+    for (int x = 0; x < sample.width(); x++) {
+      if (line[x] <= threshold) {
+        ink.append(QPoint(x, y));
+      }
+    }
+  }
+  if (ink.isEmpty()) {
+    return 0.0;
+  }
+
+  // rows for every turned point, the page may grow by its width times the
+  // sine of the largest angle either way.
+  int margin = int(std::ceil(sample.width() * std::sin(MAX_SKEW * M_PI / 180)));
+  QVector<int> rows(sample.height() + 2 * margin + 1);
+  double best_angle = 0.0;
+  double best_score = -1;
+  for (double angle = -MAX_SKEW; angle <= MAX_SKEW; angle += SKEW_STEP) {
+    double radians = angle * M_PI / 180;
+    double sine = std::sin(radians), cosine = std::cos(radians);
+    rows.fill(0);
+    foreach (QPoint point, ink) {
+      int row = int(point.x() * sine + point.y() * cosine) + margin;
+      if (row >= 0 && row < rows.size()) {
+        rows[row]++;
+      }
+    }
+    double score = 0;
+    foreach (int count, rows) {
+      score += double(count) * count;
+    }
+    // a tie goes to the smaller turn.
+    if (score > best_score ||
+        (score == best_score && qAbs(angle) < qAbs(best_angle))) {
+      best_score = score;
+      best_angle = angle;
+    }
+  }
+  return (qAbs(best_angle) < SKEW_STEP / 2 ? 0.0 : best_angle);
+}
+
+/*!
+ * \brief Turns the page about its centre, the corners uncovered are left
+ * white.
+ */
+QImage Scan::rotate(const QImage& grey, double angle)
 {
+  QImage turned(grey.size(), QImage::Format_RGB32);
+  turned.fill(Qt::white);
+  QPainter painter(&turned);
+  painter.setRenderHint(QPainter::SmoothPixmapTransform);
+  painter.translate(grey.width() / 2.0, grey.height() / 2.0);
+  painter.rotate(angle);
+  painter.translate(-grey.width() / 2.0, -grey.height() / 2.0);
+  painter.drawImage(0, 0, grey);
+  painter.end();
+  return toGrey(turned);
 }
@@ -1,13 +1,47 @@
 #ifndef SCAN_H
 #define SCAN_H
 
+#include <QImage>
+#include <QString>
+
 #include "ocrplugin_global.h"
 
+/*!
+ * \brief A scanned page, made ready for recognition.
+ *
+ * prepare() loads the image, turns it to grey, straightens it and then
+ * binarizes it with Otsu's threshold, leaving a black on white page in
+ * QImage::Format_Grayscale8.
+ */
 class OCRPLUGINSHARED_EXPORT Scan
 {
 
 public:
   Scan();
+  explicit Scan(const QString& path);
+
+  bool prepare();
+  bool isNull() const;
+  QString path() const;
+  QImage image() const;
+  double skew() const;
+
+  static QImage toGrey(const QImage& image);
+  static int otsuThreshold(const QImage& grey);
+  static QImage binarize(const QImage& grey, int threshold);
+  static double findSkew(const QImage& grey, int threshold);
+  static QImage rotate(const QImage& grey, double angle);
+
+protected:
+  QString m_path;
+  QImage m_image;
+  double m_skew;
+
+  // the largest skew looked for, either way, and the step between tries.
+  static constexpr double MAX_SKEW = 5.0; // degrees.
+  static constexpr double SKEW_STEP = 0.25;
+  // the page is scaled down to this width to find the skew.
+  static const int SKEW_SAMPLE_WIDTH = 800;
 };
 
 #endif // SCAN_H
@@ -0,0 +1,271 @@
+#include "pdfdocument.h"
+
+#include "private/pdfdocument_p.h"
+
+PdfDocument::PdfDocument(QObject* parent)
+  : ITextDocument(parent)
+  , d_ptr(new PdfDocumentPrivate(this))
+{}
+
+PdfDocument::~PdfDocument()
+{
+  delete d_ptr;
+}
+
+QString
+PdfDocument::filename()
+{
+  Q_D(PdfDocument);
+  return d->filename();
+}
+
+void
+PdfDocument::setFilename(const QString& filename)
+{
+  Q_D(PdfDocument);
+  d->setFilename(filename);
+}
+
+void
+PdfDocument::openDocument(const QString& path)
+{
+  Q_D(PdfDocument);
+  d->openDocument(path);
+}
+
+/*!
+ * \brief PDFs are read only, there is nothing to save.
+ */
+void
+PdfDocument::saveDocument(const QString& /*path*/)
+{}
+
+IEBookInterface*
+PdfDocument::plugin()
+{
+  Q_D(PdfDocument);
+  return d->plugin();
+}
+
+void
+PdfDocument::setPlugin(IEBookInterface* plugin)
+{
+  Q_D(PdfDocument);
+  d->setPlugin(plugin);
+}
+
+bool
+PdfDocument::isModified()
+{
+  return false;
+}
+
+QString
+PdfDocument::tocAsString()
+{
+  return toc().toHtml();
+}
+
+EBookToc
+PdfDocument::toc()
+{
+  Q_D(PdfDocument);
+  return d->toc();
+}
+
+EBookToc
+PdfDocument::buildTocFromData()
+{
+  return toc();
+}
+
+QString
+PdfDocument::title()
+{
+  Q_D(PdfDocument);
+  return d->title();
+}
+
+void
+PdfDocument::setTitle(const QString& title)
+{
+  Q_D(PdfDocument);
+  d->setTitle(title);
+}
+
+QString
+PdfDocument::subject()
+{
+  Q_D(PdfDocument);
+  return d->subject();
+}
+
+void
+PdfDocument::setSubject(const QString& subject)
+{
+  Q_D(PdfDocument);
+  d->setSubject(subject);
+}
+
+QString
+PdfDocument::language()
+{
+  Q_D(PdfDocument);
+  return d->language();
+}
+
+void
+PdfDocument::setLanguage(const QString& language)
+{
+  Q_D(PdfDocument);
+  d->setLanguage(language);
+}
+
+QDateTime
+PdfDocument::date()
+{
+  Q_D(PdfDocument);
+  return d->date();
+}
+
+void
+PdfDocument::setDate(const QDateTime& date)
+{
+  Q_D(PdfDocument);
+  d->setDate(date);
+}
+
+QStringList
+PdfDocument::creators()
+{
+  Q_D(PdfDocument);
+  return d->creators();
+}
+
+QString
+PdfDocument::creatorNames(const QStringList& names)
+{
+  Q_D(PdfDocument);
+  return d->creatorNames(names);
+}
+
+QString
+PdfDocument::publisher()
+{
+  Q_D(PdfDocument);
+  return d->publisher();
+}
+
+void
+PdfDocument::setPublisher(const QString& publisher)
+{
+  Q_D(PdfDocument);
+  d->setPublisher(publisher);
+}
+
+QDate
+PdfDocument::published()
+{
+  Q_D(PdfDocument);
+  return d->published();
+}
+
+void
+PdfDocument::setPublished(const QDate& published)
+{
+  Q_D(PdfDocument);
+  d->setPublished(published);
+}
+
+Metadata
+PdfDocument::metadata()
+{
+  Q_D(PdfDocument);
+  return d->metadata();
+}
+
+int
+PdfDocument::currentChapter()
+{
+  Q_D(PdfDocument);
+  return d->currentChapter();
+}
+
+int
+PdfDocument::chapterCount()
+{
+  Q_D(PdfDocument);
+  return d->chapterCount();
+}
+
+bool
+PdfDocument::setCurrentChapter(int index)
+{
+  Q_D(PdfDocument);
+  return d->loadChapter(index);
+}
+
+int
+PdfDocument::chapterOfHref(const QString& href)
+{
+  Q_D(PdfDocument);
+  return d->chapterOfHref(href);
+}
+
+QString
+PdfDocument::chapterSource()
+{
+  Q_D(PdfDocument);
+  return d->chapterSource(d->currentChapter());
+}
+
+QString
+PdfDocument::chapterSourceAt(int index)
+{
+  Q_D(PdfDocument);
+  return d->chapterSource(index);
+}
+
+bool
+PdfDocument::reloadChapter()
+{
+  Q_D(PdfDocument);
+  return d->reloadChapter();
+}
+
+/*!
+ * \brief Sets the directory that rendered page tiles are kept in, it must
+ * be set before the book is opened.
+ */
+void
+PdfDocument::setCacheDirectory(const QString& directory)
+{
+  Q_D(PdfDocument);
+  d->setCacheDirectory(directory);
+}
+
+/*!
+ * \brief Sets the memory held by rendered page tiles in megabytes.
+ */
+void
+PdfDocument::setImageCacheSize(int megabytes)
+{
+  Q_D(PdfDocument);
+  d->setImageCacheSize(megabytes);
+}
+
+/*!
+ * \brief Pages are rendered from the book on demand.
+ *
+ * Anything that the book does not hold is passed on to QTextDocument.
+ */
+QVariant
+PdfDocument::loadResource(int type, const QUrl& name)
+{
+  Q_D(PdfDocument);
+  QVariant resource = d->loadResource(type, name);
+  if (resource.isValid()) {
+    return resource;
+  }
+  return ITextDocument::loadResource(type, name);
+}
@@ -0,0 +1,81 @@
+#ifndef PDFDOCUMENT_H
+#define PDFDOCUMENT_H
+
+#include <QDateTime>
+#include <QObject>
+#include <QTextDocument>
+#include <QUrl>
+#include <QVariant>
+
+#include "ebookcommon.h"
+#include "iebookdocument.h"
+#include "interface_global.h"
+
+class PdfDocumentPrivate;
+
+/*!
+ * \brief A PDF shown a page at a time, each page being a chapter.
+ *
+ * A page is shown as its rendered image, which is made from tiles that are
+ * only rendered when the page is first shown, see PdfRenderer, and the
+ * pages either side of it are rendered in the background. PDFs cannot be
+ * edited so the document is read only.
+ */
+class INTERFACESHARED_EXPORT PdfDocument : public ITextDocument
+{
+  Q_OBJECT
+  Q_DECLARE_PRIVATE(PdfDocument)
+
+public:
+  PdfDocument(QObject* parent = nullptr);
+  virtual ~PdfDocument() override;
+
+  // IEBookDocument interface
+  QString filename() override;
+  void setFilename(const QString& filename) override;
+  void openDocument(const QString& path) override;
+  void saveDocument(const QString& path = QString()) override;
+  IEBookInterface* plugin() override;
+  void setPlugin(IEBookInterface* plugin) override;
+  EBookDocumentType type() const override { return PDF; }
+  bool isModified() override;
+
+  QString tocAsString() override;
+  EBookToc toc() override;
+  EBookToc buildTocFromData() override;
+
+  QString title() override;
+  void setTitle(const QString& title) override;
+  QString subject() override;
+  void setSubject(const QString& subject) override;
+  QString language() override;
+  void setLanguage(const QString& language) override;
+  QDateTime date() override;
+  void setDate(const QDateTime& date) override;
+  QStringList creators() override;
+  QString creatorNames(const QStringList& names) override;
+  QString publisher() override;
+  void setPublisher(const QString& publisher) override;
+  QDate published() override;
+  void setPublished(const QDate& published) override;
+
+  Metadata metadata() override;
+
+  int currentChapter() override;
+  int chapterCount() override;
+  bool setCurrentChapter(int index) override;
+  int chapterOfHref(const QString& href) override;
+  QString chapterSource() override;
+  QString chapterSourceAt(int index) override;
+  bool reloadChapter() override;
+
+  void setCacheDirectory(const QString& directory);
+  void setImageCacheSize(int megabytes);
+
+protected:
+  PdfDocumentPrivate* d_ptr;
+
+  QVariant loadResource(int type, const QUrl& name) override;
+};
+
+#endif // PDFDOCUMENT_H
@@ -0,0 +1,179 @@
+#include "pdfplugin.h"
+
+#include <cmath>
+
+#include "pdfdocument.h"
+#include "pdfrenderer.h"
+
+const QString PdfPlugin::m_plugin_name = "PDF Reader";
+const QString PdfPlugin::m_plugin_group = "Book Reader";
+const QString PdfPlugin::m_vendor = "SM Electronic Components";
+const int PdfPlugin::m_major_version = PDF_VERSION_MAJOR;
+const int PdfPlugin::m_minor_version = PDF_VERSION_MINOR;
+const int PdfPlugin::m_build_version = PDF_VERSION_BUILD;
+const QString PdfPlugin::m_version = QString("%1.%2.%3")
+                                     .arg(PdfPlugin::m_major_version)
+                                     .arg(PdfPlugin::m_minor_version)
+                                     .arg(PdfPlugin::m_build_version);
+bool PdfPlugin::m_loaded = false;
+const QString PdfPlugin::m_file_filter = "*.pdf";
+const QString PdfPlugin::m_file_description = "PDF Document";
+
+PdfPlugin::PdfPlugin(QObject* parent)
+  : QObject(parent)
+  , m_options(nullptr)
+{}
+
+QString PdfPlugin::pluginGroup() const
+{
+  return m_plugin_group;
+}
+
+QString PdfPlugin::pluginName() const
+{
+  return m_plugin_name;
+}
+
+QString PdfPlugin::vendor() const
+{
+  return m_vendor;
+}
+
+bool PdfPlugin::loaded() const
+{
+  return m_loaded;
+}
+
+void PdfPlugin::setLoaded(bool loaded)
+{
+  m_loaded = loaded;
+}
+
+QString PdfPlugin::version() const
+{
+  return m_version;
+}
+
+int PdfPlugin::majorVersion() const
+{
+  return m_major_version;
+}
+
+int PdfPlugin::minorVersion() const
+{
+  return m_minor_version;
+}
+
+int PdfPlugin::buildVersion() const
+{
+  return m_build_version;
+}
+
+void PdfPlugin::buildMenu() {}
+
+IEBookDocument* PdfPlugin::createDocument(QString path)
+{
+  PdfDocument* document = new PdfDocument(this);
+  document->setPlugin(this);
+  if (m_options) {
+    document->setCacheDirectory(m_options->cacheDirectory());
+    document->setImageCacheSize(m_options->imageCacheSize());
+  }
+  document->openDocument(path);
+  return document;
+}
+
+/*!
+ * \brief PDFs have no source to edit.
+ */
+IEBookDocument* PdfPlugin::createCodeDocument()
+{
+  return nullptr;
+}
+
+/*!
+ * \brief Reads the title and authors of a PDF from its information
+ * dictionary, no page is parsed.
+ */
+Metadata PdfPlugin::readMetadata(const QString& path)
+{
+  PdfRenderer renderer;
+  if (!renderer.load(path)) {
+    return Metadata();
+  }
+  return renderer.metadata();
+}
+
+/*!
+ * \brief Reads the text of every page for the search index, each page is
+ * a chapter with the id pageN, counted from 1.
+ */
+EBookChapterList PdfPlugin::readChapters(const QString& path)
+{
+  EBookChapterList chapters;
+  PdfRenderer renderer;
+  if (!renderer.load(path)) {
+    return chapters;
+  }
+  for (int page = 0; page < renderer.pageCount(); page++) {
+    EBookChapterText chapter;
+    chapter.id = QString("page%1").arg(page + 1);
+    chapter.text = renderer.pageText(page).toHtmlEscaped();
+    chapters.append(chapter);
+  }
+  return chapters;
+}
+
+/*!
+ * \brief Renders the first page, at a resolution that fits it to size,
+ * as the cover.
+ */
+QImage PdfPlugin::readCover(const QString& path, const QSize& size)
+{
+  PdfRenderer renderer;
+  if (!renderer.load(path)) {
+    return QImage();
+  }
+  QSizeF points = renderer.pageSize(0);
+  if (points.isEmpty()) {
+    return QImage();
+  }
+  // the smallest whole resolution that covers size.
+  int dpi = 72;
+  if (size.isValid()) {
+    double scale = qMin(size.width() / points.width(),
+                        size.height() / points.height());
+    dpi = qMax(1, int(std::ceil(72 * scale)));
+  }
+  QImage image = renderer.renderPage(0, dpi);
+  if (!image.isNull() && size.isValid()) {
+    image = image.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+  }
+  return image;
+}
+
+/*!
+ * \brief Sets the application options used when creating documents.
+ */
+void PdfPlugin::setOptions(Options* options)
+{
+  m_options = options;
+}
+
+EBookSignatureList PdfPlugin::signatures() const
+{
+  EBookSignature signature;
+  signature.offset = 0;
+  signature.magic = "%PDF-";
+  return EBookSignatureList() << signature;
+}
+
+QString PdfPlugin::fileFilter()
+{
+  return m_file_filter;
+}
+
+QString PdfPlugin::fileDescription()
+{
+  return m_file_description;
+}
@@ -0,0 +1,66 @@
+#-------------------------------------------------
+#
+# PDF reader plugin, pages are read and rendered with Poppler.
+#
+#-------------------------------------------------
+
+QT       += core gui xml svg
+
+TEMPLATE = lib
+CONFIG         += plugin
+CONFIG += c++14
+
+VERSION_MAJOR = 0
+VERSION_MINOR = 1
+VERSION_BUILD = 0
+
+DEFINES += \
+       "PDF_VERSION_MAJOR=$$VERSION_MAJOR" \
+       "PDF_VERSION_MINOR=$$VERSION_MINOR" \
+       "PDF_VERSION_BUILD=$$VERSION_BUILD"
+
+TARGET = pdfplugin
+DESTDIR = $$OUT_PWD/..
+
+SOURCES += \
+    pdfplugin.cpp \
+    pdfdocument.cpp \
+    pdfrenderer.cpp \
+    pdftilecache.cpp \
+    private/pdfdocument_p.cpp
+
+HEADERS += \
+    pdfplugin.h \
+    pdfplugin_global.h \
+    pdfdocument.h \
+    pdfrenderer.h \
+    pdftilecache.h \
+    private/pdfdocument_p.h
+
+DISTFILES += \
+    pdfplugin.json
+
+INCLUDEPATH += /usr/local/include
+INCLUDEPATH += /usr/include/poppler/qt5
+
+# Poppler library
+unix|win32: LIBS += -lpoppler-qt5
+# QLogger library
+unix|win32: LIBS += -lqloggerlib
+# QYaml YAML Extensions
+unix|win32: LIBS += -lqyaml-cpp
+# YAML library
+unix|win32: LIBS += -lyaml-cpp
+
+win32:CONFIG(release, debug|release): LIBS += -L$$OUT_PWD/../../interface/ -linterface
+else:win32:CONFIG(debug, debug|release): LIBS += -L$$OUT_PWD/../../interface/ -linterface
+else:unix: LIBS += -L$$OUT_PWD/../../interface/ -linterface
+
+INCLUDEPATH += $$PWD/../../interface
+DEPENDPATH += $$PWD/../../interface
+
+win32-g++:CONFIG(release, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../../interface/libinterface.a
+else:win32-g++:CONFIG(debug, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../../interface/libinterface.a
+else:win32:!win32-g++:CONFIG(release, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../../interface/interface.lib
+else:win32:!win32-g++:CONFIG(debug, debug|release): PRE_TARGETDEPS += $$OUT_PWD/../../interface/interface.lib
+else:unix: PRE_TARGETDEPS += $$OUT_PWD/../../interface/libinterface.a
@@ -0,0 +1,12 @@
+#ifndef PDFPLUGIN_GLOBAL_H
+#define PDFPLUGIN_GLOBAL_H
+
+#include <QtCore/qglobal.h>
+
+#if defined(PDFPLUGIN_LIBRARY)
+#  define PDFPLUGINSHARED_EXPORT Q_DECL_EXPORT
+#else
+#  define PDFPLUGINSHARED_EXPORT Q_DECL_IMPORT
+#endif
+
+#endif // PDFPLUGIN_GLOBAL_H
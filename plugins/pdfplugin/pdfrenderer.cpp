@@ -0,0 +1,264 @@
+#include "pdfrenderer.h"
+
+#include <QMutexLocker>
+#include <QPainter>
+#include <QRegularExpression>
+
+#include <poppler-qt5.h>
+
+#include <qlogger/qlogger.h>
+
+#include "ebookjobs.h"
+
+using namespace qlogger;
+
+PdfRenderer::PdfRenderer()
+  : m_document(nullptr)
+  , m_page_count(0)
+{}
+
+PdfRenderer::~PdfRenderer()
+{
+  delete m_document;
+}
+
+/*!
+ * \brief Loads the book, see the class description.
+ *
+ * \return false if the file could not be read or is locked.
+ */
+bool PdfRenderer::load(const QString& path)
+{
+  QMutexLocker locker(&m_mutex);
+  delete m_document;
+  m_document = Poppler::Document::load(path);
+  if (!m_document || m_document->isLocked()) {
+    QLOG_DEBUG(QString("Unable to open the PDF %1").arg(path))
+    delete m_document;
+    m_document = nullptr;
+    m_page_count = 0;
+    return false;
+  }
+  m_document->setRenderHint(Poppler::Document::Antialiasing, true);
+  m_document->setRenderHint(Poppler::Document::TextAntialiasing, true);
+  m_page_count = m_document->numPages();
+  return true;
+}
+
+bool PdfRenderer::isLoaded() const
+{
+  return (m_document != nullptr);
+}
+
+int PdfRenderer::pageCount() const
+{
+  return m_page_count;
+}
+
+/*!
+ * \brief The size of a page in points.
+ */
+QSizeF PdfRenderer::pageSize(int page)
+{
+  QMutexLocker locker(&m_mutex);
+  if (!m_document || page < 0 || page >= m_page_count) {
+    return QSizeF();
+  }
+  QScopedPointer<Poppler::Page> pdf_page(m_document->page(page));
+  return (pdf_page ? pdf_page->pageSizeF() : QSizeF());
+}
+
+/*!
+ * \brief The whole of a page at dpi, built from its tiles.
+ *
+ * Tiles already in the tile cache are not rendered again.
+ */
+QImage PdfRenderer::renderPage(int page, int dpi)
+{
+  QSizeF points = pageSize(page);
+  if (points.isEmpty()) {
+    return QImage();
+  }
+  QSize size(qRound(points.width() * dpi / 72.0),
+             qRound(points.height() * dpi / 72.0));
+  QImage image(size, QImage::Format_RGB32);
+  image.fill(Qt::white);
+  QPainter painter(&image);
+  int tile_size = PdfTileCache::TILE_SIZE;
+  for (int row = 0; row * tile_size < size.height(); row++) {
+    for (int column = 0; column * tile_size < size.width(); column++) {
+      QImage tile = renderTile(page, dpi, column, row, size);
+      painter.drawImage(column * tile_size, row * tile_size, tile);
+    }
+  }
+  painter.end();
+  return image;
+}
+
+/*!
+ * \brief Renders the tiles of a page into the tile cache in the
+ * background, at low priority so that it never holds up the page shown.
+ */
+void PdfRenderer::prerenderPage(int page, int dpi)
+{
+  if (page < 0 || page >= m_page_count) {
+    return;
+  }
+  QString key = queuedKey(page, dpi);
+  {
+    QMutexLocker locker(&m_queued_mutex);
+    if (m_queued.contains(key)) {
+      return;
+    }
+    m_queued.insert(key);
+  }
+  // the job holds the renderer so that it outlives a closed document.
+  SharedPdfRenderer renderer = sharedFromThis();
+  EBookJobs::submit<bool>(
+    [renderer, page, dpi, key](QFutureInterface<bool>&) {
+      renderer->renderPage(page, dpi);
+      QMutexLocker locker(&renderer->m_queued_mutex);
+      renderer->m_queued.remove(key);
+      return true;
+    },
+    EBookJobs::LOW_PRIORITY);
+}
+
+/*!
+ * \brief The text of a page, in reading order.
+ */
+QString PdfRenderer::pageText(int page)
+{
+  QMutexLocker locker(&m_mutex);
+  if (!m_document || page < 0 || page >= m_page_count) {
+    return QString();
+  }
+  QScopedPointer<Poppler::Page> pdf_page(m_document->page(page));
+  return (pdf_page ? pdf_page->text(QRectF()) : QString());
+}
+
+/*!
+ * \brief A value from the document information dictionary, Title or
+ * Author for instance.
+ */
+QString PdfRenderer::info(const QString& key)
+{
+  QMutexLocker locker(&m_mutex);
+  return (m_document ? m_document->info(key) : QString());
+}
+
+QDateTime PdfRenderer::date(const QString& key)
+{
+  QMutexLocker locker(&m_mutex);
+  return (m_document ? m_document->date(key) : QDateTime());
+}
+
+/*!
+ * \brief The bookmarks of the book as a table of contents, each entry
+ * links to its page as pageN, counted from 1.
+ */
+EBookToc PdfRenderer::outline()
+{
+  EBookToc toc;
+  QMutexLocker locker(&m_mutex);
+  if (m_document) {
+    addOutlineItems(m_document->outline(), toc.entries);
+  }
+  return toc;
+}
+
+/*!
+ * \brief The names in the Author entry, which may hold several split by
+ * semicolons or ampersands.
+ */
+QStringList PdfRenderer::creators()
+{
+  QStringList creators;
+  QRegularExpression separators("\\s*[;&]\\s*");
+  foreach (QString name, info("Author").split(separators)) {
+    name = name.trimmed();
+    if (!name.isEmpty()) {
+      creators.append(name);
+    }
+  }
+  return creators;
+}
+
+/*!
+ * \brief The title and creators of the book from the information
+ * dictionary, nothing else of the book is read.
+ */
+Metadata PdfRenderer::metadata()
+{
+  Metadata metadata(new EBookMetadata());
+  QString name = info("Title").trimmed();
+  if (!name.isEmpty()) {
+    Title title(new EBookTitle());
+    title->title = name;
+    OrderedTitleMap titles;
+    titles.insert(1, title);
+    metadata->setOrderedTitles(titles);
+  }
+  metadata->setCreatorList(creators());
+  return metadata;
+}
+
+PdfTileCache* PdfRenderer::tileCache()
+{
+  return &m_tiles;
+}
+
+/*
+ * Renders the part of a page of size pixels, at dpi, that falls within a
+ * tile. Tiles on the right and bottom edges are cut to the page.
+ */
+QImage PdfRenderer::renderTile(int page,
+                               int dpi,
+                               int column,
+                               int row,
+                               QSize size)
+{
+  QImage tile = m_tiles.tile(page, dpi, column, row);
+  if (!tile.isNull()) {
+    return tile;
+  }
+  int tile_size = PdfTileCache::TILE_SIZE;
+  int x = column * tile_size, y = row * tile_size;
+  int width = qMin(tile_size, size.width() - x);
+  int height = qMin(tile_size, size.height() - y);
+  {
+    QMutexLocker locker(&m_mutex);
+    if (!m_document) {
+      return QImage();
+    }
+    QScopedPointer<Poppler::Page> pdf_page(m_document->page(page));
+    if (pdf_page) {
+      tile = pdf_page->renderToImage(dpi, dpi, x, y, width, height);
+    }
+  }
+  m_tiles.insert(page, dpi, column, row, tile);
+  return tile;
+}
+
+QString PdfRenderer::queuedKey(int page, int dpi)
+{
+  return QString("%1-%2").arg(page).arg(dpi);
+}
+
+void PdfRenderer::addOutlineItems(const QVector<Poppler::OutlineItem>& items,
+                                  TocEntryList& entries)
+{
+  foreach (Poppler::OutlineItem item, items) {
+    SharedTocEntry entry(new EBookTocEntry());
+    entry->label = item.name();
+    QSharedPointer<const Poppler::LinkDestination> destination =
+      item.destination();
+    if (destination) {
+      entry->href = QString("page%1").arg(destination->pageNumber());
+    }
+    if (item.hasChildren()) {
+      addOutlineItems(item.children(), entry->children);
+    }
+    entries.append(entry);
+  }
+}
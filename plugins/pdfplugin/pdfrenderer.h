@@ -0,0 +1,73 @@
+#ifndef PDFRENDERER_H
+#define PDFRENDERER_H
+
+#include <QEnableSharedFromThis>
+#include <QDateTime>
+#include <QImage>
+#include <QMutex>
+#include <QSet>
+#include <QSharedPointer>
+#include <QSizeF>
+#include <QString>
+#include <QVector>
+
+#include "ebookmetadata.h"
+#include "ebooktoc.h"
+#include "pdftilecache.h"
+
+namespace Poppler {
+class Document;
+class OutlineItem;
+}
+
+/*!
+ * \brief Renders and reads the pages of a PDF one at a time.
+ *
+ * Loading the book only reads its cross reference table, no page is
+ * parsed until it is rendered or its text is asked for, so a book opens
+ * in the same time however many pages it has.
+ *
+ * Poppler documents may not be used by two threads at once, so every use
+ * is behind a lock. A renderer must be held by a SharedPdfRenderer, the
+ * background renders share it and keep it alive after the document that
+ * made it has gone.
+ */
+class PdfRenderer : public QEnableSharedFromThis<PdfRenderer>
+{
+public:
+  PdfRenderer();
+  ~PdfRenderer();
+
+  bool load(const QString& path);
+  bool isLoaded() const;
+  int pageCount() const;
+  QSizeF pageSize(int page);
+
+  QImage renderPage(int page, int dpi);
+  void prerenderPage(int page, int dpi);
+  QString pageText(int page);
+  QString info(const QString& key);
+  QDateTime date(const QString& key);
+  EBookToc outline();
+  QStringList creators();
+  Metadata metadata();
+
+  PdfTileCache* tileCache();
+
+protected:
+  Poppler::Document* m_document;
+  int m_page_count;
+  QMutex m_mutex;
+  PdfTileCache m_tiles;
+  // pages whose background render has been asked for but not finished.
+  QSet<QString> m_queued;
+  QMutex m_queued_mutex;
+
+  QImage renderTile(int page, int dpi, int column, int row, QSize size);
+  static QString queuedKey(int page, int dpi);
+  static void addOutlineItems(const QVector<Poppler::OutlineItem>& items,
+                              TocEntryList& entries);
+};
+typedef QSharedPointer<PdfRenderer> SharedPdfRenderer;
+
+#endif // PDFRENDERER_H
@@ -0,0 +1,122 @@
+#include "pdftilecache.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
+
+#include <qlogger/qlogger.h>
+
+using namespace qlogger;
+
+PdfTileCache::PdfTileCache()
+{
+  setSize(DEFAULT_SIZE);
+}
+
+/*!
+ * \brief Sets the directory that the tiles of the book at path are
+ * written to, within cache_directory.
+ *
+ * Until this is called the tiles are only held in memory.
+ */
+void PdfTileCache::setDirectory(const QString& cache_directory,
+                                const QString& path)
+{
+  QFileInfo info(path);
+  QByteArray name = (info.absoluteFilePath() + '/' +
+                     info.lastModified().toString(Qt::ISODate))
+                      .toUtf8();
+  QString directory =
+    cache_directory + QDir::separator() + "pdf" + QDir::separator() +
+    QCryptographicHash::hash(name, QCryptographicHash::Md5).toHex();
+  if (!QDir().mkpath(directory)) {
+    QLOG_DEBUG(QString("Unable to create the PDF tile cache %1").arg(directory))
+    directory.clear();
+  }
+
+  QMutexLocker locker(&m_mutex);
+  m_directory = directory;
+}
+
+/*!
+ * \brief Sets the memory held by the tiles in megabytes.
+ */
+void PdfTileCache::setSize(int megabytes)
+{
+  QMutexLocker locker(&m_mutex);
+  // costs are in kilobytes.
+  m_tiles.setMaxCost(qMax(1, megabytes) * 1024);
+}
+
+/*!
+ * \brief The tile, from memory or from disk, or a null QImage if it has
+ * not been rendered.
+ */
+QImage PdfTileCache::tile(int page, int dpi, int column, int row)
+{
+  QString tile_key = key(page, dpi, column, row);
+  QString path;
+  {
+    QMutexLocker locker(&m_mutex);
+    QImage* image = m_tiles.object(tile_key);
+    if (image) {
+      return *image;
+    }
+    if (m_directory.isEmpty()) {
+      return QImage();
+    }
+    path = tilePath(tile_key);
+  }
+
+  // read without the lock, reading a png is slow.
+  QImage image;
+  if (QFileInfo::exists(path) && image.load(path)) {
+    QMutexLocker locker(&m_mutex);
+    m_tiles.insert(tile_key, new QImage(image), cost(image));
+  }
+  return image;
+}
+
+/*!
+ * \brief Adds a newly rendered tile, in memory and on disk.
+ */
+void PdfTileCache::insert(int page,
+                          int dpi,
+                          int column,
+                          int row,
+                          const QImage& tile)
+{
+  if (tile.isNull()) {
+    return;
+  }
+  QString tile_key = key(page, dpi, column, row);
+  QString path;
+  {
+    QMutexLocker locker(&m_mutex);
+    m_tiles.insert(tile_key, new QImage(tile), cost(tile));
+    if (m_directory.isEmpty()) {
+      return;
+    }
+    path = tilePath(tile_key);
+  }
+  if (!tile.save(path, "PNG")) {
+    QLOG_DEBUG(QString("Unable to write the PDF tile %1").arg(path))
+  }
+}
+
+QString PdfTileCache::key(int page, int dpi, int column, int row)
+{
+  return QString("p%1-d%2-c%3-r%4").arg(page).arg(dpi).arg(column).arg(row);
+}
+
+int PdfTileCache::cost(const QImage& image)
+{
+  return qMax(1, int((qint64(image.bytesPerLine()) * image.height()) / 1024));
+}
+
+QString PdfTileCache::tilePath(const QString& key) const
+{
+  return m_directory + QDir::separator() + key + ".png";
+}
@@ -0,0 +1,47 @@
+#ifndef PDFTILECACHE_H
+#define PDFTILECACHE_H
+
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+#include <QString>
+
+/*!
+ * \brief The rendered tiles of the pages of one PDF, kept in memory and
+ * on disk.
+ *
+ * Pages are rendered as square tiles of TILE_SIZE pixels. The tiles most
+ * recently used are held in memory, up to setSize() megabytes, and every
+ * tile is also written as a png file to a directory of its own in the
+ * cache directory. The directory is named from the path and modification
+ * time of the book, so pages rendered in one session are read back in the
+ * next and a changed book is rendered afresh.
+ *
+ * The cache is used by the gui thread and by the background renders so
+ * every method is thread safe.
+ */
+class PdfTileCache
+{
+public:
+  PdfTileCache();
+
+  void setDirectory(const QString& cache_directory, const QString& path);
+  void setSize(int megabytes);
+
+  QImage tile(int page, int dpi, int column, int row);
+  void insert(int page, int dpi, int column, int row, const QImage& tile);
+
+  static const int TILE_SIZE = 512; // pixels.
+  static const int DEFAULT_SIZE = 64; // megabytes.
+
+protected:
+  QString m_directory;
+  QCache<QString, QImage> m_tiles;
+  QMutex m_mutex;
+
+  static QString key(int page, int dpi, int column, int row);
+  static int cost(const QImage& image);
+  QString tilePath(const QString& key) const;
+};
+
+#endif // PDFTILECACHE_H
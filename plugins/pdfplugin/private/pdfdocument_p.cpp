@@ -0,0 +1,193 @@
+#include "pdfdocument_p.h"
+
+#include <QTextCursor>
+
+#include <qlogger/qlogger.h>
+
+using namespace qlogger;
+
+const QString PdfDocumentPrivate::PAGE_IMAGE = "page%1.png";
+const QString PdfDocumentPrivate::PAGE_HTML =
+  "<p><img src=\"%1\" width=\"%2\" height=\"%3\"/></p>";
+
+PdfDocumentPrivate::PdfDocumentPrivate(PdfDocument* parent)
+  : q_ptr(parent)
+  , m_renderer(new PdfRenderer())
+  , m_image_cache_size(PdfTileCache::DEFAULT_SIZE)
+  , m_loaded(false)
+  , m_current_chapter(0)
+  , m_toc_read(false)
+{
+  m_plugin = nullptr;
+}
+
+PdfDocumentPrivate::~PdfDocumentPrivate() {}
+
+/*
+ * Only the cross reference table and the information dictionary are read,
+ * then the first page is shown, so a book with thousands of scanned pages
+ * opens as quickly as one with a few.
+ */
+void PdfDocumentPrivate::openDocument(const QString& path)
+{
+  Q_Q(PdfDocument);
+
+  m_filename = path;
+  m_loaded = false;
+  m_toc_read = false;
+  m_toc = EBookToc();
+  if (!m_cache_directory.isEmpty()) {
+    m_renderer->tileCache()->setDirectory(m_cache_directory, path);
+  }
+  m_renderer->tileCache()->setSize(m_image_cache_size);
+  if (!m_renderer->load(path)) {
+    return;
+  }
+  m_title = m_renderer->info("Title");
+  m_subject = m_renderer->info("Subject");
+  m_creators = m_renderer->creators();
+  m_date = m_renderer->date("CreationDate");
+  q->setUndoRedoEnabled(false);
+
+  if (loadChapter(0)) {
+    m_loaded = true;
+    emit q->loadCompleted();
+  }
+}
+
+/*!
+ * \brief The table of contents, read from the bookmarks when it is first
+ * wanted.
+ */
+EBookToc PdfDocumentPrivate::toc()
+{
+  if (!m_toc_read && m_renderer->isLoaded()) {
+    m_toc = m_renderer->outline();
+    m_toc_read = true;
+  }
+  return m_toc;
+}
+
+Metadata PdfDocumentPrivate::metadata()
+{
+  return m_renderer->metadata();
+}
+
+int PdfDocumentPrivate::currentChapter() const
+{
+  return m_current_chapter;
+}
+
+int PdfDocumentPrivate::chapterCount() const
+{
+  return m_renderer->pageCount();
+}
+
+/*
+ * Only the image of the page is put into the document, it is rendered
+ * when the document asks for it through loadResource().
+ */
+bool PdfDocumentPrivate::loadChapter(int index)
+{
+  Q_Q(PdfDocument);
+
+  if (index < 0 || index >= chapterCount()) {
+    QLOG_WARN(QString("No PDF page at %1").arg(index))
+    return false;
+  }
+
+  bool changing = (!m_loaded || index != m_current_chapter);
+  if (m_loaded && changing) {
+    emit q->chapterAboutToChange(m_current_chapter);
+  }
+  q->clear();
+  QTextCursor cursor(q_ptr);
+  cursor.insertHtml(chapterSource(index));
+  m_current_chapter = index;
+  if (changing) {
+    emit q->chapterChanged(index);
+  }
+  prerenderAround(index);
+  return true;
+}
+
+/*!
+ * \brief The page of an href of the table of contents, pageN counted from
+ * 1.
+ */
+int PdfDocumentPrivate::chapterOfHref(const QString& href) const
+{
+  if (!href.startsWith("page")) {
+    return -1;
+  }
+  bool ok = false;
+  int page = href.mid(4).toInt(&ok) - 1;
+  return (ok && page >= 0 && page < chapterCount() ? page : -1);
+}
+
+QString PdfDocumentPrivate::chapterSource(int index) const
+{
+  QSizeF points = m_renderer->pageSize(index);
+  if (points.isEmpty()) {
+    return QString();
+  }
+  return PAGE_HTML.arg(PAGE_IMAGE.arg(index))
+    .arg(qRound(points.width() * PAGE_DPI / 72.0))
+    .arg(qRound(points.height() * PAGE_DPI / 72.0));
+}
+
+bool PdfDocumentPrivate::reloadChapter()
+{
+  return loadChapter(m_current_chapter);
+}
+
+/*!
+ * \brief Sets the directory that rendered tiles are kept in, used from
+ * the next openDocument().
+ */
+void PdfDocumentPrivate::setCacheDirectory(const QString& directory)
+{
+  m_cache_directory = directory;
+}
+
+void PdfDocumentPrivate::setImageCacheSize(int megabytes)
+{
+  m_image_cache_size = megabytes;
+  m_renderer->tileCache()->setSize(megabytes);
+}
+
+QVariant PdfDocumentPrivate::loadResource(int type, const QUrl& name)
+{
+  if (type != QTextDocument::ImageResource) {
+    return QVariant();
+  }
+  int page = pageOfImage(name);
+  if (page < 0 || page >= chapterCount()) {
+    return QVariant();
+  }
+  QImage image = m_renderer->renderPage(page, PAGE_DPI);
+  return (image.isNull() ? QVariant() : QVariant(image));
+}
+
+/*
+ * The pages either side of the one shown are the ones most likely to be
+ * shown next.
+ */
+void PdfDocumentPrivate::prerenderAround(int index)
+{
+  for (int i = 1; i <= PRERENDER_PAGES; i++) {
+    m_renderer->prerenderPage(index + i, PAGE_DPI);
+    m_renderer->prerenderPage(index - i, PAGE_DPI);
+  }
+}
+
+int PdfDocumentPrivate::pageOfImage(const QUrl& name)
+{
+  QString file = name.toString();
+  if (!file.startsWith("page") || !file.endsWith(".png")) {
+    return -1;
+  }
+  bool ok = false;
+  int page = file.mid(4, file.size() - 8).toInt(&ok);
+  return (ok ? page : -1);
+}
@@ -0,0 +1,71 @@
+#ifndef PDFDOCUMENT_P_H
+#define PDFDOCUMENT_P_H
+
+#include <QDateTime>
+#include <QUrl>
+#include <QVariant>
+
+#include "pdfdocument.h"
+#include "pdfrenderer.h"
+
+class PdfDocumentPrivate : public ITextDocumentPrivate
+{
+public:
+  PdfDocumentPrivate(PdfDocument* parent);
+  virtual ~PdfDocumentPrivate();
+
+  PdfDocument* q_ptr;
+
+  void openDocument(const QString& path);
+
+  IEBookInterface* plugin() { return m_plugin; }
+  void setPlugin(IEBookInterface* plugin) { m_plugin = plugin; }
+
+  QString title() const { return m_title; }
+  void setTitle(QString title) { m_title = title; }
+  QStringList creators() const { return m_creators; }
+  QString language() const { return m_language; }
+  void setLanguage(QString language) { m_language = language; }
+  QDateTime date() const { return m_date; }
+  void setDate(QDateTime date) { m_date = date; }
+
+  EBookToc toc();
+  Metadata metadata();
+
+  int currentChapter() const;
+  int chapterCount() const;
+  bool loadChapter(int index);
+  int chapterOfHref(const QString& href) const;
+  QString chapterSource(int index) const;
+  bool reloadChapter();
+
+  void setCacheDirectory(const QString& directory);
+  void setImageCacheSize(int megabytes);
+  QVariant loadResource(int type, const QUrl& name);
+
+protected:
+  SharedPdfRenderer m_renderer;
+  QString m_cache_directory;
+  int m_image_cache_size;
+  bool m_loaded;
+  int m_current_chapter;
+  QString m_language;
+  QDateTime m_date;
+  EBookToc m_toc;
+  bool m_toc_read;
+
+  void prerenderAround(int index);
+  static int pageOfImage(const QUrl& name);
+
+  // the resolution pages are shown at.
+  static const int PAGE_DPI = 96;
+  // pages either side of the one shown that are rendered ahead.
+  static const int PRERENDER_PAGES = 1;
+  static const QString PAGE_IMAGE;
+  static const QString PAGE_HTML;
+
+private:
+  Q_DECLARE_PUBLIC(PdfDocument)
+};
+
+#endif // PDFDOCUMENT_P_H
@@ -3,14 +3,20 @@ TEMPLATE = subdirs
 
 SUBDIRS += \
     hunspellplugin \
+    googlespellplugin \
     epubplugin \
     mobiplugin \
+    pdfplugin \
     ocrplugin
 
 hunspellplugin.subdir = hunspellplugin
 
+googlespellplugin.subdir = googlespellplugin
+
 epubplugin.subdir = epubplugin
 
 mobiplugin.subdir = mobiplugin
 
+pdfplugin.subdir = pdfplugin
+
 ocrplugin.subdir = ocrplugin